@@ -75,6 +75,7 @@
 
 static void free_channel(struct nvgpu_fifo *f, struct nvgpu_channel *ch);
 static void channel_dump_ref_actions(struct nvgpu_channel *ch);
+static void channel_semaphore_wakeup_reset(struct nvgpu_channel *ch);
 
 static int channel_setup_ramfc(struct nvgpu_channel *c,
 		struct nvgpu_setup_bind_args *args,
@@ -481,7 +482,17 @@ int nvgpu_channel_add_job(struct nvgpu_channel *c,
 	job->num_mapped_buffers = num_mapped_buffers;
 	job->mapped_buffers = mapped_buffers;
 
-	nvgpu_channel_launch_wdt(c);
+	/*
+	 * Deterministic channels have no watchdog, and semaphore wakeups do
+	 * not clean up their jobs (see nvgpu_channel_semaphore_signal()), so
+	 * keep their submits free of these locks.
+	 */
+	if (!nvgpu_channel_is_deterministic(c)) {
+		nvgpu_channel_launch_wdt(c);
+
+		/* dropped in nvgpu_channel_finalize_job() */
+		nvgpu_channel_semaphore_wakeup_get(c);
+	}
 
 	nvgpu_channel_joblist_lock(c);
 	nvgpu_channel_joblist_add(c, job);
@@ -516,6 +527,11 @@ static void nvgpu_channel_finalize_job(struct nvgpu_channel *c,
 	nvgpu_channel_joblist_lock(c);
 	nvgpu_channel_joblist_delete(c, job);
 	nvgpu_channel_joblist_unlock(c);
+
+	/* taken in nvgpu_channel_add_job() */
+	if (!nvgpu_channel_is_deterministic(c)) {
+		nvgpu_channel_semaphore_wakeup_put(c);
+	}
 }
 
 /**
@@ -1048,6 +1064,12 @@ unbind:
 	nvgpu_cond_destroy(&ch->notifier_wq);
 	nvgpu_cond_destroy(&ch->semaphore_wq);
 
+	/*
+	 * Jobs that were never finalized (e.g. on shutdown) still hold
+	 * wakeup references; nothing can wait on this channel anymore.
+	 */
+	channel_semaphore_wakeup_reset(ch);
+
 	/* make sure we catch accesses of unopened channels in case
 	 * there's non-refcounted channel pointers hanging around */
 	ch->g = NULL;
@@ -1286,7 +1308,7 @@ struct nvgpu_channel *nvgpu_channel_open_new(struct gk20a *g,
 	ch->wdt = nvgpu_channel_wdt_alloc(g);
 	if (ch->wdt == NULL) {
 		nvgpu_err(g, "wdt alloc failed");
-		goto clean_up;
+		goto clean_up_inst;
 	}
 	ch->wdt_debug_dump = true;
 #endif
@@ -1302,11 +1324,11 @@ struct nvgpu_channel *nvgpu_channel_open_new(struct gk20a *g,
 
 	if (nvgpu_cond_init(&ch->notifier_wq) != 0) {
 		nvgpu_err(g, "cond init failed");
-		goto clean_up;
+		goto clean_up_inst;
 	}
 	if (nvgpu_cond_init(&ch->semaphore_wq) != 0) {
 		nvgpu_err(g, "cond init failed");
-		goto clean_up;
+		goto clean_up_inst;
 	}
 
 	/* Mark the channel alive, get-able, with 1 initial use
@@ -1324,6 +1346,8 @@ struct nvgpu_channel *nvgpu_channel_open_new(struct gk20a *g,
 
 	return ch;
 
+clean_up_inst:
+	g->ops.channel.free_inst(g, ch);
 clean_up:
 	ch->g = NULL;
 	free_channel(f, ch);
@@ -1367,6 +1391,11 @@ static int nvgpu_channel_setup_usermode(struct nvgpu_channel *c,
 		c->userd_offset = 0U;
 		c->userd_iova = nvgpu_mem_get_addr(g, c->userd_mem);
 		c->usermode_submit_enabled = true;
+		/*
+		 * Work from this channel never goes through the submit path,
+		 * which is where deferred TLB invalidates are issued.
+		 */
+		nvgpu_vm_tlb_disable_defer(c->vm);
 	} else {
 		nvgpu_err(g, "Usermode submit not supported");
 		err = -EINVAL;
@@ -1771,6 +1800,8 @@ void nvgpu_channel_cleanup_sw(struct gk20a *g)
 
 	nvgpu_vfree(g, f->channel);
 	f->channel = NULL;
+	nvgpu_kfree(g, f->sema_wakeup_chids);
+	f->sema_wakeup_chids = NULL;
 	nvgpu_mutex_destroy(&f->free_chs_mutex);
 }
 
@@ -1835,6 +1866,18 @@ int nvgpu_channel_setup_sw(struct gk20a *g)
 		goto clean_up_mutex;
 	}
 
+	f->sema_wakeup_chids = nvgpu_kzalloc(g,
+			DIV_ROUND_UP(f->num_channels, BITS_PER_BYTE));
+	if (f->sema_wakeup_chids == NULL) {
+		nvgpu_err(g, "no mem for semaphore wakeup bitmap");
+		err = -ENOMEM;
+		goto clean_up_channels;
+	}
+	nvgpu_spinlock_init(&f->sema_wakeup_lock);
+	nvgpu_atomic_set(&f->sema_wakeup_event_users, 0);
+	nvgpu_spinlock_init(&f->inst_tree_lock);
+	f->inst_tree = NULL;
+
 	nvgpu_init_list_node(&f->free_chs);
 
 	for (chid = 0; chid < f->num_channels; chid++) {
@@ -1853,6 +1896,10 @@ clean_up:
 
 		nvgpu_channel_destroy(ch);
 	}
+	nvgpu_kfree(g, f->sema_wakeup_chids);
+	f->sema_wakeup_chids = NULL;
+
+clean_up_channels:
 	nvgpu_vfree(g, f->channel);
 	f->channel = NULL;
 
@@ -1990,10 +2037,73 @@ static void nvgpu_channel_semaphore_signal(struct nvgpu_channel *c,
 #endif
 }
 
+void nvgpu_channel_semaphore_wakeup_get(struct nvgpu_channel *ch)
+{
+	struct nvgpu_fifo *f = &ch->g->fifo;
+
+	nvgpu_spinlock_acquire(&f->sema_wakeup_lock);
+	if (ch->sema_wakeup_refs == 0U) {
+		nvgpu_set_bit(ch->chid, f->sema_wakeup_chids);
+	}
+	ch->sema_wakeup_refs = nvgpu_safe_add_u32(ch->sema_wakeup_refs, 1U);
+	nvgpu_spinlock_release(&f->sema_wakeup_lock);
+}
+
+void nvgpu_channel_semaphore_wakeup_put(struct nvgpu_channel *ch)
+{
+	struct nvgpu_fifo *f = &ch->g->fifo;
+
+	nvgpu_spinlock_acquire(&f->sema_wakeup_lock);
+	if (ch->sema_wakeup_refs == 0U) {
+		nvgpu_spinlock_release(&f->sema_wakeup_lock);
+		nvgpu_warn(ch->g, "ch %u: unbalanced semaphore wakeup put",
+			ch->chid);
+		return;
+	}
+	ch->sema_wakeup_refs = nvgpu_safe_sub_u32(ch->sema_wakeup_refs, 1U);
+	if (ch->sema_wakeup_refs == 0U) {
+		nvgpu_clear_bit(ch->chid, f->sema_wakeup_chids);
+	}
+	nvgpu_spinlock_release(&f->sema_wakeup_lock);
+}
+
+static void channel_semaphore_wakeup_reset(struct nvgpu_channel *ch)
+{
+	struct nvgpu_fifo *f = &ch->g->fifo;
+
+	nvgpu_spinlock_acquire(&f->sema_wakeup_lock);
+	ch->sema_wakeup_refs = 0U;
+	nvgpu_clear_bit(ch->chid, f->sema_wakeup_chids);
+	nvgpu_spinlock_release(&f->sema_wakeup_lock);
+}
+
+void nvgpu_channel_semaphore_wakeup_events_get(struct gk20a *g)
+{
+	nvgpu_atomic_inc(&g->fifo.sema_wakeup_event_users);
+}
+
+void nvgpu_channel_semaphore_wakeup_events_put(struct gk20a *g)
+{
+	nvgpu_atomic_dec(&g->fifo.sema_wakeup_event_users);
+}
+
+static void nvgpu_channel_semaphore_wakeup_chid(struct gk20a *g, u32 chid,
+		bool post_events)
+{
+	struct nvgpu_channel *c = &g->fifo.channel[chid];
+
+	if (nvgpu_channel_get(c) != NULL) {
+		if (nvgpu_atomic_read(&c->bound) != 0) {
+			nvgpu_channel_semaphore_signal(c, post_events);
+		}
+		nvgpu_channel_put(c);
+	}
+}
+
 void nvgpu_channel_semaphore_wakeup(struct gk20a *g, bool post_events)
 {
 	struct nvgpu_fifo *f = &g->fifo;
-	u32 chid;
+	unsigned long chid;
 
 	nvgpu_log_fn(g, " ");
 
@@ -2003,14 +2113,22 @@ void nvgpu_channel_semaphore_wakeup(struct gk20a *g, bool post_events)
 	 */
 	nvgpu_assert(g->ops.mm.cache.fb_flush(g) == 0);
 
-	for (chid = 0; chid < f->num_channels; chid++) {
-		struct nvgpu_channel *c = &g->fifo.channel[chid];
-		if (nvgpu_channel_get(c) != NULL) {
-			if (nvgpu_atomic_read(&c->bound) != 0) {
-				nvgpu_channel_semaphore_signal(c, post_events);
-			}
-			nvgpu_channel_put(c);
+	if (post_events &&
+			(nvgpu_atomic_read(&f->sema_wakeup_event_users) != 0)) {
+		for (chid = 0; chid < f->num_channels; chid++) {
+			nvgpu_channel_semaphore_wakeup_chid(g, (u32)chid,
+					post_events);
 		}
+		return;
+	}
+
+	/*
+	 * Channels get registered before their work is submitted to hardware,
+	 * so any release that raised this interrupt belongs to a channel that
+	 * is already visible in the bitmap.
+	 */
+	for_each_set_bit(chid, f->sema_wakeup_chids, f->num_channels) {
+		nvgpu_channel_semaphore_wakeup_chid(g, (u32)chid, post_events);
 	}
 }
 
@@ -2019,29 +2137,35 @@ struct nvgpu_channel *nvgpu_channel_refch_from_inst_ptr(struct gk20a *g,
 			u64 inst_ptr)
 {
 	struct nvgpu_fifo *f = &g->fifo;
-	unsigned int ci;
+	struct nvgpu_rbtree_node *node = NULL;
+	struct nvgpu_channel *ch = NULL;
 
 	if (unlikely(f->channel == NULL)) {
 		return NULL;
 	}
-	for (ci = 0; ci < f->num_channels; ci++) {
-		struct nvgpu_channel *ch;
-		u64 ch_inst_ptr;
 
-		ch = nvgpu_channel_from_id(g, ci);
-		/* only alive channels are searched */
-		if (ch == NULL) {
-			continue;
-		}
+	nvgpu_spinlock_acquire(&f->inst_tree_lock);
+	nvgpu_rbtree_search(inst_ptr, &node, f->inst_tree);
+	if (node != NULL) {
+		/* only alive channels are returned */
+		ch = nvgpu_channel_get(nvgpu_channel_from_inst_node(node));
+	}
+	nvgpu_spinlock_release(&f->inst_tree_lock);
 
-		ch_inst_ptr = nvgpu_inst_block_addr(g, &ch->inst_block);
-		if (inst_ptr == ch_inst_ptr) {
-			return ch;
-		}
+	return ch;
+}
 
-		nvgpu_channel_put(ch);
+static void channel_inst_tree_remove_locked(struct nvgpu_fifo *f,
+		struct nvgpu_channel *ch)
+{
+	struct nvgpu_rbtree_node *node = NULL;
+
+	/* the instance block may have been freed or never indexed */
+	nvgpu_rbtree_search(ch->inst_node.key_start, &node, f->inst_tree);
+	if (node == &ch->inst_node) {
+		nvgpu_rbtree_unlink(&ch->inst_node, &f->inst_tree);
 	}
-	return NULL;
+	(void) memset(&ch->inst_node, 0, sizeof(ch->inst_node));
 }
 
 int nvgpu_channel_alloc_inst(struct gk20a *g, struct nvgpu_channel *ch)
@@ -2055,8 +2179,16 @@ int nvgpu_channel_alloc_inst(struct gk20a *g, struct nvgpu_channel *ch)
 		return err;
 	}
 
+	nvgpu_spinlock_acquire(&g->fifo.inst_tree_lock);
+	channel_inst_tree_remove_locked(&g->fifo, ch);
+	ch->inst_node.key_start = nvgpu_inst_block_addr(g, &ch->inst_block);
+	ch->inst_node.key_end = nvgpu_safe_add_u64(ch->inst_node.key_start,
+			ch->inst_block.size);
+	nvgpu_rbtree_insert(&ch->inst_node, &g->fifo.inst_tree);
+	nvgpu_spinlock_release(&g->fifo.inst_tree_lock);
+
 	nvgpu_log_info(g, "channel %d inst block physical addr: 0x%16llx",
-		ch->chid, nvgpu_inst_block_addr(g, &ch->inst_block));
+		ch->chid, ch->inst_node.key_start);
 
 	nvgpu_log_fn(g, "done");
 	return 0;
@@ -2064,6 +2196,10 @@ int nvgpu_channel_alloc_inst(struct gk20a *g, struct nvgpu_channel *ch)
 
 void nvgpu_channel_free_inst(struct gk20a *g, struct nvgpu_channel *ch)
 {
+	nvgpu_spinlock_acquire(&g->fifo.inst_tree_lock);
+	channel_inst_tree_remove_locked(&g->fifo, ch);
+	nvgpu_spinlock_release(&g->fifo.inst_tree_lock);
+
 	nvgpu_free_inst_block(g, &ch->inst_block);
 }
 
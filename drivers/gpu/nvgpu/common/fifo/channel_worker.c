@@ -26,6 +26,12 @@
 #include <nvgpu/worker.h>
 #include <nvgpu/channel.h>
 
+/*
+ * Job cleanup runs on this many threads, channels spread over them by chid.
+ * The main worker thread is left with the watchdog polling.
+ */
+#define NVGPU_CHANNEL_WORKER_SHARDS	4U
+
 static inline struct nvgpu_channel *
 nvgpu_channel_from_worker_item(struct nvgpu_list_node *node)
 {
@@ -63,7 +69,7 @@ static const struct nvgpu_worker_ops channel_worker_ops = {
 };
 
 /**
- * Initialize the channel worker's metadata and start the background thread.
+ * Initialize the channel worker's metadata and start the background threads.
  */
 int nvgpu_channel_worker_init(struct gk20a *g)
 {
@@ -71,7 +77,8 @@ int nvgpu_channel_worker_init(struct gk20a *g)
 
 	nvgpu_worker_init_name(worker, "nvgpu_channel_poll", g->name);
 
-	return nvgpu_worker_init(g, worker, &channel_worker_ops);
+	return nvgpu_worker_init_sharded(g, worker, &channel_worker_ops,
+			NVGPU_CHANNEL_WORKER_SHARDS);
 }
 
 void nvgpu_channel_worker_deinit(struct gk20a *g)
@@ -84,11 +91,11 @@ void nvgpu_channel_worker_deinit(struct gk20a *g)
 /**
  * Append a channel to the worker's list, if not there already.
  *
- * The worker thread processes work items (channels in its work list) and polls
- * for other things. This adds @ch to the end of the list and wakes the worker
- * up immediately. If the channel already existed in the list, it's not added,
- * because in that case it has been scheduled already but has not yet been
- * processed.
+ * The worker threads process work items (channels in their work lists) and
+ * poll for other things. This adds @ch to the end of the list of the shard
+ * that owns its chid and wakes that shard up immediately. If the channel
+ * already existed in the list, it's not added, because in that case it has
+ * been scheduled already but has not yet been processed.
  */
 void nvgpu_channel_worker_enqueue(struct nvgpu_channel *ch)
 {
@@ -109,8 +116,8 @@ void nvgpu_channel_worker_enqueue(struct nvgpu_channel *ch)
 		return;
 	}
 
-	ret = nvgpu_worker_enqueue(&g->channel_worker.worker,
-			&ch->worker_item);
+	ret = nvgpu_worker_enqueue_sharded(&g->channel_worker.worker,
+			&ch->worker_item, ch->chid);
 	if (ret != 0) {
 		nvgpu_channel_put(ch);
 		return;
@@ -62,14 +62,24 @@ void nvgpu_channel_free_job(struct nvgpu_channel *c,
 	 */
 }
 
+/*
+ * The job list of a deterministic channel is only touched by the submit path,
+ * which the caller serializes per channel like the gpfifo put pointer, and by
+ * the channel teardown after the last submit. Only non-deterministic channels
+ * have a concurrent consumer, the channel worker.
+ */
 void nvgpu_channel_joblist_lock(struct nvgpu_channel *c)
 {
-	nvgpu_mutex_acquire(&c->joblist.pre_alloc.read_lock);
+	if (!nvgpu_channel_is_deterministic(c)) {
+		nvgpu_mutex_acquire(&c->joblist.pre_alloc.read_lock);
+	}
 }
 
 void nvgpu_channel_joblist_unlock(struct nvgpu_channel *c)
 {
-	nvgpu_mutex_release(&c->joblist.pre_alloc.read_lock);
+	if (!nvgpu_channel_is_deterministic(c)) {
+		nvgpu_mutex_release(&c->joblist.pre_alloc.read_lock);
+	}
 }
 
 struct nvgpu_channel_job *nvgpu_channel_joblist_peek(struct nvgpu_channel *c)
@@ -67,6 +67,7 @@ int nvgpu_priv_cmdbuf_queue_alloc(struct vm_gk20a *vm,
 	int err = 0;
 	u32 wait_size, incr_size;
 	u32 mem_per_job;
+	u32 entries_len;
 
 	/*
 	 * sema size is at least as much as syncpt size, but semas may not be
@@ -125,33 +126,33 @@ int nvgpu_priv_cmdbuf_queue_alloc(struct vm_gk20a *vm,
 	}
 	size = (u32)tmp_size;
 
-	q = nvgpu_kzalloc(g, sizeof(*q));
-	if (q == NULL) {
-		return -ENOMEM;
-	}
-
-	q->vm = vm;
-
 	if (job_count > U32_MAX / 2U - 1U) {
-		err = -ERANGE;
-		goto err_free_queue;
+		return -ERANGE;
 	}
 
 	/* One extra to account for the full condition: 2 * job_count + 1 */
-	q->entries_len = nvgpu_safe_mult_u32(2U,
-			nvgpu_safe_add_u32(job_count, 1U));
-	q->entries = nvgpu_vzalloc(g,
-			nvgpu_safe_mult_u64((u64)q->entries_len,
-				sizeof(*q->entries)));
-	if (q->entries == NULL) {
-		err = -ENOMEM;
-		goto err_free_queue;
+	entries_len = nvgpu_safe_mult_u32(2U, nvgpu_safe_add_u32(job_count, 1U));
+
+	/*
+	 * The queue and its entry ring are allocated in one go and stay for the
+	 * lifetime of the channel, so that the submit path only walks memory
+	 * that was set up here.
+	 */
+	q = nvgpu_vzalloc(g, nvgpu_safe_add_u64(sizeof(*q),
+			nvgpu_safe_mult_u64((u64)entries_len,
+				sizeof(*q->entries))));
+	if (q == NULL) {
+		return -ENOMEM;
 	}
 
+	q->vm = vm;
+	q->entries = (struct priv_cmd_entry *)(void *)(q + 1);
+	q->entries_len = entries_len;
+
 	err = nvgpu_dma_alloc_map_sys(vm, size, &q->mem);
 	if (err != 0) {
 		nvgpu_err(g, "%s: memory allocation failed", __func__);
-		goto err_free_entries;
+		goto err_free_queue;
 	}
 
 	tmp_size = q->mem.size / sizeof(u32);
@@ -160,10 +161,8 @@ int nvgpu_priv_cmdbuf_queue_alloc(struct vm_gk20a *vm,
 
 	*queue = q;
 	return 0;
-err_free_entries:
-	nvgpu_vfree(g, q->entries);
 err_free_queue:
-	nvgpu_kfree(g, q);
+	nvgpu_vfree(g, q);
 	return err;
 }
 
@@ -173,8 +172,7 @@ void nvgpu_priv_cmdbuf_queue_free(struct priv_cmd_queue *q)
 	struct gk20a *g = vm->mm->g;
 
 	nvgpu_dma_unmap_free(vm, &q->mem);
-	nvgpu_vfree(g, q->entries);
-	nvgpu_kfree(g, q);
+	nvgpu_vfree(g, q);
 }
 
 /* allocate a cmd buffer with given size. size is number of u32 entries */
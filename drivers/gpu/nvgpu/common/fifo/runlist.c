@@ -64,27 +64,87 @@ void nvgpu_runlist_unlock_active_runlists(struct gk20a *g)
 	}
 }
 
-static u32 nvgpu_runlist_append_tsg(struct gk20a *g,
+static void nvgpu_runlist_tsg_block_dequeue(
+		struct nvgpu_runlist_tsg_block *blk)
+{
+	/* nvgpu_list_del() leaves the node pointing to itself */
+	if (!nvgpu_list_empty(&blk->level_entry)) {
+		nvgpu_list_del(&blk->level_entry);
+	}
+}
+
+static void nvgpu_runlist_tsg_block_queue(struct nvgpu_runlist_domain *domain,
+		struct nvgpu_runlist_tsg_block *blk, u32 level)
+{
+	struct nvgpu_list_node *head = &domain->level_tsgs[level];
+	struct nvgpu_runlist_tsg_block *pos;
+
+	if (!nvgpu_list_empty(&blk->level_entry)) {
+		if (blk->level == level) {
+			return;
+		}
+		nvgpu_list_del(&blk->level_entry);
+	}
+
+	blk->level = level;
+
+	/* keep the tsgid order that walking the active_tsgs bitmap gives */
+	nvgpu_list_for_each_entry(pos, head, nvgpu_runlist_tsg_block,
+			level_entry) {
+		if (pos->tsgid > blk->tsgid) {
+			nvgpu_list_add_tail(&blk->level_entry,
+					&pos->level_entry);
+			return;
+		}
+	}
+	nvgpu_list_add_tail(&blk->level_entry, head);
+}
+
+/*
+ * Requeue all active TSGs and drop every cached block. Used when the runlist
+ * is reloaded as a whole, which is also how TSG timeslice and interleave
+ * changes get applied.
+ */
+static void nvgpu_runlist_tsg_blocks_reset(struct nvgpu_fifo *f,
+		struct nvgpu_runlist_domain *domain)
+{
+	unsigned long tsgid;
+	u32 i;
+
+	for (i = 0U; i < NVGPU_FIFO_RUNLIST_INTERLEAVE_NUM_LEVELS; i++) {
+		while (!nvgpu_list_empty(&domain->level_tsgs[i])) {
+			nvgpu_list_del(domain->level_tsgs[i].next);
+		}
+	}
+
+	for (i = 0U; i < f->num_channels; i++) {
+		domain->tsg_blocks[i].dirty = true;
+	}
+
+	for_each_set_bit(tsgid, domain->active_tsgs, f->num_channels) {
+		struct nvgpu_tsg *tsg = nvgpu_tsg_get_from_id(f->g, (u32)tsgid);
+
+		nvgpu_runlist_tsg_block_queue(domain,
+				&domain->tsg_blocks[tsgid],
+				tsg->interleave_level);
+	}
+}
+
+static int nvgpu_runlist_tsg_block_encode(struct gk20a *g,
 		struct nvgpu_runlist_domain *domain,
-		u32 **runlist_entry,
-		u32 *entries_left,
-		struct nvgpu_tsg *tsg)
+		struct nvgpu_runlist_tsg_block *blk)
 {
 	struct nvgpu_fifo *f = &g->fifo;
+	struct nvgpu_tsg *tsg = nvgpu_tsg_get_from_id(g, blk->tsgid);
 	u32 runlist_entry_words = f->runlist_entry_size / (u32)sizeof(u32);
 	struct nvgpu_channel *ch;
-	u32 count = 0;
+	u32 *runlist_entry;
+	u32 max_entries;
 	u32 timeslice;
 	int err;
 
-	nvgpu_log_fn(f->g, " ");
-
-	if (*entries_left == 0U) {
-		return RUNLIST_APPEND_FAILURE;
-	}
-
 	/* add TSG entry */
-	nvgpu_log_info(g, "add TSG %d to runlist", tsg->tsgid);
+	nvgpu_log_info(g, "encode TSG %d runlist entries", tsg->tsgid);
 
 	/*
 	 * timeslice is measured with PTIMER.
@@ -92,19 +152,32 @@ static u32 nvgpu_runlist_append_tsg(struct gk20a *g,
 	 */
 	err = nvgpu_ptimer_scale(g, tsg->timeslice_us, &timeslice);
 	if (err != 0) {
-		return RUNLIST_APPEND_FAILURE;
+		return err;
 	}
 
-	g->ops.runlist.get_tsg_entry(tsg, *runlist_entry, timeslice);
+	nvgpu_rwsem_down_read(&tsg->ch_list_lock);
 
-	nvgpu_log_info(g, "tsg rl entries left %d runlist [0] %x [1] %x",
-			*entries_left,
-			(*runlist_entry)[0], (*runlist_entry)[1]);
-	*runlist_entry += runlist_entry_words;
-	count++;
-	(*entries_left)--;
+	/* room for the TSG entry and every bound channel */
+	max_entries = nvgpu_safe_add_u32(tsg->ch_count, 1U);
+	if (max_entries > blk->max_entries) {
+		nvgpu_kfree(g, blk->entries);
+		blk->max_entries = 0U;
+		blk->entries = nvgpu_kmalloc(g, nvgpu_safe_mult_u64(
+				(u64)max_entries, f->runlist_entry_size));
+		if (blk->entries == NULL) {
+			nvgpu_rwsem_up_read(&tsg->ch_list_lock);
+			return -ENOMEM;
+		}
+		blk->max_entries = max_entries;
+	}
+
+	runlist_entry = blk->entries;
+	g->ops.runlist.get_tsg_entry(tsg, runlist_entry, timeslice);
+	nvgpu_log_info(g, "tsg runlist [0] %x [1] %x",
+			runlist_entry[0], runlist_entry[1]);
+	runlist_entry += runlist_entry_words;
+	blk->num_entries = 1U;
 
-	nvgpu_rwsem_down_read(&tsg->ch_list_lock);
 	/* add runnable channels bound to this TSG */
 	nvgpu_list_for_each_entry(ch, &tsg->ch_list,
 			nvgpu_channel, ch_entry) {
@@ -113,24 +186,61 @@ static u32 nvgpu_runlist_append_tsg(struct gk20a *g,
 			continue;
 		}
 
-		if (*entries_left == 0U) {
+		if (blk->num_entries == blk->max_entries) {
 			nvgpu_rwsem_up_read(&tsg->ch_list_lock);
-			return RUNLIST_APPEND_FAILURE;
+			return -E2BIG;
 		}
 
 		nvgpu_log_info(g, "add channel %d to runlist",
 			ch->chid);
-		g->ops.runlist.get_ch_entry(ch, *runlist_entry);
-		nvgpu_log_info(g, "rl entries left %d runlist [0] %x [1] %x",
-			*entries_left,
-			(*runlist_entry)[0], (*runlist_entry)[1]);
-		count = nvgpu_safe_add_u32(count, 1U);
-		*runlist_entry += runlist_entry_words;
-		(*entries_left)--;
+		g->ops.runlist.get_ch_entry(ch, runlist_entry);
+		nvgpu_log_info(g, "runlist [0] %x [1] %x",
+			runlist_entry[0], runlist_entry[1]);
+		runlist_entry += runlist_entry_words;
+		blk->num_entries = nvgpu_safe_add_u32(blk->num_entries, 1U);
 	}
 	nvgpu_rwsem_up_read(&tsg->ch_list_lock);
 
-	return count;
+	blk->dirty = false;
+
+	return 0;
+}
+
+static u32 nvgpu_runlist_append_tsg(struct gk20a *g,
+		struct nvgpu_runlist_domain *domain,
+		u32 **runlist_entry,
+		u32 *entries_left,
+		struct nvgpu_runlist_tsg_block *blk)
+{
+	struct nvgpu_fifo *f = &g->fifo;
+	u32 runlist_entry_words = f->runlist_entry_size / (u32)sizeof(u32);
+	int err;
+
+	nvgpu_log_fn(f->g, " ");
+
+	if (blk->dirty) {
+		err = nvgpu_runlist_tsg_block_encode(g, domain, blk);
+		if (err != 0) {
+			nvgpu_err(g, "tsg %u runlist encode failed: %d",
+					blk->tsgid, err);
+			return RUNLIST_APPEND_FAILURE;
+		}
+	}
+
+	if (*entries_left < blk->num_entries) {
+		return RUNLIST_APPEND_FAILURE;
+	}
+
+	nvgpu_log_info(g, "add TSG %d to runlist, %u entries",
+			blk->tsgid, blk->num_entries);
+
+	nvgpu_memcpy((u8 *)*runlist_entry, (const u8 *)blk->entries,
+			(size_t)blk->num_entries * f->runlist_entry_size);
+	*runlist_entry += nvgpu_safe_mult_u32(blk->num_entries,
+			runlist_entry_words);
+	*entries_left = nvgpu_safe_sub_u32(*entries_left, blk->num_entries);
+
+	return blk->num_entries;
 }
 
 
@@ -141,22 +251,20 @@ static u32 nvgpu_runlist_append_prio(struct nvgpu_fifo *f,
 				u32 interleave_level)
 {
 	u32 count = 0;
-	unsigned long tsgid;
+	struct nvgpu_runlist_tsg_block *blk;
 
 	nvgpu_log_fn(f->g, " ");
 
-	for_each_set_bit(tsgid, domain->active_tsgs, f->num_channels) {
-		struct nvgpu_tsg *tsg = nvgpu_tsg_get_from_id(f->g, (u32)tsgid);
+	nvgpu_list_for_each_entry(blk, &domain->level_tsgs[interleave_level],
+			nvgpu_runlist_tsg_block, level_entry) {
 		u32 entries;
 
-		if (tsg->interleave_level == interleave_level) {
-			entries = nvgpu_runlist_append_tsg(f->g, domain,
-					runlist_entry, entries_left, tsg);
-			if (entries == RUNLIST_APPEND_FAILURE) {
-				return RUNLIST_APPEND_FAILURE;
-			}
-			count += entries;
+		entries = nvgpu_runlist_append_tsg(f->g, domain,
+				runlist_entry, entries_left, blk);
+		if (entries == RUNLIST_APPEND_FAILURE) {
+			return RUNLIST_APPEND_FAILURE;
 		}
+		count += entries;
 	}
 
 	return count;
@@ -184,19 +292,15 @@ static u32 nvgpu_runlist_append_med(struct nvgpu_fifo *f,
 				u32 *entries_left)
 {
 	u32 count = 0;
-	unsigned long tsgid;
+	struct nvgpu_runlist_tsg_block *blk;
 
 	nvgpu_log_fn(f->g, " ");
 
-	for_each_set_bit(tsgid, domain->active_tsgs, f->num_channels) {
-		struct nvgpu_tsg *tsg = nvgpu_tsg_get_from_id(f->g, (u32)tsgid);
+	nvgpu_list_for_each_entry(blk,
+			&domain->level_tsgs[NVGPU_FIFO_RUNLIST_INTERLEAVE_LEVEL_MEDIUM],
+			nvgpu_runlist_tsg_block, level_entry) {
 		u32 entries;
 
-		if (tsg->interleave_level !=
-				NVGPU_FIFO_RUNLIST_INTERLEAVE_LEVEL_MEDIUM) {
-			continue;
-		}
-
 		/* LEVEL_MEDIUM list starts with a LEVEL_HIGH, if any */
 
 		entries = nvgpu_runlist_append_hi(f, domain,
@@ -207,7 +311,7 @@ static u32 nvgpu_runlist_append_med(struct nvgpu_fifo *f,
 		count += entries;
 
 		entries = nvgpu_runlist_append_tsg(f->g, domain,
-				runlist_entry, entries_left, tsg);
+				runlist_entry, entries_left, blk);
 		if (entries == RUNLIST_APPEND_FAILURE) {
 			return RUNLIST_APPEND_FAILURE;
 		}
@@ -223,19 +327,15 @@ static u32 nvgpu_runlist_append_low(struct nvgpu_fifo *f,
 				u32 *entries_left)
 {
 	u32 count = 0;
-	unsigned long tsgid;
+	struct nvgpu_runlist_tsg_block *blk;
 
 	nvgpu_log_fn(f->g, " ");
 
-	for_each_set_bit(tsgid, domain->active_tsgs, f->num_channels) {
-		struct nvgpu_tsg *tsg = nvgpu_tsg_get_from_id(f->g, (u32)tsgid);
+	nvgpu_list_for_each_entry(blk,
+			&domain->level_tsgs[NVGPU_FIFO_RUNLIST_INTERLEAVE_LEVEL_LOW],
+			nvgpu_runlist_tsg_block, level_entry) {
 		u32 entries;
 
-		if (tsg->interleave_level !=
-				NVGPU_FIFO_RUNLIST_INTERLEAVE_LEVEL_LOW) {
-			continue;
-		}
-
 		/* The medium level starts with the highs, if any. */
 
 		entries = nvgpu_runlist_append_med(f, domain,
@@ -253,7 +353,7 @@ static u32 nvgpu_runlist_append_low(struct nvgpu_fifo *f,
 		count += entries;
 
 		entries = nvgpu_runlist_append_tsg(f->g, domain,
-				runlist_entry, entries_left, tsg);
+				runlist_entry, entries_left, blk);
 		if (entries == RUNLIST_APPEND_FAILURE) {
 			return RUNLIST_APPEND_FAILURE;
 		}
@@ -327,6 +427,7 @@ static bool nvgpu_runlist_modify_active_locked(struct gk20a *g,
 					       struct nvgpu_channel *ch, bool add)
 {
 	struct nvgpu_tsg *tsg = NULL;
+	struct nvgpu_runlist_tsg_block *blk;
 
 	tsg = nvgpu_tsg_from_ch(ch);
 
@@ -339,6 +440,8 @@ static bool nvgpu_runlist_modify_active_locked(struct gk20a *g,
 		return false;
 	}
 
+	blk = &domain->tsg_blocks[tsg->tsgid];
+
 	if (add) {
 		if (nvgpu_test_and_set_bit(ch->chid,
 				domain->active_channels)) {
@@ -349,6 +452,8 @@ static bool nvgpu_runlist_modify_active_locked(struct gk20a *g,
 			nvgpu_set_bit(tsg->tsgid, domain->active_tsgs);
 			tsg->num_active_channels = nvgpu_safe_add_u32(
 					tsg->num_active_channels, 1U);
+			nvgpu_runlist_tsg_block_queue(domain, blk,
+					tsg->interleave_level);
 		}
 	} else {
 		if (!nvgpu_test_and_clear_bit(ch->chid,
@@ -362,10 +467,14 @@ static bool nvgpu_runlist_modify_active_locked(struct gk20a *g,
 				/* was the only member of this tsg */
 				nvgpu_clear_bit(tsg->tsgid,
 						domain->active_tsgs);
+				nvgpu_runlist_tsg_block_dequeue(blk);
 			}
 		}
 	}
 
+	/* the TSG entry and channel list of this TSG changed */
+	blk->dirty = true;
+
 	return true;
 }
 
@@ -397,6 +506,56 @@ static int nvgpu_runlist_reconstruct_locked(struct gk20a *g,
 	return 0;
 }
 
+/*
+ * Rebuild the sw buffer of a domain and make it the one to be submitted. The
+ * caller submits the runlist to hardware afterwards.
+ */
+static int nvgpu_runlist_rebuild_locked(struct gk20a *g,
+					struct nvgpu_runlist *rl,
+					struct nvgpu_runlist_domain *domain,
+					bool add_entries)
+{
+	struct nvgpu_runlist_mem *mem_tmp;
+	int ret;
+
+	ret = nvgpu_runlist_reconstruct_locked(g, rl, domain, add_entries);
+	if (ret != 0) {
+		return ret;
+	}
+
+	/*
+	 * hw_submit updates mem_hw to hardware; swap the buffers now. mem
+	 * becomes the previously scheduled buffer and it can be modified once
+	 * the runlist lock is released.
+	 */
+
+	mem_tmp = domain->mem;
+	domain->mem = domain->mem_hw;
+	domain->mem_hw = mem_tmp;
+
+	return 0;
+}
+
+static int nvgpu_runlist_wait_locked(struct gk20a *g, struct nvgpu_runlist *rl)
+{
+	int ret;
+
+	ret = g->ops.runlist.wait_pending(g, rl);
+
+	if (ret == -ETIMEDOUT) {
+		nvgpu_err(g, "runlist %d update timeout", rl->id);
+		/* trigger runlist update timeout recovery */
+		return ret;
+
+	} else {
+		if (ret == -EINTR) {
+			nvgpu_err(g, "runlist update interrupted");
+		}
+	}
+
+	return ret;
+}
+
 int nvgpu_runlist_update_locked(struct gk20a *g, struct nvgpu_runlist *rl,
 				struct nvgpu_runlist_domain *domain,
 				struct nvgpu_channel *ch, bool add,
@@ -404,7 +563,6 @@ int nvgpu_runlist_update_locked(struct gk20a *g, struct nvgpu_runlist *rl,
 {
 	int ret = 0;
 	bool add_entries;
-	struct nvgpu_runlist_mem *mem_tmp;
 
 	if (ch != NULL) {
 		bool update = nvgpu_runlist_modify_active_locked(g, domain, ch, add);
@@ -417,23 +575,17 @@ int nvgpu_runlist_update_locked(struct gk20a *g, struct nvgpu_runlist *rl,
 	} else {
 		/* no channel; add means update all, !add means clear all */
 		add_entries = add;
+		if (add_entries) {
+			/* TSG parameters may have changed; encode all again */
+			nvgpu_runlist_tsg_blocks_reset(&g->fifo, domain);
+		}
 	}
 
-	ret = nvgpu_runlist_reconstruct_locked(g, rl, domain, add_entries);
+	ret = nvgpu_runlist_rebuild_locked(g, rl, domain, add_entries);
 	if (ret != 0) {
 		return ret;
 	}
 
-	/*
-	 * hw_submit updates mem_hw to hardware; swap the buffers now. mem
-	 * becomes the previously scheduled buffer and it can be modified once
-	 * the runlist lock is released.
-	 */
-
-	mem_tmp = domain->mem;
-	domain->mem = domain->mem_hw;
-	domain->mem_hw = mem_tmp;
-
 	/*
 	 * A non-active domain may be updated, but submit still the currently
 	 * active one just for simplicity.
@@ -444,18 +596,7 @@ int nvgpu_runlist_update_locked(struct gk20a *g, struct nvgpu_runlist *rl,
 	g->ops.runlist.hw_submit(g, rl);
 
 	if (wait_for_finish) {
-		ret = g->ops.runlist.wait_pending(g, rl);
-
-		if (ret == -ETIMEDOUT) {
-			nvgpu_err(g, "runlist %d update timeout", rl->id);
-			/* trigger runlist update timeout recovery */
-			return ret;
-
-		} else {
-			if (ret == -EINTR) {
-				nvgpu_err(g, "runlist update interrupted");
-			}
-		}
+		ret = nvgpu_runlist_wait_locked(g, rl);
 	}
 
 	return ret;
@@ -678,32 +819,362 @@ int nvgpu_runlist_reload(struct gk20a *g, struct nvgpu_runlist *rl,
 	return nvgpu_runlist_do_update(g, rl, domain, NULL, add, wait_for_finish);
 }
 
-int nvgpu_runlist_reload_ids(struct gk20a *g, u32 runlist_ids, bool add)
+void nvgpu_runlist_batch_begin(struct gk20a *g,
+			       struct nvgpu_runlist_batch *batch)
+{
+	(void)memset(batch, 0, sizeof(*batch));
+	batch->g = g;
+}
+
+void nvgpu_runlist_batch_queue(struct nvgpu_runlist_batch *batch,
+			       struct nvgpu_channel *ch, bool add)
+{
+	struct gk20a *g = batch->g;
+	struct nvgpu_runlist *rl;
+	struct nvgpu_tsg *tsg;
+
+	nvgpu_assert(ch != NULL);
+
+	tsg = nvgpu_tsg_from_ch(ch);
+	if (tsg == NULL) {
+		nvgpu_err(g, "ch %u not bound to a tsg", ch->chid);
+		batch->err = -EINVAL;
+		return;
+	}
+
+	if (tsg->rl_domain == NULL) {
+		/* not participating in scheduling, see nvgpu_runlist_update() */
+		return;
+	}
+
+	rl = ch->runlist;
+
+	/* a later operation on the same channel overrides an earlier one */
+	nvgpu_mutex_acquire(&rl->batch_lock);
+	if (add) {
+		nvgpu_set_bit(ch->chid, rl->batch_add_chids);
+		nvgpu_clear_bit(ch->chid, rl->batch_remove_chids);
+	} else {
+		nvgpu_set_bit(ch->chid, rl->batch_remove_chids);
+		nvgpu_clear_bit(ch->chid, rl->batch_add_chids);
+	}
+	nvgpu_mutex_release(&rl->batch_lock);
+
+	batch->runlist_ids |= BIT32(rl->id);
+}
+
+void nvgpu_runlist_batch_queue_reload(struct nvgpu_runlist_batch *batch,
+				      u32 runlist_ids, bool add)
+{
+	if (add) {
+		batch->reload_ids |= runlist_ids;
+		batch->clear_ids &= ~runlist_ids;
+	} else {
+		batch->clear_ids |= runlist_ids;
+		batch->reload_ids &= ~runlist_ids;
+	}
+}
+
+/*
+ * Apply the queued channel operations that target one domain of a runlist.
+ * Returns true if the set of active channels of the domain changed. Called
+ * with runlist_lock and batch_lock held.
+ */
+static bool nvgpu_runlist_batch_apply_locked(struct gk20a *g,
+					     struct nvgpu_runlist *rl,
+					     struct nvgpu_runlist_domain *domain)
 {
 	struct nvgpu_fifo *f = &g->fifo;
-	int ret = -EINVAL;
-	unsigned long runlist_id = 0;
-	int errcode;
-	unsigned long ulong_runlist_ids = (unsigned long)runlist_ids;
+	bool changed = false;
+	unsigned long chid;
+	u32 i;
 
-	if (g == NULL) {
-		goto end;
+	for (i = 0U; i < 2U; i++) {
+		unsigned long *chids = (i == 0U) ?
+			rl->batch_remove_chids : rl->batch_add_chids;
+
+		for_each_set_bit(chid, chids, f->num_channels) {
+			struct nvgpu_channel *ch = &f->channel[chid];
+			struct nvgpu_tsg *tsg = nvgpu_tsg_from_ch(ch);
+
+			if ((tsg == NULL) || (tsg->rl_domain != domain)) {
+				continue;
+			}
+
+			if (nvgpu_runlist_modify_active_locked(g, domain, ch,
+					i != 0U)) {
+				changed = true;
+			}
+		}
 	}
 
-	ret = 0;
+	return changed;
+}
+
+/*
+ * Apply all queued changes of one runlist and submit it. Returns true if the
+ * runlist was submitted to hardware.
+ */
+static bool nvgpu_runlist_batch_submit_locked(struct nvgpu_runlist_batch *batch,
+					      struct nvgpu_runlist *rl)
+{
+	struct gk20a *g = batch->g;
+	struct nvgpu_runlist_domain *domain;
+	size_t bitmap_size = DIV_ROUND_UP(g->fifo.num_channels, BITS_PER_BYTE);
+	bool reload = (batch->reload_ids & BIT32(rl->id)) != 0U;
+	bool clear = (batch->clear_ids & BIT32(rl->id)) != 0U;
+	bool submit = false;
+	int err;
+
+	nvgpu_mutex_acquire(&rl->batch_lock);
+
+	nvgpu_list_for_each_entry(domain, &rl->domains, nvgpu_runlist_domain,
+				  domains_list) {
+		bool changed;
+		bool add_entries = true;
+
+		changed = nvgpu_runlist_batch_apply_locked(g, rl, domain);
+
+		if (domain == rl->domain) {
+			if (reload) {
+				nvgpu_runlist_tsg_blocks_reset(&g->fifo,
+						domain);
+				changed = true;
+			} else if (clear) {
+				add_entries = false;
+				changed = true;
+			} else {
+				/* nothing to do */
+			}
+		}
+
+		if (!changed) {
+			continue;
+		}
+
+		err = nvgpu_runlist_rebuild_locked(g, rl, domain, add_entries);
+		if (err != 0) {
+			nvgpu_err(g, "failed to update_runlist %u %d",
+					rl->id, err);
+			batch->err = err;
+			continue;
+		}
+		submit = true;
+	}
+
+	(void)memset(rl->batch_add_chids, 0, bitmap_size);
+	(void)memset(rl->batch_remove_chids, 0, bitmap_size);
+	nvgpu_mutex_release(&rl->batch_lock);
+
+	if (submit) {
+		g->ops.runlist.hw_submit(g, rl);
+	}
+
+	return submit;
+}
+
+/*
+ * Queued operations can only be merged when the runlist HALs are the ones
+ * of this file. Otherwise, as on vgpu where there is no batched interface
+ * towards the server, pass every queued operation on to the HALs as it is.
+ */
+static bool nvgpu_runlist_batch_can_merge(struct gk20a *g)
+{
+	return (g->ops.runlist.update == nvgpu_runlist_update) &&
+		(g->ops.runlist.reload == nvgpu_runlist_reload);
+}
+
+/*
+ * Take the next queued operation of a runlist off its bitmaps, removals
+ * first. Returns false if none is left.
+ */
+static bool nvgpu_runlist_batch_pop(struct gk20a *g, struct nvgpu_runlist *rl,
+				    u32 *chid, bool *add)
+{
+	u32 num_channels = g->fifo.num_channels;
+	unsigned long bit;
+	bool found = false;
+
+	nvgpu_mutex_acquire(&rl->batch_lock);
+	bit = find_first_bit(rl->batch_remove_chids, num_channels);
+	if (bit < num_channels) {
+		nvgpu_clear_bit((u32)bit, rl->batch_remove_chids);
+		*add = false;
+		found = true;
+	} else {
+		bit = find_first_bit(rl->batch_add_chids, num_channels);
+		if (bit < num_channels) {
+			nvgpu_clear_bit((u32)bit, rl->batch_add_chids);
+			*add = true;
+			found = true;
+		}
+	}
+	nvgpu_mutex_release(&rl->batch_lock);
+
+	*chid = (u32)bit;
+	return found;
+}
+
+static void nvgpu_runlist_batch_replay(struct nvgpu_runlist_batch *batch,
+				       bool wait_for_finish)
+{
+	struct gk20a *g = batch->g;
+	struct nvgpu_fifo *f = &g->fifo;
+	unsigned long ulong_runlist_ids;
+	unsigned long runlist_id;
+	u32 chid;
+	bool add;
+	int err;
+
+	/* the HALs wait, so no batch_lock is held while calling them */
+	ulong_runlist_ids = (unsigned long)batch->runlist_ids;
 	for_each_set_bit(runlist_id, &ulong_runlist_ids, 32U) {
-		/* Capture the last failure error code */
-		errcode = g->ops.runlist.reload(g,
-						f->runlists[runlist_id],
-						f->runlists[runlist_id]->domain,
-						add, true);
-		if (errcode != 0) {
-			nvgpu_err(g,
-				"failed to update_runlist %lu %d",
-				runlist_id, errcode);
-			ret = errcode;
+		struct nvgpu_runlist *rl = f->runlists[runlist_id];
+
+		while (nvgpu_runlist_batch_pop(g, rl, &chid, &add)) {
+			struct nvgpu_channel *ch = &f->channel[chid];
+
+			err = g->ops.runlist.update(g, rl, ch, add,
+					wait_for_finish);
+			if (err != 0) {
+				batch->err = err;
+			}
+		}
+	}
+
+	ulong_runlist_ids = (unsigned long)(batch->reload_ids |
+			batch->clear_ids);
+	for_each_set_bit(runlist_id, &ulong_runlist_ids, 32U) {
+		struct nvgpu_runlist *rl = f->runlists[runlist_id];
+
+		err = g->ops.runlist.reload(g, rl, rl->domain,
+				(batch->reload_ids & BIT32(runlist_id)) != 0U,
+				wait_for_finish);
+		if (err != 0) {
+			nvgpu_err(g, "failed to update_runlist %lu %d",
+					runlist_id, err);
+			batch->err = err;
+		}
+	}
+}
+
+int nvgpu_runlist_batch_commit(struct nvgpu_runlist_batch *batch,
+			       bool wait_for_finish)
+{
+	struct gk20a *g = batch->g;
+	struct nvgpu_fifo *f = &g->fifo;
+	u32 runlist_ids = batch->runlist_ids | batch->reload_ids |
+			batch->clear_ids;
+	u32 submitted = 0U;
+	u32 timedout = 0U;
+#ifdef CONFIG_NVGPU_LS_PMU
+	u32 token = PMU_INVALID_MUTEX_OWNER_ID;
+	int mutex_ret = 0;
+#endif
+	u32 i;
+	int err;
+
+	nvgpu_log_fn(g, "runlists 0x%x", runlist_ids);
+
+	if (runlist_ids == 0U) {
+		goto end;
+	}
+
+	if (!nvgpu_runlist_batch_can_merge(g)) {
+		nvgpu_runlist_batch_replay(batch, wait_for_finish);
+		goto end;
+	}
+
+	/* same order as nvgpu_runlist_lock_active_runlists() */
+	for (i = 0U; i < f->num_runlists; i++) {
+		struct nvgpu_runlist *rl = &f->active_runlists[i];
+
+		if ((runlist_ids & BIT32(rl->id)) != 0U) {
+			nvgpu_mutex_acquire(&rl->runlist_lock);
 		}
 	}
+#ifdef CONFIG_NVGPU_LS_PMU
+	mutex_ret = nvgpu_pmu_lock_acquire(g, g->pmu,
+		PMU_MUTEX_ID_FIFO, &token);
+#endif
+
+	/* submit everything first so that the runlists switch in parallel */
+	for (i = 0U; i < f->num_runlists; i++) {
+		struct nvgpu_runlist *rl = &f->active_runlists[i];
+
+		if ((runlist_ids & BIT32(rl->id)) == 0U) {
+			continue;
+		}
+
+		if (nvgpu_runlist_batch_submit_locked(batch, rl)) {
+			submitted |= BIT32(rl->id);
+		}
+	}
+
+	/*
+	 * A runlist with queued channels may have been submitted by another
+	 * commit that applied them; wait for it too.
+	 */
+	submitted |= batch->runlist_ids;
+
+	for (i = 0U; wait_for_finish && (i < f->num_runlists); i++) {
+		struct nvgpu_runlist *rl = &f->active_runlists[i];
+
+		if ((submitted & BIT32(rl->id)) == 0U) {
+			continue;
+		}
+
+		err = nvgpu_runlist_wait_locked(g, rl);
+		if (err != 0) {
+			batch->err = err;
+			if (err == -ETIMEDOUT) {
+				timedout |= BIT32(rl->id);
+			}
+		}
+	}
+
+#ifdef CONFIG_NVGPU_LS_PMU
+	if (mutex_ret == 0) {
+		if (nvgpu_pmu_lock_release(g, g->pmu,
+				PMU_MUTEX_ID_FIFO, &token) != 0) {
+			nvgpu_err(g, "failed to release PMU lock");
+		}
+	}
+#endif
+	for (i = 0U; i < f->num_runlists; i++) {
+		struct nvgpu_runlist *rl = &f->active_runlists[i];
+
+		if ((runlist_ids & BIT32(rl->id)) != 0U) {
+			nvgpu_mutex_release(&rl->runlist_lock);
+		}
+	}
+
+	for (i = 0U; i < f->num_runlists; i++) {
+		struct nvgpu_runlist *rl = &f->active_runlists[i];
+
+		if ((timedout & BIT32(rl->id)) != 0U) {
+			nvgpu_rc_runlist_update(g, rl->id);
+		}
+	}
+
+end:
+	return batch->err;
+}
+
+int nvgpu_runlist_reload_ids(struct gk20a *g, u32 runlist_ids, bool add)
+{
+	struct nvgpu_runlist_batch batch;
+	int ret = -EINVAL;
+
+	if (g == NULL) {
+		goto end;
+	}
+
+	nvgpu_runlist_batch_begin(g, &batch);
+	nvgpu_runlist_batch_queue_reload(&batch, runlist_ids, add);
+
+	/* Captures the last failure error code */
+	ret = nvgpu_runlist_batch_commit(&batch, true);
 end:
 	return ret;
 }
@@ -764,6 +1235,23 @@ static void free_rl_mem(struct gk20a *g, struct nvgpu_runlist_mem *mem)
 	nvgpu_kfree(g, mem);
 }
 
+static void nvgpu_runlist_tsg_blocks_free(struct gk20a *g,
+					  struct nvgpu_runlist_domain *domain)
+{
+	struct nvgpu_fifo *f = &g->fifo;
+	u32 i;
+
+	if (domain->tsg_blocks == NULL) {
+		return;
+	}
+
+	for (i = 0U; i < f->num_channels; i++) {
+		nvgpu_kfree(g, domain->tsg_blocks[i].entries);
+	}
+	nvgpu_kfree(g, domain->tsg_blocks);
+	domain->tsg_blocks = NULL;
+}
+
 static void nvgpu_runlist_domain_free(struct gk20a *g,
 				      struct nvgpu_runlist_domain *domain)
 {
@@ -778,6 +1266,7 @@ static void nvgpu_runlist_domain_free(struct gk20a *g,
 	domain->active_channels = NULL;
 	nvgpu_kfree(g, domain->active_tsgs);
 	domain->active_tsgs = NULL;
+	nvgpu_runlist_tsg_blocks_free(g, domain);
 
 	nvgpu_kfree(g, domain);
 }
@@ -854,6 +1343,11 @@ void nvgpu_runlist_cleanup_sw(struct gk20a *g)
 		/* this isn't an owning pointer, just reset */
 		runlist->domain = NULL;
 
+		nvgpu_kfree(g, runlist->batch_add_chids);
+		runlist->batch_add_chids = NULL;
+		nvgpu_kfree(g, runlist->batch_remove_chids);
+		runlist->batch_remove_chids = NULL;
+		nvgpu_mutex_destroy(&runlist->batch_lock);
 		nvgpu_mutex_destroy(&runlist->runlist_lock);
 		f->runlists[runlist->id] = NULL;
 	}
@@ -1009,6 +1503,7 @@ static struct nvgpu_runlist_domain *nvgpu_runlist_domain_alloc(struct gk20a *g,
 	struct nvgpu_fifo *f = &g->fifo;
 	size_t runlist_size = (size_t)f->runlist_entry_size *
 				(size_t)f->num_runlist_entries;
+	u32 i;
 
 	if (domain == NULL) {
 		return NULL;
@@ -1040,6 +1535,22 @@ static struct nvgpu_runlist_domain *nvgpu_runlist_domain_alloc(struct gk20a *g,
 		goto free_active_channels;
 	}
 
+	domain->tsg_blocks = nvgpu_kzalloc(g, nvgpu_safe_mult_u64(
+			sizeof(*domain->tsg_blocks), f->num_channels));
+	if (domain->tsg_blocks == NULL) {
+		goto free_active_tsgs;
+	}
+
+	for (i = 0U; i < f->num_channels; i++) {
+		nvgpu_init_list_node(&domain->tsg_blocks[i].level_entry);
+		domain->tsg_blocks[i].tsgid = i;
+		domain->tsg_blocks[i].dirty = true;
+	}
+
+	for (i = 0U; i < NVGPU_FIFO_RUNLIST_INTERLEAVE_NUM_LEVELS; i++) {
+		nvgpu_init_list_node(&domain->level_tsgs[i]);
+	}
+
 	/* deleted in nvgpu_runlist_domain_free() */
 	nvgpu_list_add_tail(&domain->domains_list, &runlist->domains);
 
@@ -1049,6 +1560,8 @@ static struct nvgpu_runlist_domain *nvgpu_runlist_domain_alloc(struct gk20a *g,
 	}
 
 	return domain;
+free_active_tsgs:
+	nvgpu_kfree(g, domain->active_tsgs);
 free_active_channels:
 	nvgpu_kfree(g, domain->active_channels);
 free_mem_hw:
@@ -1150,7 +1663,28 @@ static void nvgpu_init_active_runlist_mapping(struct gk20a *g)
 
 		nvgpu_init_list_node(&runlist->domains);
 		nvgpu_mutex_init(&runlist->runlist_lock);
+		nvgpu_mutex_init(&runlist->batch_lock);
+	}
+}
+
+static int nvgpu_runlist_alloc_batch_bitmaps(struct gk20a *g)
+{
+	struct nvgpu_fifo *f = &g->fifo;
+	size_t bitmap_size = DIV_ROUND_UP(f->num_channels, BITS_PER_BYTE);
+	u32 i;
+
+	for (i = 0U; i < f->num_runlists; i++) {
+		struct nvgpu_runlist *runlist = &f->active_runlists[i];
+
+		runlist->batch_add_chids = nvgpu_kzalloc(g, bitmap_size);
+		runlist->batch_remove_chids = nvgpu_kzalloc(g, bitmap_size);
+		if ((runlist->batch_add_chids == NULL) ||
+				(runlist->batch_remove_chids == NULL)) {
+			return -ENOMEM;
+		}
 	}
+
+	return 0;
 }
 
 static int nvgpu_runlist_alloc_default_domain(struct gk20a *g)
@@ -1220,6 +1754,11 @@ int nvgpu_runlist_setup_sw(struct gk20a *g)
 
 	nvgpu_init_active_runlist_mapping(g);
 
+	err = nvgpu_runlist_alloc_batch_bitmaps(g);
+	if (err != 0) {
+		goto clean_up_runlist;
+	}
+
 	err = nvgpu_runlist_alloc_default_domain(g);
 	if (err != 0) {
 		goto clean_up_runlist;
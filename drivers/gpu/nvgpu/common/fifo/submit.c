@@ -39,6 +39,7 @@
 #include <nvgpu/trace.h>
 #include <nvgpu/nvhost.h>
 #include <nvgpu/user_fence.h>
+#include <nvgpu/vm.h>
 
 #include <nvgpu/fifo/swprofile.h>
 
@@ -264,7 +265,9 @@ static void nvgpu_submit_append_gpfifo_common(struct nvgpu_channel *c,
 		/* wrap-around */
 		u32 length0 = gpfifo_size - start;
 		u32 length1 = len - length0;
-		struct nvgpu_gpfifo_entry *src2 = &src[length0];
+		/* length0 is in bytes, src2 is the first entry after the wrap */
+		struct nvgpu_gpfifo_entry *src2 = &src[length0 /
+				(u32)sizeof(struct nvgpu_gpfifo_entry)];
 
 		nvgpu_mem_wr_n(g, gpfifo_mem, start, src, length0);
 		nvgpu_mem_wr_n(g, gpfifo_mem, 0, src2, length1);
@@ -477,7 +480,8 @@ static int nvgpu_do_submit(struct nvgpu_channel *c,
 		struct nvgpu_fence_type **fence_out,
 		struct nvgpu_swprofiler *profiler,
 		bool need_job_tracking,
-		bool need_deferred_cleanup)
+		bool need_deferred_cleanup,
+		bool kick)
 {
 	struct gk20a *g = c->g;
 	int err;
@@ -514,7 +518,10 @@ static int nvgpu_do_submit(struct nvgpu_channel *c,
 
 	nvgpu_swprofile_snapshot(profiler, PROF_KICKOFF_APPEND);
 
-	g->ops.userd.gp_put(g, c);
+	/* Batched submits ring all doorbells at the end. */
+	if (kick) {
+		g->ops.userd.gp_put(g, c);
+	}
 
 	return 0;
 }
@@ -527,7 +534,8 @@ static int nvgpu_submit_deterministic(struct nvgpu_channel *c,
 				u32 flags,
 				struct nvgpu_channel_fence *fence,
 				struct nvgpu_fence_type **fence_out,
-				struct nvgpu_swprofiler *profiler)
+				struct nvgpu_swprofiler *profiler,
+				bool kick)
 {
 	bool skip_buffer_refcounting = (flags &
 			NVGPU_SUBMIT_FLAGS_SKIP_BUFFER_REFCOUNTING) != 0U;
@@ -609,7 +617,7 @@ static int nvgpu_submit_deterministic(struct nvgpu_channel *c,
 	}
 
 	err = nvgpu_do_submit(c, gpfifo, userdata, num_entries, flags, fence,
-			fence_out, profiler, need_job_tracking, false);
+			fence_out, profiler, need_job_tracking, false, kick);
 	if (err != 0) {
 		goto clean_up;
 	}
@@ -634,7 +642,8 @@ static int nvgpu_submit_nondeterministic(struct nvgpu_channel *c,
 				u32 flags,
 				struct nvgpu_channel_fence *fence,
 				struct nvgpu_fence_type **fence_out,
-				struct nvgpu_swprofiler *profiler)
+				struct nvgpu_swprofiler *profiler,
+				bool kick)
 {
 	bool skip_buffer_refcounting = (flags &
 			NVGPU_SUBMIT_FLAGS_SKIP_BUFFER_REFCOUNTING) != 0U;
@@ -683,7 +692,7 @@ static int nvgpu_submit_nondeterministic(struct nvgpu_channel *c,
 	}
 
 	err = nvgpu_do_submit(c, gpfifo, userdata, num_entries, flags, fence,
-			fence_out, profiler, need_job_tracking, true);
+			fence_out, profiler, need_job_tracking, true, kick);
 	if (err != 0) {
 		goto clean_up;
 	}
@@ -732,50 +741,51 @@ static int check_submit_allowed(struct nvgpu_channel *c)
 	return 0;
 }
 
-static int nvgpu_submit_channel_gpfifo(struct nvgpu_channel *c,
+/*
+ * Fifo not large enough for request. Kernel can insert gpfifo entries before
+ * and after user gpfifos, so add extra entries in user request. Also, HW with
+ * fifo size N can accept only N-1 entries.
+ */
+static int check_gpfifo_size(struct nvgpu_channel *c, u32 num_entries)
+{
+	if (c->gpfifo.entry_num - 1U < num_entries + EXTRA_GPFIFO_ENTRIES) {
+		nvgpu_err(c->g, "not enough gpfifo space allocated");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+/*
+ * The part of a submit that comes after the checks of
+ * nvgpu_submit_channel_gpfifo(), shared with batched submits.
+ */
+static int nvgpu_submit_channel_gpfifo_validated(struct nvgpu_channel *c,
 				struct nvgpu_gpfifo_entry *gpfifo,
 				struct nvgpu_gpfifo_userdata userdata,
 				u32 num_entries,
 				u32 flags,
 				struct nvgpu_channel_fence *fence,
 				struct nvgpu_fence_type **fence_out,
-				struct nvgpu_swprofiler *profiler)
+				struct nvgpu_swprofiler *profiler,
+				bool kick)
 {
 	struct gk20a *g = c->g;
 	int err;
 
-	err = check_submit_allowed(c);
-	if (err != 0) {
-		return err;
-	}
-
-	/*
-	 * Fifo not large enough for request. Return error immediately.
-	 * Kernel can insert gpfifo entries before and after user gpfifos.
-	 * So, add extra entries in user request. Also, HW with fifo size N
-	 * can accept only N-1 entries.
-	 */
-	if (c->gpfifo.entry_num - 1U < num_entries + EXTRA_GPFIFO_ENTRIES) {
-		nvgpu_err(g, "not enough gpfifo space allocated");
-		return -ENOMEM;
-	}
-
-	nvgpu_swprofile_snapshot(profiler, PROF_KICKOFF_ENTRY);
-
-	/* update debug settings */
-	nvgpu_ltc_sync_enabled(g);
-
 	nvgpu_log_info(g, "channel %d", c->chid);
 
 #ifdef CONFIG_NVGPU_DETERMINISTIC_CHANNELS
 	if (c->deterministic) {
 		err = nvgpu_submit_deterministic(c, gpfifo, userdata,
-				num_entries, flags, fence, fence_out, profiler);
+				num_entries, flags, fence, fence_out, profiler,
+				kick);
 	} else
 #endif
 	{
 		err = nvgpu_submit_nondeterministic(c, gpfifo, userdata,
-				num_entries, flags, fence, fence_out, profiler);
+				num_entries, flags, fence, fence_out, profiler,
+				kick);
 	}
 
 	if (err != 0) {
@@ -808,10 +818,55 @@ static int nvgpu_submit_channel_gpfifo(struct nvgpu_channel *c,
 	nvgpu_log_info(g, "post-submit put %d, get %d, size %d",
 		c->gpfifo.put, c->gpfifo.get, c->gpfifo.entry_num);
 
+	return 0;
+}
+
+static int nvgpu_submit_channel_gpfifo(struct nvgpu_channel *c,
+				struct nvgpu_gpfifo_entry *gpfifo,
+				struct nvgpu_gpfifo_userdata userdata,
+				u32 num_entries,
+				u32 flags,
+				struct nvgpu_channel_fence *fence,
+				struct nvgpu_fence_type **fence_out,
+				struct nvgpu_swprofiler *profiler)
+{
+	struct gk20a *g = c->g;
+	int err;
+
+	err = check_submit_allowed(c);
+	if (err != 0) {
+		return err;
+	}
+
+	/*
+	 * Maps may have deferred their TLB invalidate until work that can
+	 * use them is submitted.
+	 */
+	err = nvgpu_vm_tlb_flush_deferred(c->vm);
+	if (err != 0) {
+		return err;
+	}
+
+	err = check_gpfifo_size(c, num_entries);
+	if (err != 0) {
+		return err;
+	}
+
+	nvgpu_swprofile_snapshot(profiler, PROF_KICKOFF_ENTRY);
+
+	/* update debug settings */
+	nvgpu_ltc_sync_enabled(g);
+
+	err = nvgpu_submit_channel_gpfifo_validated(c, gpfifo, userdata,
+			num_entries, flags, fence, fence_out, profiler, true);
+	if (err != 0) {
+		return err;
+	}
+
 	nvgpu_swprofile_snapshot(profiler, PROF_KICKOFF_END);
 
 	nvgpu_log_fn(g, "done");
-	return err;
+	return 0;
 }
 
 int nvgpu_submit_channel_gpfifo_user(struct nvgpu_channel *c,
@@ -846,3 +901,200 @@ int nvgpu_submit_channel_gpfifo_kernel(struct nvgpu_channel *c,
 	return nvgpu_submit_channel_gpfifo(c, gpfifo, userdata, num_entries,
 			flags, fence, fence_out, NULL);
 }
+
+static int nvgpu_submit_batch_check_wait(struct gk20a *g,
+		struct nvgpu_submit_batch_entry *e, u32 index)
+{
+	if (e->wait_index >= index) {
+		nvgpu_err(g, "batch entry %u waits for entry %u",
+			index, e->wait_index);
+		return -EINVAL;
+	}
+
+	/* The in-batch wait takes the only pre-fence slot of the submit. */
+	if ((e->flags & (NVGPU_SUBMIT_FLAGS_FENCE_WAIT |
+			NVGPU_SUBMIT_FLAGS_SYNC_FENCE)) != 0U) {
+		nvgpu_err(g, "batch entry %u has its own pre-fence", index);
+		return -EINVAL;
+	}
+
+#ifdef CONFIG_TEGRA_GK20A_NVHOST
+	if (!nvgpu_has_syncpoints(g)) {
+		nvgpu_info(g, "in-batch waits need syncpoints");
+		return -ENODEV;
+	}
+
+	return 0;
+#else
+	nvgpu_info(g, "in-batch waits need syncpoints");
+	return -ENODEV;
+#endif
+}
+
+/*
+ * Check all of a batch before any of it is submitted. The entries that later
+ * entries wait for are returned as a bitmask in waited_on.
+ */
+static int nvgpu_submit_batch_validate(struct gk20a *g,
+		struct nvgpu_submit_batch_entry *batch, u32 count,
+		u32 *waited_on)
+{
+	u32 i, j;
+	int err;
+
+	if ((count == 0U) || (count > NVGPU_SUBMIT_BATCH_MAX_CHANNELS)) {
+		return -EINVAL;
+	}
+
+	*waited_on = 0U;
+
+	for (i = 0U; i < count; i++) {
+		struct nvgpu_submit_batch_entry *e = &batch[i];
+		struct nvgpu_channel *c = e->ch;
+		bool flush_vm = true;
+
+		if (c->g != g) {
+			return -EINVAL;
+		}
+
+		for (j = 0U; j < i; j++) {
+			if (batch[j].ch == c) {
+				nvgpu_err(g, "channel %u twice in a batch",
+					c->chid);
+				return -EINVAL;
+			}
+		}
+
+		err = check_submit_allowed(c);
+		if (err != 0) {
+			return err;
+		}
+
+		err = check_gpfifo_size(c, e->num_entries);
+		if (err != 0) {
+			return err;
+		}
+
+		if (e->wait_index != NVGPU_SUBMIT_BATCH_NO_WAIT) {
+			err = nvgpu_submit_batch_check_wait(g, e, i);
+			if (err != 0) {
+				return err;
+			}
+			*waited_on |= BIT32(e->wait_index);
+		}
+
+		/* Channels of a TSG usually share one VM; flush it once. */
+		for (j = 0U; j < i; j++) {
+			if (batch[j].ch->vm == c->vm) {
+				flush_vm = false;
+			}
+		}
+
+		if (flush_vm) {
+			err = nvgpu_vm_tlb_flush_deferred(c->vm);
+			if (err != 0) {
+				return err;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Turn the post fence of an earlier batch entry into a raw syncpoint
+ * pre-fence.
+ */
+static void nvgpu_submit_batch_wait_fence(struct nvgpu_fence_type *post_fence,
+		struct nvgpu_channel_fence *fence)
+{
+	struct nvgpu_user_fence uf = nvgpu_fence_extract_user(post_fence);
+
+	fence->id = uf.syncpt_id;
+	fence->value = uf.syncpt_value;
+	nvgpu_user_fence_release(&uf);
+}
+
+int nvgpu_submit_channels_gpfifo(struct gk20a *g,
+				struct nvgpu_submit_batch_entry *batch,
+				u32 count, u32 *num_submitted,
+				struct nvgpu_swprofiler *profiler)
+{
+	u32 waited_on;
+	u32 submitted = 0U;
+	u32 i;
+	int err;
+
+	*num_submitted = 0U;
+
+	err = nvgpu_submit_batch_validate(g, batch, count, &waited_on);
+	if (err != 0) {
+		return err;
+	}
+
+	nvgpu_swprofile_snapshot(profiler, PROF_KICKOFF_ENTRY);
+
+	/* update debug settings */
+	nvgpu_ltc_sync_enabled(g);
+
+	/*
+	 * Deterministic submits give up their hw access before they return;
+	 * keep the GPU powered until the doorbells have been rung.
+	 */
+	err = gk20a_busy(g);
+	if (err != 0) {
+		return err;
+	}
+
+	for (i = 0U; i < count; i++) {
+		struct nvgpu_submit_batch_entry *e = &batch[i];
+		struct nvgpu_channel_fence fence = e->fence;
+		u32 flags = e->flags;
+
+		if ((waited_on & BIT32(i)) != 0U) {
+			flags |= NVGPU_SUBMIT_FLAGS_FENCE_GET;
+		}
+
+		if (e->wait_index != NVGPU_SUBMIT_BATCH_NO_WAIT) {
+			nvgpu_submit_batch_wait_fence(
+				batch[e->wait_index].fence_out, &fence);
+			flags |= NVGPU_SUBMIT_FLAGS_FENCE_WAIT;
+		}
+
+		e->fence_out = NULL;
+		err = nvgpu_submit_channel_gpfifo_validated(e->ch, e->gpfifo,
+				e->userdata, e->num_entries, flags, &fence,
+				((flags & NVGPU_SUBMIT_FLAGS_FENCE_GET) != 0U) ?
+					&e->fence_out : NULL,
+				profiler, false);
+		if (err != 0) {
+			break;
+		}
+		submitted++;
+	}
+
+	for (i = 0U; i < submitted; i++) {
+		g->ops.userd.gp_put(g, batch[i].ch);
+	}
+
+	gk20a_idle(g);
+
+	/* Drop the post fences that only the batch itself needed. */
+	for (i = 0U; i < submitted; i++) {
+		if (((batch[i].flags & NVGPU_SUBMIT_FLAGS_FENCE_GET) == 0U) &&
+				(batch[i].fence_out != NULL)) {
+			nvgpu_fence_put(batch[i].fence_out);
+			batch[i].fence_out = NULL;
+		}
+	}
+
+	*num_submitted = submitted;
+
+	if (err != 0) {
+		return err;
+	}
+
+	nvgpu_swprofile_snapshot(profiler, PROF_KICKOFF_END);
+
+	return 0;
+}
@@ -221,6 +221,32 @@ static bool nvgpu_tsg_is_multi_channel(struct nvgpu_tsg *tsg)
 	return ret;
 }
 
+/*
+ * Take ch, or all channels of the TSG if ch is NULL, off their runlist in a
+ * single runlist update.
+ */
+static int nvgpu_tsg_remove_from_runlist(struct gk20a *g,
+		struct nvgpu_tsg *tsg, struct nvgpu_channel *ch)
+{
+	struct nvgpu_runlist_batch batch;
+	struct nvgpu_channel *tsg_ch;
+
+	nvgpu_runlist_batch_begin(g, &batch);
+
+	if (ch != NULL) {
+		nvgpu_runlist_batch_queue(&batch, ch, false);
+	} else {
+		nvgpu_rwsem_down_read(&tsg->ch_list_lock);
+		nvgpu_list_for_each_entry(tsg_ch, &tsg->ch_list,
+				nvgpu_channel, ch_entry) {
+			nvgpu_runlist_batch_queue(&batch, tsg_ch, false);
+		}
+		nvgpu_rwsem_up_read(&tsg->ch_list_lock);
+	}
+
+	return nvgpu_runlist_batch_commit(&batch, true);
+}
+
 static int nvgpu_tsg_unbind_channel_common(struct nvgpu_tsg *tsg,
 		struct nvgpu_channel *ch)
 {
@@ -262,8 +288,14 @@ static int nvgpu_tsg_unbind_channel_common(struct nvgpu_tsg *tsg,
 		g->ops.channel.clear(ch);
 	}
 
-	/* Channel should be seen as TSG channel while updating runlist */
-	err = nvgpu_channel_update_runlist(ch, false);
+	/*
+	 * Channel should be seen as TSG channel while updating runlist.
+	 *
+	 * A TSG that has timed out is not re-enabled and all of its channels
+	 * are on their way out, so take them off the runlist together. The
+	 * unbinds of the other channels then find nothing left to update.
+	 */
+	err = nvgpu_tsg_remove_from_runlist(g, tsg, tsg_timedout ? NULL : ch);
 	if (err != 0) {
 		nvgpu_err(g, "update runlist failed ch:%u tsg:%u",
 				ch->chid, tsg->tsgid);
@@ -374,6 +406,14 @@ fail:
 		nvgpu_err(g, "remove ch %u from runlist failed", ch->chid);
 	}
 
+	/*
+	 * The whole TSG is going down, so take its other channels off in one
+	 * runlist update rather than one per channel as they get closed.
+	 */
+	if (nvgpu_tsg_remove_from_runlist(g, tsg, NULL) != 0) {
+		nvgpu_err(g, "remove tsg %u from runlist failed", tsg->tsgid);
+	}
+
 #ifdef CONFIG_NVGPU_DEBUGGER
 	while (ch->mmu_debug_mode_refcnt > 0U) {
 		err = nvgpu_tsg_set_mmu_debug_mode(ch, false);
@@ -1026,6 +1066,29 @@ struct nvgpu_tsg *nvgpu_tsg_from_ch(struct nvgpu_channel *ch)
 	return tsg;
 }
 
+struct nvgpu_tsg *nvgpu_tsg_from_inst_ptr(struct gk20a *g, u64 inst_ptr,
+					  struct nvgpu_channel **refch)
+{
+	struct nvgpu_tsg *tsg = NULL;
+	struct nvgpu_channel *ch;
+
+	*refch = NULL;
+
+	ch = nvgpu_channel_refch_from_inst_ptr(g, inst_ptr);
+	if (ch == NULL) {
+		return NULL;
+	}
+
+	tsg = nvgpu_tsg_from_ch(ch);
+	if (tsg == NULL) {
+		nvgpu_channel_put(ch);
+		return NULL;
+	}
+
+	*refch = ch;
+	return tsg;
+}
+
 int nvgpu_tsg_alloc_sm_error_states_mem(struct gk20a *g,
 					struct nvgpu_tsg *tsg,
 					u32 num_sm)
@@ -37,8 +37,16 @@
 
 static void nvgpu_gr_fecs_trace_periodic_polling(void *arg);
 
+static struct nvgpu_list_node *nvgpu_gr_fecs_trace_context_bucket(
+	struct nvgpu_gr_fecs_trace *trace, u32 context_ptr)
+{
+	/* context_ptr is an instance block page number, low bits vary most. */
+	return &trace->context_hash[context_ptr &
+			(NVGPU_FECS_TRACE_CONTEXT_HASH_SIZE - 1U)];
+}
+
 int nvgpu_gr_fecs_trace_add_context(struct gk20a *g, u32 context_ptr,
-	pid_t pid, u32 vmid, struct nvgpu_list_node *list)
+	pid_t pid, u32 vmid)
 {
 	struct nvgpu_gr_fecs_trace *trace = g->fecs_trace;
 	struct nvgpu_fecs_trace_context_entry *entry;
@@ -61,26 +69,30 @@ int nvgpu_gr_fecs_trace_add_context(struct gk20a *g, u32 context_ptr,
 	entry->vmid = vmid;
 
 	nvgpu_mutex_acquire(&trace->list_lock);
-	nvgpu_list_add_tail(&entry->entry, list);
+	nvgpu_list_add_tail(&entry->entry,
+		nvgpu_gr_fecs_trace_context_bucket(trace, context_ptr));
+	trace->num_contexts++;
 	nvgpu_mutex_release(&trace->list_lock);
 
 	return 0;
 }
 
-void nvgpu_gr_fecs_trace_remove_context(struct gk20a *g, u32 context_ptr,
-	struct nvgpu_list_node *list)
+void nvgpu_gr_fecs_trace_remove_context(struct gk20a *g, u32 context_ptr)
 {
 	struct nvgpu_gr_fecs_trace *trace = g->fecs_trace;
+	struct nvgpu_list_node *bucket =
+		nvgpu_gr_fecs_trace_context_bucket(trace, context_ptr);
 	struct nvgpu_fecs_trace_context_entry *entry, *tmp;
 
 	nvgpu_log(g, gpu_dbg_fn | gpu_dbg_ctxsw,
 		"freeing entry context_ptr=%x", context_ptr);
 
 	nvgpu_mutex_acquire(&trace->list_lock);
-	nvgpu_list_for_each_entry_safe(entry, tmp, list,
+	nvgpu_list_for_each_entry_safe(entry, tmp, bucket,
 			nvgpu_fecs_trace_context_entry,	entry) {
 		if (entry->context_ptr == context_ptr) {
 			nvgpu_list_del(&entry->entry);
+			trace->num_contexts--;
 			nvgpu_log(g, gpu_dbg_ctxsw,
 				"freed entry=%p context_ptr=%x", entry,
 				entry->context_ptr);
@@ -91,49 +103,90 @@ void nvgpu_gr_fecs_trace_remove_context(struct gk20a *g, u32 context_ptr,
 	nvgpu_mutex_release(&trace->list_lock);
 }
 
-void nvgpu_gr_fecs_trace_remove_contexts(struct gk20a *g,
-	struct nvgpu_list_node *list)
+void nvgpu_gr_fecs_trace_remove_contexts(struct gk20a *g)
 {
 	struct nvgpu_gr_fecs_trace *trace = g->fecs_trace;
 	struct nvgpu_fecs_trace_context_entry *entry, *tmp;
+	u32 i;
 
 	nvgpu_mutex_acquire(&trace->list_lock);
-	nvgpu_list_for_each_entry_safe(entry, tmp, list,
-			nvgpu_fecs_trace_context_entry,	entry) {
-		nvgpu_list_del(&entry->entry);
-		nvgpu_kfree(g, entry);
+	for (i = 0U; i < NVGPU_FECS_TRACE_CONTEXT_HASH_SIZE; i++) {
+		nvgpu_list_for_each_entry_safe(entry, tmp,
+				&trace->context_hash[i],
+				nvgpu_fecs_trace_context_entry, entry) {
+			nvgpu_list_del(&entry->entry);
+			nvgpu_kfree(g, entry);
+		}
 	}
+	trace->num_contexts = 0U;
 	nvgpu_mutex_release(&trace->list_lock);
 }
 
 void nvgpu_gr_fecs_trace_find_pid(struct gk20a *g, u32 context_ptr,
-	struct nvgpu_list_node *list, pid_t *pid, u32 *vmid)
+	pid_t *pid, u32 *vmid)
 {
 	struct nvgpu_gr_fecs_trace *trace = g->fecs_trace;
 	struct nvgpu_fecs_trace_context_entry *entry;
 
-	nvgpu_mutex_acquire(&trace->list_lock);
-	nvgpu_list_for_each_entry(entry, list, nvgpu_fecs_trace_context_entry,
-			entry) {
+	nvgpu_list_for_each_entry(entry,
+			nvgpu_gr_fecs_trace_context_bucket(trace, context_ptr),
+			nvgpu_fecs_trace_context_entry, entry) {
 		if (entry->context_ptr == context_ptr) {
 			nvgpu_log(g, gpu_dbg_ctxsw,
 				"found context_ptr=%x -> pid=%d, vmid=%d",
 				entry->context_ptr, entry->pid, entry->vmid);
 			*pid = entry->pid;
 			*vmid = entry->vmid;
-			nvgpu_mutex_release(&trace->list_lock);
 			return;
 		}
 	}
-	nvgpu_mutex_release(&trace->list_lock);
 
 	*pid = 0;
 	*vmid = 0xffffffffU;
 }
 
+/*
+ * Look up a context for the poller, with list_lock held. The last context
+ * found is checked first.
+ */
+static void nvgpu_gr_fecs_trace_lookup(struct gk20a *g,
+	struct nvgpu_gr_fecs_trace *trace, u32 context_ptr,
+	pid_t *pid, u32 *vmid)
+{
+	trace->stats.lookups++;
+
+	if (trace->last_valid && (trace->last_context_ptr == context_ptr)) {
+		*pid = trace->last_pid;
+		*vmid = trace->last_vmid;
+		return;
+	}
+
+	trace->stats.lookup_misses++;
+	nvgpu_gr_fecs_trace_find_pid(g, context_ptr, pid, vmid);
+
+	trace->last_valid = true;
+	trace->last_context_ptr = context_ptr;
+	trace->last_pid = *pid;
+	trace->last_vmid = *vmid;
+}
+
+/* Hand the staged entries to the OS ring. Called with poll_lock held. */
+static void nvgpu_gr_fecs_trace_flush_staging(struct gk20a *g,
+	struct nvgpu_gr_fecs_trace *trace)
+{
+	if (trace->staging_count == 0U) {
+		return;
+	}
+
+	nvgpu_gr_fecs_trace_write_entries(g, trace->staging,
+		trace->staging_count);
+	trace->staging_count = 0U;
+}
+
 int nvgpu_gr_fecs_trace_init(struct gk20a *g)
 {
 	struct nvgpu_gr_fecs_trace *trace;
+	u32 i;
 	int err;
 
 	if (!is_power_of_2((u32)GK20A_FECS_TRACE_NUM_RECORDS)) {
@@ -150,11 +203,23 @@ int nvgpu_gr_fecs_trace_init(struct gk20a *g)
 	}
 	g->fecs_trace = trace;
 
+	trace->staging = nvgpu_vzalloc(g, NVGPU_FECS_TRACE_STAGING_ENTRIES *
+			sizeof(*trace->staging));
+	if (trace->staging == NULL) {
+		nvgpu_err(g, "failed to allocate fecs_trace staging");
+		nvgpu_kfree(g, trace);
+		g->fecs_trace = NULL;
+		nvgpu_set_enabled(g, NVGPU_SUPPORT_FECS_CTXSW_TRACE, false);
+		return -ENOMEM;
+	}
+
 	nvgpu_mutex_init(&trace->poll_lock);
 	nvgpu_mutex_init(&trace->list_lock);
 	nvgpu_mutex_init(&trace->enable_lock);
 
-	nvgpu_init_list_node(&trace->context_list);
+	for (i = 0U; i < NVGPU_FECS_TRACE_CONTEXT_HASH_SIZE; i++) {
+		nvgpu_init_list_node(&trace->context_hash[i]);
+	}
 
 	trace->enable_count = 0;
 
@@ -184,12 +249,13 @@ int nvgpu_gr_fecs_trace_deinit(struct gk20a *g)
 	}
 	nvgpu_periodic_timer_destroy(&trace->poll_timer);
 
-	nvgpu_gr_fecs_trace_remove_contexts(g, &trace->context_list);
+	nvgpu_gr_fecs_trace_remove_contexts(g);
 
 	nvgpu_mutex_destroy(&g->fecs_trace->list_lock);
 	nvgpu_mutex_destroy(&g->fecs_trace->poll_lock);
 	nvgpu_mutex_destroy(&g->fecs_trace->enable_lock);
 
+	nvgpu_vfree(g, trace->staging);
 	nvgpu_kfree(g, g->fecs_trace);
 	g->fecs_trace = NULL;
 	return 0;
@@ -364,8 +430,9 @@ void nvgpu_gr_fecs_trace_reset_buffer(struct gk20a *g)
 }
 
 /*
- * Converts HW entry format to userspace-facing format and pushes it to the
- * queue.
+ * Converts HW entry format to userspace-facing format and stages it for the
+ * queue. Called from the poller with poll_lock and list_lock held; the
+ * staged entries are written and readers woken up once per poll.
  */
 int nvgpu_gr_fecs_trace_ring_read(struct gk20a *g, int index,
 	u32 *vm_update_mask)
@@ -375,7 +442,7 @@ int nvgpu_gr_fecs_trace_ring_read(struct gk20a *g, int index,
 	struct nvgpu_gr_fecs_trace *trace = g->fecs_trace;
 	pid_t cur_pid = 0, new_pid = 0;
 	u32 cur_vmid = 0U, new_vmid = 0U;
-	u32 vmid = 0U;
+	int num_ts = nvgpu_gr_fecs_trace_num_ts(g);
 	int count = 0;
 
 	struct nvgpu_fecs_trace_record *r =
@@ -401,16 +468,16 @@ int nvgpu_gr_fecs_trace_ring_read(struct gk20a *g, int index,
 	r->magic_hi = 0;
 
 	if ((r->context_ptr != 0U) && (r->context_id != 0U)) {
-		nvgpu_gr_fecs_trace_find_pid(g, r->context_ptr,
-			&trace->context_list, &cur_pid, &cur_vmid);
+		nvgpu_gr_fecs_trace_lookup(g, trace, r->context_ptr,
+			&cur_pid, &cur_vmid);
 	} else {
 		cur_vmid = 0xffffffffU;
 		cur_pid = 0;
 	}
 
 	if (r->new_context_ptr != 0U) {
-		nvgpu_gr_fecs_trace_find_pid(g, r->new_context_ptr,
-			&trace->context_list, &new_pid, &new_vmid);
+		nvgpu_gr_fecs_trace_lookup(g, trace, r->new_context_ptr,
+			&new_pid, &new_vmid);
 	} else {
 		new_vmid = 0xffffffffU;
 		new_pid = 0;
@@ -425,8 +492,14 @@ int nvgpu_gr_fecs_trace_ring_read(struct gk20a *g, int index,
 
 	entry.context_id = r->context_id;
 
+	/* Make room for all events of the record. */
+	if ((trace->staging_count + (u32)num_ts) >
+			NVGPU_FECS_TRACE_STAGING_ENTRIES) {
+		nvgpu_gr_fecs_trace_flush_staging(g, trace);
+	}
+
 	/* break out FECS record into trace events */
-	for (i = 0; i < nvgpu_gr_fecs_trace_num_ts(g); i++) {
+	for (i = 0; i < num_ts; i++) {
 
 		entry.tag = (u8)g->ops.gr.ctxsw_prog.hw_get_ts_tag(r->ts[i]);
 		entry.timestamp =
@@ -477,12 +550,11 @@ int nvgpu_gr_fecs_trace_ring_read(struct gk20a *g, int index,
 			g->ops.gr.fecs_trace.vm_dev_write(g, entry.vmid,
 				vm_update_mask, &entry);
 		} else {
-			nvgpu_gr_fecs_trace_write_entry(g, &entry);
+			trace->staging[trace->staging_count++] = entry;
 		}
 		count++;
 	}
 
-	nvgpu_gr_fecs_trace_wake_up(g, (int)vmid);
 	return count;
 }
 
@@ -490,6 +562,8 @@ int nvgpu_gr_fecs_trace_poll(struct gk20a *g)
 {
 	struct nvgpu_gr_fecs_trace *trace = g->fecs_trace;
 	u32 vm_update_mask = 0U;
+	u64 records = 0ULL, entries = 0ULL;
+	s64 start_ns;
 	int read = 0;
 	int write = 0;
 	int cnt;
@@ -535,15 +609,31 @@ int nvgpu_gr_fecs_trace_poll(struct gk20a *g)
 		read = ((u32)read) & (~(BIT32(NVGPU_FECS_TRACE_FEATURE_CONTROL_BIT)));
 	}
 
+	start_ns = nvgpu_current_time_ns();
+
+	/* Look up the contexts of all records under one lock hold. */
+	nvgpu_mutex_acquire(&trace->list_lock);
+	trace->last_valid = false;
 	while (read != write) {
 		cnt = nvgpu_gr_fecs_trace_ring_read(g, read, &vm_update_mask);
 		if (cnt <= 0) {
 			break;
 		}
+		records++;
+		entries += (u64)cnt;
 
 		/* Get to next record. */
 		read = (read + 1) & (GK20A_FECS_TRACE_NUM_RECORDS - 1);
 	}
+	nvgpu_mutex_release(&trace->list_lock);
+
+	nvgpu_gr_fecs_trace_flush_staging(g, trace);
+	nvgpu_gr_fecs_trace_wake_up(g, 0);
+
+	trace->stats.polls++;
+	trace->stats.records += records;
+	trace->stats.entries += entries;
+	trace->stats.decode_ns += (u64)(nvgpu_current_time_ns() - start_ns);
 
 	if (nvgpu_is_enabled(g, NVGPU_FECS_TRACE_FEATURE_CONTROL)) {
 		/*
@@ -580,6 +670,16 @@ done_unlock:
 	return err;
 }
 
+void nvgpu_gr_fecs_trace_get_stats(struct gk20a *g,
+	struct nvgpu_gr_fecs_trace_stats *stats)
+{
+	struct nvgpu_gr_fecs_trace *trace = g->fecs_trace;
+
+	nvgpu_mutex_acquire(&trace->poll_lock);
+	*stats = trace->stats;
+	nvgpu_mutex_release(&trace->poll_lock);
+}
+
 static void nvgpu_gr_fecs_trace_periodic_polling(void *arg)
 {
 	struct gk20a *g = (struct gk20a *)arg;
@@ -664,8 +764,7 @@ int nvgpu_gr_fecs_trace_bind_channel(struct gk20a *g,
 
 	g->ops.gr.ctxsw_prog.set_ts_buffer_ptr(g, mem, addr, aperture_mask);
 
-	ret = nvgpu_gr_fecs_trace_add_context(g, context_ptr, pid, vmid,
-		&trace->context_list);
+	ret = nvgpu_gr_fecs_trace_add_context(g, context_ptr, pid, vmid);
 
 	return ret;
 }
@@ -692,8 +791,7 @@ int nvgpu_gr_fecs_trace_unbind_channel(struct gk20a *g,
 		nvgpu_gr_fecs_trace_poll(g);
 	}
 
-	nvgpu_gr_fecs_trace_remove_context(g, context_ptr,
-		&trace->context_list);
+	nvgpu_gr_fecs_trace_remove_context(g, context_ptr);
 
 	return 0;
 }
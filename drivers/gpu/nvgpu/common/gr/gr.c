@@ -319,8 +319,6 @@ static void gr_remove_support(struct gk20a *g)
 
 	nvgpu_log_fn(g, " ");
 
-	nvgpu_netlist_deinit_ctx_vars(g);
-
 	for (i = 0U; i < g->num_gr_instances; i++) {
 		gr = &g->gr[i];
 
@@ -340,6 +338,9 @@ static void gr_remove_support(struct gk20a *g)
 		gr->golden_image = NULL;
 	}
 
+	/* After the HWPM maps, which may still be built from the netlist */
+	nvgpu_netlist_deinit_ctx_vars(g);
+
 	nvgpu_gr_free(g);
 }
 
@@ -484,6 +485,63 @@ static int gr_init_ecc_init(struct gk20a *g)
 	return err;
 }
 
+#ifdef CONFIG_NVGPU_DEBUGGER
+/*
+ * GR instances with the same layout share one HWPM map. The map is built
+ * by nvgpu_gr_build_hwpm_maps() once GR init is done.
+ */
+static int gr_init_hwpm_map(struct gk20a *g, struct nvgpu_gr *gr)
+{
+	u32 size = nvgpu_gr_falcon_get_pm_ctxsw_image_size(gr->falcon);
+	struct nvgpu_gr_hwpm_map *hwpm_map = NULL;
+	struct nvgpu_gr *other;
+	u32 i;
+	int err;
+
+	err = nvgpu_gr_hwpm_map_init(g, &hwpm_map, size);
+	if (err != 0) {
+		return err;
+	}
+
+	err = nvgpu_gr_hwpm_map_setup(g, hwpm_map, gr->config,
+			gr->instance_id);
+	if (err != 0) {
+		nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+		return err;
+	}
+
+	for (i = 0U; i < g->num_gr_instances; i++) {
+		other = &g->gr[i];
+		if ((other != gr) && (other->hwpm_map != NULL) &&
+		    nvgpu_gr_hwpm_map_is_compatible(other->hwpm_map,
+				hwpm_map)) {
+			nvgpu_log(g, gpu_dbg_gr, "GR%u shares HWPM map of GR%u",
+				gr->instance_id, other->instance_id);
+			nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+			hwpm_map = nvgpu_gr_hwpm_map_get(other->hwpm_map);
+			break;
+		}
+	}
+
+	gr->hwpm_map = hwpm_map;
+
+	return 0;
+}
+
+int nvgpu_gr_build_hwpm_maps(struct gk20a *g)
+{
+	u32 i;
+
+	for (i = 0U; i < g->num_gr_instances; i++) {
+		if (g->gr[i].hwpm_map != NULL) {
+			nvgpu_gr_hwpm_map_build_async(g, g->gr[i].hwpm_map);
+		}
+	}
+
+	return 0;
+}
+#endif
+
 static int gr_init_setup_sw(struct gk20a *g, struct nvgpu_gr *gr)
 {
 	int err = 0;
@@ -502,8 +560,7 @@ static int gr_init_setup_sw(struct gk20a *g, struct nvgpu_gr *gr)
 	}
 
 #ifdef CONFIG_NVGPU_DEBUGGER
-	err = nvgpu_gr_hwpm_map_init(g, &gr->hwpm_map,
-			nvgpu_gr_falcon_get_pm_ctxsw_image_size(gr->falcon));
+	err = gr_init_hwpm_map(g, gr);
 	if (err != 0) {
 		nvgpu_err(g, "hwpm_map init failed");
 		goto clean_up;
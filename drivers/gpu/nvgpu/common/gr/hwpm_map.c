@@ -23,11 +23,13 @@
 #include <nvgpu/gk20a.h>
 #include <nvgpu/netlist.h>
 #include <nvgpu/log.h>
-#include <nvgpu/sort.h>
 #include <nvgpu/kmem.h>
-#include <nvgpu/bsearch.h>
 #include <nvgpu/fbp.h>
+#include <nvgpu/barrier.h>
+#include <nvgpu/timers.h>
+#include <nvgpu/grmgr.h>
 #include <nvgpu/gr/config.h>
+#include <nvgpu/gr/gr_instances.h>
 #include <nvgpu/gr/hwpm_map.h>
 
 /* needed for pri_is_ppc_addr_shared */
@@ -41,6 +43,11 @@
 /* Dummy address for ctxsw'ed pri reg checksum. */
 #define CTXSW_PRI_CHECKSUM_DUMMY_REG  0x00ffffffU
 
+/* Address of a free hash table slot, not a valid register address. */
+#define HWPM_MAP_FREE_SLOT	U32_MAX
+/* 2^32 divided by the golden ratio, for multiplicative hashing. */
+#define HWPM_MAP_HASH_MULT	0x9E3779B1ULL
+
 int nvgpu_gr_hwpm_map_init(struct gk20a *g, struct nvgpu_gr_hwpm_map **hwpm_map,
 	u32 size)
 {
@@ -57,44 +64,150 @@ int nvgpu_gr_hwpm_map_init(struct gk20a *g, struct nvgpu_gr_hwpm_map **hwpm_map,
 		return -ENOMEM;
 	}
 
+	tmp_map->g = g;
 	tmp_map->pm_ctxsw_image_size = size;
 	tmp_map->init = false;
+	nvgpu_ref_init(&tmp_map->ref);
+	nvgpu_mutex_init(&tmp_map->lock);
+	nvgpu_atomic64_set(&tmp_map->lookups, 0);
+	nvgpu_atomic64_set(&tmp_map->misses, 0);
 
 	*hwpm_map = tmp_map;
 
 	return 0;
 }
 
-void nvgpu_gr_hwpm_map_deinit(struct gk20a *g,
-	struct nvgpu_gr_hwpm_map *hwpm_map)
+static struct nvgpu_gr_hwpm_map *nvgpu_gr_hwpm_map_from_ref(
+	struct nvgpu_ref *ref)
 {
+	return (struct nvgpu_gr_hwpm_map *)((uintptr_t)ref -
+				offsetof(struct nvgpu_gr_hwpm_map, ref));
+}
+
+static void nvgpu_gr_hwpm_map_release(struct nvgpu_ref *ref)
+{
+	struct nvgpu_gr_hwpm_map *hwpm_map = nvgpu_gr_hwpm_map_from_ref(ref);
+	struct gk20a *g = hwpm_map->g;
+
+	/* The build reads the netlist, wait for it before anything is freed */
+	nvgpu_thread_stop_graceful(&hwpm_map->build_thread, NULL, NULL);
+
 	if (hwpm_map->init) {
 		nvgpu_big_free(g, hwpm_map->map);
 	}
 
+	nvgpu_kfree(g, hwpm_map->gpcs);
+	nvgpu_mutex_destroy(&hwpm_map->lock);
 	nvgpu_kfree(g, hwpm_map);
 }
 
+void nvgpu_gr_hwpm_map_deinit(struct gk20a *g,
+	struct nvgpu_gr_hwpm_map *hwpm_map)
+{
+	(void)g;
+
+	if (hwpm_map == NULL) {
+		return;
+	}
+
+	nvgpu_ref_put(&hwpm_map->ref, nvgpu_gr_hwpm_map_release);
+}
+
+struct nvgpu_gr_hwpm_map *nvgpu_gr_hwpm_map_get(
+	struct nvgpu_gr_hwpm_map *hwpm_map)
+{
+	nvgpu_ref_get(&hwpm_map->ref);
+	return hwpm_map;
+}
+
+bool nvgpu_gr_hwpm_map_is_compatible(struct nvgpu_gr_hwpm_map *hwpm_map,
+	struct nvgpu_gr_hwpm_map *other)
+{
+	u32 gpc;
+
+	if ((hwpm_map->gpcs == NULL) || (other->gpcs == NULL) ||
+	    (hwpm_map->pm_ctxsw_image_size != other->pm_ctxsw_image_size) ||
+	    (hwpm_map->num_gpcs != other->num_gpcs) ||
+	    (hwpm_map->num_fbps != other->num_fbps) ||
+	    (hwpm_map->num_ltc != other->num_ltc) ||
+	    (hwpm_map->active_fbpa_mask != other->active_fbpa_mask)) {
+		return false;
+	}
+
+	for (gpc = 0U; gpc < hwpm_map->num_gpcs; gpc++) {
+		if ((hwpm_map->gpcs[gpc].phys_id != other->gpcs[gpc].phys_id) ||
+		    (hwpm_map->gpcs[gpc].num_tpcs !=
+				other->gpcs[gpc].num_tpcs) ||
+		    (hwpm_map->gpcs[gpc].num_ppcs !=
+				other->gpcs[gpc].num_ppcs)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 u32 nvgpu_gr_hwpm_map_get_size(struct nvgpu_gr_hwpm_map *hwpm_map)
 {
 	return hwpm_map->pm_ctxsw_image_size;
 }
 
-static int map_cmp(const void *a, const void *b)
+static inline u32 hwpm_map_hash(struct nvgpu_gr_hwpm_map *hwpm_map, u32 addr)
 {
-	const struct ctxsw_buf_offset_map_entry *e1;
-	const struct ctxsw_buf_offset_map_entry *e2;
+	return (u32)((((u64)addr * HWPM_MAP_HASH_MULT) & U32_MAX) >>
+			hwpm_map->hash_shift);
+}
+
+/*
+ * Move the entries of the list built from the netlist into a hash table
+ * sized for them. A register listed more than once keeps its first offset.
+ */
+static int hwpm_map_build_hash(struct gk20a *g,
+	struct nvgpu_gr_hwpm_map *hwpm_map,
+	struct ctxsw_buf_offset_map_entry *list, u32 count)
+{
+	struct ctxsw_buf_offset_map_entry *map;
+	u32 slots = 2U;
+	u32 shift = 31U;
+	u32 max_probe = 0U;
+	u32 i, idx, probe;
+
+	while (slots < nvgpu_safe_mult_u32(count, 2U)) {
+		slots <<= 1U;
+		shift--;
+	}
 
-	e1 = (const struct ctxsw_buf_offset_map_entry *)a;
-	e2 = (const struct ctxsw_buf_offset_map_entry *)b;
+	map = nvgpu_big_malloc(g, nvgpu_safe_mult_u64(slots, sizeof(*map)));
+	if (map == NULL) {
+		return -ENOMEM;
+	}
 
-	if (e1->addr < e2->addr) {
-		return -1;
+	for (i = 0U; i < slots; i++) {
+		map[i].addr = HWPM_MAP_FREE_SLOT;
 	}
 
-	if (e1->addr > e2->addr) {
-		return 1;
+	hwpm_map->hash_shift = shift;
+	hwpm_map->hash_mask = slots - 1U;
+
+	for (i = 0U; i < count; i++) {
+		idx = hwpm_map_hash(hwpm_map, list[i].addr);
+		probe = 0U;
+
+		while ((map[idx].addr != HWPM_MAP_FREE_SLOT) &&
+		       (map[idx].addr != list[i].addr)) {
+			idx = (idx + 1U) & hwpm_map->hash_mask;
+			probe++;
+		}
+
+		if (map[idx].addr == HWPM_MAP_FREE_SLOT) {
+			map[idx] = list[i];
+			max_probe = max(max_probe, probe);
+		}
 	}
+
+	hwpm_map->map = map;
+	hwpm_map->max_probe = max_probe;
+
 	return 0;
 }
 
@@ -246,9 +359,9 @@ static int add_ctxsw_buffer_map_entries_subunits(
 static int add_ctxsw_buffer_map_entries_gpcs(struct gk20a *g,
 					struct ctxsw_buf_offset_map_entry *map,
 					u32 *count, u32 *offset, u32 max_cnt,
-					struct nvgpu_gr_config *config)
+					struct nvgpu_gr_hwpm_map *hwpm_map)
 {
-	u32 num_gpcs = nvgpu_gr_config_get_gpc_count(config);
+	u32 num_gpcs = hwpm_map->num_gpcs;
 	u32 num_ppcs, num_tpcs, gpc_num, base;
 	u32 gpc_base = nvgpu_get_litter_value(g, GPU_LIT_GPC_BASE);
 	u32 gpc_stride = nvgpu_get_litter_value(g, GPU_LIT_GPC_STRIDE);
@@ -258,7 +371,7 @@ static int add_ctxsw_buffer_map_entries_gpcs(struct gk20a *g,
 	u32 tpc_in_gpc_stride = nvgpu_get_litter_value(g, GPU_LIT_TPC_IN_GPC_STRIDE);
 
 	for (gpc_num = 0; gpc_num < num_gpcs; gpc_num++) {
-		num_tpcs = nvgpu_gr_config_get_gpc_tpc_count(config, gpc_num);
+		num_tpcs = hwpm_map->gpcs[gpc_num].num_tpcs;
 		base = gpc_base + (gpc_stride * gpc_num) + tpc_in_gpc_base;
 		if (add_ctxsw_buffer_map_entries_subunits(map,
 					nvgpu_netlist_get_pm_tpc_ctxsw_regs(g),
@@ -268,7 +381,7 @@ static int add_ctxsw_buffer_map_entries_gpcs(struct gk20a *g,
 			return -EINVAL;
 		}
 
-		num_ppcs = nvgpu_gr_config_get_gpc_ppc_count(config, gpc_num);
+		num_ppcs = hwpm_map->gpcs[gpc_num].num_ppcs;
 		base = gpc_base + (gpc_stride * gpc_num) + ppc_in_gpc_base;
 		if (add_ctxsw_buffer_map_entries_subunits(map,
 					nvgpu_netlist_get_pm_ppc_ctxsw_regs(g),
@@ -391,8 +504,83 @@ static int add_ctxsw_buffer_map_entries_gpcs(struct gk20a *g,
  *|=============================================|<----256 byte aligned on Maxwell and later
  */
 
+/* Use the logical id of a GPC the GR manager has no physical id for. */
+static u32 hwpm_map_gpc_phys_id(struct gk20a *g, u32 gr_instance_id, u32 gpc)
+{
+	if (gpc >= nvgpu_grmgr_get_gr_num_gpcs(g, gr_instance_id)) {
+		return gpc;
+	}
+
+	return nvgpu_grmgr_get_gr_gpc_phys_id(g, gr_instance_id, gpc);
+}
+
+/*
+ * Must be called with hwpm_map->lock held.
+ */
+static int hwpm_map_read_layout(struct gk20a *g,
+	struct nvgpu_gr_hwpm_map *hwpm_map, struct nvgpu_gr_config *config,
+	u32 gr_instance_id)
+{
+	struct nvgpu_gr_hwpm_map_gpc *gpcs;
+	u32 num_gpcs, gpc;
+
+	if (hwpm_map->gpcs != NULL) {
+		return 0;
+	}
+
+	num_gpcs = nvgpu_gr_config_get_gpc_count(config);
+	if (num_gpcs == 0U) {
+		return -EINVAL;
+	}
+
+	gpcs = nvgpu_kzalloc(g, nvgpu_safe_mult_u64(num_gpcs, sizeof(*gpcs)));
+	if (gpcs == NULL) {
+		return -ENOMEM;
+	}
+
+	for (gpc = 0U; gpc < num_gpcs; gpc++) {
+		gpcs[gpc].phys_id = hwpm_map_gpc_phys_id(g, gr_instance_id, gpc);
+		gpcs[gpc].num_tpcs =
+			nvgpu_gr_config_get_gpc_tpc_count(config, gpc);
+		gpcs[gpc].num_ppcs =
+			nvgpu_gr_config_get_gpc_ppc_count(config, gpc);
+	}
+
+	hwpm_map->num_fbps = nvgpu_fbp_get_num_fbps(g->fbp);
+	hwpm_map->num_ltc = g->ops.top.get_max_ltc_per_fbp(g) *
+			    g->ops.priv_ring.get_fbp_count(g);
+
+	if (g->ops.gr.hwpm_map.get_active_fbpa_mask) {
+		hwpm_map->active_fbpa_mask =
+			g->ops.gr.hwpm_map.get_active_fbpa_mask(g);
+	} else {
+		hwpm_map->active_fbpa_mask = ~U32(0U);
+	}
+
+	hwpm_map->num_gpcs = num_gpcs;
+	hwpm_map->gpcs = gpcs;
+
+	return 0;
+}
+
+int nvgpu_gr_hwpm_map_setup(struct gk20a *g,
+	struct nvgpu_gr_hwpm_map *hwpm_map, struct nvgpu_gr_config *config,
+	u32 gr_instance_id)
+{
+	int err;
+
+	nvgpu_mutex_acquire(&hwpm_map->lock);
+	err = hwpm_map_read_layout(g, hwpm_map, config, gr_instance_id);
+	nvgpu_mutex_release(&hwpm_map->lock);
+
+	return err;
+}
+
+/*
+ * Must be called with hwpm_map->lock held, after hwpm_map_read_layout().
+ */
 static int nvgpu_gr_hwpm_map_create(struct gk20a *g,
-	struct nvgpu_gr_hwpm_map *hwpm_map, struct nvgpu_gr_config *config)
+	struct nvgpu_gr_hwpm_map *hwpm_map)
 {
 	u32 hwpm_ctxsw_buffer_size = hwpm_map->pm_ctxsw_image_size;
 	struct ctxsw_buf_offset_map_entry *map;
@@ -401,13 +589,12 @@ static int nvgpu_gr_hwpm_map_create(struct gk20a *g,
 	u32 i, count = 0;
 	u32 offset = 0;
 	int ret;
-	u32 active_fbpa_mask;
-	u32 num_fbps = nvgpu_fbp_get_num_fbps(g->fbp);
+	s64 start_ns = nvgpu_current_time_ns();
+	u32 num_fbps = hwpm_map->num_fbps;
 	u32 ltc_stride = nvgpu_get_litter_value(g, GPU_LIT_LTC_STRIDE);
 	u32 num_fbpas = nvgpu_get_litter_value(g, GPU_LIT_NUM_FBPAS);
 	u32 fbpa_stride = nvgpu_get_litter_value(g, GPU_LIT_FBPA_STRIDE);
-	u32 num_ltc = g->ops.top.get_max_ltc_per_fbp(g) *
-		      g->ops.priv_ring.get_fbp_count(g);
+	u32 num_ltc = hwpm_map->num_ltc;
 
 	if (hwpm_ctxsw_buffer_size == 0U) {
 		nvgpu_log(g, gpu_dbg_fn | gpu_dbg_gpu_dbg,
@@ -499,17 +686,12 @@ static int nvgpu_gr_hwpm_map_create(struct gk20a *g,
 		goto cleanup;
 	}
 
-	if (g->ops.gr.hwpm_map.get_active_fbpa_mask) {
-		active_fbpa_mask = g->ops.gr.hwpm_map.get_active_fbpa_mask(g);
-	} else {
-		active_fbpa_mask = ~U32(0U);
-	}
-
 	/* Add entries from _LIST_nv_pm_fbpa_ctx_regs */
 	if (add_ctxsw_buffer_map_entries_subunits(map,
 			nvgpu_netlist_get_pm_fbpa_ctxsw_regs(g),
 			&count, &offset, hwpm_ctxsw_reg_count_max, 0,
-			num_fbpas, active_fbpa_mask, fbpa_stride, ~U32(0U))
+			num_fbpas, hwpm_map->active_fbpa_mask, fbpa_stride,
+			~U32(0U))
 				!= 0) {
 		goto cleanup;
 	}
@@ -545,7 +727,7 @@ static int nvgpu_gr_hwpm_map_create(struct gk20a *g,
 
 	/* Add GPC entries */
 	if (add_ctxsw_buffer_map_entries_gpcs(g, map, &count, &offset,
-			hwpm_ctxsw_reg_count_max, config) != 0) {
+			hwpm_ctxsw_reg_count_max, hwpm_map) != 0) {
 		goto cleanup;
 	}
 
@@ -554,12 +736,6 @@ static int nvgpu_gr_hwpm_map_create(struct gk20a *g,
 		goto cleanup;
 	}
 
-	sort(map, count, sizeof(*map), map_cmp, NULL);
-
-	hwpm_map->map = map;
-	hwpm_map->count = count;
-	hwpm_map->init = true;
-
 	nvgpu_log(g, gpu_dbg_hwpm,
 		"Reg Addr => HWPM Ctxt switch buffer offset");
 
@@ -568,6 +744,25 @@ static int nvgpu_gr_hwpm_map_create(struct gk20a *g,
 			map[i].addr, map[i].offset);
 	}
 
+	ret = hwpm_map_build_hash(g, hwpm_map, map, count);
+	nvgpu_big_free(g, map);
+	if (ret != 0) {
+		nvgpu_err(g, "Failed to allocate HWPM buffer offset map");
+		return ret;
+	}
+
+	hwpm_map->count = count;
+	hwpm_map->build_ns = nvgpu_safe_cast_s64_to_u64(
+			nvgpu_safe_sub_s64(nvgpu_current_time_ns(), start_ns));
+
+	nvgpu_log(g, gpu_dbg_gr | gpu_dbg_gpu_dbg,
+		"HWPM map: %u regs in %u slots, built in %llu ns",
+		count, hwpm_map->hash_mask + 1U, hwpm_map->build_ns);
+
+	/* Publish the table before lookups without the lock can see init */
+	nvgpu_smp_wmb();
+	NV_WRITE_ONCE(hwpm_map->init, true);
+
 	return 0;
 
 cleanup:
@@ -576,6 +771,46 @@ cleanup:
 	return -EINVAL;
 }
 
+static int nvgpu_gr_hwpm_map_build_thread(void *arg)
+{
+	struct nvgpu_gr_hwpm_map *hwpm_map = arg;
+	int err = 0;
+
+	nvgpu_mutex_acquire(&hwpm_map->lock);
+	if (!hwpm_map->init) {
+		err = nvgpu_gr_hwpm_map_create(hwpm_map->g, hwpm_map);
+	}
+	nvgpu_mutex_release(&hwpm_map->lock);
+
+	return err;
+}
+
+void nvgpu_gr_hwpm_map_build_async(struct gk20a *g,
+	struct nvgpu_gr_hwpm_map *hwpm_map)
+{
+	bool start;
+	int err;
+
+	nvgpu_mutex_acquire(&hwpm_map->lock);
+	start = !hwpm_map->init && !hwpm_map->build_started &&
+		(hwpm_map->gpcs != NULL);
+	if (start) {
+		hwpm_map->build_started = true;
+	}
+	nvgpu_mutex_release(&hwpm_map->lock);
+
+	if (!start) {
+		return;
+	}
+
+	err = nvgpu_thread_create(&hwpm_map->build_thread, hwpm_map,
+			nvgpu_gr_hwpm_map_build_thread, "nvgpu_hwpm_map");
+	if (err != 0) {
+		nvgpu_warn(g, "HWPM map thread failed (%d), build on first use",
+			err);
+	}
+}
+
 /*
  *  This function will return the 32 bit offset for a priv register if it is
  *  present in the PM context buffer.
@@ -584,33 +819,66 @@ int nvgpu_gr_hwmp_map_find_priv_offset(struct gk20a *g,
 	struct nvgpu_gr_hwpm_map *hwpm_map,
 	u32 addr, u32 *priv_offset, struct nvgpu_gr_config *config)
 {
-	struct ctxsw_buf_offset_map_entry *map, *result, map_key;
+	struct ctxsw_buf_offset_map_entry *map;
 	int err = 0;
-	u32 count;
+	u32 idx;
 
 	nvgpu_log(g, gpu_dbg_fn | gpu_dbg_gpu_dbg, "addr=0x%x", addr);
 
-	/* Create map of pri address and pm offset if necessary */
-	if (!hwpm_map->init) {
-		err = nvgpu_gr_hwpm_map_create(g, hwpm_map, config);
+	/*
+	 * The map is normally built by the thread started at GR init. Wait
+	 * for it, or build the map here if it was not started or failed.
+	 */
+	if (!NV_READ_ONCE(hwpm_map->init)) {
+		nvgpu_mutex_acquire(&hwpm_map->lock);
+		if (!hwpm_map->init) {
+			err = hwpm_map_read_layout(g, hwpm_map, config,
+					nvgpu_gr_get_cur_instance_id(g));
+			if (err == 0) {
+				err = nvgpu_gr_hwpm_map_create(g, hwpm_map);
+			}
+		}
+		nvgpu_mutex_release(&hwpm_map->lock);
 		if (err != 0) {
 			return err;
 		}
+	} else {
+		nvgpu_smp_rmb();
 	}
 
 	*priv_offset = 0;
+	nvgpu_atomic64_inc(&hwpm_map->lookups);
 
 	map = hwpm_map->map;
-	count = hwpm_map->count;
+	idx = hwpm_map_hash(hwpm_map, addr);
 
-	map_key.addr = addr;
-	result = nvgpu_bsearch(&map_key, map, count, sizeof(*map), map_cmp);
+	while (map[idx].addr != HWPM_MAP_FREE_SLOT) {
+		if (map[idx].addr == addr) {
+			*priv_offset = map[idx].offset;
+			return 0;
+		}
+		idx = (idx + 1U) & hwpm_map->hash_mask;
+	}
 
-	if (result != NULL) {
-		*priv_offset = result->offset;
-	} else {
-		err = -EINVAL;
+	nvgpu_atomic64_inc(&hwpm_map->misses);
+
+	return -EINVAL;
+}
+
+void nvgpu_gr_hwpm_map_get_stats(struct nvgpu_gr_hwpm_map *hwpm_map,
+	struct nvgpu_gr_hwpm_map_stats *stats)
+{
+	(void) memset(stats, 0, sizeof(*stats));
+
+	nvgpu_mutex_acquire(&hwpm_map->lock);
+	if (hwpm_map->init) {
+		stats->count = hwpm_map->count;
+		stats->slots = hwpm_map->hash_mask + 1U;
+		stats->max_probe = hwpm_map->max_probe;
+		stats->build_ns = hwpm_map->build_ns;
 	}
+	nvgpu_mutex_release(&hwpm_map->lock);
 
-	return err;
+	stats->lookups = (u64)nvgpu_atomic64_read(&hwpm_map->lookups);
+	stats->misses = (u64)nvgpu_atomic64_read(&hwpm_map->misses);
 }
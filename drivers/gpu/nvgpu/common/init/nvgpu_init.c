@@ -50,6 +50,7 @@
 #include <nvgpu/gsp/gsp_test.h>
 #endif
 #include <nvgpu/pm_reservation.h>
+#include <nvgpu/regops.h>
 #include <nvgpu/netlist.h>
 #include <nvgpu/hal_init.h>
 #ifdef CONFIG_NVGPU_NON_FUSA
@@ -884,6 +885,7 @@ int nvgpu_finalize_poweron(struct gk20a *g)
 #ifdef CONFIG_NVGPU_DEBUGGER
 		NVGPU_INIT_TABLE_ENTRY(g->ops.ptimer.config_gr_tick_freq,
 				       NO_FLAG),
+		NVGPU_INIT_TABLE_ENTRY(&nvgpu_regops_allowlist_init, NO_FLAG),
 #endif
 
 #ifdef CONFIG_NVGPU_DGPU
@@ -938,6 +940,9 @@ int nvgpu_finalize_poweron(struct gk20a *g)
 		NVGPU_INIT_TABLE_ENTRY(g->ops.pmu.pmu_rtos_init, NO_FLAG),
 #endif
 		NVGPU_INIT_TABLE_ENTRY(g->ops.gr.gr_init_support, NO_FLAG),
+#ifdef CONFIG_NVGPU_DEBUGGER
+		NVGPU_INIT_TABLE_ENTRY(&nvgpu_gr_build_hwpm_maps, NO_FLAG),
+#endif
 		/**
 		 * All units requiring ECC stats must initialize ECC counters
 		 * before this call to finalize ECC support.
@@ -1203,6 +1208,9 @@ static void gk20a_free_cb(struct nvgpu_ref *refcount)
 #ifdef CONFIG_NVGPU_PROFILER
 	nvgpu_pm_reservation_deinit(g);
 #endif
+#ifdef CONFIG_NVGPU_DEBUGGER
+	nvgpu_regops_allowlist_deinit(g);
+#endif
 
 	nvgpu_sw_quiesce_remove_support(g);
 
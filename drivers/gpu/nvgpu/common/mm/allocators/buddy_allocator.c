@@ -171,17 +171,7 @@ static void balloc_buddy_list_do_add(struct nvgpu_buddy_allocator *a,
 		nvgpu_do_assert();
 	}
 
-	/*
-	 * Add big PTE blocks to the tail, small to the head for GVA spaces.
-	 * This lets the code that checks if there are available blocks check
-	 * without cycling through the entire list.
-	 */
-	if (((a->flags & GPU_ALLOC_GVA_SPACE) != 0ULL) &&
-		(b->pte_size == BALLOC_PTE_SIZE_BIG)) {
-		nvgpu_list_add_tail(&b->buddy_entry, list);
-	} else {
-		nvgpu_list_add(&b->buddy_entry, list);
-	}
+	nvgpu_list_add(&b->buddy_entry, list);
 
 	buddy_set_in_list(b);
 }
@@ -202,22 +192,37 @@ static void balloc_buddy_list_do_rem(struct nvgpu_buddy_allocator *a,
 
 /*
  * Add a buddy to one of the buddy lists and deal with the necessary
- * book keeping. Adds the buddy to the list specified by the buddy's order.
+ * book keeping. Adds the buddy to the list specified by the buddy's order and
+ * PTE size.
  */
 static void balloc_blist_add(struct nvgpu_buddy_allocator *a,
 			     struct nvgpu_buddy *b)
 {
-	balloc_buddy_list_do_add(a, b, balloc_get_order_list(a, b->order));
+	u32 idx = balloc_pte_list_idx(b->pte_size);
+
+	balloc_buddy_list_do_add(a, b, balloc_get_order_list(a, b->order, idx));
+	nvgpu_set_bit(U32(b->order), a->buddy_list_map[idx]);
 	a->buddy_list_len[b->order] =
 		nvgpu_safe_add_u64(a->buddy_list_len[b->order], 1ULL);
+
+	b->free_entry.key_start = b->start;
+	b->free_entry.key_end = b->end;
+	nvgpu_rbtree_insert(&b->free_entry, &a->free_buddies);
 }
 
 static void balloc_blist_rem(struct nvgpu_buddy_allocator *a,
 			     struct nvgpu_buddy *b)
 {
+	u32 idx = balloc_pte_list_idx(b->pte_size);
+
 	balloc_buddy_list_do_rem(a, b);
+	if (nvgpu_list_empty(balloc_get_order_list(a, b->order, idx))) {
+		nvgpu_clear_bit(U32(b->order), a->buddy_list_map[idx]);
+	}
 	nvgpu_assert(a->buddy_list_len[b->order] > 0ULL);
 	a->buddy_list_len[b->order]--;
+
+	nvgpu_rbtree_unlink(&b->free_entry, &a->free_buddies);
 }
 
 static u64 balloc_get_order(struct nvgpu_buddy_allocator *a, u64 len)
@@ -249,16 +254,19 @@ static u64 balloc_max_order_in(struct nvgpu_buddy_allocator *a,
  */
 static int balloc_init_lists(struct nvgpu_buddy_allocator *a)
 {
-	u32 i;
+	u32 i, idx;
 	u64 bstart, bend, order;
 	struct nvgpu_buddy *buddy;
+	struct nvgpu_list_node *list;
 
 	bstart = a->start;
 	bend = a->end;
 
 	/* First make sure the LLs are valid. */
 	for (i = 0U; i < GPU_BALLOC_ORDER_LIST_LEN; i++) {
-		nvgpu_init_list_node(balloc_get_order_list(a, i));
+		for (idx = 0U; idx < BALLOC_PTE_LIST_NUM; idx++) {
+			nvgpu_init_list_node(balloc_get_order_list(a, i, idx));
+		}
 	}
 
 	while (bstart < bend) {
@@ -277,10 +285,11 @@ static int balloc_init_lists(struct nvgpu_buddy_allocator *a)
 	return 0;
 
 cleanup:
+	/* Top level buddies never have a PTE size yet. */
 	for (i = 0U; i < GPU_BALLOC_ORDER_LIST_LEN; i++) {
-		if (!nvgpu_list_empty(balloc_get_order_list(a, i))) {
-			buddy = nvgpu_list_first_entry(
-					balloc_get_order_list(a, i),
+		list = balloc_get_order_list(a, i, BALLOC_PTE_LIST_ANY);
+		if (!nvgpu_list_empty(list)) {
+			buddy = nvgpu_list_first_entry(list,
 					nvgpu_buddy, buddy_entry);
 			balloc_blist_rem(a, buddy);
 			nvgpu_kmem_cache_free(a->buddy_cache, buddy);
@@ -299,10 +308,11 @@ cleanup:
  */
 static void nvgpu_buddy_allocator_destroy(struct nvgpu_allocator *na)
 {
-	u32 i;
+	u32 i, idx;
 	struct nvgpu_rbtree_node *node = NULL;
 	struct nvgpu_buddy *bud;
 	struct nvgpu_fixed_alloc *falloc;
+	struct nvgpu_list_node *list;
 	struct nvgpu_buddy_allocator *a = buddy_allocator(na);
 
 	alloc_lock(na);
@@ -342,12 +352,14 @@ static void nvgpu_buddy_allocator_destroy(struct nvgpu_allocator *na)
 	for (i = 0U; i < GPU_BALLOC_ORDER_LIST_LEN; i++) {
 		BUG_ON(a->buddy_list_alloced[i] != 0U);
 
-		while (!nvgpu_list_empty(balloc_get_order_list(a, i))) {
-			bud = nvgpu_list_first_entry(
-						balloc_get_order_list(a, i),
+		for (idx = 0U; idx < BALLOC_PTE_LIST_NUM; idx++) {
+			list = balloc_get_order_list(a, i, idx);
+			while (!nvgpu_list_empty(list)) {
+				bud = nvgpu_list_first_entry(list,
 						nvgpu_buddy, buddy_entry);
-			balloc_blist_rem(a, bud);
-			nvgpu_kmem_cache_free(a->buddy_cache, bud);
+				balloc_blist_rem(a, bud);
+				nvgpu_kmem_cache_free(a->buddy_cache, bud);
+			}
 		}
 
 		if (a->buddy_list_len[i] != 0U) {
@@ -407,6 +419,7 @@ static void balloc_coalesce(struct nvgpu_buddy_allocator *a,
 		buddy_clr_split(parent);
 		nvgpu_assert(a->buddy_list_split[parent->order] > 0ULL);
 		a->buddy_list_split[parent->order]--;
+		a->coalesces = nvgpu_safe_add_u64(a->coalesces, 1ULL);
 		balloc_blist_add(a, parent);
 
 		/* Clean up the remains. */
@@ -447,6 +460,7 @@ static int balloc_split_buddy(struct nvgpu_buddy_allocator *a,
 	buddy_set_split(b);
 	a->buddy_list_split[b->order] =
 		nvgpu_safe_add_u64(a->buddy_list_split[b->order], 1ULL);
+	a->splits = nvgpu_safe_add_u64(a->splits, 1ULL);
 
 	b->left = left;
 	b->right = right;
@@ -529,57 +543,63 @@ static struct nvgpu_buddy *balloc_free_buddy(struct nvgpu_buddy_allocator *a,
 }
 
 /*
- * Find a suitable buddy for the given order and PTE type (big or little).
+ * Find the smallest free buddy of at least the given order that can hold the
+ * given PTE type (big or little). A buddy that already has the requested PTE
+ * size is preferred over an unassigned one of the same order so that PDEs
+ * without a PTE size are kept for later.
  */
 static struct nvgpu_buddy *balloc_find_buddy(struct nvgpu_buddy_allocator *a,
 					     u64 order, u32 pte_size)
 {
-	struct nvgpu_buddy *bud;
-
-	if ((order > a->max_order) ||
-	    nvgpu_list_empty(balloc_get_order_list(a, order))) {
-		return NULL;
+	u32 lists[BALLOC_PTE_LIST_NUM];
+	u32 nr_lists, i, best_idx = 0U;
+	u64 best_order = GPU_BALLOC_ORDER_LIST_LEN;
+	u64 list_order;
+
+	if (pte_size == BALLOC_PTE_SIZE_ANY) {
+		lists[0] = BALLOC_PTE_LIST_ANY;
+		lists[1] = BALLOC_PTE_LIST_SMALL;
+		lists[2] = BALLOC_PTE_LIST_BIG;
+		nr_lists = 3U;
+	} else {
+		lists[0] = balloc_pte_list_idx(pte_size);
+		lists[1] = BALLOC_PTE_LIST_ANY;
+		nr_lists = 2U;
 	}
 
-	if (((a->flags & GPU_ALLOC_GVA_SPACE) != 0ULL) &&
-		(pte_size == BALLOC_PTE_SIZE_BIG)) {
-		bud = nvgpu_list_last_entry(balloc_get_order_list(a, order),
-				      nvgpu_buddy, buddy_entry);
-	} else {
-		bud = nvgpu_list_first_entry(balloc_get_order_list(a, order),
-				       nvgpu_buddy, buddy_entry);
+	for (i = 0U; i < nr_lists; i++) {
+		list_order = find_next_bit(a->buddy_list_map[lists[i]],
+					   GPU_BALLOC_ORDER_LIST_LEN, order);
+		if (list_order < best_order) {
+			best_order = list_order;
+			best_idx = lists[i];
+		}
 	}
 
-	if ((pte_size != BALLOC_PTE_SIZE_ANY) &&
-		(pte_size != bud->pte_size) &&
-		(bud->pte_size != BALLOC_PTE_SIZE_ANY)) {
+	if (best_order > a->max_order) {
 		return NULL;
 	}
 
-	return bud;
+	return nvgpu_list_first_entry(
+			balloc_get_order_list(a, best_order, best_idx),
+			nvgpu_buddy, buddy_entry);
 }
 
 /*
- * Allocate a suitably sized buddy. If no suitable buddy exists split higher
- * order buddies until we have a suitable buddy to allocate.
+ * Allocate a suitably sized buddy. If no suitable buddy exists split the
+ * smallest higher order buddy until we have a suitable buddy to allocate.
  *
- * For PDE grouping add an extra check to see if a buddy is suitable: that the
- * buddy exists in a PDE who's PTE size is reasonable
+ * For PDE grouping only buddies in a PDE who's PTE size is reasonable are
+ * considered, see balloc_find_buddy().
  *
  * @a must be locked.
  */
 static u64 balloc_do_alloc(struct nvgpu_buddy_allocator *a,
 			   u64 order, u32 pte_size)
 {
-	u64 split_order;
-	struct nvgpu_buddy *bud = NULL;
+	struct nvgpu_buddy *bud;
 
-	for (split_order = order; split_order <= a->max_order; split_order++) {
-		bud = balloc_find_buddy(a, split_order, pte_size);
-		if (bud != NULL) {
-			break;
-		}
-	}
+	bud = balloc_find_buddy(a, order, pte_size);
 
 	/* Out of memory! */
 	if (bud == NULL) {
@@ -604,36 +624,21 @@ static u64 balloc_do_alloc(struct nvgpu_buddy_allocator *a,
  * See if the passed range is actually available for allocation. If so, then
  * return 1, otherwise return 0.
  *
- * TODO: Right now this uses the unoptimal approach of going through all
- * outstanding allocations and checking their base/ends. This could be better.
+ * Allocated buddies never overlap so the only one that can intersect with
+ * [base, end) is the last buddy starting below @end: every buddy before it
+ * ends at or before its start.
  */
 static bool balloc_is_range_free(struct nvgpu_buddy_allocator *a,
 				u64 base, u64 end)
 {
 	struct nvgpu_rbtree_node *node = NULL;
-	struct nvgpu_buddy *bud;
 
-	nvgpu_rbtree_enum_start(0, &node, a->alloced_buddies);
+	nvgpu_rbtree_less_than_search(end, &node, a->alloced_buddies);
 	if (node == NULL) {
-		return true; /* No allocs yet. */
-	}
-
-	bud = nvgpu_buddy_from_rbtree_node(node);
-
-	while (bud->start < end) {
-		if (((bud->start > base) && (bud->start < end)) ||
-			((bud->end > base) && (bud->end < end))) {
-			return false;
-		}
-
-		nvgpu_rbtree_enum_next(&node, node);
-		if (node == NULL) {
-			break;
-		}
-		bud = nvgpu_buddy_from_rbtree_node(node);
+		return true;
 	}
 
-	return true;
+	return node->key_end <= base;
 }
 
 static void balloc_alloc_fixed(struct nvgpu_buddy_allocator *a,
@@ -669,27 +674,6 @@ static struct nvgpu_fixed_alloc *balloc_free_fixed(
 	return falloc;
 }
 
-/*
- * Find the parent range - doesn't necessarily need the parent to actually exist
- * as a buddy. Finding an existing parent comes later...
- */
-static void balloc_get_parent_range(struct nvgpu_buddy_allocator *a,
-				    u64 base, u64 order,
-				    u64 *pbase, u64 *porder)
-{
-	u64 base_mask;
-	u64 shifted_base = balloc_base_shift(a, base);
-
-	nvgpu_assert(order < 63U);
-	order++;
-	base_mask = ~nvgpu_safe_sub_u64((a->blk_size << order), 1U);
-
-	shifted_base &= base_mask;
-
-	*pbase = balloc_base_unshift(a, shifted_base);
-	*porder = order;
-}
-
 static struct nvgpu_buddy *balloc_get_target_buddy(
 				struct nvgpu_buddy_allocator *a,
 				struct nvgpu_buddy *bud,
@@ -723,58 +707,39 @@ static struct nvgpu_buddy *balloc_make_fixed_buddy(
 	struct nvgpu_buddy_allocator *a, u64 base, u64 order, u32 pte_size)
 {
 	struct nvgpu_buddy *bud = NULL;
-	struct nvgpu_list_node *order_list;
-	u64 cur_order = order, cur_base = base;
+	struct nvgpu_rbtree_node *node = NULL;
 
 	/*
 	 * Algo:
-	 *  1. Keep jumping up a buddy order until we find the real buddy that
-	 *     this buddy exists in.
-	 *  2. Then work our way down through the buddy tree until we hit a dead
-	 *     end.
+	 *  1. Look up the free buddy that covers @base. Since free buddies are
+	 *     disjoint there is at most one.
+	 *  2. Make sure it is at least as big as the buddy we need to make.
 	 *  3. Start splitting buddies until we split to the one we need to
 	 *     make.
 	 */
-	while (cur_order <= a->max_order) {
-		bool found = false;
-
-		order_list = balloc_get_order_list(a, cur_order);
-		nvgpu_list_for_each_entry(bud, order_list,
-					nvgpu_buddy, buddy_entry) {
-			if (bud->start == cur_base) {
-				/*
-				 * Make sure page size matches if it's smaller
-				 * than a PDE sized buddy.
-				 */
-				if ((bud->order <= a->pte_blk_order) &&
-					(bud->pte_size !=
-						BALLOC_PTE_SIZE_ANY) &&
-					(bud->pte_size != pte_size)) {
-					/* Welp, that's the end of that. */
-					alloc_dbg(balloc_owner(a),
-						  "Fixed buddy PTE "
-						  "size mismatch!");
-					return NULL;
-				}
-
-				found = true;
-				break;
-			}
-		}
-
-		if (found) {
-			break;
-		}
-
-		balloc_get_parent_range(a, cur_base, cur_order,
-					&cur_base, &cur_order);
+	nvgpu_rbtree_range_search(base, &node, a->free_buddies);
+	if (node == NULL) {
+		alloc_dbg(balloc_owner(a), "No buddy for range ???");
+		return NULL;
 	}
 
-	if (cur_order > a->max_order) {
+	bud = nvgpu_buddy_from_free_node(node);
+	if (bud->order < order) {
 		alloc_dbg(balloc_owner(a), "No buddy for range ???");
 		return NULL;
 	}
 
+	/*
+	 * Make sure page size matches if it's smaller than a PDE sized buddy.
+	 */
+	if ((bud->order <= a->pte_blk_order) &&
+		(bud->pte_size != BALLOC_PTE_SIZE_ANY) &&
+		(bud->pte_size != pte_size)) {
+		/* Welp, that's the end of that. */
+		alloc_dbg(balloc_owner(a), "Fixed buddy PTE size mismatch!");
+		return NULL;
+	}
+
 	/* Get target buddy */
 	bud = balloc_get_target_buddy(a, bud, base, order, pte_size);
 
@@ -1355,6 +1320,10 @@ static void nvgpu_buddy_print_stats(struct nvgpu_allocator *na,
 		      a->bytes_alloced_real);
 	alloc_pstat(s, na, "Bytes freed:            %llu",
 		      a->bytes_freed);
+	alloc_pstat(s, na, "Splits:                 %llu",
+		      a->splits);
+	alloc_pstat(s, na, "Coalesces:              %llu",
+		      a->coalesces);
 
 	if (lock)
 		alloc_unlock(na);
@@ -1530,6 +1499,7 @@ int nvgpu_buddy_allocator_init(struct gk20a *g, struct nvgpu_allocator *na,
 
 	a->alloced_buddies = NULL;
 	a->fixed_allocs = NULL;
+	a->free_buddies = NULL;
 	nvgpu_init_list_node(&a->co_list);
 	err = balloc_init_lists(a);
 	if (err != 0) {
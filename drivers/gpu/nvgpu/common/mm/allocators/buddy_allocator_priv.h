@@ -29,6 +29,7 @@
  * Implementation of the buddy allocator.
  */
 
+#include <nvgpu/bitops.h>
 #include <nvgpu/rbtree.h>
 #include <nvgpu/list.h>
 #include <nvgpu/static_analysis.h>
@@ -71,6 +72,12 @@ struct nvgpu_buddy {
 	 */
 	struct nvgpu_rbtree_node alloced_entry;
 
+	/**
+	 * RB tree of free buddies. Valid while the buddy sits in one of the
+	 * order lists.
+	 */
+	struct nvgpu_rbtree_node free_entry;
+
 	/**
 	 * Start address of this buddy.
 	 */
@@ -150,6 +157,20 @@ nvgpu_buddy_from_rbtree_node(struct nvgpu_rbtree_node *node)
 		((uintptr_t)node - offsetof(struct nvgpu_buddy, alloced_entry));
 };
 
+/**
+ * @brief Given a free tree node, retrieve the buddy.
+ *
+ * @param[in] node	Pointer to the free tree node.
+ *
+ * @return pointer to the struct nvgpu_buddy of the node.
+ */
+static inline struct nvgpu_buddy *
+nvgpu_buddy_from_free_node(struct nvgpu_rbtree_node *node)
+{
+	return (struct nvgpu_buddy *)
+		((uintptr_t)node - offsetof(struct nvgpu_buddy, free_entry));
+};
+
 /**
  * @brief Macro generator to create is/set/clr operations for each of the
  * flags in @ref BALLOC_BUDDY_FLAGS.
@@ -294,6 +315,12 @@ struct nvgpu_buddy_allocator {
 	 * Outstanding fixed allocations.
 	 */
 	struct nvgpu_rbtree_node *fixed_allocs;
+	/**
+	 * Free buddies from all the order lists, keyed by address range. Free
+	 * buddies never overlap so this lets fixed allocations find the buddy
+	 * covering an address without walking the order lists.
+	 */
+	struct nvgpu_rbtree_node *free_buddies;
 
 	/**
 	 * List of carveouts.
@@ -311,9 +338,30 @@ struct nvgpu_buddy_allocator {
 #define GPU_BALLOC_ORDER_LIST_LEN	(GPU_BALLOC_MAX_ORDER + 1U)
 
 	/**
-	 * List of buddies.
+	 * Free buddies are kept in a separate list per PTE size so that a
+	 * buddy which is usable for a given PTE size can be found without
+	 * walking past buddies of the other size.
+	 * @addtogroup BALLOC_PTE_LIST
+	 * @{
 	 */
-	struct nvgpu_list_node buddy_list[GPU_BALLOC_ORDER_LIST_LEN];
+#define BALLOC_PTE_LIST_ANY	0U
+#define BALLOC_PTE_LIST_SMALL	1U
+#define BALLOC_PTE_LIST_BIG	2U
+#define BALLOC_PTE_LIST_NUM	3U
+	/**@}*/
+
+	/**
+	 * List of buddies, indexed by order and @ref BALLOC_PTE_LIST.
+	 */
+	struct nvgpu_list_node buddy_list[GPU_BALLOC_ORDER_LIST_LEN]
+					 [BALLOC_PTE_LIST_NUM];
+	/**
+	 * Per @ref BALLOC_PTE_LIST bitmap of orders with a non-empty buddy
+	 * list. Lets the allocator find the smallest usable order with a
+	 * single find-first-set.
+	 */
+	DECLARE_BITMAP(buddy_list_map[BALLOC_PTE_LIST_NUM],
+		       GPU_BALLOC_ORDER_LIST_LEN);
 	/**
 	 * Length of the buddy list.
 	 */
@@ -361,6 +409,14 @@ struct nvgpu_buddy_allocator {
 	 * Statistics: total number of bytes freed.
 	 */
 	u64 bytes_freed;
+	/**
+	 * Statistics: number of buddies split into two.
+	 */
+	u64 splits;
+	/**
+	 * Statistics: number of buddy pairs merged back into their parent.
+	 */
+	u64 coalesces;
 };
 
 /**
@@ -377,19 +433,38 @@ static inline struct nvgpu_buddy_allocator *buddy_allocator(
 	return (struct nvgpu_buddy_allocator *)(a)->priv;
 }
 
+/**
+ * @brief Map a PTE size to its free list index.
+ *
+ * @param[in] pte_size	PTE size among @ref BALLOC_PTE_SIZE.
+ *
+ * @return index among @ref BALLOC_PTE_LIST.
+ */
+static inline u32 balloc_pte_list_idx(u32 pte_size)
+{
+	if (pte_size == BALLOC_PTE_SIZE_SMALL) {
+		return BALLOC_PTE_LIST_SMALL;
+	} else if (pte_size == BALLOC_PTE_SIZE_BIG) {
+		return BALLOC_PTE_LIST_BIG;
+	} else {
+		return BALLOC_PTE_LIST_ANY;
+	}
+}
+
 /**
  * @brief Given a buddy allocator, retrieve the list of buddies of the chosen
- * order.
+ * order and PTE list.
  *
  * @param[in] a		Pointer to the buddy allocator.
  * @param[in] order	Buddy order.
+ * @param[in] idx	PTE list index among @ref BALLOC_PTE_LIST.
  *
  * @return list of buddies whose order is \a order.
  */
 static inline struct nvgpu_list_node *balloc_get_order_list(
-	struct nvgpu_buddy_allocator *a, u64 order)
+	struct nvgpu_buddy_allocator *a, u64 order, u32 idx)
 {
-	return &a->buddy_list[order];
+	return &a->buddy_list[order][idx];
 }
 
 /**
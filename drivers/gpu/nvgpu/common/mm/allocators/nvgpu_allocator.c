@@ -24,9 +24,193 @@
 
 #include <nvgpu/allocator.h>
 #include <nvgpu/gk20a.h>
+#include <nvgpu/kmem.h>
+#include <nvgpu/os_sched.h>
 
 #include <nvgpu/string.h>
 
+/*
+ * GPU_ALLOC_CACHE: each allocator gets a handful of slots which threads are
+ * hashed onto by thread ID. A slot holds one magazine of freed blocks for
+ * each of the last few sizes seen, so the common case of the same thread
+ * allocating and freeing blocks of a couple of sizes only touches the slot
+ * spinlock and never the allocator mutex.
+ *
+ * The cache holds at most 1/16 of the allocator space and never more than
+ * NVGPU_ALLOC_CACHE_MAX_BYTES, split evenly between the slots. Blocks freed
+ * above that go straight back to the backend.
+ */
+#define NVGPU_ALLOC_CACHE_SLOTS		8U
+#define NVGPU_ALLOC_CACHE_SIZES		4U
+#define NVGPU_ALLOC_CACHE_DEPTH		16U
+#define NVGPU_ALLOC_CACHE_MAX_BYTES	(SZ_16M * 4ULL)
+
+struct nvgpu_alloc_magazine {
+	u64 len;
+	u32 page_size;
+	u32 count;
+	u64 addrs[NVGPU_ALLOC_CACHE_DEPTH];
+};
+
+struct nvgpu_alloc_cache_slot {
+	struct nvgpu_spinlock lock;
+	struct nvgpu_alloc_magazine mags[NVGPU_ALLOC_CACHE_SIZES];
+	/* Bytes held by the magazines. */
+	u64 bytes;
+	u64 hits;
+	u64 misses;
+};
+
+struct nvgpu_alloc_cache {
+	struct nvgpu_alloc_cache_slot slots[NVGPU_ALLOC_CACHE_SLOTS];
+	u64 slot_max_bytes;
+};
+
+static struct nvgpu_alloc_cache_slot *nvgpu_alloc_cache_this_slot(
+	struct nvgpu_allocator *a)
+{
+	u32 tid = (u32)nvgpu_current_tid(a->g);
+
+	/* POSIX thread IDs are aligned pointers, fold the high bits down. */
+	tid ^= tid >> 16U;
+	tid ^= tid >> 8U;
+	tid ^= tid >> 4U;
+
+	return &a->cache->slots[tid % NVGPU_ALLOC_CACHE_SLOTS];
+}
+
+static u64 nvgpu_alloc_cache_get(struct nvgpu_allocator *a, u64 len,
+				 u32 page_size)
+{
+	struct nvgpu_alloc_cache_slot *slot = nvgpu_alloc_cache_this_slot(a);
+	struct nvgpu_alloc_magazine *mag;
+	u64 addr = 0ULL;
+	u32 i;
+
+	nvgpu_spinlock_acquire(&slot->lock);
+	for (i = 0U; i < NVGPU_ALLOC_CACHE_SIZES; i++) {
+		mag = &slot->mags[i];
+		if ((mag->count > 0U) && (mag->len == len) &&
+		    (mag->page_size == page_size)) {
+			mag->count--;
+			addr = mag->addrs[mag->count];
+			slot->bytes = nvgpu_safe_sub_u64(slot->bytes, len);
+			break;
+		}
+	}
+	if (addr != 0ULL) {
+		slot->hits = nvgpu_safe_add_u64(slot->hits, 1ULL);
+	} else {
+		slot->misses = nvgpu_safe_add_u64(slot->misses, 1ULL);
+	}
+	nvgpu_spinlock_release(&slot->lock);
+
+	return addr;
+}
+
+static bool nvgpu_alloc_cache_put(struct nvgpu_allocator *a, u64 addr,
+				  u64 len, u32 page_size)
+{
+	struct nvgpu_alloc_cache_slot *slot = nvgpu_alloc_cache_this_slot(a);
+	struct nvgpu_alloc_magazine *mag, *empty = NULL;
+	bool cached = false;
+	u32 i;
+
+	nvgpu_spinlock_acquire(&slot->lock);
+	if (len > nvgpu_safe_sub_u64(a->cache->slot_max_bytes, slot->bytes)) {
+		nvgpu_spinlock_release(&slot->lock);
+		return false;
+	}
+	for (i = 0U; i < NVGPU_ALLOC_CACHE_SIZES; i++) {
+		mag = &slot->mags[i];
+		if ((mag->len == len) && (mag->page_size == page_size)) {
+			empty = NULL;
+			if (mag->count < NVGPU_ALLOC_CACHE_DEPTH) {
+				mag->addrs[mag->count] = addr;
+				mag->count++;
+				cached = true;
+			}
+			break;
+		}
+		if ((mag->count == 0U) && (empty == NULL)) {
+			empty = mag;
+		}
+	}
+	if (empty != NULL) {
+		/* First block of a new size, take over an unused magazine. */
+		empty->len = len;
+		empty->page_size = page_size;
+		empty->addrs[0] = addr;
+		empty->count = 1U;
+		cached = true;
+	}
+	if (cached) {
+		slot->bytes = nvgpu_safe_add_u64(slot->bytes, len);
+	}
+	nvgpu_spinlock_release(&slot->lock);
+
+	return cached;
+}
+
+/*
+ * Give every cached block back to the underlying allocator. Returns true if
+ * there was anything to give back.
+ */
+static bool nvgpu_alloc_cache_drain(struct nvgpu_allocator *a)
+{
+	u64 addrs[NVGPU_ALLOC_CACHE_DEPTH];
+	struct nvgpu_alloc_cache_slot *slot;
+	struct nvgpu_alloc_magazine *mag;
+	bool drained = false;
+	u32 i, j, k, count;
+
+	if (a->cache == NULL) {
+		return false;
+	}
+
+	for (i = 0U; i < NVGPU_ALLOC_CACHE_SLOTS; i++) {
+		slot = &a->cache->slots[i];
+		for (j = 0U; j < NVGPU_ALLOC_CACHE_SIZES; j++) {
+			mag = &slot->mags[j];
+
+			/* The free op sleeps, so not under the spinlock. */
+			nvgpu_spinlock_acquire(&slot->lock);
+			count = mag->count;
+			(void) memcpy(addrs, mag->addrs, count * sizeof(u64));
+			mag->count = 0U;
+			slot->bytes = nvgpu_safe_sub_u64(slot->bytes,
+					nvgpu_safe_mult_u64(mag->len, count));
+			nvgpu_spinlock_release(&slot->lock);
+
+			for (k = 0U; k < count; k++) {
+				a->ops->free_alloc(a, addrs[k]);
+			}
+			drained = drained || (count > 0U);
+		}
+	}
+
+	return drained;
+}
+
+static int nvgpu_alloc_cache_init(struct nvgpu_allocator *a)
+{
+	u64 max_bytes = min(nvgpu_alloc_length(a) / 16ULL,
+			    NVGPU_ALLOC_CACHE_MAX_BYTES);
+	u32 i;
+
+	a->cache = nvgpu_kzalloc(a->g, sizeof(*a->cache));
+	if (a->cache == NULL) {
+		return -ENOMEM;
+	}
+	a->cache->slot_max_bytes = max_bytes / NVGPU_ALLOC_CACHE_SLOTS;
+
+	for (i = 0U; i < NVGPU_ALLOC_CACHE_SLOTS; i++) {
+		nvgpu_spinlock_init(&a->cache->slots[i].lock);
+	}
+
+	return 0;
+}
+
 u64 nvgpu_alloc_length(struct nvgpu_allocator *a)
 {
 	if (a->ops->length != NULL) {
@@ -74,12 +258,36 @@ u64 nvgpu_alloc_space(struct nvgpu_allocator *a)
 
 u64 nvgpu_alloc(struct nvgpu_allocator *a, u64 len)
 {
-	return a->ops->alloc(a, len);
+	u64 addr = 0ULL;
+
+	if (a->cache != NULL) {
+		addr = nvgpu_alloc_cache_get(a, len, 0U);
+	}
+	if (addr == 0ULL) {
+		addr = a->ops->alloc(a, len);
+	}
+	if ((addr == 0ULL) && nvgpu_alloc_cache_drain(a)) {
+		addr = a->ops->alloc(a, len);
+	}
+
+	return addr;
 }
 
 u64 nvgpu_alloc_pte(struct nvgpu_allocator *a, u64 len, u32 page_size)
 {
-	return a->ops->alloc_pte(a, len, page_size);
+	u64 addr = 0ULL;
+
+	if (a->cache != NULL) {
+		addr = nvgpu_alloc_cache_get(a, len, page_size);
+	}
+	if (addr == 0ULL) {
+		addr = a->ops->alloc_pte(a, len, page_size);
+	}
+	if ((addr == 0ULL) && nvgpu_alloc_cache_drain(a)) {
+		addr = a->ops->alloc_pte(a, len, page_size);
+	}
+
+	return addr;
 }
 
 void nvgpu_free(struct nvgpu_allocator *a, u64 addr)
@@ -87,18 +295,38 @@ void nvgpu_free(struct nvgpu_allocator *a, u64 addr)
 	a->ops->free_alloc(a, addr);
 }
 
+void nvgpu_free_sized(struct nvgpu_allocator *a, u64 addr, u64 len,
+		      u32 page_size)
+{
+	if ((a->cache != NULL) && (addr != 0ULL) &&
+	    nvgpu_alloc_cache_put(a, addr, len, page_size)) {
+		return;
+	}
+
+	a->ops->free_alloc(a, addr);
+}
+
 u64 nvgpu_alloc_fixed(struct nvgpu_allocator *a, u64 base, u64 len,
 		      u32 page_size)
 {
+	u64 addr;
+
 	if ((U64_MAX - base) < len) {
 		return 0ULL;
 	}
 
-	if (a->ops->alloc_fixed != NULL) {
-		return a->ops->alloc_fixed(a, base, len, page_size);
+	if (a->ops->alloc_fixed == NULL) {
+		return 0;
 	}
 
-	return 0;
+	addr = a->ops->alloc_fixed(a, base, len, page_size);
+
+	/* The range may be sitting in the free block cache. */
+	if ((addr == 0ULL) && nvgpu_alloc_cache_drain(a)) {
+		addr = a->ops->alloc_fixed(a, base, len, page_size);
+	}
+
+	return addr;
 }
 
 void nvgpu_free_fixed(struct nvgpu_allocator *a, u64 base, u64 len)
@@ -133,6 +361,12 @@ void nvgpu_alloc_release_carveout(struct nvgpu_allocator *a,
 
 void nvgpu_alloc_destroy(struct nvgpu_allocator *a)
 {
+	if (a->cache != NULL) {
+		(void) nvgpu_alloc_cache_drain(a);
+		nvgpu_kfree(a->g, a->cache);
+		a->cache = NULL;
+	}
+
 	a->ops->fini(a);
 	nvgpu_mutex_destroy(&a->lock);
 	(void) memset(a, 0, sizeof(*a));
@@ -142,7 +376,23 @@ void nvgpu_alloc_destroy(struct nvgpu_allocator *a)
 void nvgpu_alloc_print_stats(struct nvgpu_allocator *na,
 			     struct seq_file *s, int lock)
 {
+	u64 hits = 0ULL, misses = 0ULL;
+	u32 i;
+
 	na->ops->print_stats(na, s, lock);
+
+	if (na->cache == NULL) {
+		return;
+	}
+
+	for (i = 0U; i < NVGPU_ALLOC_CACHE_SLOTS; i++) {
+		hits += na->cache->slots[i].hits;
+		misses += na->cache->slots[i].misses;
+	}
+
+	alloc_pstat(s, na, "");
+	alloc_pstat(s, na, "Cache hits:             %llu", hits);
+	alloc_pstat(s, na, "Cache misses:           %llu", misses);
 }
 #endif
 
@@ -172,6 +422,7 @@ int nvgpu_alloc_common_init(struct nvgpu_allocator *a, struct gk20a *g,
 	a->ops = ops;
 	a->priv = priv;
 	a->debug = dbg;
+	a->cache = NULL;
 
 	(void) strncpy(a->name, name, sizeof(a->name));
 	a->name[sizeof(a->name) - 1U] = '\0';
@@ -210,6 +461,13 @@ int nvgpu_allocator_init(struct gk20a *g, struct nvgpu_allocator *na,
 		break;
 	}
 
+	if ((err == 0) && ((flags & GPU_ALLOC_CACHE) != 0ULL)) {
+		err = nvgpu_alloc_cache_init(na);
+		if (err != 0) {
+			na->ops->fini(na);
+		}
+	}
+
 	if (err < 0) {
 		nvgpu_err(g, "Failed!");
 	}
@@ -257,6 +257,9 @@ static void nvgpu_page_alloc_free_pages(struct nvgpu_page_allocator *a,
 
 	nvgpu_page_alloc_sgl_proper_free(a->owner->g,
 			(struct nvgpu_mem_sgl *)sgl);
+	if (alloc->chunk_index != NULL) {
+		nvgpu_kfree(g, alloc->chunk_index);
+	}
 	nvgpu_kmem_cache_free(a->alloc_cache, alloc);
 }
 
@@ -457,6 +460,7 @@ static struct nvgpu_page_alloc *nvgpu_alloc_slab(
 		goto fail;
 	}
 
+	(void) memset(alloc, 0, sizeof(*alloc));
 	alloc->sgt.ops = &page_alloc_sgl_ops;
 
 	sgl = nvgpu_kzalloc(a->owner->g, sizeof(*sgl));
@@ -802,6 +806,7 @@ static struct nvgpu_page_alloc *nvgpu_alloc_pages_fixed(
 		goto fail;
 	}
 
+	(void) memset(alloc, 0, sizeof(*alloc));
 	alloc->sgt.ops = &page_alloc_sgl_ops;
 	alloc->base = nvgpu_alloc_fixed(&a->source_allocator, base, length, 0);
 	if (alloc->base == 0ULL) {
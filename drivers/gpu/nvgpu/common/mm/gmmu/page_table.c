@@ -38,6 +38,9 @@
 #include <nvgpu/static_analysis.h>
 #include <nvgpu/errata.h>
 #include <nvgpu/power_features/pg.h>
+#include <nvgpu/kmem.h>
+#include <nvgpu/cond.h>
+#include <nvgpu/worker.h>
 
 #ifdef CONFIG_NVGPU_TRACE
 #define nvgpu_gmmu_dbg(g, attrs, fmt, args...)				\
@@ -438,6 +441,322 @@ static int nvgpu_set_pd_level_is_next_level_pde(struct vm_gk20a *vm,
 	return 0;
 }
 
+/*
+ * Program the PTEs of [virt_addr, virt_addr + length) in the last level PD
+ * pd. Nothing is allocated at this level, so this cannot fail.
+ */
+static void nvgpu_set_pd_leaf(struct vm_gk20a *vm,
+			      struct nvgpu_gmmu_pd *pd,
+			      const struct gk20a_mmu_level *l,
+			      u64 phys_addr,
+			      u64 virt_addr, u64 length,
+			      struct nvgpu_gmmu_attrs *attrs)
+{
+	struct gk20a *g = gk20a_from_vm(vm);
+	u64 pte_range = 1ULL << (u64)l->lo_bit[attrs->pgsz];
+
+	/*
+	 * Stage the run of PTEs so that vidmem PDs see one bulk write instead
+	 * of one PRAMIN access per word.
+	 */
+	nvgpu_pd_stage_begin(g, &vm->pd_stage, pd);
+
+	while (length != 0ULL) {
+		u32 pd_idx = pd_index(l, virt_addr, attrs);
+		u64 chunk_size;
+
+		nvgpu_assert(pte_range >= 1ULL);
+		chunk_size = min(length, nvgpu_safe_sub_u64(pte_range,
+				virt_addr & (pte_range - 1U)));
+
+		l->update_entry(vm, l,
+				pd, pd_idx,
+				virt_addr,
+				phys_addr,
+				attrs);
+
+		virt_addr = nvgpu_safe_add_u64(virt_addr, chunk_size);
+
+		/* A zero phys_addr is an unmap, see nvgpu_set_pd_level(). */
+		if (phys_addr != 0ULL) {
+			phys_addr += chunk_size;
+		}
+		length -= chunk_size;
+	}
+
+	nvgpu_pd_stage_end(g, pd);
+}
+
+/*
+ * Parallel page table population.
+ *
+ * Once a large update has allocated the PDs down to the last level, the PTE
+ * writes of each last level PD are independent of each other. Instead of
+ * writing them as the walk reaches them, nvgpu_set_pd_level() queues them
+ * in vm->pt_batch. When the queue is full or the walk is done, the queue is
+ * cut in one slice per worker thread plus one for the caller, and the caller
+ * waits for all slices. The caller holds update_gmmu_lock throughout, so the
+ * PDs cannot change under the workers.
+ */
+#define NVGPU_GMMU_PT_JOBS		512U
+#define NVGPU_GMMU_PT_MAX_THREADS	16U
+#define NVGPU_GMMU_PT_MIN_SIZE		SZ_256M
+
+struct nvgpu_gmmu_pt_job {
+	struct nvgpu_gmmu_pd *pd;
+	const struct gk20a_mmu_level *l;
+	u64 phys_addr;
+	u64 virt_addr;
+	u64 length;
+};
+
+struct nvgpu_gmmu_pt_slice {
+	struct nvgpu_list_node worker_item;
+	struct nvgpu_gmmu_pt_batch *batch;
+	u32 first;
+	u32 count;
+};
+
+struct nvgpu_gmmu_pt_batch {
+	struct vm_gk20a *vm;
+	const struct nvgpu_gmmu_attrs *attrs;
+	/* Slices still running on the worker threads. */
+	nvgpu_atomic_t remaining;
+	struct nvgpu_gmmu_pt_slice slices[NVGPU_GMMU_PT_MAX_THREADS];
+	u32 nr_jobs;
+	struct nvgpu_gmmu_pt_job jobs[NVGPU_GMMU_PT_JOBS];
+};
+
+static inline struct nvgpu_gmmu_pt_slice *
+nvgpu_gmmu_pt_slice_from_worker_item(struct nvgpu_list_node *node)
+{
+	return (struct nvgpu_gmmu_pt_slice *)
+	   ((uintptr_t)node - offsetof(struct nvgpu_gmmu_pt_slice, worker_item));
+};
+
+static void nvgpu_gmmu_pt_write_jobs(struct nvgpu_gmmu_pt_batch *batch,
+				     u32 first, u32 count)
+{
+	/* The PTE HALs take non-const attrs; give each thread its own. */
+	struct nvgpu_gmmu_attrs attrs = *batch->attrs;
+	u32 i;
+
+	for (i = first; i < nvgpu_safe_add_u32(first, count); i++) {
+		struct nvgpu_gmmu_pt_job *job = &batch->jobs[i];
+
+		nvgpu_set_pd_leaf(batch->vm, job->pd, job->l, job->phys_addr,
+				  job->virt_addr, job->length, &attrs);
+	}
+}
+
+static void nvgpu_gmmu_pt_run_slice(struct nvgpu_gmmu_pt_slice *slice)
+{
+	struct nvgpu_gmmu_pt_batch *batch = slice->batch;
+	struct mm_gk20a *mm = batch->vm->mm;
+
+	nvgpu_gmmu_pt_write_jobs(batch, slice->first, slice->count);
+
+	/* The caller may free the batch as soon as this reaches zero. */
+	if (nvgpu_atomic_dec_and_test(&batch->remaining)) {
+		(void) nvgpu_cond_broadcast(&mm->pt_parallel_done);
+	}
+}
+
+static void nvgpu_gmmu_pt_worker_process_item(
+		struct nvgpu_list_node *work_item)
+{
+	nvgpu_gmmu_pt_run_slice(
+		nvgpu_gmmu_pt_slice_from_worker_item(work_item));
+}
+
+static const struct nvgpu_worker_ops nvgpu_gmmu_pt_worker_ops = {
+	.pre_process = NULL,
+	.wakeup_early_exit = NULL,
+	.wakeup_post_process = NULL,
+	.wakeup_process_item = nvgpu_gmmu_pt_worker_process_item,
+	.wakeup_condition = NULL,
+	.wakeup_timeout = NULL,
+};
+
+static void nvgpu_gmmu_pt_run(struct nvgpu_gmmu_pt_batch *batch)
+{
+	struct mm_gk20a *mm = batch->vm->mm;
+	u32 nr_slices;
+	u32 per_slice;
+	u32 first = 0U;
+	u32 i;
+
+	if (batch->nr_jobs == 0U) {
+		return;
+	}
+
+	nr_slices = min(nvgpu_safe_add_u32(mm->pt_worker.num_shards, 1U),
+			batch->nr_jobs);
+	per_slice = DIV_ROUND_UP(batch->nr_jobs, nr_slices);
+	nr_slices = DIV_ROUND_UP(batch->nr_jobs, per_slice);
+
+	nvgpu_atomic_set(&batch->remaining, (int)(nr_slices - 1U));
+
+	for (i = 0U; i < (nr_slices - 1U); i++) {
+		struct nvgpu_gmmu_pt_slice *slice = &batch->slices[i];
+
+		slice->first = first;
+		slice->count = per_slice;
+		first = nvgpu_safe_add_u32(first, per_slice);
+
+		nvgpu_init_list_node(&slice->worker_item);
+		if (nvgpu_worker_enqueue_sharded(&mm->pt_worker,
+				&slice->worker_item, i) != 0) {
+			nvgpu_gmmu_pt_run_slice(slice);
+		}
+	}
+
+	/* The last slice runs on the caller. */
+	nvgpu_gmmu_pt_write_jobs(batch, first,
+				 nvgpu_safe_sub_u32(batch->nr_jobs, first));
+
+	while (nvgpu_atomic_read(&batch->remaining) != 0) {
+		(void) NVGPU_COND_WAIT(&mm->pt_parallel_done,
+				nvgpu_atomic_read(&batch->remaining) == 0, 0U);
+	}
+
+	batch->nr_jobs = 0U;
+}
+
+/*
+ * Queue the PTE writes of a last level PD if a parallel update is in
+ * progress. Returns false if the caller has to write them itself.
+ */
+static bool nvgpu_gmmu_pt_queue_leaf(struct vm_gk20a *vm,
+				     struct nvgpu_gmmu_pd *pd,
+				     const struct gk20a_mmu_level *l,
+				     u64 phys_addr,
+				     u64 virt_addr, u64 length)
+{
+	struct nvgpu_gmmu_pt_batch *batch = vm->pt_batch;
+	struct nvgpu_gmmu_pt_job *job;
+
+	/*
+	 * Vidmem PDs go through the PRAMIN window and vm->pd_stage, both of
+	 * which are single-threaded.
+	 */
+	if ((batch == NULL) || (pd->mem == NULL) ||
+	    (pd->mem->aperture == APERTURE_VIDMEM)) {
+		return false;
+	}
+
+	if (batch->nr_jobs == NVGPU_GMMU_PT_JOBS) {
+		nvgpu_gmmu_pt_run(batch);
+	}
+
+	job = &batch->jobs[batch->nr_jobs];
+	job->pd = pd;
+	job->l = l;
+	job->phys_addr = phys_addr;
+	job->virt_addr = virt_addr;
+	job->length = length;
+	batch->nr_jobs++;
+
+	return true;
+}
+
+static struct nvgpu_gmmu_pt_batch *nvgpu_gmmu_pt_batch_start(
+		struct vm_gk20a *vm, u64 length,
+		const struct nvgpu_gmmu_attrs *attrs)
+{
+	struct gk20a *g = gk20a_from_vm(vm);
+	struct mm_gk20a *mm = vm->mm;
+	struct nvgpu_gmmu_pt_batch *batch;
+	u32 i;
+
+	/*
+	 * The PTE HALs advance attrs->ctag for each page they write, which
+	 * only works in address order.
+	 */
+	if (!mm->pt_parallel_ready || (length < mm->pt_parallel_min_size) ||
+	    (attrs->ctag != 0ULL)) {
+		return NULL;
+	}
+
+	/* Without a batch, the PTEs are simply written inline. */
+	batch = nvgpu_big_zalloc(g, sizeof(*batch));
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	batch->vm = vm;
+	batch->attrs = attrs;
+	for (i = 0U; i < NVGPU_GMMU_PT_MAX_THREADS; i++) {
+		batch->slices[i].batch = batch;
+	}
+	vm->pt_batch = batch;
+
+	return batch;
+}
+
+static void nvgpu_gmmu_pt_batch_finish(struct vm_gk20a *vm,
+				       struct nvgpu_gmmu_pt_batch *batch)
+{
+	if (batch == NULL) {
+		return;
+	}
+
+	/*
+	 * Write what was queued even if the walk failed, as the serial walk
+	 * would have done before reaching the failure.
+	 */
+	nvgpu_gmmu_pt_run(batch);
+	vm->pt_batch = NULL;
+	nvgpu_big_free(gk20a_from_vm(vm), batch);
+}
+
+int nvgpu_gmmu_pt_workers_init(struct gk20a *g)
+{
+	struct mm_gk20a *mm = &g->mm;
+	int err;
+
+	if ((mm->pt_parallel_threads == 0U) || mm->pt_parallel_ready) {
+		return 0;
+	}
+
+	err = nvgpu_cond_init(&mm->pt_parallel_done);
+	if (err != 0) {
+		return err;
+	}
+
+	/* One slice runs on the caller. */
+	nvgpu_worker_init_name(&mm->pt_worker, "nvgpu_gmmu_pt", g->name);
+	err = nvgpu_worker_init_sharded(g, &mm->pt_worker,
+			&nvgpu_gmmu_pt_worker_ops,
+			min(mm->pt_parallel_threads,
+			    NVGPU_GMMU_PT_MAX_THREADS - 1U));
+	if (err != 0) {
+		nvgpu_err(g, "failed to start page table workers: %d", err);
+		nvgpu_cond_destroy(&mm->pt_parallel_done);
+		return err;
+	}
+
+	if (mm->pt_parallel_min_size == 0ULL) {
+		mm->pt_parallel_min_size = NVGPU_GMMU_PT_MIN_SIZE;
+	}
+	mm->pt_parallel_ready = true;
+
+	return 0;
+}
+
+void nvgpu_gmmu_pt_workers_deinit(struct gk20a *g)
+{
+	struct mm_gk20a *mm = &g->mm;
+
+	if (!mm->pt_parallel_ready) {
+		return;
+	}
+
+	mm->pt_parallel_ready = false;
+	nvgpu_worker_deinit(&mm->pt_worker);
+	nvgpu_cond_destroy(&mm->pt_parallel_done);
+}
+
 /*
  * This function programs the GMMU based on two ranges: a physical range and a
  * GPU virtual range. The virtual is mapped to the physical. Physical in this
@@ -496,6 +815,19 @@ static int nvgpu_set_pd_level(struct vm_gk20a *vm,
 	/* This limits recursion */
 	nvgpu_assert(lvl < g->ops.mm.gmmu.get_max_page_table_levels(g));
 
+	/*
+	 * The last level writes a contiguous run of PTEs into a single PD,
+	 * possibly on another thread.
+	 */
+	if (next_l->update_entry == NULL) {
+		if (!nvgpu_gmmu_pt_queue_leaf(vm, pd, l, phys_addr,
+					      virt_addr, length)) {
+			nvgpu_set_pd_leaf(vm, pd, l, phys_addr,
+					  virt_addr, length, attrs);
+		}
+		goto done;
+	}
+
 	pde_range = 1ULL << (u64)l->lo_bit[attrs->pgsz];
 
 	/*
@@ -566,6 +898,7 @@ static int nvgpu_set_pd_level(struct vm_gk20a *vm,
 		length -= chunk_size;
 	}
 
+done:
 #ifdef CONFIG_NVGPU_TRACE
 	nvgpu_gmmu_dbg_v(g, attrs, "L=%d   %s%s", lvl, lvl_debug[lvl],
 			 "ret!");
@@ -767,9 +1100,12 @@ static int nvgpu_gmmu_do_update_page_table(struct vm_gk20a *vm,
 					   struct nvgpu_gmmu_attrs *attrs)
 {
 	struct gk20a *g = gk20a_from_vm(vm);
+	struct nvgpu_gmmu_pt_batch *pt_batch;
 	bool is_iommuable, sgt_is_iommuable;
 	int err = 0;
 
+	pt_batch = nvgpu_gmmu_pt_batch_start(vm, length, attrs);
+
 	if (sgt == NULL) {
 		/*
 		 * This is considered an unmap. Just pass in 0 as the physical
@@ -782,6 +1118,7 @@ static int nvgpu_gmmu_do_update_page_table(struct vm_gk20a *vm,
 					 0,
 					 virt_addr, length,
 					 attrs);
+		nvgpu_gmmu_pt_batch_finish(vm, pt_batch);
 		if (err != 0) {
 			nvgpu_err(g, "Failed!");
 		}
@@ -827,6 +1164,8 @@ static int nvgpu_gmmu_do_update_page_table(struct vm_gk20a *vm,
 							virt_addr, length, attrs);
 	}
 
+	nvgpu_gmmu_pt_batch_finish(vm, pt_batch);
+
 	if (err < 0) {
 		struct nvgpu_gmmu_attrs unmap_attrs = gmmu_unmap_attrs(attrs->pgsz);
 		int err_unmap;
@@ -851,17 +1190,119 @@ static int nvgpu_gmmu_do_update_page_table(struct vm_gk20a *vm,
 	return err;
 }
 
-static int nvgpu_gmmu_cache_maint_map(struct gk20a *g, struct vm_gk20a *vm,
-		struct vm_gk20a_mapping_batch *batch)
+/*
+ * Add [vaddr, vaddr + size) to the dirty ranges of the VM, merging it with
+ * any range it overlaps or touches. The list is kept sorted; once it is
+ * full, the next flush invalidates the whole VM instead.
+ */
+static void nvgpu_gmmu_tlb_record(struct vm_gk20a *vm, u64 vaddr, u64 size)
+{
+	struct nvgpu_vm_tlb_tracker *tlb = &vm->tlb;
+	u64 start = vaddr;
+	u64 end = nvgpu_safe_add_u64(vaddr, size);
+	u32 i = 0U;
+	u32 j;
+
+	nvgpu_atomic_set(&tlb->pending, 1);
+
+	if (tlb->overflow) {
+		return;
+	}
+
+	/* Skip ranges entirely below the new one. */
+	while ((i < tlb->nr_ranges) && (tlb->ranges[i].end < start)) {
+		i++;
+	}
+
+	/* Absorb every range overlapping or touching the new one. */
+	j = i;
+	while ((j < tlb->nr_ranges) && (tlb->ranges[j].start <= end)) {
+		start = min(start, tlb->ranges[j].start);
+		end = max(end, tlb->ranges[j].end);
+		j++;
+	}
+
+	if (j == i) {
+		/* Nothing absorbed: open a slot at i. */
+		if (tlb->nr_ranges == NVGPU_VM_TLB_DIRTY_RANGES) {
+			tlb->overflow = true;
+			return;
+		}
+		for (j = tlb->nr_ranges; j > i; j--) {
+			tlb->ranges[j] = tlb->ranges[j - 1U];
+		}
+		tlb->nr_ranges++;
+	} else {
+		/* Ranges i..j-1 collapse into slot i. */
+		u32 gone = j - i - 1U;
+
+		for (; j < tlb->nr_ranges; j++) {
+			tlb->ranges[j - gone] = tlb->ranges[j];
+		}
+		tlb->nr_ranges -= gone;
+	}
+
+	tlb->ranges[i].start = start;
+	tlb->ranges[i].end = end;
+}
+
+int nvgpu_gmmu_tlb_flush_dirty(struct vm_gk20a *vm)
 {
+	struct gk20a *g = gk20a_from_vm(vm);
+	struct nvgpu_vm_tlb_tracker *tlb = &vm->tlb;
 	int err = 0;
+	u32 i;
 
-	if (batch == NULL) {
+	if (nvgpu_atomic_read(&tlb->pending) == 0) {
+		return 0;
+	}
+
+	if ((g->ops.fb.tlb_invalidate_range != NULL) && !tlb->overflow) {
+		for (i = 0U; i < tlb->nr_ranges; i++) {
+			err = nvgpu_pg_elpg_ms_protected_call(g,
+				g->ops.fb.tlb_invalidate_range(g, vm->pdb.mem,
+					tlb->ranges[i].start,
+					tlb->ranges[i].end -
+						tlb->ranges[i].start));
+			if (err != 0) {
+				break;
+			}
+			tlb->nr_range_invalidates++;
+		}
+	} else {
 		err = nvgpu_pg_elpg_ms_protected_call(g,
 				g->ops.fb.tlb_invalidate(g, vm->pdb.mem));
-		if (err != 0) {
-			nvgpu_err(g, "fb.tlb_invalidate() failed err=%d", err);
+		if (err == 0) {
+			tlb->nr_full_invalidates++;
 		}
+	}
+
+	if (err != 0) {
+		nvgpu_err(g, "fb.tlb_invalidate() failed err=%d", err);
+		return err;
+	}
+
+	tlb->nr_ranges = 0U;
+	tlb->overflow = false;
+	nvgpu_atomic_set(&tlb->pending, 0);
+
+	return 0;
+}
+
+static int nvgpu_gmmu_cache_maint_map(struct gk20a *g, struct vm_gk20a *vm,
+		u64 vaddr, u64 size, struct vm_gk20a_mapping_batch *batch)
+{
+	int err = 0;
+
+	(void)g;
+
+	nvgpu_gmmu_tlb_record(vm, vaddr, size);
+
+	if (batch == NULL) {
+		err = nvgpu_gmmu_tlb_flush_dirty(vm);
+	} else if (batch->defer_tlb_invalidate && !vm->tlb.no_defer) {
+		/* Flushed by the next submit, batch end or unmap. */
+		vm->tlb.nr_deferred++;
 	} else {
 		batch->need_tlb_invalidate = true;
 	}
@@ -870,20 +1311,18 @@ static int nvgpu_gmmu_cache_maint_map(struct gk20a *g, struct vm_gk20a *vm,
 }
 
 static int nvgpu_gmmu_cache_maint_unmap(struct gk20a *g, struct vm_gk20a *vm,
-		struct vm_gk20a_mapping_batch *batch)
+		u64 vaddr, u64 size, struct vm_gk20a_mapping_batch *batch)
 {
 	int err = 0;
 
+	nvgpu_gmmu_tlb_record(vm, vaddr, size);
+
 	if (batch == NULL) {
 		if ((nvgpu_pg_elpg_ms_protected_call(g,
 			g->ops.mm.cache.l2_flush(g, true))) != 0) {
 			nvgpu_err(g, "gk20a_mm_l2_flush[1] failed");
 		}
-		err = nvgpu_pg_elpg_ms_protected_call(g,
-				g->ops.fb.tlb_invalidate(g, vm->pdb.mem));
-		if (err != 0) {
-			nvgpu_err(g, "fb.tlb_invalidate() failed err=%d", err);
-		}
+		err = nvgpu_gmmu_tlb_flush_dirty(vm);
 	} else {
 		if (!batch->gpu_l2_flushed) {
 			if ((nvgpu_pg_elpg_ms_protected_call(g,
@@ -952,6 +1391,46 @@ static void nvgpu_gmmu_update_page_table_dbg_print(struct gk20a *g,
 #endif /* CONFIG_NVGPU_TRACE */
 }
 
+/*
+ * The memory a mapping starts at must be aligned to its page size. For most
+ * buffers an aligned offset into the buffer is enough; buffers mapped in
+ * parts with different page sizes use big pages from offsets that are only
+ * aligned in memory.
+ */
+static bool nvgpu_gmmu_skip_aligned(struct gk20a *g, struct nvgpu_sgt *sgt,
+				    u64 space_to_skip, u32 page_size,
+				    struct nvgpu_gmmu_attrs *attrs)
+{
+	u64 mask = nvgpu_safe_sub_u64(U64(page_size), 1ULL);
+	u64 skip = space_to_skip;
+	void *sgl;
+
+	if ((skip & mask) == 0ULL) {
+		return true;
+	}
+	if (sgt == NULL) {
+		return false;
+	}
+
+	if (nvgpu_aperture_is_sysmem(attrs->aperture) &&
+	    nvgpu_iommuable(g) && nvgpu_sgt_iommuable(g, sgt)) {
+		return ((nvgpu_sgt_get_gpu_addr(g, sgt, sgt->sgl, attrs) +
+			 skip) & mask) == 0ULL;
+	}
+
+	nvgpu_sgt_for_each_sgl(sgl, sgt) {
+		u64 len = nvgpu_sgt_get_length(sgt, sgl);
+
+		if (skip < len) {
+			return ((nvgpu_sgt_get_phys(g, sgt, sgl) + skip) &
+				mask) == 0ULL;
+		}
+		skip -= len;
+	}
+
+	return false;
+}
+
 static int nvgpu_gmmu_update_page_table(struct vm_gk20a *vm,
 					struct nvgpu_sgt *sgt,
 					u64 space_to_skip,
@@ -972,7 +1451,8 @@ static int nvgpu_gmmu_update_page_table(struct vm_gk20a *vm,
 	page_size = vm->gmmu_page_sizes[attrs->pgsz];
 
 	if ((page_size == 0U) ||
-		((space_to_skip & (U64(page_size) - U64(1))) != 0ULL)) {
+	    !nvgpu_gmmu_skip_aligned(g, sgt, space_to_skip, page_size,
+				     attrs)) {
 		return -EINVAL;
 	}
 
@@ -1112,7 +1592,8 @@ u64 nvgpu_gmmu_map_locked(struct vm_gk20a *vm,
 		 * as if this was an unmap to guard against concurrent GPU
 		 * accesses to the buffer.
 		 */
-		err_maint = nvgpu_gmmu_cache_maint_unmap(g, vm, batch);
+		err_maint = nvgpu_gmmu_cache_maint_unmap(g, vm, vaddr, size,
+							 batch);
 		if (err_maint != 0) {
 			nvgpu_err(g,
 				  "failed cache maintenance on failed map, err=%d",
@@ -1120,7 +1601,8 @@ u64 nvgpu_gmmu_map_locked(struct vm_gk20a *vm,
 			err = err_maint;
 		}
 	} else {
-		err_maint = nvgpu_gmmu_cache_maint_map(g, vm, batch);
+		err_maint = nvgpu_gmmu_cache_maint_map(g, vm, vaddr, size,
+						       batch);
 		if (err_maint != 0) {
 			nvgpu_err(g,
 				  "failed cache maintenance on map! Backing off, err=%d",
@@ -1145,7 +1627,8 @@ u64 nvgpu_gmmu_map_locked(struct vm_gk20a *vm,
 			}
 
 			/* Try the unmap maintenance in any case */
-			err_maint = nvgpu_gmmu_cache_maint_unmap(g, vm, batch);
+			err_maint = nvgpu_gmmu_cache_maint_unmap(g, vm,
+					vaddr, size, batch);
 			if (err_maint != 0) {
 				nvgpu_err(g,
 					  "failed cache maintenance twice, err=%d",
@@ -1162,7 +1645,7 @@ u64 nvgpu_gmmu_map_locked(struct vm_gk20a *vm,
 
 fail_free_va:
 	if (allocated) {
-		nvgpu_vm_free_va(vm, vaddr, pgsz_idx);
+		nvgpu_vm_free_va(vm, vaddr, size, pgsz_idx);
 	}
 fail_alloc:
 	nvgpu_err(g, "%s: failed with err=%d", __func__, err);
@@ -1187,7 +1670,7 @@ void nvgpu_gmmu_unmap_locked(struct vm_gk20a *vm,
 	attrs.sparse = sparse;
 
 	if (va_allocated) {
-		nvgpu_vm_free_va(vm, vaddr, pgsz_idx);
+		nvgpu_vm_free_va(vm, vaddr, size, pgsz_idx);
 	}
 
 	err = nvgpu_gmmu_update_page_table(vm, NULL, 0,
@@ -1196,7 +1679,7 @@ void nvgpu_gmmu_unmap_locked(struct vm_gk20a *vm,
 		nvgpu_err(g, "failed to update gmmu ptes on unmap");
 	}
 
-	(void)nvgpu_gmmu_cache_maint_unmap(g, vm, batch);
+	(void)nvgpu_gmmu_cache_maint_unmap(g, vm, vaddr, size, batch);
 }
 
 u32 nvgpu_pte_words(struct gk20a *g)
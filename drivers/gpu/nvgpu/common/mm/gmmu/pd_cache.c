@@ -92,16 +92,101 @@ u32 nvgpu_pd_offset_from_index(const struct gk20a_mmu_level *l, u32 pd_idx)
 	return nvgpu_safe_mult_u32(pd_idx, l->entry_size) / U32(sizeof(u32));
 }
 
+static void nvgpu_pd_stage_flush(struct gk20a *g,
+				 struct nvgpu_pd_stage *stage)
+{
+	struct nvgpu_gmmu_pd *pd = stage->pd;
+	u64 offset;
+
+	if (stage->count == 0U) {
+		return;
+	}
+
+	offset = nvgpu_safe_add_u64(U64(pd->mem_offs),
+			nvgpu_safe_mult_u64(U64(stage->start),
+					    U64(sizeof(u32))));
+	nvgpu_mem_wr_n(g, pd->mem, offset, stage->words,
+		       nvgpu_safe_mult_u64(U64(stage->count),
+					   U64(sizeof(u32))));
+	stage->count = 0U;
+}
+
+/*
+ * Add a word to the staged run. A word that extends the run is appended and
+ * a word inside it overwrites the staged value; anything else (a gap, a
+ * backwards write or a full buffer) flushes the run and starts a new one.
+ */
+static void nvgpu_pd_stage_write(struct gk20a *g,
+				 struct nvgpu_pd_stage *stage,
+				 u32 w, u32 data)
+{
+	u32 end = nvgpu_safe_add_u32(stage->start, stage->count);
+
+	if ((stage->count != 0U) &&
+	    ((w < stage->start) || (w > end) ||
+	     ((w == end) && (stage->count == NVGPU_PD_STAGE_WORDS)))) {
+		nvgpu_pd_stage_flush(g, stage);
+	}
+
+	if (stage->count == 0U) {
+		stage->start = w;
+	}
+
+	stage->words[w - stage->start] = data;
+	if ((w - stage->start) == stage->count) {
+		stage->count = nvgpu_safe_add_u32(stage->count, 1U);
+	}
+}
+
 void nvgpu_pd_write(struct gk20a *g, struct nvgpu_gmmu_pd *pd,
 		    size_t w, u32 data)
 {
-	u64 tmp_offset = nvgpu_safe_add_u64((pd->mem_offs / sizeof(u32)), w);
+	u64 tmp_offset;
+
+	if (pd->stage != NULL) {
+		nvgpu_pd_stage_write(g, pd->stage,
+				     nvgpu_safe_cast_u64_to_u32(w), data);
+		return;
+	}
+
+	tmp_offset = nvgpu_safe_add_u64((pd->mem_offs / sizeof(u32)), w);
 
 	nvgpu_mem_wr32(g, pd->mem,
 		       nvgpu_safe_cast_u64_to_u32(tmp_offset),
 		       data);
 }
 
+void nvgpu_pd_stage_begin(struct gk20a *g, struct nvgpu_pd_stage *stage,
+			  struct nvgpu_gmmu_pd *pd)
+{
+	(void)g;
+
+	/*
+	 * Sysmem PDs are plain CPU stores; staging would only add a copy.
+	 */
+	if ((pd->mem == NULL) || (pd->mem->aperture != APERTURE_VIDMEM)) {
+		return;
+	}
+
+	stage->pd = pd;
+	stage->start = 0U;
+	stage->count = 0U;
+	pd->stage = stage;
+}
+
+void nvgpu_pd_stage_end(struct gk20a *g, struct nvgpu_gmmu_pd *pd)
+{
+	struct nvgpu_pd_stage *stage = pd->stage;
+
+	if (stage == NULL) {
+		return;
+	}
+
+	nvgpu_pd_stage_flush(g, stage);
+	stage->pd = NULL;
+	pd->stage = NULL;
+}
+
 int nvgpu_pd_cache_init(struct gk20a *g)
 {
 	struct nvgpu_pd_cache *cache;
@@ -182,6 +182,7 @@ static void nvgpu_remove_mm_support(struct mm_gk20a *mm)
 		g->ops.ramin.deinit_pdb_cache_errata(g);
 	}
 #endif
+	nvgpu_gmmu_pt_workers_deinit(g);
 	nvgpu_pd_cache_fini(g);
 }
 
@@ -564,6 +565,11 @@ static int nvgpu_init_mm_setup_sw(struct gk20a *g)
 		return err;
 	}
 
+	err = nvgpu_gmmu_pt_workers_init(g);
+	if (err != 0) {
+		return err;
+	}
+
 	if ((g->ops.fb.ecc.init != NULL) && !g->ecc.initialized) {
 		err = g->ops.fb.ecc.init(g);
 		if (err != 0) {
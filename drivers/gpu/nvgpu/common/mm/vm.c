@@ -39,7 +39,6 @@
 #include <nvgpu/vgpu/vm_vgpu.h>
 #include <nvgpu/cbc.h>
 #include <nvgpu/static_analysis.h>
-#include <nvgpu/power_features/pg.h>
 #include <nvgpu/nvhost.h>
 #include <nvgpu/string.h>
 
@@ -269,11 +268,13 @@ u64 nvgpu_vm_alloc_va(struct vm_gk20a *vm, u64 size, u32 pgsz_idx)
 	return addr;
 }
 
-void nvgpu_vm_free_va(struct vm_gk20a *vm, u64 addr, u32 pgsz_idx)
+void nvgpu_vm_free_va(struct vm_gk20a *vm, u64 addr, u64 size, u32 pgsz_idx)
 {
 	struct nvgpu_allocator *vma = vm->vma[pgsz_idx];
+	u32 page_size = vm->gmmu_page_sizes[pgsz_idx];
 
-	nvgpu_free(vma, addr);
+	/* the size nvgpu_vm_alloc_va() allocated */
+	nvgpu_free_sized(vma, addr, NVGPU_ALIGN(size, page_size), page_size);
 }
 
 void nvgpu_vm_mapping_batch_start(struct vm_gk20a_mapping_batch *mapping_batch)
@@ -286,18 +287,39 @@ void nvgpu_vm_mapping_batch_start(struct vm_gk20a_mapping_batch *mapping_batch)
 void nvgpu_vm_mapping_batch_finish_locked(
 	struct vm_gk20a *vm, struct vm_gk20a_mapping_batch *mapping_batch)
 {
-	int err;
-
 	/* hanging kref_put batch pointer? */
 	WARN_ON(vm->kref_put_batch == mapping_batch);
 
 	if (mapping_batch->need_tlb_invalidate) {
-		struct gk20a *g = gk20a_from_vm(vm);
-		err = nvgpu_pg_elpg_ms_protected_call(g, g->ops.fb.tlb_invalidate(g, vm->pdb.mem));
-		if (err != 0) {
-			nvgpu_err(g, "fb.tlb_invalidate() failed err=%d", err);
-		}
+		/*
+		 * Also covers any map invalidates deferred so far; the error
+		 * is logged by the flush.
+		 */
+		(void) nvgpu_gmmu_tlb_flush_dirty(vm);
+	}
+}
+
+int nvgpu_vm_tlb_flush_deferred(struct vm_gk20a *vm)
+{
+	int err;
+
+	if (nvgpu_atomic_read(&vm->tlb.pending) == 0) {
+		return 0;
 	}
+
+	nvgpu_mutex_acquire(&vm->update_gmmu_lock);
+	err = nvgpu_gmmu_tlb_flush_dirty(vm);
+	nvgpu_mutex_release(&vm->update_gmmu_lock);
+
+	return err;
+}
+
+void nvgpu_vm_tlb_disable_defer(struct vm_gk20a *vm)
+{
+	nvgpu_mutex_acquire(&vm->update_gmmu_lock);
+	vm->tlb.no_defer = true;
+	(void) nvgpu_gmmu_tlb_flush_dirty(vm);
+	nvgpu_mutex_release(&vm->update_gmmu_lock);
 }
 
 void nvgpu_vm_mapping_batch_finish(struct vm_gk20a *vm,
@@ -405,7 +427,8 @@ static int nvgpu_vm_init_user_vma(struct gk20a *g, struct vm_gk20a *vm,
 	}
 
 	/*
-	 * User VMA.
+	 * User VMA. Buffers are mapped and unmapped from many threads, so
+	 * keep a bounded amount of recently freed ranges for reuse.
 	 */
 	if (user_vma_start < user_vma_limit) {
 		(void) strcpy(alloc_name, "gk20a_");
@@ -417,7 +440,8 @@ static int nvgpu_vm_init_user_vma(struct gk20a *g, struct vm_gk20a *vm,
 						 user_vma_start,
 						 SZ_4K,
 						 GPU_BALLOC_MAX_ORDER,
-						 GPU_ALLOC_GVA_SPACE,
+						 GPU_ALLOC_GVA_SPACE |
+						 GPU_ALLOC_CACHE,
 						 BUDDY_ALLOCATOR);
 		if (err != 0) {
 			return err;
@@ -466,7 +490,8 @@ static int nvgpu_vm_init_user_lp_vma(struct gk20a *g, struct vm_gk20a *vm,
 						 user_lp_vma_start,
 						 vm->big_page_size,
 						 GPU_BALLOC_MAX_ORDER,
-						 GPU_ALLOC_GVA_SPACE,
+						 GPU_ALLOC_GVA_SPACE |
+						 GPU_ALLOC_CACHE,
 						 BUDDY_ALLOCATOR);
 		if (err != 0) {
 			return err;
@@ -822,6 +847,7 @@ int nvgpu_vm_do_init(struct mm_gk20a *mm,
 
 	nvgpu_mutex_init(&vm->syncpt_ro_map_lock);
 	nvgpu_mutex_init(&vm->update_gmmu_lock);
+	nvgpu_atomic_set(&vm->tlb.pending, 0);
 
 	nvgpu_ref_init(&vm->ref);
 	nvgpu_init_list_node(&vm->vm_area_list);
@@ -1161,6 +1187,346 @@ void nvgpu_vm_put_buffers(struct vm_gk20a *vm,
 	nvgpu_big_free(vm->mm->g, mapped_buffers);
 }
 
+/*
+ * A mapping that cannot use big pages as a whole, because its size or the
+ * alignment of its backing memory is not a multiple of the big page size,
+ * often still has a big page aligned interior. Such a mapping gets a VA
+ * range of whole PDEs; each PDE whose memory is laid out in big page aligned
+ * chunks is mapped with big pages, the others with small pages. A PDE never
+ * holds PTEs of both sizes.
+ */
+struct nvgpu_vm_mixed_layout {
+	u64 big_page_size;
+	u32 pde_shift;
+	/* Offset of the mapping into its first PDE. */
+	u64 delta;
+	u64 size;
+	u32 nr_pdes;
+	/* One bit per PDE that has to use small pages. */
+	unsigned long *small_pdes;
+	/* Longest chunk seen, used to pick delta. */
+	u64 ref_len;
+};
+
+static bool nvgpu_vm_mixed_pages_possible(struct vm_gk20a *vm, u64 map_addr,
+					  u64 map_size,
+					  struct nvgpu_ctag_buffer_info *binfo_ptr)
+{
+	struct gk20a *g = gk20a_from_vm(vm);
+	u64 pde_size;
+
+	if (((binfo_ptr->flags & NVGPU_VM_MAP_MIXED_PAGES) == 0U) ||
+	    g->is_virtual || !vm->big_pages || !vm->unified_va ||
+	    g->mm.disable_bigpage || (map_addr != 0ULL) ||
+	    ((binfo_ptr->flags & NVGPU_VM_MAP_FIXED_OFFSET) != 0U) ||
+	    (binfo_ptr->pgsz_idx != GMMU_PAGE_SIZE_SMALL)) {
+		return false;
+	}
+
+	pde_size = BIT64(nvgpu_vm_pde_coverage_bit_count(g,
+							vm->big_page_size));
+
+	return map_size >= pde_size;
+}
+
+/*
+ * Account a chunk of the mapping at offset @offset backed by @len bytes at
+ * physical (or IOMMU) address @phys. Without @mark only pick delta so that
+ * the longest chunk can use big pages.
+ */
+static void nvgpu_vm_mixed_chunk(struct nvgpu_vm_mixed_layout *l, u64 offset,
+				 u64 phys, u64 len, bool mark)
+{
+	u64 mask = nvgpu_safe_sub_u64(l->big_page_size, 1ULL);
+	u64 v0, v1;
+	u32 first, last;
+
+	if (!mark) {
+		if (len > l->ref_len) {
+			l->ref_len = len;
+			l->delta = ((phys & mask) + l->big_page_size -
+				    (offset & mask)) & mask;
+		}
+		return;
+	}
+
+	v0 = nvgpu_safe_add_u64(l->delta, offset);
+	v1 = nvgpu_safe_add_u64(v0, len);
+	first = nvgpu_safe_cast_u64_to_u32(v0 >> l->pde_shift);
+	last = nvgpu_safe_cast_u64_to_u32(
+			nvgpu_safe_sub_u64(v1, 1ULL) >> l->pde_shift);
+
+	if ((phys & mask) != (v0 & mask)) {
+		nvgpu_bitmap_set(l->small_pdes, first,
+				 nvgpu_safe_add_u32(last - first, 1U));
+		return;
+	}
+	if ((v0 & mask) != 0ULL) {
+		nvgpu_bitmap_set(l->small_pdes, first, 1U);
+	}
+	if ((v1 & mask) != 0ULL) {
+		nvgpu_bitmap_set(l->small_pdes, last, 1U);
+	}
+}
+
+static void nvgpu_vm_mixed_walk(struct gk20a *g, struct nvgpu_sgt *sgt,
+				u64 phys_offset,
+				struct nvgpu_vm_mixed_layout *l, bool mark)
+{
+	u64 space_to_skip = phys_offset;
+	u64 remaining = l->size;
+	u64 offset = 0ULL;
+	void *sgl;
+
+	/* Same address selection as nvgpu_sgt_alignment(). */
+	if (nvgpu_iommuable(g) && nvgpu_sgt_iommuable(g, sgt) &&
+	    (nvgpu_sgt_get_dma(sgt, sgt->sgl) != 0ULL)) {
+		nvgpu_vm_mixed_chunk(l, 0ULL,
+			nvgpu_safe_add_u64(nvgpu_sgt_get_dma(sgt, sgt->sgl),
+					   phys_offset),
+			l->size, mark);
+		return;
+	}
+
+	nvgpu_sgt_for_each_sgl(sgl, sgt) {
+		u64 len = nvgpu_sgt_get_length(sgt, sgl);
+		u64 phys;
+
+		if (remaining == 0ULL) {
+			break;
+		}
+		if (space_to_skip >= len) {
+			space_to_skip -= len;
+			continue;
+		}
+
+		phys = nvgpu_safe_add_u64(nvgpu_sgt_get_phys(g, sgt, sgl),
+					  space_to_skip);
+		len = min(len - space_to_skip, remaining);
+		space_to_skip = 0ULL;
+
+		nvgpu_vm_mixed_chunk(l, offset, phys, len, mark);
+
+		offset = nvgpu_safe_add_u64(offset, len);
+		remaining -= len;
+	}
+}
+
+/*
+ * Turn the PDE bitmap into page size segments; returns the number of
+ * segments and fills @segs when it is not NULL.
+ */
+static u32 nvgpu_vm_mixed_segs(struct nvgpu_vm_mixed_layout *l,
+			       struct nvgpu_mapped_buf_seg *segs,
+			       bool *has_big)
+{
+	u64 end_va = nvgpu_safe_add_u64(l->delta, l->size);
+	u32 nr_segs = 0U;
+	u32 prev_pgsz = GMMU_NR_PAGE_SIZES;
+	u32 i;
+
+	*has_big = false;
+
+	for (i = 0U; i < l->nr_pdes; i++) {
+		u64 start = max((u64)i << l->pde_shift, l->delta);
+		u64 end = min((u64)(i + 1U) << l->pde_shift, end_va);
+		u32 pgsz = nvgpu_test_bit(i, l->small_pdes) ?
+			GMMU_PAGE_SIZE_SMALL : GMMU_PAGE_SIZE_BIG;
+
+		if (pgsz == GMMU_PAGE_SIZE_BIG) {
+			*has_big = true;
+		}
+
+		if (pgsz == prev_pgsz) {
+			if (segs != NULL) {
+				segs[nr_segs - 1U].size += end - start;
+			}
+			continue;
+		}
+
+		if (segs != NULL) {
+			segs[nr_segs].offset = start - l->delta;
+			segs[nr_segs].size = end - start;
+			segs[nr_segs].pgsz_idx = pgsz;
+		}
+		nr_segs++;
+		prev_pgsz = pgsz;
+	}
+
+	return nr_segs;
+}
+
+static void nvgpu_vm_unmap_segs(struct vm_gk20a *vm, u64 addr,
+				struct nvgpu_mapped_buf_seg *segs, u32 nr_segs,
+				struct vm_gk20a_mapping_batch *batch)
+{
+	struct gk20a *g = gk20a_from_vm(vm);
+	u32 i;
+
+	for (i = 0U; i < nr_segs; i++) {
+		g->ops.mm.gmmu.unmap(vm,
+				     nvgpu_safe_add_u64(addr, segs[i].offset),
+				     segs[i].size,
+				     segs[i].pgsz_idx,
+				     false,
+				     gk20a_mem_flag_none,
+				     false,
+				     batch);
+	}
+}
+
+/*
+ * Map a buffer with both big and small pages. Returns 1 when the buffer
+ * has no big page aligned interior, so that the caller maps it with small
+ * pages as usual.
+ */
+static int nvgpu_vm_do_map_mixed(struct vm_gk20a *vm,
+				 struct nvgpu_sgt *sgt,
+				 u64 *map_addr_ptr,
+				 u64 map_size,
+				 u64 phys_offset,
+				 u8 pte_kind,
+				 enum gk20a_mem_rw_flag rw,
+				 struct vm_gk20a_mapping_batch *batch,
+				 enum nvgpu_aperture aperture,
+				 struct nvgpu_ctag_buffer_info *binfo_ptr,
+				 struct nvgpu_mapped_buf *mapped_buffer)
+{
+	struct gk20a *g = gk20a_from_vm(vm);
+	struct nvgpu_vm_mixed_layout l = { };
+	struct nvgpu_mapped_buf_seg *segs = NULL;
+	struct vm_gk20a_mapping_batch local_batch;
+	struct vm_gk20a_mapping_batch *map_batch = batch;
+	u64 pde_size, va_base, va_size, map_addr;
+	u32 nr_segs, i;
+	bool has_big;
+	int err = 0;
+
+	l.big_page_size = vm->big_page_size;
+	l.pde_shift = nvgpu_vm_pde_coverage_bit_count(g, vm->big_page_size);
+	l.size = map_size;
+	pde_size = BIT64(l.pde_shift);
+
+	nvgpu_vm_mixed_walk(g, sgt, phys_offset, &l, false);
+
+	l.nr_pdes = nvgpu_safe_cast_u64_to_u32(DIV_ROUND_UP_U64(
+			nvgpu_safe_add_u64(l.delta, map_size), pde_size));
+	l.small_pdes = nvgpu_kzalloc(g, BITS_TO_LONGS(l.nr_pdes) *
+				     sizeof(unsigned long));
+	if (l.small_pdes == NULL) {
+		return -ENOMEM;
+	}
+
+	nvgpu_vm_mixed_walk(g, sgt, phys_offset, &l, true);
+
+	/* PDEs only partly covered by the buffer keep small pages. */
+	if (l.delta != 0ULL) {
+		nvgpu_bitmap_set(l.small_pdes, 0U, 1U);
+	}
+	if (((l.delta + map_size) & (pde_size - 1ULL)) != 0ULL) {
+		nvgpu_bitmap_set(l.small_pdes, l.nr_pdes - 1U, 1U);
+	}
+
+	nr_segs = nvgpu_vm_mixed_segs(&l, NULL, &has_big);
+	if (!has_big) {
+		err = 1;
+		goto free_pdes;
+	}
+
+	segs = nvgpu_kzalloc(g, sizeof(*segs) * nr_segs);
+	if (segs == NULL) {
+		err = -ENOMEM;
+		goto free_pdes;
+	}
+	(void) nvgpu_vm_mixed_segs(&l, segs, &has_big);
+
+	/*
+	 * Allocations of whole PDEs are PDE aligned and don't share a PDE
+	 * with other mappings of either page size.
+	 */
+	va_size = NVGPU_ALIGN(l.delta + map_size, pde_size);
+	va_base = nvgpu_vm_alloc_va(vm, va_size, GMMU_PAGE_SIZE_BIG);
+	if (va_base == 0ULL) {
+		err = -ENOMEM;
+		goto free_segs;
+	}
+	if ((va_base & (pde_size - 1ULL)) != 0ULL) {
+		nvgpu_vm_free_va(vm, va_base, va_size, GMMU_PAGE_SIZE_BIG);
+		err = 1;
+		goto free_segs;
+	}
+	map_addr = va_base + l.delta;
+
+	if (map_batch == NULL) {
+		nvgpu_vm_mapping_batch_start(&local_batch);
+		map_batch = &local_batch;
+	}
+
+	for (i = 0U; i < nr_segs; i++) {
+		u64 addr = g->ops.mm.gmmu.map(vm,
+				      map_addr + segs[i].offset,
+				      sgt,
+				      phys_offset + segs[i].offset,
+				      segs[i].size,
+				      segs[i].pgsz_idx,
+				      pte_kind,
+				      0U,
+				      binfo_ptr->flags,
+				      rw,
+				      false,
+				      false,
+				      false,
+				      map_batch,
+				      aperture);
+		if (addr == 0ULL) {
+			err = -ENOMEM;
+			break;
+		}
+	}
+
+	if ((err == 0) && (map_batch == &local_batch)) {
+		/*
+		 * Like a single map without a batch, fail if the new PTEs
+		 * can't be made visible.
+		 */
+		if (nvgpu_gmmu_tlb_flush_dirty(vm) != 0) {
+			err = -ENOMEM;
+		}
+		nvgpu_vm_mapping_batch_start(&local_batch);
+	}
+
+	if (err != 0) {
+		nvgpu_vm_unmap_segs(vm, map_addr, segs, i, map_batch);
+		nvgpu_vm_free_va(vm, va_base, va_size, GMMU_PAGE_SIZE_BIG);
+	}
+
+	if (map_batch == &local_batch) {
+		nvgpu_vm_mapping_batch_finish_locked(vm, &local_batch);
+	}
+
+	if (err != 0) {
+		goto free_segs;
+	}
+
+	nvgpu_log(g, gpu_dbg_map,
+		  "mixed page map: gv=0x%llx size=0x%llx segs=%u",
+		  map_addr, map_size, nr_segs);
+
+	mapped_buffer->segs = segs;
+	mapped_buffer->nr_segs = nr_segs;
+	mapped_buffer->va_base = va_base;
+	mapped_buffer->va_size = va_size;
+	*map_addr_ptr = map_addr;
+	nvgpu_kfree(g, l.small_pdes);
+	return 0;
+
+free_segs:
+	nvgpu_kfree(g, segs);
+free_pdes:
+	nvgpu_kfree(g, l.small_pdes);
+	return err;
+}
+
 static int nvgpu_vm_do_map(struct vm_gk20a *vm,
 		 struct nvgpu_os_buffer *os_buf,
 		 struct nvgpu_sgt *sgt,
@@ -1171,7 +1537,8 @@ static int nvgpu_vm_do_map(struct vm_gk20a *vm,
 		 u32 flags,
 		 struct vm_gk20a_mapping_batch *batch,
 		 enum nvgpu_aperture aperture,
-		 struct nvgpu_ctag_buffer_info *binfo_ptr)
+		 struct nvgpu_ctag_buffer_info *binfo_ptr,
+		 struct nvgpu_mapped_buf *mapped_buffer)
 {
 	struct gk20a *g = gk20a_from_vm(vm);
 	int err = 0;
@@ -1310,6 +1677,18 @@ static int nvgpu_vm_do_map(struct vm_gk20a *vm,
 	}
 #endif
 
+	if ((ctag_offset == 0U) && !clear_ctags &&
+	    nvgpu_vm_mixed_pages_possible(vm, map_addr, map_size, binfo_ptr)) {
+		err = nvgpu_vm_do_map_mixed(vm, sgt, map_addr_ptr, map_size,
+					    phys_offset, pte_kind, rw, batch,
+					    aperture, binfo_ptr,
+					    mapped_buffer);
+		if (err != 1) {
+			goto ret_err;
+		}
+		err = 0;
+	}
+
 	map_addr = g->ops.mm.gmmu.map(vm,
 				      map_addr,
 				      sgt,
@@ -1451,6 +1830,126 @@ static int nvgpu_vm_map_check_attributes(struct vm_gk20a *vm,
 	return 0;
 }
 
+static void nvgpu_vm_account_pages(struct vm_gk20a *vm, u32 pgsz_idx,
+				   u64 size, bool map)
+{
+	struct nvgpu_vm_page_stats *stats = &vm->page_stats;
+	u64 nr_pages = DIV_ROUND_UP_U64(size, vm->gmmu_page_sizes[pgsz_idx]);
+
+	if (map) {
+		stats->mapped_pages[pgsz_idx] = nvgpu_safe_add_u64(
+			stats->mapped_pages[pgsz_idx], nr_pages);
+	} else {
+		stats->mapped_pages[pgsz_idx] = nvgpu_safe_sub_u64(
+			stats->mapped_pages[pgsz_idx], nr_pages);
+	}
+}
+
+/*
+ * Update vm.page_stats for a mapping being added or removed. The
+ * update_gmmu_lock must be held.
+ */
+static void nvgpu_vm_update_page_stats(struct vm_gk20a *vm,
+				       struct nvgpu_mapped_buf *mapped_buffer,
+				       bool map)
+{
+	struct nvgpu_vm_page_stats *stats = &vm->page_stats;
+	u64 big_bytes = 0ULL;
+	u32 i;
+
+	if (mapped_buffer->segs == NULL) {
+		nvgpu_vm_account_pages(vm, mapped_buffer->pgsz_idx,
+				       mapped_buffer->size, map);
+		return;
+	}
+
+	for (i = 0U; i < mapped_buffer->nr_segs; i++) {
+		struct nvgpu_mapped_buf_seg *seg = &mapped_buffer->segs[i];
+
+		nvgpu_vm_account_pages(vm, seg->pgsz_idx, seg->size, map);
+		if (seg->pgsz_idx == GMMU_PAGE_SIZE_BIG) {
+			big_bytes = nvgpu_safe_add_u64(big_bytes, seg->size);
+		}
+	}
+
+	if (map) {
+		stats->nr_mixed_maps = nvgpu_safe_add_u64(
+			stats->nr_mixed_maps, 1ULL);
+		stats->mixed_big_bytes = nvgpu_safe_add_u64(
+			stats->mixed_big_bytes, big_bytes);
+	} else {
+		stats->nr_mixed_maps = nvgpu_safe_sub_u64(
+			stats->nr_mixed_maps, 1ULL);
+		stats->mixed_big_bytes = nvgpu_safe_sub_u64(
+			stats->mixed_big_bytes, big_bytes);
+	}
+}
+
+void nvgpu_vm_get_page_stats(struct vm_gk20a *vm,
+			     struct nvgpu_vm_page_stats *stats)
+{
+	nvgpu_mutex_acquire(&vm->update_gmmu_lock);
+	*stats = vm->page_stats;
+	nvgpu_mutex_release(&vm->update_gmmu_lock);
+}
+
+int nvgpu_vm_mapping_modify_mixed(struct vm_gk20a *vm,
+				  struct nvgpu_mapped_buf *mapped_buffer,
+				  struct nvgpu_sgt *sgt, u8 kind,
+				  u64 buffer_offset, u64 buffer_size)
+{
+	struct gk20a *g = gk20a_from_vm(vm);
+	u64 end = nvgpu_safe_add_u64(buffer_offset, buffer_size);
+	u32 i;
+
+	/* Check every segment first so that a bad range changes nothing. */
+	for (i = 0U; i < mapped_buffer->nr_segs; i++) {
+		struct nvgpu_mapped_buf_seg *seg = &mapped_buffer->segs[i];
+		u64 start = max(buffer_offset, seg->offset);
+		u64 stop = min(end, nvgpu_safe_add_u64(seg->offset, seg->size));
+		u64 mask = (u64)vm->gmmu_page_sizes[seg->pgsz_idx] - 1ULL;
+
+		if (start >= stop) {
+			continue;
+		}
+		if ((((mapped_buffer->addr + start) & mask) != 0ULL) ||
+		    (((mapped_buffer->addr + stop) & mask) != 0ULL)) {
+			nvgpu_err(g, "range 0x%llx+0x%llx splits a 0x%llx page",
+				  buffer_offset, buffer_size, mask + 1ULL);
+			return -EINVAL;
+		}
+	}
+
+	for (i = 0U; i < mapped_buffer->nr_segs; i++) {
+		struct nvgpu_mapped_buf_seg *seg = &mapped_buffer->segs[i];
+		u64 start = max(buffer_offset, seg->offset);
+		u64 stop = min(end, nvgpu_safe_add_u64(seg->offset, seg->size));
+
+		if (start >= stop) {
+			continue;
+		}
+		if (g->ops.mm.gmmu.map(vm,
+				       mapped_buffer->addr + start,
+				       sgt,
+				       start,
+				       stop - start,
+				       seg->pgsz_idx,
+				       kind,
+				       0U,
+				       mapped_buffer->flags,
+				       mapped_buffer->rw_flag,
+				       false,
+				       false,
+				       false,
+				       NULL,
+				       mapped_buffer->aperture) == 0ULL) {
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
 int nvgpu_vm_map(struct vm_gk20a *vm,
 		 struct nvgpu_os_buffer *os_buf,
 		 struct nvgpu_sgt *sgt,
@@ -1531,7 +2030,7 @@ int nvgpu_vm_map(struct vm_gk20a *vm,
 
 	err = nvgpu_vm_do_map(vm, os_buf, sgt, &map_addr,
 				map_size, phys_offset, rw, flags, batch,
-				aperture, &binfo);
+				aperture, &binfo, mapped_buffer);
 	if (err != 0) {
 		goto clean_up;
 	}
@@ -1551,6 +2050,7 @@ int nvgpu_vm_map(struct vm_gk20a *vm,
 	mapped_buffer->aperture     = aperture;
 
 	nvgpu_insert_mapped_buf(vm, mapped_buffer);
+	nvgpu_vm_update_page_stats(vm, mapped_buffer, true);
 
 	if (vm_area != NULL) {
 		nvgpu_list_add_tail(&mapped_buffer->buffer_list,
@@ -1579,16 +2079,36 @@ static void nvgpu_vm_do_unmap(struct nvgpu_mapped_buf *mapped_buffer,
 {
 	struct vm_gk20a *vm = mapped_buffer->vm;
 	struct gk20a *g = vm->mm->g;
+	struct vm_gk20a_mapping_batch local_batch;
+
+	nvgpu_vm_update_page_stats(vm, mapped_buffer, false);
 
-	g->ops.mm.gmmu.unmap(vm,
-			     mapped_buffer->addr,
-			     mapped_buffer->size,
-			     mapped_buffer->pgsz_idx,
-			     mapped_buffer->va_allocated,
-			     gk20a_mem_flag_none,
-			     (mapped_buffer->vm_area != NULL) ?
-			     mapped_buffer->vm_area->sparse : false,
-			     batch);
+	if (mapped_buffer->segs != NULL) {
+		if (batch == NULL) {
+			nvgpu_vm_mapping_batch_start(&local_batch);
+		}
+		nvgpu_vm_unmap_segs(vm, mapped_buffer->addr,
+				    mapped_buffer->segs,
+				    mapped_buffer->nr_segs,
+				    (batch != NULL) ? batch : &local_batch);
+		nvgpu_vm_free_va(vm, mapped_buffer->va_base,
+				 mapped_buffer->va_size, GMMU_PAGE_SIZE_BIG);
+		if (batch == NULL) {
+			nvgpu_vm_mapping_batch_finish_locked(vm,
+							     &local_batch);
+		}
+		nvgpu_kfree(g, mapped_buffer->segs);
+	} else {
+		g->ops.mm.gmmu.unmap(vm,
+				     mapped_buffer->addr,
+				     mapped_buffer->size,
+				     mapped_buffer->pgsz_idx,
+				     mapped_buffer->va_allocated,
+				     gk20a_mem_flag_none,
+				     (mapped_buffer->vm_area != NULL) ?
+				     mapped_buffer->vm_area->sparse : false,
+				     batch);
+	}
 
 	/*
 	 * Remove from mapped buffer tree. Then delete the buffer from the
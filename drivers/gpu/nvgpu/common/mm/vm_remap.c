@@ -78,6 +78,12 @@ static void nvgpu_vm_remap_mpool_release(struct nvgpu_ref *ref)
 		*mpool->l2_flushed = true;
 	}
 
+	/*
+	 * A map whose TLB invalidate was deferred may have replaced pages of
+	 * this pool within the same remap; don't let the TLB outlive them.
+	 */
+	(void) nvgpu_gmmu_tlb_flush_dirty(vm);
+
 	nvgpu_vm_remap_os_buf_put(vm, &mpool->remap_os_buf);
 	nvgpu_kfree(g, mpool);
 }
@@ -342,6 +348,29 @@ static void nvgpu_vm_remap_update_pool_refcounts(
 	}
 }
 
+/*
+ * Return true if any page of the range is currently backed by a physical
+ * pool, i.e. remapping it replaces translations to memory that is released
+ * once the remap completes.
+ */
+static bool nvgpu_vm_remap_range_backed(struct nvgpu_vm_remap_vpool *vpool,
+	u64 first_page, u64 num_pages)
+{
+	u64 pgnum;
+
+	if (vpool->num_pages < first_page + num_pages) {
+		return true;
+	}
+
+	for (pgnum = first_page; pgnum < first_page + num_pages; pgnum++) {
+		if (vpool->mpool_by_page[pgnum] != NULL) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /*
  * Return the ctag offset (if applicable) for the specified map operation.
  */
@@ -480,6 +509,18 @@ static int nvgpu_vm_remap_execute_remaps(struct vm_gk20a *vm,
 			flags = nvgpu_vm_remap_get_map_flags(op);
 			rw_flag = nvgpu_vm_remap_get_map_rw_flag(op);
 
+			/*
+			 * Binding pages into a sparse hole only adds
+			 * translations, so the TLB invalidate can wait for
+			 * the next submit.
+			 */
+			batch.defer_tlb_invalidate =
+				!nvgpu_vm_remap_range_backed(vpool,
+					nvgpu_safe_sub_u64(
+						op->virt_offset_in_pages,
+						vpool->base_offset_in_pages),
+					op->num_pages);
+
 			/*
 			 * Remap range.
 			 */
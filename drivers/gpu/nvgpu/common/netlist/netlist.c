@@ -79,12 +79,53 @@ u32 *nvgpu_netlist_alloc_u32_list(struct gk20a *g,
 	return u32l->l;
 }
 
-static int nvgpu_netlist_alloc_load_u32_list(struct gk20a *g, u8 *src, u32 len,
+/*
+ * The firmware image stays resident while the netlist is loaded, so regions
+ * that are word aligned and hold a whole number of elements are used in
+ * place. That is the case for every image the netlist tools produce; other
+ * regions are copied into lists of their own.
+ */
+static bool nvgpu_netlist_region_in_place(u8 *src, u32 len, u32 elem_size)
+{
+	return ((((uintptr_t)src) & (sizeof(u32) - 1UL)) == 0UL) &&
+		((len % elem_size) == 0U);
+}
+
+static bool nvgpu_netlist_list_in_image(struct nvgpu_netlist_vars *netlist_vars,
+			void *l)
+{
+	struct nvgpu_firmware *fw = netlist_vars->fw;
+	uintptr_t start, addr = (uintptr_t)l;
+
+	if (fw == NULL) {
+		return false;
+	}
+
+	start = (uintptr_t)fw->data;
+
+	/* A region of zero length can start at the end of the image */
+	return (addr >= start) && ((addr - start) <= fw->size);
+}
+
+static void nvgpu_netlist_free_list(struct gk20a *g,
+			struct nvgpu_netlist_vars *netlist_vars, void *l)
+{
+	if (!nvgpu_netlist_list_in_image(netlist_vars, l)) {
+		nvgpu_kfree(g, l);
+	}
+}
+
+static int nvgpu_netlist_load_u32_list(struct gk20a *g, u8 *src, u32 len,
 			struct netlist_u32_list *u32_list)
 {
 	u32_list->count = nvgpu_safe_add_u32(len,
 				nvgpu_safe_cast_u64_to_u32(sizeof(u32) - 1UL))
 							/ U32(sizeof(u32));
+	if (nvgpu_netlist_region_in_place(src, len, U32(sizeof(u32)))) {
+		u32_list->l = (u32 *)(void *)src;
+		return 0;
+	}
+
 	if (nvgpu_netlist_alloc_u32_list(g, u32_list) == NULL) {
 		return -ENOMEM;
 	}
@@ -94,41 +135,63 @@ static int nvgpu_netlist_alloc_load_u32_list(struct gk20a *g, u8 *src, u32 len,
 	return 0;
 }
 
-static int nvgpu_netlist_alloc_load_av_list(struct gk20a *g, u8 *src, u32 len,
+static int nvgpu_netlist_load_av_list(struct gk20a *g, u8 *src, u32 len,
 			struct netlist_av_list *av_list)
 {
 	av_list->count = len / U32(sizeof(struct netlist_av));
+	if (nvgpu_netlist_region_in_place(src, len,
+			U32(sizeof(struct netlist_av)))) {
+		av_list->l = (struct netlist_av *)(void *)src;
+		return 0;
+	}
+
 	if (nvgpu_netlist_alloc_av_list(g, av_list) == NULL) {
 		return -ENOMEM;
 	}
 
-	nvgpu_memcpy((u8 *)av_list->l, src, len);
+	nvgpu_memcpy((u8 *)av_list->l, src,
+		nvgpu_safe_mult_u64(av_list->count, sizeof(struct netlist_av)));
 
 	return 0;
 }
 
-static int nvgpu_netlist_alloc_load_av_list64(struct gk20a *g, u8 *src, u32 len,
+static int nvgpu_netlist_load_av64_list(struct gk20a *g, u8 *src, u32 len,
 			struct netlist_av64_list *av64_list)
 {
 	av64_list->count = len / U32(sizeof(struct netlist_av64));
+	if (nvgpu_netlist_region_in_place(src, len,
+			U32(sizeof(struct netlist_av64)))) {
+		av64_list->l = (struct netlist_av64 *)(void *)src;
+		return 0;
+	}
+
 	if (nvgpu_netlist_alloc_av64_list(g, av64_list) == NULL) {
 		return -ENOMEM;
 	}
 
-	nvgpu_memcpy((u8 *)av64_list->l, src, len);
+	nvgpu_memcpy((u8 *)av64_list->l, src,
+		nvgpu_safe_mult_u64(av64_list->count,
+				    sizeof(struct netlist_av64)));
 
 	return 0;
 }
 
-static int nvgpu_netlist_alloc_load_aiv_list(struct gk20a *g, u8 *src, u32 len,
+static int nvgpu_netlist_load_aiv_list(struct gk20a *g, u8 *src, u32 len,
 			struct netlist_aiv_list *aiv_list)
 {
 	aiv_list->count = len / U32(sizeof(struct netlist_aiv));
+	if (nvgpu_netlist_region_in_place(src, len,
+			U32(sizeof(struct netlist_aiv)))) {
+		aiv_list->l = (struct netlist_aiv *)(void *)src;
+		return 0;
+	}
+
 	if (nvgpu_netlist_alloc_aiv_list(g, aiv_list) == NULL) {
 		return -ENOMEM;
 	}
 
-	nvgpu_memcpy((u8 *)aiv_list->l, src, len);
+	nvgpu_memcpy((u8 *)aiv_list->l, src,
+		nvgpu_safe_mult_u64(aiv_list->count, sizeof(struct netlist_aiv)));
 
 	return 0;
 }
@@ -143,22 +206,22 @@ static bool nvgpu_netlist_handle_ucode_region_id(struct gk20a *g,
 	switch (region_id) {
 	case NETLIST_REGIONID_FECS_UCODE_DATA:
 		nvgpu_log_info(g, "NETLIST_REGIONID_FECS_UCODE_DATA");
-		err = nvgpu_netlist_alloc_load_u32_list(g,
+		err = nvgpu_netlist_load_u32_list(g,
 			src, size, &netlist_vars->ucode.fecs.data);
 		break;
 	case NETLIST_REGIONID_FECS_UCODE_INST:
 		nvgpu_log_info(g, "NETLIST_REGIONID_FECS_UCODE_INST");
-		err = nvgpu_netlist_alloc_load_u32_list(g,
+		err = nvgpu_netlist_load_u32_list(g,
 			src, size, &netlist_vars->ucode.fecs.inst);
 		break;
 	case NETLIST_REGIONID_GPCCS_UCODE_DATA:
 		nvgpu_log_info(g, "NETLIST_REGIONID_GPCCS_UCODE_DATA");
-		err = nvgpu_netlist_alloc_load_u32_list(g,
+		err = nvgpu_netlist_load_u32_list(g,
 			src, size, &netlist_vars->ucode.gpccs.data);
 		break;
 	case NETLIST_REGIONID_GPCCS_UCODE_INST:
 		nvgpu_log_info(g, "NETLIST_REGIONID_GPCCS_UCODE_INST");
-		err = nvgpu_netlist_alloc_load_u32_list(g,
+		err = nvgpu_netlist_load_u32_list(g,
 			src, size, &netlist_vars->ucode.gpccs.inst);
 		break;
 	default:
@@ -181,44 +244,44 @@ static bool nvgpu_netlist_handle_sw_bundles_region_id(struct gk20a *g,
 	switch (region_id) {
 	case NETLIST_REGIONID_SW_BUNDLE_INIT:
 		nvgpu_log_info(g, "NETLIST_REGIONID_SW_BUNDLE_INIT");
-		err = nvgpu_netlist_alloc_load_av_list(g,
+		err = nvgpu_netlist_load_av_list(g,
 			src, size, &netlist_vars->sw_bundle_init);
 		break;
 	case NETLIST_REGIONID_SW_METHOD_INIT:
 		nvgpu_log_info(g, "NETLIST_REGIONID_SW_METHOD_INIT");
-		err = nvgpu_netlist_alloc_load_av_list(g,
+		err = nvgpu_netlist_load_av_list(g,
 			src, size, &netlist_vars->sw_method_init);
 		break;
 	case NETLIST_REGIONID_SW_CTX_LOAD:
 		nvgpu_log_info(g, "NETLIST_REGIONID_SW_CTX_LOAD");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->sw_ctx_load);
 		break;
 	case NETLIST_REGIONID_SW_NON_CTX_LOAD:
 		nvgpu_log_info(g, "NETLIST_REGIONID_SW_NON_CTX_LOAD");
-		err = nvgpu_netlist_alloc_load_av_list(g,
+		err = nvgpu_netlist_load_av_list(g,
 			src, size, &netlist_vars->sw_non_ctx_load);
 		break;
 	case NETLIST_REGIONID_SWVEIDBUNDLEINIT:
 		nvgpu_log_info(g, "NETLIST_REGIONID_SW_VEID_BUNDLE_INIT");
-		err = nvgpu_netlist_alloc_load_av_list(g,
+		err = nvgpu_netlist_load_av_list(g,
 			src, size, &netlist_vars->sw_veid_bundle_init);
 		break;
 	case NETLIST_REGIONID_SW_BUNDLE64_INIT:
 		nvgpu_log_info(g, "NETLIST_REGIONID_SW_BUNDLE64_INIT");
-		err = nvgpu_netlist_alloc_load_av_list64(g,
+		err = nvgpu_netlist_load_av64_list(g,
 			src, size, &netlist_vars->sw_bundle64_init);
 		break;
 
 #if defined(CONFIG_NVGPU_NON_FUSA)
 	case NETLIST_REGIONID_SW_NON_CTX_LOCAL_COMPUTE_LOAD:
 		nvgpu_log_info(g, "NETLIST_REGIONID_SW_NON_CTX_LOCAL_COMPUTE_LOAD");
-		err = nvgpu_netlist_alloc_load_av_list(g, src, size,
+		err = nvgpu_netlist_load_av_list(g, src, size,
 			&netlist_vars->sw_non_ctx_local_compute_load);
 		break;
 	case NETLIST_REGIONID_SW_NON_CTX_GLOBAL_COMPUTE_LOAD:
 		nvgpu_log_info(g, "NETLIST_REGIONID_SW_NON_CTX_GLOBAL_COMPUTE_LOAD");
-		err = nvgpu_netlist_alloc_load_av_list(g, src, size,
+		err = nvgpu_netlist_load_av_list(g, src, size,
 			&netlist_vars->sw_non_ctx_global_compute_load);
 		break;
 #endif
@@ -235,12 +298,12 @@ static bool nvgpu_netlist_handle_sw_bundles_region_id(struct gk20a *g,
 #ifdef CONFIG_NVGPU_GRAPHICS
 		case NETLIST_REGIONID_SW_NON_CTX_LOCAL_GFX_LOAD:
 			nvgpu_log_info(g, "NETLIST_REGIONID_SW_NON_CTX_LOCAL_GFX_LOAD");
-			err = nvgpu_netlist_alloc_load_av_list(g, src, size,
+			err = nvgpu_netlist_load_av_list(g, src, size,
 				&netlist_vars->sw_non_ctx_local_gfx_load);
 			break;
 		case NETLIST_REGIONID_SW_NON_CTX_GLOBAL_GFX_LOAD:
 			nvgpu_log_info(g, "NETLIST_REGIONID_SW_NON_CTX_GLOBAL_GFX_LOAD");
-			err = nvgpu_netlist_alloc_load_av_list(g, src, size,
+			err = nvgpu_netlist_load_av_list(g, src, size,
 				&netlist_vars->sw_non_ctx_global_gfx_load);
 			break;
 #endif
@@ -306,134 +369,134 @@ static bool nvgpu_netlist_handle_debugger_region_id(struct gk20a *g,
 	switch (region_id) {
 	case NETLIST_REGIONID_CTXREG_PM_SYS:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PM_SYS");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.pm_sys);
 		break;
 	case NETLIST_REGIONID_CTXREG_PM_GPC:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PM_GPC");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.pm_gpc);
 		break;
 	case NETLIST_REGIONID_CTXREG_PM_TPC:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PM_TPC");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.pm_tpc);
 		break;
 	case NETLIST_REGIONID_NVPERF_CTXREG_SYS:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_CTXREG_SYS");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.perf_sys);
 		break;
 	case NETLIST_REGIONID_NVPERF_FBP_CTXREGS:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_FBP_CTXREGS");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.fbp);
 		break;
 	case NETLIST_REGIONID_NVPERF_CTXREG_GPC:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_CTXREG_GPC");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.perf_gpc);
 		break;
 	case NETLIST_REGIONID_NVPERF_FBP_ROUTER:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_FBP_ROUTER");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.fbp_router);
 		break;
 	case NETLIST_REGIONID_NVPERF_GPC_ROUTER:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_GPC_ROUTER");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.gpc_router);
 		break;
 	case NETLIST_REGIONID_CTXREG_PMLTC:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PMLTC");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.pm_ltc);
 		break;
 	case NETLIST_REGIONID_CTXREG_PMFBPA:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PMFBPA");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.pm_fbpa);
 		break;
 	case NETLIST_REGIONID_NVPERF_SYS_ROUTER:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_SYS_ROUTER");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.perf_sys_router);
 		break;
 	case NETLIST_REGIONID_NVPERF_PMA:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_PMA");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.perf_pma);
 		break;
 	case NETLIST_REGIONID_CTXREG_PMUCGPC:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PMUCGPC");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.pm_ucgpc);
 		break;
 	case NETLIST_REGIONID_NVPERF_PMCAU:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_PMCAU");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.pm_cau);
 		break;
 	case NETLIST_REGIONID_NVPERF_SYS_CONTROL:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_SYS_CONTROL");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.perf_sys_control);
 		break;
 	case NETLIST_REGIONID_NVPERF_FBP_CONTROL:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_FBP_CONTROL");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.perf_fbp_control);
 		break;
 	case NETLIST_REGIONID_NVPERF_GPC_CONTROL:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_GPC_CONTROL");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.perf_gpc_control);
 		break;
 	case NETLIST_REGIONID_NVPERF_PMA_CONTROL:
 		nvgpu_log_info(g, "NETLIST_REGIONID_NVPERF_PMA_CONTROL");
-		err = nvgpu_netlist_alloc_load_aiv_list(g,
+		err = nvgpu_netlist_load_aiv_list(g,
 			src, size, &netlist_vars->ctxsw_regs.perf_pma_control);
 		break;
 
 #if defined(CONFIG_NVGPU_NON_FUSA)
 	case NETLIST_REGIONID_CTXREG_SYS_COMPUTE:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_SYS_COMPUTE");
-		err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+		err = nvgpu_netlist_load_aiv_list(g, src, size,
 			&netlist_vars->ctxsw_regs.sys_compute);
 		break;
 
 	case NETLIST_REGIONID_CTXREG_GPC_COMPUTE:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_GPC_COMPUTE");
-		err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+		err = nvgpu_netlist_load_aiv_list(g, src, size,
 			&netlist_vars->ctxsw_regs.gpc_compute);
 		break;
 
 	case NETLIST_REGIONID_CTXREG_TPC_COMPUTE:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_TPC_COMPUTE");
-		err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+		err = nvgpu_netlist_load_aiv_list(g, src, size,
 			&netlist_vars->ctxsw_regs.tpc_compute);
 		break;
 
 	case NETLIST_REGIONID_CTXREG_PPC_COMPUTE:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PPC_COMPUTE");
-		err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+		err = nvgpu_netlist_load_aiv_list(g, src, size,
 			&netlist_vars->ctxsw_regs.ppc_compute);
 		break;
 
 	case NETLIST_REGIONID_CTXREG_ETPC_COMPUTE:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_ETPC_COMPUTE");
-		err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+		err = nvgpu_netlist_load_aiv_list(g, src, size,
 			&netlist_vars->ctxsw_regs.etpc_compute);
 		break;
 	case NETLIST_REGIONID_CTXREG_LTS_BC:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_LTS_BC");
-		err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+		err = nvgpu_netlist_load_aiv_list(g, src, size,
 			&netlist_vars->ctxsw_regs.lts_bc);
 		break;
 
 	case NETLIST_REGIONID_CTXREG_LTS_UC:
 		nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_LTS_UC");
-		err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+		err = nvgpu_netlist_load_aiv_list(g, src, size,
 			&netlist_vars->ctxsw_regs.lts_uc);
 		break;
 #endif
@@ -448,69 +511,69 @@ static bool nvgpu_netlist_handle_debugger_region_id(struct gk20a *g,
 		switch (region_id) {
 		case NETLIST_REGIONID_CTXREG_SYS:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_SYS");
-			err = nvgpu_netlist_alloc_load_aiv_list(g,
+			err = nvgpu_netlist_load_aiv_list(g,
 				src, size, &netlist_vars->ctxsw_regs.sys);
 			break;
 		case NETLIST_REGIONID_CTXREG_GPC:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_GPC");
-			err = nvgpu_netlist_alloc_load_aiv_list(g,
+			err = nvgpu_netlist_load_aiv_list(g,
 				src, size, &netlist_vars->ctxsw_regs.gpc);
 			break;
 		case NETLIST_REGIONID_CTXREG_TPC:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_TPC");
-			err = nvgpu_netlist_alloc_load_aiv_list(g,
+			err = nvgpu_netlist_load_aiv_list(g,
 				src, size, &netlist_vars->ctxsw_regs.tpc);
 			break;
 #ifdef CONFIG_NVGPU_GRAPHICS
 		case NETLIST_REGIONID_CTXREG_ZCULL_GPC:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_ZCULL_GPC");
-			err = nvgpu_netlist_alloc_load_aiv_list(g,
+			err = nvgpu_netlist_load_aiv_list(g,
 				src, size, &netlist_vars->ctxsw_regs.zcull_gpc);
 			break;
 		case NETLIST_REGIONID_CTXREG_SYS_GFX:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_SYS_GFX");
-			err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+			err = nvgpu_netlist_load_aiv_list(g, src, size,
 				&netlist_vars->ctxsw_regs.sys_gfx);
 			break;
 		case NETLIST_REGIONID_CTXREG_GPC_GFX:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_GPC_GFX");
-			err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+			err = nvgpu_netlist_load_aiv_list(g, src, size,
 				&netlist_vars->ctxsw_regs.gpc_gfx);
 			break;
 		case NETLIST_REGIONID_CTXREG_TPC_GFX:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_TPC_GFX");
-			err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+			err = nvgpu_netlist_load_aiv_list(g, src, size,
 				&netlist_vars->ctxsw_regs.tpc_gfx);
 			break;
 		case NETLIST_REGIONID_CTXREG_PPC_GFX:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PPC_GFX");
-			err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+			err = nvgpu_netlist_load_aiv_list(g, src, size,
 				&netlist_vars->ctxsw_regs.ppc_gfx);
 			break;
 		case NETLIST_REGIONID_CTXREG_ETPC_GFX:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_ETPC_GFX");
-			err = nvgpu_netlist_alloc_load_aiv_list(g, src, size,
+			err = nvgpu_netlist_load_aiv_list(g, src, size,
 				&netlist_vars->ctxsw_regs.etpc_gfx);
 			break;
 #endif
 		case NETLIST_REGIONID_CTXREG_PPC:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PPC");
-			err = nvgpu_netlist_alloc_load_aiv_list(g,
+			err = nvgpu_netlist_load_aiv_list(g,
 				src, size, &netlist_vars->ctxsw_regs.ppc);
 			break;
 		case NETLIST_REGIONID_CTXREG_PMPPC:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PMPPC");
-			err = nvgpu_netlist_alloc_load_aiv_list(g,
+			err = nvgpu_netlist_load_aiv_list(g,
 				src, size, &netlist_vars->ctxsw_regs.pm_ppc);
 			break;
 		case NETLIST_REGIONID_CTXREG_PMROP:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_PMROP");
-			err = nvgpu_netlist_alloc_load_aiv_list(g,
+			err = nvgpu_netlist_load_aiv_list(g,
 				src, size, &netlist_vars->ctxsw_regs.pm_rop);
 			break;
 		case NETLIST_REGIONID_CTXREG_ETPC:
 			nvgpu_log_info(g, "NETLIST_REGIONID_CTXREG_ETPC");
-			err = nvgpu_netlist_alloc_load_aiv_list(g,
+			err = nvgpu_netlist_load_aiv_list(g,
 				src, size, &netlist_vars->ctxsw_regs.etpc);
 			break;
 		default:
@@ -571,6 +634,189 @@ static bool nvgpu_netlist_is_valid(int net, u32 major_v, u32 major_v_hw)
 	return true;
 }
 
+/*
+ * Check that the region table and all regions lie within the image, and get
+ * the major version from the region table so that a slot built for another
+ * major version is skipped without parsing any of its regions.
+ */
+static int nvgpu_netlist_check_image(struct gk20a *g,
+			struct nvgpu_firmware *netlist_fw, u32 *major_v)
+{
+	struct netlist_image *netlist =
+		(struct netlist_image *)(uintptr_t)netlist_fw->data;
+	u64 table_size;
+	u32 i;
+
+	*major_v = ~U32(0U);
+
+	if (netlist_fw->size < sizeof(struct netlist_image_header)) {
+		nvgpu_err(g, "netlist image truncated: %zu bytes",
+			netlist_fw->size);
+		return -EINVAL;
+	}
+
+	table_size = nvgpu_safe_add_u64(sizeof(struct netlist_image_header),
+			nvgpu_safe_mult_u64(netlist->header.regions,
+				sizeof(struct netlist_region)));
+	if (table_size > netlist_fw->size) {
+		nvgpu_err(g, "netlist region table truncated: %u regions",
+			netlist->header.regions);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < netlist->header.regions; i++) {
+		struct netlist_region *region = &netlist->regions[i];
+
+		if (nvgpu_safe_add_u64(region->data_offset,
+				region->data_size) > netlist_fw->size) {
+			nvgpu_err(g, "netlist region %u out of bounds",
+				region->region_id);
+			return -EINVAL;
+		}
+
+		if ((region->region_id == NETLIST_REGIONID_MAJORV) &&
+				(region->data_size >= sizeof(u32))) {
+			nvgpu_memcpy((u8 *)major_v,
+				(u8 *)netlist + region->data_offset,
+				sizeof(u32));
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Free the lists that were copied out of the image, release the image the
+ * other lists point into, and forget all of them.
+ */
+static void nvgpu_netlist_free_lists(struct gk20a *g,
+			struct nvgpu_netlist_vars *netlist_vars)
+{
+	bool dynamic = netlist_vars->dynamic;
+
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ucode.fecs.inst.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ucode.fecs.data.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ucode.gpccs.inst.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ucode.gpccs.data.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_bundle_init.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_bundle64_init.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_veid_bundle_init.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_method_init.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_ctx_load.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_non_ctx_load.l);
+#if defined(CONFIG_NVGPU_NON_FUSA)
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_non_ctx_local_compute_load.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_non_ctx_global_compute_load.l);
+#ifdef CONFIG_NVGPU_GRAPHICS
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_non_ctx_local_gfx_load.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->sw_non_ctx_global_gfx_load.l);
+#endif
+#endif
+#ifdef CONFIG_NVGPU_DEBUGGER
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.sys.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.gpc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.tpc.l);
+#ifdef CONFIG_NVGPU_GRAPHICS
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.zcull_gpc.l);
+#endif
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.ppc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_sys.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_gpc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_tpc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_ppc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.perf_sys.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.fbp.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.perf_gpc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.fbp_router.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.gpc_router.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_ltc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_fbpa.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.perf_sys_router.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.perf_pma.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_rop.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_ucgpc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.etpc.l);
+#if defined(CONFIG_NVGPU_NON_FUSA)
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.sys_compute.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.gpc_compute.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.tpc_compute.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.ppc_compute.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.etpc_compute.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.lts_bc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.lts_uc.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.sys_gfx.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.gpc_gfx.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.tpc_gfx.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.ppc_gfx.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.etpc_gfx.l);
+#endif
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.pm_cau.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.perf_sys_control.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.perf_fbp_control.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.perf_gpc_control.l);
+	nvgpu_netlist_free_list(g, netlist_vars,
+			netlist_vars->ctxsw_regs.perf_pma_control.l);
+#endif /* CONFIG_NVGPU_DEBUGGER */
+
+	if (netlist_vars->fw != NULL) {
+		nvgpu_release_firmware(g, netlist_vars->fw);
+	}
+
+	(void) memset(netlist_vars, 0, sizeof(*netlist_vars));
+	netlist_vars->dynamic = dynamic;
+}
+
 static int nvgpu_netlist_init_ctx_vars_fw(struct gk20a *g)
 {
 	struct nvgpu_netlist_vars *netlist_vars = g->netlist_vars;
@@ -607,6 +853,21 @@ static int nvgpu_netlist_init_ctx_vars_fw(struct gk20a *g)
 			continue;
 		}
 
+		if (nvgpu_netlist_check_image(g, netlist_fw, &major_v) != 0) {
+			nvgpu_warn(g, "invalid netlist %s", name);
+			nvgpu_release_firmware(g, netlist_fw);
+			continue;
+		}
+
+		if (!nvgpu_netlist_is_valid(net, major_v, major_v_hw)) {
+			nvgpu_log_info(g, "skip %s: major_v 0x%08x doesn't match hw 0x%08x",
+				name, major_v, major_v_hw);
+			nvgpu_release_firmware(g, netlist_fw);
+			continue;
+		}
+
+		/* The lists point into the image until it is released */
+		netlist_vars->fw = netlist_fw;
 		netlist = (struct netlist_image *)(uintptr_t)netlist_fw->data;
 
 		for (i = 0; i < netlist->header.regions; i++) {
@@ -622,83 +883,14 @@ static int nvgpu_netlist_init_ctx_vars_fw(struct gk20a *g)
 			}
 		}
 
-		if (!nvgpu_netlist_is_valid(net, major_v, major_v_hw)) {
-			nvgpu_log_info(g, "skip %s: major_v 0x%08x doesn't match hw 0x%08x",
-				name, major_v, major_v_hw);
-			goto clean_up;
-		}
-
 		g->netlist_valid = true;
 
-		nvgpu_release_firmware(g, netlist_fw);
 		nvgpu_log_fn(g, "done");
 		goto done;
 
 clean_up:
 		g->netlist_valid = false;
-		nvgpu_kfree(g, netlist_vars->ucode.fecs.inst.l);
-		nvgpu_kfree(g, netlist_vars->ucode.fecs.data.l);
-		nvgpu_kfree(g, netlist_vars->ucode.gpccs.inst.l);
-		nvgpu_kfree(g, netlist_vars->ucode.gpccs.data.l);
-		nvgpu_kfree(g, netlist_vars->sw_bundle_init.l);
-		nvgpu_kfree(g, netlist_vars->sw_bundle64_init.l);
-		nvgpu_kfree(g, netlist_vars->sw_veid_bundle_init.l);
-		nvgpu_kfree(g, netlist_vars->sw_method_init.l);
-		nvgpu_kfree(g, netlist_vars->sw_ctx_load.l);
-		nvgpu_kfree(g, netlist_vars->sw_non_ctx_load.l);
-#if defined(CONFIG_NVGPU_NON_FUSA)
-		nvgpu_kfree(g, netlist_vars->sw_non_ctx_local_compute_load.l);
-		nvgpu_kfree(g, netlist_vars->sw_non_ctx_global_compute_load.l);
-#ifdef CONFIG_NVGPU_GRAPHICS
-		nvgpu_kfree(g, netlist_vars->sw_non_ctx_local_gfx_load.l);
-		nvgpu_kfree(g, netlist_vars->sw_non_ctx_global_gfx_load.l);
-#endif
-#endif
-#ifdef CONFIG_NVGPU_DEBUGGER
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.sys.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.gpc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.tpc.l);
-#ifdef CONFIG_NVGPU_GRAPHICS
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.zcull_gpc.l);
-#endif
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.ppc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_sys.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_gpc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_tpc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_ppc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_sys.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.fbp.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_gpc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.fbp_router.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.gpc_router.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_ltc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_fbpa.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_sys_router.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_pma.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_rop.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_ucgpc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.etpc.l);
-#if defined(CONFIG_NVGPU_NON_FUSA)
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.sys_compute.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.gpc_compute.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.tpc_compute.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.ppc_compute.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.etpc_compute.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.lts_bc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.lts_uc.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.sys_gfx.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.gpc_gfx.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.tpc_gfx.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.ppc_gfx.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.etpc_gfx.l);
-#endif
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_cau.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_sys_control.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_fbp_control.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_gpc_control.l);
-		nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_pma_control.l);
-#endif /* CONFIG_NVGPU_DEBUGGER */
-		nvgpu_release_firmware(g, netlist_fw);
+		nvgpu_netlist_free_lists(g, netlist_vars);
 		err = -ENOENT;
 	}
 
@@ -755,69 +947,7 @@ void nvgpu_netlist_deinit_ctx_vars(struct gk20a *g)
 	}
 
 	g->netlist_valid = false;
-	nvgpu_kfree(g, netlist_vars->ucode.fecs.inst.l);
-	nvgpu_kfree(g, netlist_vars->ucode.fecs.data.l);
-	nvgpu_kfree(g, netlist_vars->ucode.gpccs.inst.l);
-	nvgpu_kfree(g, netlist_vars->ucode.gpccs.data.l);
-	nvgpu_kfree(g, netlist_vars->sw_bundle_init.l);
-	nvgpu_kfree(g, netlist_vars->sw_bundle64_init.l);
-	nvgpu_kfree(g, netlist_vars->sw_veid_bundle_init.l);
-	nvgpu_kfree(g, netlist_vars->sw_method_init.l);
-	nvgpu_kfree(g, netlist_vars->sw_ctx_load.l);
-	nvgpu_kfree(g, netlist_vars->sw_non_ctx_load.l);
-#if defined(CONFIG_NVGPU_NON_FUSA)
-	nvgpu_kfree(g, netlist_vars->sw_non_ctx_local_compute_load.l);
-	nvgpu_kfree(g, netlist_vars->sw_non_ctx_global_compute_load.l);
-#ifdef CONFIG_NVGPU_GRAPHICS
-	nvgpu_kfree(g, netlist_vars->sw_non_ctx_local_gfx_load.l);
-	nvgpu_kfree(g, netlist_vars->sw_non_ctx_global_gfx_load.l);
-#endif
-#endif
-#ifdef CONFIG_NVGPU_DEBUGGER
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.sys.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.gpc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.tpc.l);
-#ifdef CONFIG_NVGPU_GRAPHICS
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.zcull_gpc.l);
-#endif
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.ppc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_sys.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_gpc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_tpc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_ppc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_sys.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.fbp.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_gpc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.fbp_router.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.gpc_router.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_ltc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_fbpa.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_sys_router.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_pma.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_rop.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_ucgpc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.etpc.l);
-
-#if defined(CONFIG_NVGPU_NON_FUSA)
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.sys_compute.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.gpc_compute.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.tpc_compute.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.ppc_compute.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.etpc_compute.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.lts_bc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.lts_uc.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.sys_gfx.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.gpc_gfx.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.tpc_gfx.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.ppc_gfx.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.etpc_gfx.l);
-#endif
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.pm_cau.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_sys_control.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_fbp_control.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_gpc_control.l);
-	nvgpu_kfree(g, netlist_vars->ctxsw_regs.perf_pma_control.l);
-#endif /* CONFIG_NVGPU_DEBUGGER */
+	nvgpu_netlist_free_lists(g, netlist_vars);
 
 	nvgpu_kfree(g, netlist_vars);
 	g->netlist_vars = NULL;
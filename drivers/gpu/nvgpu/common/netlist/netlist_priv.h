@@ -29,6 +29,7 @@ struct netlist_u32_list;
 struct netlist_av_list;
 struct netlist_av64_list;
 struct netlist_aiv_list;
+struct nvgpu_firmware;
 
 /* netlist regions */
 #define NETLIST_REGIONID_FECS_UCODE_DATA	0
@@ -126,6 +127,13 @@ struct netlist_gr_ucode {
 struct nvgpu_netlist_vars {
 	bool dynamic;
 
+	/*
+	 * Netlist image kept resident after a successful load. Lists for
+	 * regions that could be used in place point into it; NULL for
+	 * netlists that were not loaded from firmware.
+	 */
+	struct nvgpu_firmware *fw;
+
 	u32 regs_base_index;
 	u32 buffer_size;
 
@@ -107,10 +107,7 @@ static u64 nvgpu_nvs_tick(struct gk20a *g)
 		return 100 * NSEC_PER_MSEC;
 	}
 
-	nvs_domain = domain->parent->next;
-	if (nvs_domain == NULL) {
-		nvs_domain = g->scheduler->sched->domain_list->domains;
-	}
+	nvs_domain = nvs_domain_get_next(sched->sched, domain->parent);
 	timeslice = nvs_domain->timeslice_ns;
 
 	nvgpu_runlist_tick(g);
@@ -307,7 +304,7 @@ int nvgpu_nvs_add_domain(struct gk20a *g, const char *name, u64 timeslice,
 	nvgpu_dom->id = nvgpu_nvs_new_id(g);
 	nvgpu_dom->ref = 1U;
 
-	nvs_dom = nvs_domain_create(g->scheduler->sched, name,
+	nvs_dom = nvs_domain_create(g->scheduler->sched, nvgpu_dom->id, name,
 				    timeslice, preempt_grace, nvgpu_dom);
 
 	if (nvs_dom == NULL) {
@@ -346,15 +343,12 @@ nvgpu_nvs_domain_by_id_locked(struct gk20a *g, u64 domain_id)
 
 	nvgpu_log(g, gpu_dbg_nvs, "lookup %llu", domain_id);
 
-	nvs_domain_for_each(sched->sched, nvs_dom) {
-		struct nvgpu_nvs_domain *nvgpu_dom = nvs_dom->priv;
-
-		if (nvgpu_dom->id == domain_id) {
-			return nvgpu_dom;
-		}
+	nvs_dom = nvs_domain_by_id(sched->sched, domain_id);
+	if (nvs_dom == NULL) {
+		return NULL;
 	}
 
-	return NULL;
+	return nvs_dom->priv;
 }
 
 struct nvgpu_nvs_domain *
@@ -464,10 +458,7 @@ int nvgpu_nvs_del_domain(struct gk20a *g, u64 dom_id)
 
 	/* note: same wraparound logic as in RL domains to keep in sync */
 	if (s->active_domain == nvgpu_dom) {
-		nvs_next = nvs_dom->next;
-		if (nvs_next == NULL) {
-			nvs_next = s->sched->domain_list->domains;
-		}
+		nvs_next = nvs_domain_get_next(s->sched, nvs_dom);
 		s->active_domain = nvs_next->priv;
 	}
 
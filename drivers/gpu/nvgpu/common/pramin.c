@@ -27,6 +27,8 @@
 #include <nvgpu/io.h>
 #include <nvgpu/gk20a.h>
 #include <nvgpu/bug.h>
+#include <nvgpu/kmem.h>
+#include <nvgpu/static_analysis.h>
 
 /*
  * This typedef is for functions that get called during the access_batched()
@@ -35,6 +37,133 @@
 typedef void (*pramin_access_batch_fn)(struct gk20a *g, u64 start, u64 words,
 				       u32 **arg);
 
+/*
+ * Allocations with more chunks than this get a chunk index on their first
+ * PRAMIN access that misses the cursor. Below it a walk is cheap enough.
+ */
+#define NVGPU_PRAMIN_CHUNK_INDEX_MIN	16
+
+static void nvgpu_pramin_build_chunk_index(struct gk20a *g,
+					   struct nvgpu_page_alloc *alloc)
+{
+	struct nvgpu_sgt *sgt = &alloc->sgt;
+	struct nvgpu_page_alloc_chunk *index;
+	void *sgl;
+	u64 offset = 0ULL;
+	int i = 0;
+
+	index = nvgpu_kmalloc(g, sizeof(*index) * (size_t)alloc->nr_chunks);
+	if (index == NULL) {
+		/* Not fatal: lookups fall back to walking the SGL list. */
+		return;
+	}
+
+	nvgpu_sgt_for_each_sgl(sgl, sgt) {
+		if (i == alloc->nr_chunks) {
+			break;
+		}
+		index[i].offset = offset;
+		index[i].sgl = sgl;
+		offset = nvgpu_safe_add_u64(offset,
+				nvgpu_sgt_get_length(sgt, sgl));
+		i++;
+	}
+
+	if (i != alloc->nr_chunks) {
+		nvgpu_kfree(g, index);
+		return;
+	}
+
+	alloc->chunk_index = index;
+}
+
+/*
+ * Find the SGL holding byte @offset of @alloc and turn @offset into an offset
+ * within that SGL. The cursor left by the previous access (or the chunk right
+ * after it) covers sequential access; anything else uses a binary search of
+ * the chunk index, or a walk from the start for allocations with few chunks.
+ *
+ * Must be called with mm.pramin_window_lock held.
+ */
+static void *nvgpu_pramin_find_sgl(struct gk20a *g,
+				   struct nvgpu_page_alloc *alloc, u64 *offset)
+{
+	struct nvgpu_sgt *sgt = &alloc->sgt;
+	void *sgl = alloc->pramin_sgl;
+	u64 off = *offset;
+
+	if ((sgl != NULL) && (off >= alloc->pramin_sgl_offset)) {
+		u64 start = alloc->pramin_sgl_offset;
+		u64 end = nvgpu_safe_add_u64(start,
+				nvgpu_sgt_get_length(sgt, sgl));
+
+		if (off < end) {
+			*offset = off - start;
+			return sgl;
+		}
+
+		sgl = nvgpu_sgt_get_next(sgt, sgl);
+		if ((sgl != NULL) && (off < nvgpu_safe_add_u64(end,
+				nvgpu_sgt_get_length(sgt, sgl)))) {
+			alloc->pramin_sgl = sgl;
+			alloc->pramin_sgl_offset = end;
+			*offset = off - end;
+			return sgl;
+		}
+	}
+
+	if ((alloc->chunk_index == NULL) &&
+	    (alloc->nr_chunks > NVGPU_PRAMIN_CHUNK_INDEX_MIN)) {
+		nvgpu_pramin_build_chunk_index(g, alloc);
+	}
+
+	if (alloc->chunk_index != NULL) {
+		struct nvgpu_page_alloc_chunk *index = alloc->chunk_index;
+		int lo = 0;
+		int hi = alloc->nr_chunks - 1;
+
+		/* Last chunk starting at or before off. */
+		while (lo < hi) {
+			int mid = hi - ((hi - lo) / 2);
+
+			if (index[mid].offset <= off) {
+				lo = mid;
+			} else {
+				hi = mid - 1;
+			}
+		}
+
+		sgl = index[lo].sgl;
+		off -= index[lo].offset;
+		if (off >= nvgpu_sgt_get_length(sgt, sgl)) {
+			/* Past the end of the allocation. */
+			return NULL;
+		}
+
+		alloc->pramin_sgl = sgl;
+		alloc->pramin_sgl_offset = index[lo].offset;
+		*offset = off;
+		return sgl;
+	}
+
+	alloc->pramin_sgl_offset = 0ULL;
+	nvgpu_sgt_for_each_sgl(sgl, sgt) {
+		u64 len = nvgpu_sgt_get_length(sgt, sgl);
+
+		if (off >= len) {
+			off -= len;
+			alloc->pramin_sgl_offset = nvgpu_safe_add_u64(
+					alloc->pramin_sgl_offset, len);
+		} else {
+			break;
+		}
+	}
+
+	alloc->pramin_sgl = sgl;
+	*offset = off;
+	return sgl;
+}
+
 /*
  * The PRAMIN range is 1 MB, must change base addr if a buffer crosses that.
  * This same loop is used for read/write/memset. Offset and size in bytes.
@@ -47,6 +176,7 @@ static void nvgpu_pramin_access_batched(struct gk20a *g, struct nvgpu_mem *mem,
 	struct nvgpu_sgt *sgt;
 	void *sgl;
 	u64 byteoff, start_reg, until_end, n;
+	u64 sgl_start;
 
 	/*
 	 * TODO: Vidmem is not accesible through pramin on shutdown path.
@@ -60,16 +190,10 @@ static void nvgpu_pramin_access_batched(struct gk20a *g, struct nvgpu_mem *mem,
 	alloc = mem->vidmem_alloc;
 	sgt = &alloc->sgt;
 
-	nvgpu_sgt_for_each_sgl(sgl, sgt) {
-		if (offset >= nvgpu_sgt_get_length(sgt, sgl)) {
-			u64 tmp_offset = nvgpu_sgt_get_length(sgt, sgl);
-
-			nvgpu_assert(tmp_offset <= offset);
-			offset -= tmp_offset;
-		} else {
-			break;
-		}
-	}
+	nvgpu_mutex_acquire(&g->mm.pramin_window_lock);
+	sgl = nvgpu_pramin_find_sgl(g, alloc, &offset);
+	sgl_start = alloc->pramin_sgl_offset;
+	nvgpu_mutex_release(&g->mm.pramin_window_lock);
 
 	while (size != 0U) {
 		u64 sgl_len;
@@ -78,6 +202,8 @@ static void nvgpu_pramin_access_batched(struct gk20a *g, struct nvgpu_mem *mem,
 		sgl_len = nvgpu_sgt_get_length(sgt, sgl);
 
 		nvgpu_mutex_acquire(&g->mm.pramin_window_lock);
+		alloc->pramin_sgl = sgl;
+		alloc->pramin_sgl_offset = sgl_start;
 		byteoff = g->ops.bus.set_bar0_window(g, mem, sgt, sgl,
 					      offset / sizeof(u32));
 		start_reg = g->ops.pramin.data032_r(byteoff / sizeof(u32));
@@ -96,6 +222,7 @@ static void nvgpu_pramin_access_batched(struct gk20a *g, struct nvgpu_mem *mem,
 
 		if (n == (sgl_len - offset)) {
 			sgl = nvgpu_sgt_get_next(sgt, sgl);
+			sgl_start += sgl_len;
 			offset = 0;
 		} else {
 			offset += n;
@@ -26,6 +26,9 @@
 #include <nvgpu/bsearch.h>
 #include <nvgpu/bug.h>
 #include <nvgpu/io.h>
+#include <nvgpu/kmem.h>
+#include <nvgpu/bitops.h>
+#include <nvgpu/static_analysis.h>
 #include <nvgpu/gk20a.h>
 #include <nvgpu/regops.h>
 #include <nvgpu/gr/gr_instances.h>
@@ -62,6 +65,193 @@ static inline bool linear_search(u32 offset, const u32 *list, u64 size)
 	return false;
 }
 
+/*
+ * Allowlist built at init from the global, context and runcontrol lists of
+ * the chip, so that an offset is checked with a few loads instead of up to
+ * two binary searches and a linear search. Regops offsets are 24 bit, so the
+ * directory covers 4096 pages of 4 KB of registers and keeps one bit per
+ * register and list for pages with at least one allowed register.
+ */
+#define REGOPS_ALLOWLIST_OFFSET_LIMIT	BIT32(24U)
+#define REGOPS_ALLOWLIST_PAGE_SHIFT	12U
+#define REGOPS_ALLOWLIST_NUM_PAGES	\
+	(REGOPS_ALLOWLIST_OFFSET_LIMIT >> REGOPS_ALLOWLIST_PAGE_SHIFT)
+#define REGOPS_ALLOWLIST_PAGE_REGS	\
+	(BIT32(REGOPS_ALLOWLIST_PAGE_SHIFT) / U32(sizeof(u32)))
+
+#define REGOPS_ALLOWLIST_GLOBAL		0U
+#define REGOPS_ALLOWLIST_CONTEXT	1U
+#define REGOPS_ALLOWLIST_RUNCONTROL	2U
+#define REGOPS_ALLOWLIST_NUM_LISTS	3U
+
+/* Page index of a page that is in use before the pages are allocated */
+#define REGOPS_ALLOWLIST_PAGE_USED	U16_MAX
+
+struct nvgpu_regops_allowlist_page {
+	DECLARE_BITMAP(map[REGOPS_ALLOWLIST_NUM_LISTS],
+		       REGOPS_ALLOWLIST_PAGE_REGS);
+};
+
+struct nvgpu_regops_allowlist {
+	/* Index + 1 in pages of each page of registers, 0 if none allowed */
+	u16 page_index[REGOPS_ALLOWLIST_NUM_PAGES];
+	u32 num_pages;
+	struct nvgpu_regops_allowlist_page *pages;
+};
+
+static void regops_allowlist_add(struct nvgpu_regops_allowlist *allowlist,
+				 u32 list, u32 base, u32 count)
+{
+	struct nvgpu_regops_allowlist_page *page;
+	u32 i, offset, page_nr;
+
+	for (i = 0U; i < count; i++) {
+		offset = nvgpu_safe_add_u32(base, i * U32(sizeof(u32)));
+		if (offset >= REGOPS_ALLOWLIST_OFFSET_LIMIT) {
+			break;
+		}
+
+		page_nr = offset >> REGOPS_ALLOWLIST_PAGE_SHIFT;
+		if (allowlist->pages == NULL) {
+			allowlist->page_index[page_nr] =
+				REGOPS_ALLOWLIST_PAGE_USED;
+			continue;
+		}
+
+		page = &allowlist->pages[allowlist->page_index[page_nr] - 1U];
+		nvgpu_set_bit((offset & (BIT32(REGOPS_ALLOWLIST_PAGE_SHIFT) -
+					1U)) / U32(sizeof(u32)),
+			      page->map[list]);
+	}
+}
+
+/*
+ * Called twice: first to find the pages in use, then to set the bits once
+ * the pages are allocated.
+ */
+static void regops_allowlist_add_lists(struct gk20a *g,
+				       struct nvgpu_regops_allowlist *allowlist)
+{
+	const struct regop_offset_range *ranges;
+	const u32 *offsets;
+	u64 i, count;
+
+	if (g->ops.regops.get_global_whitelist_ranges != NULL) {
+		ranges = g->ops.regops.get_global_whitelist_ranges();
+		count = g->ops.regops.get_global_whitelist_ranges_count();
+		for (i = 0U; i < count; i++) {
+			regops_allowlist_add(allowlist, REGOPS_ALLOWLIST_GLOBAL,
+					     ranges[i].base, ranges[i].count);
+		}
+	}
+
+	if (g->ops.regops.get_context_whitelist_ranges != NULL) {
+		ranges = g->ops.regops.get_context_whitelist_ranges();
+		count = g->ops.regops.get_context_whitelist_ranges_count();
+		for (i = 0U; i < count; i++) {
+			regops_allowlist_add(allowlist, REGOPS_ALLOWLIST_CONTEXT,
+					     ranges[i].base, ranges[i].count);
+		}
+	}
+
+	if (g->ops.regops.get_runcontrol_whitelist != NULL) {
+		offsets = g->ops.regops.get_runcontrol_whitelist();
+		count = g->ops.regops.get_runcontrol_whitelist_count();
+		for (i = 0U; i < count; i++) {
+			regops_allowlist_add(allowlist,
+					     REGOPS_ALLOWLIST_RUNCONTROL,
+					     offsets[i], 1U);
+		}
+	}
+}
+
+int nvgpu_regops_allowlist_init(struct gk20a *g)
+{
+	struct nvgpu_regops_allowlist *allowlist;
+	u32 i;
+
+	if (g->regops_allowlist != NULL) {
+		return 0;
+	}
+
+	allowlist = nvgpu_vzalloc(g, sizeof(*allowlist));
+	if (allowlist == NULL) {
+		return -ENOMEM;
+	}
+
+	regops_allowlist_add_lists(g, allowlist);
+
+	for (i = 0U; i < REGOPS_ALLOWLIST_NUM_PAGES; i++) {
+		if (allowlist->page_index[i] == REGOPS_ALLOWLIST_PAGE_USED) {
+			allowlist->num_pages = nvgpu_safe_add_u32(
+					allowlist->num_pages, 1U);
+			allowlist->page_index[i] =
+				nvgpu_safe_cast_u32_to_u16(allowlist->num_pages);
+		}
+	}
+
+	if (allowlist->num_pages != 0U) {
+		allowlist->pages = nvgpu_vzalloc(g,
+				nvgpu_safe_mult_u64(allowlist->num_pages,
+						    sizeof(*allowlist->pages)));
+		if (allowlist->pages == NULL) {
+			nvgpu_vfree(g, allowlist);
+			return -ENOMEM;
+		}
+
+		regops_allowlist_add_lists(g, allowlist);
+	}
+
+	nvgpu_log(g, gpu_dbg_gpu_dbg, "regops allowlist: %u pages",
+		  allowlist->num_pages);
+
+	g->regops_allowlist = allowlist;
+
+	return 0;
+}
+
+void nvgpu_regops_allowlist_deinit(struct gk20a *g)
+{
+	struct nvgpu_regops_allowlist *allowlist = g->regops_allowlist;
+
+	if (allowlist == NULL) {
+		return;
+	}
+
+	nvgpu_vfree(g, allowlist->pages);
+	nvgpu_vfree(g, allowlist);
+	g->regops_allowlist = NULL;
+}
+
+/* Bit mask of the lists that allow offset */
+static u32 regops_allowlist_lookup(
+			const struct nvgpu_regops_allowlist *allowlist,
+			u32 offset)
+{
+	const struct nvgpu_regops_allowlist_page *page;
+	u32 index, bit, list, lists = 0U;
+
+	if (offset >= REGOPS_ALLOWLIST_OFFSET_LIMIT) {
+		return 0U;
+	}
+
+	index = allowlist->page_index[offset >> REGOPS_ALLOWLIST_PAGE_SHIFT];
+	if (index == 0U) {
+		return 0U;
+	}
+
+	page = &allowlist->pages[index - 1U];
+	bit = (offset & (BIT32(REGOPS_ALLOWLIST_PAGE_SHIFT) - 1U)) /
+		U32(sizeof(u32));
+	for (list = 0U; list < REGOPS_ALLOWLIST_NUM_LISTS; list++) {
+		if (nvgpu_test_bit(bit, page->map[list])) {
+			lists |= BIT32(list);
+		}
+	}
+
+	return lists;
+}
+
 /*
  * In order to perform a context relative op the context has
  * to be created already... which would imply that the
@@ -100,6 +290,7 @@ int exec_regops_gk20a(struct gk20a *g,
 	unsigned int i;
 	u32 data32_lo = 0, data32_hi = 0;
 	bool skip_read_lo, skip_read_hi;
+	bool log_ops = nvgpu_log_mask_enabled(g, gpu_dbg_gpu_dbg);
 
 	nvgpu_log(g, gpu_dbg_fn | gpu_dbg_gpu_dbg, " ");
 
@@ -131,8 +322,11 @@ int exec_regops_gk20a(struct gk20a *g,
 		case REGOP(READ_32):
 			ops[i].value_hi = 0;
 			ops[i].value_lo = gk20a_readl(g, ops[i].offset);
-			nvgpu_log(g, gpu_dbg_gpu_dbg, "read_32 0x%08x from 0x%08x",
-				   ops[i].value_lo, ops[i].offset);
+			if (log_ops) {
+				nvgpu_log(g, gpu_dbg_gpu_dbg,
+					"read_32 0x%08x from 0x%08x",
+					ops[i].value_lo, ops[i].offset);
+			}
 
 			break;
 
@@ -141,9 +335,12 @@ int exec_regops_gk20a(struct gk20a *g,
 			ops[i].value_hi =
 				gk20a_readl(g, ops[i].offset + 4U);
 
-			nvgpu_log(g, gpu_dbg_gpu_dbg, "read_64 0x%08x:%08x from 0x%08x",
-				   ops[i].value_hi, ops[i].value_lo,
-				   ops[i].offset);
+			if (log_ops) {
+				nvgpu_log(g, gpu_dbg_gpu_dbg,
+					"read_64 0x%08x:%08x from 0x%08x",
+					ops[i].value_hi, ops[i].value_lo,
+					ops[i].offset);
+			}
 		break;
 
 		case REGOP(WRITE_32):
@@ -180,14 +377,19 @@ int exec_regops_gk20a(struct gk20a *g,
 
 			/* now update first 32bits */
 			gk20a_writel(g, ops[i].offset, data32_lo);
-			nvgpu_log(g, gpu_dbg_gpu_dbg, "Wrote 0x%08x to 0x%08x ",
-				   data32_lo, ops[i].offset);
+			if (log_ops) {
+				nvgpu_log(g, gpu_dbg_gpu_dbg,
+					"Wrote 0x%08x to 0x%08x ",
+					data32_lo, ops[i].offset);
+			}
 			/* if desired, update second 32bits */
 			if (ops[i].op == REGOP(WRITE_64)) {
 				gk20a_writel(g, ops[i].offset + 4U, data32_hi);
-				nvgpu_log(g, gpu_dbg_gpu_dbg, "Wrote 0x%08x to 0x%08x ",
-					   data32_hi, ops[i].offset + 4U);
-
+				if (log_ops) {
+					nvgpu_log(g, gpu_dbg_gpu_dbg,
+						"Wrote 0x%08x to 0x%08x ",
+						data32_hi, ops[i].offset + 4U);
+				}
 			}
 
 
@@ -471,6 +673,31 @@ static int validate_reg_op_info(struct nvgpu_dbg_reg_op *op)
 	return err;
 }
 
+/* Same rules as the list searches in check_whitelists() */
+static bool check_allowlist(const struct nvgpu_regops_allowlist *allowlist,
+			    struct nvgpu_dbg_reg_op *op,
+			    u32 offset,
+			    bool valid_ctx)
+{
+	u32 lists = regops_allowlist_lookup(allowlist, offset);
+	u32 ctx_lists = BIT32(REGOPS_ALLOWLIST_RUNCONTROL);
+
+	if (op->type == REGOP(TYPE_GLOBAL)) {
+		if ((lists & BIT32(REGOPS_ALLOWLIST_GLOBAL)) != 0U) {
+			return true;
+		}
+		ctx_lists |= BIT32(REGOPS_ALLOWLIST_CONTEXT);
+	} else if (op->type == REGOP(TYPE_GR_CTX)) {
+		if ((lists & BIT32(REGOPS_ALLOWLIST_CONTEXT)) != 0U) {
+			return true;
+		}
+	} else {
+		return false;
+	}
+
+	return valid_ctx && ((lists & ctx_lists) != 0U);
+}
+
 static bool check_whitelists(struct gk20a *g,
 			     struct nvgpu_dbg_reg_op *op,
 			     u32 offset,
@@ -478,6 +705,11 @@ static bool check_whitelists(struct gk20a *g,
 {
 	bool valid = false;
 
+	if (g->regops_allowlist != NULL) {
+		return check_allowlist(g->regops_allowlist, op, offset,
+				       valid_ctx);
+	}
+
 	if (op->type == REGOP(TYPE_GLOBAL)) {
 		/* search global list */
 		valid = (g->ops.regops.get_global_whitelist_ranges != NULL) &&
@@ -709,7 +941,14 @@ static bool validate_reg_ops(struct gk20a *g,
 /* exported for tools like cyclestats, etc */
 bool is_bar0_global_offset_whitelisted_gk20a(struct gk20a *g, u32 offset)
 {
-	bool valid = nvgpu_bsearch(&offset,
+	bool valid;
+
+	if (g->regops_allowlist != NULL) {
+		return (regops_allowlist_lookup(g->regops_allowlist, offset) &
+			BIT32(REGOPS_ALLOWLIST_GLOBAL)) != 0U;
+	}
+
+	valid = nvgpu_bsearch(&offset,
 			g->ops.regops.get_global_whitelist_ranges(),
 			g->ops.regops.get_global_whitelist_ranges_count(),
 			sizeof(*g->ops.regops.get_global_whitelist_ranges()),
@@ -52,6 +52,40 @@ struct nvgpu_channel_sync *nvgpu_channel_sync_create(struct nvgpu_channel *c)
 	}
 }
 
+static void channel_sync_swap_wait_pts(struct nvgpu_channel_sync_wait_pt *a,
+		struct nvgpu_channel_sync_wait_pt *b)
+{
+	struct nvgpu_channel_sync_wait_pt tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+u32 nvgpu_channel_sync_compact_wait_pts(struct nvgpu_channel_sync_wait_pt *pts,
+		u32 count)
+{
+	u32 kept = 0U;
+	u32 i, j;
+
+	/* Merged fences have tens of points at most; a linear scan will do. */
+	for (i = 0U; i < count; i++) {
+		for (j = 0U; j < kept; j++) {
+			if (pts[j].key == pts[i].key) {
+				break;
+			}
+		}
+
+		if (j == kept) {
+			channel_sync_swap_wait_pts(&pts[kept], &pts[i]);
+			kept++;
+		} else if ((s32)(pts[i].thresh - pts[j].thresh) > 0) {
+			channel_sync_swap_wait_pts(&pts[j], &pts[i]);
+		}
+	}
+
+	return kept;
+}
+
 bool nvgpu_channel_sync_needs_os_fence_framework(struct gk20a *g)
 {
 	return !nvgpu_has_syncpoints(g);
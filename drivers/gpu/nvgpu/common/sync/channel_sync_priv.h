@@ -78,6 +78,32 @@ struct nvgpu_channel_sync_ops {
 	void (*destroy)(struct nvgpu_channel_sync *s);
 };
 
+/*
+ * Pre-fence points up to this many are compacted in an array on the stack;
+ * larger fences allocate one.
+ */
+#define NVGPU_CHANNEL_SYNC_WAIT_PTS_ON_STACK	16U
+
+/*
+ * One point of a pre-fence: wait until the semaphore or syncpoint identified
+ * by key reaches thresh. priv is owned by the backend.
+ */
+struct nvgpu_channel_sync_wait_pt {
+	u64 key;
+	u32 thresh;
+	void *priv;
+};
+
+/*
+ * Collapse the points of a pre-fence that wait on the same key into the one
+ * with the latest threshold, compared with wraparound. The remaining points
+ * are moved to the start of pts in their original order and their number is
+ * returned; the points dropped end up in the rest of the array so that the
+ * caller can release their priv.
+ */
+u32 nvgpu_channel_sync_compact_wait_pts(struct nvgpu_channel_sync_wait_pt *pts,
+		u32 count);
+
 #endif /* CONFIG_NVGPU_KERNEL_MODE_SUBMIT */
 
 #endif /* NVGPU_CHANNEL_SYNC_PRIV_H */
@@ -74,20 +74,14 @@ static void add_sema_wait_cmd(struct gk20a *g, struct nvgpu_channel *c,
 }
 
 static void channel_sync_semaphore_gen_wait_cmd(struct nvgpu_channel *c,
-	struct nvgpu_semaphore *sema, struct priv_cmd_entry *wait_cmd,
-	u32 wait_cmd_size)
+	struct nvgpu_semaphore *sema, struct priv_cmd_entry *wait_cmd)
 {
 	bool has_incremented;
 
-	if (sema == NULL) {
-		/* came from an expired sync fence */
-		nvgpu_priv_cmdbuf_append_zeros(c->g, wait_cmd, wait_cmd_size);
-	} else {
-		has_incremented = nvgpu_semaphore_can_wait(sema);
-		nvgpu_assert(has_incremented);
-		add_sema_wait_cmd(c->g, c, sema, wait_cmd);
-		nvgpu_semaphore_put(sema);
-	}
+	has_incremented = nvgpu_semaphore_can_wait(sema);
+	nvgpu_assert(has_incremented);
+	add_sema_wait_cmd(c->g, c, sema, wait_cmd);
+	nvgpu_semaphore_put(sema);
 }
 #endif
 
@@ -124,8 +118,11 @@ static int channel_sync_semaphore_wait_fd(
 
 	struct nvgpu_os_fence os_fence = {0};
 	struct nvgpu_os_fence_sema os_fence_sema = {0};
+	struct nvgpu_channel_sync_wait_pt
+		stack_pts[NVGPU_CHANNEL_SYNC_WAIT_PTS_ON_STACK];
+	struct nvgpu_channel_sync_wait_pt *pts = stack_pts;
 	int err;
-	u32 wait_cmd_size, i, num_fences;
+	u32 wait_cmd_size, i, num_fences, num_pts = 0U, num_waits;
 	struct nvgpu_semaphore *semaphore = NULL;
 
 	err = nvgpu_os_fence_fdget(&os_fence, c, fd);
@@ -149,21 +146,60 @@ static int channel_sync_semaphore_wait_fd(
 		goto cleanup;
 	}
 
+	if (num_fences > NVGPU_CHANNEL_SYNC_WAIT_PTS_ON_STACK) {
+		pts = nvgpu_kmalloc(c->g, num_fences * sizeof(*pts));
+		if (pts == NULL) {
+			err = -ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	/* Waits for semaphores that were released already are no-ops. */
+	for (i = 0; i < num_fences; i++) {
+		nvgpu_os_fence_sema_extract_nth_semaphore(
+			&os_fence_sema, i, &semaphore);
+		if (semaphore == NULL) {
+			/* came from an expired sync fence */
+			continue;
+		}
+		if (nvgpu_semaphore_is_released(semaphore)) {
+			nvgpu_semaphore_put(semaphore);
+			continue;
+		}
+		pts[num_pts].key = nvgpu_semaphore_gpu_ro_va(semaphore);
+		pts[num_pts].thresh = nvgpu_semaphore_get_value(semaphore);
+		pts[num_pts].priv = semaphore;
+		num_pts++;
+	}
+
+	/* Only the latest threshold of each hw semaphore needs a wait. */
+	num_waits = nvgpu_channel_sync_compact_wait_pts(pts, num_pts);
+	for (i = num_waits; i < num_pts; i++) {
+		nvgpu_semaphore_put(pts[i].priv);
+	}
+
+	if (num_waits == 0U) {
+		goto cleanup;
+	}
+
 	wait_cmd_size = c->g->ops.sync.sema.get_wait_cmd_size();
 	err = nvgpu_priv_cmdbuf_alloc(c->priv_cmd_q,
-		wait_cmd_size * num_fences, entry);
+		wait_cmd_size * num_waits, entry);
 	if (err != 0) {
+		for (i = 0; i < num_waits; i++) {
+			nvgpu_semaphore_put(pts[i].priv);
+		}
 		goto cleanup;
 	}
 
-	for (i = 0; i < num_fences; i++) {
-		nvgpu_os_fence_sema_extract_nth_semaphore(
-			&os_fence_sema, i, &semaphore);
-		channel_sync_semaphore_gen_wait_cmd(c, semaphore, *entry,
-				wait_cmd_size);
+	for (i = 0; i < num_waits; i++) {
+		channel_sync_semaphore_gen_wait_cmd(c, pts[i].priv, *entry);
 	}
 
 cleanup:
+	if (pts != stack_pts) {
+		nvgpu_kfree(c->g, pts);
+	}
 	os_fence.ops->drop_ref(&os_fence);
 	return err;
 #else
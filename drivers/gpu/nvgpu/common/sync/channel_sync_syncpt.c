@@ -94,17 +94,33 @@ static int channel_sync_syncpt_wait_raw(struct nvgpu_channel_sync_syncpt *s,
 }
 
 #ifndef CONFIG_NVGPU_SYNCFD_NONE
-struct gen_wait_cmd_iter_data {
-	struct nvgpu_channel *c;
-	struct priv_cmd_entry *wait_cmd;
+struct collect_wait_pts_iter_data {
+	struct nvgpu_channel_sync_syncpt *sp;
+	struct nvgpu_channel_sync_wait_pt *pts;
+	u32 max_pts;
+	u32 num_pts;
 };
 
-static int gen_wait_cmd_iter(struct nvhost_ctrl_sync_fence_info info, void *d)
+static int collect_wait_pts_iter(struct nvhost_ctrl_sync_fence_info info,
+		void *d)
 {
-	struct gen_wait_cmd_iter_data *data = d;
+	struct collect_wait_pts_iter_data *data = d;
+
+	/* Waits for thresholds that were reached already are no-ops. */
+	if (nvgpu_nvhost_syncpt_is_expired_ext(data->sp->nvhost, info.id,
+			info.thresh)) {
+		return 0;
+	}
+
+	if (data->num_pts == data->max_pts) {
+		return -EINVAL;
+	}
+
+	data->pts[data->num_pts].key = info.id;
+	data->pts[data->num_pts].thresh = info.thresh;
+	data->pts[data->num_pts].priv = NULL;
+	data->num_pts++;
 
-	channel_sync_syncpt_gen_wait_cmd(data->c, info.id, info.thresh,
-			data->wait_cmd);
 	return 0;
 }
 
@@ -116,10 +132,15 @@ static int channel_sync_syncpt_wait_fd(struct nvgpu_channel_sync *s, int fd,
 	struct nvgpu_channel_sync_syncpt *sp =
 		nvgpu_channel_sync_syncpt_from_base(s);
 	struct nvgpu_channel *c = sp->c;
-	struct gen_wait_cmd_iter_data iter_data = {
-		.c = c
+	struct nvgpu_channel_sync_wait_pt
+		stack_pts[NVGPU_CHANNEL_SYNC_WAIT_PTS_ON_STACK];
+	struct collect_wait_pts_iter_data iter_data = {
+		.sp = sp,
+		.pts = stack_pts,
+		.max_pts = NVGPU_CHANNEL_SYNC_WAIT_PTS_ON_STACK,
+		.num_pts = 0U,
 	};
-	u32 num_fences, wait_cmd_size;
+	u32 num_fences, num_waits, wait_cmd_size, i;
 	int err = 0;
 
 	err = nvgpu_os_fence_fdget(&os_fence, c, fd);
@@ -143,19 +164,45 @@ static int channel_sync_syncpt_wait_fd(struct nvgpu_channel_sync *s, int fd,
 		goto cleanup;
 	}
 
+	if (num_fences > NVGPU_CHANNEL_SYNC_WAIT_PTS_ON_STACK) {
+		iter_data.pts = nvgpu_kmalloc(c->g,
+				num_fences * sizeof(*iter_data.pts));
+		if (iter_data.pts == NULL) {
+			err = -ENOMEM;
+			goto cleanup;
+		}
+		iter_data.max_pts = num_fences;
+	}
+
+	err = nvgpu_os_fence_syncpt_foreach_pt(&os_fence_syncpt,
+			collect_wait_pts_iter, &iter_data);
+	if (err != 0) {
+		goto cleanup;
+	}
+
+	/* Only the latest threshold of each syncpoint needs a wait. */
+	num_waits = nvgpu_channel_sync_compact_wait_pts(iter_data.pts,
+			iter_data.num_pts);
+	if (num_waits == 0U) {
+		goto cleanup;
+	}
+
 	wait_cmd_size = c->g->ops.sync.syncpt.get_wait_cmd_size();
 	err = nvgpu_priv_cmdbuf_alloc(c->priv_cmd_q,
-		wait_cmd_size * num_fences, wait_cmd);
+		wait_cmd_size * num_waits, wait_cmd);
 	if (err != 0) {
 		goto cleanup;
 	}
 
-	iter_data.wait_cmd = *wait_cmd;
-
-	nvgpu_os_fence_syncpt_foreach_pt(&os_fence_syncpt,
-			gen_wait_cmd_iter, &iter_data);
+	for (i = 0U; i < num_waits; i++) {
+		channel_sync_syncpt_gen_wait_cmd(c, (u32)iter_data.pts[i].key,
+				iter_data.pts[i].thresh, *wait_cmd);
+	}
 
 cleanup:
+	if (iter_data.pts != stack_pts) {
+		nvgpu_kfree(c->g, iter_data.pts);
+	}
 	os_fence.ops->drop_ref(&os_fence);
 	return err;
 }
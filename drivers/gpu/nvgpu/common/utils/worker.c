@@ -22,8 +22,10 @@
 
 #include <nvgpu/log.h>
 #include <nvgpu/bug.h>
+#include <nvgpu/kmem.h>
 #include <nvgpu/worker.h>
 #include <nvgpu/string.h>
+#include <nvgpu/static_analysis.h>
 
 static void nvgpu_worker_pre_process(struct nvgpu_worker *worker)
 {
@@ -81,67 +83,162 @@ static void nvgpu_worker_wakeup_post_process(
 }
 
 /**
- * Tell the worker that potentially more work needs to be done.
+ * Tell a queue's thread that potentially more work needs to be done.
  *
- * Increase the work counter to synchronize the worker with the new work. Wake
- * up the worker. If the worker was already running, it will handle this work
- * before going to sleep.
+ * Increase the work counter to synchronize the thread with the new work. The
+ * thread only needs a signal if it is not processing items right now: a busy
+ * thread checks the counter again after its current batch, and once more in
+ * its wait condition after clearing \a busy, so it cannot miss the increment.
  */
-static int nvgpu_worker_wakeup(struct nvgpu_worker *worker)
+static void nvgpu_worker_wakeup(nvgpu_atomic_t *put, nvgpu_atomic_t *busy,
+		struct nvgpu_cond *wq)
 {
-	int put;
-	struct gk20a *g = worker->g;
+	/* The increment is fully ordered against the read of busy. */
+	(void) nvgpu_atomic_inc_return(put);
 
-	nvgpu_log_fn(g, " ");
+	if (nvgpu_atomic_read(busy) == 0) {
+		nvgpu_cond_signal_interruptible(wq);
+	}
+}
 
-	put = nvgpu_atomic_inc_return(&worker->put);
-	nvgpu_cond_signal_interruptible(&worker->wq);
+static bool nvgpu_worker_pending(struct nvgpu_worker *worker, int get)
+{
+	return nvgpu_atomic_read(&worker->put) != get;
+}
 
-	return put;
+/*
+ * Work queues are lock-free stacks of work items linked through the next
+ * pointer of the item's list node. The prev pointer doubles as the queued
+ * state: an idle item is an empty list node whose prev points to itself, and
+ * a producer claims the item by swapping that for NULL. Only a producer that
+ * wins the claim pushes the item, so an item is on at most one queue once.
+ */
+static bool nvgpu_worker_claim_item(struct nvgpu_list_node *work_item)
+{
+	return nvgpu_atomic_cmpxchg_ptr(&work_item->prev, work_item, NULL) ==
+		work_item;
 }
 
-static bool nvgpu_worker_pending(struct nvgpu_worker *worker, int get)
+/*
+ * Push a claimed item. Returns true if the queue was empty, in which case the
+ * caller is responsible for waking up the consumer. Pushes onto a non-empty
+ * queue rely on the wakeup of whoever pushed the oldest item in it.
+ */
+static bool nvgpu_worker_push_item(struct nvgpu_list_node **queue,
+		struct nvgpu_list_node *work_item)
 {
-	bool pending = nvgpu_atomic_read(&worker->put) != get;
+	struct nvgpu_list_node *head = NULL;
+	struct nvgpu_list_node *old;
 
-	/* We don't need barriers because they are implicit in locking */
-	return pending;
+	do {
+		work_item->next = head;
+		old = nvgpu_atomic_cmpxchg_ptr(queue, head, work_item);
+		if (old == head) {
+			break;
+		}
+		head = old;
+	} while (true);
+
+	return head == NULL;
+}
+
+/*
+ * Take every queued item at once and return them oldest first.
+ */
+static struct nvgpu_list_node *nvgpu_worker_take_items(
+		struct nvgpu_list_node **queue)
+{
+	struct nvgpu_list_node *items = nvgpu_atomic_xchg_ptr(queue, NULL);
+	struct nvgpu_list_node *batch = NULL;
+
+	while (items != NULL) {
+		struct nvgpu_list_node *next = items->next;
+
+		items->next = batch;
+		batch = items;
+		items = next;
+	}
+
+	return batch;
+}
+
+/*
+ * Turn a dequeued item back into an empty list node so it can be queued again
+ * while it is being processed, like with the old locked list.
+ */
+static void nvgpu_worker_release_item(struct nvgpu_list_node *work_item)
+{
+	work_item->next = work_item;
+	(void) nvgpu_atomic_xchg_ptr(&work_item->prev, work_item);
 }
 
 /**
- * Process the queued works for the worker thread serially.
+ * Process the queued works of one queue serially.
  *
- * Flush all the work items in the queue one by one. This may block timeout
- * handling for a short while, as these are serialized.
+ * Drain the queue in batches and handle the items of each batch one by one.
+ * On a worker without shards this may block timeout handling for a short
+ * while, as these are serialized.
  */
-static void nvgpu_worker_process(struct nvgpu_worker *worker, int *get)
+static void nvgpu_worker_process_items(struct nvgpu_worker *worker,
+		nvgpu_atomic_t *put, struct nvgpu_list_node **queue,
+		nvgpu_atomic_t *busy, int *get)
 {
-	struct gk20a *g = worker->g;
+	(void) nvgpu_atomic_xchg(busy, 1);
 
-	while (nvgpu_worker_pending(worker, *get)) {
-		struct nvgpu_list_node *work_item = NULL;
+	while (nvgpu_atomic_read(put) != *get) {
+		struct nvgpu_list_node *batch;
 
-		nvgpu_spinlock_acquire(&worker->items_lock);
-		if (!nvgpu_list_empty(&worker->items)) {
-			work_item = worker->items.next;
-			nvgpu_list_del(work_item);
-		}
-		nvgpu_spinlock_release(&worker->items_lock);
-
-		if (work_item == NULL) {
-			/*
-			 * Woke up for some other reason, but there are no
-			 * other reasons than a work item added in the items
-			 * list currently, so warn and ack the message.
-			 */
-			nvgpu_info(g, "Spurious worker event!");
-			++*get;
-			break;
+		/*
+		 * Ack all wakeups so far before taking the items. A wakeup
+		 * counted after this point may belong to an item taken now,
+		 * in which case the next pass just finds the queue empty.
+		 */
+		*get = nvgpu_atomic_read(put);
+		batch = nvgpu_worker_take_items(queue);
+
+		while (batch != NULL) {
+			struct nvgpu_list_node *work_item = batch;
+
+			batch = work_item->next;
+			nvgpu_worker_release_item(work_item);
+			nvgpu_worker_wakeup_process_item(worker, work_item);
 		}
+	}
+
+	(void) nvgpu_atomic_xchg(busy, 0);
+}
+
+static void nvgpu_worker_process(struct nvgpu_worker *worker, int *get)
+{
+	nvgpu_worker_process_items(worker, &worker->put, &worker->queue,
+			&worker->busy, get);
+}
+
+/*
+ * Process the work items of one shard. The hooks of the worker ops other than
+ * wakeup_process_item belong to the main thread, which keeps running them on
+ * its own schedule however long the shards are busy.
+ */
+static int nvgpu_worker_shard_poll_work(void *arg)
+{
+	struct nvgpu_worker_shard *shard = (struct nvgpu_worker_shard *)arg;
+	int get = 0;
+
+	while (!nvgpu_thread_should_stop(&shard->poll_task)) {
+		int ret;
+
+		ret = NVGPU_COND_WAIT_INTERRUPTIBLE(
+				&shard->wq,
+				(nvgpu_atomic_read(&shard->put) != get) ||
+				nvgpu_thread_should_stop(&shard->poll_task),
+				0U);
 
-		nvgpu_worker_wakeup_process_item(worker, work_item);
-		++*get;
+		if (ret == 0) {
+			nvgpu_worker_process_items(shard->worker, &shard->put,
+					&shard->queue, &shard->busy, &get);
+		}
 	}
+	return 0;
 }
 
 /*
@@ -177,11 +274,13 @@ static int nvgpu_worker_poll_work(void *arg)
 	return 0;
 }
 
-static int nvgpu_worker_start(struct nvgpu_worker *worker)
+static int nvgpu_worker_start_thread(struct nvgpu_worker *worker,
+		struct nvgpu_thread *poll_task, void *data,
+		int (*threadfn)(void *data), const char *name)
 {
 	int err = 0;
 
-	if (nvgpu_thread_is_running(&worker->poll_task)) {
+	if (nvgpu_thread_is_running(poll_task)) {
 		return err;
 	}
 
@@ -193,34 +292,90 @@ static int nvgpu_worker_start(struct nvgpu_worker *worker)
 	 * thread_is_running is volatile
 	 */
 
-	if (nvgpu_thread_is_running(&worker->poll_task)) {
+	if (nvgpu_thread_is_running(poll_task)) {
 		nvgpu_mutex_release(&worker->start_lock);
 		return err;
 	}
 
-	err = nvgpu_thread_create(&worker->poll_task, worker,
-			nvgpu_worker_poll_work, worker->thread_name);
+	err = nvgpu_thread_create(poll_task, data, threadfn, name);
 	if (err != 0) {
 		nvgpu_err(worker->g,
 			  "failed to create worker poller thread %s err %d",
-			  worker->thread_name, err);
+			  name, err);
 	}
 
 	nvgpu_mutex_release(&worker->start_lock);
 	return err;
 }
 
+static int nvgpu_worker_start(struct nvgpu_worker *worker)
+{
+	return nvgpu_worker_start_thread(worker, &worker->poll_task, worker,
+			nvgpu_worker_poll_work, worker->thread_name);
+}
+
+static int nvgpu_worker_shard_start(struct nvgpu_worker_shard *shard)
+{
+	return nvgpu_worker_start_thread(shard->worker, &shard->poll_task,
+			shard, nvgpu_worker_shard_poll_work,
+			shard->thread_name);
+}
+
 bool nvgpu_worker_should_stop(struct nvgpu_worker *worker)
 {
 	return nvgpu_thread_should_stop(&worker->poll_task);
 }
 
+static int nvgpu_worker_add_item(nvgpu_atomic_t *put,
+		struct nvgpu_list_node **queue, nvgpu_atomic_t *busy,
+		struct nvgpu_cond *wq, struct nvgpu_list_node *work_item)
+{
+	if (!nvgpu_worker_claim_item(work_item)) {
+		/*
+		 * Already queued, so will get processed eventually.
+		 * The worker is probably awake already.
+		 */
+		return -1;
+	}
+
+	if (nvgpu_worker_push_item(queue, work_item)) {
+		nvgpu_worker_wakeup(put, busy, wq);
+	}
+
+	return 0;
+}
+
+static int nvgpu_worker_shard_enqueue(struct nvgpu_worker_shard *shard,
+		struct nvgpu_list_node *work_item)
+{
+	struct gk20a *g = shard->worker->g;
+	int err;
+
+	err = nvgpu_worker_shard_start(shard);
+	if (err != 0) {
+		nvgpu_do_assert_print(g, "nvgpu_worker %s cannot run!",
+			shard->thread_name);
+		return -1;
+	}
+
+	return nvgpu_worker_add_item(&shard->put, &shard->queue, &shard->busy,
+			&shard->wq, work_item);
+}
+
 int nvgpu_worker_enqueue(struct nvgpu_worker *worker,
 		struct nvgpu_list_node *work_item)
+{
+	return nvgpu_worker_enqueue_sharded(worker, work_item, 0U);
+}
+
+int nvgpu_worker_enqueue_sharded(struct nvgpu_worker *worker,
+		struct nvgpu_list_node *work_item, u32 key)
 {
 	int err;
 	struct gk20a *g = worker->g;
 
+	nvgpu_log_fn(g, " ");
+
 	/*
 	 * Warn if worker thread cannot run
 	 */
@@ -231,21 +386,18 @@ int nvgpu_worker_enqueue(struct nvgpu_worker *worker,
 		return -1;
 	}
 
-	nvgpu_spinlock_acquire(&worker->items_lock);
-	if (!nvgpu_list_empty(work_item)) {
+	if (worker->num_shards != 0U) {
 		/*
-		 * Already queued, so will get processed eventually.
-		 * The worker is probably awake already.
+		 * A given key always maps to the same shard, so an item is
+		 * never processed by two threads at once.
 		 */
-		nvgpu_spinlock_release(&worker->items_lock);
-		return -1;
+		return nvgpu_worker_shard_enqueue(
+				&worker->shards[key % worker->num_shards],
+				work_item);
 	}
-	nvgpu_list_add_tail(work_item, &worker->items);
-	nvgpu_spinlock_release(&worker->items_lock);
 
-	(void) nvgpu_worker_wakeup(worker);
-
-	return 0;
+	return nvgpu_worker_add_item(&worker->put, &worker->queue,
+			&worker->busy, &worker->wq, work_item);
 }
 
 void nvgpu_worker_init_name(struct nvgpu_worker *worker,
@@ -274,24 +426,122 @@ void nvgpu_worker_init_name(struct nvgpu_worker *worker,
 	(void) strncat(worker->thread_name, gpu_name, num_free_chars);
 }
 
+static void nvgpu_worker_shard_wake(void *data)
+{
+	struct nvgpu_worker_shard *shard = (struct nvgpu_worker_shard *)data;
+
+	nvgpu_cond_signal_interruptible(&shard->wq);
+}
+
+/*
+ * Shard threads are woken up to notice the stop request and exit on their own
+ * rather than being cancelled, since a thread cancelled while waiting would
+ * leave the wait queue locked and its wq could not be destroyed.
+ */
+static void nvgpu_worker_stop_shards(struct nvgpu_worker *worker)
+{
+	u32 i;
+
+	for (i = 0U; i < worker->num_shards; i++) {
+		nvgpu_thread_stop_graceful(&worker->shards[i].poll_task,
+				nvgpu_worker_shard_wake, &worker->shards[i]);
+	}
+}
+
+static void nvgpu_worker_free_shards(struct nvgpu_worker *worker)
+{
+	u32 i;
+
+	for (i = 0U; i < worker->num_shards; i++) {
+		nvgpu_cond_destroy(&worker->shards[i].wq);
+	}
+	nvgpu_kfree(worker->g, worker->shards);
+	worker->shards = NULL;
+	worker->num_shards = 0U;
+}
+
+static int nvgpu_worker_init_shards(struct nvgpu_worker *worker,
+		u32 num_shards)
+{
+	struct gk20a *g = worker->g;
+	const char *name_parts[2];
+	char shard_id[11];
+	u32 i;
+	int err;
+
+	worker->shards = nvgpu_kzalloc(g, nvgpu_safe_mult_u64(num_shards,
+				sizeof(*worker->shards)));
+	if (worker->shards == NULL) {
+		return -ENOMEM;
+	}
+	worker->num_shards = num_shards;
+
+	for (i = 0U; i < num_shards; i++) {
+		struct nvgpu_worker_shard *shard = &worker->shards[i];
+
+		shard->worker = worker;
+		nvgpu_atomic_set(&shard->put, 0);
+		nvgpu_atomic_set(&shard->busy, 0);
+		(void) nvgpu_cond_init(&shard->wq);
+		shard->queue = NULL;
+		/* {thread_name}_{shard index} */
+		name_parts[0] = worker->thread_name;
+		name_parts[1] = shard_id;
+		(void) nvgpu_strnadd_u32(shard_id, i, sizeof(shard_id), 10U);
+		(void) nvgpu_str_join(shard->thread_name,
+				(u32)sizeof(shard->thread_name),
+				name_parts, 2U, "_");
+
+		err = nvgpu_worker_shard_start(shard);
+		if (err != 0) {
+			nvgpu_worker_stop_shards(worker);
+			nvgpu_worker_free_shards(worker);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
 int nvgpu_worker_init(struct gk20a *g, struct nvgpu_worker *worker,
 	const struct nvgpu_worker_ops *worker_ops)
+{
+	return nvgpu_worker_init_sharded(g, worker, worker_ops, 0U);
+}
+
+int nvgpu_worker_init_sharded(struct gk20a *g, struct nvgpu_worker *worker,
+	const struct nvgpu_worker_ops *worker_ops, u32 num_shards)
 {
 	int err;
 
 	worker->g = g;
 	nvgpu_atomic_set(&worker->put, 0);
+	nvgpu_atomic_set(&worker->busy, 0);
 	(void) nvgpu_cond_init(&worker->wq);
-	nvgpu_init_list_node(&worker->items);
-	nvgpu_spinlock_init(&worker->items_lock);
+	worker->queue = NULL;
 	nvgpu_mutex_init(&worker->start_lock);
+	worker->shards = NULL;
+	worker->num_shards = 0U;
 
 	worker->ops = worker_ops;
 
+	if (num_shards != 0U) {
+		err = nvgpu_worker_init_shards(worker, num_shards);
+		if (err != 0) {
+			nvgpu_err(g, "failed to start %u shards for %s",
+					num_shards, worker->thread_name);
+			return err;
+		}
+	}
+
 	err = nvgpu_worker_start(worker);
 	if (err != 0) {
 		nvgpu_err(g, "failed to start worker poller thread %s",
 				worker->thread_name);
+		if (worker->num_shards != 0U) {
+			nvgpu_worker_stop_shards(worker);
+			nvgpu_worker_free_shards(worker);
+		}
 		return err;
 	}
 	return 0;
@@ -300,6 +550,11 @@ int nvgpu_worker_init(struct gk20a *g, struct nvgpu_worker *worker,
 void nvgpu_worker_deinit(struct nvgpu_worker *worker)
 {
 	nvgpu_mutex_acquire(&worker->start_lock);
+	nvgpu_worker_stop_shards(worker);
 	nvgpu_thread_stop(&worker->poll_task);
 	nvgpu_mutex_release(&worker->start_lock);
+
+	if (worker->num_shards != 0U) {
+		nvgpu_worker_free_shards(worker);
+	}
 }
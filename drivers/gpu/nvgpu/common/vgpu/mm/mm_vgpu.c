@@ -105,7 +105,7 @@ void vgpu_locked_gmmu_unmap(struct vm_gk20a *vm,
 	}
 
 	if (va_allocated) {
-		nvgpu_vm_free_va(vm, vaddr, pgsz_idx);
+		nvgpu_vm_free_va(vm, vaddr, size, pgsz_idx);
 	}
 	/* TLB invalidate handled on server side */
 }
@@ -66,7 +66,7 @@ static int set_syncpt_ro_map_gpu_va_locked(struct vm_gk20a *vm)
 			"mapping read-only va space failed err %d",
 			err);
 		nvgpu_vm_free_va(vm, vm->syncpt_ro_map_gpu_va,
-				 GMMU_PAGE_SIZE_KERNEL);
+				 g->syncpt_unit_size, GMMU_PAGE_SIZE_KERNEL);
 		vm->syncpt_ro_map_gpu_va = 0;
 		return err;
 	}
@@ -115,7 +115,7 @@ int vgpu_gv11b_syncpt_alloc_buf(struct nvgpu_channel *c,
 	if (err) {
 		nvgpu_err(g, "mapping syncpt va space failed err %d", err);
 		nvgpu_vm_free_va(c->vm, syncpt_buf->gpu_va,
-				 GMMU_PAGE_SIZE_KERNEL);
+				 g->syncpt_size, GMMU_PAGE_SIZE_KERNEL);
 		return err;
 	}
 
@@ -126,7 +126,8 @@ void vgpu_gv11b_syncpt_free_buf(struct nvgpu_channel *c,
 					struct nvgpu_mem *syncpt_buf)
 {
 	nvgpu_gmmu_unmap(c->vm, syncpt_buf);
-	nvgpu_vm_free_va(c->vm, syncpt_buf->gpu_va, GMMU_PAGE_SIZE_KERNEL);
+	nvgpu_vm_free_va(c->vm, syncpt_buf->gpu_va, c->g->syncpt_size,
+			 GMMU_PAGE_SIZE_KERNEL);
 	nvgpu_dma_free(c->g, syncpt_buf);
 }
 
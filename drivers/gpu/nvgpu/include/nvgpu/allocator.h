@@ -211,6 +211,8 @@ struct nvgpu_allocator_ops {
 /**
  * Basic structure to hold details of an allocator.
  */
+struct nvgpu_alloc_cache;
+
 struct nvgpu_allocator {
 	/**
 	 * Pointer to GPU structure.
@@ -240,6 +242,10 @@ struct nvgpu_allocator {
 	 * Control for debug msgs.
 	 */
 	bool debug;
+	/**
+	 * Free block cache, only present with #GPU_ALLOC_CACHE.
+	 */
+	struct nvgpu_alloc_cache *cache;
 };
 
 /**
@@ -356,6 +362,18 @@ nvgpu_alloc_carveout_from_co_entry(struct nvgpu_list_node *node)
  */
 #define GPU_ALLOC_NO_SCATTER_GATHER	BIT64(4)
 
+/**
+ *     Put a small cache of recently freed blocks in front of the allocator.
+ *     Blocks handed back with nvgpu_free_sized() are kept in per-thread
+ *     magazines, one per recently used size, and are handed out again by
+ *     nvgpu_alloc() and nvgpu_alloc_pte() without taking the allocator lock.
+ *     Cached blocks still count as allocated for the underlying allocator;
+ *     they are returned to it when an allocation fails and when the
+ *     allocator is destroyed. The cache holds at most 1/16 of the allocator
+ *     space and at most 64MB. Only honoured by nvgpu_allocator_init().
+ */
+#define GPU_ALLOC_CACHE			BIT64(5)
+
 /** @}*/
 
 /** Enumerated type used to identify various allocator types */
@@ -610,6 +628,24 @@ u64  nvgpu_alloc_pte(struct nvgpu_allocator *a, u64 len, u32 page_size);
  */
 void nvgpu_free(struct nvgpu_allocator *a, u64 addr);
 
+/**
+ * @brief Interface to free allocated resources of a known size.
+ *
+ * @param[in] a		Pointer to nvgpu allocator.
+ * @param[in] addr	Base address of allocation.
+ * @param[in] len	Size passed when allocating.
+ * @param[in] page_size	Page size passed to nvgpu_alloc_pte(), 0 if the
+ *			resource came from nvgpu_alloc().
+ *
+ * If the allocator was created with #GPU_ALLOC_CACHE the allocation is kept
+ * in the calling thread's cache for reuse by an allocation of the same size.
+ * Otherwise, or if the cache is full, this is the same as nvgpu_free().
+ *
+ * @return	None
+ */
+void nvgpu_free_sized(struct nvgpu_allocator *a, u64 addr, u64 len,
+		      u32 page_size);
+
 /**
  * @brief Interface to allocate resources with specific start address.
  *
@@ -626,4 +626,36 @@ static inline long nvgpu_atomic64_sub_return(long x, nvgpu_atomic64_t *v)
 	return nvgpu_atomic64_sub_return_impl(x, v);
 }
 
+/**
+ * @brief Compare and exchange a pointer.
+ *
+ * Atomically compares the pointer stored at \a p with \a old and replaces it
+ * with \a new if they are equal. The pointer does not need to be declared
+ * as an atomic type, which lets lock-free code link through plain pointer
+ * fields such as the ones in #nvgpu_list_node. The operation is fully
+ * ordered. Function does not perform any validation of the parameters.
+ *
+ * @param p [in]	Address of the pointer.
+ * @param old [in]	Value to compare.
+ * @param new [in]	Value to store.
+ *
+ * @return The pointer stored at \a p before the operation.
+ */
+#define nvgpu_atomic_cmpxchg_ptr(p, old, new)			\
+	nvgpu_atomic_cmpxchg_ptr_impl(p, old, new)
+
+/**
+ * @brief Exchange a pointer.
+ *
+ * Atomically stores \a new at \a p. The operation is fully ordered.
+ * Function does not perform any validation of the parameters.
+ *
+ * @param p [in]	Address of the pointer.
+ * @param new [in]	Value to store.
+ *
+ * @return The pointer stored at \a p before the operation.
+ */
+#define nvgpu_atomic_xchg_ptr(p, new)				\
+	nvgpu_atomic_xchg_ptr_impl(p, new)
+
 #endif /* NVGPU_ATOMIC_H */
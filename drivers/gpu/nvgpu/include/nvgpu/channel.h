@@ -31,6 +31,7 @@
 #include <nvgpu/nvgpu_mem.h>
 #include <nvgpu/allocator.h>
 #include <nvgpu/debug.h>
+#include <nvgpu/rbtree.h>
 
 /**
  * @file
@@ -42,7 +43,6 @@ struct dbg_session_gk20a;
 struct nvgpu_fence_type;
 struct nvgpu_swprofiler;
 struct nvgpu_channel_sync;
-struct nvgpu_gpfifo_userdata;
 struct nvgpu_gr_subctx;
 struct nvgpu_gr_ctx;
 struct nvgpu_debug_context;
@@ -135,6 +135,60 @@ struct nvgpu_gpfifo_entry {
 	u32 entry1;
 };
 
+#ifdef CONFIG_NVGPU_KERNEL_MODE_SUBMIT
+struct _resmgr_context;
+
+/**
+ * Gpfifo entries of a submit that still live in the caller's address space.
+ */
+struct nvgpu_gpfifo_userdata {
+	/** User pointer to the entries. */
+	struct nvgpu_gpfifo_entry nvgpu_user *entries;
+	/** OS specific context for copying the entries. */
+	struct _resmgr_context *context;
+};
+
+/**
+ * Maximum number of channels in one #nvgpu_submit_channels_gpfifo() batch.
+ */
+#define NVGPU_SUBMIT_BATCH_MAX_CHANNELS		16U
+
+/**
+ * Value of #nvgpu_submit_batch_entry.wait_index for no in-batch wait.
+ */
+#define NVGPU_SUBMIT_BATCH_NO_WAIT		U32_MAX
+
+/**
+ * One channel's part of a batched submit, see #nvgpu_submit_channels_gpfifo().
+ */
+struct nvgpu_submit_batch_entry {
+	/** Channel to submit to. A channel can appear once per batch. */
+	struct nvgpu_channel *ch;
+	/** Kernel gpfifo entries, or NULL to copy them from #userdata. */
+	struct nvgpu_gpfifo_entry *gpfifo;
+	/** User gpfifo entries, used when #gpfifo is NULL. */
+	struct nvgpu_gpfifo_userdata userdata;
+	/** Number of gpfifo entries. */
+	u32 num_entries;
+	/** NVGPU_SUBMIT_FLAGS_* for this channel. */
+	u32 flags;
+	/** Pre-fence, used with #NVGPU_SUBMIT_FLAGS_FENCE_WAIT. */
+	struct nvgpu_channel_fence fence;
+	/**
+	 * Index of an earlier entry of the batch whose work has to finish
+	 * before the work of this entry starts, or
+	 * #NVGPU_SUBMIT_BATCH_NO_WAIT. The wait is done by the GPU on the
+	 * post fence of that entry and takes the place of a pre-fence.
+	 */
+	u32 wait_index;
+	/**
+	 * Out: post fence when #NVGPU_SUBMIT_FLAGS_FENCE_GET was requested.
+	 * The caller owns the reference.
+	 */
+	struct nvgpu_fence_type *fence_out;
+};
+#endif
+
 struct gpfifo_desc {
 	/** Memory area containing gpfifo entries. */
 	struct nvgpu_mem mem;
@@ -388,6 +442,12 @@ struct nvgpu_channel {
 	struct nvgpu_mem usermode_gpfifo;
 	/** Channel instance block memory. */
 	struct nvgpu_mem inst_block;
+	/**
+	 * Node in #nvgpu_fifo.inst_tree, keyed by the instance block
+	 * address. Valid between #nvgpu_channel_alloc_inst and
+	 * #nvgpu_channel_free_inst.
+	 */
+	struct nvgpu_rbtree_node inst_node;
 
 	/**
 	 * USERD address that will be programmed in H/W.
@@ -410,6 +470,12 @@ struct nvgpu_channel {
 	struct nvgpu_cond notifier_wq;
 	/** Semaphore wait queue (see #NVPGU_WAIT_TYPE_SEMAPHORE). */
 	struct nvgpu_cond semaphore_wq;
+	/**
+	 * Number of in-flight jobs and semaphore waiters that need this
+	 * channel to be signalled on semaphore wakeup. Protected by
+	 * #nvgpu_fifo.sema_wakeup_lock.
+	 */
+	u32 sema_wakeup_refs;
 
 #if defined(CONFIG_NVGPU_CYCLESTATS)
 	struct {
@@ -578,6 +644,43 @@ int nvgpu_submit_channel_gpfifo_kernel(struct nvgpu_channel *c,
 				u32 flags,
 				struct nvgpu_channel_fence *fence,
 				struct nvgpu_fence_type **fence_out);
+
+/**
+ * @brief Submit gpfifo entries to several channels at once.
+ *
+ * @param g [in]		The GPU.
+ * @param batch [in,out]	Per channel submits.
+ * @param count [in]		Number of entries in \a batch.
+ * @param num_submitted [out]	Number of entries that were submitted.
+ * @param profiler [in]		Kickoff profiler, or NULL.
+ *
+ * Submits like #nvgpu_submit_channel_gpfifo_kernel() for each entry of
+ * \a batch in order, with the per call overhead paid once for the batch:
+ * the whole batch is validated before anything is written, deferred TLB
+ * invalidates and the LTC settings are synced once, and the doorbells of all
+ * channels are rung together after all gpfifos have been written.
+ *
+ * An entry can depend on an earlier entry of the same batch with
+ * #nvgpu_submit_batch_entry.wait_index. The dependency is resolved on the
+ * GPU with a syncpoint wait on the post fence of the earlier entry, so this
+ * needs syncpoint support and raw syncpoint fences.
+ *
+ * The caller serializes submits on each channel, as for single submits.
+ *
+ * @return 0 on success. If a submit fails, the entries before it stay
+ * submitted and their doorbells are rung; \a num_submitted tells how many.
+ *
+ * @retval -EINVAL if \a count is 0 or too large, a channel appears twice, a
+ *         wait index does not point to an earlier entry, or an entry with a
+ *         wait index also has its own pre-fence or uses sync fences.
+ * @retval -ENODEV if the driver is dying or in-batch waits are not
+ *         supported.
+ * @retval other errors from #nvgpu_submit_channel_gpfifo_kernel().
+ */
+int nvgpu_submit_channels_gpfifo(struct gk20a *g,
+				struct nvgpu_submit_batch_entry *batch,
+				u32 count, u32 *num_submitted,
+				struct nvgpu_swprofiler *profiler);
 #ifdef CONFIG_TEGRA_GK20A_NVHOST
 int nvgpu_channel_set_syncpt(struct nvgpu_channel *ch);
 #endif
@@ -629,6 +732,23 @@ nvgpu_channel_from_ch_entry(struct nvgpu_list_node *node)
           ((uintptr_t)node - offsetof(struct nvgpu_channel, ch_entry));
 };
 
+/**
+ * @brief Get channel pointer from its node in the instance block index.
+ *
+ * @param node [in]	Pointer to node entry in #nvgpu_fifo.inst_tree.
+ *			Cannot be NULL, and must be valid.
+ *
+ * Computes channel pointer from #node pointer.
+ *
+ * @return Channel pointer.
+ */
+static inline struct nvgpu_channel *
+nvgpu_channel_from_inst_node(struct nvgpu_rbtree_node *node)
+{
+	return (struct nvgpu_channel *)
+		((uintptr_t)node - offsetof(struct nvgpu_channel, inst_node));
+};
+
 /**
  * @brief Check if channel is bound to an address space.
  *
@@ -777,11 +897,54 @@ void nvgpu_channel_abort_clean_up(struct nvgpu_channel *ch);
  * @param post_events [in]	When true, notify all threads waiting
  *				on TSG events.
  *
- * Goes through all channels, and wakes up semaphore wait queue.
- * If #post_events is true, it also wakes up TSG event wait queue.
+ * Goes through the channels that have jobs in flight or semaphore waiters
+ * (see #nvgpu_channel_semaphore_wakeup_get()), and wakes up semaphore wait
+ * queue. If #post_events is true, it also wakes up TSG event wait queue;
+ * while TSG event listeners are registered with
+ * #nvgpu_channel_semaphore_wakeup_events_get(), all bound channels are
+ * signalled.
  */
 void nvgpu_channel_semaphore_wakeup(struct gk20a *g, bool post_events);
 
+/**
+ * @brief Register channel for semaphore wakeups
+ *
+ * @param ch [in]	Channel pointer.
+ *
+ * Takes a reference on the channel's semaphore wakeup tracking. While the
+ * channel holds at least one such reference, #nvgpu_channel_semaphore_wakeup()
+ * signals it. This is taken for every in-flight job and for every thread
+ * that waits on #nvgpu_channel.semaphore_wq for a GPU semaphore release.
+ */
+void nvgpu_channel_semaphore_wakeup_get(struct nvgpu_channel *ch);
+
+/**
+ * @brief Unregister channel from semaphore wakeups
+ *
+ * @param ch [in]	Channel pointer.
+ *
+ * Drops a reference taken with #nvgpu_channel_semaphore_wakeup_get().
+ */
+void nvgpu_channel_semaphore_wakeup_put(struct nvgpu_channel *ch);
+
+/**
+ * @brief Register a TSG event listener for semaphore wakeups
+ *
+ * @param g [in]	Pointer to GPU driver struct.
+ *
+ * Blocking sync events are posted to the TSG of every bound channel, so
+ * while a listener is registered, #nvgpu_channel_semaphore_wakeup() visits
+ * all channels when posting events.
+ */
+void nvgpu_channel_semaphore_wakeup_events_get(struct gk20a *g);
+
+/**
+ * @brief Unregister a TSG event listener for semaphore wakeups
+ *
+ * @param g [in]	Pointer to GPU driver struct.
+ */
+void nvgpu_channel_semaphore_wakeup_events_put(struct gk20a *g);
+
 /**
  * @brief Enable all channels in channel's TSG
  *
@@ -1113,7 +1276,8 @@ static inline u64 nvgpu_channel_userd_gpu_va(struct nvgpu_channel *c)
  * @param ch [in]	Channel pointer.
  *
  * Instance block is allocated in vidmem if supported by GPU,
- * sysmem otherwise.
+ * sysmem otherwise. The channel is added to the instance block
+ * address index used by #nvgpu_channel_refch_from_inst_ptr.
  *
  * @return 0 in case of success, < 0 in case of failure.
  * @retval -ENOMEM in case there is not enough memory.
@@ -1125,6 +1289,9 @@ int nvgpu_channel_alloc_inst(struct gk20a *g, struct nvgpu_channel *ch);
  *
  * @param g [in]	Pointer to GPU driver struct.
  * @param ch [in]	Channel pointer.
+ *
+ * The channel is removed from the instance block address index before
+ * the instance block is freed.
  */
 void nvgpu_channel_free_inst(struct gk20a *g, struct nvgpu_channel *ch);
 
@@ -1152,8 +1319,10 @@ void nvgpu_channel_set_error_notifier(struct gk20a *g, struct nvgpu_channel *ch,
  * @param inst_ptr [in]	Instance block physical address.
  *
  * Search for the channel which instance block physical address is
- * equal to #inst_ptr. If channel is found, an extra reference is
- * taken on the channel, and should be released with #nvgpu_channel_put.
+ * equal to #inst_ptr. The lookup goes through #nvgpu_fifo.inst_tree, so
+ * its cost does not depend on the number of channels. If channel is
+ * found, an extra reference is taken on the channel, and should be
+ * released with #nvgpu_channel_put.
  *
  * @return Pointer to channel, or NULL if channel was not found.
  */
@@ -194,6 +194,7 @@
 #include <nvgpu/kref.h>
 #include <nvgpu/list.h>
 #include <nvgpu/swprofile.h>
+#include <nvgpu/rbtree.h>
 
 /**
  * H/w defined value for Channel ID type
@@ -323,6 +324,34 @@ struct nvgpu_fifo {
 	 */
 	struct nvgpu_mutex free_chs_mutex;
 
+	/**
+	 * Bitmap of channels, indexed by chid, that need to be signalled on a
+	 * semaphore wakeup interrupt, i.e. channels that have jobs in flight
+	 * or threads waiting on #nvgpu_channel.semaphore_wq. Bits are set and
+	 * cleared with #sema_wakeup_lock held, but may be read locklessly.
+	 */
+	unsigned long *sema_wakeup_chids;
+	/**
+	 * Lock used to update #sema_wakeup_chids and the per-channel
+	 * #nvgpu_channel.sema_wakeup_refs counters.
+	 */
+	struct nvgpu_spinlock sema_wakeup_lock;
+	/**
+	 * Number of TSG event listeners that want a blocking sync event on
+	 * every semaphore wakeup. While non-zero, a wakeup that posts events
+	 * has to visit every channel.
+	 */
+	nvgpu_atomic_t sema_wakeup_event_users;
+
+	/**
+	 * Channels with an allocated instance block, keyed by instance block
+	 * address. Used to map the instance pointer reported by MMU fault,
+	 * ctxsw timeout and FECS trace events back to a channel.
+	 */
+	struct nvgpu_rbtree_node *inst_tree;
+	/** Lock used to read and update #inst_tree. */
+	struct nvgpu_spinlock inst_tree_lock;
+
 	/** Lock used to prevent multiple recoveries. */
 	struct nvgpu_mutex engines_reset_mutex;
 
@@ -111,6 +111,7 @@ struct gk20a_cs_snapshot;
 #ifdef CONFIG_NVGPU_DEBUGGER
 struct dbg_session_gk20a;
 struct nvgpu_dbg_reg_op;
+struct nvgpu_regops_allowlist;
 #endif
 #ifdef CONFIG_NVGPU_KERNEL_MODE_SUBMIT
 struct _resmgr_context;
@@ -325,13 +326,6 @@ struct railgate_stats {
 
 #endif
 
-#ifdef CONFIG_NVGPU_KERNEL_MODE_SUBMIT
-struct nvgpu_gpfifo_userdata {
-	struct nvgpu_gpfifo_entry nvgpu_user *entries;
-	struct _resmgr_context *context;
-};
-#endif
-
 #ifdef CONFIG_NVGPU_CHANNEL_TSG_CONTROL
 enum nvgpu_event_id_type {
 	NVGPU_EVENT_ID_BPT_INT = 0,
@@ -646,6 +640,9 @@ struct gk20a {
 	struct nvgpu_dbg_reg_op *dbg_regops_tmp_buf;
 	u32 dbg_regops_tmp_buf_ops;
 
+	/* allowlist of regops offsets, built at poweron */
+	struct nvgpu_regops_allowlist *regops_allowlist;
+
 	/* For perfbuf mapping */
 	struct {
 		struct dbg_session_gk20a *owner;
@@ -608,6 +608,48 @@ void nvgpu_gmmu_unmap_locked(struct vm_gk20a *vm,
 			     bool sparse,
 			     struct vm_gk20a_mapping_batch *batch);
 
+/**
+ * @brief Invalidate the TLB for the dirty VA ranges of a VM.
+ *
+ * @param vm			[in]	Pointer to virtual memory structure.
+ *
+ * Issue one invalidate per range recorded in vm.tlb when the HAL provides
+ * fb.tlb_invalidate_range and the range list did not overflow. Otherwise
+ * invalidate the whole TLB for vm.pdb once. Does nothing if no range is
+ * pending. Must be called with vm.update_gmmu_lock held.
+ *
+ * @return	Zero on success, error code from the TLB invalidate HAL
+ *		otherwise. The ranges are kept pending on failure.
+ */
+int nvgpu_gmmu_tlb_flush_dirty(struct vm_gk20a *vm);
+
+/**
+ * @brief Start the threads writing the PTEs of large GMMU updates.
+ *
+ * @param g		[in]	The GPU.
+ *
+ * Start mm.pt_worker with mm.pt_parallel_threads shard threads. From then
+ * on, map and unmap updates covering at least mm.pt_parallel_min_size bytes
+ * allocate the upper page directories on the caller, then split the writes
+ * of the last level page tables between the caller and the worker threads.
+ * Mappings with comptags and page tables in vidmem are always written by
+ * the caller. Does nothing if mm.pt_parallel_threads is 0, which is the
+ * default unless the platform asks for worker threads.
+ *
+ * @return	Zero on success, error code from #nvgpu_worker_init_sharded()
+ *		otherwise.
+ */
+int nvgpu_gmmu_pt_workers_init(struct gk20a *g);
+
+/**
+ * @brief Stop the threads started by #nvgpu_gmmu_pt_workers_init().
+ *
+ * @param g		[in]	The GPU.
+ *
+ * No GMMU update may be in progress.
+ */
+void nvgpu_gmmu_pt_workers_deinit(struct gk20a *g);
+
 /**
  * Internal debugging routines.
  */
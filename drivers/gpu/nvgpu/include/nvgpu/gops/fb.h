@@ -370,6 +370,21 @@ struct gops_fb {
 	 */
 	int (*tlb_invalidate)(struct gk20a *g, struct nvgpu_mem *pdb);
 
+	/**
+	 * @brief Invalidate TLB entries of a VA range of the pdb given.
+	 *
+	 * @param g [in]	Pointer to GPU driver struct.
+	 * @param pdb [in]	Pointer to pdb.
+	 * @param va [in]	First GPU VA of the range.
+	 * @param size [in]	Size of the range in bytes.
+	 *
+	 * Optional. When NULL, callers fall back to #tlb_invalidate.
+	 *
+	 * @return 0 in case of success, < 0 in case of failure.
+	 */
+	int (*tlb_invalidate_range)(struct gk20a *g, struct nvgpu_mem *pdb,
+				    u64 va, u64 size);
+
 	/**
 	 * @brief Setup mmu fault buffer.
 	 *
@@ -59,6 +59,11 @@
 #define NVGPU_GPU_CTXSW_FILTER_SIZE (NVGPU_GPU_CTXSW_TAG_LAST + 1)
 #define NVGPU_FECS_TRACE_FEATURE_CONTROL_BIT 31
 
+/* Buckets of the context_ptr hash table, a power of 2. */
+#define NVGPU_FECS_TRACE_CONTEXT_HASH_SIZE	64U
+/* Entries decoded before they are handed to the OS ring in one go. */
+#define NVGPU_FECS_TRACE_STAGING_ENTRIES	1024U
+
 struct gk20a;
 struct nvgpu_mem;
 struct nvgpu_gr_subctx;
@@ -66,13 +71,50 @@ struct nvgpu_gr_ctx;
 struct nvgpu_tsg;
 struct vm_area_struct;
 
+struct nvgpu_gpu_ctxsw_trace_entry;
+
+/*
+ * Decode statistics, updated by the poller under poll_lock.
+ */
+struct nvgpu_gr_fecs_trace_stats {
+	/* Polls that found records in the FECS ring. */
+	u64 polls;
+	/* FECS records decoded. */
+	u64 records;
+	/* Trace entries emitted to the OS ring. */
+	u64 entries;
+	/* Time spent decoding and emitting records. */
+	u64 decode_ns;
+	/* context_ptr lookups, and those not answered by the last hit. */
+	u64 lookups;
+	u64 lookup_misses;
+};
+
 struct nvgpu_gr_fecs_trace {
-	struct nvgpu_list_node context_list;
+	/*
+	 * Bound contexts, hashed by context_ptr. The poller looks contexts up
+	 * with list_lock held once for all records of a poll.
+	 */
+	struct nvgpu_list_node context_hash[NVGPU_FECS_TRACE_CONTEXT_HASH_SIZE];
+	u32 num_contexts;
 	struct nvgpu_mutex list_lock;
 
 	struct nvgpu_mutex poll_lock;
 	struct nvgpu_periodic_timer poll_timer;
 
+	/* Entries decoded in this poll, protected by poll_lock. */
+	struct nvgpu_gpu_ctxsw_trace_entry *staging;
+	u32 staging_count;
+	struct nvgpu_gr_fecs_trace_stats stats;
+	/*
+	 * Context found by the last lookup of this poll. Consecutive records
+	 * switch away from the context the previous record switched to.
+	 */
+	bool last_valid;
+	u32 last_context_ptr;
+	pid_t last_pid;
+	u32 last_vmid;
+
 	struct nvgpu_mutex enable_lock;
 	u32 enable_count;
 };
@@ -145,13 +187,12 @@ bool nvgpu_gr_fecs_trace_is_valid_record(struct gk20a *g,
 	struct nvgpu_fecs_trace_record *r);
 
 int nvgpu_gr_fecs_trace_add_context(struct gk20a *g, u32 context_ptr,
-	pid_t pid, u32 vmid, struct nvgpu_list_node *list);
-void nvgpu_gr_fecs_trace_remove_context(struct gk20a *g, u32 context_ptr,
-	struct nvgpu_list_node *list);
-void nvgpu_gr_fecs_trace_remove_contexts(struct gk20a *g,
-	struct nvgpu_list_node *list);
+	pid_t pid, u32 vmid);
+void nvgpu_gr_fecs_trace_remove_context(struct gk20a *g, u32 context_ptr);
+void nvgpu_gr_fecs_trace_remove_contexts(struct gk20a *g);
+/* Must be called with list_lock held. */
 void nvgpu_gr_fecs_trace_find_pid(struct gk20a *g, u32 context_ptr,
-	struct nvgpu_list_node *list, pid_t *pid, u32 *vmid);
+	pid_t *pid, u32 *vmid);
 
 size_t nvgpu_gr_fecs_trace_buffer_size(struct gk20a *g);
 int nvgpu_gr_fecs_trace_max_entries(struct gk20a *g,
@@ -166,6 +207,8 @@ int nvgpu_gr_fecs_trace_ring_read(struct gk20a *g, int index,
 	u32 *vm_update_mask);
 int nvgpu_gr_fecs_trace_poll(struct gk20a *g);
 int nvgpu_gr_fecs_trace_reset(struct gk20a *g);
+void nvgpu_gr_fecs_trace_get_stats(struct gk20a *g,
+	struct nvgpu_gr_fecs_trace_stats *stats);
 
 int nvgpu_gr_fecs_trace_bind_channel(struct gk20a *g,
 	struct nvgpu_mem *inst_block, struct nvgpu_gr_subctx *subctx,
@@ -185,6 +228,9 @@ void nvgpu_gr_fecs_trace_add_tsg_reset(struct gk20a *g, struct nvgpu_tsg *tsg);
 u8 nvgpu_gpu_ctxsw_tags_to_common_tags(u8 tags);
 int nvgpu_gr_fecs_trace_write_entry(struct gk20a *g,
 			    struct nvgpu_gpu_ctxsw_trace_entry *entry);
+void nvgpu_gr_fecs_trace_write_entries(struct gk20a *g,
+			    struct nvgpu_gpu_ctxsw_trace_entry *entries,
+			    u32 count);
 void nvgpu_gr_fecs_trace_wake_up(struct gk20a *g, int vmid);
 
 #endif /* CONFIG_NVGPU_FECS_TRACE */
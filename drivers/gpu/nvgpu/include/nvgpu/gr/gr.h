@@ -352,6 +352,22 @@ int nvgpu_gr_enable_ctxsw(struct gk20a *g);
 int nvgpu_gr_reset(struct gk20a *g);
 #endif
 
+#ifdef CONFIG_NVGPU_DEBUGGER
+/**
+ * @brief Start building the HWPM maps of all GR instances.
+ *
+ * @param g [in]	Pointer to GPU driver struct.
+ *
+ * Starts a background build of each HWPM map set up by
+ * nvgpu_gr_init_support() that is not built yet, so that the first
+ * profiler session does not wait for it. Must be called after
+ * nvgpu_gr_init_support().
+ *
+ * @return 0.
+ */
+int nvgpu_gr_build_hwpm_maps(struct gk20a *g);
+#endif
+
 /** @cond DOXYGEN_SHOULD_SKIP_THIS */
 void nvgpu_gr_init_reset_enable_hw_non_ctx_local(struct gk20a *g);
 void nvgpu_gr_init_reset_enable_hw_non_ctx_global(struct gk20a *g);
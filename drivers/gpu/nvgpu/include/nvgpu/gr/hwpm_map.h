@@ -26,6 +26,10 @@
 #ifdef CONFIG_NVGPU_DEBUGGER
 
 #include <nvgpu/types.h>
+#include <nvgpu/atomic.h>
+#include <nvgpu/kref.h>
+#include <nvgpu/lock.h>
+#include <nvgpu/thread.h>
 
 struct gk20a;
 struct ctxsw_buf_offset_map_entry;
@@ -36,11 +40,73 @@ struct ctxsw_buf_offset_map_entry {
 	u32 offset;	/* Offset in ctxt switch buffer */
 };
 
+/*
+ * Map statistics, as returned by nvgpu_gr_hwpm_map_get_stats().
+ */
+struct nvgpu_gr_hwpm_map_stats {
+	/* Registers in the map, and slots of its hash table. */
+	u32 count;
+	u32 slots;
+	/* Longest probe sequence of a register in the hash table. */
+	u32 max_probe;
+	/* Time taken to build the map. */
+	u64 build_ns;
+	/* Offset lookups, and those for registers not in the map. */
+	u64 lookups;
+	u64 misses;
+};
+
+/*
+ * GPC of the GR instance a map is built for. GPCs are in logical order.
+ */
+struct nvgpu_gr_hwpm_map_gpc {
+	u32 phys_id;
+	u32 num_tpcs;
+	u32 num_ppcs;
+};
+
 struct nvgpu_gr_hwpm_map {
+	struct gk20a *g;
 	u32 pm_ctxsw_image_size;
 
+	/* Held by each GR instance using the map. */
+	struct nvgpu_ref ref;
+
+	/*
+	 * Serializes building the map. Once init is set the map is read-only
+	 * and lookups do not take the lock.
+	 */
+	struct nvgpu_mutex lock;
+	struct nvgpu_thread build_thread;
+	bool build_started;
+
+	/*
+	 * Layout the map is built for, copied from the GR config and read
+	 * from h/w before the build so that the build can run with the GPU
+	 * idle, and after the GR instance that set it up is removed. Not
+	 * changed once gpcs is set.
+	 */
+	u32 num_gpcs;
+	struct nvgpu_gr_hwpm_map_gpc *gpcs;
+	u32 num_fbps;
+	u32 num_ltc;
+	u32 active_fbpa_mask;
+
+	/*
+	 * Open addressed hash table of the registers, keyed by address and
+	 * probed linearly. It has a power of 2 number of slots, at least
+	 * twice the number of registers. Free slots have an address of
+	 * U32_MAX.
+	 */
 	u32 count;
+	u32 hash_shift;
+	u32 hash_mask;
 	struct ctxsw_buf_offset_map_entry *map;
+	u32 max_probe;
+
+	u64 build_ns;
+	nvgpu_atomic64_t lookups;
+	nvgpu_atomic64_t misses;
 
 	bool init;
 };
@@ -50,11 +116,49 @@ int nvgpu_gr_hwpm_map_init(struct gk20a *g, struct nvgpu_gr_hwpm_map **hwpm_map,
 void nvgpu_gr_hwpm_map_deinit(struct gk20a *g,
 	struct nvgpu_gr_hwpm_map *hwpm_map);
 
+/*
+ * Take a reference on a map for another GR instance. The reference is
+ * dropped by nvgpu_gr_hwpm_map_deinit().
+ */
+struct nvgpu_gr_hwpm_map *nvgpu_gr_hwpm_map_get(
+	struct nvgpu_gr_hwpm_map *hwpm_map);
+
+/*
+ * Copy the layout of GR instance \a gr_instance_id, with GR config \a config,
+ * into the map. Returns 0 if the layout was already set.
+ */
+int nvgpu_gr_hwpm_map_setup(struct gk20a *g,
+	struct nvgpu_gr_hwpm_map *hwpm_map, struct nvgpu_gr_config *config,
+	u32 gr_instance_id);
+
+/*
+ * Return true if both maps have been set up with the same PM ctxsw image
+ * size and the same layout, which gives the same map.
+ */
+bool nvgpu_gr_hwpm_map_is_compatible(struct nvgpu_gr_hwpm_map *hwpm_map,
+	struct nvgpu_gr_hwpm_map *other);
+
+/*
+ * Start building a map that has been set up in a background thread. Does
+ * nothing if the map is built or its build was started. If the thread can
+ * not be started, the map is built by the first lookup.
+ */
+void nvgpu_gr_hwpm_map_build_async(struct gk20a *g,
+	struct nvgpu_gr_hwpm_map *hwpm_map);
+
 u32 nvgpu_gr_hwpm_map_get_size(struct nvgpu_gr_hwpm_map *hwpm_map);
 
+/*
+ * Find the offset of a register in the PM ctxsw image, building the map if
+ * needed. A map that was not set up is set up for \a config of the current
+ * GR instance.
+ */
 int nvgpu_gr_hwmp_map_find_priv_offset(struct gk20a *g,
 	struct nvgpu_gr_hwpm_map *hwpm_map,
 	u32 addr, u32 *priv_offset, struct nvgpu_gr_config *config);
 
+void nvgpu_gr_hwpm_map_get_stats(struct nvgpu_gr_hwpm_map *hwpm_map,
+	struct nvgpu_gr_hwpm_map_stats *stats);
+
 #endif /* CONFIG_NVGPU_DEBUGGER */
 #endif /* NVGPU_GR_HWPM_MAP_H */
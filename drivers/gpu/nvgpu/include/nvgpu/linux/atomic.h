@@ -193,4 +193,7 @@ static inline bool nvgpu_atomic64_sub_and_test_impl(long x, nvgpu_atomic64_t *v)
 	return atomic64_sub_and_test(x, &v->atomic_var);
 }
 
+#define nvgpu_atomic_cmpxchg_ptr_impl(p, old, new)	cmpxchg((p), (old), (new))
+#define nvgpu_atomic_xchg_ptr_impl(p, new)		xchg((p), (new))
+
 #endif /*__NVGPU_ATOMIC_LINUX_H__ */
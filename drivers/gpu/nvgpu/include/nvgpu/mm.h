@@ -167,6 +167,7 @@
 #include <nvgpu/sizes.h>
 #include <nvgpu/mmu_fault.h>
 #include <nvgpu/fb.h>
+#include <nvgpu/worker.h>
 
 struct gk20a;
 struct vm_gk20a;
@@ -369,6 +370,23 @@ struct mm_gk20a {
 	/** Disable big page support. */
 	bool disable_bigpage;
 
+	/**
+	 * Worker whose shard threads write the PTEs of large mappings, see
+	 * nvgpu_gmmu_pt_workers_init().
+	 */
+	struct nvgpu_worker pt_worker;
+	/**
+	 * Number of pt_worker threads. 0 writes all PTEs on the caller. Set
+	 * from the platform data (gmmu_pt_threads) on Linux.
+	 */
+	u32 pt_parallel_threads;
+	/** Updates of at least this many bytes are written in parallel. */
+	u64 pt_parallel_min_size;
+	/** Signalled when the worker threads finish a parallel update. */
+	struct nvgpu_cond pt_parallel_done;
+	/** True while pt_worker is running. */
+	bool pt_parallel_ready;
+
 	/**
 	 * 4K bytes memory which is used for memory scrubbing
 	 * during GPU poweron.
@@ -163,6 +163,21 @@ page_alloc_slab_page_from_list_entry(struct nvgpu_list_node *node)
 	((uintptr_t)node - offsetof(struct page_alloc_slab_page, list_entry));
 };
 
+/**
+ * Entry of the chunk index used to look up the SGL holding a given byte
+ * offset of a #nvgpu_page_alloc without walking the SGL list.
+ */
+struct nvgpu_page_alloc_chunk {
+	/**
+	 * Byte offset of the chunk from the start of the allocation.
+	 */
+	u64 offset;
+	/**
+	 * SGL describing the chunk.
+	 */
+	void *sgl;
+};
+
 /**
  * Struct to handle internal management of page allocation. It holds a list
  * of the chunks of pages that make up the overall allocation - much like a
@@ -198,6 +213,21 @@ struct nvgpu_page_alloc {
 	 * Pointer to the slab page that owns this particular allocation.
 	 */
 	struct page_alloc_slab_page *slab_page;
+
+	/**
+	 * Sorted index of the chunks, built on demand by PRAMIN accesses
+	 * into allocations with many chunks. Has @nr_chunks entries.
+	 */
+	struct nvgpu_page_alloc_chunk *chunk_index;
+	/**
+	 * SGL touched by the last PRAMIN access and its byte offset in the
+	 * allocation. Protected, like @chunk_index, by mm.pramin_window_lock.
+	 */
+	void *pramin_sgl;
+	/**
+	 * Byte offset of @pramin_sgl from the start of the allocation.
+	 */
+	u64 pramin_sgl_offset;
 };
 
 /**
@@ -36,6 +36,13 @@ struct gk20a;
 struct vm_gk20a;
 struct nvgpu_mem;
 struct gk20a_mmu_level;
+struct nvgpu_pd_stage;
+
+/**
+ * Number of 32-bit words a #nvgpu_pd_stage can hold before it must be
+ * flushed to the PD. 256 words covers 128 two-word PTEs.
+ */
+#define NVGPU_PD_STAGE_WORDS	256U
 
 /**
  * GMMU page directory. This is the kernel's tracking of a list of PDEs or PTEs
@@ -73,6 +80,36 @@ struct nvgpu_gmmu_pd {
 	 * number of bits.
 	 */
 	u32			 num_entries;
+	/**
+	 * Staging buffer collecting writes to this PD. Only set between
+	 * nvgpu_pd_stage_begin() and nvgpu_pd_stage_end().
+	 */
+	struct nvgpu_pd_stage	*stage;
+};
+
+/**
+ * Sysmem staging buffer for PD writes. Vidmem PDs are written through the
+ * PRAMIN window, where each nvgpu_mem_wr32() costs a window programming, a
+ * read back and a write barrier. Collecting a contiguous run of words here
+ * lets the run be flushed with a single nvgpu_mem_wr_n().
+ */
+struct nvgpu_pd_stage {
+	/**
+	 * PD the staged words belong to.
+	 */
+	struct nvgpu_gmmu_pd	*pd;
+	/**
+	 * Word offset, relative to the start of the PD, of words[0].
+	 */
+	u32			 start;
+	/**
+	 * Number of valid words in @words.
+	 */
+	u32			 count;
+	/**
+	 * Staged PD contents.
+	 */
+	u32			 words[NVGPU_PD_STAGE_WORDS];
 };
 
 /**
@@ -174,13 +211,45 @@ u32  nvgpu_pd_offset_from_index(const struct gk20a_mmu_level *l, u32 pd_idx);
  *
  * Write data content into pd mem:
  * Offset = ((start address of the pd / 4 + @w).
- * Write data content into offset address by calling #nvgpu_mem_wr32().
+ * Write data content into offset address by calling #nvgpu_mem_wr32(),
+ * or into the staging buffer if one is attached to \a pd.
  *
  * @return	None
  */
 void nvgpu_pd_write(struct gk20a *g, struct nvgpu_gmmu_pd *pd,
 		    size_t w, u32 data);
 
+/**
+ * @brief Start staging writes to a PD.
+ *
+ * @param g	[in]	The GPU.
+ * @param stage	[in]	Staging buffer to use.
+ * @param pd	[in]	Pointer to GMMU page directory structure.
+ *
+ * Attach \a stage to \a pd so that subsequent #nvgpu_pd_write() calls on
+ * \a pd are collected in sysmem. Contiguous runs are flushed with a single
+ * #nvgpu_mem_wr_n(). Staging is only used for vidmem PDs; sysmem PDs are
+ * written directly and are left untouched. The caller must serialize use
+ * of \a stage, e.g. by holding the VM's update_gmmu_lock.
+ *
+ * @return	None
+ */
+void nvgpu_pd_stage_begin(struct gk20a *g, struct nvgpu_pd_stage *stage,
+			  struct nvgpu_gmmu_pd *pd);
+
+/**
+ * @brief Flush staged writes and stop staging a PD.
+ *
+ * @param g	[in]	The GPU.
+ * @param pd	[in]	Pointer to GMMU page directory structure.
+ *
+ * Write out any words still held in the staging buffer attached to \a pd
+ * and detach it. Does nothing if \a pd is not being staged.
+ *
+ * @return	None
+ */
+void nvgpu_pd_stage_end(struct gk20a *g, struct nvgpu_gmmu_pd *pd);
+
 /**
  * @brief Return the _physical_ address of a page directory.
  *
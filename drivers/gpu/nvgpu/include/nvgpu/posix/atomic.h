@@ -645,4 +645,37 @@ static inline bool nvgpu_atomic64_sub_and_test_impl(long x, nvgpu_atomic64_t *v)
 	return NVGPU_POSIX_ATOMIC_SUB_RETURN(v, x) == 0;
 }
 
+/**
+ * @brief POSIX implementation of pointer compare and exchange.
+ *
+ * @param p	Address of the pointer.
+ * @param old	Value to compare.
+ * @param new	Value to store.
+ *
+ * Uses the GCC builtin on the plain pointer at \a p with sequentially
+ * consistent ordering.
+ *
+ * @return The pointer stored at \a p before the operation.
+ */
+#define nvgpu_atomic_cmpxchg_ptr_impl(p, old, new)			\
+	({								\
+		typeof(*(p)) tmp = (old);				\
+									\
+		(void) __atomic_compare_exchange_n((p), &tmp, (new),	\
+				false, __ATOMIC_SEQ_CST,		\
+				__ATOMIC_SEQ_CST);			\
+		tmp;							\
+	})
+
+/**
+ * @brief POSIX implementation of pointer exchange.
+ *
+ * @param p	Address of the pointer.
+ * @param new	Value to store.
+ *
+ * @return The pointer stored at \a p before the operation.
+ */
+#define nvgpu_atomic_xchg_ptr_impl(p, new)				\
+	__atomic_exchange_n((p), (new), __ATOMIC_SEQ_CST)
+
 #endif /* NVGPU_POSIX_ATOMIC_H */
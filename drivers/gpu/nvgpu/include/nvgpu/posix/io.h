@@ -99,6 +99,8 @@ nvgpu_posix_io_reg_space_from_link(struct nvgpu_list_node *node)
 };
 
 void nvgpu_posix_io_init_reg_space(struct gk20a *g);
+/* free the register space lookup index and the access recorder */
+void nvgpu_posix_io_fini_reg_space(struct gk20a *g);
 int nvgpu_posix_io_get_error_code(struct gk20a *g);
 void nvgpu_posix_io_reset_error_code(struct gk20a *g);
 
@@ -117,17 +119,11 @@ void nvgpu_posix_io_unregister_reg_space(struct gk20a *g,
 void nvgpu_posix_io_writel_reg_space(struct gk20a *g, u32 addr, u32 data);
 u32 nvgpu_posix_io_readl_reg_space(struct gk20a *g, u32 addr);
 
-struct nvgpu_posix_io_reg_access {
-	struct nvgpu_reg_access access;
-	struct nvgpu_list_node link;
-};
-
-static inline struct nvgpu_posix_io_reg_access *
-nvgpu_posix_io_reg_access_from_link(struct nvgpu_list_node *node)
-{
-	return (struct nvgpu_posix_io_reg_access *)
-	   ((uintptr_t)node - offsetof(struct nvgpu_posix_io_reg_access, link));
-};
+/*
+ * Number of register accesses the recorder keeps. Older accesses are dropped
+ * once the recorder is full.
+ */
+#define NVGPU_POSIX_IO_RECORDER_SIZE	4096U
 
 void nvgpu_posix_io_start_recorder(struct gk20a *g);
 void nvgpu_posix_io_record_access(struct gk20a *g,
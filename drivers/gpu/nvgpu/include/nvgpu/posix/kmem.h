@@ -150,6 +150,40 @@ void nvgpu_kfree_impl(struct gk20a *g, void *addr);
  */
 void nvgpu_vfree_impl(struct gk20a *g, void *addr);
 
+struct nvgpu_kmem_cache;
+
+/**
+ * Object counts of a kmem cache.
+ */
+struct nvgpu_kmem_cache_stats {
+	/** Number of slabs allocated for the cache. */
+	u64 nr_slabs;
+	/** Number of objects handed out. */
+	u64 nr_allocs;
+	/** Number of objects returned. */
+	u64 nr_frees;
+	/** Number of objects currently in use. */
+	u64 nr_active;
+	/**
+	 * Number of objects carved out of slabs. Freed objects are reused
+	 * first, so this follows the peak number of objects in use.
+	 */
+	u64 nr_objs;
+};
+
+/**
+ * @brief Get the object counts of a kmem cache.
+ *
+ * Copies the statistics of \a cache into \a stats. The same numbers are
+ * logged with #gpu_dbg_kmem when the cache is destroyed. Function does not
+ * perform any validation of the parameters.
+ *
+ * @param cache [in]	Cache created with #nvgpu_kmem_cache_create().
+ * @param stats [out]	Statistics of the cache.
+ */
+void nvgpu_kmem_cache_get_stats(struct nvgpu_kmem_cache *cache,
+				struct nvgpu_kmem_cache_stats *stats);
+
 #ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
 /**
  * @brief Get fault injection structure.
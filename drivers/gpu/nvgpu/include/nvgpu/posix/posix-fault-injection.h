@@ -32,10 +32,31 @@ struct nvgpu_posix_fault_inj {
 	unsigned long bitmask;
 };
 
+/**
+ * Counts of calls into the POSIX layer. Benchmarks read these before and
+ * after a code path to find out how many allocations and lock acquisitions
+ * it makes.
+ */
+struct nvgpu_posix_call_stats {
+	/** Allocations made through the kmem API. */
+	unsigned long kmem_allocs;
+	/**
+	 * Mutex, spinlock and rwsem acquisitions. The inline
+	 * nvgpu_spinlock_irqsave() is not counted.
+	 */
+	unsigned long lock_acquires;
+};
+
 /**
  * Container for all fault injection instances.
  */
 struct nvgpu_posix_fault_inj_container {
+	/*
+	 * Not a fault injection instance, but shared by the same threads.
+	 * Threads sharing a container must not be measured concurrently.
+	 */
+	struct nvgpu_posix_call_stats call_stats;
+
 	/* nvgpu-core */
 	struct nvgpu_posix_fault_inj thread_fi;
 	struct nvgpu_posix_fault_inj thread_running_true_fi;
@@ -152,6 +173,13 @@ void nvgpu_posix_init_fault_injection
 struct nvgpu_posix_fault_inj_container
 	*nvgpu_posix_fault_injection_get_container(void);
 
+/**
+ * @brief Get the call counts of this thread.
+ * @return A pointer to the call counts in the fault injection container of
+ * this thread, or NULL if the thread has no container.
+ */
+struct nvgpu_posix_call_stats *nvgpu_posix_get_call_stats(void);
+
 /**
  * nvgpu_posix_enable_fault_injection - Enable/Disable fault injection for the
  *                                      object after @number calls to the
@@ -108,5 +108,13 @@ bool reg_op_is_gr_ctx(u8 type);
 bool reg_op_is_read(u8 op);
 bool is_bar0_global_offset_whitelisted_gk20a(struct gk20a *g, u32 offset);
 
+/*
+ * Build the allowlist of the chip's global, context and runcontrol regops
+ * lists that validation uses instead of searching the lists. Does nothing
+ * if it is already built. Without it ops are checked against the lists.
+ */
+int nvgpu_regops_allowlist_init(struct gk20a *g);
+void nvgpu_regops_allowlist_deinit(struct gk20a *g);
+
 #endif /* CONFIG_NVGPU_DEBUGGER */
 #endif /* NVGPU_REGOPS_H */
@@ -26,6 +26,7 @@
 #include <nvgpu/types.h>
 #include <nvgpu/nvgpu_mem.h>
 #include <nvgpu/lock.h>
+#include <nvgpu/list.h>
 
 /**
  * @file
@@ -91,6 +92,37 @@ struct nvgpu_runlist_mem {
 	u32 count;
 };
 
+/*
+ * Encoded runlist entries of one TSG: the TSG header entry followed by the
+ * entries of the TSG's channels that are active in the owning domain. The
+ * runlist buffer is assembled by copying these blocks, so a TSG only gets
+ * re-encoded when its own state has changed.
+ */
+struct nvgpu_runlist_tsg_block {
+	/** Entry in nvgpu_runlist_domain::level_tsgs for #level. */
+	struct nvgpu_list_node level_entry;
+	/** Interleave level list this block is currently queued on. */
+	u32 level;
+	/** TSG described by this block; also its index in the block array. */
+	u32 tsgid;
+	/** Encoded entries, nvgpu_fifo::runlist_entry_size bytes each. */
+	u32 *entries;
+	/** Number of valid entries in #entries. */
+	u32 num_entries;
+	/** Number of entries #entries has room for. */
+	u32 max_entries;
+	/** The entries are stale and must be encoded again before use. */
+	bool dirty;
+};
+
+static inline struct nvgpu_runlist_tsg_block *
+nvgpu_runlist_tsg_block_from_level_entry(struct nvgpu_list_node *node)
+{
+	return (struct nvgpu_runlist_tsg_block *)
+	((uintptr_t)node - offsetof(struct nvgpu_runlist_tsg_block,
+				   level_entry));
+}
+
 /*
  * Data interface to be owned by another SW unit. The heart of the domain
  * scheduler can be running outside nvgpu and as such cannot own these.
@@ -132,6 +164,14 @@ struct nvgpu_runlist_domain {
 	/** Bitmap of active TSGs in the runlist domain. One bit per tsgid. */
 	unsigned long *active_tsgs;
 
+	/** Cached runlist entries of each TSG, indexed by tsgid. */
+	struct nvgpu_runlist_tsg_block *tsg_blocks;
+	/**
+	 * Blocks of the active TSGs, one list per interleave level, sorted by
+	 * tsgid. Walked instead of #active_tsgs when building the runlist.
+	 */
+	struct nvgpu_list_node level_tsgs[NVGPU_FIFO_RUNLIST_INTERLEAVE_NUM_LEVELS];
+
 	/** Runlist buffer free to use in sw. Swapped with another mem on next load. */
 	struct nvgpu_runlist_mem *mem;
 
@@ -165,6 +205,16 @@ struct nvgpu_runlist {
 	/** Protect ch/tsg/runlist preempt & runlist update. */
 	struct nvgpu_mutex runlist_lock;
 
+	/**
+	 * Protect #batch_add_chids and #batch_remove_chids. Taken with
+	 * #runlist_lock held, never the other way round.
+	 */
+	struct nvgpu_mutex batch_lock;
+	/** Channels queued for addition by runlist batches. */
+	unsigned long *batch_add_chids;
+	/** Channels queued for removal by runlist batches. */
+	unsigned long *batch_remove_chids;
+
 	/** @cond DOXYGEN_SHOULD_SKIP_THIS */
 	/* Ampere+ runlist info additions */
 
@@ -205,6 +255,9 @@ void nvgpu_runlist_tick(struct gk20a *g);
  * buffer #buf_id. This buffer can afterwards be submitted to H/W
  * to be used for scheduling.
  *
+ * TSG entries are copied from the per-TSG blocks cached in the domain; only
+ * blocks marked dirty since the previous construction are encoded again.
+ *
  * Note: Caller must hold runlist_lock before invoking this function.
  *
  * @return Number of entries in the runlist.
@@ -300,6 +353,95 @@ int nvgpu_runlist_reload(struct gk20a *g, struct nvgpu_runlist *rl,
 		struct nvgpu_runlist_domain *domain,
 		bool add, bool wait_for_finish);
 
+/**
+ * Set of runlist changes to be applied together, see
+ * #nvgpu_runlist_batch_begin.
+ */
+struct nvgpu_runlist_batch {
+	/** The GPU driver struct owning the runlists. */
+	struct gk20a *g;
+	/** Runlists with queued channel changes, one bit per runlist_id. */
+	u32 runlist_ids;
+	/** Runlists to be rebuilt with all active channels. */
+	u32 reload_ids;
+	/** Runlists to be submitted empty. */
+	u32 clear_ids;
+	/** Last error seen while queueing or committing. */
+	int err;
+};
+
+/**
+ * @brief Start a batch of runlist updates
+ *
+ * @param g [in]		The GPU driver struct owning the runlists.
+ * @param batch [out]		Batch to initialize.
+ *
+ * Channel add/remove operations queued with #nvgpu_runlist_batch_queue and
+ * runlist reloads queued with #nvgpu_runlist_batch_queue_reload are only
+ * recorded. #nvgpu_runlist_batch_commit then rebuilds and submits each
+ * affected runlist once, no matter how many channels of it were touched.
+ *
+ * Queued channels are kept in bitmaps of their runlist, allocated with the
+ * runlists and shared by all batches. A commit applies every operation
+ * queued on its runlists, including those of batches not yet committed,
+ * which is the same as those batches committing earlier. No lock is held
+ * between the calls, but a batch must not be queued to or committed while
+ * holding a runlist_lock.
+ */
+void nvgpu_runlist_batch_begin(struct gk20a *g,
+		struct nvgpu_runlist_batch *batch);
+
+/**
+ * @brief Queue a channel add/remove operation
+ *
+ * @param batch [in]		Batch started with #nvgpu_runlist_batch_begin.
+ * @param ch [in]		Channel to be added/removed.
+ * @param add [in]		True to add the channel, false to remove it.
+ *
+ * Same as #nvgpu_runlist_update, but deferred to the commit. A later
+ * operation on the same channel overrides an earlier one. The channel must
+ * stay bound to its TSG until the batch has been committed.
+ */
+void nvgpu_runlist_batch_queue(struct nvgpu_runlist_batch *batch,
+		struct nvgpu_channel *ch, bool add);
+
+/**
+ * @brief Queue a reload of a set of runlists
+ *
+ * @param batch [in]		Batch started with #nvgpu_runlist_batch_begin.
+ * @param runlist_ids [in]	Bitmask of runlists, one bit per runlist_id.
+ * @param add [in]		True to submit a runlist buffer with all active
+ *				channels. False to submit an empty runlist
+ *				buffer.
+ *
+ * Same as #nvgpu_runlist_reload on the active domain of each runlist, but
+ * deferred to the commit.
+ */
+void nvgpu_runlist_batch_queue_reload(struct nvgpu_runlist_batch *batch,
+		u32 runlist_ids, bool add);
+
+/**
+ * @brief Apply all queued runlist changes
+ *
+ * @param batch [in]		Batch started with #nvgpu_runlist_batch_begin.
+ * @param wait_for_finish [in]	True to wait for runlist update completion.
+ *
+ * Takes the runlist_lock of every affected runlist, applies the queued
+ * changes, rebuilds each changed domain once and submits all runlists
+ * before waiting for any of them, so that they switch over in parallel. If
+ * another commit already applied the operations queued on a runlist, this
+ * still waits for that runlist. The batch must be started again before
+ * reuse.
+ *
+ * @return 0 in case of success, < 0 in case of failure.
+ * @retval -EINVAL if a queued channel was not bound to a TSG.
+ * @retval -ETIMEDOUT if runlist update takes too long for one of the runlists.
+ * @retval -E2BIG in case there are not enough entries in one runlist buffer
+ *         to accommodate all active channels/TSGs.
+ */
+int nvgpu_runlist_batch_commit(struct nvgpu_runlist_batch *batch,
+		bool wait_for_finish);
+
 /**
  * @brief Reload a set of runlists
  *
@@ -311,6 +453,7 @@ int nvgpu_runlist_reload(struct gk20a *g, struct nvgpu_runlist *rl,
  *
  * This function is similar to nvgpu_runlist_reload, but takes a set of
  * runlists as a parameter. It also always waits for runlist update completion.
+ * All runlists are submitted before waiting for any of them.
  *
  * @return 0 in case of success, < 0 in case of failure.
  * @retval -ETIMEDOUT if runlist update takes too long for one of the runlists.
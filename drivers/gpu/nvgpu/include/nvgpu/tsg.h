@@ -339,6 +339,26 @@ void nvgpu_tsg_cleanup_sw(struct gk20a *g);
  */
 struct nvgpu_tsg *nvgpu_tsg_from_ch(struct nvgpu_channel *ch);
 
+/**
+ * @brief Get pointer to #nvgpu_tsg from a channel instance block address.
+ *
+ * @param g [in]		The GPU driver struct.
+ * @param inst_ptr [in]		Instance block physical address.
+ * @param refch [out]		Channel that uses \a inst_ptr.
+ *
+ * Look up the channel with #nvgpu_channel_refch_from_inst_ptr and return
+ * the TSG it is bound to. The channel reference is kept and returned in
+ * \a refch, so that the channel stays bound to the TSG until the caller
+ * drops it with #nvgpu_channel_put.
+ *
+ * @return Pointer to #nvgpu_tsg struct.
+ * @retval NULL if no alive channel uses \a inst_ptr, or if that channel
+ *         is not bound to a TSG. \a refch is NULL and no reference is
+ *         held then.
+ */
+struct nvgpu_tsg *nvgpu_tsg_from_inst_ptr(struct gk20a *g, u64 inst_ptr,
+					  struct nvgpu_channel **refch);
+
 /**
  * @brief Disable all the channels bound to a TSG.
  *
@@ -67,6 +67,7 @@
 #ifndef NVGPU_VM_H
 #define NVGPU_VM_H
 
+#include <nvgpu/atomic.h>
 #include <nvgpu/kref.h>
 #include <nvgpu/list.h>
 #include <nvgpu/rbtree.h>
@@ -79,6 +80,7 @@
 struct vm_gk20a;
 struct nvgpu_vm_area;
 struct nvgpu_sgt;
+struct nvgpu_gmmu_pt_batch;
 struct gk20a_comptag_allocator;
 struct nvgpu_channel;
 
@@ -121,6 +123,90 @@ struct vm_gk20a_mapping_batch {
 	 * The field describes whether the TLB invalidation is needed or not.
 	 */
 	bool need_tlb_invalidate;
+
+	/**
+	 * Set by the caller when the next map only adds translations over
+	 * unmapped or sparse PTEs, i.e. no translation to memory that may be
+	 * released is replaced. The TLB invalidate for such a map may then be
+	 * deferred until the next submit on the VM.
+	 */
+	bool defer_tlb_invalidate;
+};
+
+/**
+ * Maximum number of disjoint dirty VA ranges tracked per VM. Recording more
+ * makes the next flush invalidate the whole TLB for the VM.
+ */
+#define NVGPU_VM_TLB_DIRTY_RANGES	8U
+
+/**
+ * A GPU VA range [start, end) whose translations changed.
+ */
+struct nvgpu_vm_tlb_range {
+	/** First byte of the range. */
+	u64 start;
+	/** First byte past the range. */
+	u64 end;
+};
+
+/**
+ * Tracks GPU VA ranges whose PTEs changed since the last TLB invalidate of
+ * a VM. Invalidates from several map/unmap calls are coalesced here and
+ * issued as range invalidates when the HAL supports them, or as a single
+ * invalidate of the whole VM otherwise.
+ *
+ * Everything but @pending is protected by vm.update_gmmu_lock.
+ */
+struct nvgpu_vm_tlb_tracker {
+	/**
+	 * Non-zero while dirty ranges wait for an invalidate. Read without
+	 * the lock by the submit path.
+	 */
+	nvgpu_atomic_t pending;
+	/** Number of valid entries in @ranges. */
+	u32 nr_ranges;
+	/** More than #NVGPU_VM_TLB_DIRTY_RANGES disjoint ranges recorded. */
+	bool overflow;
+	/**
+	 * Set once the VM may run work not submitted through the kernel, e.g.
+	 * from a usermode submit channel. Map invalidates are not deferred
+	 * after that.
+	 */
+	bool no_defer;
+	/** Dirty ranges, sorted and disjoint. */
+	struct nvgpu_vm_tlb_range ranges[NVGPU_VM_TLB_DIRTY_RANGES];
+
+	/** Number of whole VM TLB invalidates issued. */
+	u64 nr_full_invalidates;
+	/** Number of range TLB invalidates issued. */
+	u64 nr_range_invalidates;
+	/** Number of map invalidates deferred to the next submit. */
+	u64 nr_deferred;
+};
+
+/**
+ * A part of a buffer mapping that uses a single GMMU page size.
+ */
+struct nvgpu_mapped_buf_seg {
+	/** Offset of the segment from the start of the mapping. */
+	u64 offset;
+	/** Size of the segment. */
+	u64 size;
+	/** Page size index used for the segment. */
+	u32 pgsz_idx;
+};
+
+/**
+ * Page size usage of the buffers mapped with #nvgpu_vm_map() into a VM.
+ * Protected by vm.update_gmmu_lock.
+ */
+struct nvgpu_vm_page_stats {
+	/** Pages currently mapped, per GMMU page size index. */
+	u64 mapped_pages[GMMU_NR_PAGE_SIZES];
+	/** Live mappings that mix big and small pages. */
+	u64 nr_mixed_maps;
+	/** Bytes of the live mixed mappings that use big pages. */
+	u64 mixed_big_bytes;
 };
 
 /**
@@ -194,6 +280,17 @@ struct nvgpu_mapped_buf {
 	 * Aperture specified when mapping was created
 	 */
 	enum nvgpu_aperture aperture;
+	/**
+	 * Page size segments of a mapping that uses both big and small
+	 * pages, NULL when the whole mapping uses pgsz_idx.
+	 */
+	struct nvgpu_mapped_buf_seg *segs;
+	/** Number of entries in segs. */
+	u32 nr_segs;
+	/** Start of the GPU VA allocation backing a mixed page mapping. */
+	u64 va_base;
+	/** Size of the GPU VA allocation at va_base. */
+	u64 va_size;
 
 	/**
 	 * Os specific buffer structure.
@@ -285,6 +382,25 @@ struct vm_gk20a {
 	 * It describes the list of PDEs or PTEs associated in the GMMU.
 	 */
 	struct nvgpu_gmmu_pd pdb;
+	/**
+	 * Staging buffer for PTE writes. Protected by update_gmmu_lock.
+	 */
+	struct nvgpu_pd_stage pd_stage;
+	/**
+	 * VA ranges waiting for a TLB invalidate.
+	 */
+	struct nvgpu_vm_tlb_tracker tlb;
+	/**
+	 * Leaf page table writes being collected for the worker threads,
+	 * NULL unless a large update is in progress. Protected by
+	 * update_gmmu_lock.
+	 */
+	struct nvgpu_gmmu_pt_batch *pt_batch;
+	/**
+	 * Page sizes used by the mapped buffers. Protected by
+	 * update_gmmu_lock.
+	 */
+	struct nvgpu_vm_page_stats page_stats;
 
 	/**
 	 * Pointers to different types of page allocators.
@@ -351,6 +467,11 @@ struct vm_gk20a {
 #define NVGPU_VM_MAP_L3_ALLOC				BIT32(5)
 #define NVGPU_VM_MAP_PLATFORM_ATOMIC			BIT32(6)
 #define NVGPU_VM_MAP_TEGRA_RAW				BIT32(7)
+/*
+ * Allow a mapping that falls back to small pages to map its big page aligned
+ * interior with big pages, see nvgpu_vm_get_page_stats().
+ */
+#define NVGPU_VM_MAP_MIXED_PAGES			BIT32(8)
 
 #define NVGPU_VM_MAP_ACCESS_DEFAULT			0U
 #define NVGPU_VM_MAP_ACCESS_READ_ONLY			1U
@@ -481,6 +602,74 @@ void nvgpu_vm_mapping_batch_finish(
 void nvgpu_vm_mapping_batch_finish_locked(
 	struct vm_gk20a *vm, struct vm_gk20a_mapping_batch *mapping_batch);
 
+/**
+ * @brief Issue TLB invalidates deferred by earlier maps.
+ *
+ * @param vm [in]		Pointer to virtual memory context.
+ *
+ * Called from the submit path before new work can reach the GPU.
+ * - Return right away if vm.tlb has nothing pending.
+ * - Acquire the vm.update_gmmu_lock.
+ * - Invalidate the dirty ranges, see #nvgpu_gmmu_tlb_flush_dirty().
+ * - Release the lock hold.
+ *
+ * @return			Zero on success, error code from the TLB
+ *				invalidate HAL otherwise.
+ */
+int nvgpu_vm_tlb_flush_deferred(struct vm_gk20a *vm);
+
+/**
+ * @brief Stop deferring TLB invalidates for a VM.
+ *
+ * @param vm [in]		Pointer to virtual memory context.
+ *
+ * Used when work can reach the GPU without going through the submit path,
+ * e.g. when a usermode submit channel is bound to \a vm. Issues anything
+ * still pending and makes all later map invalidates immediate.
+ *
+ * @return			None.
+ */
+void nvgpu_vm_tlb_disable_defer(struct vm_gk20a *vm);
+
+/**
+ * @brief Get the page size usage of a virtual memory context.
+ *
+ * @param vm [in]		Pointer to virtual memory context.
+ * @param stats [out]		Copy of vm.page_stats.
+ *
+ * Buffers mapped with #nvgpu_vm_map() are accounted. A mapping at a
+ * driver chosen address that asks for NVGPU_VM_MAP_MIXED_PAGES and cannot
+ * use big pages as a whole may still map its aligned interior with big
+ * pages; such mappings are counted in nvgpu_vm_page_stats.nr_mixed_maps.
+ *
+ * @return			None.
+ */
+void nvgpu_vm_get_page_stats(struct vm_gk20a *vm,
+			     struct nvgpu_vm_page_stats *stats);
+
+/**
+ * @brief Change the kind of a range of a mixed page size mapping.
+ *
+ * @param vm [in]		Pointer to virtual memory context.
+ * @param mapped_buffer [in]	Mapping with page size segments.
+ * @param sgt [in]		Memory backing the mapping.
+ * @param kind [in]		New PTE kind.
+ * @param buffer_offset [in]	Start of the range in the mapping.
+ * @param buffer_size [in]	Size of the range.
+ *
+ * Rewrite the PTEs of the range with @kind, each segment with its own page
+ * size. The caller holds vm.update_gmmu_lock.
+ *
+ * @return			Zero on success.
+ * @retval -EINVAL if the range ends inside a big page of the mapping. No
+ *		   PTE is changed then.
+ * @retval -ENOMEM if the GMMU update fails.
+ */
+int nvgpu_vm_mapping_modify_mixed(struct vm_gk20a *vm,
+				  struct nvgpu_mapped_buf *mapped_buffer,
+				  struct nvgpu_sgt *sgt, u8 kind,
+				  u64 buffer_offset, u64 buffer_size);
+
 /**
  * @brief Get the number of buffers mapped in given virtual memory context
  *  and reference to the buffers.
@@ -889,13 +1078,16 @@ u64 nvgpu_vm_alloc_va(struct vm_gk20a *vm, u64 size, u32 pgsz_idx);
  *
  * @param vm [in]	Pointer to VM context.
  * @param addr [in]	Virtual address to be freed.
+ * @param size [in]	Size passed to #nvgpu_vm_alloc_va() for @addr.
  * @param pgsz_idx [in]	Page size index.
  *
  * - Get the #nvgpu_allocator struct.
- * - Free the @addr using the #nvgpu_allocator by calling #nvgpu_free().
+ * - Free the @addr using the #nvgpu_allocator by calling
+ *   #nvgpu_free_sized(), so that an allocator created with #GPU_ALLOC_CACHE
+ *   can hand it out again to an allocation of the same size.
  *
  * @return		None.
  */
-void nvgpu_vm_free_va(struct vm_gk20a *vm, u64 addr, u32 pgsz_idx);
+void nvgpu_vm_free_va(struct vm_gk20a *vm, u64 addr, u64 size, u32 pgsz_idx);
 
 #endif /* NVGPU_VM_H */
@@ -74,6 +74,13 @@ struct nvgpu_worker;
  * 	}
  * 	return 0;
  * }
+ *
+ * A worker can also be created with a number of shards. Each shard is an
+ * additional thread with a work queue of its own, and work items are spread
+ * over the shards by a key given at enqueue time. The main thread then only
+ * runs the hooks other than wakeup_process_item, so a periodic tick driven by
+ * wakeup_timeout and wakeup_post_process keeps running however much work is
+ * queued.
  */
 
 /**
@@ -152,6 +159,41 @@ struct nvgpu_worker_ops {
 	u32 (*wakeup_timeout)(struct nvgpu_worker *worker);
 };
 
+/**
+ * Additional worker thread with its own work queue. See
+ * #nvgpu_worker_init_sharded.
+ */
+struct nvgpu_worker_shard {
+	/**
+	 * The worker this shard belongs to
+	 */
+	struct nvgpu_worker *worker;
+	/**
+	 * Name of the shard thread
+	 */
+	char thread_name[64];
+	/**
+	 * Track number of queue entries
+	 */
+	nvgpu_atomic_t put;
+	/**
+	 * Thread for the shard
+	 */
+	struct nvgpu_thread poll_task;
+	/**
+	 * cond structure for waiting/waking the shard thread
+	 */
+	struct nvgpu_cond wq;
+	/**
+	 * Lock-free stack of queued work items, newest first
+	 */
+	struct nvgpu_list_node *queue;
+	/**
+	 * Non-zero while the thread is processing work items
+	 */
+	nvgpu_atomic_t busy;
+};
+
 /**
  * Metadata object describing a worker.
  */
@@ -177,13 +219,13 @@ struct nvgpu_worker {
 	 */
 	struct nvgpu_cond wq;
 	/**
-	 * List of work items
+	 * Lock-free stack of queued work items, newest first
 	 */
-	struct nvgpu_list_node items;
+	struct nvgpu_list_node *queue;
 	/**
-	 * Lock for access to the work \a items list
+	 * Non-zero while the thread is processing work items
 	 */
-	struct nvgpu_spinlock items_lock;
+	nvgpu_atomic_t busy;
 	/**
 	 * Mutex for controlled starting of the worker thread
 	 */
@@ -192,6 +234,14 @@ struct nvgpu_worker {
 	 * Worker ops functions
 	 */
 	const struct nvgpu_worker_ops *ops;
+	/**
+	 * Shard threads processing the work items, if any
+	 */
+	struct nvgpu_worker_shard *shards;
+	/**
+	 * Number of entries in \a shards
+	 */
+	u32 num_shards;
 };
 
 /**
@@ -214,29 +264,26 @@ struct nvgpu_worker {
 bool nvgpu_worker_should_stop(struct nvgpu_worker *worker);
 
 /**
- * @brief Append a work item to the worker's list.
+ * @brief Append a work item to the worker's queue.
  *
- * This adds work item to the end of the list and wakes the worker
- * up immediately. If the work item already existed in the list, it's not added,
- * because in that case it has been scheduled already but has not yet been
- * processed.
+ * This adds work item to the worker's queue and wakes the worker up if
+ * needed. If the work item is already queued, it's not added, because in that
+ * case it has been scheduled already but has not yet been processed. Items
+ * are processed in the order they were queued.
  * - Checks if the thread associated with \a poll_task in #nvgpu_worker is
  *   already started. If not, try to start the thread. Return -1 if the thread
  *   creation fails.
- * - Function #nvgpu_spinlock_acquire() is called with variable \a
- *   items_lock in #nvgpu_worker as parameter to acquire the lock before
- *   trying to add the work item.
- * - #nvgpu_list_empty is called with \a work_item as parameter to check if the
- *   item is already added or not.
- * - If the item is already added, invoke the function #nvgpu_spinlock_release
- *   with variable \a items_lock in #nvgpu_worker as parameter to release the
- *   lock, and return -1.
- * - Invokes #nvgpu_list_add_tail with \a work_item and \a items in
- *   #nvgpu_worker as parameters to add the work item, if it is not already
- *   present in the list.
- * - Function #nvgpu_spinlock_release() is invoked with variable \a items_lock
- *   in #nvgpu_worker as parameter to release the lock acquired.
- * The worker thread is woken up after the addition of the work item.
+ * - Marks \a work_item as queued with #nvgpu_atomic_cmpxchg_ptr on its prev
+ *   pointer. An empty list node, as set up by #nvgpu_init_list_node, is not
+ *   queued. If the item is already queued, return -1.
+ * - Pushes \a work_item on \a queue in #nvgpu_worker with
+ *   #nvgpu_atomic_cmpxchg_ptr. No lock is taken.
+ * - If the queue was empty, increments \a put in #nvgpu_worker and, unless
+ *   the worker thread is busy processing items and will see the new item
+ *   anyway, signals the worker thread.
+ * The worker thread takes all queued items at once and turns each item back
+ * into an empty list node before processing it, so an item can be queued
+ * again from its own processing callback.
  *
  * @param worker [in] The worker. Function does not perform any validation
  *		      of the parameter.
@@ -251,6 +298,29 @@ bool nvgpu_worker_should_stop(struct nvgpu_worker *worker);
 int nvgpu_worker_enqueue(struct nvgpu_worker *worker,
 		struct nvgpu_list_node *work_item);
 
+/**
+ * @brief Append a work item to the queue of the shard selected by a key.
+ *
+ * Same as #nvgpu_worker_enqueue, but on a worker created with
+ * #nvgpu_worker_init_sharded the item goes to shard \a key modulo the number
+ * of shards, and that shard's thread is woken up instead of the main thread.
+ * Items enqueued with the same key are processed in order by one thread. On
+ * a worker without shards the key is ignored.
+ *
+ * @param worker [in] The worker. Function does not perform any validation
+ *		      of the parameter.
+ * @param work_item [in] The work item for the worker to work on. Function
+ *			 does not perform any validation of the parameter.
+ * @param key [in] Shard selector, e.g. a channel id.
+ *
+ * @return Integer value indicating the status of enqueue operation.
+ *
+ * @retval 0 on success.
+ * @retval -1 on failure.
+ */
+int nvgpu_worker_enqueue_sharded(struct nvgpu_worker *worker,
+		struct nvgpu_list_node *work_item, u32 key);
+
 /**
  * @brief This API is used to initialize the worker with a name that's a
  * conjunction of the two parameters: {worker_name}_{gpu_name}.
@@ -277,10 +347,7 @@ void nvgpu_worker_init_name(struct nvgpu_worker *worker,
  *   #nvgpu_worker and 0 as parameters to initialize the atomic variable.
  * - Invokes the function #nvgpu_cond_init() with variable \a wq in
  *   #nvgpu_worker as parameter to initialize the condition variable.
- * - Invokes the function #nvgpu_init_list_node with variable \a items in
- *   #nvgpu_worker as parameter to initialize the list.
- * - Invokes the function #nvgpu_spinlock_init() with variable \a items_lock in
- *   #nvgpu_worker as parameter to initialize the spin lock.
+ * - Sets \a queue in #nvgpu_worker to NULL and \a busy to 0.
  * - Invokes the function #nvgpu_mutex_init() with variable \a start_lock in
  *   #nvgpu_worker as parameter to initialize the mutex variable.
  * - Starts the thread associated with the \a worker. #nvgpu_thread_create()
@@ -311,6 +378,28 @@ void nvgpu_worker_init_name(struct nvgpu_worker *worker,
 int nvgpu_worker_init(struct gk20a *g, struct nvgpu_worker *worker,
 		const struct nvgpu_worker_ops *worker_ops);
 
+/**
+ * @brief Initialize a worker that processes its work items on several threads.
+ *
+ * Same as #nvgpu_worker_init, and additionally starts \a num_shards shard
+ * threads named {thread_name}_{index}. Work items are then processed by the
+ * shard threads only, see #nvgpu_worker_enqueue_sharded, while the main
+ * thread keeps running the other worker ops. With \a num_shards 0 this is
+ * the same as #nvgpu_worker_init.
+ *
+ * @param g [in] The GPU super structure.
+ * @param worker [in] The worker.
+ * @param worker_ops [in] The worker ops specific for this worker.
+ * @param num_shards [in] Number of shard threads to create.
+ *
+ * @return 0 for success, < 0 for error.
+ *
+ * @retval -ENOMEM if the shards could not be allocated.
+ * @retval Error codes of #nvgpu_thread_create() if a thread failed to start.
+ */
+int nvgpu_worker_init_sharded(struct gk20a *g, struct nvgpu_worker *worker,
+		const struct nvgpu_worker_ops *worker_ops, u32 num_shards);
+
 /**
  * @brief Stop the background thread associated with the worker.
  *
@@ -321,6 +410,8 @@ int nvgpu_worker_init(struct gk20a *g, struct nvgpu_worker *worker,
  *   worker.
  * - Invokes the function #nvgpu_mutex_release() with variable \a start_lock in
  *   #nvgpu_worker as parameter to release the lock.
+ * - Shard threads, if any, are stopped before the main thread and the shards
+ *   are freed.
  *
  * @param worker [in] The worker. Function does not perform any validation of
  *		      the parameter.
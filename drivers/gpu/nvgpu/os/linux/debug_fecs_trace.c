@@ -15,6 +15,8 @@
  */
 
 #include <linux/debugfs.h>
+#include <linux/math64.h>
+#include <linux/seq_file.h>
 
 #include <nvgpu/gr/fecs_trace.h>
 #include <nvgpu/nvgpu_init.h>
@@ -154,6 +156,44 @@ static int gk20a_fecs_trace_debugfs_write(void *arg, u64 *val)
 DEFINE_SIMPLE_ATTRIBUTE(gk20a_fecs_trace_debugfs_write_fops,
 	gk20a_fecs_trace_debugfs_write, NULL, "%llu\n");
 
+static int gk20a_fecs_trace_debugfs_stats_show(struct seq_file *s,
+		void *unused)
+{
+	struct gk20a *g = s->private;
+	struct nvgpu_gr_fecs_trace_stats stats;
+
+	if (g->fecs_trace == NULL)
+		return -ENODEV;
+
+	nvgpu_gr_fecs_trace_get_stats(g, &stats);
+
+	seq_printf(s, "contexts:      %u\n", g->fecs_trace->num_contexts);
+	seq_printf(s, "polls:         %llu\n", stats.polls);
+	seq_printf(s, "records:       %llu\n", stats.records);
+	seq_printf(s, "entries:       %llu\n", stats.entries);
+	seq_printf(s, "decode_ns:     %llu\n", stats.decode_ns);
+	seq_printf(s, "records/s:     %llu\n", stats.decode_ns == 0ULL ? 0ULL :
+		div64_u64(stats.records * NSEC_PER_SEC, stats.decode_ns));
+	seq_printf(s, "lookups:       %llu\n", stats.lookups);
+	seq_printf(s, "lookup_misses: %llu\n", stats.lookup_misses);
+
+	return 0;
+}
+
+static int gk20a_fecs_trace_debugfs_stats_open(struct inode *inode,
+		struct file *file)
+{
+	return single_open(file, gk20a_fecs_trace_debugfs_stats_show,
+		inode->i_private);
+}
+
+static const struct file_operations gk20a_fecs_trace_debugfs_stats_fops = {
+	.open = gk20a_fecs_trace_debugfs_stats_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 int nvgpu_fecs_trace_init_debugfs(struct gk20a *g)
 {
 	struct nvgpu_os_linux *l = nvgpu_os_linux_from_gk20a(g);
@@ -164,6 +204,8 @@ int nvgpu_fecs_trace_init_debugfs(struct gk20a *g)
 		&gk20a_fecs_trace_debugfs_write_fops);
 	debugfs_create_file("ctxsw_trace_ring", 0600, l->debugfs, g,
 		&gk20a_fecs_trace_debugfs_ring_fops);
+	debugfs_create_file("ctxsw_trace_stats", 0444, l->debugfs, g,
+		&gk20a_fecs_trace_debugfs_stats_fops);
 
 	return 0;
 }
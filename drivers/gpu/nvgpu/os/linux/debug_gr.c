@@ -16,6 +16,7 @@
 
 #include <nvgpu/gk20a.h>
 #include <nvgpu/gr/ctx.h>
+#include <nvgpu/gr/hwpm_map.h>
 #include <nvgpu/nvgpu_init.h>
 
 #include "common/gr/ctx_priv.h"
@@ -27,6 +28,7 @@
 #include <linux/uaccess.h>
 #include <linux/capability.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #ifdef CONFIG_NVGPU_COMPRESSION
 static int cbc_status_debug_show(struct seq_file *s, void *unused)
@@ -294,6 +296,49 @@ static const struct file_operations gr_default_attrib_cb_size_fops= {
 	.release	= single_release,
 };
 
+#ifdef CONFIG_NVGPU_DEBUGGER
+static int gr_hwpm_map_stats_show(struct seq_file *s, void *data)
+{
+	struct gk20a *g = s->private;
+	struct nvgpu_gr_hwpm_map_stats stats;
+	struct nvgpu_gr_hwpm_map *hwpm_map;
+	u32 i;
+
+	if (g->gr == NULL)
+		return -ENODEV;
+
+	for (i = 0U; i < g->num_gr_instances; i++) {
+		hwpm_map = g->gr[i].hwpm_map;
+		if (hwpm_map == NULL)
+			continue;
+
+		nvgpu_gr_hwpm_map_get_stats(hwpm_map, &stats);
+
+		seq_printf(s, "GR%u:\n", g->gr[i].instance_id);
+		seq_printf(s, "  regs:      %u\n", stats.count);
+		seq_printf(s, "  slots:     %u\n", stats.slots);
+		seq_printf(s, "  max_probe: %u\n", stats.max_probe);
+		seq_printf(s, "  build_ns:  %llu\n", stats.build_ns);
+		seq_printf(s, "  lookups:   %llu\n", stats.lookups);
+		seq_printf(s, "  misses:    %llu\n", stats.misses);
+	}
+
+	return 0;
+}
+
+static int gr_hwpm_map_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, gr_hwpm_map_stats_show, inode->i_private);
+}
+
+static const struct file_operations gr_hwpm_map_stats_fops = {
+	.open		= gr_hwpm_map_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+#endif /* CONFIG_NVGPU_DEBUGGER */
+
 static ssize_t force_preemption_gfxp_read(struct file *file,
 		char __user *user_buf, size_t count, loff_t *ppos)
 {
@@ -485,6 +530,13 @@ int gr_gk20a_debugfs_init(struct gk20a *g)
 		return -ENOMEM;
 #endif /* CONFIG_NVGPU_COMPRESSION */
 
+#ifdef CONFIG_NVGPU_DEBUGGER
+	d = debugfs_create_file("hwpm_map_stats", S_IRUGO, l->debugfs, g,
+		&gr_hwpm_map_stats_fops);
+	if (!d)
+		return -ENOMEM;
+#endif /* CONFIG_NVGPU_DEBUGGER */
+
 	if (!g->is_virtual) {
 		d = debugfs_create_file(
 			"dump_ctxsw_stats_on_channel_close", S_IRUGO|S_IWUSR,
@@ -313,6 +313,7 @@ static void nvgpu_init_mm_vars(struct gk20a *g)
 	struct gk20a_platform *platform = dev_get_drvdata(dev_from_gk20a(g));
 
 	g->mm.disable_bigpage = platform->disable_bigpage;
+	g->mm.pt_parallel_threads = platform->gmmu_pt_threads;
 	nvgpu_set_enabled(g, NVGPU_MM_HONORS_APERTURE,
 			    platform->honors_aperture);
 	nvgpu_set_enabled(g, NVGPU_MM_UNIFIED_MEMORY,
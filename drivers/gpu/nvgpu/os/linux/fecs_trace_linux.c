@@ -726,6 +726,91 @@ done:
 	return ret;
 }
 
+/*
+ * Write a run of entries for one device under a single write_lock hold, and
+ * publish them with one write index update.
+ */
+static void nvgpu_gr_fecs_trace_write_run(struct gk20a *g,
+		struct nvgpu_gpu_ctxsw_trace_entry *entries, u32 count)
+{
+	struct nvgpu_ctxsw_ring_header *hdr;
+	struct gk20a_ctxsw_dev *dev;
+	u32 write_idx;
+	u32 i;
+
+	dev = &g->ctxsw_trace->devs[entries[0].vmid];
+
+	nvgpu_mutex_acquire(&dev->write_lock);
+
+	hdr = dev->hdr;
+	if (unlikely(!hdr)) {
+		/* device has been released */
+		nvgpu_mutex_release(&dev->write_lock);
+		return;
+	}
+
+	write_idx = hdr->write_idx;
+	if (write_idx >= dev->num_ents) {
+		nvgpu_mutex_release(&dev->write_lock);
+		/* The single entry path reports it and disables tracing. */
+		for (i = 0; i < count; i++)
+			nvgpu_gr_fecs_trace_write_entry(g, &entries[i]);
+		return;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct nvgpu_gpu_ctxsw_trace_entry *entry = &entries[i];
+
+		entry->seqno = hdr->write_seqno++;
+
+		if (!dev->write_enabled ||
+		    ((write_idx + 1) % hdr->num_ents) == hdr->read_idx) {
+			hdr->drop_count++;
+			continue;
+		}
+
+		if (!NVGPU_GPU_CTXSW_FILTER_ISSET(entry->tag, &dev->filter))
+			continue;
+
+		dev->ents[write_idx] = *entry;
+
+		write_idx++;
+		if (unlikely(write_idx >= hdr->num_ents))
+			write_idx = 0;
+	}
+
+	if (write_idx != hdr->write_idx) {
+		/* ensure records are written before updating write index */
+		nvgpu_smp_wmb();
+		hdr->write_idx = write_idx;
+		nvgpu_log(g, gpu_dbg_ctxsw, "added: read=%d write=%d len=%d",
+			hdr->read_idx, hdr->write_idx, ring_len(hdr));
+	}
+
+	nvgpu_mutex_release(&dev->write_lock);
+}
+
+void nvgpu_gr_fecs_trace_write_entries(struct gk20a *g,
+		struct nvgpu_gpu_ctxsw_trace_entry *entries, u32 count)
+{
+	u32 i = 0, n;
+
+	if (!g->ctxsw_trace)
+		return;
+
+	while (i < count) {
+		/* Entries of one context switch usually go to one device. */
+		for (n = 1; i + n < count &&
+				entries[i + n].vmid == entries[i].vmid; n++)
+			;
+
+		if (likely(entries[i].vmid < GK20A_CTXSW_TRACE_NUM_DEVS))
+			nvgpu_gr_fecs_trace_write_run(g, &entries[i], n);
+
+		i += n;
+	}
+}
+
 void nvgpu_gr_fecs_trace_wake_up(struct gk20a *g, int vmid)
 {
 	struct gk20a_ctxsw_dev *dev;
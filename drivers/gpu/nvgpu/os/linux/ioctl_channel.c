@@ -738,11 +738,13 @@ static int gk20a_channel_wait_semaphore(struct nvgpu_channel *ch,
 		goto cleanup_put;
 	}
 
+	nvgpu_channel_semaphore_wakeup_get(ch);
 	ret = NVGPU_COND_WAIT_INTERRUPTIBLE(
 			&ch->semaphore_wq,
 			channel_test_user_semaphore(dmabuf, data, offset, payload) ||
 				nvgpu_channel_check_unserviceable(ch),
 			timeout);
+	nvgpu_channel_semaphore_wakeup_put(ch);
 
 	gk20a_dmabuf_vunmap(dmabuf, data);
 cleanup_put:
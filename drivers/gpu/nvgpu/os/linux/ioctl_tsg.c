@@ -31,6 +31,9 @@
 #include <nvgpu/gr/gr_instances.h>
 #include <nvgpu/gr/gr_utils.h>
 #include <nvgpu/channel.h>
+#include <nvgpu/channel_sync.h>
+#include <nvgpu/fence.h>
+#include <nvgpu/user_fence.h>
 #include <nvgpu/tsg.h>
 #include <nvgpu/fifo.h>
 #include <nvgpu/nvgpu_init.h>
@@ -41,6 +44,7 @@
 #include "platform_gk20a.h"
 #include "ioctl_tsg.h"
 #include "ioctl_channel.h"
+#include "channel.h"
 #include "ioctl_nvs.h"
 #include "ioctl.h"
 #include "os_linux.h"
@@ -343,6 +347,10 @@ static int gk20a_event_id_release(struct inode *inode, struct file *filp)
 	nvgpu_list_del(&event_id_data->event_id_node);
 	nvgpu_mutex_release(&tsg->event_id_list_lock);
 
+	if (event_id_data->event_id ==
+			NVGPU_IOCTL_CHANNEL_EVENT_ID_BLOCKING_SYNC)
+		nvgpu_channel_semaphore_wakeup_events_put(g);
+
 	nvgpu_mutex_destroy(&event_id_data->lock);
 	nvgpu_put(g);
 	nvgpu_kfree(g, event_id_data);
@@ -413,6 +421,10 @@ static int gk20a_tsg_event_id_enable(struct nvgpu_tsg *tsg,
 	nvgpu_list_add_tail(&event_id_data->event_id_node, &tsg->event_id_list);
 	nvgpu_mutex_release(&tsg->event_id_list_lock);
 
+	/* dropped in gk20a_event_id_release() */
+	if (event_id == NVGPU_IOCTL_CHANNEL_EVENT_ID_BLOCKING_SYNC)
+		nvgpu_channel_semaphore_wakeup_events_get(g);
+
 	fd_install(local_fd, file);
 
 	*fd = local_fd;
@@ -781,6 +793,135 @@ static int nvgpu_gpu_ioctl_set_l2_sector_promotion(struct gk20a *g,
 	return err;
 }
 
+static int nvgpu_tsg_ioctl_submit_gpfifo_batch(struct nvgpu_tsg *tsg,
+		struct nvgpu_tsg_submit_gpfifo_batch_args *args)
+{
+	struct gk20a *g = tsg->g;
+	struct nvgpu_tsg_submit_gpfifo_entry *entries;
+	struct nvgpu_submit_batch_entry *batch;
+	struct nvgpu_channel *order[NVGPU_TSG_SUBMIT_GPFIFO_BATCH_MAX_ENTRIES];
+	u32 fence_flags = NVGPU_SUBMIT_GPFIFO_FLAGS_FENCE_WAIT |
+			NVGPU_SUBMIT_GPFIFO_FLAGS_FENCE_GET;
+	u32 n = args->num_entries;
+	u32 num_channels = 0U;
+	u32 submitted = 0U;
+	u32 i, j;
+	int err = 0;
+
+	BUILD_BUG_ON(NVGPU_TSG_SUBMIT_GPFIFO_BATCH_MAX_ENTRIES >
+			NVGPU_SUBMIT_BATCH_MAX_CHANNELS);
+
+	args->num_submitted = 0U;
+
+	if ((n == 0U) || (n > NVGPU_TSG_SUBMIT_GPFIFO_BATCH_MAX_ENTRIES))
+		return -EINVAL;
+
+	/* the uapi entries are 8 byte aligned, so batch can follow them */
+	entries = nvgpu_kzalloc(g, n * (sizeof(*entries) + sizeof(*batch)));
+	if (entries == NULL)
+		return -ENOMEM;
+	batch = (struct nvgpu_submit_batch_entry *)(void *)&entries[n];
+
+	if (copy_from_user(entries, (void __user *)(uintptr_t)args->entries,
+			n * sizeof(*entries))) {
+		err = -EFAULT;
+		goto free;
+	}
+
+	for (i = 0U; i < n; i++) {
+		struct nvgpu_tsg_submit_gpfifo_entry *e = &entries[i];
+		struct nvgpu_channel *ch;
+
+		/* batches only pass raw syncpoint fences */
+		if ((e->flags & NVGPU_SUBMIT_GPFIFO_FLAGS_SYNC_FENCE) ||
+		    (nvgpu_channel_sync_needs_os_fence_framework(g) &&
+		     ((e->flags & fence_flags) ||
+		      (e->wait_index != NVGPU_TSG_SUBMIT_GPFIFO_NO_WAIT)))) {
+			err = -EINVAL;
+			goto put;
+		}
+
+		ch = nvgpu_channel_get_from_file(e->channel_fd);
+		if (ch == NULL) {
+			err = -EINVAL;
+			goto put;
+		}
+		batch[i].ch = ch;
+		num_channels++;
+
+		if (ch->tsgid != tsg->tsgid) {
+			nvgpu_err(g, "ch %u is not bound to tsg %u",
+				ch->chid, tsg->tsgid);
+			err = -EINVAL;
+			goto put;
+		}
+
+		batch[i].gpfifo = NULL;
+		batch[i].userdata.entries = (struct nvgpu_gpfifo_entry __user *)
+			(uintptr_t)e->gpfifo;
+		batch[i].userdata.context = NULL;
+		batch[i].num_entries = e->num_entries;
+		batch[i].flags =
+			nvgpu_submit_gpfifo_user_flags_to_common_flags(e->flags);
+		batch[i].fence.id = e->fence.id;
+		batch[i].fence.value = e->fence.value;
+		batch[i].wait_index =
+			(e->wait_index == NVGPU_TSG_SUBMIT_GPFIFO_NO_WAIT) ?
+			NVGPU_SUBMIT_BATCH_NO_WAIT : e->wait_index;
+		batch[i].fence_out = NULL;
+
+		/* channel locks are taken in chid order */
+		for (j = i; (j > 0U) && (order[j - 1U]->chid > ch->chid); j--)
+			order[j] = order[j - 1U];
+		order[j] = ch;
+	}
+
+	for (i = 1U; i < n; i++) {
+		if (order[i - 1U] == order[i]) {
+			err = -EINVAL;
+			goto put;
+		}
+	}
+
+	/* submits on a channel are serialized by its ioctl lock */
+	for (i = 0U; i < n; i++)
+		nvgpu_mutex_acquire(&order[i]->ioctl_lock);
+
+	err = nvgpu_submit_channels_gpfifo(g, batch, n, &submitted, NULL);
+
+	for (i = n; i > 0U; i--)
+		nvgpu_mutex_release(&order[i - 1U]->ioctl_lock);
+
+	for (i = 0U; i < submitted; i++) {
+		struct nvgpu_user_fence fence_out;
+
+		if (batch[i].fence_out == NULL)
+			continue;
+
+		fence_out = nvgpu_fence_extract_user(batch[i].fence_out);
+		entries[i].fence.id = fence_out.syncpt_id;
+		entries[i].fence.value = fence_out.syncpt_value;
+		nvgpu_user_fence_release(&fence_out);
+		nvgpu_fence_put(batch[i].fence_out);
+	}
+
+	args->num_submitted = submitted;
+
+	if ((submitted > 0U) &&
+	    copy_to_user((void __user *)(uintptr_t)args->entries, entries,
+			submitted * sizeof(*entries))) {
+		if (err == 0)
+			err = -EFAULT;
+	}
+
+put:
+	for (i = 0U; i < num_channels; i++)
+		nvgpu_channel_put(batch[i].ch);
+free:
+	nvgpu_kfree(g, entries);
+	return err;
+}
+
 long nvgpu_ioctl_tsg_dev_ioctl(struct file *filp, unsigned int cmd,
 			     unsigned long arg)
 {
@@ -984,6 +1125,17 @@ long nvgpu_ioctl_tsg_dev_ioctl(struct file *filp, unsigned int cmd,
 		break;
 		}
 
+	case NVGPU_TSG_IOCTL_SUBMIT_GPFIFO_BATCH:
+		{
+		err = nvgpu_tsg_ioctl_submit_gpfifo_batch(tsg,
+			(struct nvgpu_tsg_submit_gpfifo_batch_args *)buf);
+		/* num_submitted is reported on failure too */
+		if (err && copy_to_user((void __user *)arg,
+				buf, _IOC_SIZE(cmd)))
+			err = -EFAULT;
+		break;
+		}
+
 	default:
 		nvgpu_err(g, "unrecognized tsg gpu ioctl cmd: 0x%x",
 			   cmd);
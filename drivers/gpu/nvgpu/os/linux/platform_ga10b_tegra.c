@@ -788,6 +788,7 @@ struct gk20a_platform ga10b_tegra_platform = {
 	.soc_name = "tegra23x",
 
 	.honors_aperture = true,
+	.gmmu_pt_threads = 3,
 	.unified_memory = true,
 
 	/*
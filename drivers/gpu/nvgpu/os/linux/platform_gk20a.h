@@ -176,6 +176,12 @@ struct gk20a_platform {
 	/* Disable big page support */
 	bool disable_bigpage;
 
+	/*
+	 * Number of threads helping to write the PTEs of large GMMU map and
+	 * unmap updates. 0 writes them all on the calling thread.
+	 */
+	u32 gmmu_pt_threads;
+
 	/* Disable nvlink support */
 	bool disable_nvlink;
 
@@ -314,6 +314,7 @@ struct gk20a_platform gv11b_tegra_platform = {
 	.soc_name = "tegra19x",
 
 	.honors_aperture = true,
+	.gmmu_pt_threads = 3,
 	.unified_memory = true,
 	.dma_mask = DMA_BIT_MASK(38),
 
@@ -84,6 +84,10 @@ static int nvgpu_vm_translate_linux_flags(struct gk20a *g, u32 flags, u32 *out_c
 		core_flags |= NVGPU_VM_MAP_TEGRA_RAW;
 		consumed_flags |= NVGPU_AS_MAP_BUFFER_FLAGS_TEGRA_RAW;
 	}
+	if ((flags & NVGPU_AS_MAP_BUFFER_FLAGS_MIXED_PAGES) != 0U) {
+		core_flags |= NVGPU_VM_MAP_MIXED_PAGES;
+		consumed_flags |= NVGPU_AS_MAP_BUFFER_FLAGS_MIXED_PAGES;
+	}
 	if ((flags & NVGPU_AS_MAP_BUFFER_FLAGS_MAPPABLE_COMPBITS) != 0U) {
 		nvgpu_warn(g, "Ignoring deprecated flag: "
 			   "NVGPU_AS_MAP_BUFFER_FLAGS_MAPPABLE_COMPBITS");
@@ -530,6 +534,14 @@ int nvgpu_vm_mapping_modify(struct vm_gk20a *vm,
 		goto out;
 	}
 
+	if (mapped_buffer->segs != NULL) {
+		/* Mixed page mappings never have comptags. */
+		ret = nvgpu_vm_mapping_modify_mixed(vm, mapped_buffer,
+				nvgpu_sgt, (u8)kind, buffer_offset,
+				buffer_size);
+		goto free_sgt;
+	}
+
 	ctag_offset = mapped_buffer->ctag_offset;
 
 	compression_page_size = g->ops.fb.compression_page_size(g);
@@ -556,6 +568,7 @@ int nvgpu_vm_mapping_modify(struct vm_gk20a *vm,
 		ret = 0;
 	}
 
+free_sgt:
 	nvgpu_sgt_free(g, nvgpu_sgt);
 
 out:
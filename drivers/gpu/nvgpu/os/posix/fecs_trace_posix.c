@@ -23,6 +23,8 @@
 #include <nvgpu/types.h>
 #include <nvgpu/gr/fecs_trace.h>
 
+#include "os_posix.h"
+
 int vgpu_alloc_user_buffer(struct gk20a *g, void **buf, size_t *size);
 void vgpu_fecs_trace_data_update(struct gk20a *g);
 void vgpu_get_mmap_user_buffer_info(struct gk20a *g,
@@ -50,6 +52,26 @@ int nvgpu_gr_fecs_trace_write_entry(struct gk20a *g,
 	return -EINVAL;
 }
 
+void nvgpu_gr_fecs_trace_write_entries(struct gk20a *g,
+		struct nvgpu_gpu_ctxsw_trace_entry *entries, u32 count)
+{
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+	u32 i;
+
+	p->fecs_trace_writes++;
+
+	for (i = 0U; i < count; i++) {
+		entries[i].seqno = p->fecs_trace_seqno++;
+
+		if (p->fecs_trace_write_idx >= p->fecs_trace_num_ents) {
+			p->fecs_trace_drop_count++;
+			continue;
+		}
+
+		p->fecs_trace_ents[p->fecs_trace_write_idx++] = entries[i];
+	}
+}
+
 void nvgpu_gr_fecs_trace_wake_up(struct gk20a *g, int vmid)
 {
 }
@@ -58,9 +80,10 @@ void nvgpu_gr_fecs_trace_add_tsg_reset(struct gk20a *g, struct nvgpu_tsg *tsg)
 {
 }
 
+/* The FECS tags are the common tags, there are no OS tags to convert. */
 u8 nvgpu_gpu_ctxsw_tags_to_common_tags(u8 tags)
 {
-	return 0;
+	return tags;
 }
 
 int vgpu_alloc_user_buffer(struct gk20a *g, void **buf, size_t *size)
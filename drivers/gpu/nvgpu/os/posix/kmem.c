@@ -21,12 +21,16 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <nvgpu/bug.h>
 #include <nvgpu/log.h>
 #include <nvgpu/kmem.h>
 #include <nvgpu/types.h>
 #include <nvgpu/atomic.h>
+#include <nvgpu/lock.h>
+#include <nvgpu/utils.h>
+#include <nvgpu/static_analysis.h>
 #include <nvgpu/posix/kmem.h>
 #include <nvgpu/posix/sizes.h>
 #include <nvgpu/posix/bug.h>
@@ -38,12 +42,40 @@
 #define CACHE_NAME_LEN	128
 #endif
 
+/*
+ * Objects of a kmem cache are carved out of slabs of about
+ * NVGPU_KMEM_SLAB_SIZE bytes. Freed objects go on a per-cache free list and
+ * are handed out again before a new slab is allocated. Slabs are returned
+ * to the system when the cache is destroyed.
+ */
+#define NVGPU_KMEM_SLAB_SIZE	(SZ_4K << 2)
+#define NVGPU_KMEM_OBJ_ALIGN	16UL
+
+struct nvgpu_kmem_slab {
+	struct nvgpu_kmem_slab *next;
+};
+
 struct nvgpu_kmem_cache {
 	struct gk20a *g;
 	size_t size;
 #ifdef __NVGPU_UNIT_TEST__
 	char name[CACHE_NAME_LEN];
 #endif
+	/* Size of an object in a slab, at least one pointer. */
+	size_t obj_size;
+	/* Offset of the first object from the start of a slab. */
+	size_t obj_offset;
+	size_t objs_per_slab;
+
+	struct nvgpu_mutex lock;
+	struct nvgpu_kmem_slab *slabs;
+	/* Freed objects, linked through their first word. */
+	void *free_list;
+	/* Objects of the newest slab that were never handed out. */
+	char *next_obj;
+	size_t nr_fresh;
+
+	struct nvgpu_kmem_cache_stats stats;
 };
 
 #ifdef __NVGPU_UNIT_TEST__
@@ -58,18 +90,28 @@ struct nvgpu_posix_fault_inj *nvgpu_kmem_get_fault_injection(void)
 
 	return &c->kmem_fi;
 }
-#endif
 
 /*
- * kmem cache emulation: basically just do a regular malloc(). This is slower
- * but should not affect a user of kmem cache in the slightest bit.
+ * Count an allocation of the calling thread and check if it should fail.
  */
+static bool nvgpu_kmem_alloc_should_fail(void)
+{
+	struct nvgpu_posix_call_stats *stats = nvgpu_posix_get_call_stats();
+
+	if (stats != NULL) {
+		stats->kmem_allocs++;
+	}
+
+	return nvgpu_posix_fault_injection_handle_call(
+					nvgpu_kmem_get_fault_injection());
+}
+#endif
+
 struct nvgpu_kmem_cache *nvgpu_kmem_cache_create(struct gk20a *g, size_t size)
 {
 	struct nvgpu_kmem_cache *cache;
 #ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
-	if (nvgpu_posix_fault_injection_handle_call(
-					nvgpu_kmem_get_fault_injection())) {
+	if (nvgpu_kmem_alloc_should_fail()) {
 		return NULL;
 	}
 #endif
@@ -83,9 +125,23 @@ struct nvgpu_kmem_cache *nvgpu_kmem_cache_create(struct gk20a *g, size_t size)
 		return NULL;
 	}
 
+	(void) memset(cache, 0, sizeof(*cache));
 	cache->g = g;
 	cache->size = size;
 
+	cache->obj_size = NVGPU_ALIGN(max(size, sizeof(void *)),
+				      NVGPU_KMEM_OBJ_ALIGN);
+	cache->obj_offset = NVGPU_ALIGN(sizeof(struct nvgpu_kmem_slab),
+					NVGPU_KMEM_OBJ_ALIGN);
+	if (nvgpu_safe_add_u64(cache->obj_offset, cache->obj_size) <
+	    NVGPU_KMEM_SLAB_SIZE) {
+		cache->objs_per_slab = (NVGPU_KMEM_SLAB_SIZE -
+					cache->obj_offset) / cache->obj_size;
+	} else {
+		cache->objs_per_slab = 1UL;
+	}
+	nvgpu_mutex_init(&cache->lock);
+
 #ifdef __NVGPU_UNIT_TEST__
 	(void)snprintf(cache->name, sizeof(cache->name),
 			"nvgpu-cache-0x%p-%lu-%d", g, size,
@@ -97,29 +153,96 @@ struct nvgpu_kmem_cache *nvgpu_kmem_cache_create(struct gk20a *g, size_t size)
 
 void nvgpu_kmem_cache_destroy(struct nvgpu_kmem_cache *cache)
 {
+	struct nvgpu_kmem_slab *slab;
+
+	if (cache == NULL) {
+		return;
+	}
+
+	if (cache->g != NULL) {
+		nvgpu_log(cache->g, gpu_dbg_kmem,
+			  "cache size=%lu slabs=%llu allocs=%llu frees=%llu "
+			  "objs=%llu", cache->size, cache->stats.nr_slabs,
+			  cache->stats.nr_allocs, cache->stats.nr_frees,
+			  cache->stats.nr_objs);
+	}
+
+	while (cache->slabs != NULL) {
+		slab = cache->slabs;
+		cache->slabs = slab->next;
+		NVGPU_COV_WHITELIST(deviate, NVGPU_MISRA(Rule, 21_3), "TID-1131")
+		free(slab);
+	}
+
+	nvgpu_mutex_destroy(&cache->lock);
 	NVGPU_COV_WHITELIST(deviate, NVGPU_MISRA(Rule, 21_3), "TID-1131")
 	free(cache);
 }
 
+/*
+ * Add a slab to the cache. Must be called with the cache lock held.
+ */
+static bool nvgpu_kmem_cache_grow(struct nvgpu_kmem_cache *cache)
+{
+	struct nvgpu_kmem_slab *slab;
+	size_t slab_size = nvgpu_safe_add_u64(cache->obj_offset,
+			nvgpu_safe_mult_u64(cache->objs_per_slab,
+					    cache->obj_size));
+
+	NVGPU_COV_WHITELIST_BLOCK_BEGIN(deviate, 1, NVGPU_MISRA(Rule, 21_3), "TID-1131")
+	NVGPU_COV_WHITELIST_BLOCK_BEGIN(deviate, 1, NVGPU_MISRA(Directive, 4_12), "TID-1129")
+	slab = malloc(slab_size);
+	NVGPU_COV_WHITELIST_BLOCK_END(NVGPU_MISRA(Directive, 4_12))
+	NVGPU_COV_WHITELIST_BLOCK_END(NVGPU_MISRA(Rule, 21_3))
+
+	if (slab == NULL) {
+		return false;
+	}
+
+	slab->next = cache->slabs;
+	cache->slabs = slab;
+	cache->next_obj = (char *)slab + cache->obj_offset;
+	cache->nr_fresh = cache->objs_per_slab;
+	cache->stats.nr_slabs = nvgpu_safe_add_u64(cache->stats.nr_slabs, 1ULL);
+
+	return true;
+}
+
 void *nvgpu_kmem_cache_alloc(struct nvgpu_kmem_cache *cache)
 {
-	void *ptr;
+	void *ptr = NULL;
 
 #ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
-	if (nvgpu_posix_fault_injection_handle_call(
-					nvgpu_kmem_get_fault_injection())) {
+	if (nvgpu_kmem_alloc_should_fail()) {
 		return NULL;
 	}
 #endif
-	NVGPU_COV_WHITELIST_BLOCK_BEGIN(deviate, 1, NVGPU_MISRA(Rule, 21_3), "TID-1131")
-	NVGPU_COV_WHITELIST_BLOCK_BEGIN(deviate, 1, NVGPU_MISRA(Directive, 4_12), "TID-1129")
-	ptr = malloc(cache->size);
-	NVGPU_COV_WHITELIST_BLOCK_END(NVGPU_MISRA(Directive, 4_12))
-	NVGPU_COV_WHITELIST_BLOCK_END(NVGPU_MISRA(Rule, 21_3))
+	nvgpu_mutex_acquire(&cache->lock);
+
+	if (cache->free_list != NULL) {
+		ptr = cache->free_list;
+		cache->free_list = *(void **)ptr;
+	} else if ((cache->nr_fresh != 0UL) || nvgpu_kmem_cache_grow(cache)) {
+		ptr = cache->next_obj;
+		cache->next_obj += cache->obj_size;
+		cache->nr_fresh--;
+		cache->stats.nr_objs =
+			nvgpu_safe_add_u64(cache->stats.nr_objs, 1ULL);
+	} else {
+		/* Out of memory, ptr stays NULL. */
+	}
+
+	if (ptr != NULL) {
+		cache->stats.nr_allocs =
+			nvgpu_safe_add_u64(cache->stats.nr_allocs, 1ULL);
+		cache->stats.nr_active =
+			nvgpu_safe_add_u64(cache->stats.nr_active, 1ULL);
+	}
+
+	nvgpu_mutex_release(&cache->lock);
 
 	if (ptr == NULL) {
 		nvgpu_warn(NULL, "malloc returns NULL");
-		return NULL;
 	}
 
 	return ptr;
@@ -127,9 +250,24 @@ void *nvgpu_kmem_cache_alloc(struct nvgpu_kmem_cache *cache)
 
 void nvgpu_kmem_cache_free(struct nvgpu_kmem_cache *cache, void *ptr)
 {
-	(void)cache;
-	NVGPU_COV_WHITELIST(deviate, NVGPU_MISRA(Rule, 21_3), "TID-1131")
-	free(ptr);
+	if (ptr == NULL) {
+		return;
+	}
+
+	nvgpu_mutex_acquire(&cache->lock);
+	*(void **)ptr = cache->free_list;
+	cache->free_list = ptr;
+	cache->stats.nr_frees = nvgpu_safe_add_u64(cache->stats.nr_frees, 1ULL);
+	cache->stats.nr_active = nvgpu_safe_sub_u64(cache->stats.nr_active, 1ULL);
+	nvgpu_mutex_release(&cache->lock);
+}
+
+void nvgpu_kmem_cache_get_stats(struct nvgpu_kmem_cache *cache,
+				struct nvgpu_kmem_cache_stats *stats)
+{
+	nvgpu_mutex_acquire(&cache->lock);
+	*stats = cache->stats;
+	nvgpu_mutex_release(&cache->lock);
 }
 
 void *nvgpu_kmalloc_impl(struct gk20a *g, size_t size, void *ip)
@@ -140,8 +278,7 @@ void *nvgpu_kmalloc_impl(struct gk20a *g, size_t size, void *ip)
 	(void)ip;
 
 #ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
-	if (nvgpu_posix_fault_injection_handle_call(
-					nvgpu_kmem_get_fault_injection())) {
+	if (nvgpu_kmem_alloc_should_fail()) {
 		return NULL;
 	}
 #endif
@@ -175,8 +312,7 @@ void *nvgpu_kzalloc_impl(struct gk20a *g, size_t size, void *ip)
 	(void)ip;
 
 #ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
-	if (nvgpu_posix_fault_injection_handle_call(
-					nvgpu_kmem_get_fault_injection())) {
+	if (nvgpu_kmem_alloc_should_fail()) {
 		return NULL;
 	}
 #endif
@@ -200,8 +336,7 @@ void *nvgpu_kcalloc_impl(struct gk20a *g, size_t n, size_t size, void *ip)
 	(void)ip;
 
 #ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
-	if (nvgpu_posix_fault_injection_handle_call(
-					nvgpu_kmem_get_fault_injection())) {
+	if (nvgpu_kmem_alloc_should_fail()) {
 		return NULL;
 	}
 #endif
@@ -23,6 +23,20 @@
 #include <nvgpu/bug.h>
 #include <nvgpu/log.h>
 #include <nvgpu/lock.h>
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+#include <nvgpu/posix/posix-fault-injection.h>
+#endif
+
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+static void nvgpu_posix_count_lock_acquire(void)
+{
+	struct nvgpu_posix_call_stats *stats = nvgpu_posix_get_call_stats();
+
+	if (stats != NULL) {
+		stats->lock_acquires++;
+	}
+}
+#endif
 
 void nvgpu_mutex_init(struct nvgpu_mutex *mutex)
 {
@@ -32,6 +46,9 @@ void nvgpu_mutex_init(struct nvgpu_mutex *mutex)
 
 void nvgpu_mutex_acquire(struct nvgpu_mutex *mutex)
 {
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+	nvgpu_posix_count_lock_acquire();
+#endif
 	nvgpu_posix_lock_acquire(&mutex->lock);
 }
 
@@ -42,7 +59,13 @@ void nvgpu_mutex_release(struct nvgpu_mutex *mutex)
 
 int nvgpu_mutex_tryacquire(struct nvgpu_mutex *mutex)
 {
-	return ((nvgpu_posix_lock_try_acquire(&mutex->lock) == 0) ? 1 : 0);
+	if (nvgpu_posix_lock_try_acquire(&mutex->lock) != 0) {
+		return 0;
+	}
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+	nvgpu_posix_count_lock_acquire();
+#endif
+	return 1;
 }
 
 void nvgpu_mutex_destroy(struct nvgpu_mutex *mutex)
@@ -59,6 +82,9 @@ void nvgpu_spinlock_init(struct nvgpu_spinlock *spinlock)
 
 void nvgpu_spinlock_acquire(struct nvgpu_spinlock *spinlock)
 {
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+	nvgpu_posix_count_lock_acquire();
+#endif
 	nvgpu_posix_lock_acquire(&spinlock->lock);
 }
 
@@ -75,6 +101,9 @@ void nvgpu_raw_spinlock_init(struct nvgpu_raw_spinlock *spinlock)
 
 void nvgpu_raw_spinlock_acquire(struct nvgpu_raw_spinlock *spinlock)
 {
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+	nvgpu_posix_count_lock_acquire();
+#endif
 	nvgpu_posix_lock_acquire(&spinlock->lock);
 }
 
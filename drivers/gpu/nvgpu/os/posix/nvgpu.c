@@ -274,6 +274,7 @@ void nvgpu_posix_cleanup(struct gk20a *g)
 {
 	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
 
+	nvgpu_posix_io_fini_reg_space(g);
 	nvgpu_kmem_fini(g, 0);
 	nvgpu_free_enabled_flags(g);
 	nvgpu_free_errata_flags(g);
@@ -24,8 +24,12 @@
 #define NVGPU_OS_POSIX_H
 
 #include <nvgpu/gk20a.h>
+#include <nvgpu/rwsem.h>
 
 struct nvgpu_posix_io_callbacks;
+struct nvgpu_posix_io_reg_range;
+struct nvgpu_reg_access;
+struct nvgpu_gpu_ctxsw_trace_entry;
 
 struct nvgpu_os_posix {
 	struct gk20a g;
@@ -42,13 +46,40 @@ struct nvgpu_os_posix {
 	struct nvgpu_list_node reg_space_head;
 	int error_code;
 
+	/*
+	 * Lookup index of the register spaces: sorted, non-overlapping
+	 * address ranges rebuilt from reg_space_head whenever a space is
+	 * registered or unregistered. reg_ranges_valid is false if the index
+	 * could not be allocated. Written under reg_space_lock for write,
+	 * looked up under it for read.
+	 */
+	struct nvgpu_rwsem reg_space_lock;
+	struct nvgpu_posix_io_reg_range *reg_ranges;
+	u32 nr_reg_ranges;
+	bool reg_ranges_valid;
 
 	/*
-	 * List to record sequence of register writes.
+	 * Ring to record sequence of register writes. Once the ring is full
+	 * the oldest accesses are overwritten.
 	 */
-	struct nvgpu_list_node recorder_head;
+	struct nvgpu_reg_access *recorder;
+	u32 recorder_first;
+	u32 nr_recorded;
+	bool recorder_overflow;
 	bool recording;
 
+	/*
+	 * Buffer the FECS trace entries are written to, provided by the unit
+	 * tests. Entries that do not fit are dropped. fecs_trace_writes counts
+	 * the batches handed over by the poller.
+	 */
+	struct nvgpu_gpu_ctxsw_trace_entry *fecs_trace_ents;
+	u32 fecs_trace_num_ents;
+	u32 fecs_trace_write_idx;
+	u32 fecs_trace_drop_count;
+	u32 fecs_trace_writes;
+	u16 fecs_trace_seqno;
+
 	/*
 	 * Parameters to change the behavior of MM-related functions
 	 */
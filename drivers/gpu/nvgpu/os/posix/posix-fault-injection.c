@@ -37,6 +37,15 @@ struct nvgpu_posix_fault_inj_container
 	return thread_fi;
 }
 
+struct nvgpu_posix_call_stats *nvgpu_posix_get_call_stats(void)
+{
+	if (thread_fi == NULL) {
+		return NULL;
+	}
+
+	return &thread_fi->call_stats;
+}
+
 void nvgpu_posix_enable_fault_injection(struct nvgpu_posix_fault_inj *fi,
 					bool enable, unsigned int number)
 {
@@ -20,6 +20,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
+
 #include <nvgpu/io.h>
 #include <nvgpu/io_usermode.h>
 #include <nvgpu/bug.h>
@@ -30,6 +32,22 @@
 
 #include "os_posix.h"
 
+/*
+ * A range of addresses that all resolve to the same register space. The
+ * ranges of the lookup index are sorted by address and do not overlap.
+ */
+struct nvgpu_posix_io_reg_range {
+	u64 start;
+	u64 end;
+	struct nvgpu_posix_io_reg_space *space;
+};
+
+/*
+ * Index of the range the calling thread last found a register in. Accesses
+ * tend to stay within one space, so lookups try it first; it is only a hint
+ * and is checked against the current index.
+ */
+static __thread u32 last_reg_range;
 
 #ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
 struct nvgpu_posix_fault_inj *nvgpu_readl_get_fault_injection(void)
@@ -203,7 +221,30 @@ void nvgpu_posix_io_init_reg_space(struct gk20a *g)
 	p->recording = false;
 	p->error_code = 0;
 	nvgpu_init_list_node(&p->reg_space_head);
-	nvgpu_init_list_node(&p->recorder_head);
+	nvgpu_rwsem_init(&p->reg_space_lock);
+	p->reg_ranges = NULL;
+	p->nr_reg_ranges = 0U;
+	p->reg_ranges_valid = true;
+	p->recorder = NULL;
+	p->recorder_first = 0U;
+	p->nr_recorded = 0U;
+	p->recorder_overflow = false;
+}
+
+void nvgpu_posix_io_fini_reg_space(struct gk20a *g)
+{
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+
+	nvgpu_rwsem_down_write(&p->reg_space_lock);
+	free(p->reg_ranges);
+	p->reg_ranges = NULL;
+	p->nr_reg_ranges = 0U;
+	p->reg_ranges_valid = false;
+	nvgpu_rwsem_up_write(&p->reg_space_lock);
+
+	free(p->recorder);
+	p->recorder = NULL;
+	p->recording = false;
 }
 
 int nvgpu_posix_io_get_error_code(struct gk20a *g)
@@ -220,6 +261,8 @@ void nvgpu_posix_io_reset_error_code(struct gk20a *g)
 	p->error_code = 0;
 }
 
+static void nvgpu_posix_io_build_reg_ranges(struct nvgpu_os_posix *p);
+
 /*
  * Register a pre-initialized register space to the list of spaces.
  * This allows registering a space with statically initialized data.
@@ -238,15 +281,22 @@ int nvgpu_posix_io_register_reg_space(struct gk20a *g,
 	 * tests define their own smaller register spaces that take precedence
 	 * over the default reg lists.
 	 */
+	nvgpu_rwsem_down_write(&p->reg_space_lock);
 	nvgpu_list_add(&reg_space->link, &p->reg_space_head);
+	nvgpu_posix_io_build_reg_ranges(p);
+	nvgpu_rwsem_up_write(&p->reg_space_lock);
 	return 0;
 }
 
 void nvgpu_posix_io_unregister_reg_space(struct gk20a *g,
 		struct nvgpu_posix_io_reg_space *reg_space)
 {
-	(void)g;
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+
+	nvgpu_rwsem_down_write(&p->reg_space_lock);
 	nvgpu_list_del(&reg_space->link);
+	nvgpu_posix_io_build_reg_ranges(p);
+	nvgpu_rwsem_up_write(&p->reg_space_lock);
 }
 
 /*
@@ -288,6 +338,169 @@ void nvgpu_posix_io_delete_reg_space(struct gk20a *g, u32 base)
 	nvgpu_kfree(g, reg_space);
 }
 
+/*
+ * Find the first space in the list that covers addr. Spaces at the front of
+ * the list take precedence over the ones behind them.
+ */
+static struct nvgpu_posix_io_reg_space *nvgpu_posix_io_find_reg_space(
+		struct nvgpu_os_posix *p, u64 addr)
+{
+	struct nvgpu_posix_io_reg_space *reg_space;
+
+	nvgpu_list_for_each_entry(reg_space, &p->reg_space_head,
+			nvgpu_posix_io_reg_space, link) {
+		if ((addr >= reg_space->base) &&
+		    (addr < ((u64)reg_space->base + reg_space->size))) {
+			return reg_space;
+		}
+	}
+
+	return NULL;
+}
+
+static void nvgpu_posix_io_sort_points(u64 *points, u32 nr)
+{
+	u32 i, j;
+	u64 tmp;
+
+	for (i = 1U; i < nr; i++) {
+		tmp = points[i];
+		for (j = i; (j > 0U) && (points[j - 1U] > tmp); j--) {
+			points[j] = points[j - 1U];
+		}
+		points[j] = tmp;
+	}
+}
+
+/*
+ * Rebuild the lookup index from the list of register spaces. Every base and
+ * end address of a space starts a new range, and each range is resolved
+ * with the list so that overlapping spaces keep their precedence. The index
+ * is allocated with malloc() directly so that rebuilding it does not count
+ * against kmem fault injection. If that fails the index stays invalid and
+ * lookups walk the list instead. Called with reg_space_lock held for write.
+ */
+static void nvgpu_posix_io_build_reg_ranges(struct nvgpu_os_posix *p)
+{
+	struct nvgpu_posix_io_reg_space *reg_space;
+	struct nvgpu_posix_io_reg_range *ranges;
+	struct nvgpu_posix_io_reg_range *prev;
+	u64 *points;
+	u32 nr_points = 0U;
+	u32 nr_ranges = 0U;
+	u32 i;
+
+	free(p->reg_ranges);
+	p->reg_ranges = NULL;
+	p->nr_reg_ranges = 0U;
+	p->reg_ranges_valid = false;
+
+	nvgpu_list_for_each_entry(reg_space, &p->reg_space_head,
+			nvgpu_posix_io_reg_space, link) {
+		nr_points += 2U;
+	}
+
+	if (nr_points == 0U) {
+		p->reg_ranges_valid = true;
+		return;
+	}
+
+	points = malloc(sizeof(*points) * nr_points);
+	ranges = malloc(sizeof(*ranges) * nr_points);
+	if ((points == NULL) || (ranges == NULL)) {
+		free(points);
+		free(ranges);
+		return;
+	}
+
+	i = 0U;
+	nvgpu_list_for_each_entry(reg_space, &p->reg_space_head,
+			nvgpu_posix_io_reg_space, link) {
+		points[i++] = reg_space->base;
+		points[i++] = (u64)reg_space->base + reg_space->size;
+	}
+	nvgpu_posix_io_sort_points(points, nr_points);
+
+	for (i = 0U; (i + 1U) < nr_points; i++) {
+		if (points[i] == points[i + 1U]) {
+			continue;
+		}
+
+		reg_space = nvgpu_posix_io_find_reg_space(p, points[i]);
+		if (reg_space == NULL) {
+			continue;
+		}
+
+		prev = (nr_ranges > 0U) ? &ranges[nr_ranges - 1U] : NULL;
+		if ((prev != NULL) && (prev->space == reg_space) &&
+		    (prev->end == points[i])) {
+			prev->end = points[i + 1U];
+		} else {
+			ranges[nr_ranges].start = points[i];
+			ranges[nr_ranges].end = points[i + 1U];
+			ranges[nr_ranges].space = reg_space;
+			nr_ranges++;
+		}
+	}
+
+	free(points);
+	p->reg_ranges = ranges;
+	p->nr_reg_ranges = nr_ranges;
+	p->reg_ranges_valid = true;
+}
+
+/*
+ * Called with reg_space_lock held for read. Only the calling thread's hint
+ * is written.
+ */
+static struct nvgpu_posix_io_reg_space *nvgpu_posix_io_search_reg_ranges(
+		struct nvgpu_os_posix *p, u32 addr)
+{
+	struct nvgpu_posix_io_reg_range *range;
+	u32 lo = 0U;
+	u32 hi;
+	u32 mid;
+
+	if (!p->reg_ranges_valid) {
+		return nvgpu_posix_io_find_reg_space(p, addr);
+	}
+
+	if (last_reg_range < p->nr_reg_ranges) {
+		range = &p->reg_ranges[last_reg_range];
+		if ((addr >= range->start) && (addr < range->end)) {
+			return range->space;
+		}
+	}
+
+	hi = p->nr_reg_ranges;
+	while (lo < hi) {
+		mid = lo + ((hi - lo) / 2U);
+		range = &p->reg_ranges[mid];
+		if (addr < range->start) {
+			hi = mid;
+		} else if (addr >= range->end) {
+			lo = mid + 1U;
+		} else {
+			last_reg_range = mid;
+			return range->space;
+		}
+	}
+
+	return NULL;
+}
+
+static struct nvgpu_posix_io_reg_space *nvgpu_posix_io_lookup_reg_space(
+		struct nvgpu_os_posix *p, u32 addr)
+{
+	struct nvgpu_posix_io_reg_space *reg_space;
+
+	nvgpu_rwsem_down_read(&p->reg_space_lock);
+	reg_space = nvgpu_posix_io_search_reg_ranges(p, addr);
+	nvgpu_rwsem_up_read(&p->reg_space_lock);
+
+	return reg_space;
+}
+
 /*
  * Lookup a register space from a given address. If no register space is found
  * this is a bug similar to a translation fault.
@@ -298,14 +511,11 @@ struct nvgpu_posix_io_reg_space *nvgpu_posix_io_get_reg_space(struct gk20a *g,
 	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
 	struct nvgpu_posix_io_reg_space *reg_space;
 
-	nvgpu_list_for_each_entry(reg_space, &p->reg_space_head,
-			nvgpu_posix_io_reg_space, link) {
-		u32 offset = addr - reg_space->base;
-
-		if ((addr >= reg_space->base) && (offset < reg_space->size)) {
-			return reg_space;
-		}
+	reg_space = nvgpu_posix_io_lookup_reg_space(p, addr);
+	if (reg_space != NULL) {
+		return reg_space;
 	}
+
 	p->error_code = -EFAULT;
 	nvgpu_err(g, "ABORT for address 0x%x", addr);
 	return NULL;
@@ -339,22 +549,24 @@ u32 nvgpu_posix_io_readl_reg_space(struct gk20a *g, u32 addr)
 
 /*
  * Start recording register writes. If this function is called again,
- * it will free all previously recorded events.
+ * it will drop all previously recorded events.
  */
 void nvgpu_posix_io_start_recorder(struct gk20a *g)
 {
 	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
-	struct nvgpu_posix_io_reg_access *ptr;
 
-	/* If list already has events, delete them all */
-	if (p->recording == true) {
-		while (!nvgpu_list_empty(&p->recorder_head)) {
-			ptr = nvgpu_list_first_entry(&p->recorder_head,
-				nvgpu_posix_io_reg_access, link);
-			nvgpu_list_del(&ptr->link);
-			nvgpu_kfree(g, ptr);
-		}
+	/*
+	 * Like the lookup index, the ring is allocated outside of kmem so that
+	 * starting a recording does not count against kmem fault injection.
+	 */
+	if (p->recorder == NULL) {
+		p->recorder = malloc(sizeof(*p->recorder) *
+				     NVGPU_POSIX_IO_RECORDER_SIZE);
 	}
+
+	p->recorder_first = 0U;
+	p->nr_recorded = 0U;
+	p->recorder_overflow = false;
 	p->recording = true;
 }
 
@@ -362,13 +574,25 @@ void nvgpu_posix_io_record_access(struct gk20a *g,
 		struct nvgpu_reg_access *access)
 {
 	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+	u32 idx;
 
 	if (p->recording == true) {
-		struct nvgpu_posix_io_reg_access *new_event = nvgpu_kzalloc(g,
-			sizeof(struct nvgpu_posix_io_reg_access));
-		(void) memcpy(&(new_event->access), access,
-			sizeof(struct nvgpu_reg_access));
-		nvgpu_list_add_tail(&new_event->link, &p->recorder_head);
+		if (p->recorder == NULL) {
+			p->recorder_overflow = true;
+			return;
+		}
+
+		idx = (p->recorder_first + p->nr_recorded) %
+			NVGPU_POSIX_IO_RECORDER_SIZE;
+		if (p->nr_recorded == NVGPU_POSIX_IO_RECORDER_SIZE) {
+			/* Full, overwrite the oldest access. */
+			p->recorder_first = (p->recorder_first + 1U) %
+				NVGPU_POSIX_IO_RECORDER_SIZE;
+			p->recorder_overflow = true;
+		} else {
+			p->nr_recorded++;
+		}
+		p->recorder[idx] = *access;
 	}
 }
 
@@ -376,23 +600,30 @@ void nvgpu_posix_io_record_access(struct gk20a *g,
  * Take an array of accesses and compare to the recorded sequence. Returns true
  * if the array matches the recorded sequence.
  * If strict mode is false, this function allows extra accesses to be present
- * in the recording.
+ * in the recording. In strict mode the check also fails if accesses were
+ * dropped because the recorder ring was full.
  */
 bool nvgpu_posix_io_check_sequence(struct gk20a *g,
 		struct nvgpu_reg_access *sequence, u32 size, bool strict)
 {
 	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
-	struct nvgpu_posix_io_reg_access *ptr;
+	struct nvgpu_reg_access *ptr;
 	u32 i = 0;
+	u32 n;
 
 	if (p->recording == false) {
 		return false;
 	}
 
-	nvgpu_list_for_each_entry(ptr, &p->recorder_head,
-			nvgpu_posix_io_reg_access, link) {
-		if ((sequence[i].addr == ptr->access.addr) &&
-			(sequence[i].value == ptr->access.value)) {
+	if (strict && p->recorder_overflow) {
+		return false;
+	}
+
+	for (n = 0U; n < p->nr_recorded; n++) {
+		ptr = &p->recorder[(p->recorder_first + n) %
+				   NVGPU_POSIX_IO_RECORDER_SIZE];
+		if ((i < size) && (sequence[i].addr == ptr->addr) &&
+			(sequence[i].value == ptr->value)) {
 			i++;
 		} else {
 			if (strict == true) {
@@ -401,20 +632,6 @@ bool nvgpu_posix_io_check_sequence(struct gk20a *g,
 		}
 	}
 
-	if (i != size) {
-		/* Either missing or too many accesses */
-		return false;
-	}
-
-	if (&ptr->link == &p->recorder_head) {
-		/* Identical match */
-		return true;
-	}
-
-	/* Not an identical match */
-	if (strict) {
-		return false;
-	} else {
-		return true;
-	}
+	/* Either missing or too many accesses */
+	return i == size;
 }
@@ -24,6 +24,20 @@
 #include <nvgpu/rwsem.h>
 #include <nvgpu/log.h>
 #include <nvgpu/bug.h>
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+#include <nvgpu/posix/posix-fault-injection.h>
+#endif
+
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+static void nvgpu_posix_count_lock_acquire(void)
+{
+	struct nvgpu_posix_call_stats *stats = nvgpu_posix_get_call_stats();
+
+	if (stats != NULL) {
+		stats->lock_acquires++;
+	}
+}
+#endif
 
 void nvgpu_rwsem_init(struct nvgpu_rwsem *rwsem)
 {
@@ -36,7 +50,12 @@ void nvgpu_rwsem_init(struct nvgpu_rwsem *rwsem)
  */
 void nvgpu_rwsem_down_read(struct nvgpu_rwsem *rwsem)
 {
-	int err = pthread_rwlock_rdlock(&rwsem->rw_sem);
+	int err;
+
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+	nvgpu_posix_count_lock_acquire();
+#endif
+	err = pthread_rwlock_rdlock(&rwsem->rw_sem);
 	nvgpu_assert(err == 0);
 }
 
@@ -51,7 +70,12 @@ void nvgpu_rwsem_up_read(struct nvgpu_rwsem *rwsem)
 
 void nvgpu_rwsem_down_write(struct nvgpu_rwsem *rwsem)
 {
-	int err = pthread_rwlock_wrlock(&rwsem->rw_sem);
+	int err;
+
+#ifdef NVGPU_UNITTEST_FAULT_INJECTION_ENABLEMENT
+	nvgpu_posix_count_lock_acquire();
+#endif
+	err = pthread_rwlock_wrlock(&rwsem->rw_sem);
 	nvgpu_assert(err == 0);
 }
 
@@ -171,6 +171,8 @@ int nvgpu_thread_create(struct nvgpu_thread *thread,
 		if ((pthread_join(thread->thread, NULL)) != 0) {
 			nvgpu_info(NULL, "Thread join error");
 		}
+		/* Joined already, stopping the thread must not join it again */
+		nvgpu_atomic_set(&thread->running, 0);
 	}
 #endif
 
@@ -267,6 +269,8 @@ int nvgpu_thread_create_priority(struct nvgpu_thread *thread,
 	if (nvgpu_posix_fault_injection_handle_call(
 				nvgpu_thread_serial_get_fault_injection())) {
 		(void) pthread_join(thread->thread, NULL);
+		/* Joined already, stopping the thread must not join it again */
+		nvgpu_atomic_set(&thread->running, 0);
 	}
 #endif
 
@@ -101,6 +101,10 @@ struct nvgpu_as_bind_channel_args {
  * will be used to determine the page size (largest possible).  The page size
  * chosen will be returned back to the caller in the 'page_size' parameter in
  * that case.
+ *
+ * With _MIXED_PAGES, a buffer mapped without _FIXED_OFFSET that ends up on
+ * small pages may map its big page aligned interior with big pages. Its VA
+ * reservation is then rounded up to whole page directory entries.
  */
 #define NVGPU_AS_MAP_BUFFER_FLAGS_FIXED_OFFSET		(1 << 0)
 #define NVGPU_AS_MAP_BUFFER_FLAGS_CACHEABLE		(1 << 2)
@@ -111,6 +115,7 @@ struct nvgpu_as_bind_channel_args {
 #define NVGPU_AS_MAP_BUFFER_FLAGS_DIRECT_KIND_CTRL	(1 << 8)
 #define NVGPU_AS_MAP_BUFFER_FLAGS_PLATFORM_ATOMIC	(1 << 9)
 #define NVGPU_AS_MAP_BUFFER_FLAGS_TEGRA_RAW		(1 << 12)
+#define NVGPU_AS_MAP_BUFFER_FLAGS_MIXED_PAGES		(1 << 13)
 
 #define NVGPU_AS_MAP_BUFFER_FLAGS_ACCESS_BITMASK_OFFSET    10U
 #define NVGPU_AS_MAP_BUFFER_FLAGS_ACCESS_BITMASK_SIZE      2U
@@ -145,11 +145,14 @@ struct nvgpu_tsg_set_l2_sector_promotion_args {
 #define NVGPU_TSG_IOCTL_BIND_SCHEDULING_DOMAIN \
 	_IOW(NVGPU_TSG_IOCTL_MAGIC, 16, \
 			struct nvgpu_tsg_bind_scheduling_domain_args)
+#define NVGPU_TSG_IOCTL_SUBMIT_GPFIFO_BATCH \
+	_IOWR(NVGPU_TSG_IOCTL_MAGIC, 17, \
+			struct nvgpu_tsg_submit_gpfifo_batch_args)
 #define NVGPU_TSG_IOCTL_MAX_ARG_SIZE	\
 		sizeof(struct nvgpu_tsg_bind_scheduling_domain_args)
 
 #define NVGPU_TSG_IOCTL_LAST		\
-	_IOC_NR(NVGPU_TSG_IOCTL_BIND_SCHEDULING_DOMAIN)
+	_IOC_NR(NVGPU_TSG_IOCTL_SUBMIT_GPFIFO_BATCH)
 
 /*
  * /dev/nvhost-dbg-gpu device
@@ -940,6 +943,46 @@ struct nvgpu_submit_gpfifo_args {
 	struct nvgpu_fence fence;
 };
 
+/*
+ * One channel's part of NVGPU_TSG_IOCTL_SUBMIT_GPFIFO_BATCH. The fields work
+ * like those of struct nvgpu_submit_gpfifo_args. Fences are raw syncpoint
+ * fences; NVGPU_SUBMIT_GPFIFO_FLAGS_SYNC_FENCE is not supported in batches.
+ */
+struct nvgpu_tsg_submit_gpfifo_entry {
+	/* in: channel bound to this TSG, at most once per batch */
+	__s32 channel_fd;
+	/* in: number of gpfifo entries */
+	__u32 num_entries;
+	/* in: pointer to num_entries struct nvgpu_gpfifo */
+	__u64 gpfifo;
+	/* in: NVGPU_SUBMIT_GPFIFO_FLAGS_* */
+	__u32 flags;
+/* no in-batch wait */
+#define NVGPU_TSG_SUBMIT_GPFIFO_NO_WAIT		0xffffffffU
+	/*
+	 * in: index of an earlier entry whose work has to finish before the
+	 * work of this one starts. The GPU waits for the post fence of that
+	 * entry, so this can't be combined with FLAGS_FENCE_WAIT.
+	 */
+	__u32 wait_index;
+	/* in: pre-fence; out: post fence with FLAGS_FENCE_GET */
+	struct nvgpu_fence fence;
+};
+
+#define NVGPU_TSG_SUBMIT_GPFIFO_BATCH_MAX_ENTRIES	16
+
+struct nvgpu_tsg_submit_gpfifo_batch_args {
+	/* in: pointer to num_entries struct nvgpu_tsg_submit_gpfifo_entry */
+	__u64 entries;
+	/* in: number of channels in the batch */
+	__u32 num_entries;
+	/*
+	 * out: number of entries submitted, also on failure. The doorbells
+	 * of submitted entries have been rung and their fences written back.
+	 */
+	__u32 num_submitted;
+};
+
 struct nvgpu_wait_args {
 #define NVGPU_WAIT_TYPE_NOTIFIER	0x0
 #define NVGPU_WAIT_TYPE_SEMAPHORE	0x1
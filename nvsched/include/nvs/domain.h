@@ -29,11 +29,18 @@ struct nvs_sched;
 struct nvs_domain;
 
 /*
- * nvsched provides a simple, singly linked list for keeping track of
+ * nvsched provides a simple, doubly linked list for keeping track of
  * available domains. If algorithms need something more complex, like a
  * table of priorities and domains therein, then it will need to build
  * these data structures during its init().
+ *
+ * Next to the list, domains are indexed by name and by ID in two chained
+ * hash tables so that lookups and removals do not need to walk the list.
+ * Both tables share the same number of buckets, which is always a power of
+ * two and grows with the number of domains.
  */
+#define NVS_DOMAIN_HASH_MIN_SIZE	16U
+
 struct nvs_domain_list {
 	u32			 nr;
 	struct nvs_domain	*domains;
@@ -42,17 +49,37 @@ struct nvs_domain_list {
 	 * Convenience for adding a domain quickly.
 	 */
 	struct nvs_domain	*last;
+
+	/*
+	 * Hash buckets; hash_size is the number of buckets in each table.
+	 */
+	u32			 hash_size;
+	struct nvs_domain	**name_hash;
+	struct nvs_domain	**id_hash;
 };
 
 struct nvs_domain {
 	char			 name[32];
 
+	/*
+	 * Caller assigned ID; used as the key for nvs_domain_by_id().
+	 */
+	u64			 id;
+
 	struct nvs_context_list	*ctx_list;
 
 	/*
-	 * Internal, singly linked list pointer.
+	 * Internal, doubly linked list pointers.
 	 */
 	struct nvs_domain	*next;
+	struct nvs_domain	*prev;
+
+	/*
+	 * Internal hash chain pointers and the cached hash of name.
+	 */
+	struct nvs_domain	*name_hash_next;
+	struct nvs_domain	*id_hash_next;
+	u32			 name_hash;
 
 	/*
 	 * Scheduling parameters: specify how long this domain should be scheduled
@@ -77,12 +104,24 @@ struct nvs_domain {
 	     (domain_ptr) != NULL;				\
 	     (domain_ptr) = (domain_ptr)->next)
 
+int nvs_domain_list_init(struct nvs_sched *sched);
+void nvs_domain_list_destroy(struct nvs_sched *sched);
+
 struct nvs_domain *nvs_domain_create(struct nvs_sched *sched,
-		  const char *name, u64 timeslice, u64 preempt_grace,
+		  u64 id, const char *name, u64 timeslice, u64 preempt_grace,
 		  void *priv);
 void nvs_domain_destroy(struct nvs_sched *sched, struct nvs_domain *dom);
 void nvs_domain_clear_all(struct nvs_sched *sched);
 u32 nvs_domain_count(struct nvs_sched *sched);
 struct nvs_domain *nvs_domain_by_name(struct nvs_sched *sched, const char *name);
+struct nvs_domain *nvs_domain_by_id(struct nvs_sched *sched, u64 id);
+
+/**
+ * @brief Get the domain following \a dom in round robin order.
+ *
+ * Wraps around to the first domain once the end of the list is reached.
+ */
+struct nvs_domain *nvs_domain_get_next(struct nvs_sched *sched,
+				       struct nvs_domain *dom);
 
 #endif
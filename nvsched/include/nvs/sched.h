@@ -138,7 +138,7 @@ struct nvs_sched {
 	struct nvs_sched_ops	*ops;
 
 	/**
-	 * List of domains. Internally stored as a singly linked
+	 * List of domains. Internally stored as a doubly linked
 	 * list.
 	 *
 	 * @sa struct nvs_domain_list
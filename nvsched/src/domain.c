@@ -24,11 +24,153 @@
 #include <nvs/sched.h>
 #include <nvs/domain.h>
 
+/*
+ * FNV-1a over the domain name. Names are short, so this is cheap and gives a
+ * good enough spread for the chained tables below.
+ */
+static u32 nvs_domain_hash_name(const char *name)
+{
+	u32 hash = 2166136261U;
+
+	while (*name != '\0') {
+		hash ^= (u32)(u8)*name;
+		hash *= 16777619U;
+		name++;
+	}
+
+	return hash;
+}
+
+static u32 nvs_domain_hash_id(u64 id)
+{
+	return (u32)(id ^ (id >> 32U)) * 2654435761U;
+}
+
+static void nvs_domain_hash_insert(struct nvs_domain **name_hash,
+				   struct nvs_domain **id_hash,
+				   u32 size, struct nvs_domain *dom)
+{
+	u32 nb = dom->name_hash & (size - 1U);
+	u32 ib = nvs_domain_hash_id(dom->id) & (size - 1U);
+
+	dom->name_hash_next = name_hash[nb];
+	name_hash[nb] = dom;
+
+	dom->id_hash_next = id_hash[ib];
+	id_hash[ib] = dom;
+}
+
+static void nvs_domain_hash_remove(struct nvs_domain_list *dlist,
+				   struct nvs_domain *dom)
+{
+	struct nvs_domain **pp;
+
+	pp = &dlist->name_hash[dom->name_hash & (dlist->hash_size - 1U)];
+	while (*pp != dom) {
+		pp = &(*pp)->name_hash_next;
+	}
+	*pp = dom->name_hash_next;
+
+	pp = &dlist->id_hash[nvs_domain_hash_id(dom->id) &
+			     (dlist->hash_size - 1U)];
+	while (*pp != dom) {
+		pp = &(*pp)->id_hash_next;
+	}
+	*pp = dom->id_hash_next;
+
+	dom->name_hash_next = NULL;
+	dom->id_hash_next = NULL;
+}
+
+static int nvs_domain_hash_alloc(struct nvs_sched *sched, u32 size,
+				 struct nvs_domain ***name_hash,
+				 struct nvs_domain ***id_hash)
+{
+	size_t bytes = (size_t)size * sizeof(struct nvs_domain *);
+
+	*name_hash = nvs_malloc(sched, bytes);
+	*id_hash = nvs_malloc(sched, bytes);
+	if (*name_hash == NULL || *id_hash == NULL) {
+		if (*name_hash != NULL) {
+			nvs_free(sched, *name_hash);
+		}
+		if (*id_hash != NULL) {
+			nvs_free(sched, *id_hash);
+		}
+		return -ENOMEM;
+	}
+
+	nvs_memset(*name_hash, 0, bytes);
+	nvs_memset(*id_hash, 0, bytes);
+
+	return 0;
+}
+
+/*
+ * Double the number of buckets once the tables are fully loaded. Failing to
+ * grow is not an error: the old tables remain valid, just with longer chains.
+ */
+static void nvs_domain_hash_grow(struct nvs_sched *sched)
+{
+	struct nvs_domain_list *dlist = sched->domain_list;
+	struct nvs_domain **name_hash, **id_hash;
+	struct nvs_domain *dom;
+	u32 size = dlist->hash_size * 2U;
+
+	if (size < dlist->hash_size) {
+		return;
+	}
+
+	if (nvs_domain_hash_alloc(sched, size, &name_hash, &id_hash) != 0) {
+		nvs_log(sched, "Failed to grow domain hash to %u", size);
+		return;
+	}
+
+	nvs_domain_for_each(sched, dom) {
+		nvs_domain_hash_insert(name_hash, id_hash, size, dom);
+	}
+
+	nvs_free(sched, dlist->name_hash);
+	nvs_free(sched, dlist->id_hash);
+
+	dlist->name_hash = name_hash;
+	dlist->id_hash   = id_hash;
+	dlist->hash_size = size;
+}
+
+int nvs_domain_list_init(struct nvs_sched *sched)
+{
+	struct nvs_domain_list *dlist = sched->domain_list;
+	int err;
+
+	err = nvs_domain_hash_alloc(sched, NVS_DOMAIN_HASH_MIN_SIZE,
+				    &dlist->name_hash, &dlist->id_hash);
+	if (err != 0) {
+		return err;
+	}
+
+	dlist->hash_size = NVS_DOMAIN_HASH_MIN_SIZE;
+
+	return 0;
+}
+
+void nvs_domain_list_destroy(struct nvs_sched *sched)
+{
+	struct nvs_domain_list *dlist = sched->domain_list;
+
+	nvs_free(sched, dlist->name_hash);
+	nvs_free(sched, dlist->id_hash);
+
+	dlist->name_hash = NULL;
+	dlist->id_hash   = NULL;
+	dlist->hash_size = 0U;
+}
+
 /*
  * Create and add a new domain to the end of the domain list.
  */
 struct nvs_domain *nvs_domain_create(struct nvs_sched *sched,
-		  const char *name, u64 timeslice, u64 preempt_grace,
+		  u64 id, const char *name, u64 timeslice, u64 preempt_grace,
 		  void *priv)
 {
 	struct nvs_domain_list *dlist = sched->domain_list;
@@ -43,12 +185,21 @@ struct nvs_domain *nvs_domain_create(struct nvs_sched *sched,
 	nvs_memset(dom, 0, sizeof(*dom));
 
 	strncpy(dom->name, name, sizeof(dom->name) - 1);
+	dom->id               = id;
+	dom->name_hash        = nvs_domain_hash_name(dom->name);
 	dom->timeslice_ns     = timeslice;
 	dom->preempt_grace_ns = preempt_grace;
 	dom->priv             = priv;
 
 	nvs_log_event(sched, NVS_EV_CREATE_DOMAIN, 0U);
 
+	if (dlist->nr >= dlist->hash_size) {
+		nvs_domain_hash_grow(sched);
+	}
+
+	nvs_domain_hash_insert(dlist->name_hash, dlist->id_hash,
+			       dlist->hash_size, dom);
+
 	/*
 	 * Now add the domain to the list of domains. If this is the first
 	 * domain we are done. Otherwise use the last pointer to quickly
@@ -61,6 +212,7 @@ struct nvs_domain *nvs_domain_create(struct nvs_sched *sched,
 		return dom;
 	}
 
+	dom->prev         = dlist->last;
 	dlist->last->next = dom;
 	dlist->last       = dom;
 
@@ -69,43 +221,25 @@ struct nvs_domain *nvs_domain_create(struct nvs_sched *sched,
 }
 
 /*
- * Unlink the domain from our list and clear the last pointer if this was the
- * only one remaining.
+ * Unlink the domain from our list and the hash tables.
  */
 static void nvs_domain_unlink(struct nvs_sched *sched,
 			      struct nvs_domain *dom)
 {
 	struct nvs_domain_list *dlist = sched->domain_list;
-	struct nvs_domain *tmp;
 
+	nvs_domain_hash_remove(dlist, dom);
 
-	if (dlist->domains == dom) {
+	if (dom->prev != NULL) {
+		dom->prev->next = dom->next;
+	} else {
 		dlist->domains = dom->next;
-
-		/*
-		 * If dom == last and dom is the first entry, then we have a
-		 * single entry in the list and we need to clear the last
-		 * pointer as well.
-		 */
-		if (dom == dlist->last) {
-			dlist->last = NULL;
-		}
-		return;
 	}
 
-	nvs_domain_for_each(sched, tmp) {
-		/*
-		 * If tmp's next pointer is dom, then we take tmp and have it
-		 * skip over dom. But also don't forget to handle last; if dom
-		 * is last, then last becomes the one before it.
-		 */
-		if (dom == tmp->next) {
-			tmp->next = dom->next;
-			if (dom == dlist->last) {
-				dlist->last = tmp;
-			}
-			return;
-		}
+	if (dom->next != NULL) {
+		dom->next->prev = dom->prev;
+	} else {
+		dlist->last = dom->prev;
 	}
 }
 
@@ -138,13 +272,45 @@ u32 nvs_domain_count(struct nvs_sched *sched)
 
 struct nvs_domain *nvs_domain_by_name(struct nvs_sched *sched, const char *name)
 {
+	struct nvs_domain_list *dlist = sched->domain_list;
 	struct nvs_domain *domain;
+	u32 hash = nvs_domain_hash_name(name);
 
-	nvs_domain_for_each(sched, domain) {
-		if (strcmp(domain->name, name) == 0) {
+	for (domain = dlist->name_hash[hash & (dlist->hash_size - 1U)];
+	     domain != NULL;
+	     domain = domain->name_hash_next) {
+		if (domain->name_hash == hash &&
+		    strcmp(domain->name, name) == 0) {
 			return domain;
 		}
 	}
 
 	return NULL;
 }
+
+struct nvs_domain *nvs_domain_by_id(struct nvs_sched *sched, u64 id)
+{
+	struct nvs_domain_list *dlist = sched->domain_list;
+	struct nvs_domain *domain;
+	u32 bucket = nvs_domain_hash_id(id) & (dlist->hash_size - 1U);
+
+	for (domain = dlist->id_hash[bucket];
+	     domain != NULL;
+	     domain = domain->id_hash_next) {
+		if (domain->id == id) {
+			return domain;
+		}
+	}
+
+	return NULL;
+}
+
+struct nvs_domain *nvs_domain_get_next(struct nvs_sched *sched,
+				       struct nvs_domain *dom)
+{
+	if (dom->next != NULL) {
+		return dom->next;
+	}
+
+	return sched->domain_list->domains;
+}
@@ -45,8 +45,15 @@ int nvs_sched_create(struct nvs_sched *sched,
 
 	nvs_memset(sched->domain_list, 0, sizeof(*sched->domain_list));
 
+	err = nvs_domain_list_init(sched);
+	if (err != 0) {
+		nvs_free(sched, sched->domain_list);
+		return err;
+	}
+
 	err = nvs_log_init(sched);
 	if (err != 0) {
+		nvs_domain_list_destroy(sched);
 		nvs_free(sched, sched->domain_list);
 		return err;
 	}
@@ -59,6 +66,7 @@ int nvs_sched_create(struct nvs_sched *sched,
 void nvs_sched_close(struct nvs_sched *sched)
 {
 	nvs_domain_clear_all(sched);
+	nvs_domain_list_destroy(sched);
 	nvs_free(sched, sched->domain_list);
 	nvs_log_destroy(sched);
 
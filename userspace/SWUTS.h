@@ -43,6 +43,7 @@
  *   - @ref SWUTS-bus
  *   - @ref SWUTS-falcon
  *   - @ref SWUTS-netlist
+ *   - @ref SWUTS-nvsched
  *   - @ref SWUTS-fifo
  *   - @ref SWUTS-fifo-channel
  *   - @ref SWUTS-fifo-channel-gk20a
@@ -72,6 +73,7 @@
  *   - @ref SWUTS-fifo-runlist
  *   - @ref SWUTS-fifo-runlist-gk20a
  *   - @ref SWUTS-fifo-runlist-gv11b
+ *   - @ref SWUTS-fifo-submit
  *   - @ref SWUTS-fifo-tsg
  *   - @ref SWUTS-fifo-tsg-gv11b
  *   - @ref SWUTS-fifo-userd-gk20a
@@ -122,6 +124,7 @@
  *   - @ref SWUTS-posix-utils
  *   - @ref SWUTS-posix-circbuf
  *   - @ref SWUTS-posix-kmem
+ *   - @ref SWUTS-posix-io
  *   - @ref SWUTS-priv_ring
  *   - @ref SWUTS-ptimer
  *   - @ref SWUTS-sdl
@@ -148,8 +151,11 @@
  *   - @ref SWUTS-gr-ctx
  *   - @ref SWUTS-gr-obj-ctx
  *   - @ref SWUTS-gr-config
+ *   - @ref SWUTS-gr-fecs-trace
+ *   - @ref SWUTS-gr-hwpm-map
  *   - @ref SWUTS-ecc
  *   - @ref SWUTS-pmu
+ *   - @ref SWUTS-regops
  *   - @ref SWUTS-io
  *
  */
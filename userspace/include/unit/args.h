@@ -57,6 +57,7 @@ struct unit_fw_args {
 	bool		 is_qnx;
 	unsigned int	 test_lvl;
 	bool		 debug;
+	bool		 bench;
 	const char	*binary_name;
 
 	const char	*driver_load_path;
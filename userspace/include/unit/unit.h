@@ -24,6 +24,7 @@
 #define __UNIT_UNIT_H__
 
 #include <pthread.h>
+#include <stdbool.h>
 
 struct gk20a;
 
@@ -58,6 +59,13 @@ struct unit_module_test {
 	 */
 	unsigned int test_lvl;
 
+	/*
+	 * Benchmarks only run when the FW is started with --bench, and then
+	 * nothing else runs. They report their measurements with unit_info()
+	 * and fail only if the code under measurement misbehaves.
+	 */
+	bool bench;
+
 	/*
 	 * A void pointer to arbitrary arguments. Lets the same unit test
 	 * function perform multiple tests. This gets passed into the
@@ -182,6 +190,28 @@ struct unit_module {
 		.jama.verification_criteria = __vc,			\
 	}
 
+/*
+ * Use this for a benchmark. See the bench field in struct unit_module_test.
+ */
+#define UNIT_BENCH(__name, __fn, __args, __test_lvl)			\
+	{								\
+		.fn_name = #__fn,					\
+		.case_name = #__name,					\
+		.fn = __fn,						\
+		.args = __args,						\
+		.test_lvl = __test_lvl,					\
+		.bench = true,						\
+		.jama.requirement = "",					\
+		.jama.unique_id = "",					\
+		.jama.verification_criteria = "",			\
+	}
+
+/*
+ * Average time in ns of each of @ops operations run since @start_ns, as read
+ * from nvgpu_current_time_ns(). For benchmarks to report their results.
+ */
+long long unit_bench_ns_per_op(long long start_ns, unsigned int ops);
+
 #define unit_return_fail(m, msg, ...)					\
 	do {								\
 		unit_err(m, "%s():%d " msg,				\
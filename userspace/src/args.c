@@ -42,10 +42,11 @@ static struct option core_opts[] = {
 	{ "test-level",		1, NULL, 't' },
 	{ "debug",		0, NULL, 'd' },
 	{ "required",		0, NULL, 'r' },
+	{ "bench",		0, NULL, 'b' },
 	{ NULL,			0, NULL,  0  }
 };
 
-static const char *core_opts_str = "hvqCnQL:K:j:t:dr:";
+static const char *core_opts_str = "hvqCnQL:K:j:t:dr:b";
 
 void core_print_help(struct unit_fw *fw)
 {
@@ -80,6 +81,8 @@ void core_print_help(struct unit_fw *fw)
 "                         crashes.\n",
 "  -r, --required <FILE>  Path to a file with a list of required tests to\n"
 "                         check if all were executed.\n",
+"  -b, --bench            Run the benchmarks instead of the tests. Modules\n",
+"                         are executed one at a time.\n",
 "\n",
 "Note: mandatory arguments to long arguments are mandatory for short\n",
 "arguments as well.\n",
@@ -180,6 +183,9 @@ int core_parse_args(struct unit_fw *fw, int argc, char **argv)
 		case 'r':
 			args->required_tests_file = optarg;
 			break;
+		case 'b':
+			args->bench = true;
+			break;
 		case '?':
 			args->help = true;
 			return -1;
@@ -189,6 +195,13 @@ int core_parse_args(struct unit_fw *fw, int argc, char **argv)
 		}
 	}
 
+	/*
+	 * Benchmarks running in parallel would measure each other.
+	 */
+	if (args->bench) {
+		args->thread_count = 1;
+	}
+
 	/*
 	 * If there is an extra argument after the command-line options, then
 	 * it is a unit test name that need to be specifically run.
@@ -105,6 +105,21 @@ static void *core_exec_module(void *module_param)
 		int test_status;
 		thread_local_test = t;
 
+		if (t->bench != module->fw->args->bench) {
+			/*
+			 * Only report skipped benchmarks; a benchmark run
+			 * would otherwise list every test.
+			 */
+			if (t->bench) {
+				core_add_test_record(module->fw, module, t,
+						SKIPPED);
+			}
+			core_vbs(module->fw, 1, "Skipping %s %s.%s\n",
+				t->bench ? "benchmark" : "test",
+				module->name, t->fn_name);
+			continue;
+		}
+
 		if (t->test_lvl > module->fw->args->test_lvl) {
 			core_add_test_record(module->fw, module, t, SKIPPED);
 			core_vbs(module->fw, 1, "Skipping L%d test %s.%s\n",
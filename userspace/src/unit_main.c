@@ -92,7 +92,10 @@ int main(int argc, char **argv)
 		return -2;
 	}
 
-	if (fw->args->required_tests_file != NULL) {
+	/*
+	 * A benchmark run skips the tests, so there is nothing to check.
+	 */
+	if (fw->args->required_tests_file != NULL && !fw->args->bench) {
 		ret = parse_req_file(fw, fw->args->required_tests_file);
 		if (ret != 0) {
 			core_err(fw,
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2021, NVIDIA CORPORATION.  All rights reserved.
+ * Copyright (c) 2021-2022, NVIDIA CORPORATION.  All rights reserved.
  *
  * Permission is hereby granted, free of charge, to any person obtaining a
  * copy of this software and associated documentation files (the "Software"),
@@ -21,6 +21,8 @@
  */
 
 #include <stdlib.h>
+#include <time.h>
+#include <unit/unit.h>
 #include <unit/utils.h>
 
 u32 get_random_u32(u32 min, u32 max)
@@ -30,3 +32,17 @@ u32 get_random_u32(u32 min, u32 max)
 
 	return value;
 }
+
+long long unit_bench_ns_per_op(long long start_ns, unsigned int ops)
+{
+	struct timespec ts;
+	long long now_ns;
+
+	/* the clock of nvgpu_current_time_ns() on POSIX */
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+		return -1;
+	}
+	now_ns = ((long long)ts.tv_sec * 1000000000LL) + (long long)ts.tv_nsec;
+
+	return (now_ns - start_ns) / (long long)ops;
+}
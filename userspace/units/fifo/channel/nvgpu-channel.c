@@ -1189,6 +1189,91 @@ static void stub_tsg_disable(struct nvgpu_tsg *tsg)
 	stub[1].tsgid = tsg->tsgid;
 }
 
+int test_channel_from_inst_index(struct unit_module *m, struct gk20a *g,
+								void *vargs)
+{
+	struct nvgpu_fifo *f = &g->fifo;
+	struct nvgpu_channel **chs = NULL;
+	struct nvgpu_channel *ch;
+	struct nvgpu_tsg *tsg = NULL;
+	u32 num_open = 0U;
+	u64 inst_ptr;
+	s64 start, ns;
+	u32 i;
+	int err;
+	int ret = UNIT_FAIL;
+
+	chs = calloc(f->num_channels, sizeof(*chs));
+	unit_assert(chs != NULL, goto done);
+
+	while (num_open < f->num_channels) {
+		chs[num_open] = nvgpu_channel_open_new(g,
+				NVGPU_INVALID_RUNLIST_ID, false,
+				getpid(), getpid());
+		if (chs[num_open] == NULL) {
+			break;
+		}
+		num_open++;
+	}
+	unit_assert(num_open > 1U, goto done);
+
+	/* every open channel is found through the index */
+	start = nvgpu_current_time_ns();
+	for (i = 0U; i < num_open; i++) {
+		inst_ptr = nvgpu_inst_block_addr(g, &chs[i]->inst_block);
+		ch = nvgpu_channel_refch_from_inst_ptr(g, inst_ptr);
+		unit_assert(ch == chs[i], goto done);
+		nvgpu_channel_put(ch);
+	}
+	ns = (nvgpu_current_time_ns() - start) / (s64)num_open;
+	unit_info(m, "%u open channels: %lld ns/lookup\n", num_open,
+		(long long)ns);
+
+	/* TSG lookup */
+	tsg = nvgpu_tsg_open(g, getpid());
+	unit_assert(tsg != NULL, goto done);
+	inst_ptr = nvgpu_inst_block_addr(g, &chs[0]->inst_block);
+	unit_assert(nvgpu_tsg_from_inst_ptr(g, inst_ptr, &ch) == NULL,
+		goto done);
+	unit_assert(ch == NULL, goto done);
+	unit_assert(nvgpu_atomic_read(&chs[0]->ref_count) == 1, goto done);
+	err = nvgpu_tsg_bind_channel(tsg, chs[0]);
+	unit_assert(err == 0, goto done);
+	unit_assert(nvgpu_tsg_from_inst_ptr(g, inst_ptr, &ch) == tsg,
+		goto done);
+	unit_assert(ch == chs[0], goto done);
+	unit_assert(nvgpu_atomic_read(&ch->ref_count) == 2, goto done);
+	nvgpu_channel_put(ch);
+	unit_assert(nvgpu_tsg_from_inst_ptr(g, (u64)-1, &ch) == NULL,
+		goto done);
+	unit_assert(ch == NULL, goto done);
+
+	/* closed channels are dropped from the index */
+	inst_ptr = nvgpu_inst_block_addr(g, &chs[num_open - 1U]->inst_block);
+	nvgpu_channel_close(chs[num_open - 1U]);
+	num_open--;
+	unit_assert(nvgpu_channel_refch_from_inst_ptr(g, inst_ptr) == NULL,
+		goto done);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	if (ret != UNIT_SUCCESS) {
+		unit_err(m, "%s failed\n", __func__);
+	}
+	if (chs != NULL) {
+		for (i = 0U; i < num_open; i++) {
+			nvgpu_channel_close(chs[i]);
+		}
+		free(chs);
+	}
+	if (tsg != NULL) {
+		nvgpu_ref_put(&tsg->refcount, nvgpu_tsg_release);
+	}
+
+	return ret;
+}
+
 int test_channel_enable_disable_tsg(struct unit_module *m,
 						struct gk20a *g, void *vargs)
 {
@@ -1881,6 +1966,130 @@ done:
 	return ret;
 }
 
+#define CHANNEL_WAKEUP_SCALING_WAITERS		4U
+#define CHANNEL_WAKEUP_SCALING_LOOPS		1000U
+
+static s64 channel_semaphore_wakeup_avg_ns(struct gk20a *g)
+{
+	s64 start;
+	u32 i;
+
+	start = nvgpu_current_time_ns();
+	for (i = 0U; i < CHANNEL_WAKEUP_SCALING_LOOPS; i++) {
+		nvgpu_channel_semaphore_wakeup(g, false);
+	}
+
+	return (nvgpu_current_time_ns() - start) /
+		(s64)CHANNEL_WAKEUP_SCALING_LOOPS;
+}
+
+int test_channel_semaphore_wakeup_scaling(struct unit_module *m,
+						struct gk20a *g, void *vargs)
+{
+	struct nvgpu_fifo *f = &g->fifo;
+	struct gpu_ops gops = g->ops;
+	struct nvgpu_channel **chs = NULL;
+	u32 num_open = 0U;
+	u32 fractions[] = { 8U, 4U, 2U, 1U };
+	u32 target, i;
+	u32 flushes;
+	s64 ns;
+	int ret = UNIT_FAIL;
+
+	g->ops.mm.cache.fb_flush = stub_mm_fb_flush;
+	global_count = 0U;
+
+	chs = calloc(f->num_channels, sizeof(*chs));
+	unit_assert(chs != NULL, goto done);
+
+	for (i = 0U; i < ARRAY_SIZE(fractions); i++) {
+		target = f->num_channels / fractions[i];
+
+		while (num_open < target) {
+			chs[num_open] = nvgpu_channel_open_new(g,
+					NVGPU_INVALID_RUNLIST_ID, false,
+					getpid(), getpid());
+			if (chs[num_open] == NULL) {
+				/* some channels may already be in use */
+				break;
+			}
+			num_open++;
+		}
+		unit_assert(num_open > CHANNEL_WAKEUP_SCALING_WAITERS,
+			goto done);
+
+		/* only a fixed handful of channels have waiters */
+		if (i == 0U) {
+			u32 j;
+
+			for (j = 0U; j < CHANNEL_WAKEUP_SCALING_WAITERS; j++) {
+				nvgpu_channel_semaphore_wakeup_get(chs[j]);
+			}
+		}
+
+		flushes = global_count;
+		ns = channel_semaphore_wakeup_avg_ns(g);
+		unit_assert(global_count - flushes ==
+			CHANNEL_WAKEUP_SCALING_LOOPS, goto done);
+
+		unit_info(m, "%u open channels, %u waiters: %lld ns/wakeup\n",
+			num_open, CHANNEL_WAKEUP_SCALING_WAITERS,
+			(long long)ns);
+	}
+
+	/* only channels with waiters are tracked */
+	for (i = 0U; i < num_open; i++) {
+		bool tracked = nvgpu_test_bit(chs[i]->chid,
+					f->sema_wakeup_chids);
+
+		unit_assert(tracked == (i < CHANNEL_WAKEUP_SCALING_WAITERS),
+			goto done);
+	}
+
+	/* nested refs keep the channel tracked until the last put */
+	nvgpu_channel_semaphore_wakeup_get(chs[0]);
+	nvgpu_channel_semaphore_wakeup_put(chs[0]);
+	unit_assert(nvgpu_test_bit(chs[0]->chid, f->sema_wakeup_chids),
+		goto done);
+	nvgpu_channel_semaphore_wakeup_put(chs[0]);
+	unit_assert(!nvgpu_test_bit(chs[0]->chid, f->sema_wakeup_chids),
+		goto done);
+
+	/* unbalanced put does not underflow */
+	nvgpu_channel_semaphore_wakeup_put(chs[0]);
+	unit_assert(chs[0]->sema_wakeup_refs == 0U, goto done);
+
+	/* event listeners force a full scan when posting events */
+	nvgpu_channel_semaphore_wakeup_events_get(g);
+	nvgpu_channel_semaphore_wakeup(g, true);
+	nvgpu_channel_semaphore_wakeup_events_put(g);
+	unit_assert(nvgpu_atomic_read(&f->sema_wakeup_event_users) == 0,
+		goto done);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	if (ret != UNIT_SUCCESS) {
+		unit_err(m, "%s failed\n", __func__);
+	}
+	if (chs != NULL) {
+		/* closing drops any remaining wakeup refs */
+		for (i = 0U; i < num_open; i++) {
+			u32 chid = chs[i]->chid;
+
+			nvgpu_channel_close(chs[i]);
+			if (nvgpu_test_bit(chid, f->sema_wakeup_chids)) {
+				unit_err(m, "chid %u still tracked\n", chid);
+				ret = UNIT_FAIL;
+			}
+		}
+		free(chs);
+	}
+	g->ops = gops;
+
+	return ret;
+}
+
 int test_channel_from_invalid_id(struct unit_module *m, struct gk20a *g,
 								void *args)
 {
@@ -2164,6 +2373,7 @@ struct unit_module_test nvgpu_channel_tests[] = {
 	UNIT_TEST(setup_bind, test_channel_setup_bind, &unit_ctx, 0),
 	UNIT_TEST(alloc_inst, test_channel_alloc_inst, &unit_ctx, 0),
 	UNIT_TEST(from_inst, test_channel_from_inst, &unit_ctx, 0),
+	UNIT_TEST(from_inst_index, test_channel_from_inst_index, &unit_ctx, 0),
 	UNIT_TEST(enable_disable_tsg,
 			test_channel_enable_disable_tsg, &unit_ctx, 0),
 	UNIT_TEST(ch_abort, test_channel_abort, &unit_ctx, 0),
@@ -2175,6 +2385,7 @@ struct unit_module_test nvgpu_channel_tests[] = {
 	UNIT_TEST(suspend_resume, test_channel_suspend_resume_serviceable_chs, &unit_ctx, 0),
 	UNIT_TEST(debug_dump, test_channel_debug_dump, &unit_ctx, 0),
 	UNIT_TEST(semaphore_wakeup, test_channel_semaphore_wakeup, &unit_ctx, 0),
+	UNIT_TEST(semaphore_wakeup_scaling, test_channel_semaphore_wakeup_scaling, &unit_ctx, 0),
 	UNIT_TEST(channel_from_invalid_id, test_channel_from_invalid_id, &unit_ctx, 0),
 	UNIT_TEST(nvgpu_channel_from_chid_bvec, test_nvgpu_channel_from_id_bvec, &unit_ctx, 0),
 	UNIT_TEST(channel_put_warn, test_channel_put_warn, &unit_ctx, 0),
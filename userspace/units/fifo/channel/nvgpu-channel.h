@@ -235,6 +235,32 @@ int test_channel_alloc_inst(struct unit_module *m,
 int test_channel_from_inst(struct unit_module *m,
 						struct gk20a *g, void *vargs);
 
+/**
+ * Test specification for: test_channel_from_inst_index
+ *
+ * Description: Instance block address index lookup
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_channel_refch_from_inst_ptr, nvgpu_tsg_from_inst_ptr,
+ *          nvgpu_channel_alloc_inst, nvgpu_channel_free_inst
+ *
+ * Input: test_fifo_init_support() run for this GPU
+ *
+ * Steps:
+ * - Open as many channels as possible.
+ * - Look up every channel from its instance block address, and check
+ *   that the same channel is returned. Report the average lookup time.
+ * - Check that nvgpu_tsg_from_inst_ptr returns NULL and holds no channel
+ *   reference for a channel that is not bound to a TSG, and the TSG with
+ *   a reference to the channel once the channel is bound.
+ * - Close a channel and check that it can no longer be looked up.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_channel_from_inst_index(struct unit_module *m, struct gk20a *g,
+								void *vargs);
+
 /**
  * Test specification for: test_channel_enable_disable_tsg
  *
@@ -402,6 +428,35 @@ int test_channel_debug_dump(struct unit_module *m,
 int test_channel_semaphore_wakeup(struct unit_module *m,
 						struct gk20a *g, void *vargs);
 
+/**
+ * Test specification for: test_channel_semaphore_wakeup_scaling
+ *
+ * Description: Semaphore wakeup cost against the number of open channels
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_channel_semaphore_wakeup,
+ *          nvgpu_channel_semaphore_wakeup_get,
+ *          nvgpu_channel_semaphore_wakeup_put,
+ *          nvgpu_channel_semaphore_wakeup_events_get,
+ *          nvgpu_channel_semaphore_wakeup_events_put
+ *
+ * Input: test_fifo_init_support() run for this GPU
+ *
+ * Steps:
+ * - Register a fixed number of channels for semaphore wakeups.
+ * - Open 1/8, 1/4, 1/2 and then all channels, and measure the average
+ *   time of nvgpu_channel_semaphore_wakeup() at each step.
+ * - Check that only registered channels are tracked, that nested
+ *   references are counted, and that an unbalanced put does not underflow.
+ * - Check that a wakeup posting events with a TSG event listener succeeds.
+ * - Close all channels and check that no channel remains tracked.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_channel_semaphore_wakeup_scaling(struct unit_module *m,
+						struct gk20a *g, void *vargs);
+
 /**
  * Test specification for: test_channel_from_invalid_id
  *
@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 2018-2021, NVIDIA CORPORATION.  All rights reserved.
+ * Copyright (c) 2018-2022, NVIDIA CORPORATION.  All rights reserved.
  *
  * Permission is hereby granted, free of charge, to any person obtaining a
  * copy of this software and associated documentation files (the "Software"),
@@ -20,14 +20,405 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <unit/io.h>
 #include <unit/unit.h>
-#include <unit/utils.h>
+
+#include <nvgpu/channel.h>
+#include <nvgpu/tsg.h>
+#include <nvgpu/gk20a.h>
+#include <nvgpu/runlist.h>
+
+#include "../nvgpu-fifo-common.h"
+#include "nvgpu-runlist.h"
+
+#define RUNLIST_TEST_NUM_CHANNELS	4U
+#define RUNLIST_TEST_NUM_TSGS		3U
+#define RUNLIST_TEST_CH_PER_TSG		2U
+/* first word of the TSG entries written by stub_runlist_get_tsg_entry */
+#define RUNLIST_TEST_TSG_ENTRY		0x80000000U
+
+static u32 hw_submits;
+static u32 tsg_encodes;
+static u32 ch_encodes;
+
+static void stub_runlist_hw_submit(struct gk20a *g, struct nvgpu_runlist *rl)
+{
+	(void)g;
+	(void)rl;
+	hw_submits++;
+}
+
+static void stub_runlist_get_tsg_entry(struct nvgpu_tsg *tsg,
+		u32 *runlist, u32 timeslice)
+{
+	(void)timeslice;
+	runlist[0] = RUNLIST_TEST_TSG_ENTRY | tsg->tsgid;
+	runlist[1] = 0U;
+	tsg_encodes++;
+}
+
+static void stub_runlist_get_ch_entry(struct nvgpu_channel *ch, u32 *runlist)
+{
+	runlist[0] = ch->chid;
+	runlist[1] = 0U;
+	ch_encodes++;
+}
+
+static int stub_runlist_wait_pending_ETIMEDOUT(struct gk20a *g,
+		struct nvgpu_runlist *rl)
+{
+	(void)g;
+	(void)rl;
+	return -ETIMEDOUT;
+}
+
+static bool runlist_ch_active(struct nvgpu_channel *ch)
+{
+	return nvgpu_test_bit(ch->chid, ch->runlist->domain->active_channels);
+}
+
+int test_runlist_batch(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct gpu_ops gops = g->ops;
+	u32 ptimer_src_freq = g->ptimer_src_freq;
+	struct nvgpu_channel *ch[RUNLIST_TEST_NUM_CHANNELS] = { NULL };
+	struct nvgpu_channel *bare_ch = NULL;
+	struct nvgpu_runlist_batch batch;
+	struct nvgpu_tsg *tsg = NULL;
+	int ret = UNIT_FAIL;
+	u32 i;
+	int err;
+
+	(void)args;
+
+	g->ops.runlist.hw_submit = stub_runlist_hw_submit;
+	/* channels have no instance block to encode */
+	g->ops.runlist.get_ch_entry = stub_runlist_get_ch_entry;
+	/* TSG entries carry a timeslice scaled to ptimer ticks */
+	g->ptimer_src_freq = 31250000U;
+
+	tsg = nvgpu_tsg_open(g, getpid());
+	unit_assert(tsg != NULL, goto done);
+
+	for (i = 0U; i < RUNLIST_TEST_NUM_CHANNELS; i++) {
+		ch[i] = nvgpu_channel_open_new(g, NVGPU_INVALID_RUNLIST_ID,
+				false, getpid(), getpid());
+		unit_assert(ch[i] != NULL, goto done);
+		err = nvgpu_tsg_bind_channel(tsg, ch[i]);
+		unit_assert(err == 0, goto done);
+	}
+
+	bare_ch = nvgpu_channel_open_new(g, NVGPU_INVALID_RUNLIST_ID,
+			false, getpid(), getpid());
+	unit_assert(bare_ch != NULL, goto done);
+
+	/* all channels of a runlist are added with a single submit */
+	hw_submits = 0U;
+	nvgpu_runlist_batch_begin(g, &batch);
+	for (i = 0U; i < RUNLIST_TEST_NUM_CHANNELS; i++) {
+		nvgpu_runlist_batch_queue(&batch, ch[i], true);
+	}
+	err = nvgpu_runlist_batch_commit(&batch, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(hw_submits == 1U, goto done);
+	for (i = 0U; i < RUNLIST_TEST_NUM_CHANNELS; i++) {
+		unit_assert(runlist_ch_active(ch[i]), goto done);
+	}
+	unit_assert(tsg->num_active_channels == RUNLIST_TEST_NUM_CHANNELS,
+		goto done);
+
+	/* the last operation on a channel wins, no change means no submit */
+	hw_submits = 0U;
+	nvgpu_runlist_batch_begin(g, &batch);
+	nvgpu_runlist_batch_queue(&batch, ch[0], false);
+	nvgpu_runlist_batch_queue(&batch, ch[0], true);
+	nvgpu_runlist_batch_queue(&batch, ch[1], true);
+	err = nvgpu_runlist_batch_commit(&batch, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(hw_submits == 0U, goto done);
+	unit_assert(runlist_ch_active(ch[0]), goto done);
+
+	nvgpu_runlist_batch_begin(g, &batch);
+	nvgpu_runlist_batch_queue(&batch, ch[0], true);
+	nvgpu_runlist_batch_queue(&batch, ch[0], false);
+	err = nvgpu_runlist_batch_commit(&batch, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(hw_submits == 1U, goto done);
+	unit_assert(!runlist_ch_active(ch[0]), goto done);
+	unit_assert(runlist_ch_active(ch[1]), goto done);
+
+	/* a reload and channel changes of the same runlist: one submit */
+	hw_submits = 0U;
+	nvgpu_runlist_batch_begin(g, &batch);
+	nvgpu_runlist_batch_queue(&batch, ch[0], true);
+	nvgpu_runlist_batch_queue_reload(&batch, BIT32(ch[0]->runlist->id),
+		true);
+	err = nvgpu_runlist_batch_commit(&batch, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(hw_submits == 1U, goto done);
+	unit_assert(runlist_ch_active(ch[0]), goto done);
+
+	hw_submits = 0U;
+	err = nvgpu_runlist_reload_ids(g, BIT32(ch[0]->runlist->id), true);
+	unit_assert(err == 0, goto done);
+	unit_assert(hw_submits == 1U, goto done);
+
+	/*
+	 * A channel without TSG fails the batch, the other operations are
+	 * still applied.
+	 */
+	hw_submits = 0U;
+	nvgpu_runlist_batch_begin(g, &batch);
+	nvgpu_runlist_batch_queue(&batch, bare_ch, true);
+	nvgpu_runlist_batch_queue(&batch, ch[0], false);
+	err = nvgpu_runlist_batch_commit(&batch, true);
+	unit_assert(err == -EINVAL, goto done);
+	unit_assert(hw_submits == 1U, goto done);
+	unit_assert(!runlist_ch_active(ch[0]), goto done);
+	unit_assert(!runlist_ch_active(bare_ch), goto done);
+
+	/* a runlist that does not go pending fails the batch */
+	g->ops.runlist.wait_pending = stub_runlist_wait_pending_ETIMEDOUT;
+	nvgpu_runlist_batch_begin(g, &batch);
+	nvgpu_runlist_batch_queue(&batch, ch[0], true);
+	err = nvgpu_runlist_batch_commit(&batch, true);
+	unit_assert(err == -ETIMEDOUT, goto done);
+	unit_assert(runlist_ch_active(ch[0]), goto done);
+
+	/* without waiting, the timeout goes unnoticed */
+	nvgpu_runlist_batch_begin(g, &batch);
+	nvgpu_runlist_batch_queue(&batch, ch[0], false);
+	err = nvgpu_runlist_batch_commit(&batch, false);
+	unit_assert(err == 0, goto done);
+	g->ops.runlist.wait_pending = gops.runlist.wait_pending;
+
+	/* remove all channels with a single submit */
+	hw_submits = 0U;
+	nvgpu_runlist_batch_begin(g, &batch);
+	for (i = 0U; i < RUNLIST_TEST_NUM_CHANNELS; i++) {
+		nvgpu_runlist_batch_queue(&batch, ch[i], false);
+	}
+	err = nvgpu_runlist_batch_commit(&batch, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(hw_submits == 1U, goto done);
+	unit_assert(tsg->num_active_channels == 0U, goto done);
+	unit_assert(!nvgpu_test_bit(tsg->tsgid,
+		ch[0]->runlist->domain->active_tsgs), goto done);
+
+	/* an empty batch submits nothing */
+	nvgpu_runlist_batch_begin(g, &batch);
+	err = nvgpu_runlist_batch_commit(&batch, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(hw_submits == 1U, goto done);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	g->ops = gops;
+	g->ptimer_src_freq = ptimer_src_freq;
+	for (i = 0U; i < RUNLIST_TEST_NUM_CHANNELS; i++) {
+		if (ch[i] != NULL) {
+			nvgpu_channel_close(ch[i]);
+		}
+	}
+	if (bare_ch != NULL) {
+		nvgpu_channel_close(bare_ch);
+	}
+	if (tsg != NULL) {
+		nvgpu_ref_put(&tsg->refcount, nvgpu_tsg_release);
+	}
+	return ret;
+}
 
 /*
- * Place holder for runlist unit tests. These will be written once the new
- * runlist code is in place.
+ * Compare the first word of each entry of the runlist last submitted to the
+ * entries expected.
  */
+static bool runlist_check_entries(struct gk20a *g, struct nvgpu_runlist *rl,
+		const u32 *expected, u32 count)
+{
+	u32 entry_words = g->fifo.runlist_entry_size / (u32)sizeof(u32);
+	u32 *entries = rl->domain->mem_hw->mem.cpu_va;
+	u32 i;
+
+	if (rl->domain->mem_hw->count != count) {
+		return false;
+	}
+
+	for (i = 0U; i < count; i++) {
+		if (entries[i * entry_words] != expected[i]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Fill in the first words of the runlist entries expected for the TSGs in
+ * order, with all their channels but skip_ch.
+ */
+static u32 runlist_expect(u32 *expected, const u32 *order, u32 num_tsgs,
+		struct nvgpu_tsg **tsg,
+		struct nvgpu_channel *ch[][RUNLIST_TEST_CH_PER_TSG],
+		struct nvgpu_channel *skip_ch)
+{
+	u32 n = 0U;
+	u32 i, j;
+
+	for (i = 0U; i < num_tsgs; i++) {
+		expected[n++] = RUNLIST_TEST_TSG_ENTRY | tsg[order[i]]->tsgid;
+		for (j = 0U; j < RUNLIST_TEST_CH_PER_TSG; j++) {
+			if (ch[order[i]][j] != skip_ch) {
+				expected[n++] = ch[order[i]][j]->chid;
+			}
+		}
+	}
+
+	return n;
+}
+
+int test_runlist_tsg_cache(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct gpu_ops gops = g->ops;
+	u32 ptimer_src_freq = g->ptimer_src_freq;
+	bool runlist_interleave = g->runlist_interleave;
+	struct nvgpu_channel *ch[RUNLIST_TEST_NUM_TSGS][RUNLIST_TEST_CH_PER_TSG];
+	struct nvgpu_tsg *tsg[RUNLIST_TEST_NUM_TSGS] = { NULL };
+	struct nvgpu_runlist *rl;
+	/* runlist order of the TSGs, by index in tsg[] */
+	const u32 order_all[] = { 2U, 1U, 2U, 0U };
+	const u32 order_no_low[] = { 2U, 1U };
+	u32 expected[RUNLIST_TEST_NUM_TSGS * 2U *
+			(RUNLIST_TEST_CH_PER_TSG + 1U)];
+	u32 n, i, j;
+	int ret = UNIT_FAIL;
+	int err;
+
+	(void)args;
+
+	(void)memset(ch, 0, sizeof(ch));
+
+	g->ops.runlist.hw_submit = stub_runlist_hw_submit;
+	g->ops.runlist.get_tsg_entry = stub_runlist_get_tsg_entry;
+	g->ops.runlist.get_ch_entry = stub_runlist_get_ch_entry;
+	g->ptimer_src_freq = 31250000U;
+	g->runlist_interleave = true;
+
+	/* TSG i is at interleave level i: low, medium and high */
+	for (i = 0U; i < RUNLIST_TEST_NUM_TSGS; i++) {
+		tsg[i] = nvgpu_tsg_open(g, getpid());
+		unit_assert(tsg[i] != NULL, goto done);
+		tsg[i]->interleave_level = i;
+
+		for (j = 0U; j < RUNLIST_TEST_CH_PER_TSG; j++) {
+			ch[i][j] = nvgpu_channel_open_new(g,
+					NVGPU_INVALID_RUNLIST_ID, false,
+					getpid(), getpid());
+			unit_assert(ch[i][j] != NULL, goto done);
+			err = nvgpu_tsg_bind_channel(tsg[i], ch[i][j]);
+			unit_assert(err == 0, goto done);
+		}
+	}
+	rl = ch[0][0]->runlist;
+
+	for (i = 0U; i < RUNLIST_TEST_NUM_TSGS; i++) {
+		for (j = 0U; j < RUNLIST_TEST_CH_PER_TSG; j++) {
+			err = nvgpu_runlist_update(g, rl, ch[i][j], true, true);
+			unit_assert(err == 0, goto done);
+		}
+	}
+
+	/* the high TSG runs around the medium one, both before the low one */
+	n = runlist_expect(expected, order_all, 4U, tsg, ch, NULL);
+	unit_assert(runlist_check_entries(g, rl, expected, n), goto done);
+
+	/*
+	 * Removing a channel only encodes its own TSG again, once even though
+	 * the TSG is twice in the runlist.
+	 */
+	tsg_encodes = 0U;
+	ch_encodes = 0U;
+	err = nvgpu_runlist_update(g, rl, ch[2][1], false, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(tsg_encodes == 1U, goto done);
+	unit_assert(ch_encodes == 1U, goto done);
+	n = runlist_expect(expected, order_all, 4U, tsg, ch, ch[2][1]);
+	unit_assert(runlist_check_entries(g, rl, expected, n), goto done);
+
+	/* so does adding it back */
+	tsg_encodes = 0U;
+	ch_encodes = 0U;
+	err = nvgpu_runlist_update(g, rl, ch[2][1], true, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(tsg_encodes == 1U, goto done);
+	unit_assert(ch_encodes == RUNLIST_TEST_CH_PER_TSG, goto done);
+	n = runlist_expect(expected, order_all, 4U, tsg, ch, NULL);
+	unit_assert(runlist_check_entries(g, rl, expected, n), goto done);
+
+	/* a reload encodes every TSG once, whatever its interleave level */
+	tsg_encodes = 0U;
+	ch_encodes = 0U;
+	err = nvgpu_runlist_reload(g, rl, rl->domain, true, true);
+	unit_assert(err == 0, goto done);
+	unit_assert(tsg_encodes == RUNLIST_TEST_NUM_TSGS, goto done);
+	unit_assert(ch_encodes ==
+		RUNLIST_TEST_NUM_TSGS * RUNLIST_TEST_CH_PER_TSG, goto done);
+
+	/*
+	 * Once the low TSG is gone, the high TSG only runs before the medium
+	 * one. The last channel of a TSG takes the TSG off the runlist without
+	 * encoding it.
+	 */
+	tsg_encodes = 0U;
+	ch_encodes = 0U;
+	for (j = 0U; j < RUNLIST_TEST_CH_PER_TSG; j++) {
+		err = nvgpu_runlist_update(g, rl, ch[0][j], false, true);
+		unit_assert(err == 0, goto done);
+	}
+	unit_assert(tsg_encodes == 1U, goto done);
+	unit_assert(ch_encodes == 1U, goto done);
+	n = runlist_expect(expected, order_no_low, 2U, tsg, ch, NULL);
+	unit_assert(runlist_check_entries(g, rl, expected, n), goto done);
+
+	for (i = 1U; i < RUNLIST_TEST_NUM_TSGS; i++) {
+		for (j = 0U; j < RUNLIST_TEST_CH_PER_TSG; j++) {
+			err = nvgpu_runlist_update(g, rl, ch[i][j], false,
+					true);
+			unit_assert(err == 0, goto done);
+		}
+	}
+	unit_assert(rl->domain->mem_hw->count == 0U, goto done);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	g->ops = gops;
+	g->ptimer_src_freq = ptimer_src_freq;
+	g->runlist_interleave = runlist_interleave;
+	for (i = 0U; i < RUNLIST_TEST_NUM_TSGS; i++) {
+		for (j = 0U; j < RUNLIST_TEST_CH_PER_TSG; j++) {
+			if (ch[i][j] != NULL) {
+				nvgpu_channel_close(ch[i][j]);
+			}
+		}
+		if (tsg[i] != NULL) {
+			nvgpu_ref_put(&tsg[i]->refcount, nvgpu_tsg_release);
+		}
+	}
+	return ret;
+}
+
 struct unit_module_test nvgpu_runlist_tests[] = {
+	UNIT_TEST(init_support, test_fifo_init_support, NULL, 0),
+	UNIT_TEST(batch, test_runlist_batch, NULL, 0),
+	UNIT_TEST(tsg_cache, test_runlist_tsg_cache, NULL, 0),
+	UNIT_TEST(remove_support, test_fifo_remove_support, NULL, 0),
 };
 
 UNIT_MODULE(nvgpu_runlist, nvgpu_runlist_tests, UNIT_PRIO_NVGPU_TEST);
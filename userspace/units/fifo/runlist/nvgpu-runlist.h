@@ -391,4 +391,70 @@ int test_interleave_dual(struct unit_module *m, struct gk20a *g, void *args);
 int test_interleaving_levels(struct unit_module *m, struct gk20a *g,
 								void *args);
 
+/**
+ * Test specification for: test_runlist_batch
+ *
+ * Description: Batched runlist updates.
+ *
+ * Test Type: Feature, Error injection
+ *
+ * Targets: nvgpu_runlist_batch_begin, nvgpu_runlist_batch_queue,
+ *          nvgpu_runlist_batch_queue_reload, nvgpu_runlist_batch_commit,
+ *          nvgpu_runlist_reload_ids
+ *
+ * Input: test_fifo_init_support
+ *
+ * Steps:
+ * - Open a TSG with 4 channels, and a channel without TSG. Count runlist
+ *   submits by stubbing g->ops.runlist.hw_submit.
+ * - Add all channels of the TSG in one batch and check that they are active
+ *   after a single submit.
+ * - Queue a remove and then an add of the same channel, and check that the
+ *   channel stays active and that nothing is submitted. Queue an add and then
+ *   a remove of the same channel, and check that it is removed.
+ * - Check that a batch with a channel add and a reload of its runlist, and
+ *   nvgpu_runlist_reload_ids, submit once.
+ * - Queue the channel without TSG and a remove, and check that the commit
+ *   fails with -EINVAL and still removes the other channel.
+ * - Stub g->ops.runlist.wait_pending to time out, and check that the commit
+ *   fails with -ETIMEDOUT, unless it does not wait for the runlist.
+ * - Remove all channels in one batch and check that the TSG is no longer
+ *   active after a single submit.
+ * - Check that an empty batch submits nothing.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_runlist_batch(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_runlist_tsg_cache
+ *
+ * Description: Runlist entries are cached per TSG and only the TSGs that
+ * changed are encoded again.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_runlist_update, nvgpu_runlist_reload,
+ *          nvgpu_runlist_construct_locked
+ *
+ * Input: test_fifo_init_support
+ *
+ * Steps:
+ * - Open 3 TSGs at interleave levels low, medium and high, with 2 channels
+ *   each, and enable runlist interleaving. Count encoded TSG and channel
+ *   entries by stubbing g->ops.runlist.get_tsg_entry and get_ch_entry.
+ * - Add all channels and check the runlist: high, medium, high, low, each
+ *   TSG entry followed by its channels.
+ * - Remove a channel of the high TSG and check that only that TSG is encoded
+ *   again, and that it is without the channel at both places in the runlist.
+ *   Add the channel back and check the same.
+ * - Reload the runlist and check that each TSG and channel is encoded once.
+ * - Remove the channels of the low TSG and check that only the first removal
+ *   encodes it, and that the runlist is high, medium.
+ * - Remove all channels and check that the runlist is empty.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_runlist_tsg_cache(struct unit_module *m, struct gk20a *g, void *args);
+
 #endif /* UNIT_NVGPU_RUNLIST_H */
@@ -0,0 +1,1557 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <unit/io.h>
+#include <unit/unit.h>
+
+#include <nvgpu/gk20a.h>
+
+#if defined(CONFIG_NVGPU_KERNEL_MODE_SUBMIT) && \
+	defined(CONFIG_TEGRA_GK20A_NVHOST)
+#define SUBMIT_UNIT_SUPPORTED
+#endif
+
+#ifdef SUBMIT_UNIT_SUPPORTED
+#include <nvgpu/channel.h>
+#include <nvgpu/dma.h>
+#include <nvgpu/vm.h>
+#include <nvgpu/gmmu.h>
+#include <nvgpu/pd_cache.h>
+#include <nvgpu/fence.h>
+#include <nvgpu/os_fence.h>
+#include <nvgpu/job.h>
+#include <nvgpu/priv_cmdbuf.h>
+#include <nvgpu/watchdog.h>
+#include <nvgpu/nvgpu_init.h>
+#include <nvgpu/enabled.h>
+#include <nvgpu/timers.h>
+#include <nvgpu/bitops.h>
+#include <nvgpu/posix/io.h>
+#include <nvgpu/posix/posix-fault-injection.h>
+#include <os/posix/os_posix.h>
+
+#include "common/fence/fence_priv.h"
+#include "common/sync/channel_sync_priv.h"
+
+#include "hal/fifo/pbdma_gm20b.h"
+#include "hal/fifo/userd_gv11b.h"
+#include "hal/fifo/usermode_gv11b.h"
+#include "hal/mm/gmmu/gmmu_gp10b.h"
+#include "hal/mm/gmmu/gmmu_gv11b.h"
+#include "hal/mm/mm_gp10b.h"
+
+#include <nvgpu/hw/gv11b/hw_ram_gv11b.h>
+#include <nvgpu/hw/gv11b/hw_usermode_gv11b.h>
+#endif
+
+#include "nvgpu-submit.h"
+
+#ifdef SUBMIT_UNIT_SUPPORTED
+
+/* One channel per benchmark thread. */
+#define SUBMIT_MAX_CHANNELS		4U
+/* User gpfifo entries in each submit. */
+#define SUBMIT_NUM_ENTRIES		2U
+/* Priv cmdbuf words reported by the mock sync backend. */
+#define SUBMIT_WAIT_CMD_SIZE		8U
+#define SUBMIT_INCR_CMD_SIZE		10U
+
+#define SUBMIT_TEST_GPFIFO_ENTRIES	32U
+#define SUBMIT_TEST_SUBMITS		48U
+
+#define SUBMIT_BENCH_WARMUP		1000U
+#define SUBMIT_BENCH_SUBMITS		50000U
+
+struct submit_mode {
+	const char *name;
+	bool deterministic;
+	u32 flags;
+	/* The submit path creates a job and increments the sync. */
+	bool tracked;
+};
+
+static const struct submit_mode submit_modes[] = {
+#ifdef CONFIG_NVGPU_DETERMINISTIC_CHANNELS
+	{
+		.name = "det",
+		.deterministic = true,
+		.flags = NVGPU_SUBMIT_FLAGS_SKIP_BUFFER_REFCOUNTING,
+		.tracked = false,
+	},
+	{
+		.name = "det-fence",
+		.deterministic = true,
+		.flags = NVGPU_SUBMIT_FLAGS_SKIP_BUFFER_REFCOUNTING |
+			 NVGPU_SUBMIT_FLAGS_FENCE_GET,
+		.tracked = true,
+	},
+#endif
+	{
+		.name = "nondet",
+		.deterministic = false,
+		.flags = NVGPU_SUBMIT_FLAGS_SKIP_BUFFER_REFCOUNTING,
+		.tracked = false,
+	},
+	{
+		.name = "nondet-fence",
+		.deterministic = false,
+		.flags = NVGPU_SUBMIT_FLAGS_SKIP_BUFFER_REFCOUNTING |
+			 NVGPU_SUBMIT_FLAGS_FENCE_GET,
+		.tracked = true,
+	},
+	{
+		.name = "nondet-refcnt",
+		.deterministic = false,
+		.flags = 0U,
+		.tracked = true,
+	},
+};
+
+/*
+ * Mock sync backend. Fences complete when the emulated GPU sees the doorbell
+ * of the channel: the fence value is compared against the number of
+ * increments that were submitted before the last doorbell.
+ */
+struct submit_sync {
+	struct nvgpu_channel_sync base;
+	struct nvgpu_channel *c;
+	u32 max;
+	u32 done;
+};
+
+struct submit_channel {
+	struct nvgpu_channel ch;
+	struct nvgpu_mem userd;
+	struct submit_sync sync;
+	u32 doorbells;
+};
+
+static struct {
+	struct vm_gk20a *vm;
+	struct nvgpu_posix_io_callbacks *old_callbacks;
+	struct submit_channel channels[SUBMIT_MAX_CHANNELS];
+	/*
+	 * Channels 0 to batch_channels - 1 are in the batch under test.
+	 * batch_pending is the largest number of them seen at a doorbell with
+	 * gpfifo entries that the GPU was not told about yet.
+	 */
+	u32 batch_channels;
+	u32 batch_pending;
+} submit_env;
+
+static struct submit_sync *submit_sync_from_base(struct nvgpu_channel_sync *s)
+{
+	return (struct submit_sync *)
+		((uintptr_t)s - offsetof(struct submit_sync, base));
+}
+
+static struct submit_sync *submit_sync_from_fence(struct nvgpu_fence_type *f)
+{
+	return &submit_env.channels[f->priv.syncpt_id].sync;
+}
+
+static bool submit_fence_is_expired(struct nvgpu_fence_type *f)
+{
+	struct submit_sync *sp = submit_sync_from_fence(f);
+
+	return (s32)(sp->done - f->priv.syncpt_value) >= 0;
+}
+
+static int submit_fence_wait(struct nvgpu_fence_type *f, u32 timeout)
+{
+	(void)timeout;
+
+	return submit_fence_is_expired(f) ? 0 : -ETIMEDOUT;
+}
+
+static void submit_fence_release(struct nvgpu_fence_type *f)
+{
+	(void)f;
+}
+
+static const struct nvgpu_fence_ops submit_fence_ops = {
+	.wait = submit_fence_wait,
+	.is_expired = submit_fence_is_expired,
+	.release = submit_fence_release,
+};
+
+static int submit_sync_incr_user(struct nvgpu_channel_sync *s,
+		struct priv_cmd_entry **entry, struct nvgpu_fence_type *fence,
+		bool wfi, bool need_sync_fence)
+{
+	struct submit_sync *sp = submit_sync_from_base(s);
+	struct nvgpu_channel *c = sp->c;
+	struct nvgpu_os_fence os_fence;
+	int err;
+
+	(void)wfi;
+	(void)need_sync_fence;
+
+	err = nvgpu_priv_cmdbuf_alloc(c->priv_cmd_q, SUBMIT_INCR_CMD_SIZE,
+			entry);
+	if (err != 0) {
+		return err;
+	}
+	nvgpu_priv_cmdbuf_append_zeros(c->g, *entry, SUBMIT_INCR_CMD_SIZE);
+
+	sp->max++;
+
+	(void) memset(&os_fence, 0, sizeof(os_fence));
+	nvgpu_fence_init(fence, &submit_fence_ops, os_fence);
+	fence->priv.syncpt_id = c->chid;
+	fence->priv.syncpt_value = sp->max;
+
+	return 0;
+}
+
+static int submit_sync_incr(struct nvgpu_channel_sync *s,
+		struct priv_cmd_entry **entry, struct nvgpu_fence_type *fence,
+		bool need_sync_fence)
+{
+	return submit_sync_incr_user(s, entry, fence, true, need_sync_fence);
+}
+
+static void submit_sync_mark_progress(struct nvgpu_channel_sync *s,
+		bool register_irq)
+{
+	(void)s;
+	(void)register_irq;
+}
+
+static void submit_sync_set_min_eq_max(struct nvgpu_channel_sync *s)
+{
+	struct submit_sync *sp = submit_sync_from_base(s);
+
+	sp->done = sp->max;
+}
+
+static void submit_sync_destroy(struct nvgpu_channel_sync *s)
+{
+	(void)s;
+}
+
+static const struct nvgpu_channel_sync_ops submit_sync_ops = {
+	.incr = submit_sync_incr,
+	.incr_user = submit_sync_incr_user,
+	.mark_progress = submit_sync_mark_progress,
+	.set_min_eq_max = submit_sync_set_min_eq_max,
+	.destroy = submit_sync_destroy,
+};
+
+static u32 submit_wait_cmd_size(void)
+{
+	return SUBMIT_WAIT_CMD_SIZE;
+}
+
+#ifdef CONFIG_NVGPU_SW_SEMAPHORE
+static u32 submit_incr_cmd_size(void)
+{
+	return SUBMIT_INCR_CMD_SIZE;
+}
+#else
+static u32 submit_incr_cmd_size(bool wfi_cmd)
+{
+	(void)wfi_cmd;
+
+	return SUBMIT_INCR_CMD_SIZE;
+}
+#endif
+
+static u32 submit_userd_rd32(struct gk20a *g, struct nvgpu_channel *c, u32 w)
+{
+	return nvgpu_mem_rd32(g, c->userd_mem, c->userd_offset / 4U + w);
+}
+
+/*
+ * The emulated GPU. A doorbell consumes every gpfifo entry up to GP_PUT and
+ * completes all work submitted on the channel so far.
+ */
+static void submit_usermode_writel(struct gk20a *g,
+		struct nvgpu_reg_access *access)
+{
+	struct submit_channel *sc;
+	struct nvgpu_channel *c;
+	u32 chid;
+
+	if (access->addr != usermode_notify_channel_pending_r()) {
+		return;
+	}
+
+	chid = access->value - g->fifo.channel_base;
+	if (chid >= SUBMIT_MAX_CHANNELS) {
+		return;
+	}
+
+	sc = &submit_env.channels[chid];
+	c = &sc->ch;
+
+	nvgpu_mem_wr32(g, c->userd_mem,
+		c->userd_offset / 4U + ram_userd_gp_get_w(),
+		submit_userd_rd32(g, c, ram_userd_gp_put_w()));
+	sc->sync.done = sc->sync.max;
+	sc->doorbells++;
+
+	if (chid < submit_env.batch_channels) {
+		u32 pending = 0U;
+		u32 i;
+
+		for (i = 0U; i < submit_env.batch_channels; i++) {
+			struct nvgpu_channel *bc = &submit_env.channels[i].ch;
+
+			if (submit_userd_rd32(g, bc, ram_userd_gp_put_w()) !=
+					bc->gpfifo.put) {
+				pending++;
+			}
+		}
+		submit_env.batch_pending = max(submit_env.batch_pending,
+				pending);
+	}
+}
+
+static struct nvgpu_posix_io_callbacks submit_io_callbacks = {
+	.usermode_writel = submit_usermode_writel,
+};
+
+static int submit_tlb_invalidate(struct gk20a *g, struct nvgpu_mem *pdb)
+{
+	(void)g;
+	(void)pdb;
+
+	return 0;
+}
+
+static int submit_l2_flush(struct gk20a *g, bool invalidate)
+{
+	(void)g;
+	(void)invalidate;
+
+	return 0;
+}
+
+static int submit_fb_flush(struct gk20a *g)
+{
+	(void)g;
+
+	return 0;
+}
+
+static void submit_init_inst_block(struct nvgpu_mem *inst_block,
+		struct vm_gk20a *vm, u32 big_page_size)
+{
+	(void)inst_block;
+	(void)vm;
+	(void)big_page_size;
+}
+
+static void submit_vm_as_free_share(struct vm_gk20a *vm)
+{
+	(void)vm;
+}
+
+static void submit_env_deinit(struct gk20a *g)
+{
+	if (submit_env.vm != NULL) {
+		nvgpu_vm_put(submit_env.vm);
+		submit_env.vm = NULL;
+	}
+	nvgpu_pd_cache_fini(g);
+
+	nvgpu_kfree(g, g->fifo.sema_wakeup_chids);
+	g->fifo.sema_wakeup_chids = NULL;
+
+	(void) nvgpu_posix_register_io(g, submit_env.old_callbacks);
+	submit_env.old_callbacks = NULL;
+}
+
+static int submit_env_init(struct unit_module *m, struct gk20a *g)
+{
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+	u64 low_hole = SZ_1M * 64;
+	u64 kernel_reserved = 4 * SZ_1G - low_hole;
+	u64 aperture_size = 128 * SZ_1G;
+	u64 user_vma = aperture_size - low_hole - kernel_reserved;
+
+	(void) memset(&submit_env, 0, sizeof(submit_env));
+
+	p->mm_is_iommuable = true;
+	nvgpu_set_enabled(g, NVGPU_MM_UNIFIED_MEMORY, true);
+	/* Post fences on deterministic channels need syncpoints. */
+	nvgpu_set_enabled(g, NVGPU_HAS_SYNCPOINTS, true);
+
+	g->ops.fb.tlb_invalidate = submit_tlb_invalidate;
+	g->ops.mm.cache.l2_flush = submit_l2_flush;
+	g->ops.mm.cache.fb_flush = submit_fb_flush;
+	g->ops.mm.gmmu.get_default_big_page_size =
+					nvgpu_gmmu_default_big_page_size;
+	g->ops.mm.gmmu.get_mmu_levels = gp10b_mm_get_mmu_levels;
+	g->ops.mm.gmmu.get_max_page_table_levels =
+					gp10b_get_max_page_table_levels;
+	g->ops.mm.gmmu.map = nvgpu_gmmu_map_locked;
+	g->ops.mm.gmmu.unmap = nvgpu_gmmu_unmap_locked;
+	g->ops.mm.gmmu.get_iommu_bit = gp10b_mm_get_iommu_bit;
+	g->ops.mm.gmmu.gpu_phys_addr = gv11b_gpu_phys_addr;
+	g->ops.mm.get_default_va_sizes = gp10b_mm_get_default_va_sizes;
+	g->ops.mm.init_inst_block = submit_init_inst_block;
+	g->ops.mm.vm_as_free_share = submit_vm_as_free_share;
+
+	g->ops.userd.gp_get = gv11b_userd_gp_get;
+	g->ops.userd.gp_put = gv11b_userd_gp_put;
+	g->ops.userd.pb_get = gv11b_userd_pb_get;
+	g->ops.usermode.ring_doorbell = gv11b_usermode_ring_doorbell;
+	g->ops.pbdma.format_gpfifo_entry = gm20b_pbdma_format_gpfifo_entry;
+	/* No LTC state to sync before submits. */
+	g->ops.ltc.set_enabled = NULL;
+#ifdef CONFIG_NVGPU_SW_SEMAPHORE
+	g->ops.sync.sema.get_wait_cmd_size = submit_wait_cmd_size;
+	g->ops.sync.sema.get_incr_cmd_size = submit_incr_cmd_size;
+#else
+	g->ops.sync.syncpt.get_wait_cmd_size = submit_wait_cmd_size;
+	g->ops.sync.syncpt.get_incr_cmd_size = submit_incr_cmd_size;
+#endif
+
+	submit_env.old_callbacks = nvgpu_posix_register_io(g,
+			&submit_io_callbacks);
+
+	/* Job cleanup is skipped when the GPU is off. */
+	nvgpu_set_power_state(g, NVGPU_STATE_POWERED_ON);
+
+	g->fifo.sema_wakeup_chids = nvgpu_kzalloc(g,
+		BITS_TO_LONGS(SUBMIT_MAX_CHANNELS) * sizeof(unsigned long));
+	if (g->fifo.sema_wakeup_chids == NULL) {
+		unit_err(m, "no mem for semaphore wakeup bitmap\n");
+		goto fail;
+	}
+	nvgpu_spinlock_init(&g->fifo.sema_wakeup_lock);
+#ifdef CONFIG_NVGPU_DETERMINISTIC_CHANNELS
+	nvgpu_rwsem_init(&g->deterministic_busy);
+#endif
+
+	if (nvgpu_pd_cache_init(g) != 0) {
+		unit_err(m, "PD cache init failed\n");
+		goto fail;
+	}
+
+	submit_env.vm = nvgpu_vm_init(g,
+			g->ops.mm.gmmu.get_default_big_page_size(),
+			low_hole,
+			user_vma,
+			kernel_reserved,
+			nvgpu_gmmu_va_small_page_limit(),
+			true,
+			false,
+			true,
+			"submit");
+	if (submit_env.vm == NULL) {
+		unit_err(m, "VM init failed\n");
+		goto fail;
+	}
+
+	return UNIT_SUCCESS;
+
+fail:
+	submit_env_deinit(g);
+	return UNIT_FAIL;
+}
+
+static void submit_channel_deinit(struct gk20a *g, struct submit_channel *sc)
+{
+	struct nvgpu_channel *c = &sc->ch;
+
+	if (c->priv_cmd_q != NULL) {
+		/* Like channel close: all work is done, retire the jobs. */
+		submit_sync_set_min_eq_max(&sc->sync.base);
+#ifdef CONFIG_NVGPU_DETERMINISTIC_CHANNELS
+		if (c->deterministic) {
+			while (nvgpu_channel_joblist_peek(c) != NULL) {
+				nvgpu_channel_clean_up_deterministic_job(c);
+			}
+		} else
+#endif
+		{
+			nvgpu_channel_clean_up_jobs(c);
+		}
+		nvgpu_priv_cmdbuf_queue_free(c->priv_cmd_q);
+		c->priv_cmd_q = NULL;
+	}
+	nvgpu_channel_joblist_deinit(c);
+
+	if (c->wdt != NULL) {
+		nvgpu_channel_wdt_destroy(c->wdt);
+		c->wdt = NULL;
+	}
+
+	if (nvgpu_mem_is_valid(&sc->userd)) {
+		nvgpu_dma_free(g, &sc->userd);
+	}
+	if (nvgpu_mem_is_valid(&c->gpfifo.mem)) {
+		nvgpu_dma_unmap_free(submit_env.vm, &c->gpfifo.mem);
+	}
+
+	nvgpu_mutex_destroy(&c->joblist.pre_alloc.read_lock);
+	nvgpu_mutex_destroy(&c->sync_lock);
+}
+
+/*
+ * Set up the parts of a channel that kernel mode submit uses, sized like
+ * nvgpu_channel_setup_bind() does for a gpfifo of num_entries.
+ */
+static int submit_channel_init(struct unit_module *m, struct gk20a *g,
+		u32 chid, u32 num_entries, const struct submit_mode *mode)
+{
+	struct submit_channel *sc = &submit_env.channels[chid];
+	struct nvgpu_channel *c = &sc->ch;
+	u32 job_count = (num_entries + 2U) / 3U;
+	int err;
+
+	(void) memset(sc, 0, sizeof(*sc));
+
+	c->g = g;
+	c->chid = chid;
+	c->vm = submit_env.vm;
+	nvgpu_spinlock_init(&c->unserviceable_lock);
+	nvgpu_mutex_init(&c->sync_lock);
+	nvgpu_mutex_init(&c->joblist.pre_alloc.read_lock);
+#ifdef CONFIG_NVGPU_DETERMINISTIC_CHANNELS
+	c->deterministic = mode->deterministic;
+#else
+	(void)mode;
+#endif
+
+	err = nvgpu_dma_alloc_map_sys(c->vm,
+			num_entries * sizeof(struct nvgpu_gpfifo_entry),
+			&c->gpfifo.mem);
+	if (err != 0) {
+		unit_err(m, "gpfifo alloc failed: %d\n", err);
+		goto fail;
+	}
+	c->gpfifo.entry_num = num_entries;
+
+	err = nvgpu_dma_alloc_sys(g, SZ_4K, &sc->userd);
+	if (err != 0) {
+		unit_err(m, "userd alloc failed: %d\n", err);
+		goto fail;
+	}
+	c->userd_mem = &sc->userd;
+	c->userd_offset = 0U;
+
+#ifdef CONFIG_NVGPU_CHANNEL_WDT
+	c->wdt = nvgpu_channel_wdt_alloc(g);
+	if (c->wdt == NULL) {
+		unit_err(m, "wdt alloc failed\n");
+		goto fail;
+	}
+	/* An enabled watchdog is refused by deterministic submits. */
+	nvgpu_channel_wdt_disable(c->wdt);
+#endif
+
+	err = nvgpu_channel_joblist_init(c, job_count);
+	if (err != 0) {
+		unit_err(m, "joblist init failed: %d\n", err);
+		goto fail;
+	}
+
+	err = nvgpu_priv_cmdbuf_queue_alloc(c->vm, job_count, &c->priv_cmd_q);
+	if (err != 0) {
+		unit_err(m, "priv cmdbuf queue alloc failed: %d\n", err);
+		goto fail;
+	}
+
+	sc->sync.c = c;
+	sc->sync.base.ops = &submit_sync_ops;
+	nvgpu_atomic_set(&sc->sync.base.refcount, 1);
+	c->sync = &sc->sync.base;
+
+	return UNIT_SUCCESS;
+
+fail:
+	submit_channel_deinit(g, sc);
+	return UNIT_FAIL;
+}
+
+static int submit_once(struct submit_channel *sc,
+		const struct submit_mode *mode,
+		struct nvgpu_gpfifo_entry *entries,
+		struct nvgpu_fence_type **fence_out)
+{
+	struct nvgpu_channel *c = &sc->ch;
+	bool fence_get = (mode->flags & NVGPU_SUBMIT_FLAGS_FENCE_GET) != 0U;
+	int err;
+
+	*fence_out = NULL;
+
+	err = nvgpu_submit_channel_gpfifo_kernel(c, entries,
+			SUBMIT_NUM_ENTRIES, mode->flags, NULL,
+			fence_get ? fence_out : NULL);
+	if (err == -EAGAIN && !mode->deterministic) {
+		/*
+		 * Out of job slots. Retire the completed jobs like the channel
+		 * worker does after a completion interrupt, and try again.
+		 */
+		nvgpu_channel_clean_up_jobs(c);
+		err = nvgpu_submit_channel_gpfifo_kernel(c, entries,
+				SUBMIT_NUM_ENTRIES, mode->flags, NULL,
+				fence_get ? fence_out : NULL);
+	}
+
+	return err;
+}
+
+/*
+ * Check that submit n wrote entries to the gpfifo of sc from put on,
+ * published them in GP_PUT and rang the doorbell once.
+ */
+static int submit_check_kick(struct unit_module *m, struct gk20a *g,
+		const struct submit_mode *mode, u32 n, struct submit_channel *sc,
+		u32 put, u32 doorbells, const struct nvgpu_gpfifo_entry *entries)
+{
+	struct nvgpu_channel *c = &sc->ch;
+	struct nvgpu_gpfifo_entry written;
+	u32 j;
+
+	for (j = 0U; j < SUBMIT_NUM_ENTRIES; j++) {
+		u32 idx = (put + j) & (c->gpfifo.entry_num - 1U);
+
+		nvgpu_mem_rd_n(g, &c->gpfifo.mem, idx * (u32)sizeof(written),
+			&written, (u32)sizeof(written));
+		if (written.entry0 != entries[j].entry0 ||
+				written.entry1 != entries[j].entry1) {
+			unit_err(m, "%s: submit %u entry %u not in gpfifo of "
+				"channel %u\n", mode->name, n, j, c->chid);
+			return UNIT_FAIL;
+		}
+	}
+
+	if (submit_userd_rd32(g, c, ram_userd_gp_put_w()) != c->gpfifo.put) {
+		unit_err(m, "%s: submit %u did not update GP_PUT of channel "
+			"%u\n", mode->name, n, c->chid);
+		return UNIT_FAIL;
+	}
+
+	if (sc->doorbells != doorbells + 1U) {
+		unit_err(m, "%s: submit %u rang %u doorbells of channel %u\n",
+			mode->name, n, sc->doorbells - doorbells, c->chid);
+		return UNIT_FAIL;
+	}
+
+	return UNIT_SUCCESS;
+}
+
+static int submit_check_mode(struct unit_module *m, struct gk20a *g,
+		const struct submit_mode *mode, unsigned long *locks)
+{
+	struct submit_channel *sc = &submit_env.channels[0];
+	struct nvgpu_channel *c = &sc->ch;
+	struct nvgpu_posix_call_stats *stats = nvgpu_posix_get_call_stats();
+	struct nvgpu_posix_call_stats begin;
+	struct nvgpu_gpfifo_entry entries[SUBMIT_NUM_ENTRIES];
+	struct nvgpu_fence_type *fence;
+	unsigned long allocs = 0UL;
+	bool fence_get = (mode->flags & NVGPU_SUBMIT_FLAGS_FENCE_GET) != 0U;
+	u32 put, doorbells;
+	u32 i, j;
+	int ret = UNIT_FAIL;
+	int err;
+
+	if (submit_channel_init(m, g, 0U, SUBMIT_TEST_GPFIFO_ENTRIES,
+			mode) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	for (i = 0U; i < SUBMIT_TEST_SUBMITS; i++) {
+		for (j = 0U; j < SUBMIT_NUM_ENTRIES; j++) {
+			entries[j].entry0 = i;
+			entries[j].entry1 = j;
+		}
+		put = c->gpfifo.put;
+		doorbells = sc->doorbells;
+
+		begin = *stats;
+		err = submit_once(sc, mode, entries, &fence);
+		allocs += stats->kmem_allocs - begin.kmem_allocs;
+		*locks += stats->lock_acquires - begin.lock_acquires;
+		if (err != 0) {
+			unit_err(m, "%s: submit %u failed: %d\n",
+				mode->name, i, err);
+			goto done;
+		}
+
+		if (submit_check_kick(m, g, mode, i, sc, put, doorbells,
+				entries) != UNIT_SUCCESS) {
+			if (fence != NULL) {
+				nvgpu_fence_put(fence);
+			}
+			goto done;
+		}
+
+		if (fence_get) {
+			if (fence == NULL) {
+				unit_err(m, "%s: submit %u without post fence\n",
+					mode->name, i);
+				goto done;
+			}
+			if (!nvgpu_fence_is_expired(fence)) {
+				unit_err(m, "%s: submit %u fence not expired\n",
+					mode->name, i);
+				nvgpu_fence_put(fence);
+				goto done;
+			}
+			nvgpu_fence_put(fence);
+		}
+	}
+
+	if (sc->sync.max != (mode->tracked ? SUBMIT_TEST_SUBMITS : 0U)) {
+		unit_err(m, "%s: %u sync increments for %u submits\n",
+			mode->name, sc->sync.max, SUBMIT_TEST_SUBMITS);
+		goto done;
+	}
+
+	/* Jobs, fences and priv cmdbufs come from the channel's pools. */
+	if (mode->deterministic && allocs != 0U) {
+		unit_err(m, "%s: %lu allocations in %u submits\n",
+			mode->name, allocs, SUBMIT_TEST_SUBMITS);
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	submit_channel_deinit(g, sc);
+	return ret;
+}
+
+static int submit_check_errors(struct unit_module *m, struct gk20a *g)
+{
+	/* Any non-deterministic mode will do. */
+	const struct submit_mode *mode =
+		&submit_modes[ARRAY_SIZE(submit_modes) - 1U];
+	struct submit_channel *sc = &submit_env.channels[0];
+	struct nvgpu_channel *c = &sc->ch;
+	struct nvgpu_gpfifo_entry entries[SUBMIT_NUM_ENTRIES];
+	struct nvgpu_fence_type *fence;
+	int ret = UNIT_FAIL;
+	int err;
+
+	(void) memset(entries, 0, sizeof(entries));
+
+	if (submit_channel_init(m, g, 0U, SUBMIT_TEST_GPFIFO_ENTRIES,
+			mode) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	nvgpu_set_enabled(g, NVGPU_DRIVER_IS_DYING, true);
+	err = submit_once(sc, mode, entries, &fence);
+	nvgpu_set_enabled(g, NVGPU_DRIVER_IS_DYING, false);
+	if (err != -ENODEV) {
+		unit_err(m, "submit while dying returned %d\n", err);
+		goto done;
+	}
+
+	/* The gpfifo is checked before any entry is read. */
+	err = nvgpu_submit_channel_gpfifo_kernel(c, entries,
+			SUBMIT_TEST_GPFIFO_ENTRIES, mode->flags, NULL, NULL);
+	if (err != -ENOMEM) {
+		unit_err(m, "oversized submit returned %d\n", err);
+		goto done;
+	}
+
+	c->vm = NULL;
+	err = submit_once(sc, mode, entries, &fence);
+	c->vm = submit_env.vm;
+	if (err != -EINVAL) {
+		unit_err(m, "submit without address space returned %d\n", err);
+		goto done;
+	}
+
+#ifdef CONFIG_NVGPU_DETERMINISTIC_CHANNELS
+	c->deterministic = true;
+	err = nvgpu_submit_channel_gpfifo_kernel(c, entries,
+			SUBMIT_NUM_ENTRIES, 0U, NULL, NULL);
+	c->deterministic = false;
+	if (err != -EINVAL) {
+		unit_err(m, "deterministic submit with buffer refcounting "
+			"returned %d\n", err);
+		goto done;
+	}
+#endif
+
+	if (sc->doorbells != 0U) {
+		unit_err(m, "failed submits rang the doorbell\n");
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	submit_channel_deinit(g, sc);
+	return ret;
+}
+
+int test_submit_kernel(struct unit_module *m, struct gk20a *g, void *args)
+{
+	unsigned long det_locks = 0UL;
+	int ret = UNIT_FAIL;
+	u32 i;
+
+	(void)args;
+
+	if (submit_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	for (i = 0U; i < ARRAY_SIZE(submit_modes); i++) {
+		const struct submit_mode *mode = &submit_modes[i];
+		unsigned long locks = 0UL;
+
+		if (submit_check_mode(m, g, mode, &locks) != UNIT_SUCCESS) {
+			goto done;
+		}
+
+		if (!mode->deterministic) {
+			continue;
+		}
+
+		/*
+		 * Job tracking on a deterministic channel must not add locking
+		 * to the submit; the untracked mode is listed first.
+		 */
+		if (!mode->tracked) {
+			det_locks = locks;
+		} else if (locks != det_locks) {
+			unit_err(m, "%s: %lu lock acquisitions in %u submits, "
+				"%lu without job tracking\n", mode->name,
+				locks, SUBMIT_TEST_SUBMITS, det_locks);
+			goto done;
+		}
+	}
+
+	if (submit_check_errors(m, g) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	submit_env_deinit(g);
+	return ret;
+}
+
+static void submit_batch_fill(struct nvgpu_submit_batch_entry *batch,
+		u32 count, const struct submit_mode *mode,
+		struct nvgpu_gpfifo_entry (*entries)[SUBMIT_NUM_ENTRIES])
+{
+	u32 i;
+
+	for (i = 0U; i < count; i++) {
+		(void) memset(&batch[i], 0, sizeof(batch[i]));
+		batch[i].ch = &submit_env.channels[i].ch;
+		batch[i].gpfifo = entries[i];
+		batch[i].num_entries = SUBMIT_NUM_ENTRIES;
+		batch[i].flags = mode->flags;
+		batch[i].wait_index = NVGPU_SUBMIT_BATCH_NO_WAIT;
+	}
+}
+
+static void submit_batch_put_fences(struct nvgpu_submit_batch_entry *batch,
+		u32 count)
+{
+	u32 i;
+
+	for (i = 0U; i < count; i++) {
+		if (batch[i].fence_out != NULL) {
+			nvgpu_fence_put(batch[i].fence_out);
+			batch[i].fence_out = NULL;
+		}
+	}
+}
+
+/* Like submit_once(), for all channels of a batch. */
+static int submit_batch_once(struct gk20a *g, const struct submit_mode *mode,
+		struct nvgpu_submit_batch_entry *batch, u32 count)
+{
+	u32 submitted, i;
+	int err;
+
+	err = nvgpu_submit_channels_gpfifo(g, batch, count, &submitted, NULL);
+	submit_batch_put_fences(batch, submitted);
+	if (err == -EAGAIN && !mode->deterministic) {
+		batch += submitted;
+		count -= submitted;
+		for (i = 0U; i < count; i++) {
+			nvgpu_channel_clean_up_jobs(batch[i].ch);
+		}
+		err = nvgpu_submit_channels_gpfifo(g, batch, count,
+				&submitted, NULL);
+		submit_batch_put_fences(batch, submitted);
+	}
+
+	return err;
+}
+
+static int submit_batch_check_rounds(struct unit_module *m, struct gk20a *g,
+		const struct submit_mode *mode)
+{
+	struct nvgpu_submit_batch_entry batch[SUBMIT_MAX_CHANNELS];
+	struct nvgpu_gpfifo_entry entries[SUBMIT_MAX_CHANNELS][SUBMIT_NUM_ENTRIES];
+	u32 put[SUBMIT_MAX_CHANNELS];
+	u32 doorbells[SUBMIT_MAX_CHANNELS];
+	bool fence_get = (mode->flags & NVGPU_SUBMIT_FLAGS_FENCE_GET) != 0U;
+	u32 submitted;
+	u32 i, j, k;
+	int ret = UNIT_FAIL;
+	int err;
+
+	for (i = 0U; i < SUBMIT_TEST_SUBMITS; i++) {
+		for (k = 0U; k < SUBMIT_MAX_CHANNELS; k++) {
+			struct submit_channel *sc = &submit_env.channels[k];
+
+			for (j = 0U; j < SUBMIT_NUM_ENTRIES; j++) {
+				entries[k][j].entry0 = i;
+				entries[k][j].entry1 = k * SUBMIT_NUM_ENTRIES + j;
+			}
+			if (!mode->deterministic) {
+				/* The channel worker keeps up with the GPU. */
+				nvgpu_channel_clean_up_jobs(&sc->ch);
+			}
+			put[k] = sc->ch.gpfifo.put;
+			doorbells[k] = sc->doorbells;
+		}
+		submit_batch_fill(batch, SUBMIT_MAX_CHANNELS, mode, entries);
+
+		submit_env.batch_pending = 0U;
+		err = nvgpu_submit_channels_gpfifo(g, batch,
+				SUBMIT_MAX_CHANNELS, &submitted, NULL);
+		if (err != 0 || submitted != SUBMIT_MAX_CHANNELS) {
+			unit_err(m, "%s: batch %u failed: %d, %u submitted\n",
+				mode->name, i, err, submitted);
+			submit_batch_put_fences(batch, submitted);
+			goto done;
+		}
+
+		/* All gpfifos are written before the first doorbell. */
+		if (submit_env.batch_pending != SUBMIT_MAX_CHANNELS - 1U) {
+			unit_err(m, "%s: batch %u rang a doorbell with %u other "
+				"channels written\n", mode->name, i,
+				submit_env.batch_pending);
+			submit_batch_put_fences(batch, submitted);
+			goto done;
+		}
+
+		for (k = 0U; k < SUBMIT_MAX_CHANNELS; k++) {
+			struct nvgpu_fence_type *fence = batch[k].fence_out;
+
+			if (submit_check_kick(m, g, mode, i,
+					&submit_env.channels[k], put[k],
+					doorbells[k], entries[k]) != UNIT_SUCCESS) {
+				submit_batch_put_fences(batch, submitted);
+				goto done;
+			}
+			if (fence_get != (fence != NULL)) {
+				unit_err(m, "%s: batch %u channel %u post fence "
+					"%p\n", mode->name, i, k, fence);
+				submit_batch_put_fences(batch, submitted);
+				goto done;
+			}
+			if (fence != NULL && !nvgpu_fence_is_expired(fence)) {
+				unit_err(m, "%s: batch %u channel %u fence not "
+					"expired\n", mode->name, i, k);
+				submit_batch_put_fences(batch, submitted);
+				goto done;
+			}
+		}
+		submit_batch_put_fences(batch, submitted);
+	}
+
+	for (k = 0U; k < SUBMIT_MAX_CHANNELS; k++) {
+		u32 max = submit_env.channels[k].sync.max;
+
+		if (max != (mode->tracked ? SUBMIT_TEST_SUBMITS : 0U)) {
+			unit_err(m, "%s: channel %u: %u sync increments for "
+				"%u batches\n", mode->name, k, max,
+				SUBMIT_TEST_SUBMITS);
+			goto done;
+		}
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	return ret;
+}
+
+/*
+ * Entry 1 waits for entry 0. The mock sync backend has no syncpoints, so the
+ * wait cannot be built and the batch stops after entry 0.
+ */
+static int submit_batch_check_wait(struct unit_module *m, struct gk20a *g,
+		const struct submit_mode *mode)
+{
+	struct nvgpu_submit_batch_entry batch[2];
+	struct nvgpu_gpfifo_entry entries[2][SUBMIT_NUM_ENTRIES];
+	struct submit_channel *sc0 = &submit_env.channels[0];
+	struct submit_channel *sc1 = &submit_env.channels[1];
+	bool fence_get = (mode->flags & NVGPU_SUBMIT_FLAGS_FENCE_GET) != 0U;
+	u32 max0 = sc0->sync.max;
+	u32 doorbells0 = sc0->doorbells;
+	u32 doorbells1 = sc1->doorbells;
+	u32 put1 = sc1->ch.gpfifo.put;
+	u32 submitted;
+	int ret = UNIT_FAIL;
+	int err;
+
+	(void) memset(entries, 0, sizeof(entries));
+	submit_batch_fill(batch, 2U, mode, entries);
+	batch[1].wait_index = 0U;
+
+	err = nvgpu_submit_channels_gpfifo(g, batch, 2U, &submitted, NULL);
+	if (err != -EINVAL || submitted != 1U) {
+		unit_err(m, "%s: in-batch wait returned %d, %u submitted\n",
+			mode->name, err, submitted);
+		goto done;
+	}
+
+	/* The waited for entry got a post fence even if not asked for. */
+	if (sc0->sync.max != max0 + 1U) {
+		unit_err(m, "%s: waited for entry without post fence\n",
+			mode->name);
+		goto done;
+	}
+	if (fence_get != (batch[0].fence_out != NULL)) {
+		unit_err(m, "%s: waited for entry returned post fence %p\n",
+			mode->name, batch[0].fence_out);
+		goto done;
+	}
+
+	if (sc0->doorbells != doorbells0 + 1U ||
+			sc1->doorbells != doorbells1 ||
+			sc1->ch.gpfifo.put != put1) {
+		unit_err(m, "%s: partial batch kicked the wrong channels\n",
+			mode->name);
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	submit_batch_put_fences(batch, submitted);
+	return ret;
+}
+
+static int submit_batch_check_mode(struct unit_module *m, struct gk20a *g,
+		const struct submit_mode *mode)
+{
+	u32 channels = 0U;
+	int ret = UNIT_FAIL;
+	u32 k;
+
+	for (k = 0U; k < SUBMIT_MAX_CHANNELS; k++) {
+		if (submit_channel_init(m, g, k, SUBMIT_TEST_GPFIFO_ENTRIES,
+				mode) != UNIT_SUCCESS) {
+			goto done;
+		}
+		channels++;
+	}
+	submit_env.batch_channels = SUBMIT_MAX_CHANNELS;
+
+	if (submit_batch_check_rounds(m, g, mode) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	if (submit_batch_check_wait(m, g, mode) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	submit_env.batch_channels = 0U;
+	for (k = 0U; k < channels; k++) {
+		submit_channel_deinit(g, &submit_env.channels[k]);
+	}
+	return ret;
+}
+
+static int submit_batch_expect(struct unit_module *m, struct gk20a *g,
+		struct nvgpu_submit_batch_entry *batch, u32 count,
+		int expected, const char *what)
+{
+	u32 submitted = 0U;
+	int err;
+
+	err = nvgpu_submit_channels_gpfifo(g, batch, count, &submitted, NULL);
+	if (err != expected || submitted != 0U) {
+		unit_err(m, "batch with %s returned %d, %u submitted\n",
+			what, err, submitted);
+		submit_batch_put_fences(batch, submitted);
+		return UNIT_FAIL;
+	}
+
+	return UNIT_SUCCESS;
+}
+
+static int submit_batch_check_errors(struct unit_module *m, struct gk20a *g)
+{
+	/* Any non-deterministic mode will do. */
+	const struct submit_mode *mode =
+		&submit_modes[ARRAY_SIZE(submit_modes) - 1U];
+	struct nvgpu_submit_batch_entry
+		batch[NVGPU_SUBMIT_BATCH_MAX_CHANNELS + 1U];
+	struct nvgpu_gpfifo_entry entries[SUBMIT_MAX_CHANNELS][SUBMIT_NUM_ENTRIES];
+	u32 channels = 0U;
+	int ret = UNIT_FAIL;
+	u32 k;
+
+	(void) memset(batch, 0, sizeof(batch));
+	(void) memset(entries, 0, sizeof(entries));
+
+	for (k = 0U; k < SUBMIT_MAX_CHANNELS; k++) {
+		if (submit_channel_init(m, g, k, SUBMIT_TEST_GPFIFO_ENTRIES,
+				mode) != UNIT_SUCCESS) {
+			goto done;
+		}
+		channels++;
+	}
+
+	submit_batch_fill(batch, SUBMIT_MAX_CHANNELS, mode, entries);
+	if (submit_batch_expect(m, g, batch, 0U, -EINVAL,
+			"no entries") != UNIT_SUCCESS ||
+	    submit_batch_expect(m, g, batch,
+			NVGPU_SUBMIT_BATCH_MAX_CHANNELS + 1U, -EINVAL,
+			"too many entries") != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	batch[2].ch = batch[0].ch;
+	if (submit_batch_expect(m, g, batch, SUBMIT_MAX_CHANNELS, -EINVAL,
+			"a channel twice") != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	submit_batch_fill(batch, SUBMIT_MAX_CHANNELS, mode, entries);
+	batch[1].wait_index = 1U;
+	if (submit_batch_expect(m, g, batch, SUBMIT_MAX_CHANNELS, -EINVAL,
+			"an entry waiting for itself") != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	submit_batch_fill(batch, SUBMIT_MAX_CHANNELS, mode, entries);
+	batch[1].wait_index = 0U;
+	batch[1].flags |= NVGPU_SUBMIT_FLAGS_FENCE_WAIT;
+	if (submit_batch_expect(m, g, batch, SUBMIT_MAX_CHANNELS, -EINVAL,
+			"two pre-fences") != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	submit_batch_fill(batch, SUBMIT_MAX_CHANNELS, mode, entries);
+	batch[3].num_entries = SUBMIT_TEST_GPFIFO_ENTRIES;
+	if (submit_batch_expect(m, g, batch, SUBMIT_MAX_CHANNELS, -ENOMEM,
+			"an oversized entry") != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	submit_batch_fill(batch, SUBMIT_MAX_CHANNELS, mode, entries);
+	nvgpu_set_enabled(g, NVGPU_DRIVER_IS_DYING, true);
+	ret = submit_batch_expect(m, g, batch, SUBMIT_MAX_CHANNELS, -ENODEV,
+			"the driver dying");
+	nvgpu_set_enabled(g, NVGPU_DRIVER_IS_DYING, false);
+	if (ret != UNIT_SUCCESS) {
+		goto done;
+	}
+	ret = UNIT_FAIL;
+
+	for (k = 0U; k < SUBMIT_MAX_CHANNELS; k++) {
+		struct submit_channel *sc = &submit_env.channels[k];
+
+		if (sc->doorbells != 0U || sc->ch.gpfifo.put != 0U) {
+			unit_err(m, "failed batches wrote channel %u\n", k);
+			goto done;
+		}
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	for (k = 0U; k < channels; k++) {
+		submit_channel_deinit(g, &submit_env.channels[k]);
+	}
+	return ret;
+}
+
+int test_submit_batch(struct unit_module *m, struct gk20a *g, void *args)
+{
+	int ret = UNIT_FAIL;
+	u32 i;
+
+	(void)args;
+
+	if (submit_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	for (i = 0U; i < ARRAY_SIZE(submit_modes); i++) {
+		if (submit_batch_check_mode(m, g, &submit_modes[i]) !=
+				UNIT_SUCCESS) {
+			goto done;
+		}
+	}
+
+	if (submit_batch_check_errors(m, g) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	submit_env_deinit(g);
+	return ret;
+}
+
+/* Threads warm up, then start timing together. */
+struct submit_bench_start {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	u32 ready;
+	bool go;
+};
+
+struct submit_bench_thread {
+	pthread_t thread;
+	struct submit_channel *sc;
+	const struct submit_mode *mode;
+	struct submit_bench_start *start;
+	struct nvgpu_posix_fault_inj_container fi;
+	struct nvgpu_posix_call_stats stats;
+	s64 ns;
+	int err;
+};
+
+static void submit_bench_wait_start(struct submit_bench_start *start)
+{
+	(void) pthread_mutex_lock(&start->lock);
+	start->ready++;
+	(void) pthread_cond_broadcast(&start->cond);
+	while (!start->go) {
+		(void) pthread_cond_wait(&start->cond, &start->lock);
+	}
+	(void) pthread_mutex_unlock(&start->lock);
+}
+
+static void *submit_bench_thread_fn(void *arg)
+{
+	struct submit_bench_thread *t = arg;
+	struct nvgpu_posix_call_stats *stats;
+	struct nvgpu_posix_call_stats begin;
+	struct nvgpu_gpfifo_entry entries[SUBMIT_NUM_ENTRIES];
+	struct nvgpu_fence_type *fence;
+	s64 start_ns = 0;
+	u32 i;
+
+	/* Each thread counts its calls in its own container. */
+	nvgpu_posix_init_fault_injection(&t->fi);
+	stats = nvgpu_posix_get_call_stats();
+	(void) memset(&begin, 0, sizeof(begin));
+	(void) memset(entries, 0, sizeof(entries));
+
+	for (i = 0U; i < SUBMIT_BENCH_WARMUP + SUBMIT_BENCH_SUBMITS; i++) {
+		if (i == SUBMIT_BENCH_WARMUP) {
+			submit_bench_wait_start(t->start);
+			begin = *stats;
+			start_ns = nvgpu_current_time_ns();
+		}
+
+		t->err = submit_once(t->sc, t->mode, entries, &fence);
+		if (t->err != 0) {
+			break;
+		}
+		if (fence != NULL) {
+			nvgpu_fence_put(fence);
+		}
+	}
+
+	if (i < SUBMIT_BENCH_WARMUP) {
+		/* Do not hold up the other threads. */
+		submit_bench_wait_start(t->start);
+		return NULL;
+	}
+
+	t->ns = nvgpu_current_time_ns() - start_ns;
+	t->stats.kmem_allocs = stats->kmem_allocs - begin.kmem_allocs;
+	t->stats.lock_acquires = stats->lock_acquires - begin.lock_acquires;
+
+	return NULL;
+}
+
+static int submit_bench_run(struct unit_module *m, struct gk20a *g,
+		const struct submit_mode *mode, u32 num_entries,
+		u32 num_threads)
+{
+	struct submit_bench_thread threads[SUBMIT_MAX_CHANNELS];
+	struct submit_bench_start start = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+		.cond = PTHREAD_COND_INITIALIZER,
+		.ready = 0U,
+		.go = false,
+	};
+	u64 submits = (u64)num_threads * SUBMIT_BENCH_SUBMITS;
+	u64 allocs = 0ULL, locks = 0ULL;
+	s64 ns = 0, start_ns, wall_ns;
+	int ret = UNIT_SUCCESS;
+	u32 i, created = 0U;
+
+	(void) memset(threads, 0, sizeof(threads));
+
+	for (i = 0U; i < num_threads; i++) {
+		if (submit_channel_init(m, g, i, num_entries, mode) !=
+				UNIT_SUCCESS) {
+			num_threads = i;
+			ret = UNIT_FAIL;
+			goto done;
+		}
+	}
+
+	for (i = 0U; i < num_threads; i++) {
+		threads[i].sc = &submit_env.channels[i];
+		threads[i].mode = mode;
+		threads[i].start = &start;
+		if (pthread_create(&threads[i].thread, NULL,
+				submit_bench_thread_fn, &threads[i]) != 0) {
+			unit_err(m, "thread create failed\n");
+			ret = UNIT_FAIL;
+			break;
+		}
+		created++;
+	}
+
+	(void) pthread_mutex_lock(&start.lock);
+	while (start.ready < created) {
+		(void) pthread_cond_wait(&start.cond, &start.lock);
+	}
+	start.go = true;
+	(void) pthread_cond_broadcast(&start.cond);
+	(void) pthread_mutex_unlock(&start.lock);
+	start_ns = nvgpu_current_time_ns();
+
+	for (i = 0U; i < created; i++) {
+		(void) pthread_join(threads[i].thread, NULL);
+	}
+	wall_ns = nvgpu_current_time_ns() - start_ns;
+
+	if (ret != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	for (i = 0U; i < num_threads; i++) {
+		if (threads[i].err != 0) {
+			unit_err(m, "%s: submit failed: %d\n",
+				mode->name, threads[i].err);
+			ret = UNIT_FAIL;
+			goto done;
+		}
+		ns += threads[i].ns;
+		allocs += threads[i].stats.kmem_allocs;
+		locks += threads[i].stats.lock_acquires;
+	}
+
+	unit_info(m, "%-14s gpfifo %5u threads %u: %7.1f ns/submit "
+		"%7.1f ns/submit wall %5.2f allocs/submit "
+		"%5.2f locks/submit\n",
+		mode->name, num_entries, num_threads,
+		(double)ns / (double)submits,
+		(double)wall_ns / (double)submits,
+		(double)allocs / (double)submits,
+		(double)locks / (double)submits);
+
+done:
+	for (i = 0U; i < num_threads; i++) {
+		submit_channel_deinit(g, &submit_env.channels[i]);
+	}
+	return ret;
+}
+
+/*
+ * Time one submit per channel on all channels, first as single submits and
+ * then as one batch.
+ */
+static int submit_bench_batch(struct unit_module *m, struct gk20a *g,
+		const struct submit_mode *mode)
+{
+	struct nvgpu_posix_call_stats *stats = nvgpu_posix_get_call_stats();
+	struct nvgpu_posix_call_stats begin;
+	struct nvgpu_submit_batch_entry batch[SUBMIT_MAX_CHANNELS];
+	struct nvgpu_gpfifo_entry entries[SUBMIT_MAX_CHANNELS][SUBMIT_NUM_ENTRIES];
+	struct nvgpu_fence_type *fence;
+	u32 rounds = SUBMIT_BENCH_SUBMITS / SUBMIT_MAX_CHANNELS;
+	u64 submits = (u64)rounds * SUBMIT_MAX_CHANNELS;
+	u64 locks[2] = { 0ULL, 0ULL };
+	s64 ns[2] = { 0, 0 };
+	s64 start_ns = 0;
+	u32 channels = 0U;
+	u32 i, k, pass;
+	int ret = UNIT_FAIL;
+	int err = 0;
+
+	(void) memset(&begin, 0, sizeof(begin));
+	(void) memset(entries, 0, sizeof(entries));
+
+	for (k = 0U; k < SUBMIT_MAX_CHANNELS; k++) {
+		if (submit_channel_init(m, g, k, 1024U, mode) !=
+				UNIT_SUCCESS) {
+			goto done;
+		}
+		channels++;
+	}
+	submit_batch_fill(batch, SUBMIT_MAX_CHANNELS, mode, entries);
+
+	for (pass = 0U; pass < 2U; pass++) {
+		for (i = 0U; i < SUBMIT_BENCH_WARMUP + rounds; i++) {
+			if (i == SUBMIT_BENCH_WARMUP) {
+				begin = *stats;
+				start_ns = nvgpu_current_time_ns();
+			}
+
+			if (pass == 0U) {
+				for (k = 0U; k < SUBMIT_MAX_CHANNELS; k++) {
+					err = submit_once(
+						&submit_env.channels[k], mode,
+						entries[k], &fence);
+					if (err != 0) {
+						break;
+					}
+					if (fence != NULL) {
+						nvgpu_fence_put(fence);
+					}
+				}
+			} else {
+				err = submit_batch_once(g, mode, batch,
+						SUBMIT_MAX_CHANNELS);
+			}
+			if (err != 0) {
+				unit_err(m, "%s: submit failed: %d\n",
+					mode->name, err);
+				goto done;
+			}
+		}
+		ns[pass] = nvgpu_current_time_ns() - start_ns;
+		locks[pass] = stats->lock_acquires - begin.lock_acquires;
+	}
+
+	unit_info(m, "%-14s channels %u: %7.1f ns/submit single "
+		"%7.1f ns/submit batched %5.2f/%5.2f locks/submit\n",
+		mode->name, SUBMIT_MAX_CHANNELS,
+		(double)ns[0] / (double)submits,
+		(double)ns[1] / (double)submits,
+		(double)locks[0] / (double)submits,
+		(double)locks[1] / (double)submits);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	for (k = 0U; k < channels; k++) {
+		submit_channel_deinit(g, &submit_env.channels[k]);
+	}
+	return ret;
+}
+
+int test_submit_bench(struct unit_module *m, struct gk20a *g, void *args)
+{
+	static const u32 gpfifo_sizes[] = { 128U, 1024U, 8192U };
+	static const u32 thread_counts[] = { 1U, 2U, 4U };
+	int ret = UNIT_SUCCESS;
+	u32 i, j, k;
+
+	(void)args;
+
+	if (submit_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	unit_info(m, "%u submits of %u entries per thread\n",
+		SUBMIT_BENCH_SUBMITS, SUBMIT_NUM_ENTRIES);
+
+	for (i = 0U; i < ARRAY_SIZE(submit_modes); i++) {
+		for (j = 0U; j < ARRAY_SIZE(gpfifo_sizes); j++) {
+			for (k = 0U; k < ARRAY_SIZE(thread_counts); k++) {
+				if (submit_bench_run(m, g, &submit_modes[i],
+						gpfifo_sizes[j],
+						thread_counts[k]) !=
+						UNIT_SUCCESS) {
+					ret = UNIT_FAIL;
+					goto done;
+				}
+			}
+		}
+	}
+
+	for (i = 0U; i < ARRAY_SIZE(submit_modes); i++) {
+		if (submit_bench_batch(m, g, &submit_modes[i]) !=
+				UNIT_SUCCESS) {
+			ret = UNIT_FAIL;
+			goto done;
+		}
+	}
+
+done:
+	submit_env_deinit(g);
+	return ret;
+}
+
+#else /* SUBMIT_UNIT_SUPPORTED */
+
+int test_submit_kernel(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "kernel mode submit not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_submit_batch(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "kernel mode submit not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_submit_bench(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "kernel mode submit not built\n");
+	return UNIT_SUCCESS;
+}
+
+#endif /* SUBMIT_UNIT_SUPPORTED */
+
+struct unit_module_test nvgpu_submit_tests[] = {
+	UNIT_TEST(kernel_submit, test_submit_kernel, NULL, 0),
+	UNIT_TEST(kernel_submit_batch, test_submit_batch, NULL, 0),
+	UNIT_BENCH(kernel_submit_bench, test_submit_bench, NULL, 0),
+};
+
+UNIT_MODULE(nvgpu_submit, nvgpu_submit_tests, UNIT_PRIO_NVGPU_TEST);
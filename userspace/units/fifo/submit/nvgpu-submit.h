@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef UNIT_NVGPU_SUBMIT_H
+#define UNIT_NVGPU_SUBMIT_H
+
+#include <nvgpu/types.h>
+
+struct unit_module;
+struct gk20a;
+
+/** @addtogroup SWUTS-fifo-submit
+ *  @{
+ *
+ * Software Unit Test Specification for fifo/submit
+ *
+ * The tests drive the kernel mode submit path of common/fifo/submit.c on
+ * channels built by hand: a real VM, gpfifo, USERD, job list and private
+ * command buffer queue, a mock channel sync backend, and a GPU emulated in
+ * the POSIX usermode register callback. Ringing the doorbell of a channel
+ * consumes all of its gpfifo entries and completes all of its fences.
+ *
+ * Without CONFIG_NVGPU_KERNEL_MODE_SUBMIT there is nothing to test and the
+ * tests only report that.
+ */
+
+/**
+ * Test specification for: test_submit_kernel
+ *
+ * Description: Kernel mode submits write the gpfifo and ring the doorbell
+ * for each supported channel mode.
+ *
+ * Test Type: Feature, Error injection
+ *
+ * Targets: nvgpu_submit_channel_gpfifo_kernel,
+ *          nvgpu_channel_clean_up_jobs,
+ *          nvgpu_channel_clean_up_deterministic_job,
+ *          nvgpu_priv_cmdbuf_queue_alloc
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Create a VM and the emulated GPU.
+ * - For each of deterministic, deterministic with post fence,
+ *   non-deterministic, non-deterministic with post fence and
+ *   non-deterministic with buffer refcounting:
+ *   - Build a channel with a gpfifo of 32 entries.
+ *   - Submit two entries at a time until the gpfifo has wrapped three
+ *     times. When a non-deterministic submit returns -EAGAIN, clean up the
+ *     completed jobs like the channel worker would and submit again.
+ *   - Check that each submit returned 0, wrote the user entries to the
+ *     gpfifo, updated GP_PUT in USERD and rang the doorbell once.
+ *   - Check that a requested post fence is returned and expired.
+ *   - Check that the sync backend was incremented once per submit if and
+ *     only if the mode needs job tracking.
+ *   - On deterministic channels, check that the submits did no kmem
+ *     allocations, and that submits with a post fence took as many locks
+ *     as submits without job tracking.
+ *   - Clean up the remaining jobs and free the channel.
+ * - Check that a submit fails with -ENODEV when the driver is dying, with
+ *   -ENOMEM when the gpfifo is too small for the entries and with -EINVAL
+ *   when no address space is bound.
+ * - Check that a deterministic submit fails with -EINVAL when buffer
+ *   refcounting is requested.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_submit_kernel(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_submit_batch
+ *
+ * Description: Batched kernel mode submits write the gpfifos of all channels
+ * before ringing any doorbell, and check the whole batch before submitting.
+ *
+ * Test Type: Feature, Error injection
+ *
+ * Targets: nvgpu_submit_channels_gpfifo
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Create a VM and the emulated GPU.
+ * - For each channel mode of test_submit_kernel:
+ *   - Build four channels with gpfifos of 32 entries.
+ *   - Submit two entries on each channel in one batch until the gpfifos
+ *     have wrapped three times, cleaning up completed non-deterministic jobs
+ *     before each batch.
+ *   - Check that each batch returned 0 with all entries submitted, and that
+ *     at the first doorbell the gpfifos of all other channels had been
+ *     written without GP_PUT being updated.
+ *   - Check that each channel got its entries, GP_PUT and one doorbell, and
+ *     a requested post fence that has expired.
+ *   - Check that the sync backend of each channel was incremented once per
+ *     batch if and only if the mode needs job tracking.
+ *   - Submit a batch of two entries where the second waits for the first.
+ *     The mock sync backend has no syncpoints, so check that the batch
+ *     fails with -EINVAL after submitting and kicking the first entry only,
+ *     that the first entry was given a post fence, and that the post fence
+ *     is returned only when it was requested.
+ *   - Free the channels.
+ * - Check that a batch fails with -EINVAL when it is empty, is too large,
+ *   has a channel twice, has an entry waiting for itself or has an entry with
+ *   both an in-batch wait and a pre-fence; with -ENOMEM when an entry does
+ *   not fit its gpfifo and with -ENODEV when the driver is dying. Check that
+ *   none of these submitted anything or rang a doorbell.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_submit_batch(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_submit_bench
+ *
+ * Description: Benchmark of kernel mode submits, run with --bench.
+ *
+ * Test Type: Performance
+ *
+ * Targets: nvgpu_submit_channel_gpfifo_kernel,
+ *          nvgpu_submit_channels_gpfifo
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Create a VM and the emulated GPU.
+ * - For each channel mode of test_submit_kernel, for gpfifo sizes of 128,
+ *   1024 and 8192 entries and for 1, 2 and 4 threads:
+ *   - Build one channel per thread.
+ *   - In each thread, warm up the channel, then time a fixed number of
+ *     submits of two entries. Completed non-deterministic jobs are cleaned
+ *     up in the submitting thread when the job list is full, so that cost
+ *     is included.
+ *   - Count the kmem allocations and lock acquisitions of each thread with
+ *     nvgpu_posix_get_call_stats().
+ *   - Report ns per submit per thread, wall clock ns per submit over all
+ *     threads, allocations per submit and lock acquisitions per submit.
+ * - For each channel mode, build four channels of 1024 entries and time one
+ *   submit on each channel, first as four single submits and then as one
+ *   batch. Report ns and lock acquisitions per channel submit of both.
+ *
+ * Output: Returns PASS if every submit succeeded. FAIL otherwise.
+ */
+int test_submit_bench(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * @}
+ */
+
+#endif /* UNIT_NVGPU_SUBMIT_H */
@@ -447,12 +447,20 @@ static int stub_runlist_update_EINVAL(
 		struct gk20a *g, struct nvgpu_runlist *rl,
 		struct nvgpu_channel *ch, bool add, bool wait_for_finish)
 {
+	/*
+	 * The unbind updates the runlist once for the channel, or once for
+	 * each channel of the TSG if it is unserviceable. The TSG abort comes
+	 * after that.
+	 */
+	u32 abort_update = (unit_ctx.branches &
+			F_TSG_UNBIND_CHANNEL_UNSERVICEABLE) ? 3U : 2U;
+
 	stub[0].count++;
 	if (stub[0].count == 1 && (unit_ctx.branches &
 			F_TSG_UNBIND_CHANNEL_RUNLIST_UPDATE_FAIL)) {
 		return -EINVAL;
 	}
-	if (stub[0].count == 2 && (unit_ctx.branches &
+	if (stub[0].count == abort_update && (unit_ctx.branches &
 			F_TSG_UNBIND_CHANNEL_ABORT_RUNLIST_UPDATE_FAIL)) {
 		return -EINVAL;
 	}
@@ -583,6 +591,13 @@ int test_tsg_unbind_channel(struct unit_module *m,
 				goto done);
 			unit_assert(nvgpu_list_empty(&chA->ch_entry),
 				goto done);
+			/* unserviceable TSG is taken off the runlist at once */
+			if (branches &
+			    F_TSG_UNBIND_CHANNEL_ABORT_RUNLIST_UPDATE_FAIL) {
+				unit_assert(stub[0].count == ((branches &
+					F_TSG_UNBIND_CHANNEL_UNSERVICEABLE) ?
+					2U : 1U), goto done);
+			}
 			/* check that TSG has not been torn down */
 			unit_assert(!chB->unserviceable, goto done);
 			unit_assert(!nvgpu_list_empty(&chB->ch_entry),
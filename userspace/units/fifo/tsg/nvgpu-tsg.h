@@ -135,6 +135,8 @@ int test_tsg_bind_channel(struct unit_module *m,
  *   - Check that other channels in TSG are still bound.
  * - Check TSG unbind failure cases:
  *   - Attempt to unbind an unserviceable channel (by forcing unserviceable).
+ *     Check that all channels of the TSG are then taken off the runlist
+ *     in the unbind.
  *   - Failure to preempt TSG (by stubbing g->ops.fifo.preempt_tsg).
  *   - Channel with invalid HW state (by stubbing
  *     g->ops.tsg.unbind_channel_check_hw_state).
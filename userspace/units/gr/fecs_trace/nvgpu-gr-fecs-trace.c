@@ -0,0 +1,663 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <unit/io.h>
+#include <unit/unit.h>
+
+#include <nvgpu/gk20a.h>
+
+#ifdef CONFIG_NVGPU_FECS_TRACE
+#include <nvgpu/dma.h>
+#include <nvgpu/kmem.h>
+#include <nvgpu/enabled.h>
+#include <nvgpu/hal_init.h>
+#include <nvgpu/gr/global_ctx.h>
+#include <nvgpu/gr/fecs_trace.h>
+#include <nvgpu/posix/kmem.h>
+#include <nvgpu/posix/posix-fault-injection.h>
+
+#include <nvgpu/hw/gv11b/hw_ctxsw_prog_gv11b.h>
+
+#include <os/posix/os_posix.h>
+
+#include "common/gr/gr_priv.h"
+#include "common/gr/global_ctx_priv.h"
+#endif
+
+#include "nvgpu-gr-fecs-trace.h"
+
+#ifdef CONFIG_NVGPU_FECS_TRACE
+
+#define NV_PMC_BOOT_0_ARCHITECTURE_GV110	(0x00000015 << \
+					NVGPU_GPU_ARCHITECTURE_SHIFT)
+#define NV_PMC_BOOT_0_IMPLEMENTATION_B		0xB
+
+#define FECS_TEST_NUM_CONTEXTS		3U
+/* Not bound by the tests, in the bucket of fecs_test_contexts. */
+#define FECS_TEST_UNBOUND_CONTEXT	0x000010c5U
+#define FECS_TEST_CONTEXT_ID(ptr)	((ptr) | 0x80000000U)
+#define FECS_TEST_PID(i)		((pid_t)(1000 + (i)))
+#define FECS_TEST_VMID(i)		((i) + 1U)
+
+#define FECS_TEST_CHAIN_RECORDS		7
+#define FECS_TEST_FLUSH_RECORDS		100
+#define FECS_TEST_FLUSH_FIRST		(GK20A_FECS_TRACE_NUM_RECORDS - 20)
+
+/* All in one hash bucket. */
+static const u32 fecs_test_contexts[FECS_TEST_NUM_CONTEXTS] = {
+	0x00001005U, 0x00001045U, 0x00001085U,
+};
+
+static bool fecs_env_ready;
+static struct nvgpu_gr fecs_test_gr;
+static struct nvgpu_gr_global_ctx_buffer_desc *fecs_test_desc;
+static int fecs_test_read;
+static int fecs_test_write;
+
+static int fecs_test_get_read_index(struct gk20a *g)
+{
+	(void)g;
+	return fecs_test_read;
+}
+
+static int fecs_test_get_write_index(struct gk20a *g)
+{
+	(void)g;
+	return fecs_test_write;
+}
+
+static int fecs_test_set_read_index(struct gk20a *g, int index)
+{
+	(void)g;
+	fecs_test_read = index;
+	return 0;
+}
+
+static int fecs_test_fb_flush(struct gk20a *g)
+{
+	(void)g;
+	return 0;
+}
+
+/*
+ * Set up a FECS trace buffer of records written by the test and init FECS
+ * trace with polling enabled. The poll timer is not started, the tests poll
+ * themselves.
+ */
+static int fecs_env_init(struct unit_module *m, struct gk20a *g)
+{
+	struct nvgpu_mem *mem;
+
+	if (!fecs_env_ready) {
+		g->params.gpu_arch = NV_PMC_BOOT_0_ARCHITECTURE_GV110;
+		g->params.gpu_impl = NV_PMC_BOOT_0_IMPLEMENTATION_B;
+
+		if (nvgpu_init_hal(g) != 0) {
+			unit_err(m, "nvgpu_init_hal failed\n");
+			return UNIT_FAIL;
+		}
+		fecs_env_ready = true;
+	}
+
+	/* The FECS ring indexes are in mailbox registers */
+	g->ops.gr.fecs_trace.get_read_index = fecs_test_get_read_index;
+	g->ops.gr.fecs_trace.get_write_index = fecs_test_get_write_index;
+	g->ops.gr.fecs_trace.set_read_index = fecs_test_set_read_index;
+	g->ops.gr.fecs_trace.vm_dev_write = NULL;
+	g->ops.gr.fecs_trace.vm_dev_update = NULL;
+	g->ops.mm.cache.fb_flush = fecs_test_fb_flush;
+	/* Keep the read index a plain ring index, without the enable bit */
+	nvgpu_set_enabled(g, NVGPU_FECS_TRACE_FEATURE_CONTROL, false);
+	fecs_test_read = 0;
+	fecs_test_write = 0;
+
+	fecs_test_desc = nvgpu_gr_global_ctx_desc_alloc(g);
+	if (fecs_test_desc == NULL) {
+		unit_err(m, "failed to allocate global ctx desc\n");
+		return UNIT_FAIL;
+	}
+	(void) memset(&fecs_test_gr, 0, sizeof(fecs_test_gr));
+	fecs_test_gr.global_ctx_buffer = fecs_test_desc;
+	g->gr = &fecs_test_gr;
+
+	mem = &fecs_test_desc[NVGPU_GR_GLOBAL_CTX_FECS_TRACE_BUFFER].mem;
+	if (nvgpu_dma_alloc_sys(g, nvgpu_gr_fecs_trace_buffer_size(g),
+			mem) != 0) {
+		unit_err(m, "failed to allocate FECS trace buffer\n");
+		return UNIT_FAIL;
+	}
+
+	if (nvgpu_gr_fecs_trace_init(g) != 0) {
+		unit_err(m, "nvgpu_gr_fecs_trace_init failed\n");
+		return UNIT_FAIL;
+	}
+	g->fecs_trace->enable_count = 1U;
+
+	return UNIT_SUCCESS;
+}
+
+/* Give the OS layer a buffer of num_ents entries to write to. */
+static int fecs_env_set_os_buffer(struct unit_module *m, struct gk20a *g,
+		u32 num_ents)
+{
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+
+	p->fecs_trace_ents = calloc(num_ents, sizeof(*p->fecs_trace_ents));
+	if (p->fecs_trace_ents == NULL) {
+		unit_err(m, "failed to allocate OS buffer\n");
+		return UNIT_FAIL;
+	}
+	p->fecs_trace_num_ents = num_ents;
+	p->fecs_trace_write_idx = 0U;
+	p->fecs_trace_drop_count = 0U;
+	p->fecs_trace_writes = 0U;
+	p->fecs_trace_seqno = 0U;
+
+	return UNIT_SUCCESS;
+}
+
+static void fecs_env_deinit(struct gk20a *g)
+{
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+
+	if (g->fecs_trace != NULL) {
+		g->fecs_trace->enable_count = 0U;
+		nvgpu_gr_fecs_trace_deinit(g);
+	}
+
+	if (fecs_test_desc != NULL) {
+		nvgpu_dma_free(g,
+			&fecs_test_desc[NVGPU_GR_GLOBAL_CTX_FECS_TRACE_BUFFER].mem);
+		nvgpu_gr_global_ctx_desc_free(g, fecs_test_desc);
+		fecs_test_desc = NULL;
+	}
+	g->gr = NULL;
+
+	free(p->fecs_trace_ents);
+	p->fecs_trace_ents = NULL;
+	p->fecs_trace_num_ents = 0U;
+}
+
+static int fecs_test_add_contexts(struct unit_module *m, struct gk20a *g)
+{
+	u32 i;
+
+	for (i = 0U; i < FECS_TEST_NUM_CONTEXTS; i++) {
+		if (nvgpu_gr_fecs_trace_add_context(g, fecs_test_contexts[i],
+				FECS_TEST_PID(i), FECS_TEST_VMID(i)) != 0) {
+			unit_err(m, "failed to add context %x\n",
+				fecs_test_contexts[i]);
+			return UNIT_FAIL;
+		}
+	}
+
+	return UNIT_SUCCESS;
+}
+
+static bool fecs_test_find(struct gk20a *g, u32 context_ptr,
+		pid_t expected_pid, u32 expected_vmid)
+{
+	pid_t pid = -1;
+	u32 vmid = 0U;
+
+	nvgpu_gr_fecs_trace_find_pid(g, context_ptr, &pid, &vmid);
+
+	return (pid == expected_pid) && (vmid == expected_vmid);
+}
+
+static u64 fecs_test_ts(u32 tag, u32 time)
+{
+	return ((u64)ctxsw_prog_record_timestamp_timestamp_hi_tag_f(tag)
+			<< 32) | (u64)time;
+}
+
+/* Write a record of a switch, with no timestamps, at idx of the ring. */
+static struct nvgpu_fecs_trace_record *fecs_test_record(struct gk20a *g,
+		int idx, u32 context_ptr, u32 new_context_ptr)
+{
+	struct nvgpu_fecs_trace_record *r =
+		nvgpu_gr_fecs_trace_get_record(g, idx);
+
+	(void) memset(r, 0,
+		g->ops.gr.ctxsw_prog.hw_get_ts_record_size_in_bytes());
+	r->magic_hi = ctxsw_prog_record_timestamp_magic_value_hi_v_value_v();
+	r->context_ptr = context_ptr;
+	r->context_id = FECS_TEST_CONTEXT_ID(context_ptr);
+	r->new_context_ptr = new_context_ptr;
+	r->new_context_id = FECS_TEST_CONTEXT_ID(new_context_ptr);
+
+	return r;
+}
+
+static bool fecs_test_check_entry(struct unit_module *m, struct gk20a *g,
+		u32 idx, u8 tag, u32 context_ptr, pid_t pid, u8 vmid, u32 time)
+{
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+	struct nvgpu_gpu_ctxsw_trace_entry *entry = &p->fecs_trace_ents[idx];
+
+	if ((entry->tag != tag) ||
+	    (entry->context_id != FECS_TEST_CONTEXT_ID(context_ptr)) ||
+	    (entry->pid != (u64)pid) || (entry->vmid != vmid) ||
+	    (entry->seqno != (u16)idx) ||
+	    (entry->timestamp !=
+		((u64)time << GK20A_FECS_TRACE_PTIMER_SHIFT))) {
+		unit_err(m, "entry %u: tag %x context_id %x pid %lld vmid %u "
+			"seqno %u timestamp %llx\n", idx, entry->tag,
+			entry->context_id, (long long)entry->pid, entry->vmid,
+			entry->seqno, (unsigned long long)entry->timestamp);
+		return false;
+	}
+
+	return true;
+}
+
+int test_fecs_trace_context_hash(struct unit_module *m, struct gk20a *g,
+		void *args)
+{
+	struct nvgpu_posix_fault_inj *kmem_fi =
+		nvgpu_kmem_get_fault_injection();
+	u32 i;
+	int ret = UNIT_FAIL;
+	int err;
+
+	(void)args;
+
+	if (fecs_env_init(m, g) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	if (fecs_test_add_contexts(m, g) != UNIT_SUCCESS) {
+		goto done;
+	}
+	if (g->fecs_trace->num_contexts != FECS_TEST_NUM_CONTEXTS) {
+		unit_err(m, "%u contexts added\n",
+			g->fecs_trace->num_contexts);
+		goto done;
+	}
+
+	for (i = 0U; i < FECS_TEST_NUM_CONTEXTS; i++) {
+		if (!fecs_test_find(g, fecs_test_contexts[i],
+				FECS_TEST_PID(i), FECS_TEST_VMID(i))) {
+			unit_err(m, "context %x not found\n",
+				fecs_test_contexts[i]);
+			goto done;
+		}
+	}
+
+	if (!fecs_test_find(g, FECS_TEST_UNBOUND_CONTEXT, 0, 0xffffffffU)) {
+		unit_err(m, "unbound context found\n");
+		goto done;
+	}
+
+	/* Remove the middle entry of the bucket */
+	nvgpu_gr_fecs_trace_remove_context(g, fecs_test_contexts[1]);
+	if ((g->fecs_trace->num_contexts != FECS_TEST_NUM_CONTEXTS - 1U) ||
+	    !fecs_test_find(g, fecs_test_contexts[1], 0, 0xffffffffU) ||
+	    !fecs_test_find(g, fecs_test_contexts[0], FECS_TEST_PID(0U),
+			FECS_TEST_VMID(0U)) ||
+	    !fecs_test_find(g, fecs_test_contexts[2], FECS_TEST_PID(2U),
+			FECS_TEST_VMID(2U))) {
+		unit_err(m, "bucket wrong after remove\n");
+		goto done;
+	}
+
+	nvgpu_gr_fecs_trace_remove_context(g, FECS_TEST_UNBOUND_CONTEXT);
+	if (g->fecs_trace->num_contexts != FECS_TEST_NUM_CONTEXTS - 1U) {
+		unit_err(m, "removing an unbound context changed the count\n");
+		goto done;
+	}
+
+	nvgpu_posix_enable_fault_injection(kmem_fi, true, 0);
+	err = nvgpu_gr_fecs_trace_add_context(g, fecs_test_contexts[1],
+			FECS_TEST_PID(1U), FECS_TEST_VMID(1U));
+	nvgpu_posix_enable_fault_injection(kmem_fi, false, 0);
+	if ((err != -ENOMEM) ||
+	    (g->fecs_trace->num_contexts != FECS_TEST_NUM_CONTEXTS - 1U) ||
+	    !fecs_test_find(g, fecs_test_contexts[1], 0, 0xffffffffU)) {
+		unit_err(m, "add with kmem fault injection: err %d\n", err);
+		goto done;
+	}
+
+	nvgpu_gr_fecs_trace_remove_contexts(g);
+	if (g->fecs_trace->num_contexts != 0U) {
+		unit_err(m, "%u contexts left\n",
+			g->fecs_trace->num_contexts);
+		goto done;
+	}
+	for (i = 0U; i < FECS_TEST_NUM_CONTEXTS; i++) {
+		if (!fecs_test_find(g, fecs_test_contexts[i], 0,
+				0xffffffffU)) {
+			unit_err(m, "context %x found after removing all\n",
+				fecs_test_contexts[i]);
+			goto done;
+		}
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	nvgpu_posix_enable_fault_injection(kmem_fi, false, 0);
+	fecs_env_deinit(g);
+	return ret;
+}
+
+int test_fecs_trace_poll_lookup(struct unit_module *m, struct gk20a *g,
+		void *args)
+{
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+	struct nvgpu_gr_fecs_trace_stats stats;
+	struct nvgpu_fecs_trace_record *r;
+	u32 cur, new;
+	int i;
+	int ret = UNIT_FAIL;
+
+	(void)args;
+
+	if ((fecs_env_init(m, g) != UNIT_SUCCESS) ||
+	    (fecs_env_set_os_buffer(m, g,
+			2U * (FECS_TEST_CHAIN_RECORDS + 1U)) != UNIT_SUCCESS)) {
+		goto done;
+	}
+
+	if (fecs_test_add_contexts(m, g) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	/* Switch around the contexts, and last to the unbound context */
+	for (i = 0; i < FECS_TEST_CHAIN_RECORDS; i++) {
+		cur = fecs_test_contexts[(u32)i % FECS_TEST_NUM_CONTEXTS];
+		new = (i == FECS_TEST_CHAIN_RECORDS - 1) ?
+			FECS_TEST_UNBOUND_CONTEXT :
+			fecs_test_contexts[(u32)(i + 1) %
+				FECS_TEST_NUM_CONTEXTS];
+		r = fecs_test_record(g, i, cur, new);
+		r->ts[0] = fecs_test_ts(NVGPU_GPU_CTXSW_TAG_SAVE_END,
+				2U * (u32)i);
+		r->ts[1] = fecs_test_ts(NVGPU_GPU_CTXSW_TAG_CONTEXT_START,
+				(2U * (u32)i) + 1U);
+	}
+	fecs_test_write = FECS_TEST_CHAIN_RECORDS;
+
+	if (nvgpu_gr_fecs_trace_poll(g) != 0) {
+		unit_err(m, "poll failed\n");
+		goto done;
+	}
+
+	if (fecs_test_read != FECS_TEST_CHAIN_RECORDS) {
+		unit_err(m, "read index %d after poll\n", fecs_test_read);
+		goto done;
+	}
+	if ((p->fecs_trace_writes != 1U) ||
+	    (p->fecs_trace_write_idx != 2U * FECS_TEST_CHAIN_RECORDS)) {
+		unit_err(m, "%u entries in %u writes\n",
+			p->fecs_trace_write_idx, p->fecs_trace_writes);
+		goto done;
+	}
+
+	for (i = 0; i < FECS_TEST_CHAIN_RECORDS; i++) {
+		u32 c = (u32)i % FECS_TEST_NUM_CONTEXTS;
+		u32 n = (u32)(i + 1) % FECS_TEST_NUM_CONTEXTS;
+		bool last = (i == FECS_TEST_CHAIN_RECORDS - 1);
+
+		if (nvgpu_gr_fecs_trace_get_record(g, i)->magic_hi != 0U) {
+			unit_err(m, "record %d not consumed\n", i);
+			goto done;
+		}
+		if (!fecs_test_check_entry(m, g, 2U * (u32)i,
+				NVGPU_GPU_CTXSW_TAG_SAVE_END,
+				fecs_test_contexts[c], FECS_TEST_PID(c),
+				(u8)FECS_TEST_VMID(c), 2U * (u32)i)) {
+			goto done;
+		}
+		if (!fecs_test_check_entry(m, g, (2U * (u32)i) + 1U,
+				NVGPU_GPU_CTXSW_TAG_CONTEXT_START,
+				last ? FECS_TEST_UNBOUND_CONTEXT :
+					fecs_test_contexts[n],
+				last ? 0 : FECS_TEST_PID(n),
+				last ? 0xffU : (u8)FECS_TEST_VMID(n),
+				(2U * (u32)i) + 1U)) {
+			goto done;
+		}
+	}
+
+	/* Only the first record misses on its outgoing context */
+	nvgpu_gr_fecs_trace_get_stats(g, &stats);
+	if ((stats.polls != 1U) || (stats.records != FECS_TEST_CHAIN_RECORDS) ||
+	    (stats.entries != 2U * FECS_TEST_CHAIN_RECORDS) ||
+	    (stats.lookups != 2U * FECS_TEST_CHAIN_RECORDS) ||
+	    (stats.lookup_misses != FECS_TEST_CHAIN_RECORDS + 1U)) {
+		unit_err(m, "polls %llu records %llu entries %llu "
+			"lookups %llu misses %llu\n",
+			(unsigned long long)stats.polls,
+			(unsigned long long)stats.records,
+			(unsigned long long)stats.entries,
+			(unsigned long long)stats.lookups,
+			(unsigned long long)stats.lookup_misses);
+		goto done;
+	}
+
+	/* No records, no counts */
+	if ((nvgpu_gr_fecs_trace_poll(g) != 0) ||
+	    (p->fecs_trace_writes != 1U)) {
+		unit_err(m, "poll without records wrote entries\n");
+		goto done;
+	}
+	nvgpu_gr_fecs_trace_get_stats(g, &stats);
+	if ((stats.polls != 1U) ||
+	    (stats.lookups != 2U * FECS_TEST_CHAIN_RECORDS)) {
+		unit_err(m, "poll without records counted\n");
+		goto done;
+	}
+
+	/*
+	 * Bind the context the last poll ended on and switch away from it:
+	 * it is looked up again, not taken from the last poll.
+	 */
+	if (nvgpu_gr_fecs_trace_add_context(g, FECS_TEST_UNBOUND_CONTEXT,
+			FECS_TEST_PID(FECS_TEST_NUM_CONTEXTS),
+			FECS_TEST_VMID(FECS_TEST_NUM_CONTEXTS)) != 0) {
+		unit_err(m, "failed to add context\n");
+		goto done;
+	}
+	r = fecs_test_record(g, FECS_TEST_CHAIN_RECORDS,
+			FECS_TEST_UNBOUND_CONTEXT, fecs_test_contexts[0]);
+	r->ts[0] = fecs_test_ts(NVGPU_GPU_CTXSW_TAG_SAVE_END,
+			2U * FECS_TEST_CHAIN_RECORDS);
+	r->ts[1] = fecs_test_ts(NVGPU_GPU_CTXSW_TAG_CONTEXT_START,
+			(2U * FECS_TEST_CHAIN_RECORDS) + 1U);
+	fecs_test_write = FECS_TEST_CHAIN_RECORDS + 1;
+
+	if (nvgpu_gr_fecs_trace_poll(g) != 0) {
+		unit_err(m, "poll failed\n");
+		goto done;
+	}
+	if (!fecs_test_check_entry(m, g, 2U * FECS_TEST_CHAIN_RECORDS,
+			NVGPU_GPU_CTXSW_TAG_SAVE_END, FECS_TEST_UNBOUND_CONTEXT,
+			FECS_TEST_PID(FECS_TEST_NUM_CONTEXTS),
+			(u8)FECS_TEST_VMID(FECS_TEST_NUM_CONTEXTS),
+			2U * FECS_TEST_CHAIN_RECORDS)) {
+		goto done;
+	}
+	nvgpu_gr_fecs_trace_get_stats(g, &stats);
+	if ((stats.polls != 2U) ||
+	    (stats.lookups != 2U * (FECS_TEST_CHAIN_RECORDS + 1U)) ||
+	    (stats.lookup_misses != FECS_TEST_CHAIN_RECORDS + 3U)) {
+		unit_err(m, "second poll: lookups %llu misses %llu\n",
+			(unsigned long long)stats.lookups,
+			(unsigned long long)stats.lookup_misses);
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	fecs_env_deinit(g);
+	return ret;
+}
+
+int test_fecs_trace_staging_flush(struct unit_module *m, struct gk20a *g,
+		void *args)
+{
+	struct nvgpu_os_posix *p = nvgpu_os_posix_from_gk20a(g);
+	struct nvgpu_gr_fecs_trace_stats stats;
+	struct nvgpu_fecs_trace_record *r;
+	u32 num_ts, total, per_batch, batches, time, k;
+	int i, j, idx;
+	int ret = UNIT_FAIL;
+
+	(void)args;
+
+	if (fecs_env_init(m, g) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	num_ts = (u32)nvgpu_gr_fecs_trace_num_ts(g);
+	total = num_ts * FECS_TEST_FLUSH_RECORDS;
+
+	/* One record short, its entries are dropped */
+	if (fecs_env_set_os_buffer(m, g, total - num_ts) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	if (fecs_test_add_contexts(m, g) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	/* Every timestamp has a tag, wrap around the end of the ring */
+	time = 0U;
+	for (i = 0; i < FECS_TEST_FLUSH_RECORDS; i++) {
+		idx = (FECS_TEST_FLUSH_FIRST + i) &
+			(GK20A_FECS_TRACE_NUM_RECORDS - 1);
+		r = fecs_test_record(g, idx, fecs_test_contexts[0],
+				fecs_test_contexts[1]);
+		for (j = 0; j < (int)num_ts; j++) {
+			r->ts[j] = fecs_test_ts(((j & 1) == 0) ?
+					NVGPU_GPU_CTXSW_TAG_FE_ACK :
+					NVGPU_GPU_CTXSW_TAG_RESTORE_START,
+					time++);
+		}
+	}
+	fecs_test_read = FECS_TEST_FLUSH_FIRST;
+	fecs_test_write = (FECS_TEST_FLUSH_FIRST + FECS_TEST_FLUSH_RECORDS) &
+			(GK20A_FECS_TRACE_NUM_RECORDS - 1);
+
+	if (nvgpu_gr_fecs_trace_poll(g) != 0) {
+		unit_err(m, "poll failed\n");
+		goto done;
+	}
+
+	/* A batch is flushed when the next record would not fit */
+	per_batch = NVGPU_FECS_TRACE_STAGING_ENTRIES / num_ts;
+	batches = (FECS_TEST_FLUSH_RECORDS + per_batch - 1U) / per_batch;
+	if ((fecs_test_read != fecs_test_write) ||
+	    (g->fecs_trace->staging_count != 0U) ||
+	    (p->fecs_trace_writes != batches)) {
+		unit_err(m, "read %d write %d staged %u writes %u "
+			"(expected %u)\n", fecs_test_read, fecs_test_write,
+			g->fecs_trace->staging_count, p->fecs_trace_writes,
+			batches);
+		goto done;
+	}
+
+	if ((p->fecs_trace_write_idx != total - num_ts) ||
+	    (p->fecs_trace_drop_count != num_ts)) {
+		unit_err(m, "%u entries written, %u dropped\n",
+			p->fecs_trace_write_idx, p->fecs_trace_drop_count);
+		goto done;
+	}
+
+	for (k = 0U; k < total - num_ts; k++) {
+		bool save = ((k % num_ts) & 1U) == 0U;
+
+		if (!fecs_test_check_entry(m, g, k,
+				save ? NVGPU_GPU_CTXSW_TAG_FE_ACK :
+					NVGPU_GPU_CTXSW_TAG_RESTORE_START,
+				fecs_test_contexts[save ? 0U : 1U],
+				FECS_TEST_PID(save ? 0U : 1U),
+				(u8)FECS_TEST_VMID(save ? 0U : 1U), k)) {
+			goto done;
+		}
+	}
+
+	nvgpu_gr_fecs_trace_get_stats(g, &stats);
+	if ((stats.records != FECS_TEST_FLUSH_RECORDS) ||
+	    (stats.entries != total)) {
+		unit_err(m, "records %llu entries %llu\n",
+			(unsigned long long)stats.records,
+			(unsigned long long)stats.entries);
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	fecs_env_deinit(g);
+	return ret;
+}
+
+#else /* CONFIG_NVGPU_FECS_TRACE */
+
+int test_fecs_trace_context_hash(struct unit_module *m, struct gk20a *g,
+		void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "FECS trace support not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_fecs_trace_poll_lookup(struct unit_module *m, struct gk20a *g,
+		void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "FECS trace support not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_fecs_trace_staging_flush(struct unit_module *m, struct gk20a *g,
+		void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "FECS trace support not built\n");
+	return UNIT_SUCCESS;
+}
+
+#endif /* CONFIG_NVGPU_FECS_TRACE */
+
+struct unit_module_test nvgpu_gr_fecs_trace_tests[] = {
+	UNIT_TEST(fecs_trace_context_hash, test_fecs_trace_context_hash,
+		NULL, 0),
+	UNIT_TEST(fecs_trace_poll_lookup, test_fecs_trace_poll_lookup,
+		NULL, 0),
+	UNIT_TEST(fecs_trace_staging_flush, test_fecs_trace_staging_flush,
+		NULL, 0),
+};
+
+UNIT_MODULE(nvgpu_gr_fecs_trace, nvgpu_gr_fecs_trace_tests,
+	UNIT_PRIO_NVGPU_TEST);
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef UNIT_NVGPU_GR_FECS_TRACE_H
+#define UNIT_NVGPU_GR_FECS_TRACE_H
+
+#include <nvgpu/types.h>
+
+struct unit_module;
+struct gk20a;
+
+/** @addtogroup SWUTS-gr-fecs-trace
+ *  @{
+ *
+ * Software Unit Test Specification for gr/fecs_trace
+ *
+ * The tests poll FECS trace records written by the test to a FECS trace
+ * buffer, on gv11b HALs with the read and write indexes of the FECS ring
+ * kept by the test. Decoded entries go to a buffer of the POSIX OS layer.
+ *
+ * Without CONFIG_NVGPU_FECS_TRACE there is nothing to test and the tests
+ * only report that.
+ */
+
+/**
+ * Test specification for: test_fecs_trace_context_hash
+ *
+ * Description: Bound contexts are found by context_ptr in the context hash
+ * table until they are removed.
+ *
+ * Test Type: Feature, Error injection
+ *
+ * Targets: nvgpu_gr_fecs_trace_init,
+ *          nvgpu_gr_fecs_trace_add_context,
+ *          nvgpu_gr_fecs_trace_find_pid,
+ *          nvgpu_gr_fecs_trace_remove_context,
+ *          nvgpu_gr_fecs_trace_remove_contexts,
+ *          nvgpu_gr_fecs_trace_deinit
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Add contexts, three of them in the same hash bucket, and check that each
+ *   is found with its pid and vmid.
+ * - Check that a context that is not added is found with pid 0 and vmid
+ *   0xffffffff.
+ * - Remove the context in the middle of the bucket and check that it is not
+ *   found any more, and that the others of the bucket are.
+ * - Check that removing a context that is not added changes nothing.
+ * - Add a context with kmem fault injection enabled and check that it fails
+ *   with -ENOMEM and is not found.
+ * - Remove all contexts and check that none is found.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_fecs_trace_context_hash(struct unit_module *m, struct gk20a *g,
+		void *args);
+
+/**
+ * Test specification for: test_fecs_trace_poll_lookup
+ *
+ * Description: The poller gives each trace entry the pid and vmid of its
+ * context, and checks the context found by the last lookup of the poll
+ * first.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_gr_fecs_trace_poll,
+ *          nvgpu_gr_fecs_trace_ring_read,
+ *          nvgpu_gr_fecs_trace_get_stats,
+ *          nvgpu_gr_fecs_trace_write_entries
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Add three contexts and write records of a chain of switches between
+ *   them, the last one to a context that is not added. Each record has a
+ *   SAVE_END and a CONTEXT_START timestamp.
+ * - Poll and check that the read index is moved to the write index, that
+ *   the records are consumed and that two entries per record are written,
+ *   in order, with the context id, pid, vmid and timestamp of their context.
+ * - Check that each record but the first finds its context from the
+ *   previous record, and that a poll without records changes no count.
+ * - Poll another record and check that the last context is not kept from
+ *   the previous poll.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_fecs_trace_poll_lookup(struct unit_module *m, struct gk20a *g,
+		void *args);
+
+/**
+ * Test specification for: test_fecs_trace_staging_flush
+ *
+ * Description: Entries of a poll are written in batches of at most
+ * NVGPU_FECS_TRACE_STAGING_ENTRIES, without losing or reordering any.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_gr_fecs_trace_poll,
+ *          nvgpu_gr_fecs_trace_ring_read,
+ *          nvgpu_gr_fecs_trace_write_entries
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Write records with a valid tag in every timestamp, more than fit in one
+ *   batch, wrapping around the end of the FECS ring.
+ * - Poll with an OS buffer one record short of all entries.
+ * - Check that the entries are written in the number of batches that fit
+ *   whole records in NVGPU_FECS_TRACE_STAGING_ENTRIES, in record order and
+ *   with consecutive sequence numbers, and that the entries of the last
+ *   record are dropped.
+ * - Check the record and entry counts of the poll.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_fecs_trace_staging_flush(struct unit_module *m, struct gk20a *g,
+		void *args);
+
+/**
+ * @}
+ */
+
+#endif /* UNIT_NVGPU_GR_FECS_TRACE_H */
@@ -0,0 +1,1009 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <unit/io.h>
+#include <unit/unit.h>
+
+#include <nvgpu/gk20a.h>
+
+#ifdef CONFIG_NVGPU_DEBUGGER
+#include <nvgpu/kmem.h>
+#include <nvgpu/thread.h>
+#include <nvgpu/barrier.h>
+#include <nvgpu/timers.h>
+#include <nvgpu/netlist.h>
+#include <nvgpu/hal_init.h>
+#include <nvgpu/gr/gr.h>
+#include <nvgpu/gr/hwpm_map.h>
+#include <nvgpu/posix/kmem.h>
+#include <nvgpu/posix/posix-fault-injection.h>
+
+#include "common/netlist/netlist_priv.h"
+#include "common/gr/gr_config_priv.h"
+#include "common/gr/gr_priv.h"
+#include "common/fbp/fbp_priv.h"
+#endif
+
+#include "nvgpu-gr-hwpm-map.h"
+
+#ifdef CONFIG_NVGPU_DEBUGGER
+
+#define NV_PMC_BOOT_0_ARCHITECTURE_GV110	(0x00000015 << \
+					NVGPU_GPU_ARCHITECTURE_SHIFT)
+#define NV_PMC_BOOT_0_IMPLEMENTATION_B		0xB
+
+#define HWPM_TEST_NUM_FBPS		2U
+#define HWPM_TEST_LTC_PER_FBP		2U
+#define HWPM_TEST_MAX_GPCS		4U
+
+/* gv11b GPC and TPC unicast addressing */
+#define HWPM_TEST_GPC_BASE		0x00500000U
+#define HWPM_TEST_GPC_STRIDE		0x00008000U
+#define HWPM_TEST_TPC_IN_GPC_BASE	0x00004000U
+#define HWPM_TEST_TPC_IN_GPC_STRIDE	0x00000800U
+
+#define HWPM_TEST_IMAGE_SIZE		0x00100000U
+
+/* Time to wait for a background build, in ms */
+#define HWPM_TEST_BUILD_TIMEOUT_MS	10000U
+
+#define HWPM_BENCH_ROUNDS		50U
+
+/*
+ * PM lists of the functional tests. 0x1000 is in both SYS lists, and the
+ * first two PM SYS registers are below 0xFFF and so in the PCFG space.
+ */
+static struct netlist_aiv hwpm_test_pm_sys[] = {
+	{ 0x00000000U, 0U, 0U },
+	{ 0x00000004U, 0U, 0U },
+	{ 0x00001000U, 0U, 0U },
+};
+
+static struct netlist_aiv hwpm_test_perf_sys[] = {
+	{ 0x001b4000U, 0U, 0U },
+	{ 0x00001000U, 0U, 0U },
+};
+
+static struct netlist_aiv hwpm_test_fbp[] = {
+	{ 0x001a0000U, 0U, 0U },
+};
+
+static struct netlist_aiv hwpm_test_pm_ltc[] = {
+	{ 0x00140000U, 0U, 0U },
+};
+
+static struct netlist_aiv hwpm_test_pm_tpc[] = {
+	{ 0x00504600U, 0U, 0U },
+	{ 0x00504604U, 0U, 0U },
+	{ 0x00504608U, 0U, 0U },
+};
+
+static struct netlist_aiv hwpm_test_pm_gpc[] = {
+	{ 0x00500400U, 0U, 0U },
+};
+
+static const u32 hwpm_test_tpcs[] = { 3U, 2U };
+
+static bool hwpm_env_ready;
+static struct nvgpu_netlist_vars *hwpm_netlist;
+static struct nvgpu_fbp hwpm_fbp;
+
+static u32 hwpm_test_get_max_ltc_per_fbp(struct gk20a *g)
+{
+	(void)g;
+	return HWPM_TEST_LTC_PER_FBP;
+}
+
+static u32 hwpm_test_get_fbp_count(struct gk20a *g)
+{
+	(void)g;
+	return HWPM_TEST_NUM_FBPS;
+}
+
+static int hwpm_env_init(struct unit_module *m, struct gk20a *g)
+{
+	if (!hwpm_env_ready) {
+		g->params.gpu_arch = NV_PMC_BOOT_0_ARCHITECTURE_GV110;
+		g->params.gpu_impl = NV_PMC_BOOT_0_IMPLEMENTATION_B;
+
+		if (nvgpu_init_hal(g) != 0) {
+			unit_err(m, "nvgpu_init_hal failed\n");
+			return UNIT_FAIL;
+		}
+		hwpm_env_ready = true;
+	}
+
+	/* These read registers, the map only needs their values */
+	g->ops.top.get_max_ltc_per_fbp = hwpm_test_get_max_ltc_per_fbp;
+	g->ops.priv_ring.get_fbp_count = hwpm_test_get_fbp_count;
+
+	hwpm_fbp.num_fbps = HWPM_TEST_NUM_FBPS;
+	g->fbp = &hwpm_fbp;
+
+	hwpm_netlist = nvgpu_kzalloc(g, sizeof(*hwpm_netlist));
+	if (hwpm_netlist == NULL) {
+		unit_err(m, "failed to allocate netlist\n");
+		return UNIT_FAIL;
+	}
+	g->netlist_vars = hwpm_netlist;
+
+	return UNIT_SUCCESS;
+}
+
+static void hwpm_env_deinit(struct gk20a *g)
+{
+	g->netlist_vars = NULL;
+	nvgpu_kfree(g, hwpm_netlist);
+	hwpm_netlist = NULL;
+	g->fbp = NULL;
+}
+
+static void hwpm_set_list(struct netlist_aiv_list *list,
+		struct netlist_aiv *l, u32 count)
+{
+	list->l = l;
+	list->count = count;
+}
+
+static void hwpm_use_test_lists(void)
+{
+	hwpm_set_list(&hwpm_netlist->ctxsw_regs.pm_sys, hwpm_test_pm_sys,
+		ARRAY_SIZE(hwpm_test_pm_sys));
+	hwpm_set_list(&hwpm_netlist->ctxsw_regs.perf_sys, hwpm_test_perf_sys,
+		ARRAY_SIZE(hwpm_test_perf_sys));
+	hwpm_set_list(&hwpm_netlist->ctxsw_regs.fbp, hwpm_test_fbp,
+		ARRAY_SIZE(hwpm_test_fbp));
+	hwpm_set_list(&hwpm_netlist->ctxsw_regs.pm_ltc, hwpm_test_pm_ltc,
+		ARRAY_SIZE(hwpm_test_pm_ltc));
+	hwpm_set_list(&hwpm_netlist->ctxsw_regs.pm_tpc, hwpm_test_pm_tpc,
+		ARRAY_SIZE(hwpm_test_pm_tpc));
+	hwpm_set_list(&hwpm_netlist->ctxsw_regs.pm_gpc, hwpm_test_pm_gpc,
+		ARRAY_SIZE(hwpm_test_pm_gpc));
+}
+
+static void hwpm_set_config(struct nvgpu_gr_config *config,
+		u32 *tpc_count, u32 *ppc_count, const u32 *tpcs, u32 num_gpcs)
+{
+	u32 gpc;
+
+	(void)memset(config, 0, sizeof(*config));
+	config->max_gpc_count = num_gpcs;
+	config->gpc_count = num_gpcs;
+	config->gpc_tpc_count = tpc_count;
+	config->gpc_ppc_count = ppc_count;
+
+	for (gpc = 0U; gpc < num_gpcs; gpc++) {
+		tpc_count[gpc] = tpcs[gpc];
+		ppc_count[gpc] = 1U;
+	}
+}
+
+static u32 hwpm_tpc_addr(u32 reg, u32 gpc, u32 tpc)
+{
+	return HWPM_TEST_GPC_BASE + (gpc * HWPM_TEST_GPC_STRIDE) +
+		HWPM_TEST_TPC_IN_GPC_BASE + (tpc * HWPM_TEST_TPC_IN_GPC_STRIDE) +
+		(reg & (HWPM_TEST_TPC_IN_GPC_STRIDE - 1U));
+}
+
+static int hwpm_map_setup(struct unit_module *m, struct gk20a *g,
+		struct nvgpu_gr_hwpm_map **hwpm_map, u32 size,
+		struct nvgpu_gr_config *config)
+{
+	if (nvgpu_gr_hwpm_map_init(g, hwpm_map, size) != 0) {
+		unit_err(m, "map init failed\n");
+		return UNIT_FAIL;
+	}
+	if (nvgpu_gr_hwpm_map_setup(g, *hwpm_map, config, 0U) != 0) {
+		unit_err(m, "map setup failed\n");
+		return UNIT_FAIL;
+	}
+	return UNIT_SUCCESS;
+}
+
+static bool hwpm_map_wait_built(struct nvgpu_gr_hwpm_map *hwpm_map)
+{
+	u32 ms;
+
+	for (ms = 0U; ms < HWPM_TEST_BUILD_TIMEOUT_MS; ms++) {
+		if (NV_READ_ONCE(hwpm_map->init)) {
+			return true;
+		}
+		(void)usleep(1000);
+	}
+	return false;
+}
+
+int test_hwpm_map_lookup(struct unit_module *m, struct gk20a *g, void *args)
+{
+	static const struct {
+		u32 addr;
+		u32 offset;
+	} sys_regs[] = {
+		{ 0x00088000U,  0U },
+		{ 0x00088004U,  4U },
+		{ 0x00001000U,  8U },
+		{ 0x001b4000U, 12U },
+	};
+	struct nvgpu_gr_hwpm_map *hwpm_map = NULL;
+	struct nvgpu_gr_hwpm_map_stats stats;
+	struct nvgpu_gr_config config;
+	u32 tpc_count[HWPM_TEST_MAX_GPCS], ppc_count[HWPM_TEST_MAX_GPCS];
+	u64 lookups = 0U, misses = 0U;
+	u32 i, gpc, tpc, offset, base = 0U;
+	int ret = UNIT_FAIL;
+	int err;
+
+	(void)args;
+
+	if (hwpm_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	hwpm_use_test_lists();
+	hwpm_set_config(&config, tpc_count, ppc_count, hwpm_test_tpcs,
+		ARRAY_SIZE(hwpm_test_tpcs));
+
+	/* Too small for the FBP list, which starts at offset 256 */
+	if (nvgpu_gr_hwpm_map_init(g, &hwpm_map, 64U) != 0) {
+		unit_err(m, "map init failed\n");
+		goto done;
+	}
+	err = nvgpu_gr_hwmp_map_find_priv_offset(g, hwpm_map,
+			sys_regs[0].addr, &offset, &config);
+	if (err != -EINVAL) {
+		unit_err(m, "small image: lookup returned %d\n", err);
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+	hwpm_map = NULL;
+
+	if (nvgpu_gr_hwpm_map_init(g, &hwpm_map, HWPM_TEST_IMAGE_SIZE) != 0) {
+		unit_err(m, "map init failed\n");
+		goto done;
+	}
+
+	for (i = 0U; i < ARRAY_SIZE(sys_regs); i++) {
+		err = nvgpu_gr_hwmp_map_find_priv_offset(g, hwpm_map,
+				sys_regs[i].addr, &offset, &config);
+		lookups++;
+		if ((err != 0) || (offset != sys_regs[i].offset)) {
+			unit_err(m, "reg 0x%x: err %d offset %u, expected %u\n",
+				sys_regs[i].addr, err, offset,
+				sys_regs[i].offset);
+			goto done;
+		}
+	}
+
+	/* TPCs of a GPC are interleaved per register */
+	for (gpc = 0U; gpc < ARRAY_SIZE(hwpm_test_tpcs); gpc++) {
+		for (i = 0U; i < ARRAY_SIZE(hwpm_test_pm_tpc); i++) {
+			for (tpc = 0U; tpc < hwpm_test_tpcs[gpc]; tpc++) {
+				u32 addr = hwpm_tpc_addr(
+					hwpm_test_pm_tpc[i].addr, gpc, tpc);
+
+				err = nvgpu_gr_hwmp_map_find_priv_offset(g,
+					hwpm_map, addr, &offset, &config);
+				lookups++;
+				if (err != 0) {
+					unit_err(m, "TPC reg 0x%x not found\n",
+						addr);
+					goto done;
+				}
+				if ((i == 0U) && (tpc == 0U)) {
+					base = offset;
+				}
+				if (offset != base + 4U *
+					(i * hwpm_test_tpcs[gpc] + tpc)) {
+					unit_err(m, "TPC reg 0x%x at %u\n",
+						addr, offset);
+					goto done;
+				}
+			}
+		}
+	}
+
+	err = nvgpu_gr_hwmp_map_find_priv_offset(g, hwpm_map,
+			hwpm_tpc_addr(hwpm_test_pm_tpc[0].addr, 1U, 2U),
+			&offset, &config);
+	lookups++;
+	misses++;
+	if (err != -EINVAL) {
+		unit_err(m, "TPC reg of a missing TPC: err %d\n", err);
+		goto done;
+	}
+
+	for (i = 0U; i <= hwpm_map->hash_mask; i++) {
+		struct ctxsw_buf_offset_map_entry *e = &hwpm_map->map[i];
+
+		if (e->addr == U32_MAX) {
+			continue;
+		}
+		err = nvgpu_gr_hwmp_map_find_priv_offset(g, hwpm_map,
+				e->addr, &offset, &config);
+		lookups++;
+		if ((err != 0) || (offset != e->offset)) {
+			unit_err(m, "slot %u: reg 0x%x err %d offset %u\n",
+				i, e->addr, err, offset);
+			goto done;
+		}
+	}
+
+	nvgpu_gr_hwpm_map_get_stats(hwpm_map, &stats);
+	if ((stats.count == 0U) || ((stats.slots & (stats.slots - 1U)) != 0U) ||
+	    (stats.slots < 2U * stats.count) ||
+	    (stats.max_probe >= stats.slots)) {
+		unit_err(m, "bad table: %u regs %u slots max probe %u\n",
+			stats.count, stats.slots, stats.max_probe);
+		goto done;
+	}
+	if ((stats.lookups != lookups) || (stats.misses != misses)) {
+		unit_err(m, "counted %llu lookups %llu misses, expected %llu %llu\n",
+			(unsigned long long)stats.lookups,
+			(unsigned long long)stats.misses,
+			(unsigned long long)lookups,
+			(unsigned long long)misses);
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	if (hwpm_map != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+	}
+	hwpm_env_deinit(g);
+	return ret;
+}
+
+int test_hwpm_map_share(struct unit_module *m, struct gk20a *g, void *args)
+{
+	static const u32 other_tpcs[] = { 2U, 3U };
+	struct nvgpu_gr_hwpm_map *hwpm_map = NULL, *shared = NULL;
+	struct nvgpu_gr_hwpm_map *same = NULL, *other = NULL;
+	struct nvgpu_gr_hwpm_map_stats stats;
+	struct nvgpu_gr_config *config = NULL;
+	struct nvgpu_gr_config stack_config;
+	struct nvgpu_gr_syspipe *syspipe = &g->mig.gpu_instance[0].gr_syspipe;
+	u32 *tpc_count = NULL, *ppc_count = NULL;
+	u32 stack_tpc_count[HWPM_TEST_MAX_GPCS];
+	u32 stack_ppc_count[HWPM_TEST_MAX_GPCS];
+	u32 offset;
+	int ret = UNIT_FAIL;
+	int err;
+
+	(void)args;
+
+	if (hwpm_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	hwpm_use_test_lists();
+
+	config = nvgpu_kzalloc(g, sizeof(*config));
+	tpc_count = nvgpu_kzalloc(g, HWPM_TEST_MAX_GPCS * sizeof(u32));
+	ppc_count = nvgpu_kzalloc(g, HWPM_TEST_MAX_GPCS * sizeof(u32));
+	if ((config == NULL) || (tpc_count == NULL) || (ppc_count == NULL)) {
+		unit_err(m, "failed to allocate config\n");
+		goto done;
+	}
+	hwpm_set_config(config, tpc_count, ppc_count, hwpm_test_tpcs,
+		ARRAY_SIZE(hwpm_test_tpcs));
+	hwpm_set_config(&stack_config, stack_tpc_count, stack_ppc_count,
+		hwpm_test_tpcs, ARRAY_SIZE(hwpm_test_tpcs));
+
+	if (nvgpu_gr_hwpm_map_init(g, &hwpm_map, HWPM_TEST_IMAGE_SIZE) != 0) {
+		unit_err(m, "map init failed\n");
+		goto done;
+	}
+	if (hwpm_map_setup(m, g, &same, HWPM_TEST_IMAGE_SIZE,
+			&stack_config) != UNIT_SUCCESS) {
+		goto done;
+	}
+	if (nvgpu_gr_hwpm_map_is_compatible(hwpm_map, same)) {
+		unit_err(m, "map that is not set up is compatible\n");
+		goto done;
+	}
+
+	/* The map must not use the config once it is set up */
+	if (nvgpu_gr_hwpm_map_setup(g, hwpm_map, config, 0U) != 0) {
+		unit_err(m, "map setup failed\n");
+		goto done;
+	}
+	(void)memset(tpc_count, 0xff, HWPM_TEST_MAX_GPCS * sizeof(u32));
+	(void)memset(config, 0xff, sizeof(*config));
+	nvgpu_kfree(g, tpc_count);
+	nvgpu_kfree(g, ppc_count);
+	nvgpu_kfree(g, config);
+	config = NULL;
+	tpc_count = NULL;
+	ppc_count = NULL;
+
+	if (!nvgpu_gr_hwpm_map_is_compatible(hwpm_map, same)) {
+		unit_err(m, "map is not compatible with the same layout\n");
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_deinit(g, same);
+	same = NULL;
+
+	hwpm_set_config(&stack_config, stack_tpc_count, stack_ppc_count,
+		other_tpcs, ARRAY_SIZE(other_tpcs));
+	if (hwpm_map_setup(m, g, &other, HWPM_TEST_IMAGE_SIZE,
+			&stack_config) != UNIT_SUCCESS) {
+		goto done;
+	}
+	if (nvgpu_gr_hwpm_map_is_compatible(hwpm_map, other)) {
+		unit_err(m, "map is compatible with other TPC counts\n");
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_deinit(g, other);
+	other = NULL;
+
+	hwpm_set_config(&stack_config, stack_tpc_count, stack_ppc_count,
+		hwpm_test_tpcs, ARRAY_SIZE(hwpm_test_tpcs));
+	if (hwpm_map_setup(m, g, &other, HWPM_TEST_IMAGE_SIZE / 2U,
+			&stack_config) != UNIT_SUCCESS) {
+		goto done;
+	}
+	if (nvgpu_gr_hwpm_map_is_compatible(hwpm_map, other)) {
+		unit_err(m, "map is compatible with another image size\n");
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_deinit(g, other);
+	other = NULL;
+
+	/* Same counts on other physical GPCs */
+	syspipe->num_gpc = ARRAY_SIZE(hwpm_test_tpcs);
+	syspipe->gpcs[0].physical_id = 1U;
+	syspipe->gpcs[1].physical_id = 0U;
+	err = hwpm_map_setup(m, g, &other, HWPM_TEST_IMAGE_SIZE,
+			&stack_config);
+	(void)memset(syspipe, 0, sizeof(*syspipe));
+	if (err != UNIT_SUCCESS) {
+		goto done;
+	}
+	if (nvgpu_gr_hwpm_map_is_compatible(hwpm_map, other)) {
+		unit_err(m, "map is compatible with other physical GPCs\n");
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_deinit(g, other);
+	other = NULL;
+
+	hwpm_fbp.num_fbps = HWPM_TEST_NUM_FBPS - 1U;
+	err = hwpm_map_setup(m, g, &other, HWPM_TEST_IMAGE_SIZE,
+			&stack_config);
+	hwpm_fbp.num_fbps = HWPM_TEST_NUM_FBPS;
+	if (err != UNIT_SUCCESS) {
+		goto done;
+	}
+	if (nvgpu_gr_hwpm_map_is_compatible(hwpm_map, other)) {
+		unit_err(m, "map is compatible with another FBP count\n");
+		goto done;
+	}
+
+	shared = nvgpu_gr_hwpm_map_get(hwpm_map);
+	nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+	hwpm_map = NULL;
+
+	/* Built for the copied layout, of 3 and 2 TPCs */
+	nvgpu_gr_hwpm_map_build_async(g, shared);
+
+	err = nvgpu_gr_hwmp_map_find_priv_offset(g, shared, 0x001b4000U,
+			&offset, NULL);
+	if ((err != 0) || (offset != 12U)) {
+		unit_err(m, "shared map: err %d offset %u\n", err, offset);
+		goto done;
+	}
+	err = nvgpu_gr_hwmp_map_find_priv_offset(g, shared,
+			hwpm_tpc_addr(hwpm_test_pm_tpc[0].addr, 0U, 2U),
+			&offset, NULL);
+	if (err != 0) {
+		unit_err(m, "shared map: TPC 2 of GPC 0 not found\n");
+		goto done;
+	}
+	err = nvgpu_gr_hwmp_map_find_priv_offset(g, shared,
+			hwpm_tpc_addr(hwpm_test_pm_tpc[0].addr, 1U, 2U),
+			&offset, NULL);
+	if (err != -EINVAL) {
+		unit_err(m, "shared map: TPC 2 of GPC 1 found\n");
+		goto done;
+	}
+
+	nvgpu_gr_hwpm_map_get_stats(shared, &stats);
+	if ((stats.count == 0U) || (stats.build_ns == 0U) ||
+	    (stats.lookups != 3U) || (stats.misses != 1U)) {
+		unit_err(m, "stats: %u regs, %llu ns, %llu lookups\n",
+			stats.count, (unsigned long long)stats.build_ns,
+			(unsigned long long)stats.lookups);
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	nvgpu_kfree(g, tpc_count);
+	nvgpu_kfree(g, ppc_count);
+	nvgpu_kfree(g, config);
+	if (hwpm_map != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+	}
+	if (same != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, same);
+	}
+	if (other != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, other);
+	}
+	if (shared != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, shared);
+	}
+	hwpm_env_deinit(g);
+	return ret;
+}
+
+int test_hwpm_map_async(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct nvgpu_gr *saved_gr = g->gr;
+	u32 saved_num_gr_instances = g->num_gr_instances;
+	struct nvgpu_gr *gr = NULL;
+	struct nvgpu_gr_hwpm_map *hwpm_map = NULL, *not_set_up = NULL;
+	struct nvgpu_gr_hwpm_map_stats stats;
+	struct nvgpu_gr_config config;
+	u32 tpc_count[HWPM_TEST_MAX_GPCS], ppc_count[HWPM_TEST_MAX_GPCS];
+	u64 build_ns;
+	u32 offset;
+	int ret = UNIT_FAIL;
+	int err;
+
+	(void)args;
+
+	if (hwpm_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	hwpm_use_test_lists();
+	hwpm_set_config(&config, tpc_count, ppc_count, hwpm_test_tpcs,
+		ARRAY_SIZE(hwpm_test_tpcs));
+
+	/* Two GR instances share a map, a third has one not set up */
+	gr = nvgpu_kzalloc(g, 3U * sizeof(*gr));
+	if (gr == NULL) {
+		unit_err(m, "failed to allocate GR instances\n");
+		goto done;
+	}
+	if (hwpm_map_setup(m, g, &hwpm_map, HWPM_TEST_IMAGE_SIZE,
+			&config) != UNIT_SUCCESS) {
+		goto done;
+	}
+	if (nvgpu_gr_hwpm_map_init(g, &not_set_up,
+			HWPM_TEST_IMAGE_SIZE) != 0) {
+		unit_err(m, "map init failed\n");
+		goto done;
+	}
+	gr[0].hwpm_map = hwpm_map;
+	gr[1].hwpm_map = hwpm_map;
+	gr[2].hwpm_map = not_set_up;
+	g->gr = gr;
+	g->num_gr_instances = 3U;
+
+	if (nvgpu_gr_build_hwpm_maps(g) != 0) {
+		unit_err(m, "starting the builds failed\n");
+		goto done;
+	}
+	if (!hwpm_map_wait_built(hwpm_map)) {
+		unit_err(m, "map not built in the background\n");
+		goto done;
+	}
+
+	nvgpu_gr_hwpm_map_get_stats(hwpm_map, &stats);
+	if ((stats.count == 0U) || (stats.build_ns == 0U) ||
+	    (stats.lookups != 0U)) {
+		unit_err(m, "stats: %u regs, %llu ns, %llu lookups\n",
+			stats.count, (unsigned long long)stats.build_ns,
+			(unsigned long long)stats.lookups);
+		goto done;
+	}
+	build_ns = stats.build_ns;
+
+	if (not_set_up->build_started) {
+		unit_err(m, "build started for a map not set up\n");
+		goto done;
+	}
+
+	/* A built map is not built again */
+	if (nvgpu_gr_build_hwpm_maps(g) != 0) {
+		unit_err(m, "starting the builds failed\n");
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_get_stats(hwpm_map, &stats);
+	if (stats.build_ns != build_ns) {
+		unit_err(m, "map built again\n");
+		goto done;
+	}
+
+	err = nvgpu_gr_hwmp_map_find_priv_offset(g, hwpm_map, 0x001b4000U,
+			&offset, NULL);
+	if ((err != 0) || (offset != 12U)) {
+		unit_err(m, "built map: err %d offset %u\n", err, offset);
+		goto done;
+	}
+
+	/* The map that was not set up is set up and built on first use */
+	err = nvgpu_gr_hwmp_map_find_priv_offset(g, not_set_up, 0x001b4000U,
+			&offset, &config);
+	if ((err != 0) || (offset != 12U) ||
+	    !nvgpu_gr_hwpm_map_is_compatible(hwpm_map, not_set_up)) {
+		unit_err(m, "map built on use: err %d offset %u\n",
+			err, offset);
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	g->gr = saved_gr;
+	g->num_gr_instances = saved_num_gr_instances;
+	if (hwpm_map != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+	}
+	if (not_set_up != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, not_set_up);
+	}
+	nvgpu_kfree(g, gr);
+	hwpm_env_deinit(g);
+	return ret;
+}
+
+int test_hwpm_map_serial(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct nvgpu_posix_fault_inj *thread_serial_fi =
+		nvgpu_thread_serial_get_fault_injection();
+	struct nvgpu_posix_fault_inj *kmem_fi =
+		nvgpu_kmem_get_fault_injection();
+	struct nvgpu_gr_hwpm_map *hwpm_map = NULL;
+	struct nvgpu_gr_hwpm_map_stats stats;
+	struct nvgpu_gr_config config;
+	u32 tpc_count[HWPM_TEST_MAX_GPCS], ppc_count[HWPM_TEST_MAX_GPCS];
+	u32 offset;
+	int ret = UNIT_FAIL;
+	int err;
+
+	(void)args;
+
+	if (hwpm_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	hwpm_use_test_lists();
+	hwpm_set_config(&config, tpc_count, ppc_count, hwpm_test_tpcs,
+		ARRAY_SIZE(hwpm_test_tpcs));
+
+	nvgpu_posix_enable_fault_injection(thread_serial_fi, true, 0);
+
+	/* The build thread runs to completion before build_async returns */
+	if (hwpm_map_setup(m, g, &hwpm_map, HWPM_TEST_IMAGE_SIZE,
+			&config) != UNIT_SUCCESS) {
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_build_async(g, hwpm_map);
+
+	nvgpu_gr_hwpm_map_get_stats(hwpm_map, &stats);
+	if (stats.count == 0U) {
+		unit_err(m, "map not built when build_async returned\n");
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+	hwpm_map = NULL;
+
+	/* A build failed by fault injection is done again on first use */
+	if (hwpm_map_setup(m, g, &hwpm_map, HWPM_TEST_IMAGE_SIZE,
+			&config) != UNIT_SUCCESS) {
+		goto done;
+	}
+	nvgpu_posix_enable_fault_injection(kmem_fi, true, 0);
+	nvgpu_gr_hwpm_map_build_async(g, hwpm_map);
+	nvgpu_posix_enable_fault_injection(kmem_fi, false, 0);
+
+	nvgpu_gr_hwpm_map_get_stats(hwpm_map, &stats);
+	if (stats.count != 0U) {
+		unit_err(m, "map built with kmem fault injection\n");
+		goto done;
+	}
+
+	err = nvgpu_gr_hwmp_map_find_priv_offset(g, hwpm_map, 0x001b4000U,
+			&offset, &config);
+	if ((err != 0) || (offset != 12U)) {
+		unit_err(m, "lookup after failed build: err %d offset %u\n",
+			err, offset);
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	nvgpu_posix_enable_fault_injection(kmem_fi, false, 0);
+	nvgpu_posix_enable_fault_injection(thread_serial_fi, false, 0);
+	if (hwpm_map != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, hwpm_map);
+	}
+	hwpm_env_deinit(g);
+	return ret;
+}
+
+static struct netlist_aiv *hwpm_bench_list(struct netlist_aiv_list *list,
+		u32 base, u32 count)
+{
+	struct netlist_aiv *l = calloc(count, sizeof(*l));
+	u32 i;
+
+	if (l != NULL) {
+		for (i = 0U; i < count; i++) {
+			l[i].addr = base + (i * 4U);
+		}
+		hwpm_set_list(list, l, count);
+	}
+	return l;
+}
+
+static int hwpm_bench_cmp(const void *a, const void *b)
+{
+	const struct ctxsw_buf_offset_map_entry *e1 = a;
+	const struct ctxsw_buf_offset_map_entry *e2 = b;
+
+	return (e1->addr > e2->addr) - (e1->addr < e2->addr);
+}
+
+static bool hwpm_bench_bsearch(struct ctxsw_buf_offset_map_entry *sorted,
+		u32 count, u32 addr, u32 *offset)
+{
+	u32 lo = 0U, hi = count;
+
+	while (lo < hi) {
+		u32 mid = lo + ((hi - lo) / 2U);
+
+		if (sorted[mid].addr == addr) {
+			*offset = sorted[mid].offset;
+			return true;
+		}
+		if (sorted[mid].addr < addr) {
+			lo = mid + 1U;
+		} else {
+			hi = mid;
+		}
+	}
+	return false;
+}
+
+int test_hwpm_map_bench(struct unit_module *m, struct gk20a *g, void *args)
+{
+	static const u32 bench_tpcs[] = { 4U, 4U, 4U, 4U };
+	struct nvgpu_gr_hwpm_map *lazy = NULL, *async = NULL;
+	struct nvgpu_gr_hwpm_map_stats stats;
+	struct nvgpu_gr_config config;
+	struct ctxsw_buf_offset_map_entry *sorted = NULL;
+	struct netlist_aiv *lists[7] = { NULL };
+	u32 tpc_count[HWPM_TEST_MAX_GPCS], ppc_count[HWPM_TEST_MAX_GPCS];
+	u32 *addrs = NULL;
+	u32 i, j, r, count = 0U, offset;
+	s64 start_ns, lazy_first_ns, async_first_ns, hash_ns, bsearch_ns;
+	double total;
+	int ret = UNIT_FAIL;
+
+	(void)args;
+
+	if (hwpm_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	lists[0] = hwpm_bench_list(&hwpm_netlist->ctxsw_regs.pm_sys,
+			0x00180000U, 1024U);
+	lists[1] = hwpm_bench_list(&hwpm_netlist->ctxsw_regs.perf_sys,
+			0x001b4000U, 256U);
+	lists[2] = hwpm_bench_list(&hwpm_netlist->ctxsw_regs.fbp,
+			0x001a0000U, 128U);
+	lists[3] = hwpm_bench_list(&hwpm_netlist->ctxsw_regs.pm_ltc,
+			0x00140000U, 256U);
+	lists[4] = hwpm_bench_list(&hwpm_netlist->ctxsw_regs.pm_tpc,
+			0x00504000U, 256U);
+	lists[5] = hwpm_bench_list(&hwpm_netlist->ctxsw_regs.pm_gpc,
+			0x00500400U, 256U);
+	lists[6] = hwpm_bench_list(&hwpm_netlist->ctxsw_regs.perf_gpc,
+			0x00278000U, 128U);
+	for (i = 0U; i < ARRAY_SIZE(lists); i++) {
+		if (lists[i] == NULL) {
+			unit_err(m, "failed to allocate lists\n");
+			goto done;
+		}
+	}
+
+	hwpm_set_config(&config, tpc_count, ppc_count, bench_tpcs,
+		ARRAY_SIZE(bench_tpcs));
+
+	/* Built by the first lookup */
+	if (nvgpu_gr_hwpm_map_init(g, &lazy, HWPM_TEST_IMAGE_SIZE) != 0) {
+		unit_err(m, "map init failed\n");
+		goto done;
+	}
+	start_ns = nvgpu_current_time_ns();
+	if (nvgpu_gr_hwmp_map_find_priv_offset(g, lazy, 0x00180000U,
+			&offset, &config) != 0) {
+		unit_err(m, "lazy lookup failed\n");
+		goto done;
+	}
+	lazy_first_ns = nvgpu_current_time_ns() - start_ns;
+
+	/* Built in the background before the first lookup */
+	if (hwpm_map_setup(m, g, &async, HWPM_TEST_IMAGE_SIZE,
+			&config) != UNIT_SUCCESS) {
+		goto done;
+	}
+	nvgpu_gr_hwpm_map_build_async(g, async);
+	if (!hwpm_map_wait_built(async)) {
+		unit_err(m, "map not built in the background\n");
+		goto done;
+	}
+	start_ns = nvgpu_current_time_ns();
+	if (nvgpu_gr_hwmp_map_find_priv_offset(g, async, 0x00180000U,
+			&offset, &config) != 0) {
+		unit_err(m, "async lookup failed\n");
+		goto done;
+	}
+	async_first_ns = nvgpu_current_time_ns() - start_ns;
+
+	addrs = malloc((async->hash_mask + 1U) * sizeof(*addrs));
+	sorted = malloc((async->hash_mask + 1U) * sizeof(*sorted));
+	if ((addrs == NULL) || (sorted == NULL)) {
+		unit_err(m, "failed to allocate lookup arrays\n");
+		goto done;
+	}
+
+	for (i = 0U; i <= async->hash_mask; i++) {
+		if (async->map[i].addr != U32_MAX) {
+			sorted[count] = async->map[i];
+			addrs[count++] = async->map[i].addr;
+		}
+	}
+	qsort(sorted, count, sizeof(*sorted), hwpm_bench_cmp);
+
+	/* Look registers up in an order unrelated to both layouts */
+	srand(1U);
+	for (i = count - 1U; i > 0U; i--) {
+		u32 tmp;
+
+		j = (u32)rand() % (i + 1U);
+		tmp = addrs[i];
+		addrs[i] = addrs[j];
+		addrs[j] = tmp;
+	}
+
+	start_ns = nvgpu_current_time_ns();
+	for (r = 0U; r < HWPM_BENCH_ROUNDS; r++) {
+		for (i = 0U; i < count; i++) {
+			if (nvgpu_gr_hwmp_map_find_priv_offset(g, async,
+					addrs[i], &offset, &config) != 0) {
+				unit_err(m, "reg 0x%x not found\n", addrs[i]);
+				goto done;
+			}
+		}
+	}
+	hash_ns = nvgpu_current_time_ns() - start_ns;
+
+	start_ns = nvgpu_current_time_ns();
+	for (r = 0U; r < HWPM_BENCH_ROUNDS; r++) {
+		for (i = 0U; i < count; i++) {
+			if (!hwpm_bench_bsearch(sorted, count, addrs[i],
+					&offset)) {
+				unit_err(m, "reg 0x%x not found\n", addrs[i]);
+				goto done;
+			}
+		}
+	}
+	bsearch_ns = nvgpu_current_time_ns() - start_ns;
+
+	nvgpu_gr_hwpm_map_get_stats(async, &stats);
+	total = (double)count * HWPM_BENCH_ROUNDS;
+
+	unit_info(m, "%u regs in %u slots, max probe %u, built in %llu ns\n",
+		stats.count, stats.slots, stats.max_probe,
+		(unsigned long long)stats.build_ns);
+	unit_info(m, "first lookup: %lld ns built on use, %lld ns prebuilt\n",
+		(long long)lazy_first_ns, (long long)async_first_ns);
+	unit_info(m, "lookup: %.1f ns hash, %.1f ns binary search\n",
+		(double)hash_ns / total, (double)bsearch_ns / total);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	free(addrs);
+	free(sorted);
+	if (lazy != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, lazy);
+	}
+	if (async != NULL) {
+		nvgpu_gr_hwpm_map_deinit(g, async);
+	}
+	for (i = 0U; i < ARRAY_SIZE(lists); i++) {
+		free(lists[i]);
+	}
+	hwpm_env_deinit(g);
+	return ret;
+}
+
+#else /* CONFIG_NVGPU_DEBUGGER */
+
+int test_hwpm_map_lookup(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "debugger support not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_hwpm_map_share(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "debugger support not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_hwpm_map_async(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "debugger support not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_hwpm_map_serial(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "debugger support not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_hwpm_map_bench(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "debugger support not built\n");
+	return UNIT_SUCCESS;
+}
+
+#endif /* CONFIG_NVGPU_DEBUGGER */
+
+struct unit_module_test nvgpu_gr_hwpm_map_tests[] = {
+	UNIT_TEST(hwpm_map_lookup, test_hwpm_map_lookup, NULL, 0),
+	UNIT_TEST(hwpm_map_share, test_hwpm_map_share, NULL, 0),
+	UNIT_TEST(hwpm_map_async, test_hwpm_map_async, NULL, 0),
+	UNIT_TEST(hwpm_map_serial, test_hwpm_map_serial, NULL, 0),
+	UNIT_BENCH(hwpm_map_bench, test_hwpm_map_bench, NULL, 0),
+};
+
+UNIT_MODULE(nvgpu_gr_hwpm_map, nvgpu_gr_hwpm_map_tests, UNIT_PRIO_NVGPU_TEST);
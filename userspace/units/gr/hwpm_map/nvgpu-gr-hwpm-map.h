@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef UNIT_NVGPU_GR_HWPM_MAP_H
+#define UNIT_NVGPU_GR_HWPM_MAP_H
+
+#include <nvgpu/types.h>
+
+struct unit_module;
+struct gk20a;
+
+/** @addtogroup SWUTS-gr-hwpm-map
+ *  @{
+ *
+ * Software Unit Test Specification for gr/hwpm_map
+ *
+ * The tests build HWPM maps on gv11b HALs from PM register lists and GR
+ * configs made up by the test.
+ *
+ * Without CONFIG_NVGPU_DEBUGGER there is nothing to test and the tests only
+ * report that.
+ */
+
+/**
+ * Test specification for: test_hwpm_map_lookup
+ *
+ * Description: The HWPM map gives the PM context buffer offset of each
+ * register of the PM lists.
+ *
+ * Test Type: Feature, Error injection
+ *
+ * Targets: nvgpu_gr_hwpm_map_init,
+ *          nvgpu_gr_hwpm_map_deinit,
+ *          nvgpu_gr_hwmp_map_find_priv_offset,
+ *          nvgpu_gr_hwpm_map_get_stats
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Install PM SYS, PERF SYS, FBP, LTC, TPC and GPC lists, with a register
+ *   listed twice, and a config of 2 GPCs with 3 and 2 TPCs.
+ * - Check that a lookup fails with -EINVAL when the PM image is too small
+ *   for the lists.
+ * - Create a map for a PM image large enough, without starting the build.
+ * - Check the offsets of the PM SYS and PERF SYS registers, and that the
+ *   register listed twice has its first offset.
+ * - Check that each TPC register of each TPC is found, with the offsets of
+ *   the TPCs of a GPC interleaved per register, and that a TPC register of
+ *   a TPC that is not in the config is not found.
+ * - Check that each register in the hash table is found at its offset.
+ * - Check that the table has a power of 2 number of slots, at least twice
+ *   the number of registers, and that the lookup and miss counts match the
+ *   lookups done.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_hwpm_map_lookup(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_hwpm_map_share
+ *
+ * Description: HWPM maps keep a copy of the layout they are built for and
+ * are shared between GR instances of the same layout.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_gr_hwpm_map_setup,
+ *          nvgpu_gr_hwpm_map_is_compatible,
+ *          nvgpu_gr_hwpm_map_get,
+ *          nvgpu_gr_hwpm_map_deinit
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Install the lists of test_hwpm_map_lookup.
+ * - Check that a map that is not set up is not compatible with a map set up
+ *   for the config of test_hwpm_map_lookup.
+ * - Set the map up for an allocated copy of that config, overwrite and free
+ *   the copy, and check that the map is compatible with the other map.
+ * - Check that the map is not compatible with maps set up for other TPC
+ *   counts, for a PM image of another size, for the same counts on other
+ *   physical GPCs, and for another FBP count.
+ * - Take a second reference, drop the first and start the build.
+ * - Check that lookups without a config wait for the build and find the
+ *   registers of the layout the map was set up for: TPC 2 of GPC 0 and not
+ *   TPC 2 of GPC 1.
+ * - Check that the map reports its build time, register count and lookups.
+ * - Drop the second reference.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_hwpm_map_share(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_hwpm_map_async
+ *
+ * Description: The HWPM maps of the GR instances are built in the
+ * background once GR init is done.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_gr_build_hwpm_maps,
+ *          nvgpu_gr_hwpm_map_build_async,
+ *          nvgpu_gr_hwmp_map_find_priv_offset
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Install the lists of test_hwpm_map_lookup.
+ * - Set up three GR instances: two sharing a map that is set up, and one
+ *   with a map that is not.
+ * - Start the builds and check that the shared map is built in the
+ *   background, with no lookup, and that no build is started for the map
+ *   that is not set up.
+ * - Start the builds again and check that the built map is not built again.
+ * - Check that a lookup in the built map finds a register.
+ * - Check that a lookup with a config sets up and builds the other map, and
+ *   that it is then compatible with the shared map.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_hwpm_map_async(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_hwpm_map_serial
+ *
+ * Description: With thread-serial fault injection a map is built before
+ * nvgpu_gr_hwpm_map_build_async() returns, so kmem fault injection counts
+ * the allocations of the build in a fixed order.
+ *
+ * Test Type: Feature, Error injection
+ *
+ * Targets: nvgpu_gr_hwpm_map_setup,
+ *          nvgpu_gr_hwpm_map_build_async,
+ *          nvgpu_gr_hwmp_map_find_priv_offset,
+ *          nvgpu_gr_hwpm_map_get_stats
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Install the lists of test_hwpm_map_lookup and enable thread-serial fault
+ *   injection.
+ * - Start building a map and check that it is built when
+ *   nvgpu_gr_hwpm_map_build_async() returns.
+ * - Start building another map with kmem fault injection enabled and check
+ *   that it is not built.
+ * - Disable kmem fault injection and check that a lookup builds the map and
+ *   finds a register.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_hwpm_map_serial(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_hwpm_map_bench
+ *
+ * Description: Benchmark of HWPM map lookups, run with --bench.
+ *
+ * Test Type: Performance
+ *
+ * Targets: nvgpu_gr_hwpm_map_build_async,
+ *          nvgpu_gr_hwmp_map_find_priv_offset
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Install PM lists of a few hundred registers per unit and a config of
+ *   4 GPCs with 4 TPCs.
+ * - Time the first lookup of a map built on first use, and of a map whose
+ *   build was started in the background and has completed.
+ * - Time lookups of all registers of the map, and lookups of the same
+ *   registers by binary search of a sorted array of the map entries, as the
+ *   map used to be searched.
+ * - Report the build time, the first lookup times and ns per lookup.
+ *
+ * Output: Returns PASS if every lookup succeeded. FAIL otherwise.
+ */
+int test_hwpm_map_bench(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * @}
+ */
+
+#endif /* UNIT_NVGPU_GR_HWPM_MAP_H */
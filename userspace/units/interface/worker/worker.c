@@ -335,6 +335,258 @@ int test_branches(struct unit_module *m, struct gk20a *g, void *args)
 	return UNIT_SUCCESS;
 }
 
+/*
+ * Sharded worker: each item stands for one channel's job cleanup and keeps a
+ * shard thread busy for a fixed amount of time.
+ */
+#define SHARD_TEST_ITEMS	64U
+#define SHARD_TEST_ITEM_US	200U
+/* all items are done well within this even on a loaded machine */
+#define SHARD_TEST_TIMEOUT_MS	10000U
+
+struct shard_test_item {
+	struct nvgpu_list_node node;
+	nvgpu_atomic_t busy;
+	nvgpu_atomic_t processed;
+};
+
+static nvgpu_atomic_t shard_items_done;
+static nvgpu_atomic_t shard_overlaps;
+static nvgpu_atomic_t shard_ticks;
+
+static void shard_process_item(struct nvgpu_list_node *work_item)
+{
+	struct shard_test_item *item = (struct shard_test_item *)
+		((uintptr_t)work_item - offsetof(struct shard_test_item, node));
+
+	if (nvgpu_atomic_inc_return(&item->busy) != 1) {
+		nvgpu_atomic_inc(&shard_overlaps);
+	}
+	nvgpu_udelay(SHARD_TEST_ITEM_US);
+	nvgpu_atomic_inc(&item->processed);
+	nvgpu_atomic_dec(&item->busy);
+	nvgpu_atomic_inc(&shard_items_done);
+}
+
+static void shard_post_process(struct nvgpu_worker *worker)
+{
+	nvgpu_atomic_inc(&shard_ticks);
+}
+
+static u32 shard_wakeup_timeout(struct nvgpu_worker *worker)
+{
+	return 1U;
+}
+
+static const struct nvgpu_worker_ops shard_worker_ops = {
+	.wakeup_post_process = shard_post_process,
+	.wakeup_process_item = shard_process_item,
+	.wakeup_timeout = shard_wakeup_timeout,
+};
+
+int test_sharded_scaling(struct unit_module *m, struct gk20a *g, void *args)
+{
+	const u32 shard_counts[] = { 1U, 2U, 4U };
+	struct shard_test_item items[SHARD_TEST_ITEMS];
+	struct nvgpu_worker sharded;
+	s64 base_ns = 0;
+	int ret = UNIT_FAIL;
+	u32 i, j;
+	int err;
+
+	for (i = 0U; i < ARRAY_SIZE(shard_counts); i++) {
+		struct nvgpu_timeout timeout;
+		s64 start_ns, duration_ns;
+
+		memset(&sharded, 0, sizeof(sharded));
+		nvgpu_worker_init_name(&sharded, "shardtest", "gpu");
+		err = nvgpu_worker_init_sharded(g, &sharded, &shard_worker_ops,
+				shard_counts[i]);
+		unit_assert(err == 0, goto done);
+		unit_assert(sharded.num_shards == shard_counts[i],
+				goto deinit);
+
+		for (j = 0U; j < SHARD_TEST_ITEMS; j++) {
+			nvgpu_init_list_node(&items[j].node);
+			nvgpu_atomic_set(&items[j].busy, 0);
+			nvgpu_atomic_set(&items[j].processed, 0);
+		}
+		nvgpu_atomic_set(&shard_items_done, 0);
+		nvgpu_atomic_set(&shard_overlaps, 0);
+		nvgpu_atomic_set(&shard_ticks, 0);
+
+		nvgpu_timeout_init_cpu_timer(g, &timeout,
+				SHARD_TEST_TIMEOUT_MS);
+		start_ns = nvgpu_current_time_ns();
+		for (j = 0U; j < SHARD_TEST_ITEMS; j++) {
+			/* key like a chid */
+			err = nvgpu_worker_enqueue_sharded(&sharded,
+					&items[j].node, j);
+			unit_assert(err == 0, goto deinit);
+		}
+		while ((u32)nvgpu_atomic_read(&shard_items_done) <
+				SHARD_TEST_ITEMS) {
+			unit_assert(nvgpu_timeout_expired(&timeout) == 0,
+					goto deinit);
+			nvgpu_udelay(5);
+		}
+		duration_ns = nvgpu_current_time_ns() - start_ns;
+		if (duration_ns <= 0) {
+			duration_ns = 1;
+		}
+
+		for (j = 0U; j < SHARD_TEST_ITEMS; j++) {
+			unit_assert(nvgpu_atomic_read(&items[j].processed) == 1,
+					goto deinit);
+		}
+		unit_assert(nvgpu_atomic_read(&shard_overlaps) == 0,
+				goto deinit);
+
+		if (i == 0U) {
+			base_ns = duration_ns;
+		}
+		unit_info(m, "%u shard(s): %u items in %lld us, "
+			"%lld items/s, speedup x%lld.%02lld, %d ticks\n",
+			shard_counts[i], SHARD_TEST_ITEMS,
+			(long long)(duration_ns / 1000),
+			(long long)(((s64)SHARD_TEST_ITEMS * 1000000000LL) /
+				duration_ns),
+			(long long)(base_ns / duration_ns),
+			(long long)(((base_ns * 100) / duration_ns) % 100),
+			nvgpu_atomic_read(&shard_ticks));
+
+		nvgpu_worker_deinit(&sharded);
+		unit_assert(sharded.shards == NULL, goto done);
+	}
+
+	ret = UNIT_SUCCESS;
+	goto done;
+
+deinit:
+	nvgpu_worker_deinit(&sharded);
+done:
+	return ret;
+}
+
+/*
+ * Several producers hammer one worker with a shared pool of items, like
+ * channel completions arriving from interrupts on different CPUs.
+ */
+#define MPSC_TEST_PRODUCERS	4U
+#define MPSC_TEST_ITEMS		64U
+#define MPSC_TEST_LOOPS		20000U
+
+struct mpsc_test_item {
+	struct nvgpu_list_node node;
+	nvgpu_atomic_t busy;
+};
+
+static struct nvgpu_worker mpsc_worker;
+static struct mpsc_test_item mpsc_items[MPSC_TEST_ITEMS];
+static nvgpu_atomic_t mpsc_enqueued;
+static nvgpu_atomic_t mpsc_processed;
+static nvgpu_atomic_t mpsc_overlaps;
+
+static void mpsc_process_item(struct nvgpu_list_node *work_item)
+{
+	struct mpsc_test_item *item = (struct mpsc_test_item *)
+		((uintptr_t)work_item - offsetof(struct mpsc_test_item, node));
+
+	if (nvgpu_atomic_inc_return(&item->busy) != 1) {
+		nvgpu_atomic_inc(&mpsc_overlaps);
+	}
+	nvgpu_atomic_dec(&item->busy);
+	nvgpu_atomic_inc(&mpsc_processed);
+}
+
+static const struct nvgpu_worker_ops mpsc_worker_ops = {
+	.wakeup_process_item = mpsc_process_item,
+};
+
+static int mpsc_producer(void *arg)
+{
+	u32 seed = (u32)(uintptr_t)arg;
+	int enqueued = 0;
+	u32 i;
+
+	for (i = 0U; i < MPSC_TEST_LOOPS; i++) {
+		seed = seed * 1103515245U + 12345U;
+		if (nvgpu_worker_enqueue(&mpsc_worker,
+				&mpsc_items[(seed >> 16) % MPSC_TEST_ITEMS].node)
+				== 0) {
+			enqueued++;
+		}
+	}
+	nvgpu_atomic_add(enqueued, &mpsc_enqueued);
+
+	return 0;
+}
+
+int test_mpsc_enqueue(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct nvgpu_thread producers[MPSC_TEST_PRODUCERS];
+	s64 start_ns;
+	int ret = UNIT_FAIL;
+	u32 i;
+	int err;
+
+	memset(&mpsc_worker, 0, sizeof(mpsc_worker));
+	memset(producers, 0, sizeof(producers));
+	nvgpu_worker_init_name(&mpsc_worker, "mpsctest", "gpu");
+	err = nvgpu_worker_init(g, &mpsc_worker, &mpsc_worker_ops);
+	unit_assert(err == 0, return UNIT_FAIL);
+
+	for (i = 0U; i < MPSC_TEST_ITEMS; i++) {
+		nvgpu_init_list_node(&mpsc_items[i].node);
+		nvgpu_atomic_set(&mpsc_items[i].busy, 0);
+	}
+	nvgpu_atomic_set(&mpsc_enqueued, 0);
+	nvgpu_atomic_set(&mpsc_processed, 0);
+	nvgpu_atomic_set(&mpsc_overlaps, 0);
+
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < MPSC_TEST_PRODUCERS; i++) {
+		err = nvgpu_thread_create(&producers[i],
+				(void *)(uintptr_t)(i + 1U), mpsc_producer,
+				"mpsc_producer");
+		unit_assert(err == 0, goto stop);
+	}
+	for (i = 0U; i < MPSC_TEST_PRODUCERS; i++) {
+		nvgpu_thread_join(&producers[i]);
+	}
+
+	while (nvgpu_atomic_read(&mpsc_processed) !=
+			nvgpu_atomic_read(&mpsc_enqueued)) {
+		nvgpu_udelay(5);
+	}
+
+	unit_info(m, "%u producers: %d of %u enqueues accepted, "
+		"%lld us\n", MPSC_TEST_PRODUCERS,
+		nvgpu_atomic_read(&mpsc_enqueued),
+		MPSC_TEST_PRODUCERS * MPSC_TEST_LOOPS,
+		(long long)((nvgpu_current_time_ns() - start_ns) / 1000));
+
+	unit_assert(nvgpu_atomic_read(&mpsc_overlaps) == 0, goto stop);
+
+	/* Every item is idle again and can be queued once more. */
+	for (i = 0U; i < MPSC_TEST_ITEMS; i++) {
+		unit_assert(nvgpu_list_empty(&mpsc_items[i].node), goto stop);
+		err = nvgpu_worker_enqueue(&mpsc_worker, &mpsc_items[i].node);
+		unit_assert(err == 0, goto stop);
+	}
+	while (nvgpu_atomic_read(&mpsc_processed) !=
+			nvgpu_atomic_read(&mpsc_enqueued) +
+			(int)MPSC_TEST_ITEMS) {
+		nvgpu_udelay(5);
+	}
+
+	ret = UNIT_SUCCESS;
+
+stop:
+	nvgpu_worker_deinit(&mpsc_worker);
+	return ret;
+}
+
 int test_deinit(struct unit_module *m, struct gk20a *g, void *args)
 {
 	nvgpu_worker_deinit(&worker);
@@ -348,6 +600,8 @@ struct unit_module_test worker_tests[] = {
 	UNIT_TEST(init,		test_init,				NULL, 0),
 	UNIT_TEST(enqueue,	test_enqueue,				NULL, 1),
 	UNIT_TEST(branches,	test_branches,				NULL, 0),
+	UNIT_TEST(sharded_scaling, test_sharded_scaling,		NULL, 0),
+	UNIT_TEST(mpsc_enqueue,	test_mpsc_enqueue,			NULL, 0),
 	UNIT_TEST(deinit,	test_deinit,				NULL, 0),
 };
 
@@ -149,6 +149,64 @@ int test_enqueue(struct unit_module *m, struct gk20a *g, void *args);
  */
 int test_branches(struct unit_module *m, struct gk20a *g, void *args);
 
+/**
+ * Test specification for: test_sharded_scaling
+ *
+ * Description: Verify that a sharded worker processes every work item exactly
+ *              once and never on two threads at a time, and report how the
+ *              processing throughput scales with the number of shards.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_worker_init_sharded, nvgpu_worker_enqueue_sharded,
+ *          nvgpu_worker_deinit
+ *
+ * Input: None
+ *
+ * Steps:
+ * - For 1, 2 and 4 shards:
+ *   - Call nvgpu_worker_init_sharded() and verify it returns success.
+ *   - Enqueue 64 work items with distinct keys, each of which keeps a shard
+ *     busy for 200us, the way channel job cleanup would.
+ *   - Wait until all items have been processed and log the elapsed time,
+ *     the items per second, the speedup over one shard and the number of
+ *     main thread ticks seen meanwhile.
+ *   - Verify each item was processed once and no item was processed by two
+ *     threads concurrently.
+ *   - Call nvgpu_worker_deinit() and verify the shards were freed.
+ *
+ * Output: Returns PASS if expected result is met, FAIL otherwise.
+ */
+int test_sharded_scaling(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_mpsc_enqueue
+ *
+ * Description: Verify that concurrent producers can enqueue work items
+ *              without losing or duplicating any, and report the enqueue
+ *              throughput.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_worker_init, nvgpu_worker_enqueue, nvgpu_worker_deinit
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Call nvgpu_worker_init() and verify it returns success.
+ * - Start 4 producer threads that each enqueue items picked from a shared
+ *   pool of 64 items 20000 times, counting the enqueues that succeed. An
+ *   enqueue of an item that is still queued is expected to fail.
+ * - Wait until the number of processed items matches the number of
+ *   successful enqueues and log the elapsed time.
+ * - Verify no item was processed by two threads concurrently and that every
+ *   item can be queued again once idle.
+ * - Call nvgpu_worker_deinit().
+ *
+ * Output: Returns PASS if expected result is met, FAIL otherwise.
+ */
+int test_mpsc_enqueue(struct unit_module *m, struct gk20a *g, void *args);
+
 /**
  * Test specification for: test_deinit
  *
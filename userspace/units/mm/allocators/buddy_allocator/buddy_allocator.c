@@ -27,6 +27,7 @@
 #include <nvgpu/sizes.h>
 #include <nvgpu/types.h>
 #include <nvgpu/allocator.h>
+#include <nvgpu/timers.h>
 #include <nvgpu/posix/kmem.h>
 #include <nvgpu/posix/posix-fault-injection.h>
 
@@ -1030,6 +1031,186 @@ int test_nvgpu_buddy_allocator_init(struct unit_module *m,
 	return UNIT_SUCCESS;
 }
 
+/*
+ * Check that small and big PTE allocations are served from their own PDEs
+ * and that buddies left over by earlier splits are reused before splitting
+ * anything else.
+ */
+int test_buddy_allocator_pte_lists(struct unit_module *m,
+					struct gk20a *g, void *args)
+{
+	u64 base = 0x4000000;	/* PDE aligned */
+	u64 size = SZ_256M;
+	u64 blk_size = BA_DEFAULT_BLK_SIZE;
+	u64 flags = GPU_ALLOC_GVA_SPACE;
+	u64 small1, small2, big1, big2, space, splits, pde_shift;
+	struct nvgpu_buddy_allocator *ba;
+	struct vm_gk20a *vm = init_vm_env(m, g, true, "vm_pte_lists");
+
+	if (vm == NULL) {
+		unit_return_fail(m, "couldn't init vm env\n");
+	}
+
+	if (nvgpu_allocator_init(g, na, vm, "test_pte_lists", base, size,
+			blk_size, GPU_BALLOC_MAX_ORDER, flags,
+			BUDDY_ALLOCATOR) != 0) {
+		free_vm_env(m, g, vm);
+		unit_return_fail(m, "ba init failed\n");
+	}
+	ba = na->priv;
+	space = na->ops->space(na);
+	pde_shift = ba->blk_shift + ba->pte_blk_order;
+
+	small1 = na->ops->alloc_pte(na, SZ_4K, SZ_4K);
+	big1 = na->ops->alloc_pte(na, SZ_64K, vm->big_page_size);
+	if ((small1 == 0ULL) || (big1 == 0ULL)) {
+		unit_err(m, "%d: initial allocations failed\n", __LINE__);
+		goto fail;
+	}
+
+	if ((small1 >> pde_shift) == (big1 >> pde_shift)) {
+		unit_err(m, "%d: small and big PTEs share a PDE\n", __LINE__);
+		goto fail;
+	}
+
+	/* The buddies of the first allocations are free, no split needed. */
+	splits = ba->splits;
+	small2 = na->ops->alloc_pte(na, SZ_4K, SZ_4K);
+	big2 = na->ops->alloc_pte(na, SZ_64K, vm->big_page_size);
+	if ((small2 == 0ULL) || (big2 == 0ULL)) {
+		unit_err(m, "%d: second allocations failed\n", __LINE__);
+		goto fail;
+	}
+
+	if (ba->splits != splits) {
+		unit_err(m, "%d: %llu needless splits\n", __LINE__,
+			ba->splits - splits);
+		goto fail;
+	}
+
+	if (((small2 >> pde_shift) != (small1 >> pde_shift)) ||
+	    ((big2 >> pde_shift) != (big1 >> pde_shift))) {
+		unit_err(m, "%d: PDE not reused\n", __LINE__);
+		goto fail;
+	}
+
+	na->ops->free_alloc(na, small1);
+	na->ops->free_alloc(na, small2);
+	na->ops->free_alloc(na, big1);
+	na->ops->free_alloc(na, big2);
+
+	if ((ba->coalesces != ba->splits) || (na->ops->space(na) != space)) {
+		unit_err(m, "%d: %llu splits, %llu coalesces after free\n",
+			__LINE__, ba->splits, ba->coalesces);
+		goto fail;
+	}
+
+	na->ops->fini(na);
+	free_vm_env(m, g, vm);
+	return UNIT_SUCCESS;
+
+fail:
+	na->ops->fini(na);
+	free_vm_env(m, g, vm);
+	return UNIT_FAIL;
+}
+
+/*
+ * Time fixed allocations with BA_BENCH_NUM_ALLOCS live allocations.
+ */
+#define BA_BENCH_BASE		SZ_1G
+#define BA_BENCH_SIZE		SZ_1G
+#define BA_BENCH_NUM_ALLOCS	100000U
+
+int test_buddy_allocator_fixed_bench(struct unit_module *m,
+					struct gk20a *g, void *args)
+{
+	struct nvgpu_buddy_allocator *ba;
+	u64 blk_size = SZ_4K;
+	u64 addr, space;
+	s64 start_ns;
+	u32 i;
+	int result = UNIT_FAIL;
+
+	na = (struct nvgpu_allocator *)
+			nvgpu_kzalloc(g, sizeof(struct nvgpu_allocator));
+	if (na == NULL) {
+		unit_return_fail(m, "Could not allocate nvgpu_allocator\n");
+	}
+
+	if (nvgpu_allocator_init(g, na, NULL, "test_bench", BA_BENCH_BASE,
+			BA_BENCH_SIZE, blk_size, 0ULL, 0ULL,
+			BUDDY_ALLOCATOR) != 0) {
+		nvgpu_kfree(g, na);
+		unit_return_fail(m, "buddy_allocator_init failed\n");
+	}
+	ba = na->priv;
+	space = na->ops->space(na);
+
+	/* Every other block, so nothing can coalesce. */
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < BA_BENCH_NUM_ALLOCS; i++) {
+		addr = BA_BENCH_BASE + (u64)i * 2ULL * blk_size;
+		if (na->ops->alloc_fixed(na, addr, blk_size, SZ_4K) != addr) {
+			unit_err(m, "fixed alloc %u at 0x%llx failed\n",
+				i, addr);
+			goto cleanup;
+		}
+	}
+	unit_info(m, "populate: %lld ns/alloc\n",
+		unit_bench_ns_per_op(start_ns, BA_BENCH_NUM_ALLOCS));
+
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < BA_BENCH_NUM_ALLOCS; i++) {
+		addr = BA_BENCH_BASE + (u64)i * 2ULL * blk_size;
+		if (na->ops->alloc_fixed(na, addr, blk_size, SZ_4K) != 0ULL) {
+			unit_err(m, "fixed alloc on live range 0x%llx\n", addr);
+			goto cleanup;
+		}
+		if (na->ops->alloc_fixed(na, addr, blk_size << 1,
+				SZ_4K) != 0ULL) {
+			unit_err(m, "fixed alloc straddling 0x%llx\n", addr);
+			goto cleanup;
+		}
+	}
+	unit_info(m, "busy lookup: %lld ns/alloc\n",
+		unit_bench_ns_per_op(start_ns, BA_BENCH_NUM_ALLOCS * 2U));
+
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < BA_BENCH_NUM_ALLOCS; i++) {
+		addr = BA_BENCH_BASE + ((u64)i * 2ULL + 1ULL) * blk_size;
+		if (na->ops->alloc_fixed(na, addr, blk_size, SZ_4K) != addr) {
+			unit_err(m, "fixed alloc in hole 0x%llx failed\n",
+				addr);
+			goto cleanup;
+		}
+	}
+	unit_info(m, "fill holes: %lld ns/alloc\n",
+		unit_bench_ns_per_op(start_ns, BA_BENCH_NUM_ALLOCS));
+
+	result = UNIT_SUCCESS;
+
+cleanup:
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < BA_BENCH_NUM_ALLOCS * 2U; i++) {
+		na->ops->free_alloc(na, BA_BENCH_BASE + (u64)i * blk_size);
+	}
+	unit_info(m, "free: %lld ns/free\n",
+		unit_bench_ns_per_op(start_ns, BA_BENCH_NUM_ALLOCS * 2U));
+
+	if ((result == UNIT_SUCCESS) &&
+	    ((na->ops->space(na) != space) ||
+	     (ba->alloced_buddies != NULL))) {
+		unit_err(m, "allocator not empty after freeing everything\n");
+		result = UNIT_FAIL;
+	}
+
+	na->ops->fini(na);
+	nvgpu_kfree(g, na);
+
+	return result;
+}
+
 struct unit_module_test buddy_allocator_tests[] = {
 
 	/* BA initialized in this test is used by next tests */
@@ -1047,6 +1228,10 @@ struct unit_module_test buddy_allocator_tests[] = {
 	UNIT_TEST(ops_small_pages, test_buddy_allocator_with_small_pages, NULL, 0),
 	/* Tests buddy allocator - GVA_space enabled and big_pages enabled */
 	UNIT_TEST(ops_big_pages, test_buddy_allocator_with_big_pages, NULL, 0),
+	/* Tests PTE size segregation and split/coalesce counters */
+	UNIT_TEST(pte_lists, test_buddy_allocator_pte_lists, NULL, 0),
+	/* Times fixed allocations with 100k live allocations */
+	UNIT_BENCH(fixed_bench, test_buddy_allocator_fixed_bench, NULL, 0),
 };
 
 UNIT_MODULE(buddy_allocator, buddy_allocator_tests, UNIT_PRIO_NVGPU_TEST);
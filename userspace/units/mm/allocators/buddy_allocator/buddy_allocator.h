@@ -287,4 +287,67 @@ int test_buddy_allocator_with_small_pages(struct unit_module *m,
 int test_buddy_allocator_with_big_pages(struct unit_module *m,
 						struct gk20a *g, void *args);
 
+/**
+ * Test specification for: test_buddy_allocator_pte_lists
+ *
+ * Description: Test that buddies are picked per PTE size without needless
+ * splits.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_allocator.ops.alloc_pte, nvgpu_allocator.ops.free_alloc,
+ *          balloc_find_buddy, balloc_do_alloc, balloc_split_buddy,
+ *          balloc_coalesce
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Initialize vm environment with big pages enabled.
+ * - Initialize a GVA space buddy allocator with base 64M and size 256M.
+ * - Allocate a 4K small page and a 64K big page buffer. Confirm they do not
+ *   share a PDE.
+ * - Allocate another 4K small and 64K big page buffer. Confirm no buddy was
+ *   split and that each landed in the PDE of the matching first allocation.
+ * - Free everything and confirm the split and coalesce counters match and
+ *   the whole space is free again.
+ *
+ * Output: Returns SUCCESS if the steps above were executed successfully. FAIL
+ * otherwise.
+ */
+int test_buddy_allocator_pte_lists(struct unit_module *m,
+						struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_buddy_allocator_fixed_bench
+ *
+ * Description: Benchmark of fixed allocations against a heavily populated
+ * buddy allocator, run with --bench.
+ *
+ * Test Type: Performance
+ *
+ * Targets: nvgpu_allocator.ops.alloc_fixed, nvgpu_allocator.ops.free_alloc,
+ *          balloc_is_range_free, balloc_make_fixed_buddy
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Initialize buddy allocator for this test.
+ *   - Base address = 1G.
+ *   - Allocator size = 1G.
+ *   - Block size = 4K.
+ * - Make 100k 4K fixed allocations at every other block so that none of the
+ *   allocated or free buddies can coalesce.
+ * - Try a fixed allocation on top of each live allocation and on a range
+ *   covering a live allocation and the free block after it. Expect all of
+ *   them to fail.
+ * - Fill every free block in between with a fixed allocation.
+ * - Free all allocations and confirm the whole space is free again.
+ * - Log the average time per fixed allocation for each phase.
+ *
+ * Output: Returns SUCCESS if the steps above were executed successfully. FAIL
+ * otherwise.
+ */
+int test_buddy_allocator_fixed_bench(struct unit_module *m,
+						struct gk20a *g, void *args);
+
 #endif /* UNIT_BUDDY_ALLOCATOR_H */
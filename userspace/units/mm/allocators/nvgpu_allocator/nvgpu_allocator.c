@@ -25,6 +25,9 @@
 
 #include <nvgpu/types.h>
 #include <nvgpu/sizes.h>
+#include <nvgpu/atomic.h>
+#include <nvgpu/thread.h>
+#include <nvgpu/timers.h>
 #include <nvgpu/allocator.h>
 
 #include "nvgpu_allocator.h"
@@ -346,11 +349,259 @@ int test_nvgpu_allocator_init(struct unit_module *m,
 	return UNIT_SUCCESS;
 }
 
+/*
+ * Alloc/free stress for GPU_ALLOC_CACHE. Every thread keeps a few blocks of
+ * mixed sizes live and marks the 4K pages it owns so that handing the same
+ * block to two threads is caught.
+ */
+#define CACHE_STRESS_BASE	(SZ_1M * 64ULL)
+#define CACHE_STRESS_SIZE	(SZ_1M * 64ULL)
+#define CACHE_STRESS_THREADS	8U
+#define CACHE_STRESS_LOOPS	20000U
+#define CACHE_STRESS_HELD	8U
+#define CACHE_STRESS_PAGES	(CACHE_STRESS_SIZE / SZ_4K)
+
+static const u64 cache_stress_sizes[] = { SZ_4K, SZ_4K * 2ULL, SZ_64K };
+
+static nvgpu_atomic_t cache_stress_owner[CACHE_STRESS_PAGES];
+
+struct cache_stress_thread {
+	struct nvgpu_thread thread;
+	struct nvgpu_allocator *a;
+	u32 seed;
+	bool failed;
+};
+
+static u32 cache_stress_rand(u32 *seed)
+{
+	*seed = (*seed * 1103515245U) + 12345U;
+	return *seed >> 16U;
+}
+
+static bool cache_stress_mark(u64 addr, u64 len, int from, int to)
+{
+	u64 page = (addr - CACHE_STRESS_BASE) / SZ_4K;
+	u64 end = page + (len / SZ_4K);
+
+	for (; page < end; page++) {
+		if (nvgpu_atomic_cmpxchg(&cache_stress_owner[page],
+				from, to) != from) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static int cache_stress_worker(void *arg)
+{
+	struct cache_stress_thread *t = arg;
+	u64 addrs[CACHE_STRESS_HELD] = { };
+	u64 lens[CACHE_STRESS_HELD] = { };
+	u32 i, slot;
+
+	for (i = 0U; i < CACHE_STRESS_LOOPS; i++) {
+		slot = cache_stress_rand(&t->seed) % CACHE_STRESS_HELD;
+
+		if (addrs[slot] != 0ULL) {
+			if (!cache_stress_mark(addrs[slot], lens[slot], 1, 0)) {
+				t->failed = true;
+			}
+			nvgpu_free_sized(t->a, addrs[slot], lens[slot], 0U);
+			addrs[slot] = 0ULL;
+			continue;
+		}
+
+		lens[slot] = cache_stress_sizes[cache_stress_rand(&t->seed) %
+					ARRAY_SIZE(cache_stress_sizes)];
+		addrs[slot] = nvgpu_alloc(t->a, lens[slot]);
+		if ((addrs[slot] == 0ULL) ||
+		    !cache_stress_mark(addrs[slot], lens[slot], 0, 1)) {
+			t->failed = true;
+			addrs[slot] = 0ULL;
+		}
+	}
+
+	for (slot = 0U; slot < CACHE_STRESS_HELD; slot++) {
+		if (addrs[slot] != 0ULL) {
+			(void) cache_stress_mark(addrs[slot], lens[slot], 1, 0);
+			nvgpu_free_sized(t->a, addrs[slot], lens[slot], 0U);
+		}
+	}
+
+	return 0;
+}
+
+static int cache_stress_run(struct unit_module *m, struct gk20a *g,
+			    u64 flags, s64 *duration_ns)
+{
+	struct cache_stress_thread threads[CACHE_STRESS_THREADS] = { };
+	struct nvgpu_allocator a = { };
+	u64 addr, addr2;
+	s64 start_ns;
+	u32 i;
+	int ret = UNIT_SUCCESS;
+
+	if (nvgpu_allocator_init(g, &a, NULL, "cache_stress",
+			CACHE_STRESS_BASE, CACHE_STRESS_SIZE, SZ_4K, 0ULL,
+			flags, BUDDY_ALLOCATOR) != 0) {
+		unit_return_fail(m, "failed to init buddy_allocator\n");
+	}
+
+	/* A freed block comes straight back for the same size. */
+	addr = nvgpu_alloc(&a, SZ_4K);
+	nvgpu_free_sized(&a, addr, SZ_4K, 0U);
+	addr2 = nvgpu_alloc(&a, SZ_4K);
+	if ((addr == 0ULL) || (addr2 == 0ULL) ||
+	    (((flags & GPU_ALLOC_CACHE) != 0ULL) && (addr2 != addr))) {
+		unit_err(m, "freed block not reused: 0x%llx 0x%llx\n",
+			addr, addr2);
+		ret = UNIT_FAIL;
+	}
+	nvgpu_free_sized(&a, addr2, SZ_4K, 0U);
+
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < CACHE_STRESS_THREADS; i++) {
+		threads[i].a = &a;
+		threads[i].seed = i + 1U;
+		if (nvgpu_thread_create(&threads[i].thread, &threads[i],
+				cache_stress_worker, "cache_stress") != 0) {
+			unit_err(m, "failed to start thread %u\n", i);
+			threads[i].failed = true;
+		}
+	}
+	for (i = 0U; i < CACHE_STRESS_THREADS; i++) {
+		nvgpu_thread_join(&threads[i].thread);
+		if (threads[i].failed) {
+			unit_err(m, "thread %u saw a bad allocation\n", i);
+			ret = UNIT_FAIL;
+		}
+	}
+	*duration_ns = nvgpu_current_time_ns() - start_ns;
+
+	/*
+	 * Everything is free again but parts of it sit in the cache. The
+	 * whole space can only be allocated once the cache is drained.
+	 */
+	addr = nvgpu_alloc(&a, CACHE_STRESS_SIZE);
+	if (addr != CACHE_STRESS_BASE) {
+		unit_err(m, "cache not drained on allocation failure\n");
+		ret = UNIT_FAIL;
+	} else {
+		nvgpu_free(&a, addr);
+	}
+
+	nvgpu_alloc_destroy(&a);
+
+	return ret;
+}
+
+int test_nvgpu_alloc_cache_stress(struct unit_module *m,
+				  struct gk20a *g, void *args)
+{
+	s64 plain_ns = 0, cached_ns = 0;
+	u64 ops = (u64)CACHE_STRESS_THREADS * CACHE_STRESS_LOOPS;
+
+	if (cache_stress_run(m, g, 0ULL, &plain_ns) != UNIT_SUCCESS) {
+		unit_return_fail(m, "stress failed without cache\n");
+	}
+
+	if (cache_stress_run(m, g, GPU_ALLOC_CACHE, &cached_ns) !=
+			UNIT_SUCCESS) {
+		unit_return_fail(m, "stress failed with cache\n");
+	}
+
+	unit_info(m, "%u threads, %llu ops: %lld us uncached, %lld us cached\n",
+		  CACHE_STRESS_THREADS, ops, plain_ns / 1000, cached_ns / 1000);
+
+	return UNIT_SUCCESS;
+}
+
+/*
+ * 1M allocator: the cache holds 64K, 8K per slot. A single thread only
+ * uses one slot, so two 4K blocks fit.
+ */
+#define CACHE_DRAIN_BASE	SZ_1M
+#define CACHE_DRAIN_SIZE	SZ_1M
+#define CACHE_DRAIN_BLOCKS	4U
+
+int test_nvgpu_alloc_cache_drain(struct unit_module *m,
+				 struct gk20a *g, void *args)
+{
+	struct nvgpu_allocator a = { };
+	u64 addrs[CACHE_DRAIN_BLOCKS];
+	u64 addr, addr2;
+	u32 i;
+	int ret = UNIT_FAIL;
+
+	if (nvgpu_allocator_init(g, &a, NULL, "cache_drain",
+			CACHE_DRAIN_BASE, CACHE_DRAIN_SIZE, SZ_4K, 0ULL,
+			GPU_ALLOC_CACHE, BUDDY_ALLOCATOR) != 0) {
+		unit_return_fail(m, "failed to init buddy_allocator\n");
+	}
+
+	for (i = 0U; i < CACHE_DRAIN_BLOCKS; i++) {
+		addrs[i] = nvgpu_alloc(&a, SZ_4K);
+		if (addrs[i] == 0ULL) {
+			unit_err(m, "alloc %u failed\n", i);
+			goto done;
+		}
+	}
+
+	/* Only the first two blocks fit under the high-water mark. */
+	for (i = 0U; i < CACHE_DRAIN_BLOCKS; i++) {
+		nvgpu_free_sized(&a, addrs[i], SZ_4K, 0U);
+	}
+	if (nvgpu_alloc_space(&a) != CACHE_DRAIN_SIZE - 2ULL * SZ_4K) {
+		unit_err(m, "cache over its bound: space 0x%llx\n",
+			nvgpu_alloc_space(&a));
+		goto done;
+	}
+
+	/* A fixed allocation of a cached block drains the cache. */
+	addr = nvgpu_alloc_fixed(&a, addrs[0], SZ_4K, 0U);
+	if ((addr != addrs[0]) ||
+	    (nvgpu_alloc_space(&a) != CACHE_DRAIN_SIZE - SZ_4K)) {
+		unit_err(m, "fixed alloc of a cached block failed\n");
+		goto done;
+	}
+	nvgpu_free(&a, addr);
+
+	/* So does an allocation that only fits once the cache is empty. */
+	addr = nvgpu_alloc(&a, SZ_4K);
+	addr2 = nvgpu_alloc(&a, SZ_4K);
+	if ((addr == 0ULL) || (addr2 == 0ULL)) {
+		unit_err(m, "4K alloc failed\n");
+		goto done;
+	}
+	nvgpu_free_sized(&a, addr, SZ_4K, 0U);
+	nvgpu_free_sized(&a, addr2, SZ_4K, 0U);
+	if (nvgpu_alloc_space(&a) == CACHE_DRAIN_SIZE) {
+		unit_err(m, "blocks not cached\n");
+		goto done;
+	}
+	addr = nvgpu_alloc(&a, CACHE_DRAIN_SIZE);
+	if (addr != CACHE_DRAIN_BASE) {
+		unit_err(m, "cache not drained on allocation failure\n");
+		goto done;
+	}
+	nvgpu_free(&a, addr);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	nvgpu_alloc_destroy(&a);
+
+	return ret;
+}
+
 struct unit_module_test nvgpu_allocator_tests[] = {
 	UNIT_TEST(common_init,      test_nvgpu_alloc_common_init,  NULL, 0),
 	UNIT_TEST(alloc_destroy,    test_nvgpu_alloc_destroy,      NULL, 0),
 	UNIT_TEST(alloc_ops,        test_nvgpu_alloc_ops_present,  NULL, 0),
 	UNIT_TEST(allocator_init,   test_nvgpu_allocator_init,     NULL, 0),
+	UNIT_TEST(cache_stress,     test_nvgpu_alloc_cache_stress, NULL, 0),
+	UNIT_TEST(cache_drain,      test_nvgpu_alloc_cache_drain,  NULL, 0),
 };
 
 UNIT_MODULE(nvgpu_allocator, nvgpu_allocator_tests, UNIT_PRIO_NVGPU_TEST);
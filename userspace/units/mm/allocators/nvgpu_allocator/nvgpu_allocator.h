@@ -122,4 +122,66 @@ int test_nvgpu_alloc_ops_present(struct unit_module *m,
 int test_nvgpu_allocator_init(struct unit_module *m,
 						struct gk20a *g, void *args);
 
+/**
+ * Test specification for: test_nvgpu_alloc_cache_stress
+ *
+ * Description: Multi-threaded alloc/free stress of the free block cache.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_allocator_init, nvgpu_alloc, nvgpu_free_sized, nvgpu_free,
+ *          nvgpu_alloc_destroy
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Run the steps below on a 64M buddy allocator without and with
+ *   GPU_ALLOC_CACHE.
+ *   - Allocate and free a 4K block, then allocate 4K again. With the cache
+ *     the same block must come back.
+ *   - Start 8 threads which each randomly allocate and free 4K, 8K and 64K
+ *     blocks, keeping up to 8 of them live. Each thread marks the pages of
+ *     its blocks in a shared array and fails if a page is already owned.
+ *   - Once all threads are done, allocate the whole space. This can only
+ *     succeed if cached blocks are returned on allocation failure.
+ *   - Destroy the allocator.
+ * - Log the time taken with and without the cache.
+ *
+ * Output: Returns SUCCESS if the steps above were executed successfully. FAIL
+ * otherwise.
+ */
+int test_nvgpu_alloc_cache_stress(struct unit_module *m,
+						struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_nvgpu_alloc_cache_drain
+ *
+ * Description: Bound of the free block cache and drain on allocation
+ * failure.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_allocator_init, nvgpu_alloc, nvgpu_free_sized,
+ *          nvgpu_alloc_fixed, nvgpu_alloc_space,
+ *          nvgpu_free, nvgpu_alloc_destroy
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Create a 1M buddy allocator with GPU_ALLOC_CACHE.
+ * - Allocate four 4K blocks and free them with nvgpu_free_sized(). Check
+ *   that only two of them are kept in the cache, which is bounded to 8K
+ *   per thread slot for this allocator.
+ * - Allocate the first cached block with nvgpu_alloc_fixed(). This only
+ *   succeeds if the cache is drained. Free it again.
+ * - Cache two 4K blocks again, then allocate the whole space. This only
+ *   succeeds if the cache is drained.
+ * - Destroy the allocator.
+ *
+ * Output: Returns SUCCESS if the steps above were executed successfully. FAIL
+ * otherwise.
+ */
+int test_nvgpu_alloc_cache_drain(struct unit_module *m,
+						struct gk20a *g, void *args);
+
 #endif /* UNIT_NVGPU_ALLOCATOR_H */
@@ -29,6 +29,7 @@
 #include <nvgpu/gk20a.h>
 #include <nvgpu/types.h>
 #include <nvgpu/sizes.h>
+#include <nvgpu/timers.h>
 #include <nvgpu/gmmu.h>
 #include <nvgpu/mm.h>
 #include <nvgpu/vm.h>
@@ -922,6 +923,343 @@ int test_nvgpu_gmmu_map_unmap_batched(struct unit_module *m,
 	return UNIT_SUCCESS;
 }
 
+
+/* Counters for the TLB invalidate HALs used by the deferred TLB test */
+static u32 tlb_full_count;
+static u32 tlb_range_count;
+static u64 tlb_range_last_va;
+static u64 tlb_range_last_size;
+
+static int hal_fb_tlb_invalidate_count(struct gk20a *g, struct nvgpu_mem *pdb)
+{
+	tlb_full_count++;
+	return 0;
+}
+
+static int hal_fb_tlb_invalidate_range_count(struct gk20a *g,
+	struct nvgpu_mem *pdb, u64 va, u64 size)
+{
+	tlb_range_count++;
+	tlb_range_last_va = va;
+	tlb_range_last_size = size;
+	return 0;
+}
+
+/*
+ * Map TEST_SIZE bytes at TEST_PA_ADDRESS + index * TEST_SIZE, identity
+ * mapped, and return the GPU VA or 0 on failure.
+ */
+static u64 gmmu_map_index(struct unit_module *m, struct gk20a *g,
+	struct test_parameters *params, struct vm_gk20a_mapping_batch *batch,
+	u32 index)
+{
+	struct nvgpu_mem mem = { };
+	struct nvgpu_sgt *sgt;
+	u64 vaddr;
+
+	mem.size = TEST_SIZE;
+	mem.cpu_va = (void *) (TEST_PA_ADDRESS + ((u64) index * TEST_SIZE));
+
+	sgt = custom_sgt_create(m, g, &mem, NULL, 0);
+	if (sgt == NULL) {
+		return 0ULL;
+	}
+	vaddr = gmmu_map_advanced(m, g, &mem, params, batch, g->mm.pmu.vm,
+				  sgt);
+	nvgpu_sgt_free(g, sgt);
+
+	return vaddr;
+}
+
+static void gmmu_unmap_index(struct vm_gk20a *vm,
+	struct test_parameters *params, struct vm_gk20a_mapping_batch *batch,
+	u32 index)
+{
+	struct nvgpu_mem mem = { };
+
+	mem.size = TEST_SIZE;
+	gmmu_unmap_advanced(vm, &mem, TEST_PA_ADDRESS +
+			    ((u64) index * TEST_SIZE), params, batch);
+}
+
+#define TLB_TEST_BUFFERS	(2U * (NVGPU_VM_TLB_DIRTY_RANGES + 1U))
+
+int test_nvgpu_gmmu_tlb_deferred(struct unit_module *m,
+					struct gk20a *g, void *args)
+{
+	struct vm_gk20a *vm = g->mm.pmu.vm;
+	struct vm_gk20a_mapping_batch batch = { };
+	struct test_parameters *params = (struct test_parameters *) args;
+	int ret = UNIT_FAIL;
+	u32 i;
+
+	g->ops.fb.tlb_invalidate = hal_fb_tlb_invalidate_count;
+	g->ops.fb.tlb_invalidate_range = NULL;
+	tlb_full_count = 0U;
+	tlb_range_count = 0U;
+
+	if (nvgpu_vm_tlb_flush_deferred(vm) != 0) {
+		unit_err(m, "Initial flush failed\n");
+		goto done;
+	}
+	tlb_full_count = 0U;
+	vm->tlb.nr_deferred = 0ULL;
+
+	/* Deferred maps of 4 adjacent buffers: no invalidate, one range */
+	batch.defer_tlb_invalidate = true;
+	for (i = 0U; i < 4U; i++) {
+		if (gmmu_map_index(m, g, params, &batch, i) == 0ULL) {
+			unit_err(m, "Failed to map buffer %u\n", i);
+			goto done;
+		}
+	}
+	if ((tlb_full_count != 0U) || batch.need_tlb_invalidate) {
+		unit_err(m, "Deferred map invalidated the TLB\n");
+		goto done;
+	}
+	if ((nvgpu_atomic_read(&vm->tlb.pending) == 0) ||
+	    (vm->tlb.nr_ranges != 1U) || (vm->tlb.nr_deferred != 4ULL)) {
+		unit_err(m, "Unexpected tracker state (ranges=%u)\n",
+			 vm->tlb.nr_ranges);
+		goto done;
+	}
+
+	/* The next submit flushes everything with a single invalidate */
+	if ((nvgpu_vm_tlb_flush_deferred(vm) != 0) ||
+	    (nvgpu_vm_tlb_flush_deferred(vm) != 0)) {
+		unit_err(m, "Deferred flush failed\n");
+		goto done;
+	}
+	if ((tlb_full_count != 1U) ||
+	    (nvgpu_atomic_read(&vm->tlb.pending) != 0)) {
+		unit_err(m, "Expected 1 full invalidate, got %u\n",
+			 tlb_full_count);
+		goto done;
+	}
+
+	/* With a range HAL, disjoint ranges are invalidated one by one */
+	g->ops.fb.tlb_invalidate_range = hal_fb_tlb_invalidate_range_count;
+	if ((gmmu_map_index(m, g, params, &batch, 0U) == 0ULL) ||
+	    (gmmu_map_index(m, g, params, &batch, 2U) == 0ULL) ||
+	    (gmmu_map_index(m, g, params, &batch, 3U) == 0ULL)) {
+		unit_err(m, "Failed to map buffers\n");
+		goto done;
+	}
+	if ((nvgpu_vm_tlb_flush_deferred(vm) != 0) ||
+	    (tlb_range_count != 2U) || (tlb_full_count != 1U)) {
+		unit_err(m, "Expected 2 range invalidates, got %u\n",
+			 tlb_range_count);
+		goto done;
+	}
+	if ((tlb_range_last_va != (TEST_PA_ADDRESS + 2ULL * TEST_SIZE)) ||
+	    (tlb_range_last_size != (2ULL * TEST_SIZE))) {
+		unit_err(m, "Range invalidate does not match the mappings\n");
+		goto done;
+	}
+
+	/* Too many disjoint ranges fall back to a full invalidate */
+	for (i = 0U; i < TLB_TEST_BUFFERS; i += 2U) {
+		if (gmmu_map_index(m, g, params, &batch, i) == 0ULL) {
+			unit_err(m, "Failed to map buffer %u\n", i);
+			goto done;
+		}
+	}
+	if (!vm->tlb.overflow || (nvgpu_vm_tlb_flush_deferred(vm) != 0) ||
+	    (tlb_full_count != 2U) || (tlb_range_count != 2U)) {
+		unit_err(m, "Overflow did not fall back to full invalidate\n");
+		goto done;
+	}
+
+	/* An unmap outside of a batch flushes the pending maps with it */
+	if (gmmu_map_index(m, g, params, &batch, 1U) == 0ULL) {
+		unit_err(m, "Failed to map buffer 1\n");
+		goto done;
+	}
+	gmmu_unmap_index(vm, params, NULL, 0U);
+	if ((nvgpu_atomic_read(&vm->tlb.pending) != 0) ||
+	    (tlb_range_count != 3U) ||
+	    (tlb_range_last_size != (2ULL * TEST_SIZE))) {
+		unit_err(m, "Unmap did not flush the deferred map\n");
+		goto done;
+	}
+
+	/* Once deferral is disabled, the batch invalidates as before */
+	nvgpu_vm_tlb_disable_defer(vm);
+	if (gmmu_map_index(m, g, params, &batch, 0U) == 0ULL) {
+		unit_err(m, "Failed to map buffer 0\n");
+		goto done;
+	}
+	if (!batch.need_tlb_invalidate) {
+		unit_err(m, "TLB invalidate flag not set.\n");
+		goto done;
+	}
+	nvgpu_vm_mapping_batch_finish(vm, &batch);
+	if ((nvgpu_atomic_read(&vm->tlb.pending) != 0) ||
+	    (tlb_range_count != 4U)) {
+		unit_err(m, "Batch finish did not invalidate the TLB\n");
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	for (i = 0U; i < TLB_TEST_BUFFERS; i++) {
+		gmmu_unmap_index(vm, params, NULL, i);
+	}
+	vm->tlb.no_defer = false;
+	g->ops.fb.tlb_invalidate = gm20b_fb_tlb_invalidate;
+	g->ops.fb.tlb_invalidate_range = NULL;
+
+	return ret;
+}
+
+/*
+ * Map and unmap PT_BENCH_SIZE bytes with the PTEs written by the caller
+ * alone, then by PT_BENCH_THREADS worker threads, and compare the PTEs.
+ */
+#define PT_BENCH_SIZE		(4ULL * SZ_1G)
+#define PT_BENCH_THREADS	4U
+#define PT_BENCH_SAMPLE_STRIDE	(2ULL * SZ_1M)
+#define PT_BENCH_SAMPLES	(2U * (u32)(PT_BENCH_SIZE / PT_BENCH_SAMPLE_STRIDE))
+
+/*
+ * Read the first and last PTE of every PT_BENCH_SAMPLE_STRIDE chunk of the
+ * mapping. Returns the number of PTEs that could not be read.
+ */
+static u32 pt_bench_sample(struct gk20a *g, struct test_parameters *params,
+	u32 (*ptes)[2])
+{
+	u64 page_size = g->mm.pmu.vm->gmmu_page_sizes[params->page_size];
+	u32 missing = 0U;
+	u32 i;
+
+	for (i = 0U; i < PT_BENCH_SAMPLES; i++) {
+		u64 va = TEST_PA_ADDRESS +
+			(u64)(i / 2U) * PT_BENCH_SAMPLE_STRIDE;
+
+		if ((i % 2U) != 0U) {
+			va += PT_BENCH_SAMPLE_STRIDE - page_size;
+		}
+		if (nvgpu_get_pte(g, g->mm.pmu.vm, va, ptes[i]) != 0) {
+			missing++;
+		}
+	}
+
+	return missing;
+}
+
+static int pt_bench_map_unmap(struct unit_module *m, struct gk20a *g,
+	struct test_parameters *params, u32 (*ptes)[2], s64 *map_ns,
+	s64 *unmap_ns)
+{
+	struct nvgpu_mem mem = { };
+	struct nvgpu_sgt *sgt;
+	u64 vaddr;
+	s64 t0;
+
+	mem.size = PT_BENCH_SIZE;
+	mem.cpu_va = (void *) TEST_PA_ADDRESS;
+
+	sgt = custom_sgt_create(m, g, &mem, NULL, 0);
+	if (sgt == NULL) {
+		return UNIT_FAIL;
+	}
+
+	t0 = nvgpu_current_time_ns();
+	vaddr = gmmu_map_advanced(m, g, &mem, params, NULL, g->mm.pmu.vm,
+				  sgt);
+	*map_ns = nvgpu_current_time_ns() - t0;
+	nvgpu_sgt_free(g, sgt);
+
+	if (vaddr != TEST_PA_ADDRESS) {
+		unit_return_fail(m, "Failed to map buffer\n");
+	}
+
+	if (pt_bench_sample(g, params, ptes) != 0U) {
+		unit_return_fail(m, "Missing PTEs after map\n");
+	}
+
+	t0 = nvgpu_current_time_ns();
+	gmmu_unmap_advanced(g->mm.pmu.vm, &mem, vaddr, params, NULL);
+	*unmap_ns = nvgpu_current_time_ns() - t0;
+
+	return UNIT_SUCCESS;
+}
+
+int test_nvgpu_gmmu_map_unmap_parallel(struct unit_module *m,
+					struct gk20a *g, void *args)
+{
+	struct test_parameters *params = (struct test_parameters *) args;
+	u32 (*serial)[2] = NULL;
+	u32 (*parallel)[2] = NULL;
+	s64 serial_map_ns, serial_unmap_ns;
+	s64 parallel_map_ns, parallel_unmap_ns;
+	int ret = UNIT_FAIL;
+	u32 i;
+
+	serial = calloc(PT_BENCH_SAMPLES, sizeof(*serial));
+	parallel = calloc(PT_BENCH_SAMPLES, sizeof(*parallel));
+	if ((serial == NULL) || (parallel == NULL)) {
+		unit_err(m, "Failed to allocate PTE samples\n");
+		goto done;
+	}
+
+	if (pt_bench_map_unmap(m, g, params, serial, &serial_map_ns,
+			       &serial_unmap_ns) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	g->mm.pt_parallel_threads = PT_BENCH_THREADS;
+	g->mm.pt_parallel_min_size = 0ULL;
+	if (nvgpu_gmmu_pt_workers_init(g) != 0) {
+		unit_err(m, "Failed to start the page table workers\n");
+		goto done;
+	}
+
+	if (pt_bench_map_unmap(m, g, params, parallel, &parallel_map_ns,
+			       &parallel_unmap_ns) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	for (i = 0U; i < PT_BENCH_SAMPLES; i++) {
+		if ((serial[i][0] != parallel[i][0]) ||
+		    (serial[i][1] != parallel[i][1])) {
+			unit_err(m, "PTE sample %u differs: %08x %08x vs "
+				 "%08x %08x\n", i, serial[i][1], serial[i][0],
+				 parallel[i][1], parallel[i][0]);
+			goto done;
+		}
+	}
+
+	/* The unmap must have cleared the PTEs written by the workers. */
+	if (pt_bench_sample(g, params, parallel) != 0U) {
+		unit_err(m, "Missing PTEs after unmap\n");
+		goto done;
+	}
+	for (i = 0U; i < PT_BENCH_SAMPLES; i++) {
+		if ((parallel[i][0] & gmmu_new_pte_valid_true_f()) != 0U) {
+			unit_err(m, "PTE sample %u still valid\n", i);
+			goto done;
+		}
+	}
+
+	unit_info(m, "4 GiB, %u KB pages: map %lld us serial, %lld us with "
+		  "%u threads; unmap %lld us serial, %lld us with %u threads\n",
+		  g->mm.pmu.vm->gmmu_page_sizes[params->page_size] / 1024U,
+		  serial_map_ns / 1000, parallel_map_ns / 1000,
+		  PT_BENCH_THREADS, serial_unmap_ns / 1000,
+		  parallel_unmap_ns / 1000, PT_BENCH_THREADS);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	nvgpu_gmmu_pt_workers_deinit(g);
+	g->mm.pt_parallel_threads = 0U;
+	free(serial);
+	free(parallel);
+
+	return ret;
+}
 static int check_pte_valid(struct unit_module *m, struct gk20a *g,
 			struct vm_gk20a *vm, struct nvgpu_mem *mem)
 {
@@ -1272,6 +1610,18 @@ struct unit_module_test nvgpu_gmmu_tests[] = {
 		test_nvgpu_gmmu_map_unmap_batched,
 		(void *) &test_iommu_sysmem_adv_big,
 		0),
+	UNIT_TEST(gmmu_tlb_deferred_iommu_sysmem_adv_big_pages,
+		test_nvgpu_gmmu_tlb_deferred,
+		(void *) &test_iommu_sysmem_adv_big,
+		0),
+	UNIT_TEST(gmmu_map_unmap_parallel_iommu_sysmem_adv_kernel_pages,
+		test_nvgpu_gmmu_map_unmap_parallel,
+		(void *) &test_iommu_sysmem_adv,
+		0),
+	UNIT_TEST(gmmu_map_unmap_parallel_iommu_sysmem_adv_big_pages,
+		test_nvgpu_gmmu_map_unmap_parallel,
+		(void *) &test_iommu_sysmem_adv_big,
+		0),
 	UNIT_TEST(gmmu_map_unmap_unmapped, test_nvgpu_gmmu_map_unmap,
 		(void *) &test_no_iommu_unmapped,
 		0),
@@ -152,6 +152,78 @@ int test_nvgpu_gmmu_map_unmap_adv(struct unit_module *m, struct gk20a *g,
 int test_nvgpu_gmmu_map_unmap_batched(struct unit_module *m, struct gk20a *g,
 	void *args);
 
+/**
+ * Test specification for: test_nvgpu_gmmu_tlb_deferred
+ *
+ * Description: Check that TLB invalidates of maps in a batch with
+ * defer_tlb_invalidate set are deferred, coalesced into dirty ranges and
+ * flushed by the next submit, unmap or batch end.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_gmmu_map_locked, nvgpu_gmmu_unmap_locked,
+ * nvgpu_gmmu_tlb_flush_dirty, nvgpu_vm_tlb_flush_deferred,
+ * nvgpu_vm_tlb_disable_defer, nvgpu_vm_mapping_batch_finish
+ *
+ * Input: args as a struct test_parameters to hold scenario and test parameters.
+ *
+ * Steps:
+ * - Replace the TLB invalidate HALs with counting stubs, without a range
+ *   invalidate HAL.
+ * - Map 4 adjacent buffers in a deferring batch and ensure no invalidate was
+ *   issued and a single dirty range is tracked.
+ * - Call nvgpu_vm_tlb_flush_deferred twice and ensure exactly one full
+ *   invalidate was issued.
+ * - Install the range invalidate HAL, map 3 buffers forming 2 disjoint
+ *   ranges, flush and ensure 2 range invalidates matching the mappings.
+ * - Map more disjoint buffers than NVGPU_VM_TLB_DIRTY_RANGES, flush and
+ *   ensure it falls back to a single full invalidate.
+ * - Map a buffer in the deferring batch, unmap its neighbour without a batch
+ *   and ensure both were covered by a single range invalidate.
+ * - Disable deferral on the VM, map a buffer in the deferring batch and
+ *   ensure the batch requires an invalidate which is issued by
+ *   nvgpu_vm_mapping_batch_finish.
+ * - Unmap all buffers and restore the HALs.
+ *
+ * Output: Returns PASS if the steps above were executed successfully. FAIL
+ * otherwise.
+ */
+int test_nvgpu_gmmu_tlb_deferred(struct unit_module *m, struct gk20a *g,
+	void *args);
+
+/**
+ * Test specification for: test_nvgpu_gmmu_map_unmap_parallel
+ *
+ * Description: Map and unmap a 4 GiB buffer with the PTEs written by the
+ * caller only, then by the page table worker threads, check that both
+ * produce the same PTEs and report the time taken by each.
+ *
+ * Test Type: Feature, Performance
+ *
+ * Targets: nvgpu_gmmu_pt_workers_init, nvgpu_gmmu_pt_workers_deinit,
+ * gops_mm_gmmu.map, nvgpu_gmmu_map_locked, gops_mm_gmmu.unmap,
+ * nvgpu_gmmu_unmap_locked
+ *
+ * Input: args as a struct test_parameters to hold scenario and test parameters.
+ *
+ * Steps:
+ * - Map a 4 GiB buffer with the page size in argument, without page table
+ *   workers, and time it.
+ * - Read the first and last PTE of every 2 MB of the mapping.
+ * - Unmap the buffer and time it.
+ * - Start 4 page table worker threads with nvgpu_gmmu_pt_workers_init and
+ *   the default size threshold.
+ * - Repeat the map, PTE sampling and unmap.
+ * - Ensure the PTEs written by the workers match the serial ones.
+ * - Ensure the sampled PTEs are no longer valid after the unmap.
+ * - Stop the workers with nvgpu_gmmu_pt_workers_deinit.
+ *
+ * Output: Returns PASS if the steps above were executed successfully. FAIL
+ * otherwise.
+ */
+int test_nvgpu_gmmu_map_unmap_parallel(struct unit_module *m, struct gk20a *g,
+	void *args);
+
 /**
  * Test specification for: test_nvgpu_page_table_c1_full
  *
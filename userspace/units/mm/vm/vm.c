@@ -278,7 +278,16 @@ int test_nvgpu_vm_alloc_va(struct unit_module *m, struct gk20a *g,
 	}
 
 	/* And now free it */
-	nvgpu_vm_free_va(vm, addr, 0);
+	nvgpu_vm_free_va(vm, addr, SZ_1K, 0);
+
+	/* The user VMA caches the freed range for the next VA of that size */
+	if ((vm->vma[GMMU_PAGE_SIZE_SMALL]->cache == NULL) ||
+	    (nvgpu_vm_alloc_va(vm, SZ_1K, 0) != addr)) {
+		unit_err(m, "Freed VA was not reused\n");
+		ret = UNIT_FAIL;
+		goto exit;
+	}
+	nvgpu_vm_free_va(vm, addr, SZ_1K, 0);
 
 	ret = UNIT_SUCCESS;
 exit:
@@ -1978,6 +1987,369 @@ exit:
 	return ret;
 }
 
+/*
+ * Buffer for test_map_buf_mixed_pages: 4KB but not 64KB aligned in physical
+ * memory and not a multiple of 64KB in size, so it can't be mapped with big
+ * pages as a whole. It still covers one full PDE with a 64KB aligned layout.
+ */
+#define MIXED_BUF_PA		0x10003000ULL
+#define MIXED_BUF_SIZE		((4ULL * SZ_1M) + (3ULL * SZ_4K))
+
+/*
+ * Check that the PTE for @offset into a mapping points at the right
+ * physical page.
+ */
+static int check_mixed_pte(struct unit_module *m, struct gk20a *g,
+			   struct vm_gk20a *vm, u64 gpu_va, u64 offset,
+			   u64 page_size)
+{
+	u32 pte[2];
+	u64 expected = (MIXED_BUF_PA + offset) & ~(page_size - 1ULL);
+
+	if (nvgpu_get_pte(g, vm, gpu_va + offset, pte) != 0) {
+		unit_err(m, "PTE lookup failed at offset 0x%llx\n", offset);
+		return UNIT_FAIL;
+	}
+	if (!pte_is_valid(pte) || (pte_get_phys_addr(m, pte) != expected)) {
+		unit_err(m, "Bad PTE at offset 0x%llx: 0x%x 0x%x\n",
+			 offset, pte[0], pte[1]);
+		return UNIT_FAIL;
+	}
+
+	return UNIT_SUCCESS;
+}
+
+/*
+ * Buffer, VM and sgt shared by the mixed page tests.
+ */
+struct mixed_env {
+	struct vm_gk20a *vm;
+	struct nvgpu_os_buffer os_buf;
+	struct nvgpu_mem_sgl sgl_list[1];
+	struct nvgpu_mem mem;
+	struct nvgpu_sgt *sgt;
+};
+
+static int mixed_env_init(struct unit_module *m, struct gk20a *g,
+			  struct mixed_env *env)
+{
+	u64 low_hole = SZ_1M * 64;
+	u64 aperture_size = 128 * SZ_1G;
+	u64 kernel_reserved = 4 * SZ_1G - low_hole;
+	u64 user_vma = aperture_size - low_hole - kernel_reserved;
+
+	memset(env, 0, sizeof(*env));
+
+	if (init_test_env(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	env->vm = nvgpu_vm_init(g,
+			   g->ops.mm.gmmu.get_default_big_page_size(),
+			   low_hole,
+			   user_vma,
+			   kernel_reserved,
+			   nvgpu_gmmu_va_small_page_limit(),
+			   true,
+			   false,
+			   true,
+			   "mixed_pages");
+	if (env->vm == NULL) {
+		unit_err(m, "Failed to init VM\n");
+		return UNIT_FAIL;
+	}
+
+	env->os_buf.buf = nvgpu_kzalloc(g, MIXED_BUF_SIZE);
+	if (env->os_buf.buf == NULL) {
+		unit_err(m, "Failed to allocate a CPU buffer\n");
+		return UNIT_FAIL;
+	}
+	env->os_buf.size = MIXED_BUF_SIZE;
+
+	env->sgl_list[0].phys = MIXED_BUF_PA;
+	env->sgl_list[0].length = MIXED_BUF_SIZE;
+	env->mem.size = MIXED_BUF_SIZE;
+	env->mem.cpu_va = env->os_buf.buf;
+
+	env->sgt = custom_sgt_create(m, g, &env->mem, env->sgl_list, 1);
+	if (env->sgt == NULL) {
+		return UNIT_FAIL;
+	}
+
+	return UNIT_SUCCESS;
+}
+
+static void mixed_env_free(struct gk20a *g, struct mixed_env *env)
+{
+	if (env->sgt != NULL) {
+		nvgpu_sgt_free(g, env->sgt);
+	}
+	if (env->os_buf.buf != NULL) {
+		nvgpu_kfree(g, env->os_buf.buf);
+	}
+	if (env->vm != NULL) {
+		nvgpu_vm_put(env->vm);
+	}
+}
+
+static int mixed_env_map(struct unit_module *m, struct mixed_env *env,
+			 u32 flags, struct nvgpu_mapped_buf **mapped_buf)
+{
+	if (nvgpu_vm_map(env->vm, &env->os_buf, env->sgt, 0, MIXED_BUF_SIZE,
+			 0, gk20a_mem_flag_none,
+			 NVGPU_VM_MAP_ACCESS_READ_WRITE, flags,
+			 NV_KIND_INVALID, 0, NULL, APERTURE_SYSMEM,
+			 mapped_buf) != 0) {
+		unit_err(m, "Failed to map buffer\n");
+		return UNIT_FAIL;
+	}
+
+	return UNIT_SUCCESS;
+}
+
+int test_map_buf_mixed_pages(struct unit_module *m, struct gk20a *g,
+			     void *__args)
+{
+	int ret = UNIT_FAIL;
+	struct mixed_env env;
+	struct vm_gk20a *vm;
+	struct nvgpu_mapped_buf *mapped_buf = NULL;
+	struct nvgpu_vm_page_stats stats;
+	struct nvgpu_mapped_buf_seg *big_seg;
+	u64 big_offset = 0ULL;
+	u64 gpu_va;
+	u32 pte[2];
+
+	if (mixed_env_init(m, g, &env) != UNIT_SUCCESS) {
+		goto exit;
+	}
+	vm = env.vm;
+
+	/* Without NVGPU_VM_MAP_MIXED_PAGES the whole buffer uses small pages */
+	if (mixed_env_map(m, &env, NVGPU_VM_MAP_CACHEABLE,
+			  &mapped_buf) != UNIT_SUCCESS) {
+		goto exit;
+	}
+	gpu_va = mapped_buf->addr;
+	nvgpu_vm_get_page_stats(vm, &stats);
+	if ((mapped_buf->segs != NULL) ||
+	    (stats.mapped_pages[GMMU_PAGE_SIZE_SMALL] !=
+	     MIXED_BUF_SIZE / SZ_4K) ||
+	    (stats.nr_mixed_maps != 0ULL)) {
+		unit_err(m, "Mixed mapping without the flag\n");
+		nvgpu_vm_unmap(vm, gpu_va, NULL);
+		goto exit;
+	}
+	nvgpu_vm_unmap(vm, gpu_va, NULL);
+
+	if (mixed_env_map(m, &env,
+			  NVGPU_VM_MAP_CACHEABLE | NVGPU_VM_MAP_MIXED_PAGES,
+			  &mapped_buf) != UNIT_SUCCESS) {
+		goto exit;
+	}
+	gpu_va = mapped_buf->addr;
+
+	/* Small page head, one PDE of big pages, small page tail */
+	if ((mapped_buf->segs == NULL) || (mapped_buf->nr_segs != 3U)) {
+		unit_err(m, "Buffer not mapped with mixed page sizes\n");
+		goto unmap;
+	}
+	big_seg = &mapped_buf->segs[1];
+	if ((mapped_buf->segs[0].pgsz_idx != GMMU_PAGE_SIZE_SMALL) ||
+	    (big_seg->pgsz_idx != GMMU_PAGE_SIZE_BIG) ||
+	    (big_seg->size != 2ULL * SZ_1M) ||
+	    (mapped_buf->segs[2].pgsz_idx != GMMU_PAGE_SIZE_SMALL)) {
+		unit_err(m, "Unexpected page size segments\n");
+		goto unmap;
+	}
+	if (((gpu_va + big_seg->offset) & (2ULL * SZ_1M - 1ULL)) != 0ULL ||
+	    (gpu_va & (SZ_64K - 1ULL)) != (MIXED_BUF_PA & (SZ_64K - 1ULL))) {
+		unit_err(m, "Bad GPU VA 0x%llx\n", gpu_va);
+		goto unmap;
+	}
+
+	if ((check_mixed_pte(m, g, vm, gpu_va, 0ULL, SZ_4K) != UNIT_SUCCESS) ||
+	    (check_mixed_pte(m, g, vm, gpu_va, big_seg->offset,
+			     SZ_64K) != UNIT_SUCCESS) ||
+	    (check_mixed_pte(m, g, vm, gpu_va,
+			     big_seg->offset + big_seg->size - SZ_4K,
+			     SZ_64K) != UNIT_SUCCESS) ||
+	    (check_mixed_pte(m, g, vm, gpu_va, MIXED_BUF_SIZE - SZ_4K,
+			     SZ_4K) != UNIT_SUCCESS)) {
+		goto unmap;
+	}
+
+	nvgpu_vm_get_page_stats(vm, &stats);
+	if ((stats.mapped_pages[GMMU_PAGE_SIZE_BIG] != 32ULL) ||
+	    (stats.mapped_pages[GMMU_PAGE_SIZE_SMALL] !=
+	     (MIXED_BUF_SIZE - 2ULL * SZ_1M) / SZ_4K) ||
+	    (stats.nr_mixed_maps != 1ULL) ||
+	    (stats.mixed_big_bytes != 2ULL * SZ_1M)) {
+		unit_err(m, "Bad page stats while mapped\n");
+		goto unmap;
+	}
+	big_offset = big_seg->offset;
+
+	ret = UNIT_SUCCESS;
+
+unmap:
+	nvgpu_vm_unmap(vm, gpu_va, NULL);
+	if (ret != UNIT_SUCCESS) {
+		goto exit;
+	}
+	ret = UNIT_FAIL;
+
+	/* Every segment is unmapped */
+	if (((nvgpu_get_pte(g, vm, gpu_va, pte) == 0) &&
+	     pte_is_valid(pte)) ||
+	    ((nvgpu_get_pte(g, vm, gpu_va + big_offset, pte) == 0) &&
+	     pte_is_valid(pte)) ||
+	    ((nvgpu_get_pte(g, vm, gpu_va + MIXED_BUF_SIZE - SZ_4K,
+			    pte) == 0) && pte_is_valid(pte))) {
+		unit_err(m, "PTE still valid after unmap\n");
+		goto exit;
+	}
+
+	nvgpu_vm_get_page_stats(vm, &stats);
+	if ((stats.mapped_pages[GMMU_PAGE_SIZE_BIG] != 0ULL) ||
+	    (stats.mapped_pages[GMMU_PAGE_SIZE_SMALL] != 0ULL) ||
+	    (stats.nr_mixed_maps != 0ULL) ||
+	    (stats.mixed_big_bytes != 0ULL)) {
+		unit_err(m, "Bad page stats after unmap\n");
+		goto exit;
+	}
+
+	/* Without a unified VA the whole buffer uses small pages */
+	vm->unified_va = false;
+	ret = mixed_env_map(m, &env,
+			    NVGPU_VM_MAP_CACHEABLE | NVGPU_VM_MAP_MIXED_PAGES,
+			    &mapped_buf);
+	vm->unified_va = true;
+	if (ret != UNIT_SUCCESS) {
+		goto exit;
+	}
+	ret = UNIT_FAIL;
+	gpu_va = mapped_buf->addr;
+	nvgpu_vm_get_page_stats(vm, &stats);
+	if ((mapped_buf->segs != NULL) ||
+	    (stats.mapped_pages[GMMU_PAGE_SIZE_SMALL] !=
+	     MIXED_BUF_SIZE / SZ_4K) ||
+	    (stats.nr_mixed_maps != 0ULL)) {
+		unit_err(m, "Unexpected mixed mapping (non-unified VA)\n");
+	} else {
+		ret = UNIT_SUCCESS;
+	}
+	nvgpu_vm_unmap(vm, gpu_va, NULL);
+
+exit:
+	mixed_env_free(g, &env);
+
+	return ret;
+}
+
+#define MIXED_MODIFY_KIND	0x6U
+
+/*
+ * Check the kind of the PTE at @offset into a mapping.
+ */
+static bool mixed_pte_has_kind(struct gk20a *g, struct vm_gk20a *vm,
+			       u64 gpu_va, u64 offset, u32 kind)
+{
+	u32 pte[2];
+
+	if (nvgpu_get_pte(g, vm, gpu_va + offset, pte) != 0) {
+		return false;
+	}
+
+	return pte_is_valid(pte) &&
+		((pte[gmmu_new_pte_kind_w()] & gmmu_new_pte_kind_f(0xffU)) ==
+		 gmmu_new_pte_kind_f(kind));
+}
+
+int test_map_buf_mixed_pages_modify(struct unit_module *m, struct gk20a *g,
+				    void *__args)
+{
+	int ret = UNIT_FAIL;
+	struct mixed_env env;
+	struct vm_gk20a *vm;
+	struct nvgpu_mapped_buf *mapped_buf = NULL;
+	struct nvgpu_mapped_buf_seg *big_seg;
+	u64 gpu_va = 0ULL;
+	u64 big_offset, end;
+	int err;
+
+	if (mixed_env_init(m, g, &env) != UNIT_SUCCESS) {
+		goto exit;
+	}
+	vm = env.vm;
+
+	if (mixed_env_map(m, &env,
+			  NVGPU_VM_MAP_CACHEABLE | NVGPU_VM_MAP_MIXED_PAGES,
+			  &mapped_buf) != UNIT_SUCCESS) {
+		goto exit;
+	}
+	gpu_va = mapped_buf->addr;
+	if ((mapped_buf->segs == NULL) || (mapped_buf->nr_segs != 3U)) {
+		unit_err(m, "Buffer not mapped with mixed page sizes\n");
+		goto unmap;
+	}
+	big_seg = &mapped_buf->segs[1];
+	big_offset = big_seg->offset;
+	end = big_offset + SZ_64K;
+
+	/* A range ending inside a big page is rejected and changes nothing */
+	nvgpu_mutex_acquire(&vm->update_gmmu_lock);
+	err = nvgpu_vm_mapping_modify_mixed(vm, mapped_buf, env.sgt,
+			MIXED_MODIFY_KIND, 0ULL, end - SZ_4K);
+	nvgpu_mutex_release(&vm->update_gmmu_lock);
+	if (err != -EINVAL) {
+		unit_err(m, "Range splitting a big page not rejected\n");
+		goto unmap;
+	}
+	if (mixed_pte_has_kind(g, vm, gpu_va, 0ULL, MIXED_MODIFY_KIND) ||
+	    !mixed_pte_has_kind(g, vm, gpu_va, 0ULL, 0U)) {
+		unit_err(m, "Rejected modify changed the small page head\n");
+		goto unmap;
+	}
+
+	/* Small page head and the first big page */
+	nvgpu_mutex_acquire(&vm->update_gmmu_lock);
+	err = nvgpu_vm_mapping_modify_mixed(vm, mapped_buf, env.sgt,
+			MIXED_MODIFY_KIND, 0ULL, end);
+	nvgpu_mutex_release(&vm->update_gmmu_lock);
+	if (err != 0) {
+		unit_err(m, "Modify of a mixed mapping failed: %d\n", err);
+		goto unmap;
+	}
+
+	if (!mixed_pte_has_kind(g, vm, gpu_va, 0ULL, MIXED_MODIFY_KIND) ||
+	    !mixed_pte_has_kind(g, vm, gpu_va, big_offset - SZ_4K,
+				MIXED_MODIFY_KIND) ||
+	    !mixed_pte_has_kind(g, vm, gpu_va, big_offset,
+				MIXED_MODIFY_KIND) ||
+	    !mixed_pte_has_kind(g, vm, gpu_va, end, 0U) ||
+	    !mixed_pte_has_kind(g, vm, gpu_va, MIXED_BUF_SIZE - SZ_4K, 0U)) {
+		unit_err(m, "Unexpected PTE kinds after modify\n");
+		goto unmap;
+	}
+
+	/* The big page still points at the right memory */
+	if (check_mixed_pte(m, g, vm, gpu_va, big_offset,
+			    SZ_64K) != UNIT_SUCCESS) {
+		goto unmap;
+	}
+
+	ret = UNIT_SUCCESS;
+
+unmap:
+	nvgpu_vm_unmap(vm, gpu_va, NULL);
+
+exit:
+	mixed_env_free(g, &env);
+
+	return ret;
+}
+
 /*
  * Dummy cache flush ops for counting number of cache flushes
  */
@@ -2369,7 +2741,7 @@ int test_nvgpu_insert_mapped_buf(struct unit_module *m, struct gk20a *g,
 	ret = UNIT_SUCCESS;
 
 done:
-	nvgpu_vm_free_va(vm, map_addr, 0);
+	nvgpu_vm_free_va(vm, map_addr, size, 0);
 
 	return ret;
 }
@@ -2422,6 +2794,9 @@ struct unit_module_test vm_tests[] = {
 		      test_map_buf_gpu_va,
 		      NULL,
 		      0),
+	UNIT_TEST(map_buf_mixed_pages, test_map_buf_mixed_pages, NULL, 0),
+	UNIT_TEST(map_buf_mixed_pages_modify, test_map_buf_mixed_pages_modify,
+		  NULL, 0),
 
 	/*
 	 * Feature tests
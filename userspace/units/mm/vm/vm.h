@@ -128,6 +128,75 @@ int test_map_buf(struct unit_module *m, struct gk20a *g, void *__args);
  */
 int test_map_buf_gpu_va(struct unit_module *m, struct gk20a *g, void *__args);
 
+/**
+ * Test specification for: test_map_buf_mixed_pages
+ *
+ * Description: A buffer that cannot be mapped with big pages as a whole is
+ * mapped with big pages where its layout allows it and small pages
+ * elsewhere, and the VM page statistics follow the mapping.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_vm_init, nvgpu_vm_map, nvgpu_get_pte, nvgpu_vm_unmap,
+ * nvgpu_vm_get_page_stats, nvgpu_vm_put
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Initialize a VM with 64KB large page support and a unified VA.
+ * - Map a buffer that is 4KB aligned in physical memory and 4MB + 12KB in
+ *   size without a fixed GPU VA and without NVGPU_VM_MAP_MIXED_PAGES, and
+ *   check that it uses small pages only. Unmap it.
+ * - Map the buffer again with NVGPU_VM_MAP_MIXED_PAGES.
+ * - Check that the mapping has a small page head, a 2MB big page segment
+ *   that starts on a PDE boundary and a small page tail, and that the GPU
+ *   VA has the same offset into a 64KB page as the physical address.
+ * - Check the PTEs at the start and end of each segment.
+ * - Check that nvgpu_vm_get_page_stats() reports 32 big pages, the rest of
+ *   the buffer as small pages and one mixed mapping.
+ * - Unmap the buffer and check that the PTEs of all three segments are gone
+ *   and all statistics are zero.
+ * - Map the buffer again with a non-unified VA and check that it uses small
+ *   pages only.
+ * - Uninitialize the VM.
+ *
+ * Output: Returns PASS if the steps above were executed successfully. FAIL
+ * otherwise.
+ */
+int test_map_buf_mixed_pages(struct unit_module *m, struct gk20a *g,
+			     void *__args);
+
+/**
+ * Test specification for: test_map_buf_mixed_pages_modify
+ *
+ * Description: The kind of a range of a mixed page size mapping can be
+ * changed as long as the range does not split a big page.
+ *
+ * Test Type: Feature, Error injection
+ *
+ * Targets: nvgpu_vm_map, nvgpu_vm_mapping_modify_mixed, nvgpu_get_pte,
+ * nvgpu_vm_unmap
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Initialize a VM with 64KB large page support and a unified VA.
+ * - Map a 4MB + 12KB buffer that is not 64KB aligned in physical memory with
+ *   NVGPU_VM_MAP_MIXED_PAGES and check that it gets three segments.
+ * - Modify the kind from the start of the mapping to 4KB into the first big
+ *   page and check that -EINVAL is returned and the head PTE keeps its kind.
+ * - Modify the kind from the start of the mapping to the end of the first
+ *   big page and check the kind of the head, the first big page, the next
+ *   big page and the tail PTEs.
+ * - Check that the modified big page PTE still points at the buffer.
+ * - Unmap the buffer and uninitialize the VM.
+ *
+ * Output: Returns PASS if the steps above were executed successfully. FAIL
+ * otherwise.
+ */
+int test_map_buf_mixed_pages_modify(struct unit_module *m, struct gk20a *g,
+				    void *__args);
+
 /**
  * Test specification for: test_batch
  *
@@ -350,6 +419,9 @@ int test_map_buffer_security_error_cases(struct unit_module *m, struct gk20a *g,
  *   memory allocation to fail.)
  * - Call nvgpu_vm_alloc_va with valid parameters and ensure that it succeeds
  *   (returns a non-NULL address.)
+ * - Free the address, check that the user VMA has a free block cache,
+ *   allocate the same size again and ensure that the same address is
+ *   returned, then free it.
  * - Uninitialize the VM
  *
  * Output: Returns PASS if the steps above were executed successfully. FAIL
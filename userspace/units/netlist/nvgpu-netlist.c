@@ -20,6 +20,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -33,10 +35,12 @@
 #include <nvgpu/enabled.h>
 #include <nvgpu/hw/gm20b/hw_mc_gm20b.h>
 #include <nvgpu/netlist.h>
+#include <nvgpu/firmware.h>
 
 #include "hal/init/hal_gv11b.h"
 #include "hal/netlist/netlist_gv11b.h"
 #include "hal/gr/falcon/gr_falcon_gm20b.h"
+#include "common/netlist/netlist_priv.h"
 
 #include "nvgpu-netlist.h"
 
@@ -86,6 +90,160 @@ static u32 test_gr_falcon_get_fecs_ctx_state_store_major_rev_id(struct gk20a *g)
 	return 0xbad;
 }
 
+/*
+ * Netlist images made up by the tests. They are written next to the ucode
+ * the POSIX firmware loader reads, under names of their own.
+ */
+#define NETLIST_TEST_FW_DIR		"firmware/gv11b/"
+#define NETLIST_TEST_MAX_REGIONS	8U
+#define NETLIST_TEST_IMAGE_SIZE		256U
+#define NETLIST_TEST_MAJOR_V		0x1U
+
+struct netlist_test_image {
+	union {
+		struct netlist_image image;
+		u8 bytes[NETLIST_TEST_IMAGE_SIZE];
+	} u;
+	u32 size;
+};
+
+/* Image of each netlist index, from NETLIST_FINAL to the last slot */
+static const char *const netlist_test_names[] = {
+	"NETF_test.bin", "NETA_test.bin", "NETB_test.bin",
+	"NETC_test.bin", "NETD_test.bin",
+};
+
+static const u32 netlist_test_data[] = {
+	0x11111111U, 0x22222222U, 0x33333333U, 0x44444444U,
+};
+
+static bool test_netlist_fw_defined(void)
+{
+	return true;
+}
+
+static u32 test_netlist_major_rev_id(struct gk20a *g)
+{
+	(void)g;
+
+	return NETLIST_TEST_MAJOR_V;
+}
+
+static int test_netlist_get_name(struct gk20a *g, int index, char *name)
+{
+	(void)g;
+
+	(void)strcpy(name, netlist_test_names[index + 1]);
+
+	return 0;
+}
+
+static void netlist_test_image_init(struct netlist_test_image *image,
+		u32 regions)
+{
+	(void)memset(image, 0, sizeof(*image));
+	image->u.image.header.regions = regions;
+	image->size = (u32)(sizeof(struct netlist_image_header) +
+			regions * sizeof(struct netlist_region));
+}
+
+/*
+ * Append \a size bytes of test data to the image, \a pad bytes after the
+ * end of the previous region, and describe them in region \a index.
+ */
+static u32 netlist_test_add_region(struct netlist_test_image *image,
+		u32 index, u32 region_id, u32 size, u32 pad)
+{
+	struct netlist_region *region = &image->u.image.regions[index];
+	u32 offset = image->size + pad;
+
+	(void)memcpy(&image->u.bytes[offset], netlist_test_data, size);
+	region->region_id = region_id;
+	region->data_size = size;
+	region->data_offset = offset;
+	image->size = offset + size;
+
+	return offset;
+}
+
+static void netlist_test_add_major_v(struct netlist_test_image *image,
+		u32 index, u32 major_v)
+{
+	u32 offset = netlist_test_add_region(image, index,
+			NETLIST_REGIONID_MAJORV, sizeof(u32), 0U);
+
+	(void)memcpy(&image->u.bytes[offset], &major_v, sizeof(u32));
+}
+
+static int netlist_test_write_image(struct unit_module *m, int index,
+		struct netlist_test_image *image)
+{
+	char path[64];
+	ssize_t len;
+	int fd;
+
+	(void)strcpy(path, NETLIST_TEST_FW_DIR);
+	(void)strcat(path, netlist_test_names[index + 1]);
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		unit_err(m, "cannot create %s\n", path);
+		return -1;
+	}
+	len = write(fd, image->u.bytes, image->size);
+	(void)close(fd);
+	if (len != (ssize_t)image->size) {
+		unit_err(m, "cannot write %s\n", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void netlist_test_remove_images(void)
+{
+	char path[64];
+	u32 i;
+
+	for (i = 0U; i < ARRAY_SIZE(netlist_test_names); i++) {
+		(void)strcpy(path, NETLIST_TEST_FW_DIR);
+		(void)strcat(path, netlist_test_names[i]);
+		(void)unlink(path);
+	}
+}
+
+/*
+ * Drop the netlist loaded so far and have the next load read the test
+ * images. Without \a fw_defined every slot is tried in turn.
+ */
+static void netlist_test_use_images(struct gk20a *g, bool fw_defined)
+{
+	nvgpu_netlist_deinit_ctx_vars(g);
+	g->ops.netlist.get_netlist_name = test_netlist_get_name;
+	g->ops.netlist.is_fw_defined = fw_defined ?
+		test_netlist_fw_defined : test_netlist_fw_not_defined;
+	g->ops.gr.falcon.get_fecs_ctx_state_store_major_rev_id =
+		test_netlist_major_rev_id;
+}
+
+static void netlist_test_restore(struct gk20a *g)
+{
+	nvgpu_netlist_deinit_ctx_vars(g);
+	netlist_test_remove_images();
+	g->ops.netlist.get_netlist_name = gv11b_netlist_get_name;
+	g->ops.netlist.is_fw_defined = gv11b_netlist_is_firmware_defined;
+	g->ops.gr.falcon.get_fecs_ctx_state_store_major_rev_id =
+			gm20b_gr_falcon_get_fecs_ctx_state_store_major_rev_id;
+}
+
+static bool netlist_test_in_image(struct gk20a *g, void *l)
+{
+	struct nvgpu_firmware *fw = g->netlist_vars->fw;
+	u8 *p = (u8 *)l;
+
+	return (p >= fw->data) && (p <= (fw->data + fw->size));
+}
+
 int test_netlist_init_support(struct unit_module *m,
 						struct gk20a *g, void *args)
 {
@@ -214,7 +372,11 @@ static int test_netlist_alloc_failure(struct gk20a *g)
 	struct nvgpu_posix_fault_inj *kmem_fi =
 		nvgpu_kmem_get_fault_injection();
 
-	for (i = 0; i < 12; i++) {
+	/*
+	 * Loading the netlist allocates the netlist vars and the firmware
+	 * image only; the lists point into the resident image.
+	 */
+	for (i = 0; i < 3; i++) {
 		nvgpu_posix_enable_fault_injection(kmem_fi, true, i);
 		err = nvgpu_netlist_init_ctx_vars(g);
 		if (err == 0) {
@@ -271,6 +433,210 @@ int test_netlist_negative_tests(struct unit_module *m,
 	return UNIT_SUCCESS;
 }
 
+int test_netlist_region_copy(struct unit_module *m,
+		struct gk20a *g, void *args)
+{
+	struct netlist_test_image image;
+	struct netlist_av_list *bundles;
+	u32 *list;
+	u32 off;
+	int ret = UNIT_FAIL;
+
+	(void)args;
+
+	/*
+	 * FECS data is word aligned and used in place, FECS inst and the SW
+	 * bundles are not word aligned, GPCCS inst is 6 bytes and so not a
+	 * whole number of words, and GPCCS data is empty, word aligned and
+	 * starts at the end of the image.
+	 */
+	netlist_test_image_init(&image, 6U);
+	netlist_test_add_major_v(&image, 0U, NETLIST_TEST_MAJOR_V);
+	off = netlist_test_add_region(&image, 1U,
+			NETLIST_REGIONID_FECS_UCODE_DATA, 8U, 0U);
+	(void)netlist_test_add_region(&image, 2U,
+			NETLIST_REGIONID_FECS_UCODE_INST, 8U, 2U);
+	(void)netlist_test_add_region(&image, 3U,
+			NETLIST_REGIONID_GPCCS_UCODE_INST, 6U, 2U);
+	(void)netlist_test_add_region(&image, 4U,
+			NETLIST_REGIONID_SW_BUNDLE_INIT, 16U, 0U);
+	image.size += 2U;
+	image.u.image.regions[5].region_id = NETLIST_REGIONID_GPCCS_UCODE_DATA;
+	image.u.image.regions[5].data_size = 0U;
+	image.u.image.regions[5].data_offset = image.size;
+
+	netlist_test_use_images(g, true);
+	if (netlist_test_write_image(m, NETLIST_FINAL, &image) != 0) {
+		goto done;
+	}
+
+	if (nvgpu_netlist_init_ctx_vars(g) != 0) {
+		unit_err(m, "netlist load failed\n");
+		goto done;
+	}
+
+	list = nvgpu_netlist_get_fecs_data_list(g);
+	if ((nvgpu_netlist_get_fecs_data_count(g) != 2U) ||
+	    (list != (u32 *)(void *)(g->netlist_vars->fw->data + off))) {
+		unit_err(m, "aligned region not used in place\n");
+		goto done;
+	}
+
+	list = nvgpu_netlist_get_fecs_inst_list(g);
+	if ((nvgpu_netlist_get_fecs_inst_count(g) != 2U) ||
+	    netlist_test_in_image(g, list) ||
+	    (memcmp(list, netlist_test_data, 8U) != 0)) {
+		unit_err(m, "misaligned region not copied\n");
+		goto done;
+	}
+
+	list = nvgpu_netlist_get_gpccs_inst_list(g);
+	if ((nvgpu_netlist_get_gpccs_inst_count(g) != 2U) ||
+	    netlist_test_in_image(g, list) ||
+	    (memcmp(list, netlist_test_data, 6U) != 0) ||
+	    ((list[1] >> 16U) != 0U)) {
+		unit_err(m, "partial word region not copied\n");
+		goto done;
+	}
+
+	bundles = nvgpu_netlist_get_sw_bundle_init_av_list(g);
+	if ((bundles->count != 2U) || netlist_test_in_image(g, bundles->l) ||
+	    (memcmp(bundles->l, netlist_test_data, 16U) != 0)) {
+		unit_err(m, "misaligned av region not copied\n");
+		goto done;
+	}
+
+	if ((nvgpu_netlist_get_gpccs_data_count(g) != 0U) ||
+	    !netlist_test_in_image(g, nvgpu_netlist_get_gpccs_data_list(g))) {
+		unit_err(m, "empty region at the end not used in place\n");
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	/* Frees the copies and nothing that points into the image */
+	netlist_test_restore(g);
+	return ret;
+}
+
+int test_netlist_region_bounds(struct unit_module *m,
+		struct gk20a *g, void *args)
+{
+	struct netlist_test_image image;
+	int ret = UNIT_FAIL;
+
+	(void)args;
+
+	netlist_test_use_images(g, true);
+
+	/* Region table runs past the end of the image */
+	netlist_test_image_init(&image, 2U);
+	netlist_test_add_major_v(&image, 0U, NETLIST_TEST_MAJOR_V);
+	(void)netlist_test_add_region(&image, 1U,
+			NETLIST_REGIONID_FECS_UCODE_DATA, 8U, 0U);
+	image.u.image.header.regions = NETLIST_TEST_MAX_REGIONS;
+	if (netlist_test_write_image(m, NETLIST_FINAL, &image) != 0) {
+		goto done;
+	}
+	if (nvgpu_netlist_init_ctx_vars(g) == 0) {
+		unit_err(m, "truncated region table loaded\n");
+		goto done;
+	}
+	nvgpu_netlist_deinit_ctx_vars(g);
+
+	/* Image shorter than its header */
+	image.size = sizeof(u32);
+	if (netlist_test_write_image(m, NETLIST_FINAL, &image) != 0) {
+		goto done;
+	}
+	if (nvgpu_netlist_init_ctx_vars(g) == 0) {
+		unit_err(m, "truncated header loaded\n");
+		goto done;
+	}
+	nvgpu_netlist_deinit_ctx_vars(g);
+
+	/* Region data runs past the end of the image */
+	netlist_test_image_init(&image, 2U);
+	netlist_test_add_major_v(&image, 0U, NETLIST_TEST_MAJOR_V);
+	(void)netlist_test_add_region(&image, 1U,
+			NETLIST_REGIONID_FECS_UCODE_DATA, 8U, 0U);
+	image.u.image.regions[1].data_size = 12U;
+	if (netlist_test_write_image(m, NETLIST_FINAL, &image) != 0) {
+		goto done;
+	}
+	if (nvgpu_netlist_init_ctx_vars(g) == 0) {
+		unit_err(m, "out of bounds region loaded\n");
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	netlist_test_restore(g);
+	return ret;
+}
+
+int test_netlist_major_mismatch(struct unit_module *m,
+		struct gk20a *g, void *args)
+{
+	struct nvgpu_posix_call_stats *stats = nvgpu_posix_get_call_stats();
+	struct netlist_test_image image;
+	unsigned long allocs;
+	int ret = UNIT_FAIL;
+
+	(void)args;
+
+	netlist_test_use_images(g, false);
+
+	/*
+	 * Slot A is for another major version and has a misaligned region
+	 * that would have to be copied, slot B is for this one.
+	 */
+	netlist_test_image_init(&image, 2U);
+	netlist_test_add_major_v(&image, 0U, NETLIST_TEST_MAJOR_V + 1U);
+	(void)netlist_test_add_region(&image, 1U,
+			NETLIST_REGIONID_FECS_UCODE_DATA, 8U, 2U);
+	if (netlist_test_write_image(m, NETLIST_SLOT_A, &image) != 0) {
+		goto done;
+	}
+
+	netlist_test_image_init(&image, 2U);
+	netlist_test_add_major_v(&image, 0U, NETLIST_TEST_MAJOR_V);
+	(void)netlist_test_add_region(&image, 1U,
+			NETLIST_REGIONID_FECS_UCODE_DATA, 8U, 0U);
+	if (netlist_test_write_image(m, NETLIST_SLOT_A + 1, &image) != 0) {
+		goto done;
+	}
+
+	/*
+	 * The netlist vars and the descriptor and data of both images are
+	 * allocated; nothing is copied out of slot A.
+	 */
+	allocs = stats->kmem_allocs;
+	if (nvgpu_netlist_init_ctx_vars(g) != 0) {
+		unit_err(m, "netlist load failed\n");
+		goto done;
+	}
+	allocs = stats->kmem_allocs - allocs;
+	if (allocs != 5UL) {
+		unit_err(m, "%lu allocations, expected 5\n", allocs);
+		goto done;
+	}
+
+	if ((g->netlist_vars->fw->size != image.size) ||
+	    !netlist_test_in_image(g, nvgpu_netlist_get_fecs_data_list(g))) {
+		unit_err(m, "slot B not loaded\n");
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	netlist_test_restore(g);
+	return ret;
+}
+
 int test_netlist_remove_support(struct unit_module *m,
 		struct gk20a *g, void *args)
 {
@@ -283,6 +649,9 @@ struct unit_module_test nvgpu_netlist_tests[] = {
 	UNIT_TEST(netlist_init_support, test_netlist_init_support, NULL, 0),
 	UNIT_TEST(netlist_query_tests, test_netlist_query_tests, NULL, 0),
 	UNIT_TEST(netlist_negative_tests, test_netlist_negative_tests, NULL, 0),
+	UNIT_TEST(netlist_region_copy, test_netlist_region_copy, NULL, 0),
+	UNIT_TEST(netlist_region_bounds, test_netlist_region_bounds, NULL, 0),
+	UNIT_TEST(netlist_major_mismatch, test_netlist_major_mismatch, NULL, 0),
 	UNIT_TEST(netlist_remove_support, test_netlist_remove_support, NULL, 0),
 };
 
@@ -127,7 +127,9 @@ int test_netlist_query_tests(struct unit_module *m,
  * Steps:
  * - Call nvgpu_netlist_init_ctx_vars after already initilized netlist
  * - Call nvgpu_netlist_deinit_ctx_vars
- * - Call nvgpu_netlist_init_ctx_vars injecting allocation failures.
+ * - Call nvgpu_netlist_init_ctx_vars injecting a failure into each of its
+ *   allocations: the netlist vars, the firmware descriptor and the firmware
+ *   image. The lists point into the image and allocate nothing.
  * - Set HALs with no netlist defined and invalid netlist check
  * - Call nvgpu_netlist_init_ctx_vars with above test HALs
  * - Restore orginals HALs
@@ -138,6 +140,84 @@ int test_netlist_query_tests(struct unit_module *m,
 int test_netlist_negative_tests(struct unit_module *m,
 		struct gk20a *g, void *args);
 
+/**
+ * Test specification for: test_netlist_region_copy
+ *
+ * Description: Regions of the netlist image that are word aligned and hold
+ * a whole number of elements are used in place, other regions are copied.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_netlist_init_ctx_vars,
+ *          nvgpu_netlist_deinit_ctx_vars
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Load an image with a word aligned FECS data region, FECS inst and SW
+ *   bundle regions that are not word aligned, a GPCCS inst region of 6
+ *   bytes and an empty GPCCS data region at the end of the image.
+ * - Check that the FECS data list points into the image.
+ * - Check that the FECS inst, GPCCS inst and SW bundle lists are copies
+ *   with the data of the regions, the last word of GPCCS inst padded with
+ *   zeros.
+ * - Check that the empty GPCCS data list points at the end of the image.
+ * - Unload the netlist, which frees the copies only.
+ *
+ * Output: Returns PASS if expected result is met, FAIL otherwise.
+ */
+int test_netlist_region_copy(struct unit_module *m,
+		struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_netlist_region_bounds
+ *
+ * Description: Images whose region table or regions do not fit in the image
+ * are not loaded.
+ *
+ * Test Type: Error injection
+ *
+ * Targets: nvgpu_netlist_init_ctx_vars
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Check that loading fails for an image whose region table runs past the
+ *   end of the image.
+ * - Check that loading fails for an image shorter than its header.
+ * - Check that loading fails for an image with a region that runs past the
+ *   end of the image.
+ *
+ * Output: Returns PASS if expected result is met, FAIL otherwise.
+ */
+int test_netlist_region_bounds(struct unit_module *m,
+		struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_netlist_major_mismatch
+ *
+ * Description: A netlist slot for another major version is released without
+ * parsing its regions.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_netlist_init_ctx_vars
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Put an image for another major version, with a region that would have
+ *   to be copied, in slot A and an image for the major version of the HW
+ *   in slot B.
+ * - Load the netlist and check that the only allocations are the netlist
+ *   vars and the firmware of both slots.
+ * - Check that the lists point into the image of slot B.
+ *
+ * Output: Returns PASS if expected result is met, FAIL otherwise.
+ */
+int test_netlist_major_mismatch(struct unit_module *m,
+		struct gk20a *g, void *args);
+
 /**
  * Test specification for: test_netlist_remove_support
  *
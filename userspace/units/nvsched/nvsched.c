@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+
+#include <unit/io.h>
+#include <unit/unit.h>
+
+#include <nvgpu/types.h>
+#include <nvgpu/gk20a.h>
+#include <nvgpu/kmem.h>
+#include <nvgpu/string.h>
+#include <nvgpu/timers.h>
+
+#include <nvs/sched.h>
+#include <nvs/domain.h>
+
+#include "nvsched.h"
+
+#define NVS_TEST_DOMAINS	100U
+#define NVS_BENCH_DOMAINS	4096U
+#define NVS_BENCH_TICKS		(NVS_BENCH_DOMAINS * 16U)
+
+/*
+ * Stride used to visit domains in a scattered order; coprime with
+ * NVS_BENCH_DOMAINS.
+ */
+#define NVS_BENCH_STRIDE	1237U
+
+static struct nvs_sched_ops nvs_test_ops;
+
+static void nvs_test_name(char *name, size_t size, u32 i)
+{
+	(void)snprintf(name, size, "domain-%u", i);
+}
+
+static int nvs_test_setup(struct unit_module *m, struct gk20a *g,
+			  struct nvs_sched *sched, u32 nr)
+{
+	char name[32];
+	u32 i;
+
+	if (nvs_sched_create(sched, &nvs_test_ops, g) != 0) {
+		unit_err(m, "failed to create scheduler\n");
+		return -1;
+	}
+
+	for (i = 0U; i < nr; i++) {
+		nvs_test_name(name, sizeof(name), i);
+		if (nvs_domain_create(sched, (u64)i + 1ULL, name,
+				      1000ULL, 0ULL, NULL) == NULL) {
+			unit_err(m, "failed to create domain %u\n", i);
+			nvs_sched_close(sched);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Walk the list in both directions and check it against the count and the
+ * two indexes.
+ */
+static int nvs_test_check_list(struct unit_module *m, struct nvs_sched *sched)
+{
+	struct nvs_domain_list *dlist = sched->domain_list;
+	struct nvs_domain *dom, *prev = NULL;
+	u32 nr = 0U;
+
+	nvs_domain_for_each(sched, dom) {
+		if (dom->prev != prev) {
+			unit_err(m, "%s: bad prev link\n", dom->name);
+			return -1;
+		}
+		if (nvs_domain_by_name(sched, dom->name) != dom ||
+		    nvs_domain_by_id(sched, dom->id) != dom) {
+			unit_err(m, "%s: not indexed\n", dom->name);
+			return -1;
+		}
+		prev = dom;
+		nr++;
+	}
+
+	if (dlist->last != prev || nr != nvs_domain_count(sched)) {
+		unit_err(m, "list tail or count mismatch (%u vs %u)\n",
+			 nr, nvs_domain_count(sched));
+		return -1;
+	}
+
+	return 0;
+}
+
+int test_nvs_domain_list(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct nvs_sched sched;
+	struct nvs_domain *dom, *first, *last, *mid;
+	char name[32];
+	u32 i;
+	int ret = UNIT_FAIL;
+
+	if (nvs_test_setup(m, g, &sched, NVS_TEST_DOMAINS) != 0) {
+		return UNIT_FAIL;
+	}
+
+	if (sched.domain_list->hash_size <= NVS_DOMAIN_HASH_MIN_SIZE) {
+		unit_err(m, "hash did not grow: %u buckets\n",
+			 sched.domain_list->hash_size);
+		goto done;
+	}
+
+	if (nvs_test_check_list(m, &sched) != 0) {
+		goto done;
+	}
+
+	if (nvs_domain_by_name(&sched, "no-such-domain") != NULL ||
+	    nvs_domain_by_id(&sched, 0ULL) != NULL ||
+	    nvs_domain_by_id(&sched, (u64)NVS_TEST_DOMAINS + 1ULL) != NULL) {
+		unit_err(m, "lookup of a missing domain succeeded\n");
+		goto done;
+	}
+
+	/* Remove head, tail and one from the middle. */
+	first = sched.domain_list->domains;
+	last = sched.domain_list->last;
+	nvs_test_name(name, sizeof(name), NVS_TEST_DOMAINS / 2U);
+	mid = nvs_domain_by_name(&sched, name);
+	if (mid == NULL) {
+		unit_err(m, "%s not found\n", name);
+		goto done;
+	}
+
+	nvs_domain_destroy(&sched, first);
+	nvs_domain_destroy(&sched, last);
+	nvs_domain_destroy(&sched, mid);
+
+	if (nvs_domain_count(&sched) != NVS_TEST_DOMAINS - 3U) {
+		unit_err(m, "bad count after removal\n");
+		goto done;
+	}
+
+	if (nvs_domain_by_name(&sched, name) != NULL ||
+	    nvs_domain_by_id(&sched, 1ULL) != NULL ||
+	    nvs_domain_by_id(&sched, (u64)NVS_TEST_DOMAINS) != NULL) {
+		unit_err(m, "removed domain still indexed\n");
+		goto done;
+	}
+
+	if (nvs_test_check_list(m, &sched) != 0) {
+		goto done;
+	}
+
+	/* Round robin must wrap from the tail back to the head. */
+	dom = sched.domain_list->domains;
+	for (i = 0U; i < nvs_domain_count(&sched); i++) {
+		dom = nvs_domain_get_next(&sched, dom);
+	}
+	if (dom != sched.domain_list->domains) {
+		unit_err(m, "round robin did not wrap to the head\n");
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	nvs_sched_close(&sched);
+	return ret;
+}
+
+static struct nvs_domain *nvs_test_linear_by_name(struct nvs_sched *sched,
+						  const char *name)
+{
+	struct nvs_domain *dom;
+
+	nvs_domain_for_each(sched, dom) {
+		if (strcmp(dom->name, name) == 0) {
+			return dom;
+		}
+	}
+
+	return NULL;
+}
+
+int test_nvs_domain_bench(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct nvs_sched sched;
+	struct nvs_domain *dom;
+	char name[32];
+	s64 t0, t_name, t_id, t_linear, t_tick, t_destroy;
+	u32 i, idx;
+	int ret = UNIT_FAIL;
+
+	t0 = nvgpu_current_time_ns();
+	if (nvs_test_setup(m, g, &sched, NVS_BENCH_DOMAINS) != 0) {
+		return UNIT_FAIL;
+	}
+	unit_info(m, "create %u domains: %lld us\n", NVS_BENCH_DOMAINS,
+		  (nvgpu_current_time_ns() - t0) / 1000);
+
+	t0 = nvgpu_current_time_ns();
+	for (i = 0U; i < NVS_BENCH_DOMAINS; i++) {
+		nvs_test_name(name, sizeof(name), i);
+		dom = nvs_domain_by_name(&sched, name);
+		if (dom == NULL || dom->id != (u64)i + 1ULL) {
+			unit_err(m, "name lookup failed for %s\n", name);
+			goto done;
+		}
+	}
+	t_name = nvgpu_current_time_ns() - t0;
+
+	t0 = nvgpu_current_time_ns();
+	for (i = 0U; i < NVS_BENCH_DOMAINS; i++) {
+		dom = nvs_domain_by_id(&sched, (u64)i + 1ULL);
+		if (dom == NULL || dom->id != (u64)i + 1ULL) {
+			unit_err(m, "id lookup failed for %u\n", i + 1U);
+			goto done;
+		}
+	}
+	t_id = nvgpu_current_time_ns() - t0;
+
+	t0 = nvgpu_current_time_ns();
+	for (i = 0U; i < NVS_BENCH_DOMAINS; i++) {
+		nvs_test_name(name, sizeof(name), i);
+		if (nvs_test_linear_by_name(&sched, name) !=
+		    nvs_domain_by_name(&sched, name)) {
+			unit_err(m, "linear and hashed lookup differ\n");
+			goto done;
+		}
+	}
+	t_linear = nvgpu_current_time_ns() - t0;
+
+	t0 = nvgpu_current_time_ns();
+	dom = sched.domain_list->domains;
+	for (i = 0U; i < NVS_BENCH_TICKS; i++) {
+		dom = nvs_domain_get_next(&sched, dom);
+	}
+	t_tick = nvgpu_current_time_ns() - t0;
+
+	if (dom != sched.domain_list->domains) {
+		unit_err(m, "tick cursor out of sync\n");
+		goto done;
+	}
+
+	t0 = nvgpu_current_time_ns();
+	for (i = 0U; i < NVS_BENCH_DOMAINS; i++) {
+		idx = (i * NVS_BENCH_STRIDE) % NVS_BENCH_DOMAINS;
+		dom = nvs_domain_by_id(&sched, (u64)idx + 1ULL);
+		if (dom == NULL) {
+			unit_err(m, "domain %u vanished\n", idx + 1U);
+			goto done;
+		}
+		nvs_domain_destroy(&sched, dom);
+	}
+	t_destroy = nvgpu_current_time_ns() - t0;
+
+	if (nvs_domain_count(&sched) != 0U ||
+	    sched.domain_list->domains != NULL ||
+	    sched.domain_list->last != NULL) {
+		unit_err(m, "domains left after destroy\n");
+		goto done;
+	}
+
+	unit_info(m, "lookup by name: %lld ns/op (linear walk %lld ns/op)\n",
+		  t_name / NVS_BENCH_DOMAINS, t_linear / NVS_BENCH_DOMAINS);
+	unit_info(m, "lookup by id:   %lld ns/op\n", t_id / NVS_BENCH_DOMAINS);
+	unit_info(m, "tick:           %lld ns/op\n", t_tick / NVS_BENCH_TICKS);
+	unit_info(m, "lookup+destroy: %lld ns/op\n",
+		  t_destroy / NVS_BENCH_DOMAINS);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	nvs_sched_close(&sched);
+	return ret;
+}
+
+struct unit_module_test nvsched_tests[] = {
+	UNIT_TEST(domain_list,  test_nvs_domain_list,  NULL, 0),
+	UNIT_BENCH(domain_bench, test_nvs_domain_bench, NULL, 0),
+};
+
+UNIT_MODULE(nvsched, nvsched_tests, UNIT_PRIO_NVGPU_TEST);
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2022-2020, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @addtogroup SWUTS-nvsched
+ * @{
+ *
+ * Software Unit Test Specification for nvsched
+ */
+
+#ifndef UNIT_NVSCHED_H
+#define UNIT_NVSCHED_H
+
+struct gk20a;
+struct unit_module;
+
+/**
+ * Test specification for: test_nvs_domain_list
+ *
+ * Description: Check that the nvsched domain list and its name and ID
+ * indexes stay consistent across creation and removal of domains.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvs_sched_create, nvs_domain_create, nvs_domain_destroy,
+ *          nvs_domain_by_name, nvs_domain_by_id, nvs_domain_get_next,
+ *          nvs_domain_count, nvs_sched_close
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Create a scheduler and enough domains to grow the hash tables past
+ *   their initial size.
+ * - Check that every domain can be found by name and by ID and that
+ *   unknown names and IDs are not found.
+ * - Remove the head, the tail and a domain from the middle of the list and
+ *   check that the list links, the count and both indexes are updated.
+ * - Walk the list with nvs_domain_get_next() and check that it wraps
+ *   around to the first domain after the last one.
+ * - Close the scheduler.
+ *
+ * Output: Returns PASS if all checks pass; otherwise returns FAIL.
+ */
+int test_nvs_domain_list(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_nvs_domain_bench
+ *
+ * Description: Benchmark of domain lookup, round robin ticks and domain
+ * removal with thousands of domains, run with --bench.
+ *
+ * Test Type: Performance
+ *
+ * Targets: nvs_domain_create, nvs_domain_destroy, nvs_domain_by_name,
+ *          nvs_domain_by_id, nvs_domain_get_next
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Create NVS_BENCH_DOMAINS domains.
+ * - Look every domain up by name and by ID, and for comparison by name
+ *   with a linear walk of the domain list. Check the results match.
+ * - Advance a round robin cursor over the domains several times, as the
+ *   scheduler tick does.
+ * - Look up and destroy every domain in an order that is neither list
+ *   order nor reverse list order.
+ * - Report the time taken for each phase.
+ *
+ * Output: Returns PASS if every lookup returns the expected domain and all
+ * domains are destroyed; otherwise returns FAIL.
+ */
+int test_nvs_domain_bench(struct unit_module *m, struct gk20a *g, void *args);
+
+#endif /* UNIT_NVSCHED_H */
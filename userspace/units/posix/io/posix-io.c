@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+
+#include <unit/io.h>
+#include <unit/unit.h>
+
+#include <nvgpu/types.h>
+#include <nvgpu/timers.h>
+#include <nvgpu/posix/io.h>
+
+#include "posix-io.h"
+
+/*
+ * Keep the test spaces well above the BAR0 mock registers so they never
+ * overlap with them.
+ */
+#define TEST_SPACE_BASE		0x10000000U
+#define TEST_SPACE_SIZE		0x1000U
+#define TEST_SMALL_OFFSET	0x400U
+#define TEST_SMALL_SIZE		0x100U
+
+#define BENCH_NR_SPACES		64U
+#define BENCH_LOOPS		4000U
+
+static u32 test_small_data[TEST_SMALL_SIZE / sizeof(u32)];
+
+static bool check_space(struct unit_module *m, struct gk20a *g, u32 addr,
+			u32 expected_base)
+{
+	struct nvgpu_posix_io_reg_space *space =
+		nvgpu_posix_io_get_reg_space(g, addr);
+
+	if ((space == NULL) || (space->base != expected_base)) {
+		unit_err(m, "addr 0x%x: expected space 0x%x got 0x%x\n", addr,
+			 expected_base, (space == NULL) ? 0U : space->base);
+		return false;
+	}
+
+	return true;
+}
+
+static bool check_no_space(struct unit_module *m, struct gk20a *g, u32 addr)
+{
+	nvgpu_posix_io_reset_error_code(g);
+	if (nvgpu_posix_io_get_reg_space(g, addr) != NULL) {
+		unit_err(m, "addr 0x%x: unexpected space\n", addr);
+		return false;
+	}
+	if (nvgpu_posix_io_get_error_code(g) != -EFAULT) {
+		unit_err(m, "addr 0x%x: error code not set\n", addr);
+		return false;
+	}
+	nvgpu_posix_io_reset_error_code(g);
+
+	return true;
+}
+
+int test_reg_space_lookup(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct nvgpu_posix_io_reg_space small = {
+		.base = TEST_SPACE_BASE + TEST_SPACE_SIZE + TEST_SMALL_OFFSET,
+		.size = TEST_SMALL_SIZE,
+		.data = test_small_data,
+	};
+	/* Two adjacent spaces, then a gap of one space size. */
+	const u32 bases[3] = {
+		TEST_SPACE_BASE,
+		TEST_SPACE_BASE + TEST_SPACE_SIZE,
+		TEST_SPACE_BASE + 3U * TEST_SPACE_SIZE,
+	};
+	u32 mid = bases[1];
+	bool registered = false;
+	int ret = UNIT_FAIL;
+	u32 i;
+
+	for (i = 0U; i < 3U; i++) {
+		if (nvgpu_posix_io_add_reg_space(g, bases[i],
+						 TEST_SPACE_SIZE) != 0) {
+			unit_err(m, "failed to add space %u\n", i);
+			goto out;
+		}
+	}
+
+	for (i = 0U; i < 3U; i++) {
+		if (!check_space(m, g, bases[i], bases[i]) ||
+		    !check_space(m, g, bases[i] + TEST_SPACE_SIZE - 4U,
+				 bases[i])) {
+			goto out;
+		}
+	}
+	if (!check_no_space(m, g, bases[1] + TEST_SPACE_SIZE) ||
+	    !check_no_space(m, g, bases[2] - 4U) ||
+	    !check_no_space(m, g, bases[2] + TEST_SPACE_SIZE)) {
+		goto out;
+	}
+
+	for (i = 0U; i < 3U; i++) {
+		nvgpu_posix_io_writel_reg_space(g, bases[i], 0xa0U + i);
+	}
+	for (i = 0U; i < 3U; i++) {
+		if (nvgpu_posix_io_readl_reg_space(g, bases[i]) != 0xa0U + i) {
+			unit_err(m, "space %u: bad read back\n", i);
+			goto out;
+		}
+	}
+
+	/* A newer space takes precedence over the one it overlaps. */
+	if (nvgpu_posix_io_register_reg_space(g, &small) != 0) {
+		unit_err(m, "failed to register small space\n");
+		goto out;
+	}
+	registered = true;
+	if (!check_space(m, g, small.base, small.base) ||
+	    !check_space(m, g, small.base + TEST_SMALL_SIZE - 4U,
+			 small.base) ||
+	    !check_space(m, g, small.base - 4U, mid) ||
+	    !check_space(m, g, small.base + TEST_SMALL_SIZE, mid) ||
+	    !check_space(m, g, mid, mid)) {
+		goto out;
+	}
+	nvgpu_posix_io_writel_reg_space(g, small.base, 0x55U);
+	if (test_small_data[0] != 0x55U) {
+		unit_err(m, "write did not land in small space\n");
+		goto out;
+	}
+
+	nvgpu_posix_io_unregister_reg_space(g, &small);
+	registered = false;
+	if (!check_space(m, g, small.base, mid)) {
+		goto out;
+	}
+
+	ret = UNIT_SUCCESS;
+out:
+	if (registered) {
+		nvgpu_posix_io_unregister_reg_space(g, &small);
+	}
+	for (i = 0U; i < 3U; i++) {
+		nvgpu_posix_io_delete_reg_space(g, bases[i]);
+	}
+	for (i = 0U; (ret == UNIT_SUCCESS) && (i < 3U); i++) {
+		if (!check_no_space(m, g, bases[i])) {
+			ret = UNIT_FAIL;
+		}
+	}
+	nvgpu_posix_io_reset_error_code(g);
+
+	return ret;
+}
+
+int test_reg_space_bench(struct unit_module *m, struct gk20a *g, void *args)
+{
+	u32 nr_added = 0U;
+	u32 addr, loop, i;
+	s64 start_ns;
+	int ret = UNIT_FAIL;
+
+	for (i = 0U; i < BENCH_NR_SPACES; i++) {
+		if (nvgpu_posix_io_add_reg_space(g,
+				TEST_SPACE_BASE + i * TEST_SPACE_SIZE,
+				TEST_SPACE_SIZE) != 0) {
+			unit_err(m, "failed to add space %u\n", i);
+			goto out;
+		}
+		nr_added++;
+	}
+
+	start_ns = nvgpu_current_time_ns();
+	for (loop = 0U; loop < BENCH_LOOPS; loop++) {
+		for (i = 0U; i < BENCH_NR_SPACES; i++) {
+			addr = TEST_SPACE_BASE + i * TEST_SPACE_SIZE +
+				((loop * 4U) % TEST_SPACE_SIZE);
+			nvgpu_posix_io_writel_reg_space(g, addr, loop ^ i);
+			if (nvgpu_posix_io_readl_reg_space(g, addr) !=
+			    (loop ^ i)) {
+				unit_err(m, "bad read back at 0x%x\n", addr);
+				goto out;
+			}
+		}
+	}
+	unit_info(m, "%u spaces, scattered: %lld ns/access\n",
+		  BENCH_NR_SPACES, unit_bench_ns_per_op(start_ns,
+				2U * BENCH_LOOPS * BENCH_NR_SPACES));
+
+	addr = TEST_SPACE_BASE + (BENCH_NR_SPACES - 1U) * TEST_SPACE_SIZE;
+	start_ns = nvgpu_current_time_ns();
+	for (loop = 0U; loop < BENCH_LOOPS * BENCH_NR_SPACES; loop++) {
+		nvgpu_posix_io_writel_reg_space(g, addr, loop);
+		if (nvgpu_posix_io_readl_reg_space(g, addr) != loop) {
+			unit_err(m, "bad read back at 0x%x\n", addr);
+			goto out;
+		}
+	}
+	unit_info(m, "%u spaces, same register: %lld ns/access\n",
+		  BENCH_NR_SPACES, unit_bench_ns_per_op(start_ns,
+				2U * BENCH_LOOPS * BENCH_NR_SPACES));
+
+	ret = UNIT_SUCCESS;
+out:
+	for (i = 0U; i < nr_added; i++) {
+		nvgpu_posix_io_delete_reg_space(g,
+				TEST_SPACE_BASE + i * TEST_SPACE_SIZE);
+	}
+
+	return ret;
+}
+
+int test_recorder(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct nvgpu_reg_access seq[3] = {
+		{ .addr = 0x100U, .value = 1U },
+		{ .addr = 0x104U, .value = 2U },
+		{ .addr = 0x108U, .value = 3U },
+	};
+	struct nvgpu_reg_access sub[2] = {
+		{ .addr = 0x100U, .value = 1U },
+		{ .addr = 0x108U, .value = 3U },
+	};
+	struct nvgpu_reg_access extra[4] = {
+		{ .addr = 0x100U, .value = 1U },
+		{ .addr = 0x104U, .value = 2U },
+		{ .addr = 0x108U, .value = 3U },
+		{ .addr = 0x10cU, .value = 4U },
+	};
+	struct nvgpu_reg_access bad[3] = {
+		{ .addr = 0x100U, .value = 1U },
+		{ .addr = 0x104U, .value = 7U },
+		{ .addr = 0x108U, .value = 3U },
+	};
+	struct nvgpu_reg_access tail[2];
+	struct nvgpu_reg_access access;
+	u32 i;
+
+	nvgpu_posix_io_start_recorder(g);
+	for (i = 0U; i < 3U; i++) {
+		access = seq[i];
+		nvgpu_posix_io_record_access(g, &access);
+	}
+
+	if (!nvgpu_posix_io_check_sequence(g, seq, 3U, true) ||
+	    !nvgpu_posix_io_check_sequence(g, seq, 3U, false)) {
+		unit_return_fail(m, "recorded sequence does not match\n");
+	}
+	if (nvgpu_posix_io_check_sequence(g, sub, 2U, true) ||
+	    !nvgpu_posix_io_check_sequence(g, sub, 2U, false)) {
+		unit_return_fail(m, "subsequence check failed\n");
+	}
+	if (nvgpu_posix_io_check_sequence(g, bad, 3U, false) ||
+	    nvgpu_posix_io_check_sequence(g, extra, 4U, false)) {
+		unit_return_fail(m, "mismatching sequence accepted\n");
+	}
+
+	nvgpu_posix_io_start_recorder(g);
+	if (nvgpu_posix_io_check_sequence(g, seq, 3U, false) ||
+	    !nvgpu_posix_io_check_sequence(g, seq, 0U, true)) {
+		unit_return_fail(m, "restart did not drop accesses\n");
+	}
+
+	for (i = 0U; i <= NVGPU_POSIX_IO_RECORDER_SIZE; i++) {
+		access.addr = i * 4U;
+		access.value = i;
+		nvgpu_posix_io_record_access(g, &access);
+	}
+	for (i = 0U; i < 2U; i++) {
+		tail[i].addr = (NVGPU_POSIX_IO_RECORDER_SIZE - 1U + i) * 4U;
+		tail[i].value = NVGPU_POSIX_IO_RECORDER_SIZE - 1U + i;
+	}
+	if (nvgpu_posix_io_check_sequence(g, tail, 2U, true) ||
+	    !nvgpu_posix_io_check_sequence(g, tail, 2U, false)) {
+		unit_return_fail(m, "recorder overflow check failed\n");
+	}
+
+	return UNIT_SUCCESS;
+}
+
+struct unit_module_test posix_io_tests[] = {
+	UNIT_TEST(reg_space_lookup, test_reg_space_lookup, NULL, 0),
+	UNIT_BENCH(reg_space_bench, test_reg_space_bench, NULL, 0),
+	UNIT_TEST(recorder, test_recorder, NULL, 0),
+};
+
+UNIT_MODULE(posix_io, posix_io_tests, UNIT_PRIO_POSIX_TEST);
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * @addtogroup SWUTS-posix-io
+ * @{
+ *
+ * Software Unit Test Specification for posix-io
+ */
+
+#ifndef UNIT_POSIX_IO_H
+#define UNIT_POSIX_IO_H
+
+/**
+ * Test specification for test_reg_space_lookup
+ *
+ * Description: Test that register accesses resolve to the right register
+ * space, including overlapping spaces and spaces that are removed again.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_posix_io_add_reg_space, nvgpu_posix_io_get_reg_space,
+ *          nvgpu_posix_io_register_reg_space,
+ *          nvgpu_posix_io_unregister_reg_space,
+ *          nvgpu_posix_io_writel_reg_space, nvgpu_posix_io_readl_reg_space,
+ *          nvgpu_posix_io_delete_reg_space
+ *
+ * Inputs:
+ * 1) GPU driver struct g.
+ *
+ * Steps:
+ * 1) Add two adjacent register spaces and a third one with a gap in between.
+ *    Check that the first and last word of each space resolve to it and
+ *    that addresses in the gap and past the last space do not resolve and
+ *    set the error code to -EFAULT.
+ * 2) Write a different value to the first word of every space and read the
+ *    values back.
+ * 3) Register a small space in the middle of the second space. Check that
+ *    it takes precedence within its range and that the second space is
+ *    still used on both sides of it.
+ * 4) Unregister the small space and check that its range resolves to the
+ *    second space again.
+ * 5) Delete all spaces and check that none of their addresses resolve.
+ *
+ * Output:
+ * The test returns PASS if all lookups return the expected space. Otherwise,
+ * the test returns FAIL.
+ */
+int test_reg_space_lookup(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for test_reg_space_bench
+ *
+ * Description: Benchmark of register space lookups with many registered
+ * spaces, run with --bench.
+ *
+ * Test Type: Performance
+ *
+ * Targets: nvgpu_posix_io_add_reg_space, nvgpu_posix_io_readl_reg_space,
+ *          nvgpu_posix_io_writel_reg_space, nvgpu_posix_io_delete_reg_space
+ *
+ * Inputs:
+ * 1) GPU driver struct g.
+ *
+ * Steps:
+ * 1) Add 64 register spaces of 4KB each.
+ * 2) Write and read back one register in every space, looping over all
+ *    spaces many times, and report the time per access.
+ * 3) Repeatedly access a single register and report the time per access.
+ * 4) Delete all spaces.
+ *
+ * Output:
+ * The test returns PASS if every read returns the value written before.
+ * Otherwise, the test returns FAIL.
+ */
+int test_reg_space_bench(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for test_recorder
+ *
+ * Description: Test the register access recorder.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_posix_io_start_recorder, nvgpu_posix_io_record_access,
+ *          nvgpu_posix_io_check_sequence
+ *
+ * Inputs:
+ * 1) GPU driver struct g.
+ *
+ * Steps:
+ * 1) Start the recorder and record three accesses.
+ * 2) Check that the exact sequence matches in strict mode, that a
+ *    subsequence only matches in non-strict mode and that a sequence with a
+ *    wrong value or an extra access does not match.
+ * 3) Restart the recorder and check that the previous accesses are gone.
+ * 4) Record #NVGPU_POSIX_IO_RECORDER_SIZE + 1 accesses. Check that strict
+ *    mode fails because the first access was dropped and that the last two
+ *    accesses still match in non-strict mode.
+ *
+ * Output:
+ * The test returns PASS if all sequence checks return the expected result.
+ * Otherwise, the test returns FAIL.
+ */
+int test_recorder(struct unit_module *m, struct gk20a *g, void *args);
+
+#endif /* UNIT_POSIX_IO_H */
@@ -27,6 +27,8 @@
 #include <unit/unit.h>
 
 #include <nvgpu/kmem.h>
+#include <nvgpu/sizes.h>
+#include <nvgpu/timers.h>
 #include "posix-kmem.h"
 
 #define KMEM_TEST_CACHE_SIZE 512
@@ -244,9 +246,231 @@ int test_kmem_big_alloc(struct unit_module *m,
 	return UNIT_SUCCESS;
 }
 
+#define KMEM_SLAB_TEST_OBJ_SIZE	24U
+#define KMEM_SLAB_TEST_NUM_OBJS	3U
+
+int test_kmem_cache_slab(struct unit_module *m,
+				struct gk20a *g, void *args)
+{
+	struct nvgpu_kmem_cache *test_cache;
+	struct nvgpu_kmem_cache_stats stats;
+	void *objs[KMEM_SLAB_TEST_NUM_OBJS];
+	void *big_objs[2];
+	void *ptr;
+	u32 i;
+	int ret = UNIT_FAIL;
+
+	test_cache = nvgpu_kmem_cache_create(g, KMEM_SLAB_TEST_OBJ_SIZE);
+	if (test_cache == NULL) {
+		unit_return_fail(m, "Kmem cache create failed\n");
+	}
+
+	for (i = 0U; i < KMEM_SLAB_TEST_NUM_OBJS; i++) {
+		objs[i] = nvgpu_kmem_cache_alloc(test_cache);
+		if (objs[i] == NULL) {
+			unit_err(m, "Kmem cache alloc %u failed\n", i);
+			goto out;
+		}
+		if (((uintptr_t)objs[i] & 15U) != 0U) {
+			unit_err(m, "Object %u misaligned\n", i);
+			goto out;
+		}
+		memset(objs[i], 0xa5, KMEM_SLAB_TEST_OBJ_SIZE);
+	}
+
+	if ((objs[0] == objs[1]) || (objs[1] == objs[2]) ||
+	    (objs[0] == objs[2])) {
+		unit_err(m, "Kmem cache returned an object twice\n");
+		goto out;
+	}
+
+	/* A freed object is handed out again first */
+	nvgpu_kmem_cache_free(test_cache, objs[1]);
+	ptr = nvgpu_kmem_cache_alloc(test_cache);
+	if (ptr != objs[1]) {
+		unit_err(m, "Freed object not reused\n");
+		goto out;
+	}
+
+	/* Freeing NULL is allowed */
+	nvgpu_kmem_cache_free(test_cache, NULL);
+
+	nvgpu_kmem_cache_get_stats(test_cache, &stats);
+	if ((stats.nr_slabs != 1U) || (stats.nr_allocs != 4U) ||
+	    (stats.nr_frees != 1U) || (stats.nr_active != 3U) ||
+	    (stats.nr_objs != 3U)) {
+		unit_err(m, "Bad kmem cache stats\n");
+		goto out;
+	}
+
+	ret = UNIT_SUCCESS;
+out:
+	nvgpu_kmem_cache_destroy(test_cache);
+	if (ret != UNIT_SUCCESS) {
+		return ret;
+	}
+
+	/* Objects larger than a slab get a slab each */
+	test_cache = nvgpu_kmem_cache_create(g, SZ_64K);
+	if (test_cache == NULL) {
+		unit_return_fail(m, "Kmem cache create failed (big)\n");
+	}
+	big_objs[0] = nvgpu_kmem_cache_alloc(test_cache);
+	big_objs[1] = nvgpu_kmem_cache_alloc(test_cache);
+	nvgpu_kmem_cache_get_stats(test_cache, &stats);
+	if ((big_objs[0] == NULL) || (big_objs[1] == NULL) ||
+	    (stats.nr_slabs != 2U)) {
+		ret = UNIT_FAIL;
+		unit_err(m, "Big object allocation failed\n");
+	} else {
+		memset(big_objs[0], 0, SZ_64K);
+		memset(big_objs[1], 0, SZ_64K);
+		nvgpu_kmem_cache_free(test_cache, big_objs[0]);
+		nvgpu_kmem_cache_free(test_cache, big_objs[1]);
+	}
+	nvgpu_kmem_cache_destroy(test_cache);
+
+	return ret;
+}
+
+/*
+ * Compare kmem cache objects against plain malloc() with
+ * KMEM_BENCH_NUM_OBJS live objects of a typical allocator node size.
+ */
+#define KMEM_BENCH_OBJ_SIZE	64U
+#define KMEM_BENCH_NUM_OBJS	100000U
+#define KMEM_BENCH_CHURN_WINDOW	64U
+
+int test_kmem_cache_bench(struct unit_module *m,
+				struct gk20a *g, void *args)
+{
+	struct nvgpu_kmem_cache *test_cache;
+	struct nvgpu_kmem_cache_stats stats;
+	void **objs;
+	u64 nr_slabs;
+	s64 start_ns;
+	u32 i, pass;
+	int ret = UNIT_FAIL;
+
+	objs = malloc(sizeof(void *) * KMEM_BENCH_NUM_OBJS);
+	if (objs == NULL) {
+		unit_return_fail(m, "Object array allocation failed\n");
+	}
+
+	test_cache = nvgpu_kmem_cache_create(g, KMEM_BENCH_OBJ_SIZE);
+	if (test_cache == NULL) {
+		free(objs);
+		unit_return_fail(m, "Kmem cache create failed\n");
+	}
+
+	/* First pass fills new slabs, second pass reuses freed objects. */
+	for (pass = 0U; pass < 2U; pass++) {
+		start_ns = nvgpu_current_time_ns();
+		for (i = 0U; i < KMEM_BENCH_NUM_OBJS; i++) {
+			objs[i] = nvgpu_kmem_cache_alloc(test_cache);
+			if (objs[i] == NULL) {
+				unit_err(m, "Kmem cache alloc %u failed\n", i);
+				goto out;
+			}
+		}
+		unit_info(m, "cache alloc (pass %u): %lld ns/alloc\n", pass,
+			unit_bench_ns_per_op(start_ns, KMEM_BENCH_NUM_OBJS));
+
+		if (pass == 0U) {
+			nvgpu_kmem_cache_get_stats(test_cache, &stats);
+			nr_slabs = stats.nr_slabs;
+		}
+
+		start_ns = nvgpu_current_time_ns();
+		for (i = 0U; i < KMEM_BENCH_NUM_OBJS; i++) {
+			nvgpu_kmem_cache_free(test_cache, objs[i]);
+		}
+		unit_info(m, "cache free (pass %u): %lld ns/free\n", pass,
+			unit_bench_ns_per_op(start_ns, KMEM_BENCH_NUM_OBJS));
+	}
+
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < KMEM_BENCH_NUM_OBJS; i++) {
+		u32 slot = i % KMEM_BENCH_CHURN_WINDOW;
+
+		if (i >= KMEM_BENCH_CHURN_WINDOW) {
+			nvgpu_kmem_cache_free(test_cache, objs[slot]);
+		}
+		objs[slot] = nvgpu_kmem_cache_alloc(test_cache);
+		if (objs[slot] == NULL) {
+			unit_err(m, "Kmem cache churn alloc %u failed\n", i);
+			goto out;
+		}
+	}
+	for (i = 0U; i < KMEM_BENCH_CHURN_WINDOW; i++) {
+		nvgpu_kmem_cache_free(test_cache, objs[i]);
+	}
+	unit_info(m, "cache churn: %lld ns/alloc+free\n",
+		unit_bench_ns_per_op(start_ns, KMEM_BENCH_NUM_OBJS));
+
+	for (pass = 0U; pass < 2U; pass++) {
+		start_ns = nvgpu_current_time_ns();
+		for (i = 0U; i < KMEM_BENCH_NUM_OBJS; i++) {
+			objs[i] = malloc(KMEM_BENCH_OBJ_SIZE);
+			if (objs[i] == NULL) {
+				unit_err(m, "malloc %u failed\n", i);
+				goto out;
+			}
+		}
+		unit_info(m, "malloc (pass %u): %lld ns/alloc\n", pass,
+			unit_bench_ns_per_op(start_ns, KMEM_BENCH_NUM_OBJS));
+
+		start_ns = nvgpu_current_time_ns();
+		for (i = 0U; i < KMEM_BENCH_NUM_OBJS; i++) {
+			free(objs[i]);
+		}
+		unit_info(m, "free (pass %u): %lld ns/free\n", pass,
+			unit_bench_ns_per_op(start_ns, KMEM_BENCH_NUM_OBJS));
+	}
+
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < KMEM_BENCH_NUM_OBJS; i++) {
+		u32 slot = i % KMEM_BENCH_CHURN_WINDOW;
+
+		if (i >= KMEM_BENCH_CHURN_WINDOW) {
+			free(objs[slot]);
+		}
+		objs[slot] = malloc(KMEM_BENCH_OBJ_SIZE);
+		if (objs[slot] == NULL) {
+			unit_err(m, "malloc churn %u failed\n", i);
+			goto out;
+		}
+	}
+	for (i = 0U; i < KMEM_BENCH_CHURN_WINDOW; i++) {
+		free(objs[i]);
+	}
+	unit_info(m, "malloc churn: %lld ns/alloc+free\n",
+		unit_bench_ns_per_op(start_ns, KMEM_BENCH_NUM_OBJS));
+
+	/* Reuse must not have added slabs */
+	nvgpu_kmem_cache_get_stats(test_cache, &stats);
+	if ((stats.nr_slabs != nr_slabs) ||
+	    (stats.nr_slabs >= KMEM_BENCH_NUM_OBJS / 100U) ||
+	    (stats.nr_active != 0U) ||
+	    (stats.nr_allocs != stats.nr_frees) ||
+	    (stats.nr_objs != KMEM_BENCH_NUM_OBJS)) {
+		unit_err(m, "Bad kmem cache stats: slabs %llu/%llu\n",
+			stats.nr_slabs, nr_slabs);
+		goto out;
+	}
+
+	ret = UNIT_SUCCESS;
+out:
+	nvgpu_kmem_cache_destroy(test_cache);
+	free(objs);
+	return ret;
+}
+
 struct unit_module_test posix_kmem_tests[] = {
 	UNIT_TEST(cache_create,   test_kmem_cache_create, NULL, 0),
 	UNIT_TEST(cache_alloc,    test_kmem_cache_alloc, NULL, 0),
+	UNIT_TEST(cache_slab,     test_kmem_cache_slab, NULL, 0),
+	UNIT_BENCH(cache_bench,   test_kmem_cache_bench, NULL, 0),
 	UNIT_TEST(kmalloc_test,   test_kmem_kmalloc, NULL, 0),
 	UNIT_TEST(kzalloc_test,   test_kmem_kzalloc, NULL, 0),
 	UNIT_TEST(kcalloc_test,   test_kmem_kcalloc, NULL, 0),
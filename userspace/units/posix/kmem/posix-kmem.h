@@ -99,6 +99,68 @@ int test_kmem_cache_create(struct unit_module *m,
 int test_kmem_cache_alloc(struct unit_module *m,
                                 struct gk20a *g, void *args);
 
+/**
+ * Test specification for test_kmem_cache_slab
+ *
+ * Description: Test that kmem cache objects come from slabs and are reused.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_kmem_cache_create, nvgpu_kmem_cache_alloc,
+ *          nvgpu_kmem_cache_free, nvgpu_kmem_cache_get_stats,
+ *          nvgpu_kmem_cache_destroy
+ *
+ * Inputs:
+ * 1) GPU driver struct g.
+ *
+ * Steps:
+ * 1) Create a cache for 24 byte objects and allocate three objects. Check
+ *    that they are distinct, 16 byte aligned and writable.
+ * 2) Free the second object and allocate again. Check that the freed object
+ *    is returned.
+ * 3) Free a NULL pointer.
+ * 4) Check that the statistics report one slab, four allocations, one free,
+ *    three active objects and three objects carved from the slab. Destroy the cache.
+ * 5) Create a cache for 64KB objects, allocate two objects and check that
+ *    each got its own slab. Free them and destroy the cache.
+ *
+ * Output:
+ * The test returns PASS if all checks pass. Otherwise, the test returns FAIL.
+ */
+int test_kmem_cache_slab(struct unit_module *m,
+                                struct gk20a *g, void *args);
+
+/**
+ * Test specification for test_kmem_cache_bench
+ *
+ * Description: Benchmark comparing kmem cache allocations with malloc, run
+ * with --bench.
+ *
+ * Test Type: Performance
+ *
+ * Targets: nvgpu_kmem_cache_create, nvgpu_kmem_cache_alloc,
+ *          nvgpu_kmem_cache_free, nvgpu_kmem_cache_get_stats,
+ *          nvgpu_kmem_cache_destroy
+ *
+ * Inputs:
+ * 1) GPU driver struct g.
+ *
+ * Steps:
+ * 1) Create a cache for 64 byte objects.
+ * 2) Twice allocate 100000 objects and free them again, timing both loops.
+ * 3) Time 100000 alloc/free pairs with 64 live objects.
+ * 4) Repeat steps 2 and 3 with malloc and free and report all timings.
+ * 5) Check that the second pass did not allocate slabs, that there are far
+ *    fewer slabs than objects, that no object is active and that exactly
+ *    100000 objects were carved from the slabs. Destroy the cache.
+ *
+ * Output:
+ * The test returns PASS if all allocations succeed and the statistics
+ * match. Otherwise, the test returns FAIL.
+ */
+int test_kmem_cache_bench(struct unit_module *m,
+                                struct gk20a *g, void *args);
+
 /**
  * Test specification for test_kmem_kmalloc
  *
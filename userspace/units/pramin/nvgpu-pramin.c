@@ -31,9 +31,11 @@
 #include <nvgpu/nvgpu_mem.h>
 #include <nvgpu/page_allocator.h>
 #include <nvgpu/pramin.h>
+#include <nvgpu/pd_cache.h>
 #include <nvgpu/enabled.h>
 #include <nvgpu/dma.h>
 #include <nvgpu/bug.h>
+#include <nvgpu/kmem.h>
 #include <nvgpu/gk20a.h>
 
 #include "hal/bus/bus_gk20a.h"
@@ -225,7 +227,7 @@ static int create_alloc_and_sgt(struct unit_module *m, struct gk20a *g,
 {
 	struct nvgpu_sgt *sgt;
 
-	mem->vidmem_alloc = (struct nvgpu_page_alloc *) malloc(sizeof(
+	mem->vidmem_alloc = (struct nvgpu_page_alloc *) calloc(1, sizeof(
 		struct nvgpu_page_alloc));
 	if (mem->vidmem_alloc == NULL) {
 		unit_err(m, "Memory allocation failed\n");
@@ -473,6 +475,305 @@ free_vidmem:
 		return UNIT_FAIL;
 }
 
+/*
+ * Count PRAM window programmings so that tests can check how many separate
+ * PRAMIN accesses an operation needed.
+ */
+static u32 bar0_window_count;
+
+static u32 counting_set_bar0_window(struct gk20a *g, struct nvgpu_mem *mem,
+	struct nvgpu_sgt *sgt, void *sgl, u32 w)
+{
+	bar0_window_count++;
+	return gk20a_bus_set_bar0_window(g, mem, sgt, sgl, w);
+}
+
+/* Number of two-word PTEs written by the PD staging test */
+#define PD_TEST_PTES 128U
+
+/*
+ * Test case to exercize PD write staging: writing a run of PTEs to a vidmem
+ * PD must reach VIDMEM unchanged while programming the PRAM window once per
+ * contiguous run instead of once per word.
+ */
+static int test_pramin_pd_write_staged(struct unit_module *m, struct gk20a *g,
+				void *__args)
+{
+	struct nvgpu_mem mem = { };
+	struct nvgpu_mem sysmem = { };
+	struct nvgpu_gmmu_pd pd = { };
+	struct nvgpu_pd_stage *stage;
+	struct nvgpu_mem_sgl *sgl;
+	u32 pd_offs = SZ_4K;
+	u32 *pd_data;
+	u32 words = PD_TEST_PTES * 2U;
+	u32 unstaged;
+	bool success = false;
+	u32 i;
+
+	if (init_test_env(m, g) != 0) {
+		unit_return_fail(m, "Module init failed\n");
+	}
+
+	stage = malloc(sizeof(*stage));
+	if (stage == NULL) {
+		unit_return_fail(m, "Memory allocation failed\n");
+	}
+
+	if (create_alloc_and_sgt(m, g, &mem) != 0) {
+		goto free_stage;
+	}
+
+	sgl = create_sgl(m, SZ_1M, VIDMEM_ADDRESS);
+	if (sgl == NULL) {
+		goto free_vidmem;
+	}
+	mem.vidmem_alloc->sgt.sgl = (void *)sgl;
+
+	pd.mem = &mem;
+	pd.mem_offs = pd_offs;
+	pd_data = vidmem + (VIDMEM_ADDRESS + pd_offs) / sizeof(u32);
+	g->ops.bus.set_bar0_window = counting_set_bar0_window;
+
+	/* Baseline: every word is its own PRAMIN access. */
+	bar0_window_count = 0U;
+	for (i = 0U; i < words; i++) {
+		nvgpu_pd_write(g, &pd, i, rand_test_data[i]);
+	}
+	unstaged = bar0_window_count;
+	if (unstaged != words) {
+		unit_err(m, "Unstaged writes: %u windows for %u words\n",
+			unstaged, words);
+		goto free_sgl;
+	}
+
+	/* A contiguous run is flushed with a single access. */
+	memset(pd_data, 0, words * sizeof(u32));
+	bar0_window_count = 0U;
+	nvgpu_pd_stage_begin(g, stage, &pd);
+	for (i = 0U; i < words; i++) {
+		nvgpu_pd_write(g, &pd, i, rand_test_data[i]);
+	}
+	if (bar0_window_count != 0U) {
+		unit_err(m, "Staged writes reached VIDMEM before flush\n");
+		goto free_sgl;
+	}
+	nvgpu_pd_stage_end(g, &pd);
+	if (bar0_window_count != 1U || pd.stage != NULL) {
+		unit_err(m, "Staged run: %u windows\n", bar0_window_count);
+		goto free_sgl;
+	}
+	if (memcmp(pd_data, rand_test_data, words * sizeof(u32)) != 0) {
+		unit_err(m, "Mismatch in staged PD contents\n");
+		goto free_sgl;
+	}
+
+	/*
+	 * Overwriting a staged word stays in the run; a gap starts a new run
+	 * and so does overflowing the staging buffer.
+	 */
+	memset(pd_data, 0, (NVGPU_PD_STAGE_WORDS + 8U) * sizeof(u32));
+	bar0_window_count = 0U;
+	nvgpu_pd_stage_begin(g, stage, &pd);
+	nvgpu_pd_write(g, &pd, 0U, 0xdeadU);
+	nvgpu_pd_write(g, &pd, 1U, 0xbeefU);
+	nvgpu_pd_write(g, &pd, 0U, 0xcafeU);
+	nvgpu_pd_write(g, &pd, 4U, 0xf00dU);
+	for (i = 0U; i < NVGPU_PD_STAGE_WORDS; i++) {
+		nvgpu_pd_write(g, &pd, 5U + i, i);
+	}
+	nvgpu_pd_stage_end(g, &pd);
+	if (bar0_window_count != 3U) {
+		unit_err(m, "Split runs: %u windows\n", bar0_window_count);
+		goto free_sgl;
+	}
+	if (pd_data[0] != 0xcafeU || pd_data[1] != 0xbeefU ||
+	    pd_data[2] != 0U || pd_data[4] != 0xf00dU ||
+	    pd_data[5U + NVGPU_PD_STAGE_WORDS - 1U] !=
+			NVGPU_PD_STAGE_WORDS - 1U) {
+		unit_err(m, "Mismatch in split run PD contents\n");
+		goto free_sgl;
+	}
+
+	/* Sysmem PDs are never staged. */
+	sysmem.aperture = APERTURE_SYSMEM;
+	sysmem.cpu_va = pd_data;
+	pd.mem = &sysmem;
+	pd.mem_offs = 0U;
+	nvgpu_pd_stage_begin(g, stage, &pd);
+	nvgpu_pd_write(g, &pd, 0U, 0x1234U);
+	if (pd.stage != NULL || pd_data[0] != 0x1234U) {
+		unit_err(m, "Sysmem PD was staged\n");
+		nvgpu_pd_stage_end(g, &pd);
+		goto free_sgl;
+	}
+	nvgpu_pd_stage_end(g, &pd);
+
+	unit_info(m, "%u words: %u windows unstaged, 1 staged\n", words,
+		unstaged);
+	success = true;
+
+free_sgl:
+	g->ops.bus.set_bar0_window = gk20a_bus_set_bar0_window;
+	free(sgl);
+free_vidmem:
+	free(mem.vidmem_alloc);
+free_stage:
+	free(stage);
+
+	if (success)
+		return UNIT_SUCCESS;
+	else
+		return UNIT_FAIL;
+}
+
+/* Number and size of the chunks used by the SGL cursor test */
+#define CURSOR_TEST_CHUNKS	4096U
+#define CURSOR_TEST_CHUNK_SIZE	SZ_1K
+#define CURSOR_TEST_ACCESSES	(4U * CURSOR_TEST_CHUNKS)
+
+/*
+ * Count the SGL list steps taken by PRAMIN so that tests can check how much
+ * of the SGL list an access had to walk.
+ */
+static u32 sgl_next_count;
+static void *(*sgl_next_orig)(void *sgl);
+
+static void *counting_sgl_next(void *sgl)
+{
+	sgl_next_count++;
+	return sgl_next_orig(sgl);
+}
+
+/*
+ * Test case to exercize the SGL lookup cache of PRAMIN accesses. The buffer
+ * is made of CURSOR_TEST_CHUNKS chunks laid out in VIDMEM in reverse order.
+ * Sequential and random accesses must land at the right VIDMEM address while
+ * walking a bounded number of SGL entries per access, no matter how far into
+ * the buffer they are.
+ */
+static int test_pramin_sgl_cursor(struct unit_module *m, struct gk20a *g,
+				void *__args)
+{
+	struct nvgpu_mem mem = { };
+	struct nvgpu_sgt_ops ops;
+	struct nvgpu_mem_sgl *sgls;
+	struct nvgpu_page_alloc *alloc;
+	u32 chunk_words = CURSOR_TEST_CHUNK_SIZE / sizeof(u32);
+	u32 total_words = CURSOR_TEST_CHUNKS * chunk_words;
+	bool success = false;
+	u32 i, w, data;
+
+	if (init_test_env(m, g) != 0) {
+		unit_return_fail(m, "Module init failed\n");
+	}
+
+	sgls = calloc(CURSOR_TEST_CHUNKS, sizeof(*sgls));
+	if (sgls == NULL) {
+		unit_return_fail(m, "Memory allocation failed\n");
+	}
+
+	if (create_alloc_and_sgt(m, g, &mem) != 0) {
+		goto free_sgls;
+	}
+	alloc = mem.vidmem_alloc;
+
+	for (i = 0U; i < CURSOR_TEST_CHUNKS; i++) {
+		sgls[i].length = CURSOR_TEST_CHUNK_SIZE;
+		sgls[i].phys = VIDMEM_ADDRESS + (u64)(CURSOR_TEST_CHUNKS -
+			1U - i) * CURSOR_TEST_CHUNK_SIZE;
+		sgls[i].next = (i + 1U < CURSOR_TEST_CHUNKS) ?
+			&sgls[i + 1U] : NULL;
+	}
+
+	ops = *alloc->sgt.ops;
+	sgl_next_orig = ops.sgl_next;
+	ops.sgl_next = counting_sgl_next;
+	alloc->sgt.ops = &ops;
+	alloc->sgt.sgl = (void *)sgls;
+	alloc->nr_chunks = (int)CURSOR_TEST_CHUNKS;
+
+	/* Sequential: one word per access across the whole buffer. */
+	sgl_next_count = 0U;
+	for (w = 0U; w < total_words; w++) {
+		data = w ^ 0x5a5a5a5aU;
+		nvgpu_pramin_wr_n(g, &mem, (u64)w * sizeof(u32), sizeof(u32),
+			&data);
+	}
+	/*
+	 * The first access builds the chunk index, after that crossing into
+	 * a chunk costs one step in the access leaving the previous chunk and
+	 * one in the lookup of the next access.
+	 */
+	if (sgl_next_count > 3U * CURSOR_TEST_CHUNKS) {
+		unit_err(m, "Sequential access: %u SGL steps\n",
+			sgl_next_count);
+		goto free_alloc;
+	}
+
+	for (w = 0U; w < total_words; w++) {
+		u32 chunk = w / chunk_words;
+		u32 idx = (VIDMEM_ADDRESS / sizeof(u32)) +
+			(CURSOR_TEST_CHUNKS - 1U - chunk) * chunk_words +
+			(w % chunk_words);
+
+		if (vidmem[idx] != (w ^ 0x5a5a5a5aU)) {
+			unit_err(m, "Sequential mismatch at word %u\n", w);
+			goto free_alloc;
+		}
+	}
+
+	/*
+	 * Random: the chunk index is in place, so no access may walk more
+	 * than the single step checking the chunk after the cursor.
+	 */
+	srand(0);
+	sgl_next_count = 0U;
+	for (i = 0U; i < CURSOR_TEST_ACCESSES; i++) {
+		u32 val = 0U;
+
+		w = (u32)rand() % total_words;
+		nvgpu_pramin_rd_n(g, &mem, (u64)w * sizeof(u32), sizeof(u32),
+			&val);
+		if (val != (w ^ 0x5a5a5a5aU)) {
+			unit_err(m, "Random mismatch at word %u\n", w);
+			goto free_alloc;
+		}
+	}
+	if (alloc->chunk_index == NULL ||
+	    sgl_next_count > CURSOR_TEST_ACCESSES) {
+		unit_err(m, "Random access: %u SGL steps\n", sgl_next_count);
+		goto free_alloc;
+	}
+
+	/* An access spanning chunks continues from the right place. */
+	nvgpu_pramin_memset(g, &mem, CURSOR_TEST_CHUNK_SIZE - sizeof(u32),
+		2U * sizeof(u32), 0U);
+	if (vidmem[(VIDMEM_ADDRESS / sizeof(u32)) +
+			(CURSOR_TEST_CHUNKS - 1U) * chunk_words +
+			chunk_words - 1U] != 0U ||
+	    vidmem[(VIDMEM_ADDRESS / sizeof(u32)) +
+			(CURSOR_TEST_CHUNKS - 2U) * chunk_words] != 0U) {
+		unit_err(m, "Mismatch in access spanning two chunks\n");
+		goto free_alloc;
+	}
+
+	success = true;
+
+free_alloc:
+	if (alloc->chunk_index != NULL) {
+		nvgpu_kfree(g, alloc->chunk_index);
+	}
+	free(alloc);
+free_sgls:
+	free(sgls);
+
+	if (success)
+		return UNIT_SUCCESS;
+	else
+		return UNIT_FAIL;
+}
+
 /*
  * Test case to exercize the special case where NVGPU is dying. In that case,
  * PRAM is not available and PRAMIN should handle the case by not trying to
@@ -504,6 +805,9 @@ struct unit_module_test pramin_tests[] = {
 	UNIT_TEST(nvgpu_pramin_rd_n_1_sgl, test_pramin_rd_n_single, NULL, 0),
 	UNIT_TEST(nvgpu_pramin_wr_n_3_sgl, test_pramin_wr_n_multi, NULL, 0),
 	UNIT_TEST(nvgpu_pramin_memset, test_pramin_memset, NULL, 0),
+	UNIT_TEST(nvgpu_pramin_pd_write_staged, test_pramin_pd_write_staged,
+		NULL, 0),
+	UNIT_TEST(nvgpu_pramin_sgl_cursor, test_pramin_sgl_cursor, NULL, 0),
 	UNIT_TEST(nvgpu_pramin_dying, test_pramin_nvgpu_dying, NULL, 0),
 	UNIT_TEST(nvgpu_pramin_free_test_env, free_test_env, NULL, 0),
 #endif
@@ -0,0 +1,740 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include <unit/io.h>
+#include <unit/unit.h>
+
+#include <nvgpu/gk20a.h>
+
+#ifdef CONFIG_NVGPU_DEBUGGER
+#include <nvgpu/regops.h>
+#include <nvgpu/tsg.h>
+#include <nvgpu/timers.h>
+#include <nvgpu/hal_init.h>
+#include <nvgpu/posix/io.h>
+#endif
+
+#include "nvgpu-regops.h"
+
+#ifdef CONFIG_NVGPU_DEBUGGER
+
+#define NV_PMC_BOOT_0_ARCHITECTURE_GV110	(0x00000015 << \
+					NVGPU_GPU_ARCHITECTURE_SHIFT)
+#define NV_PMC_BOOT_0_IMPLEMENTATION_B		0xB
+
+/* BAR0 space reachable by regops: 24-bit offsets. */
+#define REGOPS_BAR0_SIZE		0x01000000U
+/* Offsets of a regop that are not a 24-bit, 4-byte aligned offset. */
+#define REGOPS_INVALID_OFFSET_BITS	0xFF000003U
+
+#define REGOPS_TEST_MAX_OPS		64U
+
+#define REGOPS_BENCH_OPS		4096U
+#define REGOPS_BENCH_BATCHES		200U
+
+/*
+ * Test lists. The first global range crosses a page of registers and the
+ * last one ends at the last 24-bit offset. The runcontrol offsets are in
+ * none of the ranges.
+ */
+static const struct regop_offset_range regops_test_global[] = {
+	{ 0x00000ffc,   2 },
+	{ 0x00100000,   4 },
+	{ 0x00fffffc,   1 },
+};
+
+static const struct regop_offset_range regops_test_context[] = {
+	{ 0x00100010,   4 },
+	{ 0x00419e00,  16 },
+};
+
+static const u32 regops_test_runcontrol[] = {
+	0x00419e40,
+	0x00504000,
+};
+
+static struct gops_regops regops_gv11b_ops;
+static bool regops_env_ready;
+
+/* Only passed around, ctx ops are not used. */
+static struct nvgpu_tsg regops_tsg;
+
+static const struct regop_offset_range *regops_test_get_global(void)
+{
+	return regops_test_global;
+}
+
+static u64 regops_test_get_global_count(void)
+{
+	return ARRAY_SIZE(regops_test_global);
+}
+
+static const struct regop_offset_range *regops_test_get_context(void)
+{
+	return regops_test_context;
+}
+
+static u64 regops_test_get_context_count(void)
+{
+	return ARRAY_SIZE(regops_test_context);
+}
+
+static const u32 *regops_test_get_runcontrol(void)
+{
+	return regops_test_runcontrol;
+}
+
+static u64 regops_test_get_runcontrol_count(void)
+{
+	return ARRAY_SIZE(regops_test_runcontrol);
+}
+
+static int regops_exec_nop(struct gk20a *g, struct nvgpu_tsg *tsg,
+		struct nvgpu_dbg_reg_op *ops, u32 num_ops,
+		u32 ctx_wr_count, u32 ctx_rd_count, u32 *flags)
+{
+	(void)g;
+	(void)tsg;
+	(void)ops;
+	(void)num_ops;
+	(void)ctx_wr_count;
+	(void)ctx_rd_count;
+	(void)flags;
+
+	return 0;
+}
+
+static void regops_writel(struct gk20a *g, struct nvgpu_reg_access *access)
+{
+	nvgpu_posix_io_writel_reg_space(g, access->addr, access->value);
+}
+
+static void regops_readl(struct gk20a *g, struct nvgpu_reg_access *access)
+{
+	access->value = nvgpu_posix_io_readl_reg_space(g, access->addr);
+}
+
+static struct nvgpu_posix_io_callbacks regops_reg_callbacks = {
+	.writel          = regops_writel,
+	.writel_check    = regops_writel,
+	.bar1_writel     = regops_writel,
+	.usermode_writel = regops_writel,
+	.__readl         = regops_readl,
+	.readl           = regops_readl,
+	.bar1_readl      = regops_readl,
+};
+
+static int regops_env_init(struct unit_module *m, struct gk20a *g)
+{
+	if (regops_env_ready) {
+		return UNIT_SUCCESS;
+	}
+
+	if (nvgpu_posix_io_add_reg_space(g, 0U, REGOPS_BAR0_SIZE) != 0) {
+		unit_err(m, "failed to create register space\n");
+		return UNIT_FAIL;
+	}
+
+	(void)nvgpu_posix_register_io(g, &regops_reg_callbacks);
+
+	g->params.gpu_arch = NV_PMC_BOOT_0_ARCHITECTURE_GV110;
+	g->params.gpu_impl = NV_PMC_BOOT_0_IMPLEMENTATION_B;
+
+	if (nvgpu_init_hal(g) != 0) {
+		unit_err(m, "nvgpu_init_hal failed\n");
+		nvgpu_posix_io_delete_reg_space(g, 0U);
+		return UNIT_FAIL;
+	}
+
+	regops_gv11b_ops = g->ops.regops;
+	regops_env_ready = true;
+
+	return UNIT_SUCCESS;
+}
+
+static void regops_use_test_lists(struct gk20a *g)
+{
+	nvgpu_regops_allowlist_deinit(g);
+
+	g->ops.regops.get_global_whitelist_ranges = regops_test_get_global;
+	g->ops.regops.get_global_whitelist_ranges_count =
+		regops_test_get_global_count;
+	g->ops.regops.get_context_whitelist_ranges = regops_test_get_context;
+	g->ops.regops.get_context_whitelist_ranges_count =
+		regops_test_get_context_count;
+	g->ops.regops.get_runcontrol_whitelist = regops_test_get_runcontrol;
+	g->ops.regops.get_runcontrol_whitelist_count =
+		regops_test_get_runcontrol_count;
+}
+
+static void regops_use_gv11b_lists(struct gk20a *g)
+{
+	nvgpu_regops_allowlist_deinit(g);
+	g->ops.regops = regops_gv11b_ops;
+}
+
+static bool regops_in_ranges(const struct regop_offset_range *ranges,
+		size_t count, u32 offset)
+{
+	size_t i;
+
+	for (i = 0U; i < count; i++) {
+		if ((offset >= ranges[i].base) &&
+				(offset < ranges[i].base +
+					(ranges[i].count * 4U))) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool regops_in_runcontrol(u32 offset)
+{
+	size_t i;
+
+	for (i = 0U; i < ARRAY_SIZE(regops_test_runcontrol); i++) {
+		if (regops_test_runcontrol[i] == offset) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Whether the test lists allow one register for an op of type. */
+static bool regops_test_allowed(u8 type, u32 offset, bool valid_ctx)
+{
+	bool global = regops_in_ranges(regops_test_global,
+			ARRAY_SIZE(regops_test_global), offset);
+	bool context = regops_in_ranges(regops_test_context,
+			ARRAY_SIZE(regops_test_context), offset);
+	bool runcontrol = regops_in_runcontrol(offset);
+
+	if (type == REGOP(TYPE_GLOBAL)) {
+		return global || (valid_ctx && (context || runcontrol));
+	}
+	if (type == REGOP(TYPE_GR_CTX)) {
+		return context || (valid_ctx && runcontrol);
+	}
+
+	return false;
+}
+
+static bool regops_test_op_allowed(struct nvgpu_dbg_reg_op *op,
+		bool valid_ctx)
+{
+	if ((op->offset & REGOPS_INVALID_OFFSET_BITS) != 0U) {
+		return false;
+	}
+
+	if (!regops_test_allowed(op->type, op->offset, valid_ctx)) {
+		return false;
+	}
+
+	if (op->op == REGOP(READ_64)) {
+		return regops_test_allowed(op->type, op->offset + 4U,
+				valid_ctx);
+	}
+
+	return true;
+}
+
+static void regops_add_offset(u32 *offsets, u32 *count, u32 offset)
+{
+	if (*count < REGOPS_TEST_MAX_OPS) {
+		offsets[*count] = offset;
+		*count += 1U;
+	}
+}
+
+/* Offsets at and next to both ends of each test list entry. */
+static u32 regops_test_offsets(u32 *offsets)
+{
+	const struct regop_offset_range *lists[] = {
+		regops_test_global, regops_test_context,
+	};
+	const size_t counts[] = {
+		ARRAY_SIZE(regops_test_global),
+		ARRAY_SIZE(regops_test_context),
+	};
+	u32 count = 0U;
+	u32 base, last;
+	size_t i, j;
+
+	for (i = 0U; i < ARRAY_SIZE(lists); i++) {
+		for (j = 0U; j < counts[i]; j++) {
+			base = lists[i][j].base;
+			last = base + ((lists[i][j].count - 1U) * 4U);
+			regops_add_offset(offsets, &count, base - 4U);
+			regops_add_offset(offsets, &count, base);
+			regops_add_offset(offsets, &count, last);
+			regops_add_offset(offsets, &count, last + 4U);
+		}
+	}
+
+	for (i = 0U; i < ARRAY_SIZE(regops_test_runcontrol); i++) {
+		base = regops_test_runcontrol[i];
+		regops_add_offset(offsets, &count, base - 4U);
+		regops_add_offset(offsets, &count, base);
+		regops_add_offset(offsets, &count, base + 4U);
+	}
+
+	regops_add_offset(offsets, &count, 0x00100002U);
+
+	return count;
+}
+
+static int regops_check_validation(struct unit_module *m, struct gk20a *g,
+		const u32 *offsets, u32 num_offsets, u8 op, u8 type,
+		bool valid_ctx, u8 *statuses)
+{
+	struct nvgpu_dbg_reg_op ops[REGOPS_TEST_MAX_OPS];
+	u32 flags = NVGPU_REG_OP_FLAG_MODE_CONTINUE_ON_ERROR;
+	bool allowed;
+	int err;
+	u32 i;
+
+	(void)memset(ops, 0, sizeof(ops));
+	for (i = 0U; i < num_offsets; i++) {
+		ops[i].op = op;
+		ops[i].type = type;
+		ops[i].offset = offsets[i];
+	}
+
+	err = nvgpu_regops_exec(g, valid_ctx ? &regops_tsg : NULL, NULL,
+			ops, num_offsets, &flags);
+	if (err != 0) {
+		unit_err(m, "continue on error batch failed: %d\n", err);
+		return UNIT_FAIL;
+	}
+
+	for (i = 0U; i < num_offsets; i++) {
+		allowed = regops_test_op_allowed(&ops[i], valid_ctx);
+		if (allowed !=
+			((ops[i].status & REGOP(STATUS_INVALID_OFFSET)) == 0U)) {
+			unit_err(m, "op %u type %u offset 0x%08x ctx %d: "
+				"status 0x%x, expected %s\n", op, type,
+				offsets[i], valid_ctx, ops[i].status,
+				allowed ? "valid" : "invalid");
+			return UNIT_FAIL;
+		}
+
+		if (statuses[i] == U8_MAX) {
+			statuses[i] = ops[i].status;
+		} else if (statuses[i] != ops[i].status) {
+			unit_err(m, "op %u type %u offset 0x%08x ctx %d: "
+				"status 0x%x with allowlist, 0x%x without\n",
+				op, type, offsets[i], valid_ctx,
+				ops[i].status, statuses[i]);
+			return UNIT_FAIL;
+		}
+	}
+
+	return UNIT_SUCCESS;
+}
+
+static int regops_check_global_offset(struct unit_module *m,
+		struct gk20a *g, u32 offset)
+{
+	bool with_lists, with_allowlist;
+
+	if (offset >= REGOPS_BAR0_SIZE) {
+		return UNIT_SUCCESS;
+	}
+
+	nvgpu_regops_allowlist_deinit(g);
+	with_lists = is_bar0_global_offset_whitelisted_gk20a(g, offset);
+
+	if (nvgpu_regops_allowlist_init(g) != 0) {
+		unit_err(m, "allowlist init failed\n");
+		return UNIT_FAIL;
+	}
+	with_allowlist = is_bar0_global_offset_whitelisted_gk20a(g, offset);
+
+	if (with_lists != with_allowlist) {
+		unit_err(m, "global offset 0x%08x: %d with allowlist, "
+			"%d without\n", offset, with_allowlist, with_lists);
+		return UNIT_FAIL;
+	}
+
+	return UNIT_SUCCESS;
+}
+
+static int regops_check_gv11b_global(struct unit_module *m, struct gk20a *g)
+{
+	const struct regop_offset_range *ranges;
+	u64 i, count;
+	u32 base, last;
+
+	regops_use_gv11b_lists(g);
+
+	ranges = g->ops.regops.get_global_whitelist_ranges();
+	count = g->ops.regops.get_global_whitelist_ranges_count();
+
+	for (i = 0U; i < count; i++) {
+		base = ranges[i].base;
+		last = base + ((ranges[i].count - 1U) * 4U);
+		if ((regops_check_global_offset(m, g, base - 4U) !=
+				UNIT_SUCCESS) ||
+			(regops_check_global_offset(m, g, base) !=
+				UNIT_SUCCESS) ||
+			(regops_check_global_offset(m, g, last) !=
+				UNIT_SUCCESS) ||
+			(regops_check_global_offset(m, g, last + 4U) !=
+				UNIT_SUCCESS)) {
+			return UNIT_FAIL;
+		}
+	}
+
+	return UNIT_SUCCESS;
+}
+
+int test_regops_allowlist(struct unit_module *m, struct gk20a *g, void *args)
+{
+	static const u8 types[] = {
+		REGOP(TYPE_GLOBAL), REGOP(TYPE_GR_CTX), REGOP(TYPE_GR_CTX_TPC),
+	};
+	static const u8 reads[] = { REGOP(READ_32), REGOP(READ_64) };
+	u8 statuses[ARRAY_SIZE(types)][ARRAY_SIZE(reads)][2]
+		[REGOPS_TEST_MAX_OPS];
+	u32 offsets[REGOPS_TEST_MAX_OPS];
+	u32 num_offsets, pass, i, j, ctx;
+	int ret = UNIT_FAIL;
+
+	(void)args;
+
+	if (regops_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	regops_use_test_lists(g);
+	g->ops.regops.exec_regops = regops_exec_nop;
+
+	num_offsets = regops_test_offsets(offsets);
+	regops_add_offset(offsets, &num_offsets, REGOPS_BAR0_SIZE);
+	(void)memset(statuses, U8_MAX, sizeof(statuses));
+
+	/* pass 0 searches the lists, pass 1 uses the allowlist */
+	for (pass = 0U; pass < 2U; pass++) {
+		if ((pass == 1U) && (nvgpu_regops_allowlist_init(g) != 0)) {
+			unit_err(m, "allowlist init failed\n");
+			goto done;
+		}
+
+		for (i = 0U; i < ARRAY_SIZE(types); i++) {
+			for (j = 0U; j < ARRAY_SIZE(reads); j++) {
+				for (ctx = 0U; ctx < 2U; ctx++) {
+					if (regops_check_validation(m, g,
+						offsets, num_offsets, reads[j],
+						types[i], ctx != 0U,
+						statuses[i][j][ctx]) !=
+							UNIT_SUCCESS) {
+						goto done;
+					}
+				}
+			}
+		}
+	}
+
+	if (regops_check_gv11b_global(m, g) != UNIT_SUCCESS) {
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	regops_use_gv11b_lists(g);
+	return ret;
+}
+
+static void regops_set_op(struct nvgpu_dbg_reg_op *op, u8 code, u32 offset,
+		u32 value_lo, u32 mask_lo, u32 value_hi, u32 mask_hi)
+{
+	(void)memset(op, 0, sizeof(*op));
+	op->op = code;
+	op->type = REGOP(TYPE_GLOBAL);
+	op->offset = offset;
+	op->value_lo = value_lo;
+	op->and_n_mask_lo = mask_lo;
+	op->value_hi = value_hi;
+	op->and_n_mask_hi = mask_hi;
+}
+
+int test_regops_exec(struct unit_module *m, struct gk20a *g, void *args)
+{
+	struct nvgpu_dbg_reg_op ops[5];
+	u32 flags;
+	int ret = UNIT_FAIL;
+	int err;
+	u32 i;
+
+	(void)args;
+
+	if (regops_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	regops_use_test_lists(g);
+	if (nvgpu_regops_allowlist_init(g) != 0) {
+		unit_err(m, "allowlist init failed\n");
+		goto done;
+	}
+
+	nvgpu_posix_io_writel_reg_space(g, 0x00100000U, 0x01010101U);
+	nvgpu_posix_io_writel_reg_space(g, 0x00100004U, 0x12345678U);
+	nvgpu_posix_io_writel_reg_space(g, 0x00100008U, 0x55555555U);
+	nvgpu_posix_io_writel_reg_space(g, 0x0010000cU, 0xccccccccU);
+
+	regops_set_op(&ops[0], REGOP(WRITE_32), 0x00100000U,
+		0x11111111U, U32_MAX, 0U, 0U);
+	regops_set_op(&ops[1], REGOP(WRITE_32), 0x00100004U,
+		0x00000a00U, 0x0000ff00U, 0U, 0U);
+	regops_set_op(&ops[2], REGOP(WRITE_64), 0x00100008U,
+		0xaaaaaaaaU, U32_MAX, 0x000000bbU, 0x000000ffU);
+	regops_set_op(&ops[3], REGOP(READ_32), 0x00100004U, 0U, 0U, 0U, 0U);
+	regops_set_op(&ops[4], REGOP(READ_64), 0x00100008U, 0U, 0U, 0U, 0U);
+
+	flags = NVGPU_REG_OP_FLAG_MODE_ALL_OR_NONE;
+	err = nvgpu_regops_exec(g, NULL, NULL, ops, ARRAY_SIZE(ops), &flags);
+	if (err != 0) {
+		unit_err(m, "batch failed: %d\n", err);
+		goto done;
+	}
+
+	for (i = 0U; i < ARRAY_SIZE(ops); i++) {
+		if (ops[i].status != REGOP(STATUS_SUCCESS)) {
+			unit_err(m, "op %u status 0x%x\n", i, ops[i].status);
+			goto done;
+		}
+	}
+
+	if ((nvgpu_posix_io_readl_reg_space(g, 0x00100000U) != 0x11111111U) ||
+		(nvgpu_posix_io_readl_reg_space(g, 0x00100004U) !=
+			0x12340a78U) ||
+		(nvgpu_posix_io_readl_reg_space(g, 0x00100008U) !=
+			0xaaaaaaaaU) ||
+		(nvgpu_posix_io_readl_reg_space(g, 0x0010000cU) !=
+			0xccccccbbU)) {
+		unit_err(m, "unexpected register values after writes\n");
+		goto done;
+	}
+
+	if ((ops[3].value_lo != 0x12340a78U) || (ops[3].value_hi != 0U) ||
+		(ops[4].value_lo != 0xaaaaaaaaU) ||
+		(ops[4].value_hi != 0xccccccbbU)) {
+		unit_err(m, "unexpected values read\n");
+		goto done;
+	}
+
+	/* 0x00200000 is in none of the lists */
+	regops_set_op(&ops[0], REGOP(WRITE_32), 0x00100000U,
+		0x22222222U, U32_MAX, 0U, 0U);
+	regops_set_op(&ops[1], REGOP(WRITE_32), 0x00200000U,
+		0x22222222U, U32_MAX, 0U, 0U);
+	flags = NVGPU_REG_OP_FLAG_MODE_ALL_OR_NONE;
+	err = nvgpu_regops_exec(g, NULL, NULL, ops, 2U, &flags);
+	if (err != -EINVAL) {
+		unit_err(m, "invalid all or none batch returned %d\n", err);
+		goto done;
+	}
+
+	if ((nvgpu_posix_io_readl_reg_space(g, 0x00100000U) != 0x11111111U) ||
+		(nvgpu_posix_io_readl_reg_space(g, 0x00200000U) != 0U)) {
+		unit_err(m, "invalid all or none batch wrote registers\n");
+		goto done;
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	regops_use_gv11b_lists(g);
+	return ret;
+}
+
+/* Spread REGOPS_BENCH_OPS ops over the registers of the global list. */
+static void regops_bench_fill(struct gk20a *g, struct nvgpu_dbg_reg_op *ops)
+{
+	const struct regop_offset_range *ranges =
+		g->ops.regops.get_global_whitelist_ranges();
+	u64 count = g->ops.regops.get_global_whitelist_ranges_count();
+	u64 num_regs = 0U, stride, reg, r;
+	u32 i;
+
+	for (r = 0U; r < count; r++) {
+		num_regs += ranges[r].count;
+	}
+	stride = (num_regs > REGOPS_BENCH_OPS) ?
+		(num_regs / REGOPS_BENCH_OPS) : 1U;
+
+	r = 0U;
+	reg = 0U;
+	for (i = 0U; i < REGOPS_BENCH_OPS; i++) {
+		u64 n = (i * stride) % num_regs;
+
+		if (n < reg) {
+			r = 0U;
+			reg = 0U;
+		}
+		while (n >= reg + ranges[r].count) {
+			reg += ranges[r].count;
+			r++;
+		}
+
+		switch (i % 4U) {
+		case 0U:
+		case 2U:
+			regops_set_op(&ops[i], REGOP(READ_32), 0U,
+				0U, 0U, 0U, 0U);
+			break;
+		case 1U:
+			regops_set_op(&ops[i], REGOP(WRITE_32), 0U,
+				i, U32_MAX, 0U, 0U);
+			break;
+		default:
+			regops_set_op(&ops[i], REGOP(WRITE_32), 0U,
+				i & 0xffU, 0xffU, 0U, 0U);
+			break;
+		}
+		ops[i].offset = ranges[r].base + (u32)((n - reg) * 4U);
+	}
+}
+
+static int regops_bench_run(struct unit_module *m, struct gk20a *g,
+		struct nvgpu_dbg_reg_op *ops, const char *name, u64 *ns)
+{
+	u32 flags;
+	u64 start_ns;
+	u32 i;
+
+	start_ns = nvgpu_current_time_ns();
+	for (i = 0U; i < REGOPS_BENCH_BATCHES; i++) {
+		flags = NVGPU_REG_OP_FLAG_MODE_ALL_OR_NONE;
+		if (nvgpu_regops_exec(g, NULL, NULL, ops, REGOPS_BENCH_OPS,
+				&flags) != 0) {
+			unit_err(m, "%s: batch failed\n", name);
+			return UNIT_FAIL;
+		}
+	}
+	*ns = nvgpu_current_time_ns() - start_ns;
+
+	return UNIT_SUCCESS;
+}
+
+int test_regops_bench(struct unit_module *m, struct gk20a *g, void *args)
+{
+	static const char *const names[] = { "validate", "validate+exec" };
+	struct nvgpu_dbg_reg_op *ops;
+	u64 ns[2];
+	u32 pass, allowlist;
+	double total = (double)REGOPS_BENCH_OPS * REGOPS_BENCH_BATCHES;
+	int ret = UNIT_FAIL;
+
+	(void)args;
+
+	if (regops_env_init(m, g) != UNIT_SUCCESS) {
+		return UNIT_FAIL;
+	}
+
+	ops = malloc(REGOPS_BENCH_OPS * sizeof(*ops));
+	if (ops == NULL) {
+		unit_err(m, "failed to allocate ops\n");
+		return UNIT_FAIL;
+	}
+
+	regops_use_gv11b_lists(g);
+	regops_bench_fill(g, ops);
+
+	unit_info(m, "%u batches of %u ops\n", REGOPS_BENCH_BATCHES,
+		REGOPS_BENCH_OPS);
+
+	for (pass = 0U; pass < ARRAY_SIZE(names); pass++) {
+		g->ops.regops.exec_regops = (pass == 0U) ?
+			regops_exec_nop : regops_gv11b_ops.exec_regops;
+
+		for (allowlist = 0U; allowlist < 2U; allowlist++) {
+			if (allowlist == 0U) {
+				nvgpu_regops_allowlist_deinit(g);
+			} else if (nvgpu_regops_allowlist_init(g) != 0) {
+				unit_err(m, "allowlist init failed\n");
+				goto done;
+			}
+
+			if (regops_bench_run(m, g, ops, names[pass],
+					&ns[allowlist]) != UNIT_SUCCESS) {
+				goto done;
+			}
+		}
+
+		unit_info(m, "%-14s %7.1f ns/op lists %7.1f ns/op allowlist\n",
+			names[pass], (double)ns[0] / total,
+			(double)ns[1] / total);
+	}
+
+	ret = UNIT_SUCCESS;
+
+done:
+	regops_use_gv11b_lists(g);
+	free(ops);
+	return ret;
+}
+
+#else /* CONFIG_NVGPU_DEBUGGER */
+
+int test_regops_allowlist(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "debugger support not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_regops_exec(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "debugger support not built\n");
+	return UNIT_SUCCESS;
+}
+
+int test_regops_bench(struct unit_module *m, struct gk20a *g, void *args)
+{
+	(void)g;
+	(void)args;
+
+	unit_info(m, "debugger support not built\n");
+	return UNIT_SUCCESS;
+}
+
+#endif /* CONFIG_NVGPU_DEBUGGER */
+
+struct unit_module_test nvgpu_regops_tests[] = {
+	UNIT_TEST(regops_allowlist, test_regops_allowlist, NULL, 0),
+	UNIT_TEST(regops_exec, test_regops_exec, NULL, 0),
+	UNIT_BENCH(regops_bench, test_regops_bench, NULL, 0),
+};
+
+UNIT_MODULE(nvgpu-regops, nvgpu_regops_tests, UNIT_PRIO_NVGPU_TEST);
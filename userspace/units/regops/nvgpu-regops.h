@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2022, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#ifndef UNIT_NVGPU_REGOPS_H
+#define UNIT_NVGPU_REGOPS_H
+
+#include <nvgpu/types.h>
+
+struct unit_module;
+struct gk20a;
+
+/** @addtogroup SWUTS-regops
+ *  @{
+ *
+ * Software Unit Test Specification for regops
+ *
+ * The tests run register operations through nvgpu_regops_exec() on gv11b
+ * HALs, with BAR0 emulated by a 16 MB POSIX register space.
+ *
+ * Without CONFIG_NVGPU_DEBUGGER there is nothing to test and the tests only
+ * report that.
+ */
+
+/**
+ * Test specification for: test_regops_allowlist
+ *
+ * Description: Register operations are accepted or rejected the same way
+ * whether the allowlist is built or the lists are searched.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_regops_exec,
+ *          nvgpu_regops_allowlist_init,
+ *          nvgpu_regops_allowlist_deinit,
+ *          is_bar0_global_offset_whitelisted_gk20a
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Install small global, context and runcontrol lists with ranges that
+ *   cross a page of registers and that end at the last 24-bit offset, and an
+ *   exec HAL that does nothing.
+ * - Build ops at the first and last offset of each range and next to them,
+ *   at each runcontrol offset and next to it, and at an unaligned and an
+ *   out of range offset.
+ * - Without and then with the allowlist, and without and with a TSG, run
+ *   the ops as 32 and 64 bit reads of the global, context and TPC context
+ *   types in continue on error mode.
+ * - Check that each op was accepted if and only if the lists allow it for
+ *   its type, and that the status is the same with and without allowlist.
+ * - Restore the gv11b lists, build the allowlist and check that
+ *   is_bar0_global_offset_whitelisted_gk20a() gives the same result as
+ *   without allowlist at the first and last offset of each range and next
+ *   to them.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_regops_allowlist(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_regops_exec
+ *
+ * Description: Global register operations read and write BAR0.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_regops_exec,
+ *          exec_regops_gk20a
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Install the test lists of test_regops_allowlist and build the allowlist.
+ * - Run a batch of a full mask 32 bit write, a partial mask 32 bit write, a
+ *   64 bit write with a full low and a partial high mask, and 32 and 64 bit
+ *   reads of the written registers.
+ * - Check the register space and the values read back.
+ * - Check that an all or none batch with one invalid op fails with -EINVAL
+ *   and writes nothing.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_regops_exec(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * Test specification for: test_regops_bench
+ *
+ * Description: Benchmark of global register operations, run with --bench.
+ *
+ * Test Type: Performance
+ *
+ * Targets: nvgpu_regops_exec,
+ *          exec_regops_gk20a
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Build a batch of 4096 ops spread over the gv11b global list: half 32 bit
+ *   reads, a quarter full mask 32 bit writes and a quarter partial mask
+ *   32 bit writes.
+ * - Time the batch without and with the allowlist, once with an exec HAL
+ *   that does nothing to time validation only, and once with
+ *   exec_regops_gk20a().
+ * - Report ns per op of each.
+ *
+ * Output: Returns PASS if every batch succeeded. FAIL otherwise.
+ */
+int test_regops_bench(struct unit_module *m, struct gk20a *g, void *args);
+
+/**
+ * @}
+ */
+
+#endif /* UNIT_NVGPU_REGOPS_H */
@@ -33,6 +33,10 @@
 #include <nvgpu/channel.h>
 #include <nvgpu/channel_user_syncpt.h>
 
+#ifdef CONFIG_NVGPU_KERNEL_MODE_SUBMIT
+#include "common/sync/channel_sync_priv.h"
+#endif
+
 #include "../fifo/nvgpu-fifo-common.h"
 #include "../fifo/nvgpu-fifo-gv11b.h"
 #include "nvgpu-sync.h"
@@ -515,6 +519,76 @@ done:
 	return ret;
 }
 
+int test_sync_compact_wait_pts(struct unit_module *m, struct gk20a *g,
+		void *args)
+{
+#ifdef CONFIG_NVGPU_KERNEL_MODE_SUBMIT
+	/* Points of a merged fence and the point of each key that must stay. */
+	static const struct {
+		u64 key;
+		u32 thresh;
+		bool kept;
+	} in[] = {
+		{ 1ULL, 10U, false },
+		{ 2ULL, 5U, true },
+		{ 1ULL, 12U, true },
+		{ 3ULL, 7U, true },
+		{ 2ULL, 4U, false },
+		{ 1ULL, 0xfffffff0U, false },
+		{ 4ULL, 0xfffffffeU, false },
+		/* Later than 0xfffffffe after the counter wraps. */
+		{ 4ULL, 2U, true },
+		{ 3ULL, 7U, false },
+	};
+	static const u64 keys[] = { 1ULL, 2ULL, 3ULL, 4ULL };
+	struct nvgpu_channel_sync_wait_pt pts[ARRAY_SIZE(in)];
+	bool seen[ARRAY_SIZE(in)] = { false };
+	u32 kept, i, idx;
+	int ret = UNIT_FAIL;
+
+	(void)g;
+	(void)args;
+
+	for (i = 0U; i < ARRAY_SIZE(in); i++) {
+		pts[i].key = in[i].key;
+		pts[i].thresh = in[i].thresh;
+		pts[i].priv = (void *)&in[i];
+	}
+
+	kept = nvgpu_channel_sync_compact_wait_pts(pts, ARRAY_SIZE(in));
+	assert(kept == ARRAY_SIZE(keys));
+
+	for (i = 0U; i < ARRAY_SIZE(in); i++) {
+		idx = (u32)(((uintptr_t)pts[i].priv - (uintptr_t)&in[0]) /
+				sizeof(in[0]));
+		assert(idx < ARRAY_SIZE(in));
+		assert(!seen[idx]);
+		seen[idx] = true;
+
+		assert(pts[i].key == in[idx].key);
+		assert(pts[i].thresh == in[idx].thresh);
+		/* One point per key, in the order the keys first appear. */
+		assert(in[idx].kept == (i < kept));
+		if (i < kept) {
+			assert(pts[i].key == keys[i]);
+		}
+	}
+
+	assert(nvgpu_channel_sync_compact_wait_pts(pts, 0U) == 0U);
+
+	ret = UNIT_SUCCESS;
+
+done:
+	return ret;
+#else
+	(void)g;
+	(void)args;
+
+	unit_info(m, "kernel mode submit not built\n");
+	return UNIT_SUCCESS;
+#endif
+}
+
 int test_sync_deinit(struct unit_module *m, struct gk20a *g, void *args)
 {
 
@@ -541,6 +615,7 @@ struct unit_module_test nvgpu_sync_tests[] = {
 	UNIT_TEST(sync_user_managed_apis, test_sync_usermanaged_syncpt_apis, NULL, 0),
 	UNIT_TEST(sync_get_ro_map, test_sync_get_ro_map, NULL, 0),
 	UNIT_TEST(sync_fail, test_sync_create_fail, NULL, 0),
+	UNIT_TEST(sync_compact_wait_pts, test_sync_compact_wait_pts, NULL, 0),
 	UNIT_TEST(sync_deinit, test_sync_deinit, NULL, 0),
 };
 
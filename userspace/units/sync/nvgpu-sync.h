@@ -203,6 +203,33 @@ int test_sync_get_ro_map(struct unit_module *m, struct gk20a *g, void *args);
  */
 int test_sync_create_fail(struct unit_module *m, struct gk20a *g, void *args);
 
+/**
+ * Test specification for: test_sync_compact_wait_pts
+ *
+ * Description: Pre-fence compaction keeps one wait per semaphore or
+ * syncpoint, with the latest threshold.
+ *
+ * Test Type: Feature
+ *
+ * Targets: nvgpu_channel_sync_compact_wait_pts
+ *
+ * Input: None
+ *
+ * Steps:
+ * - Compact the points of a fence that has several points on the same keys,
+ *   equal thresholds and thresholds that wrap around.
+ * - Check that one point per key is kept at the start of the array, in the
+ *   order the keys first appear, and that it is the point with the latest
+ *   threshold. With equal thresholds the first point is kept.
+ * - Check that the dropped points are in the rest of the array, so that
+ *   each point given is returned exactly once.
+ * - Check that an empty fence compacts to no points.
+ *
+ * Output: Returns PASS if all branches gave expected results. FAIL otherwise.
+ */
+int test_sync_compact_wait_pts(struct unit_module *m, struct gk20a *g,
+		void *args);
+
 /** @} */
 
 #endif /* UNIT_NVGPU_SYNC_H */